@@ -46,8 +46,9 @@ enum class DestinationType : int {
 typedef std::function<void(std::string)> ResponseFunctor;
 
 // They are passed as a parameter by MessageReceivedFunctor and should be called for responding to
-// the received message. Passing an empty message will mean you don't want to reply.
-typedef std::function<void(const std::string& /*message*/)> ReplyFunctor;
+// the received message. Passing an empty message will mean you don't want to reply.  The reply is
+// taken by value, so passing it with std::move avoids copying it into the response.
+typedef std::function<void(std::string /*message*/)> ReplyFunctor;
 
 // This is called on any message received that is NOT a reply to a request made by the Send method.
 typedef std::function<void(const std::string& /*message*/, bool /*cache_lookup*/,
@@ -57,9 +58,20 @@ typedef std::function<void(const std::string& /*message*/, bool /*cache_lookup*/
 // ValidateThisNode() method with valid public key.
 typedef std::function<void(asymm::PublicKey /*public_key*/)> GivePublicKeyFunctor;
 typedef std::function<void(NodeId /*node Id*/, GivePublicKeyFunctor)> RequestPublicKeyFunctor;
+// Batched alternative to RequestPublicKeyFunctor.  User is supposed to call the
+// GivePublicKeysFunctor once for each of the requested nodes.
+typedef std::function<void(const NodeId& /*node Id*/, const asymm::PublicKey& /*public_key*/)>
+    GivePublicKeysFunctor;
+typedef std::function<void(std::vector<NodeId> /*node Ids*/, GivePublicKeysFunctor)>
+    RequestPublicKeysFunctor;
 
 typedef std::function<bool(std::string& /*data*/)> HaveCacheDataFunctor;
 typedef std::function<void(const std::string& /*data*/)> StoreCacheDataFunctor;
+// Passed the request and the response data of a cacheable Get passing back through this node,
+// returns true if routing may store the response to answer later Gets with.  Without one, only
+// data whose SHA-512 hash is the Get's destination id, as for immutable data, is stored.
+typedef std::function<bool(const std::string& /*request*/, const std::string& /*data*/)>
+    ValidateCacheDataFunctor;
 
 // This functor fires a number from 0 to 100 and represents % network health.
 typedef std::function<void(int /*network_health*/)> NetworkStatusFunctor;
@@ -99,12 +111,14 @@ struct TypedMessageAndCachingFunctor {  // New API
   MessageAndCachingFunctorsType<GroupToSingleMessage> group_to_single;
   MessageAndCachingFunctorsType<GroupToGroupMessage> group_to_group;
   RelayMessageFunctorType<SingleToGroupRelayMessage> single_to_group_relay;
+  ValidateCacheDataFunctor validate_cache_data;
 };
 
 struct MessageAndCachingFunctors {
   MessageReceivedFunctor message_received;
   HaveCacheDataFunctor have_cache_data;
   StoreCacheDataFunctor store_cache_data;
+  ValidateCacheDataFunctor validate_cache_data;
 };
 
 // Note : Provide TypedMessageAndCachingFunctor for typed message API and MessageAndCachingFunctor
@@ -120,6 +134,7 @@ struct Functors {
         matrix_changed(),
         set_public_key(),
         request_public_key(),
+        request_public_keys(),
         new_bootstrap_endpoint() {}
 
   MessageAndCachingFunctors message_and_caching;
@@ -129,6 +144,8 @@ struct Functors {
   MatrixChangedFunctor matrix_changed;
   GivePublicKeyFunctor set_public_key;
   RequestPublicKeyFunctor request_public_key;
+  // Optional.  If set, it is used in preference to request_public_key.
+  RequestPublicKeysFunctor request_public_keys;
   NewBootstrapEndpointFunctor new_bootstrap_endpoint;
 };
 
@@ -0,0 +1,48 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_CACHE_STATISTICS_H_
+#define MAIDSAFE_ROUTING_CACHE_STATISTICS_H_
+
+#include <cstdint>
+
+namespace maidsafe {
+
+namespace routing {
+
+// Counts since startup for the cache of Gets passing through this node.  Byte counts are of the
+// serialised response data.
+struct CacheStatistics {
+  CacheStatistics()
+      : gets_seen(0), hits(0), misses(0), bytes_served(0), bytes_stored(0), entries(0),
+        bytes_held(0) {}
+
+  uint64_t gets_seen;  // cacheable Gets this node was asked to pass on
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t bytes_served;  // sent in answer to hits
+  uint64_t bytes_stored;  // put into the cache, including entries since evicted
+  uint64_t entries;       // currently held
+  uint64_t bytes_held;    // currently held
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_CACHE_STATISTICS_H_
@@ -0,0 +1,62 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_LATENCY_HISTOGRAM_H_
+#define MAIDSAFE_ROUTING_LATENCY_HISTOGRAM_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace maidsafe {
+
+namespace routing {
+
+// Points in the handling of a received message, each timed from when rudp handed it over.
+enum class MessageStage : int32_t {
+  kValidated = 0,  // passed ValidateMessage
+  kRouted = 1,     // routing table decided what to do with it
+  kSent = 2,       // first handed to rudp for sending on (or replying)
+  kUpcall = 3      // passed to the message received functor
+};
+
+enum class DestinationClass : int32_t {
+  kDirect = 0,
+  kGroup = 1,
+  kRelay = 2
+};
+
+// Counts of latencies from receipt to stage for messages of one type and destination class.
+// bucket_counts[i] is the number in [BucketLowerBound(i), BucketLowerBound(i + 1)) microseconds.
+// Buckets double in width every four, so the relative error is at most 25%.
+struct LatencyHistogram {
+  LatencyHistogram();
+
+  static uint64_t BucketLowerBound(size_t index);
+  uint64_t count() const;
+
+  int32_t message_type;  // the protobuf type field; 101 for node level messages
+  DestinationClass destination_class;
+  MessageStage stage;
+  std::vector<uint64_t> bucket_counts;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_LATENCY_HISTOGRAM_H_
@@ -19,8 +19,12 @@
 #ifndef MAIDSAFE_ROUTING_MATRIX_CHANGE_H_
 #define MAIDSAFE_ROUTING_MATRIX_CHANGE_H_
 
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "maidsafe/common/config.h"
@@ -28,6 +32,8 @@
 #include "maidsafe/common/node_id.h"
 #include "maidsafe/common/utils.h"
 
+#include "maidsafe/routing/xor_distance.h"
+
 namespace maidsafe {
 
 namespace routing {
@@ -37,8 +43,11 @@ class GroupMatrix;
 
 namespace test {
 class MatrixChangeTest_BEH_CheckHolders_Test;
+class MatrixChangeTest_BEH_BatchCheckHolders_Test;
 class SingleMatrixChangeTest_BEH_ChoosePmidNode_Test;
 class GroupMatrixTest_BEH_EmptyMatrix_Test;
+class GroupCacheTest_BEH_InvalidateTouchedGroups_Test;
+class ChangeBatcherTest_BEH_MergesMatrixChanges_Test;
 }
 
 enum class GroupRangeStatus {
@@ -53,6 +62,16 @@ struct CheckHoldersResult {
   routing::GroupRangeStatus proximity_status;
 };
 
+// The group matrix's unique node ids as of one version, sorted by distance from the matrix's
+// owner.  Never changed once published, so each MatrixChange from or to that version shares it.
+struct MatrixMembers {
+  MatrixMembers() : version(0), ids() {}
+  MatrixMembers(uint64_t version_in, std::vector<NodeId> ids_in)
+      : version(version_in), ids(std::move(ids_in)) {}
+  uint64_t version;  // zero unless published by a GroupMatrix
+  std::vector<NodeId> ids;
+};
+
 class MatrixChange {
  public:
   MatrixChange();
@@ -61,26 +80,58 @@ class MatrixChange {
   MatrixChange& operator=(MatrixChange other);
 
   CheckHoldersResult CheckHolders(const NodeId& target) const;
+  // Equivalent to calling CheckHolders for each of targets, with results[i] corresponding to
+  // targets[i].  results is resized to match and its elements' storage is reused, so the same
+  // buffer can be passed for each matrix change.  Large batches are split across cores.
+  void CheckHolders(const std::vector<NodeId>& targets,
+                    std::vector<CheckHoldersResult>& results) const;
   NodeId ChoosePmidNode(const std::set<NodeId>& online_pmids, const NodeId& target) const;
-  std::vector<NodeId> lost_nodes() const { return lost_nodes_; }
-  std::vector<NodeId> new_nodes() const { return new_nodes_; }
+  // Equivalent to calling ChoosePmidNode for each of targets, with online_pmids sorted in
+  // ascending order as a std::set would hold them.  Large batches are split across cores.
+  std::vector<NodeId> ChoosePmidNodes(const std::vector<NodeId>& online_pmids,
+                                      const std::vector<NodeId>& targets) const;
+  std::vector<NodeId> lost_nodes() const;
+  std::vector<NodeId> new_nodes() const;
+  // The routing table's matrix epoch once this change was applied, for passing to
+  // Routing::MatrixChangeSince later, or 0 if the change wasn't recorded.
+  uint64_t epoch() const { return epoch_; }
+  // The matrices either side of the change, which may be shared with other changes.
+  std::shared_ptr<const MatrixMembers> old_members() const { return old_members_; }
+  std::shared_ptr<const MatrixMembers> new_members() const { return new_members_; }
   void Print();
 
   friend void swap(MatrixChange& lhs, MatrixChange& rhs) MAIDSAFE_NOEXCEPT;
   friend class GroupMatrix;
   friend class RoutingTable;
+  friend class ChangeBatcher;
   friend class test::MatrixChangeTest_BEH_CheckHolders_Test;
+  friend class test::MatrixChangeTest_BEH_BatchCheckHolders_Test;
   friend class test::SingleMatrixChangeTest_BEH_ChoosePmidNode_Test;
   friend class test::GroupMatrixTest_BEH_EmptyMatrix_Test;
+  friend class test::GroupCacheTest_BEH_InvalidateTouchedGroups_Test;
+  friend class test::ChangeBatcherTest_BEH_MergesMatrixChanges_Test;
 
  private:
-  MatrixChange(NodeId this_node_id, const std::vector<NodeId>& old_matrix,
-               const std::vector<NodeId>& new_matrix);
+  // Sorts the matrices to this_node_id if they aren't already.
+  MatrixChange(NodeId this_node_id, std::vector<NodeId> old_matrix,
+               std::vector<NodeId> new_matrix);
+  // Shares the published matrices, which are already sorted, without copying them.
+  MatrixChange(NodeId this_node_id, std::shared_ptr<const MatrixMembers> old_members,
+               std::shared_ptr<const MatrixMembers> new_members);
+  const std::vector<NodeId>& old_matrix() const { return old_members_->ids; }
+  const std::vector<NodeId>& new_matrix() const { return new_members_->ids; }
+  XorDistance Radius() const;
   bool OldEqualsToNew() const;
+  // lost_nodes_ and new_nodes_ are only worked out once something asks for them.
+  void ComputeDifference() const;
 
   NodeId node_id_;
-  std::vector<NodeId> old_matrix_, new_matrix_, lost_nodes_, new_nodes_;
-  crypto::BigInt radius_;
+  std::shared_ptr<const MatrixMembers> old_members_, new_members_;
+  mutable std::mutex difference_mutex_;
+  mutable bool difference_computed_;
+  mutable std::vector<NodeId> lost_nodes_, new_nodes_;
+  XorDistance radius_;
+  uint64_t epoch_;
 };
 
 }  // namespace routing
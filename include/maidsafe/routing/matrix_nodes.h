@@ -0,0 +1,49 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_MATRIX_NODES_H_
+#define MAIDSAFE_ROUTING_MATRIX_NODES_H_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/routing/node_info.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// The group matrix's unique nodes as of one version, sorted by distance from this node.  Never
+// changed once published, so every holder shares the one copy (see Routing::ClosestNodesSnapshot).
+struct MatrixNodes {
+  MatrixNodes() : version(0), nodes() {}
+  MatrixNodes(uint64_t version_in, std::vector<NodeInfo> nodes_in)
+      : version(version_in), nodes(std::move(nodes_in)) {}
+
+  // Increases whenever the matrix's nodes change, and is the same as the version of the
+  // MatrixChange::new_members published with them.
+  uint64_t version;
+  std::vector<NodeInfo> nodes;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_MATRIX_NODES_H_
@@ -0,0 +1,106 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_MATRIX_SNAPSHOT_H_
+#define MAIDSAFE_ROUTING_MATRIX_SNAPSHOT_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+
+namespace boost {
+namespace interprocess {
+class mapped_region;
+}
+}
+
+namespace maidsafe {
+
+namespace routing {
+
+// Numbered as network_viewer colours them.
+enum class MatrixEntryType : int32_t { kGroup = 0, kClosest = 1, kMatrix = 2 };
+
+typedef std::vector<std::pair<NodeId, MatrixEntryType>> MatrixEntries;
+
+struct MatrixSnapshot {
+  MatrixSnapshot();
+
+  NodeId node_id;
+  MatrixEntries entries;
+};
+
+namespace detail {
+struct MatrixSnapshotSlot;
+}
+
+// network_viewer creates a shared memory region holding a fixed-size slot per node.  Nodes (in
+// TESTING builds) which find the region claim a slot each and rewrite it in place under a seqlock,
+// so the viewer can poll every node at its own rate without updates being queued or lost, and
+// without a slow viewer ever blocking a node.
+// The name of the region network_viewer creates and nodes publish to.  Tests use their own.
+extern const char kMatrixSnapshotRegionName[];
+
+class MatrixSnapshotWriter {
+ public:
+  // Throws if the region doesn't exist or has no free slot.
+  explicit MatrixSnapshotWriter(const NodeId& node_id,
+                                const std::string& region_name = kMatrixSnapshotRegionName);
+  // Frees the slot, which also removes the node from the viewer.
+  ~MatrixSnapshotWriter();
+  // Entries beyond the slot's capacity are left out.  Not to be called concurrently.
+  void Publish(const MatrixEntries& entries);
+
+ private:
+  MatrixSnapshotWriter(const MatrixSnapshotWriter&);
+  MatrixSnapshotWriter& operator=(const MatrixSnapshotWriter&);
+
+  std::unique_ptr<boost::interprocess::mapped_region> region_;
+  detail::MatrixSnapshotSlot* slot_;
+};
+
+class MatrixSnapshotReader {
+ public:
+  // Creates the region, replacing any left by an earlier reader.  Throws on failure.
+  explicit MatrixSnapshotReader(const std::string& region_name = kMatrixSnapshotRegionName);
+  // Removes the region.  Writers already attached keep their mapping until they finish.
+  ~MatrixSnapshotReader();
+  // Sets snapshots to that of each node currently publishing, returning true if any node has
+  // published, joined or left since the last call.  A slot being rewritten is retried a few times,
+  // then its previous snapshot kept.
+  bool Read(std::vector<MatrixSnapshot>& snapshots);
+
+ private:
+  MatrixSnapshotReader(const MatrixSnapshotReader&);
+  MatrixSnapshotReader& operator=(const MatrixSnapshotReader&);
+
+  const std::string kRegionName_;
+  std::unique_ptr<boost::interprocess::mapped_region> region_;
+  std::vector<uint32_t> sequences_;
+  std::vector<MatrixSnapshot> last_snapshots_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_MATRIX_SNAPSHOT_H_
@@ -80,7 +80,7 @@ template <typename Sender, typename Receiver>
 struct Message {
   Message();
   Message(std::string contents_in, Sender sender_in, Receiver receiver_in,
-          Cacheable cacheable_in = Cacheable::kNone);
+          Cacheable cacheable_in = Cacheable::kNone, bool compress_in = false);
   Message(const Message& other);
   Message(Message&& other);
   Message& operator=(Message other);
@@ -89,6 +89,9 @@ struct Message {
   Sender sender;
   Receiver receiver;
   Cacheable cacheable;
+  // If set, contents are compressed by the sender and uncompressed only by the receiver.  Ignored
+  // for cacheable messages.
+  bool compress;
 };
 
 template <typename Sender, typename Receiver>
@@ -140,29 +143,32 @@ bool operator==(const Relay<T>& lhs, const Relay<T>& rhs) {
 
 template <typename Sender, typename Receiver>
 Message<Sender, Receiver>::Message()
-    : contents(), sender(), receiver(), cacheable(Cacheable::kNone) {}
+    : contents(), sender(), receiver(), cacheable(Cacheable::kNone), compress(false) {}
 
 template <typename Sender, typename Receiver>
 Message<Sender, Receiver>::Message(std::string contents_in, Sender sender_in, Receiver receiver_in,
-                                   Cacheable cacheable_in)
+                                   Cacheable cacheable_in, bool compress_in)
     : contents(std::move(contents_in)),
       sender(std::move(sender_in)),
       receiver(std::move(receiver_in)),
-      cacheable(cacheable_in) {}
+      cacheable(cacheable_in),
+      compress(compress_in) {}
 
 template <typename Sender, typename Receiver>
 Message<Sender, Receiver>::Message(const Message& other)
     : contents(other.contents),
       sender(other.sender),
       receiver(other.receiver),
-      cacheable(other.cacheable) {}
+      cacheable(other.cacheable),
+      compress(other.compress) {}
 
 template <typename Sender, typename Receiver>
 Message<Sender, Receiver>::Message(Message&& other)
     : contents(std::move(other.contents)),
       sender(std::move(other.sender)),
       receiver(std::move(other.receiver)),
-      cacheable(std::move(other.cacheable)) {}
+      cacheable(std::move(other.cacheable)),
+      compress(other.compress) {}
 
 template <typename Sender, typename Receiver>
 Message<Sender, Receiver>& Message<Sender, Receiver>::operator=(Message other) {
@@ -177,6 +183,7 @@ void swap(Message<Sender, Receiver>& lhs, Message<Sender, Receiver>& rhs) {
   swap(lhs.sender, rhs.sender);
   swap(lhs.receiver, rhs.receiver);
   swap(lhs.cacheable, rhs.cacheable);
+  swap(lhs.compress, rhs.compress);
 }
 
 typedef Message<SingleSource, SingleId> SingleToSingleMessage;
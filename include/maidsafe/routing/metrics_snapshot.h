@@ -0,0 +1,102 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_METRICS_SNAPSHOT_H_
+#define MAIDSAFE_ROUTING_METRICS_SNAPSHOT_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace maidsafe {
+
+namespace routing {
+
+// Why a received message was dropped before being handled.
+enum class DropReason : int32_t {
+  kUninitialised = 0,
+  kNoHopsLeft = 1,
+  kInvalidDestination = 2,
+  kNoSource = 3,             // neither a source id nor relay information
+  kInvalidSource = 4,
+  kInvalidRelay = 5,         // zero relay id or relay connection id
+  kMustBeDirect = 6,         // a Connect request or FindNodes response that isn't direct
+  kDuplicate = 7,            // a repeat which isn't a kRouteLoop
+  kOverloaded = 8,           // too many awaiting handling; see Routing::dropped_message_count
+  kUpcallQueueFull = 9,      // too many node level messages awaiting the application
+  kRouteLoop = 10,           // a repeat whose route history already holds the receiving node
+  kRateLimited = 11,         // a routing request beyond its source's allowance
+  kExpired = 12,             // a request whose requester has stopped waiting for a response
+  kCount = 13
+};
+
+// What a delivered message was, for MetricsSnapshot::hops_by_class.
+enum class HopClass : int32_t {
+  kRouting = 0,  // a routing message, e.g. a FindNodes or Connect
+  kDirect = 1,   // a node level message for this node
+  kGroup = 2,    // a node level message for a group this node belongs to
+  kCount = 3
+};
+
+// Steps of a Routing object's startup, each timed the first time it happens.
+enum class StartupPhase : int32_t {
+  kConstruct = 0,        // the Routing constructor
+  kMessageHandler = 1,   // setting up message handling, put off until Join or the first message
+  kBootstrap = 2,        // connecting to a bootstrap peer
+  kCount = 3
+};
+
+// Counts since startup, plus gauges read when the snapshot was taken.
+struct MetricsSnapshot {
+  MetricsSnapshot();
+
+  // Keyed by the protobuf type field, with 101 for node level messages and 0 for unknown types.
+  std::map<int32_t, uint64_t> messages_in, messages_out;
+  uint64_t forwarded;  // passed on towards a destination other than this node
+  uint64_t delivered;  // handled by this node
+  std::vector<uint64_t> drops;  // indexed by DropReason
+  // hops_taken[i] is the number of messages delivered after using i of their hops_to_live.  The
+  // last entry also counts any which took more.
+  std::vector<uint64_t> hops_taken;
+  // hops_taken split by HopClass, which it's indexed by.
+  std::vector<std::vector<uint64_t>> hops_by_class;
+  uint64_t send_retries, send_failures;  // of sends on towards a destination, see RecursiveSendOn
+  // Node level messages passed to the application from Parameters::upcall_thread_count threads of
+  // their own, and the total time they spent waiting for one.
+  uint64_t upcalls, upcall_queue_delay_us;
+  // Microseconds each StartupPhase took, indexed by it; zero for any not reached yet.
+  std::vector<uint64_t> startup_us;
+
+  uint64_t routing_table_size, client_routing_table_size, group_matrix_size;
+  uint64_t timer_tasks_outstanding;
+  // Peers waiting for a Connect handshake, and handshakes running (see
+  // Parameters::max_concurrent_connects)
+  uint64_t connects_queued, connects_in_flight;
+  uint64_t upcalls_queued;
+};
+
+// Formats snapshot in the Prometheus text exposition format, each metric name prefixed by prefix.
+std::string ToPrometheusText(const MetricsSnapshot& snapshot,
+                             const std::string& prefix = "maidsafe_routing");
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_METRICS_SNAPSHOT_H_
@@ -20,6 +20,8 @@
 #define MAIDSAFE_ROUTING_NODE_INFO_H_
 
 #include <cstdint>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "maidsafe/common/node_id.h"
@@ -47,6 +49,9 @@ struct NodeInfo {
   NodeId node_id;
   NodeId connection_id;  // Id of a node as far as rudp is concerned
   asymm::PublicKey public_key;
+  // public_key as asymm::EncodeKey gives it, once CacheEncodedPublicKey has been called; shared by
+  // copies.  The routing table sets it for each node it adds.
+  std::shared_ptr<const std::string> encoded_public_key;
   int32_t rank;
   int32_t bucket;
   rudp::NatType nat_type;
@@ -57,6 +62,10 @@ struct NodeInfo {
 
 void swap(NodeInfo& lhs, NodeInfo& rhs) MAIDSAFE_NOEXCEPT;
 
+// Sets node_info.encoded_public_key if it isn't already set, to empty if public_key can't be
+// encoded.
+void CacheEncodedPublicKey(NodeInfo& node_info);
+
 }  // namespace routing
 
 }  // namespace maidsafe
@@ -20,7 +20,9 @@
 #define MAIDSAFE_ROUTING_PARAMETERS_H_
 
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <vector>
 #include "boost/date_time/posix_time/posix_time_duration.hpp"
 
 namespace maidsafe {
@@ -29,11 +31,20 @@ namespace routing {
 
 struct Parameters {
  public:
-  // Thread count for use of asio::io_service
+  // Default thread count for each Routing object's asio::io_service
   static uint16_t thread_count;
+  // Number of strands received messages are spread over, keyed by sender
+  static uint16_t message_dispatch_strands;
+  // Received messages that may await handling at once; requests are shed first as this fills up
+  static uint32_t max_queued_messages;
+  // Entries and bytes of payload held by the in-routing cache of responses to cacheable Gets
   static uint16_t num_chunks_to_cache;
+  static uint32_t cache_capacity_bytes;
   static uint16_t closest_nodes_size;
   static uint16_t group_size;
+  // group_size's default.  While group_size keeps it, the hot loops bounded by it run versions
+  // specialised for it at compile time.
+  static const uint16_t kDefaultGroupSize = 4;
   static uint16_t proximity_factor;
   static uint16_t max_routing_table_size;  // max size of RoutingTable owned by vault
   static uint16_t routing_table_size_threshold;
@@ -41,24 +52,168 @@ struct Parameters {
   static uint16_t max_client_routing_table_size;      // max size of ClientRoutingTable
   static uint16_t bucket_target_size;
   static uint32_t max_data_size;
+  // Payloads up to max_stream_size may be sent as streams of max_data_size frames, up to
+  // stream_window of them unacknowledged.  A node reassembles up to max_incoming_streams at once,
+  // holding no more than max_incoming_stream_bytes of their frames in all.
+  static uint32_t max_stream_size;
+  static uint16_t stream_window;
+  static uint16_t max_incoming_streams;
+  static uint32_t max_incoming_stream_bytes;
   static std::chrono::steady_clock::duration default_response_timeout;
+  // Whether node level requests awaiting a response carry the time left before it times out, so
+  // that nodes on the way drop them once the requester has stopped waiting (see time_left in
+  // routing.proto).  Requests which carry it are always honoured.
+  static bool request_deadlines;
   static std::chrono::seconds find_node_interval;
   static std::chrono::seconds recovery_time_lag;
   static std::chrono::seconds re_bootstrap_time_lag;
+  // Bootstrap endpoints tried individually, best ranked first, before the rest are tried together
+  static uint16_t max_ranked_bootstrap_attempts;
+  // Changes to the bootstrap cache made within this interval are written to disk together
+  static std::chrono::seconds bootstrap_cache_flush_interval;
+  // Interval between saves of the routing snapshot, when one is in use
+  static std::chrono::seconds routing_snapshot_interval;
   static std::chrono::seconds find_close_node_interval;
+  // The four intervals above adapt to network conditions, between the base value divided by
+  // interval_tighten_limit and multiplied by interval_backoff_limit
+  static uint16_t interval_backoff_limit;
+  static uint16_t interval_tighten_limit;
+  // FindNodes requests kept in flight by a lookup, and how long each may take to be answered
+  static uint16_t find_nodes_alpha;
+  static std::chrono::steady_clock::duration find_nodes_query_timeout;
+  // Answers to FindNodes requests are reused for identical requests within this time, up to
+  // find_nodes_memo_size of them, unless the routing table changes meanwhile.
+  static std::chrono::milliseconds find_nodes_memo_ttl;
+  static uint16_t find_nodes_memo_size;
+  // Connect handshakes run at once, and peers queued to wait for one, most valuable first.  A
+  // handshake not completed within connect_attempt_timeout gives up its place.
+  static uint16_t max_concurrent_connects;
+  static uint16_t max_queued_connects;
+  static std::chrono::steady_clock::duration connect_attempt_timeout;
+  // Close group changes within this window of each other are sent as one ClosestNodesUpdate round
+  static std::chrono::milliseconds closest_nodes_update_interval;
+  // If non-zero, a digest of the last ClosestNodesUpdate round is sent to its vaults this often,
+  // so that any holding a stale row ask for it in full
+  static std::chrono::seconds matrix_digest_interval;
+  // Number of past matrix changes kept for Routing::MatrixChangeSince.  Each costs a copy of the
+  // group matrix's member ids, unless the change reported then is still held elsewhere
+  static uint16_t matrix_epoch_history;
+  // Routing table changes within this window of each other are reported as one network status
+  // update and one matrix change, and trigger at most one removal of the furthest node
+  static std::chrono::milliseconds change_notification_interval;
+  // Network status updates differing by less than this from the last one reported are not passed
+  // to Functors::network_status.  Error codes and reaching 0 or 100 are always reported.
+  static int network_status_hysteresis;
+  // At most one network status update is passed to Functors::network_status per this interval;
+  // any later one is reported once it has passed
+  static std::chrono::milliseconds network_status_min_interval;
+  // If true, network status also reflects how complete the close group is and how lossy the
+  // connections are, rather than only how full the routing table is
+  static bool weighted_network_status;
+  // Connections lost within this window of each other are dropped together, with at most one
+  // recovery lookup following
+  static std::chrono::milliseconds connection_loss_batch_interval;
   static uint16_t find_node_repeats_per_num_requested;
   static uint16_t maximum_find_close_node_failures;
   static uint16_t max_route_history;
   static uint16_t hops_to_live;
+  // If set, messages this node originates get only as many hops as the network's size suggests
+  // they need (see NetworkStatistics::HopBudget), though at least min_hops_to_live and at most
+  // hops_to_live, so misrouted messages die sooner.
+  static bool adaptive_hops_to_live;
+  static uint16_t min_hops_to_live;
+  // Base delay before retrying a failed send; doubled per attempt, plus up to one interval jitter.
+  static std::chrono::milliseconds send_retry_interval;
+  // Failed sends that may be waiting to retry via a single peer.  Further failures are sent on via
+  // another peer straight away, keeping the busy one connected.
+  static uint16_t max_send_retries_in_flight;
+  // If non-zero, messages for the same peer sent within this long of each other go as one
+  // MessageBundle.  Every node unpacks bundles, whatever its own setting.
+  static std::chrono::microseconds message_bundle_delay;
+  // Only messages at most this size are bundled, into bundles of at most max_message_bundle_size.
+  static uint32_t max_bundled_message_size;
+  static uint32_t max_message_bundle_size;
+  // If non-zero, at most this many messages per peer are handed to rudp at a time, the rest
+  // queued by priority: routing messages first, then node level ones, then bulk ones
+  static uint16_t max_sends_in_flight_per_peer;
+  // Node level messages with at least this much data are sent as bulk
+  static uint32_t bulk_message_size;
+  // Interval between pings measuring round trip time and loss to each routing table peer
+  static std::chrono::seconds link_probe_interval;
+  // If non-zero, each round of those pings goes to the close group and at most this many others,
+  // taken in turn, so that a large routing table's far peers are each probed less often.
+  static uint16_t max_link_probes;
+  // While network_viewer is running, changes to a node's group matrix are sent to it at most this
+  // often.
+  static std::chrono::milliseconds network_viewer_update_interval;
+  // A next hop within proximity_factor of the closest peer's distance to the target is preferred
+  // when its link is at least this many times faster.
+  static uint16_t link_preference_factor;
+  // Received messages are remembered for this long, up to twice duplicate_filter_capacity of them,
+  // so that further copies can be dropped
+  static std::chrono::steady_clock::duration duplicate_filter_window;
+  static uint16_t duplicate_filter_capacity;
+  // Each source may have up to routing_request_rate FindNodes, GetGroup and Connect requests of
+  // each type a second handled by a node, in bursts of up to routing_request_burst; those beyond
+  // are dropped.  Requests a node only passes on aren't counted by it.  Zero disables the limit.
+  // Buckets are kept for at most max_rate_limited_buckets source and type pairs.
+  static uint32_t routing_request_rate;
+  static uint32_t routing_request_burst;
+  static uint32_t max_rate_limited_buckets;
+  // Completion states of finished PendingResponses and GroupResponses kept for reuse by later
+  // sends, per Routing object.
+  static uint32_t max_spare_response_states;
+  // If non-zero, a client spreads its requests awaiting a response over up to this many of its
+  // connections closest to the destination, least loaded first, and resends any in flight on a
+  // connection it loses over another at once (see RelayLinks).
+  static uint16_t client_relay_links;
+  // If non-zero, a vault which sends shortcut_threshold messages to the same far destination opens
+  // a direct connection to it, or for a group to the group's closest node, outside its routing
+  // table, and routes later messages for there over it.  At most max_shortcuts are kept, the least
+  // recently used making way for a new one, and those unused for shortcut_idle_timeout are closed
+  // (see ShortcutTable).  The far end must allow shortcuts too, and only takes one while it has
+  // room for it, never evicting its own.
+  static uint16_t max_shortcuts;
+  static uint16_t shortcut_threshold;
+  static std::chrono::seconds shortcut_idle_timeout;
   static uint16_t greedy_fraction;
   static uint16_t split_avoidance;
   static uint16_t routing_table_ready_to_response;
   static uint16_t accepted_distance_tolerance;
   static boost::posix_time::time_duration connect_rpc_prune_timeout;
+  // Peers' public key requests made within this window of each other go to the upper layer as one
+  // batch, when it provides a RequestPublicKeysFunctor.
+  static std::chrono::milliseconds public_key_batch_window;
+  // Validated public keys are reused for peers reconnecting within this time.
+  static std::chrono::seconds public_key_cache_ttl;
+  // Signatures are checked and made on this many threads of their own, up to
+  // signature_batch_size at a time per thread.  The last signature_verdict_cache_size verdicts are
+  // remembered, so copies of a message already checked aren't checked again.
+  static uint16_t signature_thread_count;
+  static uint16_t signature_batch_size;
+  static uint32_t signature_verdict_cache_size;
+  // Node level messages are passed to the application on this many threads of their own, with up
+  // to max_queued_upcalls waiting and any more dropped.  With none, they are passed on routing's
+  // own threads, so a slow handler holds up routing.
+  static uint16_t upcall_thread_count;
+  static uint32_t max_queued_upcalls;
+  // zlib level used for node-level payloads sent with compression requested
+  static uint16_t compression_level;
+  // Routing::GetGroups asks one node for at most this many groups per request.
+  static uint16_t get_group_batch_size;
+  // Groups resolved over the network are reused for this long, up to get_group_cache_size of them.
+  static std::chrono::seconds get_group_cache_ttl;
+  static uint16_t get_group_cache_size;
   static bool append_maidsafe_endpoints;
   static bool append_maidsafe_local_endpoints;
   static bool append_local_live_port_endpoint;
   static bool caching;
+  // Unless compiled out (see routing_log.h), per-message logging is only formatted while this is
+  // true.  Set it before creating any Routing objects.
+  static bool message_logging;
+  // One in this many messages sent through Routing is traced hop by hop (see trace_event.h).  Zero
+  // disables tracing.
+  static uint32_t trace_sample_interval;
 
  private:
   Parameters();
@@ -68,6 +223,65 @@ struct Parameters {
   Parameters& operator=(const Parameters&);
 };
 
+// Those of the Parameters which each Routing object may set for itself, e.g. to size a client
+// differently from a vault in the same process.  A default-constructed one copies the Parameters'
+// values at the time.  Each object given one keeps its own copy, which doesn't change after.  Those
+// Parameters which must agree across the network, such as closest_nodes_size and group_size, are
+// not included.
+struct InstanceParameters {
+  InstanceParameters();
+  // A profile for clients short of memory or wakeups: one dispatch strand, a short ingress queue,
+  // no room for clients of their own, fewer retries held, a group matrix of connected peers only,
+  // and no upcall or signature threads of their own, so node level messages are passed on and
+  // signatures checked on routing's threads.  Use it with a thread_count of 1, or with an
+  // AsioService shared by all of the process's Routing objects.  BENCHrouting --client_rss
+  // measures the resident memory of such clients before joining against that of default ones.  No
+  // budget has been measured for it yet; record one from a --client_rss run on the target and pass
+  // it back as --client_rss_budget to catch regressions.
+  static InstanceParameters LeanClient();
+  // A profile for vaults on big networks with memory and connections to spare: a routing table of
+  // up to table_size peers, spread evenly over its buckets so that lookups take fewer hops, with
+  // cheaper link probing.  BENCHrouting --hop_nodes shows the hop counts it gives.
+  static InstanceParameters LargeTable(uint16_t table_size = kLargeRoutingTableSize);
+  static const uint16_t kLargeRoutingTableSize = 1024;
+
+  uint16_t message_dispatch_strands;
+  uint32_t max_queued_messages;
+  uint16_t max_routing_table_size;
+  uint16_t routing_table_size_threshold;
+  uint16_t max_routing_table_size_for_client;
+  uint16_t max_client_routing_table_size;
+  uint16_t bucket_target_size;
+  // Size beyond which the table asks for its furthest unneeded peer to be removed.
+  uint16_t greedy_fraction;
+  std::chrono::steady_clock::duration default_response_timeout;
+  std::chrono::milliseconds send_retry_interval;
+  uint16_t max_send_retries_in_flight;
+  std::chrono::microseconds message_bundle_delay;
+  uint16_t max_sends_in_flight_per_peer;
+  uint32_t routing_request_rate;
+  uint32_t routing_request_burst;
+  uint16_t max_link_probes;
+  uint16_t max_shortcuts;
+  uint16_t shortcut_threshold;
+  std::chrono::seconds shortcut_idle_timeout;
+  // Threads of the object's own for up-calls and for signatures, as Parameters::upcall_thread_count
+  // and Parameters::signature_thread_count describe.  Zero signature threads checks and makes
+  // signatures on the calling thread.
+  uint16_t upcall_thread_count;
+  uint16_t signature_thread_count;
+  // CPUs to pin the object's worker threads to, e.g. those of one socket on a multi-socket host.
+  // The asio threads of a Routing object constructed with a thread count, and its upcall and
+  // signature threads, are each pinned to the next in turn, one pool carrying on round the list
+  // from where the last left off.  Threads of an AsioService passed in are left to its owner, as
+  // are rudp's.  Empty, the default, leaves every thread unpinned.
+  std::vector<uint32_t> worker_cpus;
+  // If false, a client keeps only its connected peers in its group matrix, not the close nodes
+  // they report, which serve only to find a better next hop than a connected peer.  Vaults always
+  // keep them.  True by default.
+  bool client_matrix_rows;
+};
+
 }  // namespace routing
 
 }  // namespace maidsafe
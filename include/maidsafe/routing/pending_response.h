@@ -0,0 +1,200 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_PENDING_RESPONSE_H_
+#define MAIDSAFE_ROUTING_PENDING_RESPONSE_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/config.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace detail {
+
+class CompletionPool;
+
+// The responses to one request, as a Timer task delivers them.  Held by the handle returned to the
+// caller and by the task's functor, and returned to its pool once both are done with it rather than
+// freed, so that a request costs no allocation for its completion state.  Thread-safe.
+class CompletionState {
+ public:
+  CompletionState();
+
+  // A functor for Timer::AddTask, which must be invoked expected_count() times (as Timer
+  // guarantees, with empty responses for any not received in time).  Each one made holds a
+  // reference, released by its last response.
+  std::function<void(std::string)> Completer();
+  void Deliver(std::string response);
+
+  int expected_count() const { return expected_count_; }
+  // True once a response is waiting to be taken or all have been taken.
+  bool ready() const;
+  // Blocks until a response has been received, then moves out the oldest not yet taken.  Returns
+  // false if all expected_count() have already been taken.
+  bool Take(std::string& response);
+  // As Take, but waits no longer than timeout; returns false if nothing came in time.
+  bool TakeFor(const std::chrono::steady_clock::duration& timeout, std::string& response);
+  // Passes every response not yet taken, and every later one, to on_response instead of keeping
+  // it.  Later responses may be passed concurrently from different threads.
+  void Then(std::function<void(std::string)> on_response);
+  // Runs on_ready once, as soon as ready() is true (at once if it is already).
+  void OnReady(std::function<void()> on_ready);
+
+  void AddReference();
+  void Release();
+
+ private:
+  friend class CompletionPool;
+  CompletionState(const CompletionState&);
+  CompletionState& operator=(const CompletionState&);
+  void Reset(int expected_count, std::shared_ptr<CompletionPool> pool);
+  bool IsReady() const;  // requires mutex_
+
+  mutable std::mutex mutex_;
+  std::condition_variable cond_var_;
+  int expected_count_, delivered_count_;
+  size_t taken_count_;
+  std::vector<std::string> responses_;
+  std::function<void(std::string)> on_response_;
+  std::function<void()> on_ready_;
+  std::atomic<int> references_;
+  // Only set while the state is in use, so that spare states don't keep their pool alive.
+  std::shared_ptr<CompletionPool> pool_;
+};
+
+// Keeps up to max_spare released CompletionStates for reuse.
+class CompletionPool : public std::enable_shared_from_this<CompletionPool> {
+ public:
+  explicit CompletionPool(size_t max_spare);
+  ~CompletionPool();
+  // The state has a single reference, which the caller's handle takes over.
+  CompletionState* Acquire(int expected_count);
+  void Return(CompletionState* state);
+  size_t spare_count() const;
+
+ private:
+  CompletionPool(const CompletionPool&);
+  CompletionPool& operator=(const CompletionPool&);
+
+  const size_t kMaxSpare_;
+  mutable std::mutex mutex_;
+  std::vector<CompletionState*> spare_;
+};
+
+}  // namespace detail
+
+// The response to a request sent with Routing::SendDirect, as an alternative to a ResponseFunctor.
+// It can be waited for, handed a callback, or awaited from a C++20 coroutine (co_await yields the
+// response).  As with a ResponseFunctor, the response is an empty string if none arrived within
+// Parameters::default_response_timeout.  Move-only.
+class PendingResponse {
+ public:
+  PendingResponse();
+  explicit PendingResponse(detail::CompletionState* state);
+  PendingResponse(PendingResponse&& other) MAIDSAFE_NOEXCEPT;
+  PendingResponse& operator=(PendingResponse&& other) MAIDSAFE_NOEXCEPT;
+  ~PendingResponse();
+
+  bool valid() const { return state_ != nullptr; }
+  detail::CompletionState* state() const { return state_; }
+  bool ready() const;
+  // Blocks until the response arrives.  Only to be called once, and not as well as Then.
+  std::string get();
+  // Returns false if the response didn't arrive within timeout.
+  bool WaitFor(const std::chrono::steady_clock::duration& timeout, std::string& response);
+  // Callback fallback: on_response is called with the response, at once if it has arrived.
+  void Then(std::function<void(std::string)> on_response);
+
+  // Awaitable interface.  Resumption happens on one of routing's threads.
+  bool await_ready() const { return ready(); }
+  template <typename CoroutineHandle>
+  void await_suspend(CoroutineHandle handle) {
+    state_->OnReady([handle]() mutable { handle.resume(); });
+  }
+  std::string await_resume() { return get(); }
+
+ private:
+  PendingResponse(const PendingResponse&);
+  PendingResponse& operator=(const PendingResponse&);
+
+  detail::CompletionState* state_;
+};
+
+// The responses to a request sent with Routing::SendGroup, as a range which can be consumed as
+// they arrive.  There are always expected_count() of them, an empty string standing for each not
+// received within Parameters::default_response_timeout.  Move-only.
+class GroupResponses {
+ public:
+  // Awaitable for the next response: co_await yields false once all have been taken.
+  class NextResponse {
+   public:
+    NextResponse(detail::CompletionState* state, std::string& response)
+        : state_(state), response_(response) {}
+    bool await_ready() const { return state_->ready(); }
+    template <typename CoroutineHandle>
+    void await_suspend(CoroutineHandle handle) {
+      state_->OnReady([handle]() mutable { handle.resume(); });
+    }
+    bool await_resume() { return state_->Take(response_); }
+
+   private:
+    detail::CompletionState* state_;
+    std::string& response_;
+  };
+
+  GroupResponses();
+  explicit GroupResponses(detail::CompletionState* state);
+  GroupResponses(GroupResponses&& other) MAIDSAFE_NOEXCEPT;
+  GroupResponses& operator=(GroupResponses&& other) MAIDSAFE_NOEXCEPT;
+  ~GroupResponses();
+
+  bool valid() const { return state_ != nullptr; }
+  detail::CompletionState* state() const { return state_; }
+  int expected_count() const;
+  // Blocks until the next response arrives and moves it into response.  Returns false once all
+  // have been taken.
+  bool Next(std::string& response);
+  // As Next, but for use with co_await, e.g. 'while (co_await responses.NextAsync(response))'.
+  NextResponse NextAsync(std::string& response) { return NextResponse(state_, response); }
+  // Callback fallback: on_response is called for each response not yet taken by Next, as they
+  // arrive, possibly concurrently.
+  void Then(std::function<void(std::string)> on_response);
+
+ private:
+  GroupResponses(const GroupResponses&);
+  GroupResponses& operator=(const GroupResponses&);
+
+  detail::CompletionState* state_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_PENDING_RESPONSE_H_
@@ -0,0 +1,45 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_RECOVERY_INTERVALS_H_
+#define MAIDSAFE_ROUTING_RECOVERY_INTERVALS_H_
+
+#include <chrono>
+
+namespace maidsafe {
+
+namespace routing {
+
+// The intervals currently used in place of the like-named Parameters.  Each backs off while the
+// network around this node is stable and tightens when it changes.
+struct RecoveryIntervals {
+  RecoveryIntervals()
+      : find_node_interval(), recovery_time_lag(), re_bootstrap_time_lag(),
+        find_close_node_interval() {}
+
+  std::chrono::steady_clock::duration find_node_interval;
+  std::chrono::steady_clock::duration recovery_time_lag;
+  std::chrono::steady_clock::duration re_bootstrap_time_lag;
+  std::chrono::steady_clock::duration find_close_node_interval;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_RECOVERY_INTERVALS_H_
@@ -34,10 +34,12 @@
 #include <future>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "boost/asio/ip/udp.hpp"
 #include "boost/date_time/posix_time/posix_time_config.hpp"
+#include "boost/filesystem/path.hpp"
 
 #include "maidsafe/common/node_id.h"
 #include "maidsafe/common/rsa.h"
@@ -45,9 +47,18 @@
 #include "maidsafe/passport/types.h"
 
 #include "maidsafe/routing/api_config.h"
+#include "maidsafe/routing/cache_statistics.h"
+#include "maidsafe/routing/latency_histogram.h"
+#include "maidsafe/routing/matrix_nodes.h"
+#include "maidsafe/routing/metrics_snapshot.h"
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/pending_response.h"
+#include "maidsafe/routing/recovery_intervals.h"
 
 namespace maidsafe {
 
+class AsioService;
+
 namespace routing {
 
 struct NodeInfo;
@@ -76,13 +87,32 @@ class Routing {
   // maid as a paramater will create a mutating client.
   // NodeId as a parameter will create a non-mutating client
   // Non-mutating client means that random keys will be generated by routing for this node.
+  // thread_count is the number of threads servicing this node's asio::io_service.
+  // parameters holds this node's own copy of the tunables in InstanceParameters; by default those
+  // currently set in Parameters.
+  template <typename FobType>
+  explicit Routing(const FobType& fob, uint16_t thread_count = Parameters::thread_count,
+                   const InstanceParameters& parameters = InstanceParameters())
+      : pimpl_() {
+    asymm::Keys keys;
+    keys.private_key = fob.private_key();
+    keys.public_key = fob.public_key();
+    InitialisePimpl(detail::is_client<FobType>::value, NodeId(fob.name()->string()), keys,
+                    thread_count, parameters);
+  }
+
+  // As above, but serviced by asio_service, which may be shared by any number of Routing objects
+  // (and others) so that they all run on its fixed set of threads.  Each still has its own rudp
+  // transport.  asio_service is kept alive for as long as this needs it.  Throws if it is null.
   template <typename FobType>
-  explicit Routing(const FobType& fob)
+  Routing(const FobType& fob, std::shared_ptr<AsioService> asio_service,
+          const InstanceParameters& parameters = InstanceParameters())
       : pimpl_() {
     asymm::Keys keys;
     keys.private_key = fob.private_key();
     keys.public_key = fob.public_key();
-    InitialisePimpl(detail::is_client<FobType>::value, NodeId(fob.name()->string()), keys);
+    InitialisePimpl(detail::is_client<FobType>::value, NodeId(fob.name()->string()), keys,
+                    std::move(asio_service), parameters);
   }
 
   // Joins the network. Valid method for requesting public key must be provided by the functor,
@@ -92,6 +122,29 @@ class Routing {
   void Join(Functors functors, std::vector<boost::asio::ip::udp::endpoint> peer_endpoints =
                                    std::vector<boost::asio::ip::udp::endpoint>());
 
+  // Keeps bootstrap contacts, with the join time and failures seen for each, in the file at path.
+  // If called before Join, the cached contacts are tried when no peer_endpoints are given, and all
+  // bootstrap endpoints are tried quickest first.  Returns false if the file can't be parsed.
+  bool UseBootstrapCache(const boost::filesystem::path& path);
+
+  // Saves this node's routing table and group matrix peers to the file at path periodically
+  // (Parameters::routing_snapshot_interval) and on destruction.  If called before Join, once
+  // bootstrapped the node requests connections to all peers saved there at once rather than
+  // waiting for them to be found.  Returns false if the file can't be parsed.
+  bool UseRoutingSnapshot(const boost::filesystem::path& path);
+
+  // For bringing up a network whose node IDs are known in advance (e.g. from a keys file), such
+  // as a test or private network.  If called before Join, once bootstrapped the node requests
+  // connections at once to those of node_ids closest to it which its routing table could hold,
+  // rather than waiting for each to be found.  node_ids may include this node's own ID.
+  void UseNetworkManifest(const std::vector<NodeId>& node_ids);
+
+  // Writes every sample_interval'th message this node sends or receives, with when it was sent or
+  // received, to a log at path, replacing any file there.  The log can be replayed against a
+  // message handler for benchmarking with real traffic (see BENCHrouting --replay).  Only to be
+  // called before Join.  Returns false if the file can't be written.
+  bool CaptureMessages(const boost::filesystem::path& path, uint32_t sample_interval = 1);
+
   // WARNING: THIS FUNCTION SHOULD BE ONLY USED TO JOIN FIRST TWO ZERO STATE NODES.
   int ZeroStateJoin(Functors functors, const boost::asio::ip::udp::endpoint& local_endpoint,
                     const boost::asio::ip::udp::endpoint& peer_endpoint, const NodeInfo& peer_info);
@@ -100,6 +153,15 @@ class Routing {
   // Throws on invalid paramaters
   template <typename T>
   void Send(const T& message);
+  // As above, but message.contents is handed on rather than copied.  Prefer these for large
+  // payloads.
+  void Send(SingleToSingleMessage&& message);
+  void Send(SingleToGroupMessage&& message);
+  void Send(GroupToSingleMessage&& message);
+  void Send(GroupToGroupMessage&& message);
+  void Send(GroupToSingleRelayMessage&& message);
+  // As above, but sent along up to path_count disjoint paths (see SendDirect below).
+  void Send(SingleToSingleMessage&& message, uint16_t path_count);
 
   // Sends message to a known destnation.
   // If a valid response functor is provided, it will be called when:
@@ -109,6 +171,24 @@ class Routing {
   void SendDirect(const NodeId& destination_id,                       // ID of final destination
                   const std::string& message, bool cacheable,  // to cache message content
                   ResponseFunctor response_functor);                  // Called on response
+  // As above, but copies of the message leave via up to path_count different peers, each of which
+  // avoids the others' paths.  The first response is passed to response_functor, and the
+  // destination handles only the first copy to arrive.  Trades bandwidth for tail latency.
+  void SendDirect(const NodeId& destination_id, const std::string& message, bool cacheable,
+                  ResponseFunctor response_functor, uint16_t path_count);
+  // As above, but the response is collected in pooled completion state rather than passed to a
+  // functor, for the caller to wait for, hand a callback or co_await (see PendingResponse).
+  PendingResponse SendDirect(const NodeId& destination_id, const std::string& message,
+                             bool cacheable);
+
+  // As SendDirect, but for payloads of up to Parameters::max_stream_size.  Larger than
+  // Parameters::max_data_size, message is sent as a stream of frames, up to
+  // Parameters::stream_window of them awaiting acknowledgement at once.  Frames after the first
+  // follow its route, and the destination receives the reassembled message, replying as for
+  // SendDirect.  If a frame goes unacknowledged, response_functor is called with an empty string.
+  // Pass message as an rvalue to avoid copying it.  Throws on invalid paramaters.
+  void SendStream(const NodeId& destination_id, std::string message,
+                  ResponseFunctor response_functor);
 
   // Sends message to Parameters::group_size most closest nodes to destination_id. The node
   // having id equal to destination id is not considered as part of group and will not receive
@@ -120,6 +200,10 @@ class Routing {
   void SendGroup(const NodeId& destination_id,  // ID of final destination or group centre
                  const std::string& message, bool cacheable,  // to cache message content
                  ResponseFunctor response_functor);                  // Called on each response
+  // As above, but the responses are offered as a range to be consumed as they arrive (see
+  // GroupResponses).
+  GroupResponses SendGroup(const NodeId& destination_id, const std::string& message,
+                           bool cacheable);
 
   // Compares own closeness to target against other known nodes' closeness to the target
   bool ClosestToId(const NodeId& target_id);
@@ -139,6 +223,11 @@ class Routing {
   // if kNodeId_ == group_id, it returns kOutwithRange
   GroupRangeStatus IsNodeIdInGroupRange(const NodeId& group_id) const;
 
+  // Sets results[i] to IsNodeIdInGroupRange(group_ids[i]).  All ids are checked against the same
+  // view of the close group, which is cheaper than calling the above once per id.
+  void IsNodeIdInGroupRange(const std::vector<NodeId>& group_ids,
+                            std::vector<GroupRangeStatus>& results) const;
+
   // Gets a random connected node from routing table (excluding closest
   // Parameters::closest_nodes_size nodes).
   // Shouldn't be called when routing table is likely to be smaller than closest_nodes_size.
@@ -151,15 +240,57 @@ class Routing {
   // Returns the closest nodes to info_id
   std::future<std::vector<NodeId>> GetGroup(const NodeId& group_id);
 
+  // Returns the closest nodes to each of group_ids, in the same order.  Ids routed via the same
+  // peer share a request, so this sends far fewer messages than calling GetGroup for each.  Ids
+  // whose groups the node answering a shared request isn't in are then asked about on their own.  A
+  // group is left empty if its request times out.
+  std::future<std::vector<std::vector<NodeId>>> GetGroups(const std::vector<NodeId>& group_ids);
+
   // Returns this node's id.
   NodeId kNodeId() const;
 
   // Returns a number between 0 to 100 representing % network health w.r.t. number of connections
   int network_status();
 
-  // Returns the group matrix
+  // Returns the number of received messages dropped because too many were awaiting handling
+  uint64_t dropped_message_count() const;
+
+  // Returns latency histograms, per message type and destination class, for each stage of
+  // handling received messages.  Only histograms with at least one entry are returned.
+  std::vector<LatencyHistogram> latency_histograms() const;
+
+  // Returns counts of messages in and out by type, forwarded, delivered and dropped by reason, hops
+  // taken and send retries, along with current table sizes.  Collecting the counts takes no locks
+  // on the message paths.  See ToPrometheusText for exporting the snapshot.
+  MetricsSnapshot GetMetricsSnapshot() const;
+
+  // Returns counts of this node's cache hits, misses and sizes, for judging Parameters::caching.
+  CacheStatistics cache_statistics() const;
+
+  // Returns the join and recovery timer intervals currently in use.
+  RecoveryIntervals recovery_intervals() const;
+
+  // Returns an estimate of how many cacheable Gets for request_data at destination_id have passed
+  // through this node recently.  It is never below the number seen since the counts were last
+  // halved, which happens periodically so the estimate follows recent traffic, and exceeds it only
+  // slightly.
+  uint32_t EstimatedCacheGetCount(const NodeId& destination_id,
+                                  const std::string& request_data) const;
+
+  // Returns the net change to the group matrix since the MatrixChange with epoch() equal to epoch
+  // was reported, as a single MatrixChange whose epoch() is the latest.  A consumer which has
+  // fallen behind Functors::matrix_changed can handle this once in place of the changes it missed.
+  // Returns nullptr if epoch is older than the last Parameters::matrix_epoch_history changes.
+  std::shared_ptr<MatrixChange> MatrixChangeSince(uint64_t epoch) const;
+
+  // Returns a copy of the group matrix
   std::vector<NodeInfo> ClosestNodes();
 
+  // Returns the group matrix as it was last published, shared rather than copied and read without
+  // waiting on the routing table.  A caller polling this can skip its work while the version is
+  // the one it last handled.
+  std::shared_ptr<const MatrixNodes> ClosestNodesSnapshot() const;
+
   // Checks if routing table or group matrix contains given node id
   bool IsConnectedVault(const NodeId& node_id);
 
@@ -172,14 +303,22 @@ class Routing {
   Routing(const Routing&);
   Routing(const Routing&&);
   Routing& operator=(const Routing&);
-  void InitialisePimpl(bool client_mode, const NodeId& node_id, const asymm::Keys& keys);
+  void InitialisePimpl(bool client_mode, const NodeId& node_id, const asymm::Keys& keys,
+                       uint16_t thread_count, const InstanceParameters& parameters);
+  void InitialisePimpl(bool client_mode, const NodeId& node_id, const asymm::Keys& keys,
+                       std::shared_ptr<AsioService> asio_service,
+                       const InstanceParameters& parameters);
 
   class Impl;
   std::shared_ptr<Impl> pimpl_;
 };
 
 template <>
-Routing::Routing(const NodeId& node_id);
+Routing::Routing(const NodeId& node_id, uint16_t thread_count,
+                 const InstanceParameters& parameters);
+template <>
+Routing::Routing(const NodeId& node_id, std::shared_ptr<AsioService> asio_service,
+                 const InstanceParameters& parameters);
 
 template <>
 void Routing::Send(const SingleToSingleMessage& message);
@@ -103,6 +103,7 @@ class GenericNode {
                     const NodeInfo& peer_node_info);
   void Join(const std::vector<boost::asio::ip::udp::endpoint>& peer_endpoints =
                 std::vector<boost::asio::ip::udp::endpoint>());
+  void UseNetworkManifest(const std::vector<NodeId>& node_ids);
   void SendDirect(const NodeId& destination_id, const std::string& data, bool cacheable,
                   ResponseFunctor response_functor);
   void SendGroup(const NodeId& destination_id, const std::string& data, bool cacheable,
@@ -179,6 +180,9 @@ class GenericNetwork {
   void SetUpNetwork(size_t total_number_vaults, size_t total_number_clients,
                     size_t num_symmetric_nat_vaults,
                     size_t num_symmetric_nat_clients);
+  // As SetUpNetwork, but the vaults join at once, each given all of the network's IDs (see
+  // Routing::UseNetworkManifest), rather than one after another.
+  void SetUpNetworkInParallel(size_t total_number_vaults);
   void AddNode(bool client_mode, const NodeId& node_id,
                MatrixChangedFunctor matrix_change_functor);
   void AddNode(bool client_mode, const NodeId& node_id,
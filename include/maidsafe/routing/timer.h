@@ -19,14 +19,20 @@
 #ifndef MAIDSAFE_ROUTING_TIMER_H_
 #define MAIDSAFE_ROUTING_TIMER_H_
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <condition_variable>
 #include <chrono>
 #include <cstdint>
 #include <functional>
 #include <iterator>
-#include <map>
+#include <list>
 #include <memory>
 #include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "boost/asio/steady_timer.hpp"
 #include "boost/asio/error.hpp"
@@ -46,10 +52,29 @@ class TimerTest;
 
 typedef int32_t TaskId;
 
+namespace detail {
+
+// Resolution of Timer deadlines.  Tasks expire on the first tick at or after their deadline.
+const std::chrono::milliseconds kTimerTick(10);
+// Each wheel has kTimerLevels levels of 2^kTimerSlotBits slots, each level's slots spanning
+// 2^kTimerSlotBits times as many ticks as the level below, so 4 x 64 slots cover about 46 hours.
+const unsigned kTimerSlotBits(6);
+const size_t kTimerLevels(4);
+// Tasks are spread over this many independently locked shards by TaskId.
+const size_t kTimerShards(8);
+
+}  // namespace detail
+
+// Tasks are sharded by ID, each shard with its own lock, task table and hierarchical timing wheel.
+// The wheels are advanced by a single asio timer, which only runs while there are tasks.  Adding,
+// cancelling and completing a task are O(1), and functors are never invoked under a lock.
 template <typename Response>
 class Timer {
  public:
   typedef std::function<void(Response)> ResponseFunctor;
+  typedef std::function<void(std::vector<Response>)> GroupResponseFunctor;
+  // Called with the responses received so far; returns true once they are enough to finish early.
+  typedef std::function<bool(const std::vector<Response>&)> CompletionPredicate;
   explicit Timer(AsioService& asio_service);
   // Cancels all tasks and blocks until all functors have been executed and all tasks removed.
   ~Timer();
@@ -61,88 +86,181 @@ class Timer {
   void AddTask(const std::chrono::steady_clock::duration& timeout,
                  const ResponseFunctor& response_functor, int expected_response_count,
                  TaskId task_id);
+  // Adds a task which collects up to 'expected_response_count' responses, moving each into a buffer
+  // reserved up front, and invokes 'group_response_functor' once with all those received.  That
+  // happens when the last expected response arrives, when 'is_complete' (if given) first returns
+  // true, or at timeout or cancellation.  Responses arriving after that throw as for an unknown
+  // task.  'is_complete' is called under the Timer's lock, so mustn't call back into the Timer.
+  // Throws if 'group_response_functor' is null or if 'expected_response_count' < 1.
+  void AddGroupTask(const std::chrono::steady_clock::duration& timeout,
+                    const GroupResponseFunctor& group_response_functor,
+                    int expected_response_count, TaskId task_id,
+                    CompletionPredicate is_complete = nullptr);
+  // A CompletionPredicate satisfied once 'count' of the responses are equal.
+  static CompletionPredicate IdenticalResponses(size_t count);
   // Removes the task and invokes its functor once per "missing" expected Response, with a
   // default-constructed Response each time.  Throws if the indicated task doesn't exist.
   void CancelTask(TaskId task_id);
-  // Invokes the response functor for the indicated task.  Throws if the indicated task doesn't
-  // exist.
+  // Invokes the response functor for the indicated task, or adds to a group task's responses.
+  // Throws if the indicated task doesn't exist.
   void AddResponse(TaskId task_id, const Response& response);
+  void AddResponse(TaskId task_id, Response&& response);
 
   TaskId NewTaskId();
+  // The number of tasks added and not yet completed, timed out or cancelled.
+  size_t task_count() const { return task_count_; }
 
   friend class test::TimerTest;
 
   void PrintTaskIds() {
-    std::lock_guard<std::mutex> lock(mutex_);
     LOG(kVerbose) << "This timer containing following tasks : ";
-    for (auto& task : tasks_) {
-      LOG(kVerbose) << "      task id   ---   " << task.first;
+    for (auto& shard : shards_) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      for (auto& task : shard.tasks)
+        LOG(kVerbose) << "      task id   ---   " << task.first;
     }
   }
 
  private:
-  struct Task {
-    Task(boost::asio::io_service& io_service, const std::chrono::steady_clock::duration& timeout,
-         ResponseFunctor functor_in, int expected_response_count);
-    Task(Task&& other);
-    Task& operator=(Task&& other);
+  typedef std::list<TaskId> Slot;
+  typedef std::array<Slot, (1 << detail::kTimerSlotBits)> Level;
 
-    std::unique_ptr<boost::asio::steady_timer> timer;
-    ResponseFunctor functor;
+  struct Task {
+    Task(ResponseFunctor functor_in, int expected_response_count, uint64_t expiry_tick_in);
+    Task(GroupResponseFunctor group_functor_in, CompletionPredicate is_complete_in,
+         int expected_response_count, uint64_t expiry_tick_in);
+
+    ResponseFunctor functor;  // null for group tasks
+    GroupResponseFunctor group_functor;
+    CompletionPredicate is_complete;
+    std::vector<Response> responses;  // received so far by a group task
     int outstanding_response_count;
+    uint64_t expiry_tick;
+    Slot* slot;  // the wheel slot holding this task's ID
+    std::list<TaskId>::iterator position;
+  };
+  typedef std::unordered_map<TaskId, Task> TaskMap;
+
+  struct Shard {
+    Shard() : mutex(), tasks(), wheel(), current_tick(0) {}
 
-   private:
-    Task() MAIDSAFE_DELETE;
-    Task(const Task&) MAIDSAFE_DELETE;
-    Task& operator=(const Task&) MAIDSAFE_DELETE;
+    std::mutex mutex;
+    TaskMap tasks;
+    std::array<Level, detail::kTimerLevels> wheel;
+    uint64_t current_tick;  // the last tick processed
+  };
+
+  // Lets a tick handler which outlives the Timer find that out.
+  struct TickGuard {
+    TickGuard() : mutex(), alive(true) {}
+    std::mutex mutex;
+    bool alive;
   };
 
   Timer(const Timer&);
   Timer(const Timer&&);
   Timer& operator=(Timer);
 
-  void FinishTask(TaskId task_id, const boost::system::error_code& error);
+  Shard& ShardOf(TaskId task_id) {
+    return shards_[static_cast<uint32_t>(task_id) % detail::kTimerShards];
+  }
+  uint64_t TickAt(const std::chrono::steady_clock::time_point& time) const;
+  // These require the shard's mutex to be held.
+  // 'make_task' is called with the expiry tick to construct the task in place.
+  template <typename MakeTask>
+  void Insert(TaskId task_id, const std::chrono::steady_clock::time_point& now,
+              const std::chrono::steady_clock::duration& timeout, const MakeTask& make_task);
+  void AddToWheel(Shard& shard, TaskId task_id, Task& task);
+  Task RemoveTask(Shard& shard, typename TaskMap::iterator itr);
+  void Cascade(Shard& shard, size_t level);
+  void Advance(Shard& shard, uint64_t target_tick, std::vector<std::pair<TaskId, Task>>& expired);
+
+  void ScheduleTick();
+  // Advances the shards and returns the tasks which have timed out, without invoking them.
+  std::vector<std::pair<TaskId, Task>> OnTick();
+  // For a timed out or cancelled task, posts its functor once per missing response with a
+  // default-constructed Response, or its group functor with the responses received.  Posted
+  // rather than dispatched, so that a functor never runs inline under one of the Timer's locks and
+  // may safely destroy the Timer.
+  static void InvokeForShortfall(boost::asio::io_service& service, Task& task);
 
   AsioService& asio_service_;
-  TaskId new_task_id_;
+  std::atomic<TaskId> new_task_id_;
+  std::array<Shard, detail::kTimerShards> shards_;
+  std::atomic<size_t> task_count_;
+  // Guards nothing itself; used with cond_var_ by the destructor to wait for task_count_ to drop.
   std::mutex mutex_;
   std::condition_variable cond_var_;
-  std::map<TaskId, Task> tasks_;
+  const std::chrono::steady_clock::time_point kStartTime_;
+  std::mutex tick_mutex_;
+  bool tick_scheduled_;
+  boost::asio::steady_timer tick_timer_;
+  std::shared_ptr<TickGuard> tick_guard_;
 };
 
 // ==================== Implementation =============================================================
 template <typename Response>
-Timer<Response>::Task::Task(boost::asio::io_service& io_service,
-                            const std::chrono::steady_clock::duration& timeout,
-                            ResponseFunctor functor_in, int expected_response_count)
-    : timer(new boost::asio::steady_timer(io_service, timeout)),
-      functor(std::move(functor_in)),
-      outstanding_response_count(expected_response_count) {}
+Timer<Response>::Task::Task(ResponseFunctor functor_in, int expected_response_count,
+                            uint64_t expiry_tick_in)
+    : functor(std::move(functor_in)),
+      group_functor(),
+      is_complete(),
+      responses(),
+      outstanding_response_count(expected_response_count),
+      expiry_tick(expiry_tick_in),
+      slot(nullptr),
+      position() {}
 
 template <typename Response>
-Timer<Response>::Task::Task(Task&& other)
-    : timer(std::move(other.timer)),
-      functor(std::move(other.functor)),
-      outstanding_response_count(std::move(other.outstanding_response_count)) {}
-
-template <typename Response>
-typename Timer<Response>::Task& Timer<Response>::Task::operator=(Task&& other) {
-  timer = std::move(other.timer);
-  functor = std::move(other.functor);
-  outstanding_response_count = std::move(other.outstanding_response_count);
-  return *this;
+Timer<Response>::Task::Task(GroupResponseFunctor group_functor_in,
+                            CompletionPredicate is_complete_in, int expected_response_count,
+                            uint64_t expiry_tick_in)
+    : functor(),
+      group_functor(std::move(group_functor_in)),
+      is_complete(std::move(is_complete_in)),
+      responses(),
+      outstanding_response_count(expected_response_count),
+      expiry_tick(expiry_tick_in),
+      slot(nullptr),
+      position() {
+  responses.reserve(expected_response_count);
 }
 
 template <typename Response>
 Timer<Response>::Timer(AsioService& asio_service)
-    : asio_service_(asio_service), new_task_id_(RandomInt32()), mutex_(), cond_var_(), tasks_() {}
+    : asio_service_(asio_service),
+      new_task_id_(RandomInt32()),
+      shards_(),
+      task_count_(0),
+      mutex_(),
+      cond_var_(),
+      kStartTime_(std::chrono::steady_clock::now()),
+      tick_mutex_(),
+      tick_scheduled_(false),
+      tick_timer_(asio_service.service()),
+      tick_guard_(std::make_shared<TickGuard>()) {}
 
 template <typename Response>
 Timer<Response>::~Timer() {
+  {
+    // Waits for any tick in progress.  Any later tick handler returns without touching this.
+    std::lock_guard<std::mutex> guard_lock(tick_guard_->mutex);
+    tick_guard_->alive = false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(tick_mutex_);
+    tick_timer_.cancel();
+  }
+  std::vector<Task> cancelled;
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    while (!shard.tasks.empty())
+      cancelled.push_back(RemoveTask(shard, std::begin(shard.tasks)));
+  }
+  for (auto& task : cancelled)
+    InvokeForShortfall(asio_service_.service(), task);
   std::unique_lock<std::mutex> lock(mutex_);
-  for (const auto& task : tasks_)
-    task.second.timer->cancel();
-  cond_var_.wait(lock, [&] { return tasks_.empty(); });
+  cond_var_.wait(lock, [&] { return task_count_ == 0; });
 }
 
 template <typename Response>
@@ -156,76 +274,93 @@ void Timer<Response>::AddTask(const std::chrono::steady_clock::duration& timeout
                 << " incorrect expected_response_count";
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
   }
-  std::lock_guard<std::mutex> lock(mutex_);
-  auto result(tasks_.insert(std::move(
-      std::make_pair(task_id, std::move(Task(asio_service_.service(), timeout, response_functor,
-                                             expected_response_count))))));
-  assert(result.second);
-  result.first->second.timer->async_wait([this, task_id](const boost::system::error_code & error) {
-    this->FinishTask(task_id, error);
+  Insert(task_id, std::chrono::steady_clock::now(), timeout, [&](uint64_t expiry_tick) {
+    return Task(response_functor, expected_response_count, expiry_tick);
   });
 }
 
 template <typename Response>
-void Timer<Response>::FinishTask(TaskId task_id, const boost::system::error_code& error) {
-  int outstanding_response_count(0);
-  ResponseFunctor functor;
-  LOG(kVerbose) << "Timer<Response>::FinishTask finish task " << task_id;
-  {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto itr(tasks_.find(task_id));
-    if (itr == std::end(tasks_)) {
-      LOG(kError) << "Timer<Response>::FinishTask Task " << task_id << " not held by Timer.";
-      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
-    }
-    assert(itr->second.outstanding_response_count >= 0);
-    LOG(kVerbose) << "Timer<Response>::FinishTask outstanding_response_count for Task "
-                  << task_id << " is " << itr->second.outstanding_response_count;
-    if (itr->second.outstanding_response_count != 0) {
-      outstanding_response_count = itr->second.outstanding_response_count;
-      functor = itr->second.functor;
-    }
-
-    tasks_.erase(itr);
+void Timer<Response>::AddGroupTask(const std::chrono::steady_clock::duration& timeout,
+                                   const GroupResponseFunctor& group_response_functor,
+                                   int expected_response_count, TaskId task_id,
+                                   CompletionPredicate is_complete) {
+  LOG(kVerbose) << "Timer<Response>::AddGroupTask add task " << task_id
+                << " with expected_response_count as " << expected_response_count;
+  if (!group_response_functor || expected_response_count < 1) {
+    LOG(kError) << "Timer<Response>::AddGroupTask group_response_functor not initialised or "
+                << " incorrect expected_response_count";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  Insert(task_id, std::chrono::steady_clock::now(), timeout, [&](uint64_t expiry_tick) {
+    return Task(group_response_functor, std::move(is_complete), expected_response_count,
+                expiry_tick);
+  });
+}
 
-    switch (error.value()) {
-      case boost::system::errc::success:  // Task's timer has expired
-        LOG(kWarning) << "Timed out waiting for task " << task_id;
-        break;
-      case boost::asio::error::operation_aborted:  // Cancelled via CancelTask
-        LOG(kInfo) << "Cancelled task " << task_id;
-        break;
-      default:
-        LOG(kError) << "Error waiting for task " << task_id << " - " << error.message();
-    }
+template <typename Response>
+typename Timer<Response>::CompletionPredicate Timer<Response>::IdenticalResponses(size_t count) {
+  return [count](const std::vector<Response>& responses) {
+    // Only the latest response can have completed a set.
+    return !responses.empty() &&
+           static_cast<size_t>(std::count(std::begin(responses), std::end(responses),
+                                          responses.back())) >= count;
+  };
+}
 
-    for (int i(0); i != outstanding_response_count; ++i)
-      asio_service_.service().dispatch([=] { functor(Response()); });
+template <typename Response>
+template <typename MakeTask>
+void Timer<Response>::Insert(TaskId task_id, const std::chrono::steady_clock::time_point& now,
+                             const std::chrono::steady_clock::duration& timeout,
+                             const MakeTask& make_task) {
+  Shard& shard(ShardOf(task_id));
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.tasks.empty())
+      shard.current_tick = std::max(shard.current_tick, TickAt(now));
+    // Round up, so that the task can't expire early.
+    uint64_t expiry_tick(std::max(TickAt(now + timeout) + 1, shard.current_tick + 1));
+    auto result(shard.tasks.insert(std::make_pair(task_id, make_task(expiry_tick))));
+    assert(result.second);
+    AddToWheel(shard, task_id, result.first->second);
+    ++task_count_;
   }
-
-  cond_var_.notify_one();
+  ScheduleTick();
 }
 
 template <typename Response>
 void Timer<Response>::CancelTask(TaskId task_id) {
   LOG(kVerbose) << "Timer<Response>::CancelTask task " << task_id << " is to be canceled";
-  std::lock_guard<std::mutex> lock(mutex_);
-  auto itr(tasks_.find(task_id));
-  if (itr == std::end(tasks_)) {
-    LOG(kError) << "Task " << task_id << " not held by Timer.";
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  std::vector<Task> cancelled;
+  {
+    Shard& shard(ShardOf(task_id));
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto itr(shard.tasks.find(task_id));
+    if (itr == std::end(shard.tasks)) {
+      LOG(kError) << "Task " << task_id << " not held by Timer.";
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+    }
+    cancelled.push_back(RemoveTask(shard, itr));
   }
-  itr->second.timer->cancel();
+  LOG(kInfo) << "Cancelled task " << task_id;
+  InvokeForShortfall(asio_service_.service(), cancelled.front());
 }
 
 template <typename Response>
 void Timer<Response>::AddResponse(TaskId task_id, const Response& response) {
+  AddResponse(task_id, Response(response));
+}
+
+template <typename Response>
+void Timer<Response>::AddResponse(TaskId task_id, Response&& response) {
   ResponseFunctor functor;
+  GroupResponseFunctor group_functor;
+  std::shared_ptr<std::vector<Response>> responses;
   LOG(kVerbose) << "Timer<Response>::AddResponse add response to task " << task_id;
   {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto itr(tasks_.find(task_id));
-    if (itr == std::end(tasks_)) {
+    Shard& shard(ShardOf(task_id));
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto itr(shard.tasks.find(task_id));
+    if (itr == std::end(shard.tasks)) {
       LOG(kError) << "Task " << task_id << " not held by Timer.";
       BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
     }
@@ -233,19 +368,158 @@ void Timer<Response>::AddResponse(TaskId task_id, const Response& response) {
     --(itr->second.outstanding_response_count);
     LOG(kVerbose) << "Task " << task_id << " now having " << itr->second.outstanding_response_count
                   << " outstanding_response_count.";
-    functor = itr->second.functor;
-    if (itr->second.outstanding_response_count == 0)
-      itr->second.timer->cancel();  // Invokes 'FinishTask'
+    Task& task(itr->second);
+    if (task.group_functor) {
+      task.responses.push_back(std::move(response));
+      if (task.outstanding_response_count != 0 &&
+          !(task.is_complete && task.is_complete(task.responses)))
+        return;
+      Task finished(RemoveTask(shard, itr));
+      group_functor = std::move(finished.group_functor);
+      responses = std::make_shared<std::vector<Response>>(std::move(finished.responses));
+    } else if (task.outstanding_response_count == 0) {
+      functor = std::move(RemoveTask(shard, itr).functor);
+    } else {
+      functor = task.functor;
+    }
+  }
+  if (group_functor) {
+    asio_service_.service().dispatch([=] { group_functor(std::move(*responses)); });
+  } else {
+    auto moved_response(std::make_shared<Response>(std::move(response)));
+    asio_service_.service().dispatch([=] { functor(std::move(*moved_response)); });
   }
-  asio_service_.service().dispatch([=] { functor(response); });
 }
 
 template <typename Response>
 TaskId Timer<Response>::NewTaskId() {
-  std::lock_guard<std::mutex> lock(mutex_);
   return new_task_id_++;
 }
 
+template <typename Response>
+uint64_t Timer<Response>::TickAt(const std::chrono::steady_clock::time_point& time) const {
+  return static_cast<uint64_t>((time - kStartTime_) / detail::kTimerTick);
+}
+
+template <typename Response>
+void Timer<Response>::AddToWheel(Shard& shard, TaskId task_id, Task& task) {
+  const uint64_t kExpiryTick(std::max(task.expiry_tick, shard.current_tick));
+  const uint64_t kDelta(kExpiryTick - shard.current_tick);
+  size_t level(0);
+  while (level + 1 < detail::kTimerLevels &&
+         kDelta >= (static_cast<uint64_t>(1) << (detail::kTimerSlotBits * (level + 1))))
+    ++level;
+  // Beyond the top level's range, a task is cascaded back into the top level until it's in range.
+  size_t index(static_cast<size_t>((kExpiryTick >> (detail::kTimerSlotBits * level)) &
+                                   ((1 << detail::kTimerSlotBits) - 1)));
+  task.slot = &shard.wheel[level][index];
+  task.position = task.slot->insert(std::end(*task.slot), task_id);
+}
+
+template <typename Response>
+typename Timer<Response>::Task Timer<Response>::RemoveTask(Shard& shard,
+                                                           typename TaskMap::iterator itr) {
+  Task task(std::move(itr->second));
+  task.slot->erase(task.position);
+  shard.tasks.erase(itr);
+  if (--task_count_ == 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cond_var_.notify_all();
+  }
+  return task;
+}
+
+template <typename Response>
+void Timer<Response>::Cascade(Shard& shard, size_t level) {
+  Slot& slot(shard.wheel[level][(shard.current_tick >> (detail::kTimerSlotBits * level)) &
+                                ((1 << detail::kTimerSlotBits) - 1)]);
+  Slot task_ids;
+  task_ids.swap(slot);
+  for (const auto& task_id : task_ids)
+    AddToWheel(shard, task_id, shard.tasks.find(task_id)->second);
+}
+
+template <typename Response>
+void Timer<Response>::Advance(Shard& shard, uint64_t target_tick,
+                              std::vector<std::pair<TaskId, Task>>& expired) {
+  const uint64_t kSlotMask((1 << detail::kTimerSlotBits) - 1);
+  while (!shard.tasks.empty() && shard.current_tick < target_tick) {
+    ++shard.current_tick;
+    for (size_t level(1); level != detail::kTimerLevels; ++level) {
+      if ((shard.current_tick >> (detail::kTimerSlotBits * (level - 1))) & kSlotMask)
+        break;
+      Cascade(shard, level);
+    }
+    Slot& due(shard.wheel[0][shard.current_tick & kSlotMask]);
+    while (!due.empty()) {
+      TaskId task_id(due.front());
+      expired.push_back(std::make_pair(task_id, RemoveTask(shard, shard.tasks.find(task_id))));
+    }
+  }
+  if (shard.tasks.empty())
+    shard.current_tick = std::max(shard.current_tick, target_tick);
+}
+
+template <typename Response>
+void Timer<Response>::ScheduleTick() {
+  std::lock_guard<std::mutex> lock(tick_mutex_);
+  if (tick_scheduled_ || task_count_ == 0)
+    return;
+  tick_scheduled_ = true;
+  std::weak_ptr<TickGuard> guard(tick_guard_);
+  tick_timer_.expires_from_now(detail::kTimerTick);
+  boost::asio::io_service* service(&asio_service_.service());
+  tick_timer_.async_wait([this, guard, service](const boost::system::error_code& error) {
+    auto tick_guard(guard.lock());
+    if (!tick_guard)
+      return;
+    std::vector<std::pair<TaskId, Task>> expired;
+    {
+      std::lock_guard<std::mutex> guard_lock(tick_guard->mutex);
+      if (!tick_guard->alive)
+        return;
+      if (error && error != boost::asio::error::operation_aborted)
+        LOG(kError) << "Error waiting for timer tick - " << error.message();
+      expired = OnTick();
+    }
+    // The guard is released first, since the Timer may be destroyed from here on.
+    for (auto& task : expired) {
+      LOG(kWarning) << "Timed out waiting for task " << task.first;
+      InvokeForShortfall(*service, task.second);
+    }
+  });
+}
+
+template <typename Response>
+std::vector<std::pair<TaskId, typename Timer<Response>::Task>> Timer<Response>::OnTick() {
+  {
+    // Cleared first, so that a task added while the shards are being advanced schedules a tick.
+    std::lock_guard<std::mutex> lock(tick_mutex_);
+    tick_scheduled_ = false;
+  }
+  const uint64_t kTargetTick(TickAt(std::chrono::steady_clock::now()));
+  std::vector<std::pair<TaskId, Task>> expired;
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    Advance(shard, kTargetTick, expired);
+  }
+  ScheduleTick();
+  return expired;
+}
+
+template <typename Response>
+void Timer<Response>::InvokeForShortfall(boost::asio::io_service& service, Task& task) {
+  assert(task.outstanding_response_count >= 0);
+  if (task.group_functor) {
+    GroupResponseFunctor group_functor(std::move(task.group_functor));
+    auto responses(std::make_shared<std::vector<Response>>(std::move(task.responses)));
+    service.post([=] { group_functor(std::move(*responses)); });
+    return;
+  }
+  ResponseFunctor functor(std::move(task.functor));
+  for (int i(0); i != task.outstanding_response_count; ++i)
+    service.post([=] { functor(Response()); });
+}
 
 }  // namespace routing
 
@@ -0,0 +1,63 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_TRACE_EVENT_H_
+#define MAIDSAFE_ROUTING_TRACE_EVENT_H_
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace maidsafe {
+
+namespace routing {
+
+// What a node did with a traced message.  A message is traced hop by hop once sampled by its
+// origin, one in Parameters::trace_sample_interval of the messages sent through Routing.
+enum class TraceDecision : uint8_t {
+  kOriginated = 0,
+  kReceived = 1,   // queue_delay is how long it waited to be handled
+  kSent = 2,       // next_hop is the peer it was sent to
+  kDelivered = 3,  // handled by this node
+  kDropped = 4
+};
+
+struct TraceEvent {
+  TraceEvent();
+
+  uint64_t trace_id;
+  uint64_t node;       // leading 64 bits of the recording node's ID
+  uint64_t next_hop;   // leading 64 bits of the peer's ID for kSent, otherwise 0
+  uint64_t timestamp;  // microseconds since the epoch
+  uint32_t queue_delay;  // microseconds
+  TraceDecision decision;
+};
+
+// The events still held in this process's trace buffers, ordered by trace id and then time.  Each
+// recording thread keeps its latest MessageTrace::kRingCapacity events.
+std::vector<TraceEvent> DumpTraceEvents();
+
+// Writes one line per event, "<trace id> <node> <timestamp> <decision> <next hop> <queue delay>",
+// with the IDs as 16 hex digits and the rest in decimal.  network_viewer displays files of these.
+void WriteTraceEvents(const std::vector<TraceEvent>& events, std::ostream& stream);
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_TRACE_EVENT_H_
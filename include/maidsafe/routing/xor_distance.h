@@ -0,0 +1,81 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_XOR_DISTANCE_H_
+#define MAIDSAFE_ROUTING_XOR_DISTANCE_H_
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+
+#include "maidsafe/routing/node_info.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// The XOR distance of a NodeId from a fixed target, held as big-endian 64-bit words.  Building one
+// costs a single pass over the ID, after which comparing two distances takes at most kWords
+// integer comparisons rather than a byte-by-byte walk of both IDs and the target.
+//
+// The value is also a fixed-width unsigned integer for the small amount of arithmetic done on
+// distances (averages and radii).  One word of headroom above the width of a NodeId means sums of
+// up to 2^64 distances, or a distance scaled by any uint32_t factor, never overflow.
+class XorDistance {
+ public:
+  static const size_t kWords = NodeId::kSize / sizeof(uint64_t) + 1;
+
+  XorDistance();
+  explicit XorDistance(const NodeId& distance);
+  XorDistance(const NodeId& node_id, const NodeId& target);
+
+  XorDistance& operator+=(const XorDistance& other);
+  XorDistance& operator*=(uint32_t factor);
+  XorDistance& operator/=(uint32_t divisor);
+  // Returns the low NodeId::kSize bytes; only meaningful when the headroom word is unused.
+  NodeId ToNodeId() const;
+
+  friend bool operator<(const XorDistance& lhs, const XorDistance& rhs);
+  friend bool operator==(const XorDistance& lhs, const XorDistance& rhs);
+
+ private:
+  std::array<uint64_t, kWords> words_;
+};
+
+bool operator<(const XorDistance& lhs, const XorDistance& rhs);
+bool operator==(const XorDistance& lhs, const XorDistance& rhs);
+inline bool operator<=(const XorDistance& lhs, const XorDistance& rhs) { return !(rhs < lhs); }
+inline XorDistance operator*(XorDistance lhs, uint32_t factor) { return lhs *= factor; }
+inline XorDistance operator/(XorDistance lhs, uint32_t divisor) { return lhs /= divisor; }
+
+// Batch ranking against one target.  Each candidate's distance is computed once, so ordering N
+// candidates costs N distance computations plus cheap word comparisons.  Both return up to count
+// entries, closest to target first; ties cannot occur between distinct IDs.
+std::vector<const NodeInfo*> RankFromTarget(std::vector<NodeInfo>::const_iterator first,
+                                            std::vector<NodeInfo>::const_iterator last,
+                                            const NodeId& target, size_t count);
+std::vector<NodeId> RankIdsFromTarget(const std::vector<NodeId>& node_ids, const NodeId& target,
+                                      size_t count);
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_XOR_DISTANCE_H_
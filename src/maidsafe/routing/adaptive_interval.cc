@@ -0,0 +1,56 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/adaptive_interval.h"
+
+#include <algorithm>
+
+#include "maidsafe/routing/parameters.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+AdaptiveInterval::AdaptiveInterval(std::chrono::steady_clock::duration base)
+    : mutex_(), kBase_(base), current_(base) {}
+
+std::chrono::steady_clock::duration AdaptiveInterval::current() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return current_;
+}
+
+void AdaptiveInterval::Backoff() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  current_ = std::min(current_ * 2, kBase_ * std::max(Parameters::interval_backoff_limit,
+                                                      static_cast<uint16_t>(1)));
+}
+
+void AdaptiveInterval::Tighten() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  current_ = std::max(current_ / 2, kBase_ / std::max(Parameters::interval_tighten_limit,
+                                                      static_cast<uint16_t>(1)));
+}
+
+void AdaptiveInterval::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  current_ = kBase_;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,55 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_ADAPTIVE_INTERVAL_H_
+#define MAIDSAFE_ROUTING_ADAPTIVE_INTERVAL_H_
+
+#include <chrono>
+#include <mutex>
+
+namespace maidsafe {
+
+namespace routing {
+
+// A timer interval which starts at a base value, doubles on each Backoff() up to
+// base * Parameters::interval_backoff_limit, and on Tighten() halves, down to
+// base / Parameters::interval_tighten_limit.
+class AdaptiveInterval {
+ public:
+  explicit AdaptiveInterval(std::chrono::steady_clock::duration base);
+  std::chrono::steady_clock::duration current() const;
+  void Backoff();
+  void Tighten();
+  // Returns to the base value.
+  void Reset();
+
+ private:
+  AdaptiveInterval(const AdaptiveInterval&);
+  AdaptiveInterval(const AdaptiveInterval&&);
+  AdaptiveInterval& operator=(const AdaptiveInterval&);
+
+  mutable std::mutex mutex_;
+  const std::chrono::steady_clock::duration kBase_;
+  std::chrono::steady_clock::duration current_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_ADAPTIVE_INTERVAL_H_
@@ -0,0 +1,210 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/bootstrap_cache.h"
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <tuple>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/utils.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+typedef boost::asio::ip::udp::endpoint Endpoint;
+
+}  // unnamed namespace
+
+BootstrapCache::BootstrapCache(AsioService& asio_service)
+    : mutex_(),
+      path_(),
+      contacts_(),
+      flush_scheduled_(false),
+      changes_(0),
+      flushed_changes_(0),
+      flush_timer_(asio_service.service()) {}
+
+BootstrapCache::~BootstrapCache() {
+  flush_timer_.cancel();
+  Flush();
+}
+
+bool BootstrapCache::Load(const fs::path& path) {
+  std::string serialised;
+  boost::system::error_code error_code;
+  protobuf::BootstrapCache proto_cache;
+  if (fs::exists(path, error_code)) {
+    if (!ReadFile(path, &serialised) || !proto_cache.ParseFromString(serialised)) {
+      LOG(kError) << "Could not read bootstrap cache " << path;
+      return false;
+    }
+  }
+
+  std::map<Endpoint, Contact> contacts;
+  for (const auto& proto_contact : proto_cache.contacts()) {
+    boost::asio::ip::address address(
+        boost::asio::ip::address::from_string(proto_contact.endpoint().ip(), error_code));
+    if (error_code)
+      continue;
+    Contact& contact(
+        contacts[Endpoint(address, static_cast<uint16_t>(proto_contact.endpoint().port()))]);
+    contact.last_success = std::chrono::system_clock::time_point(
+        std::chrono::milliseconds(proto_contact.last_success()));
+    contact.join_time = std::chrono::milliseconds(proto_contact.join_time());
+    contact.failures = static_cast<uint16_t>(proto_contact.failures());
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  path_ = path;
+  contacts_.swap(contacts);
+  flushed_changes_ = changes_;
+  LOG(kVerbose) << "Loaded " << contacts_.size() << " bootstrap contacts from " << path;
+  return true;
+}
+
+void BootstrapCache::Add(const Endpoint& endpoint) {
+  if (endpoint.address().is_unspecified())
+    return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (contacts_.insert(std::make_pair(endpoint, Contact())).second)
+    ChangeMade();
+}
+
+void BootstrapCache::RecordSuccess(const Endpoint& endpoint,
+                                   std::chrono::steady_clock::duration join_time) {
+  if (endpoint.address().is_unspecified())
+    return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  Contact& contact(contacts_[endpoint]);
+  contact.last_success = std::chrono::system_clock::now();
+  contact.join_time = std::chrono::duration_cast<std::chrono::milliseconds>(join_time);
+  contact.failures = 0;
+  ChangeMade();
+}
+
+void BootstrapCache::RecordFailure(const Endpoint& endpoint) {
+  if (endpoint.address().is_unspecified())
+    return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  Contact& contact(contacts_[endpoint]);
+  if (contact.failures < std::numeric_limits<uint16_t>::max())
+    ++contact.failures;
+  ChangeMade();
+}
+
+void BootstrapCache::Remove(const Endpoint& endpoint) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (contacts_.erase(endpoint) != 0)
+    ChangeMade();
+}
+
+std::vector<Endpoint> BootstrapCache::Rank(const std::vector<Endpoint>& endpoints) const {
+  std::vector<Endpoint> ranked_endpoints;
+  std::vector<std::tuple<int, std::chrono::milliseconds, uint16_t>> ranks;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (endpoints.empty()) {
+    for (const auto& contact : contacts_)
+      ranked_endpoints.push_back(contact.first);
+  } else {
+    for (const auto& endpoint : endpoints) {
+      if (std::find(std::begin(ranked_endpoints), std::end(ranked_endpoints), endpoint) ==
+          std::end(ranked_endpoints))
+        ranked_endpoints.push_back(endpoint);
+    }
+  }
+
+  auto rank([this](const Endpoint& endpoint) {
+    auto itr(contacts_.find(endpoint));
+    Contact contact(itr == std::end(contacts_) ? Contact() : itr->second);
+    if (contact.last_success != std::chrono::system_clock::time_point())
+      return std::make_tuple(0, contact.join_time * (1 + contact.failures), contact.failures);
+    return std::make_tuple(contact.failures == 0 ? 1 : 2, std::chrono::milliseconds(0),
+                           contact.failures);
+  });
+  std::stable_sort(std::begin(ranked_endpoints), std::end(ranked_endpoints),
+                   [&rank](const Endpoint& lhs, const Endpoint& rhs) {
+    return rank(lhs) < rank(rhs);
+  });
+  return ranked_endpoints;
+}
+
+void BootstrapCache::Flush() {
+  fs::path path;
+  std::string serialised;
+  uint64_t changes(0);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flush_scheduled_ = false;
+    if (path_.empty() || changes_ == flushed_changes_)
+      return;
+    protobuf::BootstrapCache proto_cache;
+    for (const auto& contact : contacts_) {
+      protobuf::BootstrapCacheContact* proto_contact(proto_cache.add_contacts());
+      proto_contact->mutable_endpoint()->set_ip(contact.first.address().to_string());
+      proto_contact->mutable_endpoint()->set_port(contact.first.port());
+      if (contact.second.last_success != std::chrono::system_clock::time_point()) {
+        proto_contact->set_last_success(std::chrono::duration_cast<std::chrono::milliseconds>(
+            contact.second.last_success.time_since_epoch()).count());
+        proto_contact->set_join_time(static_cast<int32_t>(contact.second.join_time.count()));
+      }
+      if (contact.second.failures != 0)
+        proto_contact->set_failures(contact.second.failures);
+    }
+    serialised = proto_cache.SerializeAsString();
+    path = path_;
+    changes = changes_;
+  }
+
+  if (!WriteFileAtomically(path, serialised))
+    return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  flushed_changes_ = std::max(flushed_changes_, changes);
+}
+
+void BootstrapCache::ChangeMade() {
+  ++changes_;
+  if (path_.empty() || flush_scheduled_)
+    return;
+  flush_scheduled_ = true;
+  std::weak_ptr<BootstrapCache> this_weak_ptr(shared_from_this());
+  flush_timer_.expires_from_now(Parameters::bootstrap_cache_flush_interval);
+  flush_timer_.async_wait([this_weak_ptr](const boost::system::error_code& error_code) {
+    if (error_code == boost::asio::error::operation_aborted)
+      return;
+    if (std::shared_ptr<BootstrapCache> bootstrap_cache = this_weak_ptr.lock())
+      bootstrap_cache->Flush();
+  });
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,90 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_BOOTSTRAP_CACHE_H_
+#define MAIDSAFE_ROUTING_BOOTSTRAP_CACHE_H_
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "boost/asio/ip/udp.hpp"
+#include "boost/asio/steady_timer.hpp"
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/asio_service.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// Bootstrap contacts along with how well joining via each has gone.  Changes are made in memory
+// and, once a file has been loaded, written back to it at most once per
+// Parameters::bootstrap_cache_flush_interval via a temporary file and a rename, so a crash never
+// leaves a partly written cache.
+class BootstrapCache : public std::enable_shared_from_this<BootstrapCache> {
+ public:
+  explicit BootstrapCache(AsioService& asio_service);
+  // Writes any outstanding changes.
+  ~BootstrapCache();
+  // Replaces the contents with those of the file at 'path' (if it exists) and persists later
+  // changes there.  Returns false if the file exists but can't be parsed.
+  bool Load(const boost::filesystem::path& path);
+  void Add(const boost::asio::ip::udp::endpoint& endpoint);
+  void RecordSuccess(const boost::asio::ip::udp::endpoint& endpoint,
+                     std::chrono::steady_clock::duration join_time);
+  void RecordFailure(const boost::asio::ip::udp::endpoint& endpoint);
+  void Remove(const boost::asio::ip::udp::endpoint& endpoint);
+  // Returns 'endpoints' without duplicates, or every cached contact if 'endpoints' is empty,
+  // ordered by expected join time: contacts which have joined before come first, quickest first
+  // and penalised for each failure since, then untried ones in their given order, then those which
+  // have only failed, fewest failures first.
+  std::vector<boost::asio::ip::udp::endpoint> Rank(
+      const std::vector<boost::asio::ip::udp::endpoint>& endpoints) const;
+  // Writes outstanding changes now.
+  void Flush();
+
+ private:
+  struct Contact {
+    Contact() : last_success(), join_time(), failures(0) {}
+    std::chrono::system_clock::time_point last_success;
+    std::chrono::milliseconds join_time;
+    uint16_t failures;
+  };
+
+  BootstrapCache(const BootstrapCache&);
+  BootstrapCache(const BootstrapCache&&);
+  BootstrapCache& operator=(const BootstrapCache&);
+  // Must be called with mutex_ locked.
+  void ChangeMade();
+
+  mutable std::mutex mutex_;
+  boost::filesystem::path path_;
+  std::map<boost::asio::ip::udp::endpoint, Contact> contacts_;
+  bool flush_scheduled_;
+  uint64_t changes_, flushed_changes_;
+  boost::asio::steady_timer flush_timer_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_BOOTSTRAP_CACHE_H_
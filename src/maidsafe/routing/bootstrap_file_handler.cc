@@ -18,12 +18,16 @@
 
 #include "maidsafe/routing/bootstrap_file_handler.h"
 
+#include <algorithm>
 #include <string>
 
+#include "boost/filesystem/operations.hpp"
+
 #include "maidsafe/common/log.h"
 #include "maidsafe/common/utils.h"
 
 #include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/utils.h"
 
 namespace fs = boost::filesystem;
 
@@ -150,6 +154,54 @@ typedef boost::asio::ip::udp::endpoint Endpoint;
 //   return;
 // }
 
+bool WriteRoutingSnapshot(const std::vector<NodeInfo>& nodes,
+                          const std::vector<NodeInfo>& matrix_nodes,
+                          const fs::path& snapshot_path) {
+  protobuf::RoutingSnapshot proto_snapshot;
+  try {
+    for (const auto& node : nodes)
+      proto_snapshot.add_nodes(node.Serialise()->string());
+    for (const auto& node : matrix_nodes)
+      proto_snapshot.add_matrix_nodes(node.Serialise()->string());
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Could not serialise routing snapshot: " << e.what();
+    return false;
+  }
+  return WriteFileAtomically(snapshot_path, proto_snapshot.SerializeAsString());
+}
+
+bool ReadRoutingSnapshot(const fs::path& snapshot_path, std::vector<NodeId>& peers) {
+  peers.clear();
+  boost::system::error_code error_code;
+  if (!fs::exists(snapshot_path, error_code))
+    return true;
+
+  std::string serialised_snapshot;
+  protobuf::RoutingSnapshot proto_snapshot;
+  if (!ReadFile(snapshot_path, &serialised_snapshot) ||
+      !proto_snapshot.ParseFromString(serialised_snapshot)) {
+    LOG(kError) << "Could not read routing snapshot " << snapshot_path;
+    return false;
+  }
+
+  auto add_peer([&peers](const std::string& serialised_node) {
+    try {
+      NodeInfo node(NodeInfo::serialised_type((NonEmptyString(serialised_node))));
+      if (std::find(std::begin(peers), std::end(peers), node.node_id) == std::end(peers))
+        peers.push_back(node.node_id);
+    }
+    catch (const std::exception& e) {
+      LOG(kWarning) << "Skipping invalid routing snapshot entry: " << e.what();
+    }
+  });
+  for (const auto& serialised_node : proto_snapshot.nodes())
+    add_peer(serialised_node);
+  for (const auto& serialised_node : proto_snapshot.matrix_nodes())
+    add_peer(serialised_node);
+  return true;
+}
+
 std::vector<boost::asio::ip::udp::endpoint> MaidSafeEndpoints() {
   std::vector<std::string> endpoint_string;
   endpoint_string.reserve(15);
@@ -24,6 +24,10 @@
 #include "boost/asio/ip/udp.hpp"
 #include "boost/filesystem/path.hpp"
 
+#include "maidsafe/common/node_id.h"
+
+#include "maidsafe/routing/node_info.h"
+
 namespace maidsafe {
 
 namespace routing {
@@ -35,6 +39,16 @@ bool WriteBootstrapFile(const std::vector<boost::asio::ip::udp::endpoint>& endpo
 
 void UpdateBootstrapFile(const boost::asio::ip::udp::endpoint& endpoint, bool remove);
 
+// Saves the IDs of a node's routing table and group matrix peers, so that it can reconnect to them
+// directly after a restart.
+bool WriteRoutingSnapshot(const std::vector<NodeInfo>& nodes,
+                          const std::vector<NodeInfo>& matrix_nodes,
+                          const boost::filesystem::path& snapshot_path);
+
+// Returns the peers saved by WriteRoutingSnapshot, routing table peers first.  Returns false if the
+// file exists but can't be parsed.
+bool ReadRoutingSnapshot(const boost::filesystem::path& snapshot_path, std::vector<NodeId>& peers);
+
 std::vector<boost::asio::ip::udp::endpoint> MaidSafeEndpoints();
 
 // TODO(Prakash) : BEFORE_RELEASE remove using local endpoints
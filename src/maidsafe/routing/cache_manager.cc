@@ -18,6 +18,11 @@
 
 #include "maidsafe/routing/cache_manager.h"
 
+#include <memory>
+
+#include "maidsafe/common/crypto.h"
+
+#include "maidsafe/routing/message_latency.h"
 #include "maidsafe/routing/network_utils.h"
 #include "maidsafe/routing/parameters.h"
 #include "maidsafe/routing/routing.pb.h"
@@ -27,11 +32,41 @@ namespace maidsafe {
 
 namespace routing {
 
+namespace {
+
+// Gets passed on which are remembered while awaiting their response
+const size_t kMaxPendingGets(1024);
+// Dimensions of the sketch of requested keys
+const size_t kPopularityWidth(4096), kPopularityDepth(4);
+
+// The destination id, of NodeId::kSize, followed by the request data.
+std::string CacheKey(const protobuf::Message& message) {
+  return message.destination_id() + message.data(0);
+}
+
+// The data field as it appears in a serialised message, ready to be appended to a serialised
+// response header.
+std::shared_ptr<const std::string> EncodeBody(const std::string& data) {
+  protobuf::Message body;
+  body.add_data(data);
+  return std::make_shared<const std::string>(body.SerializePartialAsString());
+}
+
+}  // unnamed namespace
+
 CacheManager::CacheManager(NodeId node_id, NetworkUtils& network)
     : kNodeId_(std::move(node_id)),
       network_(network),
       message_received_functor_(),
-      store_cache_data_() {}
+      store_cache_data_(),
+      validate_cache_data_(),
+      mutex_(),
+      store_(Parameters::cache_capacity_bytes, Parameters::num_chunks_to_cache),
+      popularity_(kPopularityWidth, kPopularityDepth),
+      statistics_(),
+      pending_gets_(),
+      pending_get_order_(),
+      handler_guard_() {}
 
 void CacheManager::InitialiseFunctors(MessageReceivedFunctor message_received_functor,
                                       StoreCacheDataFunctor store_cache_data) {
@@ -41,61 +76,153 @@ void CacheManager::InitialiseFunctors(MessageReceivedFunctor message_received_fu
   store_cache_data_ = store_cache_data;
 }
 
+void CacheManager::set_validate_cache_data_functor(ValidateCacheDataFunctor validate_cache_data) {
+  validate_cache_data_ = validate_cache_data;
+}
+
 void CacheManager::AddToCache(const protobuf::Message& message) {
   assert(!message.request());
-  if (store_cache_data_)
-    store_cache_data_(message.data(0));
+  std::string key;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto pending(pending_gets_.find(std::make_pair(message.destination_id(), message.id())));
+    if (pending != std::end(pending_gets_)) {
+      key = std::move(pending->second);
+      pending_gets_.erase(pending);
+    }
+  }
+  // The payload is copied here as the message is about to be sent on, but the store (and any
+  // upcall) is posted so as not to hold up forwarding.
+  if (!key.empty()) {
+    int32_t id(message.id());
+    std::string data(message.data(0));
+    network_.asio_service().service().post(handler_guard_.Wrap([this, id, key, data]() {
+      // Any node on the return path could have altered the response, so it's checked first.
+      if (!IsValidCacheData(key, data)) {
+        LOG(kWarning) << " [" << DebugId(kNodeId_) << "] not caching invalid response (id: "
+                      << id << ")";
+        return;
+      }
+      LOG(kVerbose) << " [" << DebugId(kNodeId_) << "] caching response (id: " << id << ")";
+      auto encoded_body(EncodeBody(data));
+      std::lock_guard<std::mutex> lock(mutex_);
+      store_.Put(key, encoded_body);
+      statistics_.bytes_stored += encoded_body->size();
+    }));
+  } else if (IsCacheablePut(message) && store_cache_data_) {
+    std::string data(message.data(0));
+    network_.asio_service().service().post(
+        handler_guard_.Wrap([this, data]() { store_cache_data_(data); }));
+  }
 }
-// FIXME(Prakash)
+
 void CacheManager::HandleGetFromCache(protobuf::Message& message) {
   assert(IsRequest(message));
   assert(IsCacheableGet(message));
   assert(kNodeId_.string() != message.source_id());
   assert(kNodeId_.string() != message.destination_id());
-  if (message_received_functor_) {
-    if (IsRequest(message)) {
-      LOG(kVerbose) << " [" << DebugId(kNodeId_) << "] rcvd : " << MessageTypeString(message)
-                    << " from " << HexSubstr(message.source_id()) << "   (id: " << message.id()
-                    << ")  --NodeLevel-- caching";
-      ReplyFunctor response_functor = [=](const std::string & reply_message) {
-        if (reply_message.empty()) {
-          LOG(kVerbose) << "No cache available, passing on the original request";
-          return network_.SendToClosestNode(message);
-        }
-
-        //  Responding with cached response
-        protobuf::Message message_out;
-        message_out.set_request(false);
-        message_out.set_hops_to_live(Parameters::hops_to_live);
-        message_out.set_destination_id(message.source_id());
-        message_out.set_type(message.type());
-        message_out.set_direct(true);
-        message_out.clear_data();
-        message_out.set_client_node(message.client_node());
-        message_out.set_routing_message(message.routing_message());
-        message_out.add_data(reply_message);
-        message_out.set_last_id(kNodeId_.string());
-        message_out.set_source_id(kNodeId_.string());
-        if (message.has_cacheable())
-          message_out.set_cacheable(message.cacheable());
-        if (message.has_id())
-          message_out.set_id(message.id());
-        else
-          LOG(kInfo) << "Message to be sent back had no ID.";
-
-        if (message.has_relay_id())
-          message_out.set_relay_id(message.relay_id());
-
-        if (message.has_relay_connection_id()) {
-          message_out.set_relay_connection_id(message.relay_connection_id());
-        }
-        network_.SendToClosestNode(message_out);
-      };
-
-      if (message_received_functor_)
-        message_received_functor_(message.data(0), true, response_functor);
+  std::string key(CacheKey(message));
+  std::shared_ptr<const std::string> cached;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    popularity_.Add(key);
+    cached = store_.Get(key);
+    ++statistics_.gets_seen;
+    if (cached) {
+      ++statistics_.hits;
+      statistics_.bytes_served += cached->size();
+    } else {
+      ++statistics_.misses;
     }
   }
+  if (cached) {
+    LOG(kVerbose) << " [" << DebugId(kNodeId_) << "] answering " << MessageTypeString(message)
+                  << " from " << HexSubstr(message.source_id()) << " (id: " << message.id()
+                  << ") from cache";
+    return network_.SendEncodedToClosestNode(CachedResponseHeader(message), cached);
+  }
+  AddPendingGet(message, std::move(key));
+
+  if (!message_received_functor_)
+    return network_.SendToClosestNode(message);
+  LOG(kVerbose) << " [" << DebugId(kNodeId_) << "] rcvd : " << MessageTypeString(message)
+                << " from " << HexSubstr(message.source_id()) << "   (id: " << message.id()
+                << ")  --NodeLevel-- caching";
+  ReplyFunctor response_functor = [=](std::string reply_message) {
+    if (reply_message.empty()) {
+      LOG(kVerbose) << "No cache available, passing on the original request";
+      return network_.SendToClosestNode(message);
+    }
+    protobuf::Message message_out(CachedResponseHeader(message));
+    message_out.add_data()->swap(reply_message);
+    network_.SendToClosestNode(message_out);
+  };
+  MessageLatency::Mark(MessageStage::kUpcall);
+  message_received_functor_(message.data(0), true, response_functor);
+}
+
+CacheStatistics CacheManager::statistics() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  CacheStatistics statistics(statistics_);
+  statistics.entries = store_.size();
+  statistics.bytes_held = store_.bytes();
+  return statistics;
+}
+
+uint32_t CacheManager::EstimatedGetCount(const NodeId& destination_id,
+                                         const std::string& request_data) const {
+  std::string key(destination_id.string() + request_data);
+  std::lock_guard<std::mutex> lock(mutex_);
+  return popularity_.Estimate(key);
+}
+
+void CacheManager::AddPendingGet(const protobuf::Message& request, std::string key) {
+  if (!request.has_source_id() || !request.has_id())
+    return;
+  PendingGetId pending_id(request.source_id(), request.id());
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!pending_gets_.insert(std::make_pair(pending_id, std::move(key))).second)
+    return;
+  pending_get_order_.push_back(pending_id);
+  while (pending_get_order_.size() > kMaxPendingGets) {
+    pending_gets_.erase(pending_get_order_.front());
+    pending_get_order_.pop_front();
+  }
+}
+
+bool CacheManager::IsValidCacheData(const std::string& key, const std::string& data) const {
+  if (key.size() < NodeId::kSize)
+    return false;
+  if (validate_cache_data_)
+    return validate_cache_data_(key.substr(NodeId::kSize), data);
+  return crypto::Hash<crypto::SHA512>(data).string() == key.substr(0, NodeId::kSize);
+}
+
+protobuf::Message CacheManager::CachedResponseHeader(const protobuf::Message& request) const {
+  protobuf::Message message_out;
+  message_out.set_request(false);
+  message_out.set_hops_to_live(Parameters::hops_to_live);
+  message_out.set_destination_id(request.source_id());
+  message_out.set_type(request.type());
+  message_out.set_direct(true);
+  message_out.set_client_node(request.client_node());
+  message_out.set_routing_message(request.routing_message());
+  message_out.set_last_id(kNodeId_.string());
+  message_out.set_source_id(kNodeId_.string());
+  if (request.has_cacheable())
+    message_out.set_cacheable(request.cacheable());
+  if (request.has_id())
+    message_out.set_id(request.id());
+  else
+    LOG(kInfo) << "Message to be sent back had no ID.";
+
+  if (request.has_relay_id())
+    message_out.set_relay_id(request.relay_id());
+
+  if (request.has_relay_connection_id()) {
+    message_out.set_relay_connection_id(request.relay_connection_id());
+  }
+  return message_out;
 }
 
 }  // namespace routing
@@ -19,9 +19,18 @@
 #ifndef MAIDSAFE_ROUTING_CACHE_MANAGER_H_
 #define MAIDSAFE_ROUTING_CACHE_MANAGER_H_
 
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
 #include <string>
+#include <utility>
 
 #include "maidsafe/routing/api_config.h"
+#include "maidsafe/routing/cache_statistics.h"
+#include "maidsafe/routing/cache_store.h"
+#include "maidsafe/routing/handler_guard.h"
+#include "maidsafe/routing/popularity_sketch.h"
 
 namespace maidsafe {
 
@@ -33,24 +42,54 @@ class Message;
 
 class NetworkUtils;
 
+// Cacheable Gets passing through are answered from an in-process store where possible, without
+// involving the upper layer.  A Get is keyed by its destination and request data.  The store holds
+// each response's data already serialised, and shared, so a hit only builds and serialises the
+// small response header.  When one is passed on, it is remembered, so that the response to it can
+// be stored under that key if it comes back through this node and passes validation (see
+// ValidateCacheDataFunctor).
 class CacheManager {
  public:
   CacheManager(NodeId node_id, NetworkUtils& network);
 
   void InitialiseFunctors(MessageReceivedFunctor message_received_functor,
                           StoreCacheDataFunctor store_cache_data);
+  void set_validate_cache_data_functor(ValidateCacheDataFunctor validate_cache_data);
+  // Stores the response to a Get this node passed on, or hands a cacheable Put to the upper layer.
+  // Either is done on the asio service rather than the calling thread.
   void AddToCache(const protobuf::Message& message);
+  // Replies from the store on a hit.  On a miss, it asks the upper layer if it provided a functor,
+  // and otherwise passes the request on.
   void HandleGetFromCache(protobuf::Message& message);
+  CacheStatistics statistics() const;
+  // Estimated number of recent Gets for |request_data| at |destination_id|.
+  uint32_t EstimatedGetCount(const NodeId& destination_id, const std::string& request_data) const;
 
  private:
+  typedef std::pair<std::string, int32_t> PendingGetId;  // requester and message id
+
   CacheManager(const CacheManager&);
   CacheManager(const CacheManager&&);
   CacheManager& operator=(const CacheManager&);
+  // Everything of the response to |request| except its data.
+  protobuf::Message CachedResponseHeader(const protobuf::Message& request) const;
+  void AddPendingGet(const protobuf::Message& request, std::string key);
+  // Whether the response |data| to the Get stored under |key| may be cached.
+  bool IsValidCacheData(const std::string& key, const std::string& data) const;
 
   const NodeId kNodeId_;
   NetworkUtils& network_;
   MessageReceivedFunctor message_received_functor_;
   StoreCacheDataFunctor store_cache_data_;
+  ValidateCacheDataFunctor validate_cache_data_;
+  mutable std::mutex mutex_;
+  CacheStore store_;
+  PopularitySketch popularity_;
+  CacheStatistics statistics_;
+  std::map<PendingGetId, std::string> pending_gets_;
+  std::deque<PendingGetId> pending_get_order_;  // oldest first, for bounding pending_gets_
+  // Last, so that stores posted to a shared asio service don't outlive the rest.
+  HandlerGuard handler_guard_;
 };
 
 }  // namespace routing
@@ -0,0 +1,102 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/cache_store.h"
+
+#include <iterator>
+#include <utility>
+
+namespace maidsafe {
+
+namespace routing {
+
+CacheStore::CacheStore(size_t max_bytes, size_t max_entries)
+    : kMaxBytes_(max_bytes),
+      kMaxEntries_(max_entries),
+      kMaxProtectedBytes_(max_bytes / 5 * 4),
+      probation_(),
+      protected_(),
+      index_(),
+      probation_bytes_(0),
+      protected_bytes_(0) {}
+
+std::shared_ptr<const std::string> CacheStore::Get(const std::string& key) {
+  auto found(index_.find(key));
+  if (found == std::end(index_))
+    return nullptr;
+  auto value(found->second->value);
+  Promote(found->second);
+  return value;
+}
+
+void CacheStore::Put(const std::string& key, std::shared_ptr<const std::string> value) {
+  if (!value || key.size() + value->size() > kMaxBytes_ || kMaxEntries_ == 0)
+    return;
+  auto found(index_.find(key));
+  if (found != std::end(index_)) {
+    Entry& entry(*found->second);
+    size_t& segment_bytes(entry.is_protected ? protected_bytes_ : probation_bytes_);
+    segment_bytes -= Cost(entry);
+    entry.value = std::move(value);
+    segment_bytes += Cost(entry);
+    Promote(found->second);
+  } else {
+    Entry entry;
+    entry.key = key;
+    entry.value = std::move(value);
+    entry.is_protected = false;
+    probation_bytes_ += Cost(entry);
+    probation_.push_front(std::move(entry));
+    index_.insert(std::make_pair(key, probation_.begin()));
+  }
+  Trim();
+}
+
+// Splicing keeps the iterators held in index_ valid.
+void CacheStore::Promote(Segment::iterator entry) {
+  if (entry->is_protected) {
+    protected_.splice(protected_.begin(), protected_, entry);
+    return;
+  }
+  probation_bytes_ -= Cost(*entry);
+  protected_bytes_ += Cost(*entry);
+  entry->is_protected = true;
+  protected_.splice(protected_.begin(), probation_, entry);
+  Trim();
+}
+
+void CacheStore::Trim() {
+  while (protected_bytes_ > kMaxProtectedBytes_ && protected_.size() > 1) {
+    auto demoted(std::prev(protected_.end()));
+    demoted->is_protected = false;
+    protected_bytes_ -= Cost(*demoted);
+    probation_bytes_ += Cost(*demoted);
+    probation_.splice(probation_.begin(), protected_, demoted);
+  }
+  while (bytes() > kMaxBytes_ || index_.size() > kMaxEntries_) {
+    Segment& segment(probation_.empty() ? protected_ : probation_);
+    auto evicted(std::prev(segment.end()));
+    (evicted->is_protected ? protected_bytes_ : probation_bytes_) -= Cost(*evicted);
+    index_.erase(evicted->key);
+    segment.erase(evicted);
+  }
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,69 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_CACHE_STORE_H_
+#define MAIDSAFE_ROUTING_CACHE_STORE_H_
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace maidsafe {
+
+namespace routing {
+
+// Byte-bounded segmented LRU.  New entries start in a probationary segment and are promoted to a
+// protected segment, holding up to 80% of the capacity, the first time they are hit again.  Only
+// probationary entries are evicted while any remain, so a burst of one-off entries can't flush out
+// popular ones.  Not thread-safe.
+class CacheStore {
+ public:
+  CacheStore(size_t max_bytes, size_t max_entries);
+  // Returns nullptr on a miss.
+  std::shared_ptr<const std::string> Get(const std::string& key);
+  // Entries bigger than the whole capacity are not admitted.
+  void Put(const std::string& key, std::shared_ptr<const std::string> value);
+  size_t size() const { return index_.size(); }
+  size_t bytes() const { return probation_bytes_ + protected_bytes_; }
+
+ private:
+  struct Entry {
+    std::string key;
+    std::shared_ptr<const std::string> value;
+    bool is_protected;
+  };
+  typedef std::list<Entry> Segment;
+
+  CacheStore(const CacheStore&);
+  CacheStore& operator=(const CacheStore&);
+  static size_t Cost(const Entry& entry) { return entry.key.size() + entry.value->size(); }
+  void Promote(Segment::iterator entry);
+  void Trim();
+
+  const size_t kMaxBytes_, kMaxEntries_, kMaxProtectedBytes_;
+  Segment probation_, protected_;  // most recently used first
+  std::unordered_map<std::string, Segment::iterator> index_;
+  size_t probation_bytes_, protected_bytes_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_CACHE_STORE_H_
@@ -0,0 +1,95 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/change_batcher.h"
+
+#include <utility>
+
+#include "maidsafe/routing/matrix_change.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+ChangeBatcher::ChangeBatcher()
+    : mutex_(),
+      has_network_status_(false),
+      network_status_(0),
+      first_matrix_change_(),
+      last_matrix_change_(),
+      remove_furthest_node_(false) {}
+
+bool ChangeBatcher::AddNetworkStatus(int network_status) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  bool was_pending(Pending());
+  has_network_status_ = true;
+  network_status_ = network_status;
+  return !was_pending;
+}
+
+bool ChangeBatcher::AddMatrixChange(std::shared_ptr<MatrixChange> matrix_change) {
+  if (!matrix_change)
+    return false;
+  std::lock_guard<std::mutex> lock(mutex_);
+  bool was_pending(Pending());
+  if (!first_matrix_change_)
+    first_matrix_change_ = matrix_change;
+  last_matrix_change_ = matrix_change;
+  return !was_pending;
+}
+
+bool ChangeBatcher::AddRemoveFurthestNode() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  bool was_pending(Pending());
+  remove_furthest_node_ = true;
+  return !was_pending;
+}
+
+ChangeBatcher::Batch ChangeBatcher::Take() {
+  Batch batch;
+  std::shared_ptr<MatrixChange> first_matrix_change, last_matrix_change;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    batch.has_network_status = has_network_status_;
+    batch.network_status = network_status_;
+    batch.remove_furthest_node = remove_furthest_node_;
+    first_matrix_change.swap(first_matrix_change_);
+    last_matrix_change.swap(last_matrix_change_);
+    has_network_status_ = false;
+    remove_furthest_node_ = false;
+  }
+  if (first_matrix_change == last_matrix_change) {
+    batch.matrix_change = first_matrix_change;
+  } else {
+    std::shared_ptr<MatrixChange> matrix_change(
+        new MatrixChange(first_matrix_change->node_id_, first_matrix_change->old_members_,
+                         last_matrix_change->new_members_));
+    matrix_change->epoch_ = last_matrix_change->epoch_;
+    if (!matrix_change->OldEqualsToNew())
+      batch.matrix_change = std::move(matrix_change);
+  }
+  return batch;
+}
+
+bool ChangeBatcher::Pending() const {
+  return has_network_status_ || first_matrix_change_ || remove_furthest_node_;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,72 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_CHANGE_BATCHER_H_
+#define MAIDSAFE_ROUTING_CHANGE_BATCHER_H_
+
+#include <memory>
+#include <mutex>
+
+#include "maidsafe/routing/api_config.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+class MatrixChange;
+
+// Collects the effects of routing table changes made between two deliveries to the functors that
+// act on them, so that a burst of adds or drops is acted on once rather than once per change.
+// Each Add returns true if nothing was pending before it, i.e. if a delivery needs scheduling.
+class ChangeBatcher {
+ public:
+  struct Batch {
+    Batch() : has_network_status(false), network_status(0), matrix_change(),
+              remove_furthest_node(false) {}
+    bool has_network_status;
+    int network_status;  // the latest
+    // From the first queued change's old matrix to the last one's new matrix; null if the queued
+    // changes cancel out.
+    std::shared_ptr<MatrixChange> matrix_change;
+    bool remove_furthest_node;
+  };
+
+  ChangeBatcher();
+  bool AddNetworkStatus(int network_status);
+  bool AddMatrixChange(std::shared_ptr<MatrixChange> matrix_change);
+  bool AddRemoveFurthestNode();
+  // Returns and clears what is pending.
+  Batch Take();
+
+ private:
+  ChangeBatcher(const ChangeBatcher&);
+  ChangeBatcher& operator=(const ChangeBatcher&);
+  bool Pending() const;
+
+  std::mutex mutex_;
+  bool has_network_status_;
+  int network_status_;
+  std::shared_ptr<MatrixChange> first_matrix_change_, last_matrix_change_;
+  bool remove_furthest_node_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_CHANGE_BATCHER_H_
@@ -33,8 +33,12 @@ typedef boost::asio::ip::udp::endpoint Endpoint;
 
 }  // unnamed namespace
 
-ClientRoutingTable::ClientRoutingTable(NodeId node_id)
-    : kNodeId_(std::move(node_id)), nodes_(), mutex_() {}
+ClientRoutingTable::ClientRoutingTable(NodeId node_id, const InstanceParameters& parameters)
+    : kNodeId_(std::move(node_id)),
+      kMaxSize_(parameters.max_client_routing_table_size),
+      nodes_(),
+      connections_(),
+      mutex_() {}
 
 bool ClientRoutingTable::AddNode(NodeInfo& node, const NodeId& furthest_close_node_id) {
   return AddOrCheckNode(node, furthest_close_node_id, true);
@@ -51,7 +55,8 @@ bool ClientRoutingTable::AddOrCheckNode(NodeInfo& node, const NodeId& furthest_c
   std::lock_guard<std::mutex> lock(mutex_);
   if (CheckRangeForNodeToBeAdded(node, furthest_close_node_id, add)) {
     if (add) {
-      nodes_.push_back(node);
+      nodes_.insert(std::make_pair(node.connection_id, node));
+      connections_.insert(std::make_pair(node.node_id, node.connection_id));
       LOG(kInfo) << "Added to ClientRoutingTable :" << DebugId(node.node_id);
       LOG(kVerbose) << PrintClientRoutingTable();
     }
@@ -63,25 +68,29 @@ bool ClientRoutingTable::AddOrCheckNode(NodeInfo& node, const NodeId& furthest_c
 std::vector<NodeInfo> ClientRoutingTable::DropNodes(const NodeId& node_to_drop) {
   std::vector<NodeInfo> nodes_info;
   std::lock_guard<std::mutex> lock(mutex_);
-  uint16_t i(0);
-  while (i < nodes_.size()) {
-    if (nodes_.at(i).node_id == node_to_drop) {
-      nodes_info.push_back(nodes_.at(i));
-      nodes_.erase(nodes_.begin() + i);
-    } else {
-      ++i;
-    }
+  auto range(connections_.equal_range(node_to_drop));
+  for (auto it(range.first); it != range.second; ++it) {
+    auto node(nodes_.find(it->second));
+    assert(node != nodes_.end());
+    nodes_info.push_back(node->second);
+    nodes_.erase(node);
   }
+  connections_.erase(range.first, range.second);
   return nodes_info;
 }
 
 NodeInfo ClientRoutingTable::DropConnection(const NodeId& connection_to_drop) {
   NodeInfo node_info;
   std::lock_guard<std::mutex> lock(mutex_);
-  for (auto it = nodes_.begin(); it != nodes_.end(); ++it) {
-    if ((*it).connection_id == connection_to_drop) {
-      node_info = *it;
-      nodes_.erase(it);
+  auto node(nodes_.find(connection_to_drop));
+  if (node == nodes_.end())
+    return node_info;
+  node_info = node->second;
+  nodes_.erase(node);
+  auto range(connections_.equal_range(node_info.node_id));
+  for (auto it(range.first); it != range.second; ++it) {
+    if (it->second == connection_to_drop) {
+      connections_.erase(it);
       break;
     }
   }
@@ -91,18 +100,15 @@ NodeInfo ClientRoutingTable::DropConnection(const NodeId& connection_to_drop) {
 std::vector<NodeInfo> ClientRoutingTable::GetNodesInfo(const NodeId& node_id) const {
   std::vector<NodeInfo> nodes_info;
   std::lock_guard<std::mutex> lock(mutex_);
-  for (const auto& elem : nodes_) {
-    if ((elem).node_id == node_id)
-      nodes_info.push_back(elem);
-  }
+  auto range(connections_.equal_range(node_id));
+  for (auto it(range.first); it != range.second; ++it)
+    nodes_info.push_back(nodes_.at(it->second));
   return nodes_info;
 }
 
 bool ClientRoutingTable::Contains(const NodeId& node_id) const {
   std::lock_guard<std::mutex> lock(mutex_);
-  return std::find_if(nodes_.begin(), nodes_.end(), [node_id](const NodeInfo & node_info) {
-           return node_info.node_id == node_id;
-         }) != nodes_.end();
+  return connections_.find(node_id) != connections_.end();
 }
 
 bool ClientRoutingTable::IsConnected(const NodeId& node_id) const { return Contains(node_id); }
@@ -124,9 +130,7 @@ bool ClientRoutingTable::CheckValidParameters(const NodeInfo& node) const {
 
 bool ClientRoutingTable::CheckParametersAreUnique(const NodeInfo& node) const {
   // If we already have a duplicate endpoint return false
-  if (std::find_if(nodes_.begin(), nodes_.end(), [node](const NodeInfo & node_info) {
-        return (node_info.connection_id == node.connection_id);
-      }) != nodes_.end()) {
+  if (nodes_.count(node.connection_id) != 0) {
     LOG(kInfo) << "Already have node with this connection_id.";
     return false;
   }
@@ -147,7 +151,7 @@ bool ClientRoutingTable::CheckParametersAreUnique(const NodeInfo& node) const {
 bool ClientRoutingTable::CheckRangeForNodeToBeAdded(NodeInfo& node,
                                                     const NodeId& furthest_close_node_id,
                                                     bool add) const {
-  if (nodes_.size() >= Parameters::max_client_routing_table_size) {
+  if (nodes_.size() >= kMaxSize_) {
     LOG(kInfo) << "ClientRoutingTable full.";
     return false;
   }
@@ -170,12 +174,11 @@ bool ClientRoutingTable::IsThisNodeInRange(const NodeId& node_id,
 }
 
 std::string ClientRoutingTable::PrintClientRoutingTable() {
-  auto rt(nodes_);
   std::string s =
       "\n\n[" + DebugId(kNodeId_) + "] This node's own ClientRoutingTable and peer connections:\n";
-  for (const auto& node : rt) {
-    s += std::string("\tPeer ") + "[" + DebugId(node.node_id) + "]" + "-->";
-    s += DebugId(node.connection_id) + "\n";
+  for (const auto& node : nodes_) {
+    s += std::string("\tPeer ") + "[" + DebugId(node.second.node_id) + "]" + "-->";
+    s += DebugId(node.first) + "\n";
   }
   s += "\n\n";
   return s;
@@ -22,6 +22,7 @@
 #include <cstdint>
 #include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "boost/asio/ip/udp.hpp"
@@ -30,6 +31,8 @@
 #include "maidsafe/common/rsa.h"
 
 #include "maidsafe/routing/api_config.h"
+#include "maidsafe/routing/node_id_hash.h"
+#include "maidsafe/routing/parameters.h"
 
 namespace maidsafe {
 
@@ -51,7 +54,8 @@ class Contact;
 
 class ClientRoutingTable {
  public:
-  explicit ClientRoutingTable(NodeId node_id);
+  explicit ClientRoutingTable(NodeId node_id,
+                              const InstanceParameters& parameters = InstanceParameters());
   bool AddNode(NodeInfo& node, const NodeId& furthest_close_node_id);
   bool CheckNode(NodeInfo& node, const NodeId& furthest_close_node_id);
   std::vector<NodeInfo> DropNodes(const NodeId& node_to_drop);
@@ -80,7 +84,11 @@ class ClientRoutingTable {
   friend class test::BasicClientRoutingTableTest_BEH_IsThisNodeInRange_Test;
 
   const NodeId kNodeId_;
-  std::vector<NodeInfo> nodes_;
+  const uint16_t kMaxSize_;
+  // Keyed by connection_id; a client can hold several connections, so node_id indexes into this
+  // through connections_.
+  std::unordered_map<NodeId, NodeInfo, NodeIdHash> nodes_;
+  std::unordered_multimap<NodeId, NodeId, NodeIdHash> connections_;
   mutable std::mutex mutex_;
 };
 
@@ -0,0 +1,166 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/connection_scheduler.h"
+
+#include <algorithm>
+
+#include "maidsafe/common/log.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+ConnectionScheduler::ConnectionScheduler(AsioService& asio_service, const NodeId& this_node_id,
+                                         size_t max_in_flight, size_t max_queued,
+                                         std::chrono::steady_clock::duration timeout)
+    : asio_service_(asio_service),
+      kNodeId_(this_node_id),
+      kMaxInFlight_(std::max(max_in_flight, static_cast<size_t>(1))),
+      kMaxQueued_(max_queued),
+      kTimeout_(timeout),
+      mutex_(),
+      start_connect_(),
+      queue_(),
+      in_flight_() {}
+
+ConnectionScheduler::~ConnectionScheduler() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& attempt : in_flight_)
+    attempt.second->cancel();
+}
+
+void ConnectionScheduler::set_start_connect_functor(StartConnectFunctor start_connect) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  start_connect_ = start_connect;
+}
+
+bool ConnectionScheduler::Add(const NodeId& peer, uint32_t value) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (in_flight_.count(peer) != 0)
+      return true;
+    auto queued(std::find_if(std::begin(queue_), std::end(queue_),
+                             [&peer](const Candidate& candidate) {
+      return candidate.peer == peer;
+    }));
+    if (queued != std::end(queue_)) {
+      queued->value = std::max(queued->value, value);
+      return true;
+    }
+    Candidate candidate = { peer, value };
+    if (in_flight_.size() >= kMaxInFlight_ && queue_.size() >= kMaxQueued_) {
+      auto worst(std::min_element(std::begin(queue_), std::end(queue_),
+                                  [this](const Candidate& lhs, const Candidate& rhs) {
+        return IsBetter(rhs, lhs);
+      }));
+      if (worst == std::end(queue_) || !IsBetter(candidate, *worst)) {
+        LOG(kVerbose) << "Connect queue full; not queueing " << DebugId(peer);
+        return false;
+      }
+      LOG(kVerbose) << "Connect queue full; dropping " << DebugId(worst->peer);
+      queue_.erase(worst);
+    }
+    queue_.push_back(candidate);
+  }
+  Dispatch();
+  return true;
+}
+
+void ConnectionScheduler::Completed(const NodeId& peer) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto attempt(in_flight_.find(peer));
+    if (attempt == std::end(in_flight_))
+      return;
+    attempt->second->cancel();
+    in_flight_.erase(attempt);
+  }
+  Dispatch();
+}
+
+size_t ConnectionScheduler::queued() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return queue_.size();
+}
+
+size_t ConnectionScheduler::in_flight() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return in_flight_.size();
+}
+
+bool ConnectionScheduler::IsBetter(const Candidate& lhs, const Candidate& rhs) const {
+  if (lhs.value != rhs.value)
+    return lhs.value > rhs.value;
+  return NodeId::CloserToTarget(lhs.peer, rhs.peer, kNodeId_);
+}
+
+void ConnectionScheduler::Dispatch() {
+  std::weak_ptr<ConnectionScheduler> this_weak_ptr(shared_from_this());
+  for (;;) {
+    NodeId peer;
+    StartConnectFunctor start_connect;
+    std::shared_ptr<boost::asio::steady_timer> timer;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!start_connect_ || queue_.empty() || in_flight_.size() >= kMaxInFlight_)
+        return;
+      auto best(std::min_element(std::begin(queue_), std::end(queue_),
+                                 [this](const Candidate& lhs, const Candidate& rhs) {
+        return IsBetter(lhs, rhs);
+      }));
+      peer = best->peer;
+      queue_.erase(best);
+      timer = std::make_shared<boost::asio::steady_timer>(asio_service_.service(), kTimeout_);
+      in_flight_[peer] = timer;
+      start_connect = start_connect_;
+    }
+    timer->async_wait([this_weak_ptr, peer, timer](const boost::system::error_code& error_code) {
+      if (error_code == boost::asio::error::operation_aborted)
+        return;
+      if (std::shared_ptr<ConnectionScheduler> scheduler = this_weak_ptr.lock())
+        scheduler->OnTimeout(peer, timer);
+    });
+    if (!start_connect(peer)) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto attempt(in_flight_.find(peer));
+      if (attempt != std::end(in_flight_) && attempt->second == timer) {
+        timer->cancel();
+        in_flight_.erase(attempt);
+      }
+    }
+  }
+}
+
+void ConnectionScheduler::OnTimeout(const NodeId& peer,
+                                    std::shared_ptr<boost::asio::steady_timer> timer) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto attempt(in_flight_.find(peer));
+    // A later attempt with the same peer has its own timer.
+    if (attempt == std::end(in_flight_) || attempt->second != timer)
+      return;
+    LOG(kVerbose) << "Connect handshake with " << DebugId(peer) << " timed out";
+    in_flight_.erase(attempt);
+  }
+  Dispatch();
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
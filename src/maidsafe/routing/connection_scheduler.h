@@ -0,0 +1,89 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_CONNECTION_SCHEDULER_H_
+#define MAIDSAFE_ROUTING_CONNECTION_SCHEDULER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "boost/asio/steady_timer.hpp"
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/node_id.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// Queues candidate peers for Connect handshakes, keeping at most a fixed number in flight, so that
+// a burst of FindNodes responses doesn't start handshakes with every node named at once.  Queued
+// peers are started highest value first, the one closer to this node winning a tie.  A peer
+// already queued or in flight isn't added again.  A handshake's slot is freed by Completed, or
+// if that isn't called, after a timeout.
+class ConnectionScheduler : public std::enable_shared_from_this<ConnectionScheduler> {
+ public:
+  // Returns false if no handshake could be started, freeing the slot straight away.
+  typedef std::function<bool(const NodeId& /*peer*/)> StartConnectFunctor;
+
+  // At most max_queued peers are held waiting, the lowest valued being dropped for better ones.
+  ConnectionScheduler(AsioService& asio_service, const NodeId& this_node_id, size_t max_in_flight,
+                      size_t max_queued, std::chrono::steady_clock::duration timeout);
+  ~ConnectionScheduler();
+  void set_start_connect_functor(StartConnectFunctor start_connect);
+  // Starts a handshake with peer now if a slot is free.  Returns false if peer was neither queued
+  // nor started.
+  bool Add(const NodeId& peer, uint32_t value);
+  // Frees peer's slot, whether or not the handshake succeeded.
+  void Completed(const NodeId& peer);
+  size_t queued() const;
+  size_t in_flight() const;
+
+ private:
+  struct Candidate {
+    NodeId peer;
+    uint32_t value;
+  };
+
+  ConnectionScheduler(const ConnectionScheduler&);
+  ConnectionScheduler& operator=(const ConnectionScheduler&);
+  bool IsBetter(const Candidate& lhs, const Candidate& rhs) const;
+  // Starts queued handshakes while slots are free.
+  void Dispatch();
+  void OnTimeout(const NodeId& peer, std::shared_ptr<boost::asio::steady_timer> timer);
+
+  AsioService& asio_service_;
+  const NodeId kNodeId_;
+  const size_t kMaxInFlight_, kMaxQueued_;
+  const std::chrono::steady_clock::duration kTimeout_;
+  mutable std::mutex mutex_;
+  StartConnectFunctor start_connect_;
+  std::vector<Candidate> queue_;  // unordered; it's small, so the best is found by a scan
+  std::map<NodeId, std::shared_ptr<boost::asio::steady_timer>> in_flight_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_CONNECTION_SCHEDULER_H_
@@ -0,0 +1,144 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/duplicate_filter.h"
+
+#include <algorithm>
+#include <string>
+
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+const uint64_t kFnvOffsetBasis(14695981039346656037ULL);
+const uint64_t kFnvPrime(1099511628211ULL);
+
+void HashBytes(const std::string& bytes, uint64_t& hash) {
+  for (const auto& byte : bytes) {
+    hash ^= static_cast<unsigned char>(byte);
+    hash *= kFnvPrime;
+  }
+  // Separates adjacent fields, so that moving bytes from one to the next changes the hash.
+  hash ^= bytes.size();
+  hash *= kFnvPrime;
+}
+
+void HashValue(uint64_t value, uint64_t& hash) {
+  for (int shift(0); shift != 64; shift += 8) {
+    hash ^= (value >> shift) & 0xff;
+    hash *= kFnvPrime;
+  }
+}
+
+// Open-addressed tables are sized to a power of two at most half full.
+size_t SlotCount(size_t capacity) {
+  size_t slot_count(2);
+  while (slot_count < capacity * 2)
+    slot_count *= 2;
+  return slot_count;
+}
+
+}  // unnamed namespace
+
+DuplicateFilter::DuplicateFilter(Clock::duration window, size_t capacity)
+    : kHalfWindow_(window / 2),
+      kCapacity_(capacity == 0 ? 1 : capacity),
+      mutex_(),
+      tables_{{Table(SlotCount(kCapacity_)), Table(SlotCount(kCapacity_))}},
+      current_(0) {
+  tables_[0].started = tables_[1].started = Clock::now();
+}
+
+bool DuplicateFilter::IsDuplicate(const protobuf::Message& message) {
+  if (message.id() == 0)
+    return false;
+  const uint64_t kFingerprint(Fingerprint(message));
+  const Clock::time_point kNow(Clock::now());
+  std::lock_guard<std::mutex> lock(mutex_);
+  RotateIfDue(kNow);
+  if (Contains(tables_[0], kFingerprint) || Contains(tables_[1], kFingerprint))
+    return true;
+  if (tables_[current_].size == kCapacity_) {
+    current_ ^= 1;
+    Clear(tables_[current_], kNow);
+  }
+  Insert(tables_[current_], kFingerprint);
+  return false;
+}
+
+uint64_t DuplicateFilter::Fingerprint(const protobuf::Message& message) {
+  uint64_t hash(kFnvOffsetBasis);
+  HashBytes(message.source_id(), hash);
+  HashBytes(message.relay_id(), hash);
+  HashBytes(message.destination_id(), hash);
+  HashValue(static_cast<uint32_t>(message.id()), hash);
+  HashValue(static_cast<uint32_t>(message.type()), hash);
+  // A closest node forwarding a message it can't deliver marks it visited, and that second pass
+  // mustn't be mistaken for a repeat of the first.  Likewise for the direct copies a group leader
+  // sends to the group's members.
+  HashValue((message.request() ? 1U : 0U) | (message.direct() ? 2U : 0U) |
+                (message.visited() ? 4U : 0U),
+            hash);
+  // Spreads the remaining structure across the low bits used to pick a slot.
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  return hash == 0 ? 1 : hash;
+}
+
+bool DuplicateFilter::Contains(const Table& table, uint64_t fingerprint) const {
+  const size_t kMask(table.slots.size() - 1);
+  for (size_t index(fingerprint & kMask); table.slots[index] != 0; index = (index + 1) & kMask) {
+    if (table.slots[index] == fingerprint)
+      return true;
+  }
+  return false;
+}
+
+void DuplicateFilter::Insert(Table& table, uint64_t fingerprint) {
+  const size_t kMask(table.slots.size() - 1);
+  size_t index(fingerprint & kMask);
+  while (table.slots[index] != 0)
+    index = (index + 1) & kMask;
+  table.slots[index] = fingerprint;
+  ++table.size;
+}
+
+void DuplicateFilter::Clear(Table& table, Clock::time_point now) {
+  std::fill(table.slots.begin(), table.slots.end(), 0);
+  table.size = 0;
+  table.started = now;
+}
+
+void DuplicateFilter::RotateIfDue(Clock::time_point now) {
+  if (now - tables_[current_].started < kHalfWindow_)
+    return;
+  // Entries in the other table are at least half a window older still.
+  if (now - tables_[current_].started >= kHalfWindow_ * 2)
+    Clear(tables_[current_], now);
+  current_ ^= 1;
+  Clear(tables_[current_], now);
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
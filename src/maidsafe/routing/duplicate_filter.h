@@ -0,0 +1,81 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_DUPLICATE_FILTER_H_
+#define MAIDSAFE_ROUTING_DUPLICATE_FILTER_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace protobuf {
+class Message;
+}
+
+// Fixed-memory, time-windowed record of received messages, used to drop further copies of a
+// message arriving via retries, group fan-out or rerouting.  A message is identified by a 64-bit
+// fingerprint of its source, relay, destination, ID, type and routing flags.  Fingerprints are
+// held in two open-addressed tables: new ones go in the current table, and when it fills or has
+// been current for half the window, the older table is cleared and becomes current.  Distinct
+// messages with the same header are told apart only by their IDs, which is why routing RPCs take
+// theirs from the full range of rpcs::NewRpcId.
+class DuplicateFilter {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  // Each table holds up to capacity fingerprints.
+  DuplicateFilter(Clock::duration window, size_t capacity);
+  // Returns true if the message has been seen within the window, otherwise records it.  Messages
+  // with no ID can't be told apart, so are never treated as duplicates.
+  bool IsDuplicate(const protobuf::Message& message);
+
+ private:
+  DuplicateFilter(const DuplicateFilter&);
+  DuplicateFilter& operator=(const DuplicateFilter&);
+
+  struct Table {
+    explicit Table(size_t slot_count) : slots(slot_count, 0), size(0), started() {}
+    std::vector<uint64_t> slots;  // zero marks an empty slot
+    size_t size;
+    Clock::time_point started;
+  };
+
+  static uint64_t Fingerprint(const protobuf::Message& message);
+  bool Contains(const Table& table, uint64_t fingerprint) const;
+  void Insert(Table& table, uint64_t fingerprint);
+  void Clear(Table& table, Clock::time_point now);
+  void RotateIfDue(Clock::time_point now);
+
+  const Clock::duration kHalfWindow_;
+  const size_t kCapacity_;
+  std::mutex mutex_;
+  std::array<Table, 2> tables_;
+  size_t current_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_DUPLICATE_FILTER_H_
@@ -0,0 +1,80 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/find_nodes_memo.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+FindNodesMemo::FindNodesMemo(Clock::duration ttl, size_t capacity)
+    : kTtl_(ttl), kCapacity_(capacity), mutex_(), table_version_(0), entries_() {}
+
+bool FindNodesMemo::Get(const NodeId& target, uint32_t count, bool with_contacts,
+                        uint64_t table_version, std::string& serialised_nodes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!MoveToVersion(table_version))
+    return false;
+  auto found(entries_.find(std::make_tuple(target, count, with_contacts)));
+  if (found == entries_.end())
+    return false;
+  if (found->second.expiry <= Clock::now()) {
+    entries_.erase(found);
+    return false;
+  }
+  serialised_nodes = found->second.serialised_nodes;
+  return true;
+}
+
+void FindNodesMemo::Add(const NodeId& target, uint32_t count, bool with_contacts,
+                        uint64_t table_version, const std::string& serialised_nodes) {
+  if (kCapacity_ == 0)
+    return;
+  const Clock::time_point kNow(Clock::now());
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!MoveToVersion(table_version))
+    return;
+  if (entries_.size() >= kCapacity_) {
+    for (auto itr(entries_.begin()); itr != entries_.end();) {
+      if (itr->second.expiry <= kNow)
+        itr = entries_.erase(itr);
+      else
+        ++itr;
+    }
+    // Bursts are of few distinct requests, so a memo still full is better started afresh.
+    if (entries_.size() >= kCapacity_)
+      entries_.clear();
+  }
+  Entry& entry(entries_[std::make_tuple(target, count, with_contacts)]);
+  entry.serialised_nodes = serialised_nodes;
+  entry.expiry = kNow + kTtl_;
+}
+
+bool FindNodesMemo::MoveToVersion(uint64_t table_version) {
+  if (table_version < table_version_)
+    return false;
+  if (table_version > table_version_) {
+    entries_.clear();
+    table_version_ = table_version;
+  }
+  return true;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,77 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_FIND_NODES_MEMO_H_
+#define MAIDSAFE_ROUTING_FIND_NODES_MEMO_H_
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+#include "maidsafe/common/node_id.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// The serialised node lists of recent FindNodes responses, so that a burst of identical requests
+// (as during a join wave or after churn) is answered without repeating the lookup.  Entries are
+// for one routing table version (see RoutingTable::version) and are all dropped once a later one
+// is seen; each also expires after a fixed time.  Lists with contacts (see FindNodesRequest's
+// want_contacts) are held apart from those without.
+class FindNodesMemo {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  // Holds up to capacity node lists, each for at most ttl.
+  FindNodesMemo(Clock::duration ttl, size_t capacity);
+  // Returns false unless a live list for target and count was added at table_version.
+  bool Get(const NodeId& target, uint32_t count, bool with_contacts, uint64_t table_version,
+           std::string& serialised_nodes);
+  // Ignored if table_version is older than that of the lists already held.
+  void Add(const NodeId& target, uint32_t count, bool with_contacts, uint64_t table_version,
+           const std::string& serialised_nodes);
+
+ private:
+  FindNodesMemo(const FindNodesMemo&);
+  FindNodesMemo& operator=(const FindNodesMemo&);
+
+  struct Entry {
+    std::string serialised_nodes;
+    Clock::time_point expiry;
+  };
+  typedef std::tuple<NodeId, uint32_t, bool> Key;
+
+  // Clears entries_ for a newer table_version.  Returns false if table_version is older.
+  bool MoveToVersion(uint64_t table_version);
+
+  const Clock::duration kTtl_;
+  const size_t kCapacity_;
+  std::mutex mutex_;
+  uint64_t table_version_;
+  std::map<Key, Entry> entries_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_FIND_NODES_MEMO_H_
@@ -0,0 +1,136 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/group_cache.h"
+
+#include <algorithm>
+
+#include "maidsafe/routing/matrix_change.h"
+#include "maidsafe/routing/parameters.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+bool IsTouched(const std::vector<NodeId>& group, const NodeId& group_id,
+               const std::vector<NodeId>& lost_nodes, const std::vector<NodeId>& new_nodes) {
+  for (const auto& lost_node : lost_nodes) {
+    if (std::find(group.begin(), group.end(), lost_node) != group.end())
+      return true;
+  }
+  if (new_nodes.empty())
+    return false;
+  // A group short of members takes any new node.
+  if (group.size() < Parameters::group_size)
+    return true;
+  const NodeId& kFurthest(*std::max_element(group.begin(), group.end(),
+                                            [&group_id](const NodeId& lhs, const NodeId& rhs) {
+                                              return NodeId::CloserToTarget(lhs, rhs, group_id);
+                                            }));
+  for (const auto& new_node : new_nodes) {
+    if (NodeId::CloserToTarget(new_node, kFurthest, group_id))
+      return true;
+  }
+  return false;
+}
+
+}  // unnamed namespace
+
+GroupCache::GroupCache(Clock::duration ttl, size_t capacity)
+    : kTtl_(ttl), kCapacity_(capacity), mutex_(), entries_(), index_() {}
+
+bool GroupCache::Get(const NodeId& group_id, std::vector<NodeId>& group) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto entry(Find(group_id));
+  if (entry == entries_.end())
+    return false;
+  group = entry->group;
+  return true;
+}
+
+bool GroupCache::GetLeader(const NodeId& group_id, NodeId& leader) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto entry(Find(group_id));
+  if (entry == entries_.end() || entry->leader.IsZero())
+    return false;
+  leader = entry->leader;
+  return true;
+}
+
+void GroupCache::Add(const NodeId& group_id, const std::vector<NodeId>& group,
+                     const NodeId& leader) {
+  if (kCapacity_ == 0 || group.empty())
+    return;
+  const Clock::time_point kNow(Clock::now());
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found(index_.find(group_id));
+  if (found != index_.end())
+    Erase(found->second);
+  else if (entries_.size() >= kCapacity_)
+    Erase(std::prev(entries_.end()));
+  Entry entry;
+  entry.group_id = group_id;
+  entry.group = group;
+  entry.leader = leader;
+  entry.expiry = kNow + kTtl_;
+  entries_.push_front(std::move(entry));
+  index_[group_id] = entries_.begin();
+}
+
+void GroupCache::Invalidate(const MatrixChange& matrix_change) {
+  const std::vector<NodeId> kLostNodes(matrix_change.lost_nodes());
+  const std::vector<NodeId> kNewNodes(matrix_change.new_nodes());
+  if (kLostNodes.empty() && kNewNodes.empty())
+    return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto itr(entries_.begin()); itr != entries_.end();) {
+    auto entry(itr++);
+    if (IsTouched(entry->group, entry->group_id, kLostNodes, kNewNodes))
+      Erase(entry);
+  }
+}
+
+void GroupCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  index_.clear();
+  entries_.clear();
+}
+
+GroupCache::EntryItr GroupCache::Find(const NodeId& group_id) {
+  auto found(index_.find(group_id));
+  if (found == index_.end())
+    return entries_.end();
+  EntryItr entry(found->second);
+  if (entry->expiry <= Clock::now()) {
+    Erase(entry);
+    return entries_.end();
+  }
+  entries_.splice(entries_.begin(), entries_, entry);
+  return entry;
+}
+
+void GroupCache::Erase(EntryItr entry) {
+  index_.erase(entry->group_id);
+  entries_.erase(entry);
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,85 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_GROUP_CACHE_H_
+#define MAIDSAFE_ROUTING_GROUP_CACHE_H_
+
+#include <chrono>
+#include <list>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+class MatrixChange;
+
+// Recently resolved far groups, so that repeated GetGroup calls for the same group needn't each go
+// out over the network, along with the node which answered for the group (its leader) where known.
+// Entries expire after a fixed time, the least recently used being dropped first when full.  A
+// matrix change drops only the entries whose membership it could have changed.
+class GroupCache {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  // Holds up to capacity groups, each for at most ttl.
+  GroupCache(Clock::duration ttl, size_t capacity);
+  // Returns false if group_id isn't cached or has expired.
+  bool Get(const NodeId& group_id, std::vector<NodeId>& group);
+  // Returns false if group_id isn't cached with a leader or has expired.
+  bool GetLeader(const NodeId& group_id, NodeId& leader);
+  // leader may be left zero if unknown.
+  void Add(const NodeId& group_id, const std::vector<NodeId>& group,
+           const NodeId& leader = NodeId());
+  // Drops the groups with a lost node as a member, or which a new node would be closer to than
+  // their furthest member.
+  void Invalidate(const MatrixChange& matrix_change);
+  void Clear();
+
+ private:
+  GroupCache(const GroupCache&);
+  GroupCache& operator=(const GroupCache&);
+
+  struct Entry {
+    NodeId group_id;
+    std::vector<NodeId> group;
+    NodeId leader;
+    Clock::time_point expiry;
+  };
+  typedef std::list<Entry>::iterator EntryItr;
+
+  // Returns a live entry for group_id, moved to the front, or entries_.end().
+  EntryItr Find(const NodeId& group_id);
+  void Erase(EntryItr entry);
+
+  const Clock::duration kTtl_;
+  const size_t kCapacity_;
+  std::mutex mutex_;
+  std::list<Entry> entries_;  // most recently used first
+  std::map<NodeId, EntryItr> index_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_GROUP_CACHE_H_
@@ -18,7 +18,9 @@
 
 #include "maidsafe/routing/group_change_handler.h"
 
+#include <set>
 #include <string>
+#include <utility>
 #include <vector>
 #include <algorithm>
 
@@ -27,7 +29,9 @@
 #include "maidsafe/common/utils.h"
 
 #include "maidsafe/routing/client_routing_table.h"
+#include "maidsafe/routing/group_matrix.h"
 #include "maidsafe/routing/message_handler.h"
+#include "maidsafe/routing/network_utils.h"
 #include "maidsafe/routing/routing.pb.h"
 #include "maidsafe/routing/routing_table.h"
 #include "maidsafe/routing/rpcs.h"
@@ -42,7 +46,14 @@ GroupChangeHandler::GroupChangeHandler(RoutingTable& routing_table,
                                        NetworkUtils& network)
     : routing_table_(routing_table),
       client_routing_table_(client_routing_table),
-      network_(network) {}
+      network_(network),
+      mutex_(),
+      update_queued_(false),
+      queued_closest_nodes_(),
+      queued_old_closest_nodes_(),
+      sent_version_(0),
+      sent_closest_nodes_(),
+      synced_subscribers_() {}
 
 GroupChangeHandler::~GroupChangeHandler() {}
 
@@ -66,6 +77,24 @@ std::pair<NodeId, std::vector<NodeInfo>> GroupChangeHandler::ClosestNodesUpdate(
     return matrix_update_pair;
   }
 
+  if (closest_node_update.has_digest()) {
+    // Digests are only ever sent to vaults.
+    if (routing_table_.client_mode())
+      message.Clear();
+    else
+      CheckRowDigest(closest_node_update, message);
+    return matrix_update_pair;
+  }
+
+  if (closest_node_update.has_base_version()) {
+    // Deltas are only ever sent to vaults.
+    if (routing_table_.client_mode())
+      message.Clear();
+    else
+      ApplyClosestNodesUpdateDelta(closest_node_update, message);
+    return matrix_update_pair;
+  }
+
   std::vector<NodeInfo> closest_nodes;
   NodeInfo node_info;
   for (const auto& basic_info : closest_node_update.nodes_info()) {
@@ -78,18 +107,131 @@ std::pair<NodeId, std::vector<NodeInfo>> GroupChangeHandler::ClosestNodesUpdate(
   assert(!closest_nodes.empty());
   if (!routing_table_.client_mode())
     message.Clear();
-  if (!UpdateGroupChange(NodeId(closest_node_update.node()), closest_nodes))
+  if (!UpdateGroupChange(NodeId(closest_node_update.node()), closest_nodes,
+                         closest_node_update.version()))
     return matrix_update_pair;
   return std::pair<NodeId, std::vector<NodeInfo>>(NodeId(closest_node_update.node()),
                                                   closest_nodes);
 }
 
+void GroupChangeHandler::ApplyClosestNodesUpdateDelta(
+    const protobuf::ClosestNodesUpdate& closest_node_update, protobuf::Message& message) {
+  NodeId peer(closest_node_update.node());
+  std::vector<NodeInfo> added_nodes;
+  NodeInfo node_info;
+  for (const auto& basic_info : closest_node_update.nodes_info()) {
+    if (CheckId(basic_info.node_id())) {
+      node_info.node_id = NodeId(basic_info.node_id());
+      node_info.rank = basic_info.rank();
+      added_nodes.push_back(node_info);
+    }
+  }
+  std::vector<NodeId> removed_nodes;
+  for (const auto& removed_node : closest_node_update.removed_nodes()) {
+    if (CheckId(removed_node))
+      removed_nodes.push_back(NodeId(removed_node));
+  }
+  if (routing_table_.GroupDeltaFromConnectedPeer(peer, added_nodes, removed_nodes,
+                                                 closest_node_update.base_version(),
+                                                 closest_node_update.version())) {
+    message.Clear();
+    return;
+  }
+  LOG(kVerbose) << DebugId(routing_table_.kNodeId()) << " can't apply delta "
+                << closest_node_update.base_version() << " -> " << closest_node_update.version()
+                << " from " << DebugId(peer) << ", requesting full update";
+  RequestFullRow(message);
+}
+
+void GroupChangeHandler::CheckRowDigest(const protobuf::ClosestNodesUpdate& closest_node_update,
+                                        protobuf::Message& message) {
+  NodeId peer(closest_node_update.node());
+  if (!routing_table_.Contains(peer) ||
+      routing_table_.GroupRowMatchesDigest(peer, closest_node_update.version(),
+                                           closest_node_update.digest())) {
+    message.Clear();
+    return;
+  }
+  LOG(kVerbose) << DebugId(routing_table_.kNodeId()) << " holds a stale row for "
+                << DebugId(peer) << " at version " << closest_node_update.version()
+                << ", requesting full update";
+  RequestFullRow(message);
+}
+
+void GroupChangeHandler::RequestFullRow(protobuf::Message& message) {
+  // Reply so that the peer resends its full row.
+  protobuf::ClosestNodesUpdate resync_request;
+  resync_request.set_node(routing_table_.kNodeId().string());
+  message.set_request(false);
+  message.clear_route_history();
+  message.clear_data();
+  message.add_data(resync_request.SerializeAsString());
+  message.set_destination_id(message.source_id());
+  message.set_source_id(routing_table_.kNodeId().string());
+  message.set_hops_to_live(Parameters::hops_to_live);
+  assert(message.IsInitialized() && "unintialised message");
+}
+
+void GroupChangeHandler::ResendClosestNodesUpdate(protobuf::Message& message) {
+  protobuf::ClosestNodesUpdate resync_request;
+  NodeInfo subscriber;
+  if (message.destination_id() != routing_table_.kNodeId().string() ||
+      !resync_request.ParseFromString(message.data(0)) || !CheckId(resync_request.node()) ||
+      !routing_table_.GetNodeInfo(NodeId(resync_request.node()), subscriber)) {
+    message.Clear();
+    return;
+  }
+  message.Clear();
+  std::vector<NodeInfo> closest_nodes;
+  uint32_t version(0);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (sent_version_ == 0)
+      return;
+    closest_nodes = sent_closest_nodes_;
+    version = sent_version_;
+  }
+  LOG(kVerbose) << "[" << DebugId(routing_table_.kNodeId())
+                << "] Resending full update to: " << DebugId(subscriber.node_id);
+  network_.SendToDirect(
+      rpcs::ClosestNodesUpdate(subscriber.node_id, routing_table_.kNodeId(), closest_nodes,
+                               version),
+      subscriber.node_id, subscriber.connection_id);
+}
+
+void GroupChangeHandler::SendRowDigests() {
+  std::vector<NodeId> subscribers;
+  uint32_t version(0);
+  uint64_t digest(0);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (sent_version_ == 0)
+      return;
+    subscribers.assign(std::begin(synced_subscribers_), std::end(synced_subscribers_));
+    version = sent_version_;
+    digest = GroupMatrix::RowDigest(sent_closest_nodes_);
+  }
+  std::vector<NodeInfo> connected_subscribers;
+  NodeInfo subscriber;
+  for (const auto& node_id : subscribers) {
+    if (routing_table_.GetNodeInfo(node_id, subscriber))
+      connected_subscribers.push_back(subscriber);
+  }
+  if (connected_subscribers.empty())
+    return;
+  SendBatch batch;
+  batch.Add(rpcs::ClosestNodesUpdateDigest(routing_table_.kNodeId(), routing_table_.kNodeId(),
+                                           version, digest),
+            connected_subscribers);
+  network_.Send(std::move(batch));
+}
+
 bool GroupChangeHandler::UpdateGroupChange(const NodeId& node_id,
-                                           std::vector<NodeInfo> close_nodes) {
+                                           std::vector<NodeInfo> close_nodes, uint32_t version) {
   if (routing_table_.Contains(node_id)) {
     LOG(kVerbose) << DebugId(routing_table_.kNodeId()) << " UpdateGroupChange for "
                   << DebugId(node_id) << " size of update: " << close_nodes.size();
-    routing_table_.GroupUpdateFromConnectedPeer(node_id, close_nodes);
+    routing_table_.GroupUpdateFromConnectedPeer(node_id, close_nodes, version);
     return true;
   } else {
     LOG(kVerbose) << DebugId(routing_table_.kNodeId()) << "UpdateGroupChange for failed"
@@ -123,26 +265,92 @@ void GroupChangeHandler::SendClosestNodesUpdateRpcs(
 
   LOG(kVerbose) << "[" << DebugId(routing_table_.kNodeId())
                 << "] SendClosestNodesUpdateRpcs: " << closest_nodes.size();
-  std::vector<NodeInfo> update_subscribers(closest_nodes);
+  std::vector<NodeInfo> vault_subscribers(closest_nodes);
+  vault_subscribers.insert(std::end(vault_subscribers), std::begin(old_closest_nodes),
+                           std::end(old_closest_nodes));
+  std::vector<NodeInfo> added_nodes;
+  std::vector<NodeId> removed_nodes;
+  std::set<NodeId> previous_subscribers;
+  uint32_t base_version(0), version(0);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& node_info : closest_nodes) {
+      if (std::find_if(std::begin(sent_closest_nodes_), std::end(sent_closest_nodes_),
+                       [&node_info](const NodeInfo& sent) {
+                         return sent.node_id == node_info.node_id && sent.rank == node_info.rank;
+                       }) == std::end(sent_closest_nodes_))
+        added_nodes.push_back(node_info);
+    }
+    for (const auto& sent : sent_closest_nodes_) {
+      if (std::find_if(std::begin(closest_nodes), std::end(closest_nodes),
+                       [&sent](const NodeInfo& node_info) {
+                         return node_info.node_id == sent.node_id;
+                       }) == std::end(closest_nodes))
+        removed_nodes.push_back(sent.node_id);
+    }
+    base_version = sent_version_;
+    version = ++sent_version_;
+    sent_closest_nodes_ = closest_nodes;
+    previous_subscribers.swap(synced_subscribers_);
+    for (const auto& subscriber : vault_subscribers)
+      synced_subscribers_.insert(subscriber.node_id);
+  }
+
+  // Vaults which were sent the previous version get only the difference from it; anyone else, and
+  // clients, get the full list.  Each version is serialised once and sent in one batch, with only
+  // the destination rewritten per send.
+  protobuf::Message full_update(rpcs::ClosestNodesUpdate(kNodeId, kNodeId, closest_nodes, version));
+  protobuf::Message delta_update;
+  if (base_version != 0) {
+    delta_update = rpcs::ClosestNodesUpdateDelta(kNodeId, kNodeId, added_nodes, removed_nodes,
+                                                 base_version, version);
+  }
+  std::vector<NodeInfo> delta_subscribers, full_subscribers;
+  for (const auto& update_subscriber : vault_subscribers) {
+    bool use_delta(base_version != 0 && previous_subscribers.count(update_subscriber.node_id) &&
+                   delta_update.data(0).size() < full_update.data(0).size());
+    (use_delta ? delta_subscribers : full_subscribers).push_back(update_subscriber);
+  }
   // clients are also notified of changes in connected close nodes
   for (const auto& client : client_routing_table_.nodes_)
-    update_subscribers.push_back(client);
-  for (const auto& update_subscriber : update_subscribers) {
-    LOG(kVerbose) << "[" << DebugId(routing_table_.kNodeId())
-                  << "] Sending update to: " << DebugId(update_subscriber.node_id);
-    protobuf::Message closest_nodes_update_rpc(rpcs::ClosestNodesUpdate(
-        update_subscriber.node_id, routing_table_.kNodeId(), closest_nodes));
-    network_.SendToDirect(closest_nodes_update_rpc, update_subscriber.node_id,
-                          update_subscriber.connection_id);
-  }
+    full_subscribers.push_back(client.second);
+  LOG(kVerbose) << "[" << DebugId(routing_table_.kNodeId()) << "] Sending update to "
+                << full_subscribers.size() << " in full and " << delta_subscribers.size()
+                << " as a delta";
+  SendBatch batch;
+  batch.Add(full_update, full_subscribers);
+  batch.Add(delta_update, delta_subscribers);
+  network_.Send(std::move(batch));
+}
+
+bool GroupChangeHandler::QueueClosestNodesUpdate(const std::vector<NodeInfo>& closest_nodes,
+                                                 const std::vector<NodeInfo>& old_closest_nodes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  queued_closest_nodes_ = closest_nodes;
   for (const auto& old_closest_node : old_closest_nodes) {
-    LOG(kVerbose) << "[" << DebugId(routing_table_.kNodeId())
-                  << "] Sending update to: " << DebugId(old_closest_node.node_id);
-    protobuf::Message closest_nodes_update_rpc(rpcs::ClosestNodesUpdate(
-        old_closest_node.node_id, routing_table_.kNodeId(), closest_nodes));
-    network_.SendToDirect(closest_nodes_update_rpc, old_closest_node.node_id,
-                          old_closest_node.connection_id);
+    if (std::find_if(std::begin(queued_old_closest_nodes_), std::end(queued_old_closest_nodes_),
+                     [&old_closest_node](const NodeInfo& node_info) {
+                       return node_info.node_id == old_closest_node.node_id;
+                     }) == std::end(queued_old_closest_nodes_))
+      queued_old_closest_nodes_.push_back(old_closest_node);
+  }
+  if (update_queued_)
+    return false;
+  update_queued_ = true;
+  return true;
+}
+
+void GroupChangeHandler::SendQueuedClosestNodesUpdate() {
+  std::vector<NodeInfo> closest_nodes, old_closest_nodes;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!update_queued_)
+      return;
+    update_queued_ = false;
+    closest_nodes.swap(queued_closest_nodes_);
+    old_closest_nodes.swap(queued_old_closest_nodes_);
   }
+  SendClosestNodesUpdateRpcs(closest_nodes, old_closest_nodes);
 }
 bool GroupChangeHandler::GetNodeInfo(const NodeId& node_id, const NodeId& connection_id,
                                      NodeInfo& out_node_info) {
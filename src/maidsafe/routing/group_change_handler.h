@@ -19,6 +19,9 @@
 #ifndef MAIDSAFE_ROUTING_GROUP_CHANGE_HANDLER_H_
 #define MAIDSAFE_ROUTING_GROUP_CHANGE_HANDLER_H_
 
+#include <cstdint>
+#include <mutex>
+#include <set>
 #include <vector>
 #include <utility>
 
@@ -41,6 +44,7 @@ class ClientRoutingTable;
 
 namespace protobuf {
 class Message;
+class ClosestNodesUpdate;
 }
 
 class GroupChangeHandler {
@@ -50,8 +54,20 @@ class GroupChangeHandler {
   ~GroupChangeHandler();
   void SendClosestNodesUpdateRpcs(std::vector<NodeInfo> closest_nodes,
                                   std::vector<NodeInfo> old_closest_nodes);
-  bool UpdateGroupChange(const NodeId& node_id, std::vector<NodeInfo> close_nodes);
+  // Coalesces close group changes: only the latest closest_nodes are kept, while old closest nodes
+  // accumulate until SendQueuedClosestNodesUpdate.  Returns true if no update was already queued,
+  // in which case the caller is responsible for scheduling the send.
+  bool QueueClosestNodesUpdate(const std::vector<NodeInfo>& closest_nodes,
+                               const std::vector<NodeInfo>& old_closest_nodes);
+  void SendQueuedClosestNodesUpdate();
+  bool UpdateGroupChange(const NodeId& node_id, std::vector<NodeInfo> close_nodes,
+                         uint32_t version = 0);
   std::pair<NodeId, std::vector<NodeInfo>> ClosestNodesUpdate(protobuf::Message& message);
+  // Handles a subscriber's reply saying it couldn't apply our last delta.
+  void ResendClosestNodesUpdate(protobuf::Message& message);
+  // Sends a digest of the last round's row to each vault it went to, in place of the row itself.
+  // A vault holding something else asks for the row in full, as for a delta it can't apply.
+  void SendRowDigests();
   void SendSubscribeRpc(bool subscribe, const NodeInfo& node_info);
 
   friend class test::GenericNode;
@@ -62,10 +78,25 @@ class GroupChangeHandler {
 
   void Subscribe(const NodeId& node_id, const NodeId& connection_id);
   bool GetNodeInfo(const NodeId& node_id, const NodeId& connection_id, NodeInfo& out_node_info);
+  // Applies a delta update, or turns message into a reply requesting the full row.
+  void ApplyClosestNodesUpdateDelta(const protobuf::ClosestNodesUpdate& closest_node_update,
+                                    protobuf::Message& message);
+  // Requests the full row if what is held for the sender of a digest differs from it.
+  void CheckRowDigest(const protobuf::ClosestNodesUpdate& closest_node_update,
+                      protobuf::Message& message);
+  // Turns message into a reply asking its sender to resend its full row.
+  void RequestFullRow(protobuf::Message& message);
 
   RoutingTable& routing_table_;
   ClientRoutingTable& client_routing_table_;
   NetworkUtils& network_;
+  std::mutex mutex_;
+  bool update_queued_;
+  std::vector<NodeInfo> queued_closest_nodes_, queued_old_closest_nodes_;
+  // What the last round of updates sent, and to which vaults, so the next can be a delta on it.
+  uint32_t sent_version_;
+  std::vector<NodeInfo> sent_closest_nodes_;
+  std::set<NodeId> synced_subscribers_;
 };
 
 }  // namespace routing
@@ -21,7 +21,6 @@
 #include <algorithm>
 #include <bitset>
 #include <cstdint>
-#include <set>
 
 #include "maidsafe/common/log.h"
 
@@ -29,64 +28,90 @@
 #include "maidsafe/routing/node_info.h"
 #include "maidsafe/routing/return_codes.h"
 #include "maidsafe/routing/utils.h"
+#include "maidsafe/routing/xor_distance.h"
 
 namespace maidsafe {
 
 namespace routing {
 
+namespace {
+
+const uint64_t kFnvOffsetBasis(14695981039346656037ULL);
+const uint64_t kFnvPrime(1099511628211ULL);
+
+uint64_t DigestOf(std::vector<std::string> ids) {
+  std::sort(std::begin(ids), std::end(ids));
+  uint64_t digest(kFnvOffsetBasis);
+  for (const auto& id : ids) {
+    for (const auto& byte : id) {
+      digest ^= static_cast<unsigned char>(byte);
+      digest *= kFnvPrime;
+    }
+  }
+  return digest;
+}
+
+}  // unnamed namespace
+
 GroupMatrix::GroupMatrix(const NodeId& this_node_id, bool client_mode)
     : kNodeId_(this_node_id),
       unique_nodes_(),
-      radius_(crypto::BigInt::Zero()),
+      unique_node_ids_(),
+      row_heads_(),
+      members_(std::make_shared<const MatrixMembers>()),
+      nodes_(std::make_shared<const MatrixNodes>()),
+      members_changed_(false),
+      radius_(),
       client_mode_(client_mode),
-      matrix_() {
-  UpdateUniqueNodeList();
+      group_range_(),
+      matrix_(),
+      connected_peers_(),
+      row_versions_() {
+  if (!client_mode_) {
+    NodeInfo node_info;
+    node_info.node_id = kNodeId_;
+    IndexNode(node_info);
+  }
+  UpdateRadius();
 }
 
 std::shared_ptr<MatrixChange> GroupMatrix::AddConnectedPeer(
     const NodeInfo& node_info, const std::vector<NodeInfo>& matrix_update) {
-  std::vector<NodeId> old_unique_ids(GetUniqueNodeIds());
+  auto old_members(members_);
   LOG(kVerbose) << DebugId(kNodeId_) << " AddConnectedPeer : " << DebugId(node_info.node_id);
-  auto node_id(node_info.node_id);
-  auto found(std::find_if(std::begin(matrix_), std::end(matrix_),
-                          [node_id](const std::vector<NodeInfo>& info) {
-                            return info.begin()->node_id == node_id;
-                          }));
-  if (found != std::end(matrix_)) {
+  if (FindRow(node_info.node_id) != std::end(matrix_)) {
     LOG(kWarning) << "Already Added in matrix";
-    return std::make_shared<MatrixChange>(MatrixChange(kNodeId_, old_unique_ids, old_unique_ids));
+    return ChangeFrom(old_members);
   }
 
-  std::vector<NodeInfo> nodes_info(std::vector<NodeInfo>(1, node_info));
-  std::copy(std::begin(matrix_update), std::end(matrix_update), std::back_inserter(nodes_info));
-  matrix_.push_back(nodes_info);
+  row_versions_.erase(node_info.node_id);
+  Row row;
+  IndexPeer(row, node_info);
+  IndexEntries(row, std::begin(matrix_update), std::end(matrix_update));
+  matrix_.push_back(std::move(row));
   Prune();
-  UpdateUniqueNodeList();
-  return std::make_shared<MatrixChange>(MatrixChange(kNodeId_, old_unique_ids, GetUniqueNodeIds()));
+  UpdateConnectedPeers();
+  UpdateRadius();
+  return ChangeFrom(old_members);
 }
 
 std::shared_ptr<MatrixChange> GroupMatrix::RemoveConnectedPeer(const NodeInfo& node_info) {
-  std::vector<NodeId> old_unique_ids(GetUniqueNodeIds());
-  matrix_.erase(std::remove_if(std::begin(matrix_), std::end(matrix_),
-                               [node_info](const std::vector<NodeInfo>& nodes) {
-                                 return (node_info.node_id == nodes.begin()->node_id);
-                               }),
-                std::end(matrix_));
+  auto old_members(members_);
+  auto row_itr(FindRow(node_info.node_id));
+  if (row_itr != std::end(matrix_)) {
+    UnindexRow(*row_itr);
+    matrix_.erase(row_itr);
+  }
+  row_versions_.erase(node_info.node_id);
   Prune();
-  UpdateUniqueNodeList();
-  return std::make_shared<MatrixChange>(MatrixChange(kNodeId_, old_unique_ids, GetUniqueNodeIds()));
+  UpdateConnectedPeers();
+  UpdateRadius();
+  return ChangeFrom(old_members);
 }
 
-std::vector<NodeInfo> GroupMatrix::GetConnectedPeers() const {
-  std::vector<NodeInfo> connected_peers;
-  for (const auto& nodes : matrix_) {
-    if (nodes.begin()->node_id != kNodeId_)
-      connected_peers.push_back(nodes.at(0));
-  }
-  return connected_peers;
-}
+std::vector<NodeInfo> GroupMatrix::GetConnectedPeers() const { return connected_peers_; }
 
-NodeInfo GroupMatrix::GetConnectedPeerFor(const NodeId& target_node_id) {
+NodeInfo GroupMatrix::GetConnectedPeerFor(const NodeId& target_node_id) const {
   /*
     for (const auto& nodes : matrix_) {
       if (nodes.at(0).node_id == target_node_id) {
@@ -95,48 +120,40 @@ NodeInfo GroupMatrix::GetConnectedPeerFor(const NodeId& target_node_id) {
         return NodeInfo();
       }
     }*/
-  for (const auto& nodes : matrix_) {
-    if (std::find_if(std::begin(nodes), std::end(nodes),
-                     [target_node_id](const NodeInfo& node_info) {
-                       return (node_info.node_id == target_node_id);
-                     }) != std::end(nodes)) {
-      return nodes.at(0);
+  const Handle kTarget(unique_node_ids_.Find(target_node_id));
+  if (kTarget == NodeIdTable::kInvalidHandle)
+    return NodeInfo();
+  for (const auto& row : matrix_) {
+    if (row.peer_handle == kTarget ||
+        std::find(std::begin(row.entries), std::end(row.entries), kTarget) !=
+            std::end(row.entries)) {
+      return row.peer;
     }
   }
   return NodeInfo();
 }
 
 void GroupMatrix::GetBetterNodeForSendingMessage(const NodeId& target_node_id,
-                                                 const std::vector<std::string>& exclude,
+                                                 const RouteHistory& exclude,
                                                  bool ignore_exact_match,
-                                                 NodeInfo& current_closest_peer) {
+                                                 NodeInfo& current_closest_peer) const {
   NodeId closest_id(current_closest_peer.node_id);
+  auto eligible([&](const NodeId& node_id) {
+    return !(ignore_exact_match && node_id == target_node_id) && !exclude.Contains(node_id);
+  });
 
-  for (const auto& row : matrix_) {
-    if (ignore_exact_match && row.at(0).node_id == target_node_id)
-      continue;
-    if (std::find(exclude.begin(), exclude.end(), row.at(0).node_id.string()) != exclude.end())
-      continue;
-
-    for (const auto& node : row) {
-      if (node.node_id == kNodeId_)
-        continue;
-      if (ignore_exact_match && node.node_id == target_node_id)
-        continue;
-      if (std::find(exclude.begin(), exclude.end(), node.node_id.string()) != exclude.end())
-        continue;
-      if (NodeId::CloserToTarget(node.node_id, closest_id, target_node_id)) {
-        PrintGroupMatrix();
-        LOG(kVerbose) << DebugId(closest_id) << ", peer to send: "
-                      << DebugId(current_closest_peer.node_id) << ", "
-                      << DebugId(row.at(0).node_id);
-        closest_id = node.node_id;
-        current_closest_peer = row.at(0);
-        LOG(kVerbose) << DebugId(closest_id) << ", peer to send: "
-                      << DebugId(current_closest_peer.node_id);
-      }
-    }
-  }
+  VisitFromTarget(target_node_id, [&](const NodeInfo& node) {
+    if (!NodeId::CloserToTarget(node.node_id, closest_id, target_node_id))
+      return true;
+    if (node.node_id == kNodeId_ || !eligible(node.node_id))
+      return false;
+    auto row(FirstRowOf(row_heads_[unique_node_ids_.Find(node.node_id)], eligible));
+    if (row == std::end(matrix_))
+      return false;
+    closest_id = node.node_id;
+    current_closest_peer = row->peer;
+    return true;
+  });
   LOG(kVerbose) << "[" << DebugId(kNodeId_) << "]\ttarget: " << DebugId(target_node_id)
                 << "\tfound node in matrix: " << DebugId(closest_id)
                 << "\treccommend sending to: " << DebugId(current_closest_peer.node_id);
@@ -144,40 +161,45 @@ void GroupMatrix::GetBetterNodeForSendingMessage(const NodeId& target_node_id,
 
 void GroupMatrix::GetBetterNodeForSendingMessage(const NodeId& target_node_id,
                                                  bool ignore_exact_match,
-                                                 NodeId& current_closest_peer_id) {
+                                                 NodeId& current_closest_peer_id) const {
   NodeId closest_id(current_closest_peer_id);
+  auto eligible([&](const NodeId& node_id) {
+    return !(ignore_exact_match && node_id == target_node_id);
+  });
 
-  for (const auto& row : matrix_) {
-    if (ignore_exact_match && row.at(0).node_id == target_node_id)
-      continue;
-
-    for (const auto& node : row) {
-      if (ignore_exact_match && node.node_id == target_node_id)
-        continue;
-      if (NodeId::CloserToTarget(node.node_id, closest_id, target_node_id)) {
-        closest_id = node.node_id;
-        current_closest_peer_id = row.at(0).node_id;
-      }
-    }
-  }
+  VisitFromTarget(target_node_id, [&](const NodeInfo& node) {
+    if (!NodeId::CloserToTarget(node.node_id, closest_id, target_node_id))
+      return true;
+    if (!eligible(node.node_id))
+      return false;
+    auto row(FirstRowOf(row_heads_[unique_node_ids_.Find(node.node_id)], eligible));
+    if (row == std::end(matrix_))
+      return false;
+    closest_id = node.node_id;
+    current_closest_peer_id = row->peer.node_id;
+    return true;
+  });
   LOG(kVerbose) << "[" << DebugId(kNodeId_) << "]\ttarget: " << DebugId(target_node_id)
                 << "\tfound node in matrix: " << DebugId(closest_id)
                 << "\treccommend sending to: " << DebugId(current_closest_peer_id);
 }
 
-std::vector<NodeInfo> GroupMatrix::GetAllConnectedPeersFor(const NodeId& target_id) {
+std::vector<NodeInfo> GroupMatrix::GetAllConnectedPeersFor(const NodeId& target_id) const {
   std::vector<NodeInfo> connected_nodes;
+  const Handle kTarget(unique_node_ids_.Find(target_id));
+  if (kTarget == NodeIdTable::kInvalidHandle)
+    return connected_nodes;
   for (const auto& row : matrix_) {
-    if (std::find_if(row.begin(), row.end(), [&target_id](const NodeInfo & node_info) {
-          return target_id == node_info.node_id;
-        }) != row.end()) {
-      connected_nodes.push_back(row.at(0));
+    if (row.peer_handle == kTarget ||
+        std::find(std::begin(row.entries), std::end(row.entries), kTarget) !=
+            std::end(row.entries)) {
+      connected_nodes.push_back(row.peer);
     }
   }
   return connected_nodes;
 }
 
-bool GroupMatrix::IsThisNodeGroupLeader(const NodeId& target_id, NodeId& connected_peer) {
+bool GroupMatrix::IsThisNodeGroupLeader(const NodeId& target_id, NodeId& connected_peer) const {
   assert(!client_mode_ && "Client should not call IsThisNodeGroupLeader.");
   if (client_mode_)
     return false;
@@ -213,22 +235,22 @@ bool GroupMatrix::IsThisNodeGroupLeader(const NodeId& target_id, NodeId& connect
   return is_group_leader;
 }
 
-bool GroupMatrix::ClosestToId(const NodeId& target_id) {
+bool GroupMatrix::ClosestToId(const NodeId& target_id) const {
   if (unique_nodes_.size() == 0)
     return true;
 
-  PartialSortFromTarget(target_id, 2, unique_nodes_);
-  if (unique_nodes_.at(0).node_id == kNodeId_)
+  auto closest_nodes(RankFromTarget(unique_nodes_.begin(), unique_nodes_.end(), target_id, 2));
+  if (closest_nodes.at(0)->node_id == kNodeId_)
     return true;
 
-  if (unique_nodes_.at(0).node_id == target_id) {
-    if (unique_nodes_.at(1).node_id == kNodeId_)
+  if (closest_nodes.at(0)->node_id == target_id) {
+    if (closest_nodes.at(1)->node_id == kNodeId_)
       return true;
     else
-      return NodeId::CloserToTarget(kNodeId_, unique_nodes_.at(1).node_id, target_id);
+      return NodeId::CloserToTarget(kNodeId_, closest_nodes.at(1)->node_id, target_id);
   }
 
-  return NodeId::CloserToTarget(kNodeId_, unique_nodes_.at(0).node_id, target_id);
+  return NodeId::CloserToTarget(kNodeId_, closest_nodes.at(0)->node_id, target_id);
 }
 
 // bool GroupMatrix::IsNodeIdInGroupRange(const NodeId& group_id, const NodeId& node_id) {
@@ -252,211 +274,365 @@ bool GroupMatrix::ClosestToId(const NodeId& target_id) {
 
 GroupRangeStatus GroupMatrix::IsNodeIdInGroupRange(const NodeId& group_id,
                                                    const NodeId& node_id) const {
-  size_t group_size_adjust(Parameters::group_size + 1U);
-  size_t new_holders_size = std::min(unique_nodes_.size(), group_size_adjust);
-  std::vector<NodeInfo> new_holders_info(new_holders_size);
-  std::partial_sort_copy(unique_nodes_.begin(), unique_nodes_.end(), new_holders_info.begin(),
-                         new_holders_info.end(),
-                         [group_id](const NodeInfo & lhs, const NodeInfo & rhs) {
-    return NodeId::CloserToTarget(lhs.node_id, rhs.node_id, group_id);
-  });
+  return group_range()->IsNodeIdInGroupRange(group_id, node_id);
+}
 
-  std::vector<NodeId> new_holders;
-  for (auto i : new_holders_info)
-    new_holders.push_back(i.node_id);
+std::shared_ptr<const GroupRangeSnapshot> GroupMatrix::group_range() const {
+  return std::atomic_load(&group_range_);
+}
 
-  new_holders.erase(std::remove(new_holders.begin(), new_holders.end(), group_id),
-                    new_holders.end());
-  if (new_holders.size() > Parameters::group_size) {
-    new_holders.resize(Parameters::group_size);
-    assert(new_holders.size() == Parameters::group_size);
-  }
-  if (!client_mode_) {
-    auto this_node_range(GetProximalRange(group_id, kNodeId_, kNodeId_, radius_, new_holders));
-    if (node_id == kNodeId_)
-      return this_node_range;
-    else if (this_node_range != GroupRangeStatus::kInRange)
-      BOOST_THROW_EXCEPTION(MakeError(RoutingErrors::not_in_range));  // not_in_group
-  } else {
-    if (node_id == kNodeId_)
-      return GroupRangeStatus::kInProximalRange;
-  }
-  return GetProximalRange(group_id, node_id, kNodeId_, radius_, new_holders);
+std::shared_ptr<const MatrixNodes> GroupMatrix::nodes() const { return std::atomic_load(&nodes_); }
+
+std::shared_ptr<MatrixChange> GroupMatrix::UpdateFromConnectedPeer(
+    const NodeId& peer, const std::vector<NodeInfo>& nodes, uint32_t version) {
+  return UpdateFromConnectedPeer(peer, nodes, version, members_);
 }
 
 std::shared_ptr<MatrixChange> GroupMatrix::UpdateFromConnectedPeer(
-    const NodeId& peer, const std::vector<NodeInfo>& nodes,
-    const std::vector<NodeId>& old_unique_ids) {
+    const NodeId& peer, const std::vector<NodeInfo>& nodes, uint32_t version,
+    std::shared_ptr<const MatrixMembers> old_members) {
   assert(nodes.size() < Parameters::max_routing_table_size);
   if (peer.IsZero()) {
     assert(false && "Invalid peer node id.");
-    return std::make_shared<MatrixChange>(MatrixChange(kNodeId_, old_unique_ids, old_unique_ids));
+    return ChangeFrom(old_members);
   }
   // If peer is in my group
-  auto group_itr(std::begin(matrix_));
-  for (; group_itr != std::end(matrix_); ++group_itr) {
-    if (group_itr->begin()->node_id == peer)
-      break;
-  }
-
+  auto group_itr(FindRow(peer));
   if (group_itr == std::end(matrix_)) {
     LOG(kWarning) << "Peer Node : " << DebugId(peer) << " is not in closest group of this node.";
-    return std::make_shared<MatrixChange>(MatrixChange(kNodeId_, old_unique_ids, old_unique_ids));
+    return ChangeFrom(old_members);
   }
 
   // Update peer's row
-  if (group_itr->size() > 1) {
-    group_itr->erase(group_itr->begin() + 1, group_itr->end());
+  UnindexEntries(*group_itr, std::begin(group_itr->entries), std::end(group_itr->entries));
+  group_itr->entries.clear();
+  IndexEntries(*group_itr, std::begin(nodes), std::end(nodes));
+  if (version != 0)
+    row_versions_[peer] = version;
+  else
+    row_versions_.erase(peer);
+
+  Prune();
+  UpdateConnectedPeers();
+  UpdateRadius();
+  return ChangeFrom(old_members);
+}
+
+std::shared_ptr<MatrixChange> GroupMatrix::PatchFromConnectedPeer(
+    const NodeId& peer, const std::vector<NodeInfo>& added_nodes,
+    const std::vector<NodeId>& removed_nodes, uint32_t base_version, uint32_t version) {
+  auto old_members(members_);
+  auto version_itr(row_versions_.find(peer));
+  if (version_itr == std::end(row_versions_) || version_itr->second != base_version)
+    return nullptr;
+  auto group_itr(FindRow(peer));
+  if (group_itr == std::end(matrix_)) {
+    row_versions_.erase(version_itr);
+    return nullptr;
   }
-  for (const auto& i : nodes)
-    group_itr->push_back(i);
 
-  // Update unique node vector
+  auto& entries(group_itr->entries);
+  for (const auto& removed_node : removed_nodes) {
+    const Handle kRemoved(unique_node_ids_.Find(removed_node));
+    if (kRemoved == NodeIdTable::kInvalidHandle)
+      continue;
+    // Unlike remove, stable_partition leaves the removed entries intact for UnindexEntries.
+    auto removed_itr(std::stable_partition(std::begin(entries), std::end(entries),
+                                           [kRemoved](Handle entry) { return entry != kRemoved; }));
+    UnindexEntries(*group_itr, removed_itr, std::end(entries));
+    entries.erase(removed_itr, std::end(entries));
+  }
+  for (auto added_itr(std::begin(added_nodes)); added_itr != std::end(added_nodes); ++added_itr) {
+    const Handle kAdded(unique_node_ids_.Find(added_itr->node_id));
+    if (kAdded == NodeIdTable::kInvalidHandle ||
+        std::find(std::begin(entries), std::end(entries), kAdded) == std::end(entries))
+      IndexEntries(*group_itr, added_itr, added_itr + 1);
+  }
+  version_itr->second = version;
+
   Prune();
-  UpdateUniqueNodeList();
-  return std::make_shared<MatrixChange>(MatrixChange(kNodeId_, old_unique_ids, GetUniqueNodeIds()));
+  UpdateConnectedPeers();
+  UpdateRadius();
+  return ChangeFrom(old_members);
 }
 
-bool GroupMatrix::GetRow(const NodeId& row_id, std::vector<NodeInfo>& row_entries) {
+bool GroupMatrix::GetRow(const NodeId& row_id, std::vector<NodeInfo>& row_entries) const {
   if (row_id.IsZero()) {
     assert(false && "Invalid node id.");
     return false;
   }
-  auto group_itr(std::begin(matrix_));
-  for (group_itr = std::begin(matrix_); group_itr != std::end(matrix_); ++group_itr) {
-    if ((*group_itr).at(0).node_id == row_id)
-      break;
-  }
-
+  auto group_itr(FindRow(row_id));
   if (group_itr == std::end(matrix_))
     return false;
 
   row_entries.clear();
-  for (uint32_t i(0); i < (*group_itr).size(); ++i) {
-    if (i != 0) {
-      row_entries.push_back((*group_itr).at(i));
-    }
-  }
+  for (const auto& entry : group_itr->entries)
+    row_entries.push_back(UniqueNode(entry));
   return true;
 }
 
-std::vector<NodeInfo> GroupMatrix::GetUniqueNodes() const { return unique_nodes_; }
+uint64_t GroupMatrix::RowDigest(const std::vector<NodeInfo>& nodes) {
+  std::vector<std::string> ids;
+  ids.reserve(nodes.size());
+  for (const auto& node_info : nodes)
+    ids.push_back(node_info.node_id.string());
+  return DigestOf(std::move(ids));
+}
 
-std::vector<NodeId> GroupMatrix::GetUniqueNodeIds() const {
-  std::vector<NodeId> unique_node_ids;
-  for (auto& node_info : unique_nodes_)
-    unique_node_ids.push_back(node_info.node_id);
-  return unique_node_ids;
+bool GroupMatrix::RowMatchesDigest(const NodeId& peer, uint32_t version, uint64_t digest) const {
+  auto version_itr(row_versions_.find(peer));
+  if (version_itr == std::end(row_versions_) || version_itr->second != version)
+    return false;
+  auto group_itr(FindRow(peer));
+  if (group_itr == std::end(matrix_))
+    return false;
+  std::vector<std::string> ids;
+  ids.reserve(group_itr->entries.size());
+  for (const auto& entry : group_itr->entries)
+    ids.push_back(unique_node_ids_.node_id(entry).string());
+  return DigestOf(std::move(ids)) == digest;
 }
 
-bool GroupMatrix::IsRowEmpty(const NodeInfo& node_info) {
-  auto group_itr(std::begin(matrix_));
-  for (; group_itr != std::end(matrix_); ++group_itr) {
-    if ((*group_itr).at(0).node_id == node_info.node_id)
-      break;
-  }
+std::vector<NodeInfo> GroupMatrix::GetUniqueNodes() const { return unique_nodes_; }
+
+std::vector<NodeId> GroupMatrix::GetUniqueNodeIds() const { return members_->ids; }
+
+bool GroupMatrix::IsRowEmpty(const NodeInfo& node_info) const {
+  auto group_itr(FindRow(node_info.node_id));
   assert(group_itr != std::end(matrix_));
   if (group_itr == std::end(matrix_))
     return false;
 
-  return (group_itr->size() < 2);
+  return group_itr->entries.empty();
 }
 
-std::vector<NodeInfo> GroupMatrix::GetClosestNodes(uint16_t size) {
-  uint16_t size_to_sort(std::min(size, static_cast<uint16_t>(unique_nodes_.size())));
-  PartialSortFromTarget(kNodeId_, size_to_sort, unique_nodes_);
-  return std::vector<NodeInfo>(unique_nodes_.begin(), unique_nodes_.begin() + size_to_sort);
+std::vector<NodeInfo> GroupMatrix::GetClosestNodes(uint16_t size) const {
+  uint16_t count(std::min(size, static_cast<uint16_t>(unique_nodes_.size())));
+  return std::vector<NodeInfo>(unique_nodes_.begin(), unique_nodes_.begin() + count);
 }
 
-bool GroupMatrix::Contains(const NodeId& node_id) {
-  return std::find_if(unique_nodes_.begin(), unique_nodes_.end(),
-                      [&node_id](const NodeInfo & node_info) {
-           return node_info.node_id == node_id;
-         }) != unique_nodes_.end();
+bool GroupMatrix::Contains(const NodeId& node_id) const {
+  return unique_node_ids_.Contains(node_id);
 }
 
-void GroupMatrix::UpdateUniqueNodeList() {
-  std::set<NodeInfo, std::function<bool(const NodeInfo&, const NodeInfo&)>> sorted_to_owner([&](
-      const NodeInfo & lhs,
-      const NodeInfo & rhs) { return NodeId::CloserToTarget(lhs.node_id, rhs.node_id, kNodeId_); });
-  auto closest_nodes_size_adjust = Parameters::closest_nodes_size;
-  if (!client_mode_) {
-    NodeInfo node_info;
-    node_info.node_id = kNodeId_;
-    sorted_to_owner.insert(node_info);
-    ++closest_nodes_size_adjust;
+void GroupMatrix::UpdateConnectedPeers() {
+  connected_peers_.clear();
+  for (const auto& row : matrix_) {
+    if (row.peer.node_id != kNodeId_)
+      connected_peers_.push_back(row.peer);
+  }
+  std::sort(connected_peers_.begin(), connected_peers_.end(),
+            [this](const NodeInfo & lhs, const NodeInfo & rhs) {
+    return NodeId::CloserToTarget(lhs.node_id, rhs.node_id, kNodeId_);
+  });
+}
+
+std::vector<GroupMatrix::Row>::iterator GroupMatrix::FindRow(const NodeId& peer) {
+  return std::find_if(std::begin(matrix_), std::end(matrix_),
+                      [&peer](const Row& row) { return row.peer.node_id == peer; });
+}
+
+std::vector<GroupMatrix::Row>::const_iterator GroupMatrix::FindRow(const NodeId& peer) const {
+  return std::find_if(std::begin(matrix_), std::end(matrix_),
+                      [&peer](const Row& row) { return row.peer.node_id == peer; });
+}
+
+GroupMatrix::Handle GroupMatrix::IndexNode(const NodeInfo& node_info) {
+  auto handle(unique_node_ids_.Acquire(node_info.node_id));
+  if (row_heads_.size() <= handle)
+    row_heads_.resize(handle + 1);
+  if (unique_node_ids_.references(handle) != 1)
+    return handle;
+  auto position(std::lower_bound(std::begin(unique_nodes_), std::end(unique_nodes_), node_info,
+                                 [this](const NodeInfo& lhs, const NodeInfo& rhs) {
+                                   return NodeId::CloserToTarget(lhs.node_id, rhs.node_id,
+                                                                 kNodeId_);
+                                 }));
+  unique_nodes_.insert(position, node_info);
+  members_changed_ = true;
+  return handle;
+}
+
+void GroupMatrix::UnindexNode(Handle row_head, Handle handle) {
+  auto& row_heads(row_heads_[handle]);
+  auto listed(std::find(std::begin(row_heads), std::end(row_heads), row_head));
+  if (listed != std::end(row_heads))
+    row_heads.erase(listed);
+  // Copied, as the table forgets it with the last reference.
+  const NodeId kNodeId(unique_node_ids_.node_id(handle));
+  if (!unique_node_ids_.Release(handle))
+    return;
+  assert(row_heads.empty());
+  if (row_heads_.size() > unique_node_ids_.handle_limit()) {
+    row_heads_.resize(unique_node_ids_.handle_limit());
+    if (row_heads_.size() < row_heads_.capacity() / 4)
+      row_heads_.shrink_to_fit();
+  }
+  // Distances from kNodeId_ are unique per id, so the lower bound is the entry itself.
+  auto position(std::lower_bound(std::begin(unique_nodes_), std::end(unique_nodes_), kNodeId,
+                                 [this](const NodeInfo& lhs, const NodeId& rhs) {
+                                   return NodeId::CloserToTarget(lhs.node_id, rhs, kNodeId_);
+                                 }));
+  if (position != std::end(unique_nodes_) && position->node_id == kNodeId) {
+    unique_nodes_.erase(position);
+    members_changed_ = true;
+  }
+}
+
+void GroupMatrix::IndexPeer(Row& row, const NodeInfo& peer) {
+  row.peer = peer;
+  row.peer_handle = IndexNode(peer);
+  row_heads_[row.peer_handle].push_back(row.peer_handle);
+}
+
+void GroupMatrix::IndexEntries(Row& row, std::vector<NodeInfo>::const_iterator first,
+                               std::vector<NodeInfo>::const_iterator last) {
+  for (; first != last; ++first) {
+    const Handle kHandle(IndexNode(*first));
+    row_heads_[kHandle].push_back(row.peer_handle);
+    row.entries.push_back(kHandle);
   }
-  for (const auto& node_ids : matrix_) {
-    for (const auto& node_id : node_ids)
-      sorted_to_owner.insert(node_id);
+}
+
+void GroupMatrix::UnindexEntries(const Row& row, std::vector<Handle>::const_iterator first,
+                                 std::vector<Handle>::const_iterator last) {
+  for (; first != last; ++first)
+    UnindexNode(row.peer_handle, *first);
+}
+
+void GroupMatrix::UnindexRow(const Row& row) {
+  UnindexEntries(row, std::begin(row.entries), std::end(row.entries));
+  UnindexNode(row.peer_handle, row.peer_handle);
+}
+
+const NodeInfo& GroupMatrix::UniqueNode(Handle handle) const {
+  const NodeId& node_id(unique_node_ids_.node_id(handle));
+  auto position(std::lower_bound(std::begin(unique_nodes_), std::end(unique_nodes_), node_id,
+                                 [this](const NodeInfo& lhs, const NodeId& rhs) {
+                                   return NodeId::CloserToTarget(lhs.node_id, rhs, kNodeId_);
+                                 }));
+  assert(position != std::end(unique_nodes_) && position->node_id == node_id);
+  return *position;
+}
+
+// As in RoutingTable::GetClosestFromTarget, unique_nodes_ is walked as contiguous ranges of nodes
+// sharing the position of the most significant bit in which they differ from kNodeId_.  The first
+// range, of nodes differing from kNodeId_ no higher than target_id does, lies closer to target_id
+// than any node beyond, and each later range lies wholly closer to it than the next, so only one
+// range at a time needs ranking.
+template <typename Visit>
+void GroupMatrix::VisitFromTarget(const NodeId& target_id, Visit visit) const {
+  // The end of the range from 'first' of nodes whose most significant differing bit is no higher
+  // than pivot's, i.e. those closer to kNodeId_ than pivot is or closer to pivot than kNodeId_ is.
+  auto range_end([this](std::vector<NodeInfo>::const_iterator first, const NodeId& pivot) {
+    return std::find_if(first, std::end(unique_nodes_), [&](const NodeInfo& node_info) {
+      return !NodeId::CloserToTarget(node_info.node_id, pivot, kNodeId_) &&
+             !NodeId::CloserToTarget(node_info.node_id, kNodeId_, pivot);
+    });
+  });
+
+  auto first(std::begin(unique_nodes_));
+  if (first == std::end(unique_nodes_))
+    return;
+  auto last(range_end(first, target_id));
+  for (;;) {
+    for (const auto& node_info : RankFromTarget(first, last, target_id,
+                                                static_cast<size_t>(last - first))) {
+      if (visit(*node_info))
+        return;
+    }
+    first = last;
+    if (first == std::end(unique_nodes_))
+      return;
+    last = range_end(first, first->node_id);
+    if (last == first)  // first is this node, alone at distance zero
+      ++last;
   }
-  unique_nodes_.assign(std::begin(sorted_to_owner), std::end(sorted_to_owner));
+}
+
+template <typename Eligible>
+std::vector<GroupMatrix::Row>::const_iterator GroupMatrix::FirstRowOf(
+    const std::vector<Handle>& heads, Eligible eligible) const {
+  return std::find_if(std::begin(matrix_), std::end(matrix_), [&](const Row& row) {
+    return std::find(std::begin(heads), std::end(heads), row.peer_handle) != std::end(heads) &&
+           eligible(row.peer.node_id);
+  });
+}
+
+void GroupMatrix::UpdateRadius() {
+  auto closest_nodes_size_adjust = Parameters::closest_nodes_size;
+  if (!client_mode_)
+    ++closest_nodes_size_adjust;
 
-  // Updating radius
   NodeId fcn_distance;
   if (unique_nodes_.size() >= closest_nodes_size_adjust) {
     fcn_distance = kNodeId_ ^ unique_nodes_[closest_nodes_size_adjust - 1].node_id;
 
-    radius_ =
-        (crypto::BigInt((fcn_distance.ToStringEncoded(NodeId::EncodingType::kHex) + 'h').c_str()) *
-         Parameters::proximity_factor);
+    radius_ = XorDistance(fcn_distance) * Parameters::proximity_factor;
   } else {
     fcn_distance = NodeId(NodeId::kMaxId);  // FIXME Prakash
-    radius_ =
-        (crypto::BigInt((fcn_distance.ToStringEncoded(NodeId::EncodingType::kHex) + 'h').c_str()));
+    radius_ = XorDistance(fcn_distance);
   }
+  std::atomic_store(&group_range_, std::shared_ptr<const GroupRangeSnapshot>(
+      std::make_shared<GroupRangeSnapshot>(kNodeId_, unique_nodes_, radius_, client_mode_)));
+
+  if (!members_changed_)
+    return;
+  std::vector<NodeId> ids;
+  ids.reserve(unique_nodes_.size());
+  for (const auto& node_info : unique_nodes_)
+    ids.push_back(node_info.node_id);
+  members_ = std::make_shared<const MatrixMembers>(members_->version + 1, std::move(ids));
+  std::atomic_store(&nodes_, std::shared_ptr<const MatrixNodes>(
+      std::make_shared<MatrixNodes>(members_->version, unique_nodes_)));
+  members_changed_ = false;
 }
 
-void GroupMatrix::PartialSortFromTarget(const NodeId& target, uint16_t number,
-                                        std::vector<NodeInfo>& nodes) {
-  uint16_t count = std::min(number, static_cast<uint16_t>(nodes.size()));
-  std::partial_sort(nodes.begin(), nodes.begin() + count, nodes.end(),
-                    [target](const NodeInfo & lhs, const NodeInfo & rhs) {
-    return NodeId::CloserToTarget(lhs.node_id, rhs.node_id, target);
-  });
+std::shared_ptr<MatrixChange> GroupMatrix::ChangeFrom(
+    std::shared_ptr<const MatrixMembers> old_members) const {
+  return std::make_shared<MatrixChange>(MatrixChange(kNodeId_, std::move(old_members), members_));
 }
 
 void GroupMatrix::Prune() {
   if (matrix_.size() <= Parameters::closest_nodes_size)
     return;
-  NodeId node_id;
   std::partial_sort(std::begin(matrix_), std::begin(matrix_) + Parameters::closest_nodes_size,
-                    std::end(matrix_), [this](const std::vector<NodeInfo>& lhs,
-                                              const std::vector<NodeInfo>& rhs) {
-                                         return NodeId::CloserToTarget(lhs.begin()->node_id,
-                                                                       rhs.begin()->node_id,
-                                                                       kNodeId_);
-                                       });
+                    std::end(matrix_), [this](const Row& lhs, const Row& rhs) {
+                      return NodeId::CloserToTarget(lhs.peer.node_id, rhs.peer.node_id, kNodeId_);
+                    });
+  const Handle kOwnHandle(unique_node_ids_.Find(kNodeId_));
   auto itr(std::begin(matrix_));
   std::advance(itr, Parameters::closest_nodes_size);
   while (itr != std::end(matrix_)) {
+    const NodeId& node_id(itr->peer.node_id);
     if (client_mode_) {
-      LOG(kInfo) << DebugId(kNodeId_) << " matrix conected removes "
-                 << DebugId(itr->begin()->node_id);
+      LOG(kInfo) << DebugId(kNodeId_) << " matrix conected removes " << DebugId(node_id);
+      UnindexRow(*itr);
       itr = matrix_.erase(itr);
       continue;
     }
-    node_id = itr->begin()->node_id;
-    if (itr->size() <= Parameters::closest_nodes_size) {
-      if (itr->size() > 1) {  // avoids removing the recently added node
+    auto& entries(itr->entries);
+    if (entries.size() < Parameters::closest_nodes_size) {
+      if (!entries.empty()) {  // avoids removing the recently added node
         LOG(kInfo) << DebugId(kNodeId_) << " matrix conected removes " << DebugId(node_id);
+        UnindexRow(*itr);
         itr = matrix_.erase(itr);
       } else {
         itr++;
       }
       continue;
     }
-    std::sort(itr->begin() + 1, itr->end(), [node_id](const NodeInfo& lhs, const NodeInfo& rhs) {
-                                              return NodeId::CloserToTarget(lhs.node_id,
-                                                                            rhs.node_id, node_id);
-                                            });
-    if (NodeId::CloserToTarget(itr->at(Parameters::closest_nodes_size).node_id, kNodeId_,
-                               node_id) ||
-        (std::find_if(std::begin(*itr), std::end(*itr), [&](const NodeInfo& node_info) {
-                                                          return node_info.node_id == kNodeId_;
-                                                        }) == std::end(*itr))) {
-      LOG(kInfo) << DebugId(kNodeId_) << " matrix conected removes "
-                 << DebugId(itr->begin()->node_id);
+    std::sort(std::begin(entries), std::end(entries), [&](Handle lhs, Handle rhs) {
+      return NodeId::CloserToTarget(unique_node_ids_.node_id(lhs), unique_node_ids_.node_id(rhs),
+                                    node_id);
+    });
+    const NodeId& kFurthestClose(
+        unique_node_ids_.node_id(entries[Parameters::closest_nodes_size - 1]));
+    if (NodeId::CloserToTarget(kFurthestClose, kNodeId_, node_id) ||
+        (node_id != kNodeId_ &&
+         std::find(std::begin(entries), std::end(entries), kOwnHandle) == std::end(entries))) {
+      LOG(kInfo) << DebugId(kNodeId_) << " matrix conected removes " << DebugId(node_id);
+      UnindexRow(*itr);
       itr = matrix_.erase(itr);
     } else {
       itr++;
@@ -465,15 +641,17 @@ void GroupMatrix::Prune() {
   PrintGroupMatrix();
 }
 
-void GroupMatrix::PrintGroupMatrix() {
+void GroupMatrix::PrintGroupMatrix() const {
   auto group_itr(std::begin(matrix_));
   std::string tab("\t");
   std::string output("Group matrix of node with NodeID: " + DebugId(kNodeId_));
   for (group_itr = std::begin(matrix_); group_itr != std::end(matrix_); ++group_itr) {
     output.append("\nGroup matrix row:");
-    for (const auto& elem : (*group_itr)) {
+    output.append(tab);
+    output.append(DebugId(group_itr->peer.node_id));
+    for (const auto& entry : group_itr->entries) {
       output.append(tab);
-      output.append(DebugId(elem.node_id));
+      output.append(DebugId(unique_node_ids_.node_id(entry)));
     }
   }
   LOG(kVerbose) << output;
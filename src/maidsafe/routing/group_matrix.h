@@ -20,14 +20,20 @@
 #define MAIDSAFE_ROUTING_GROUP_MATRIX_H_
 
 #include <cstdint>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <vector>
 #include <string>
 
-#include "maidsafe/common/crypto.h"
 #include "maidsafe/common/node_id.h"
 #include "maidsafe/routing/node_info.h"
 #include "maidsafe/routing/api_config.h"
+#include "maidsafe/routing/group_range_snapshot.h"
+#include "maidsafe/routing/matrix_nodes.h"
+#include "maidsafe/routing/node_id_table.h"
+#include "maidsafe/routing/route_history.h"
+#include "maidsafe/routing/xor_distance.h"
 
 namespace maidsafe {
 
@@ -57,32 +63,58 @@ class GroupMatrix {
   std::vector<NodeInfo> GetConnectedPeers() const;
 
   // Returns the peer which has target_info in its row (1st occurrence).
-  NodeInfo GetConnectedPeerFor(const NodeId& target_node_id);
+  NodeInfo GetConnectedPeerFor(const NodeId& target_node_id) const;
 
-  // Returns the peer which has node closest to target_id in its row (1st occurrence).
-  void GetBetterNodeForSendingMessage(const NodeId& target_node_id,
-                                      const std::vector<std::string>& exclude,
-                                      bool ignore_exact_match, NodeInfo& current_closest_peer);
+  // Returns the peer which has node closest to target_id in its row (1st occurrence).  Members are
+  // visited from target_id outwards, so only those closer than current_closest_peer's are tried.
+  void GetBetterNodeForSendingMessage(const NodeId& target_node_id, const RouteHistory& exclude,
+                                      bool ignore_exact_match,
+                                      NodeInfo& current_closest_peer) const;
   void GetBetterNodeForSendingMessage(const NodeId& target_node_id, bool ignore_exact_match,
-                                      NodeId& current_closest_peer_id);
-  std::vector<NodeInfo> GetAllConnectedPeersFor(const NodeId& target_id);
-  bool IsThisNodeGroupLeader(const NodeId& target_id, NodeId& connected_peer);
+                                      NodeId& current_closest_peer_id) const;
+  std::vector<NodeInfo> GetAllConnectedPeersFor(const NodeId& target_id) const;
+  bool IsThisNodeGroupLeader(const NodeId& target_id, NodeId& connected_peer) const;
 
-  bool ClosestToId(const NodeId& target_id);
+  bool ClosestToId(const NodeId& target_id) const;
   //  bool IsNodeIdInGroupRange(const NodeId& group_id, const NodeId& node_id);
   GroupRangeStatus IsNodeIdInGroupRange(const NodeId& group_id, const NodeId& node_id) const;
-  // Updates group matrix if peer is present in 1st column of matrix
+  // Republished whenever the unique nodes change.  Safe to call without holding the lock guarding
+  // the rest of the matrix.
+  std::shared_ptr<const GroupRangeSnapshot> group_range() const;
+  // The unique node ids, republished with a new version whenever they change.  Each MatrixChange
+  // returned shares these rather than copying them.
+  std::shared_ptr<const MatrixMembers> members() const { return members_; }
+  // The unique nodes, republished along with members_.  Like group_range, safe to call without
+  // holding the lock guarding the rest of the matrix.
+  std::shared_ptr<const MatrixNodes> nodes() const;
+  // Updates group matrix if peer is present in 1st column of matrix.  A non-zero version is
+  // recorded so that later deltas from peer can be applied against it.
   std::shared_ptr<MatrixChange> UpdateFromConnectedPeer(const NodeId& peer,
                                                         const std::vector<NodeInfo>& nodes,
-                                                        const std::vector<NodeId>& old_unique_ids);
+                                                        uint32_t version = 0);
+  // As above, but the change returned is from old_members, for a caller which has changed the
+  // matrix itself first, e.g. by adding peer, and is to report both changes as one.
+  std::shared_ptr<MatrixChange> UpdateFromConnectedPeer(
+      const NodeId& peer, const std::vector<NodeInfo>& nodes, uint32_t version,
+      std::shared_ptr<const MatrixMembers> old_members);
+  // Patches peer's row in place.  Returns nullptr without changing anything if the row is not
+  // present or was not last updated to base_version, in which case peer's full row is needed.
+  std::shared_ptr<MatrixChange> PatchFromConnectedPeer(const NodeId& peer,
+                                                       const std::vector<NodeInfo>& added_nodes,
+                                                       const std::vector<NodeId>& removed_nodes,
+                                                       uint32_t base_version, uint32_t version);
   void UpdateFromUnvalidatedPeer(const NodeId& peer, const std::vector<NodeInfo>& nodes);
 
-  bool IsRowEmpty(const NodeInfo& node_info);
-  bool GetRow(const NodeId& row_id, std::vector<NodeInfo>& row_entries);
+  bool IsRowEmpty(const NodeInfo& node_info) const;
+  bool GetRow(const NodeId& row_id, std::vector<NodeInfo>& row_entries) const;
+  // A hash of the sorted ids of nodes, which a peer sends in place of its row while it's unchanged.
+  static uint64_t RowDigest(const std::vector<NodeInfo>& nodes);
+  // True if peer's row was last updated to version and its entries hash to digest.
+  bool RowMatchesDigest(const NodeId& peer, uint32_t version, uint64_t digest) const;
   std::vector<NodeInfo> GetUniqueNodes() const;
   std::vector<NodeId> GetUniqueNodeIds() const;
-  std::vector<NodeInfo> GetClosestNodes(uint16_t size);
-  bool Contains(const NodeId& node_id);
+  std::vector<NodeInfo> GetClosestNodes(uint16_t size) const;
+  bool Contains(const NodeId& node_id) const;
   void Prune();
 
   friend class RoutingTable;
@@ -91,18 +123,73 @@ class GroupMatrix {
   friend class test::GroupMatrixTest_BEH_Prune_Test;
 
  private:
+  typedef NodeIdTable::Handle Handle;
+  // A connected peer and the close nodes it last reported, held as unique_node_ids_ handles.  The
+  // entries' other details are those unique_nodes_ holds for them.
+  struct Row {
+    Row() : peer(), peer_handle(NodeIdTable::kInvalidHandle), entries() {}
+    NodeInfo peer;
+    Handle peer_handle;
+    std::vector<Handle> entries;
+  };
+
   GroupMatrix(const GroupMatrix&);
   GroupMatrix& operator=(const GroupMatrix&);
-  void UpdateUniqueNodeList();
-  void PartialSortFromTarget(const NodeId& target, uint16_t number,
-                             std::vector<NodeInfo>& nodes);
-  void PrintGroupMatrix();
+  std::vector<Row>::iterator FindRow(const NodeId& peer);
+  std::vector<Row>::const_iterator FindRow(const NodeId& peer) const;
+  // Adds a reference to node_info's id, and adds it to unique_nodes_ if it's new.  The caller lists
+  // the rows it is in under row_heads_.
+  Handle IndexNode(const NodeInfo& node_info);
+  // Drops a reference to handle's id as an entry of row_head's row, or as this node's own entry
+  // where row_head is kInvalidHandle, removing the id from unique_nodes_ with its last reference.
+  void UnindexNode(Handle row_head, Handle handle);
+  // Index row's peer, or nodes reported by it, adding them to row.
+  void IndexPeer(Row& row, const NodeInfo& peer);
+  void IndexEntries(Row& row, std::vector<NodeInfo>::const_iterator first,
+                    std::vector<NodeInfo>::const_iterator last);
+  // These don't remove the entries from row, which the caller does after.
+  void UnindexEntries(const Row& row, std::vector<Handle>::const_iterator first,
+                      std::vector<Handle>::const_iterator last);
+  void UnindexRow(const Row& row);
+  // The unique_nodes_ entry for a handle held.
+  const NodeInfo& UniqueNode(Handle handle) const;
+  // Calls visit with each of unique_nodes_ in order of distance from target_id until it returns
+  // true.
+  template <typename Visit>
+  void VisitFromTarget(const NodeId& target_id, Visit visit) const;
+  // The first row of matrix_ whose peer is in heads and accepted by eligible, or matrix_.end().
+  template <typename Eligible>
+  std::vector<Row>::const_iterator FirstRowOf(const std::vector<Handle>& heads,
+                                              Eligible eligible) const;
+  // Also republishes members_ if unique_nodes_ has changed since it was last published.
+  void UpdateRadius();
+  // The change from old_members to members_.
+  std::shared_ptr<MatrixChange> ChangeFrom(std::shared_ptr<const MatrixMembers> old_members) const;
+  void UpdateConnectedPeers();
+  void PrintGroupMatrix() const;
 
   const NodeId& kNodeId_;
+  // Kept sorted by distance from kNodeId_.
   std::vector<NodeInfo> unique_nodes_;
-  crypto::BigInt radius_;
+  // Each id in unique_nodes_, referenced once per matrix_ entry with it (plus once for this node
+  // if not a client).
+  NodeIdTable unique_node_ids_;
+  // The handles of the peers whose rows list each of unique_nodes_, by its unique_node_ids_ handle.
+  // A peer appears once per entry of the id in its row, and under its own handle for heading it.
+  std::vector<std::vector<Handle>> row_heads_;
+  std::shared_ptr<const MatrixMembers> members_;
+  // Only accessed through std::atomic_load and std::atomic_store.
+  std::shared_ptr<const MatrixNodes> nodes_;
+  bool members_changed_;
+  XorDistance radius_;
   bool client_mode_;
-  std::vector<std::vector<NodeInfo>> matrix_;
+  // Only accessed through std::atomic_load and std::atomic_store.
+  std::shared_ptr<const GroupRangeSnapshot> group_range_;
+  std::vector<Row> matrix_;
+  // First column of matrix_, sorted by distance from kNodeId_ and refreshed whenever rows change.
+  std::vector<NodeInfo> connected_peers_;
+  // Version of the last full row or delta applied for each connected peer which sent one.
+  std::map<NodeId, uint32_t> row_versions_;
 };
 
 }  // namespace routing
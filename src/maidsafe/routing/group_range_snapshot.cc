@@ -0,0 +1,110 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/group_range_snapshot.h"
+
+#include <algorithm>
+
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/return_codes.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+// True if lhs is closer to target than rhs.
+template <typename Words>
+bool Closer(const Words& lhs, const Words& rhs, const Words& target) {
+  for (size_t i(0); i != lhs.size(); ++i) {
+    uint64_t lhs_distance(lhs[i] ^ target[i]), rhs_distance(rhs[i] ^ target[i]);
+    if (lhs_distance != rhs_distance)
+      return lhs_distance < rhs_distance;
+  }
+  return false;
+}
+
+}  // unnamed namespace
+
+GroupRangeSnapshot::GroupRangeSnapshot(const NodeId& this_node_id,
+                                       const std::vector<NodeInfo>& unique_nodes,
+                                       const XorDistance& radius, bool client_mode)
+    : kNodeId_(this_node_id),
+      kNodeIdWords_(ToWords(this_node_id)),
+      unique_nodes_(),
+      kRadius_(radius),
+      kClientMode_(client_mode) {
+  unique_nodes_.reserve(unique_nodes.size());
+  for (const auto& node : unique_nodes)
+    unique_nodes_.push_back(ToWords(node.node_id));
+}
+
+GroupRangeSnapshot::Words GroupRangeSnapshot::ToWords(const NodeId& node_id) {
+  Words words;
+  const std::string& id(node_id.string());
+  for (size_t i(0); i != kIdWords; ++i) {
+    uint64_t word(0);
+    for (size_t j(0); j != sizeof(uint64_t); ++j)
+      word = (word << 8) | static_cast<unsigned char>(id[i * sizeof(uint64_t) + j]);
+    words[i] = word;
+  }
+  return words;
+}
+
+GroupRangeStatus GroupRangeSnapshot::IsNodeIdInGroupRange(const NodeId& group_id,
+                                                          const NodeId& node_id) const {
+  const Words kGroupId(ToWords(group_id));
+  if (!kClientMode_) {
+    auto this_node_range(Range(kGroupId, group_id, kNodeIdWords_, kNodeId_));
+    if (node_id == kNodeId_)
+      return this_node_range;
+    else if (this_node_range != GroupRangeStatus::kInRange)
+      BOOST_THROW_EXCEPTION(MakeError(RoutingErrors::not_in_range));  // not_in_group
+  } else {
+    if (node_id == kNodeId_)
+      return GroupRangeStatus::kInProximalRange;
+  }
+  return Range(kGroupId, group_id, ToWords(node_id), node_id);
+}
+
+GroupRangeStatus GroupRangeSnapshot::Range(const Words& group_id, const NodeId& group_node_id,
+                                           const Words& node_id,
+                                           const NodeId& node_node_id) const {
+  if (group_node_id == node_node_id || group_node_id == kNodeId_)
+    return GroupRangeStatus::kOutwithRange;
+  // The group ID itself is never counted as one of its holders.
+  bool held(false);
+  size_t closer(0);
+  for (const auto& unique_node : unique_nodes_) {
+    if (unique_node == node_id) {
+      held = true;
+    } else if (unique_node != group_id && Closer(unique_node, node_id, group_id) &&
+               ++closer == Parameters::group_size) {
+      break;
+    }
+  }
+  if (held && closer < Parameters::group_size)
+    return GroupRangeStatus::kInRange;
+  return (XorDistance(node_node_id, group_node_id) < kRadius_) ? GroupRangeStatus::kInProximalRange
+                                                              : GroupRangeStatus::kOutwithRange;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,67 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_GROUP_RANGE_SNAPSHOT_H_
+#define MAIDSAFE_ROUTING_GROUP_RANGE_SNAPSHOT_H_
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+
+#include "maidsafe/routing/matrix_change.h"
+#include "maidsafe/routing/node_info.h"
+#include "maidsafe/routing/xor_distance.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// An immutable copy of what GroupMatrix::IsNodeIdInGroupRange needs: the matrix's unique node IDs
+// as big-endian 64-bit words, and the proximity radius.  A node is one of a group's holders if
+// fewer than Parameters::group_size other unique nodes are closer to the group ID, so answering
+// takes one early-exit word comparison per unique node, with no ranking, allocation or lock.
+class GroupRangeSnapshot {
+ public:
+  GroupRangeSnapshot(const NodeId& this_node_id, const std::vector<NodeInfo>& unique_nodes,
+                     const XorDistance& radius, bool client_mode);
+  // Same result as GroupMatrix::IsNodeIdInGroupRange, including throwing if node_id isn't this
+  // node and this node isn't in range.
+  GroupRangeStatus IsNodeIdInGroupRange(const NodeId& group_id, const NodeId& node_id) const;
+
+ private:
+  static const size_t kIdWords = NodeId::kSize / sizeof(uint64_t);
+  typedef std::array<uint64_t, kIdWords> Words;
+
+  static Words ToWords(const NodeId& node_id);
+  GroupRangeStatus Range(const Words& group_id, const NodeId& group_node_id, const Words& node_id,
+                         const NodeId& node_node_id) const;
+
+  const NodeId kNodeId_;
+  const Words kNodeIdWords_;
+  std::vector<Words> unique_nodes_;
+  const XorDistance kRadius_;
+  const bool kClientMode_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_GROUP_RANGE_SNAPSHOT_H_
@@ -0,0 +1,104 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_HANDLER_GUARD_H_
+#define MAIDSAFE_ROUTING_HANDLER_GUARD_H_
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace maidsafe {
+
+namespace routing {
+
+// Lets handlers posted to an AsioService which may outlive their owner (e.g. one shared by several
+// Routing objects) find out that the owner has gone.  Handlers wrapped by Wrap run as usual until
+// Close is called; Close waits for any of them in progress, and any which run later return without
+// calling what they wrap.  Unlike Timer's TickGuard, wrapped handlers may run concurrently.
+class HandlerGuard {
+  struct State {
+    State() : mutex(), idle(), open(true), running(0) {}
+    std::mutex mutex;
+    std::condition_variable idle;
+    bool open;
+    int running;
+  };
+
+ public:
+  template <typename Handler>
+  class Guarded {
+   public:
+    Guarded(std::weak_ptr<State> state, Handler handler)
+        : state_(std::move(state)), handler_(std::move(handler)) {}
+    template <typename... Args>
+    void operator()(Args&&... args) {
+      auto state(state_.lock());
+      if (!state)
+        return;
+      {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (!state->open)
+          return;
+        ++state->running;
+      }
+      struct Finished {
+        explicit Finished(State& state_in) : state(state_in) {}
+        ~Finished() {
+          std::lock_guard<std::mutex> lock(state.mutex);
+          if (--state.running == 0)
+            state.idle.notify_all();
+        }
+        State& state;
+      } finished(*state);
+      handler_(std::forward<Args>(args)...);
+    }
+
+   private:
+    std::weak_ptr<State> state_;
+    Handler handler_;
+  };
+
+  HandlerGuard() : state_(std::make_shared<State>()) {}
+  ~HandlerGuard() { Close(); }
+
+  template <typename Handler>
+  Guarded<Handler> Wrap(Handler handler) const {
+    return Guarded<Handler>(state_, std::move(handler));
+  }
+
+  // Mustn't be called from a wrapped handler, which it would wait for forever.
+  void Close() {
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    state_->open = false;
+    state_->idle.wait(lock, [this] { return state_->running == 0; });
+  }
+
+ private:
+  HandlerGuard(const HandlerGuard&);
+  HandlerGuard& operator=(const HandlerGuard&);
+
+  const std::shared_ptr<State> state_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_HANDLER_GUARD_H_
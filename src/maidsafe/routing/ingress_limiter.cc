@@ -0,0 +1,59 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/ingress_limiter.h"
+
+#include <cassert>
+
+namespace maidsafe {
+
+namespace routing {
+
+IngressLimiter::IngressLimiter(size_t capacity)
+    : mutex_(), kCapacity_(capacity), size_(0), dropped_count_(0) {}
+
+bool IngressLimiter::TryAdmit(bool high_priority) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const size_t kLimit(high_priority ? kCapacity_ : kCapacity_ - kCapacity_ / 4);
+  if (size_ >= kLimit) {
+    ++dropped_count_;
+    return false;
+  }
+  ++size_;
+  return true;
+}
+
+void IngressLimiter::Release() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  assert(size_ > 0);
+  --size_;
+}
+
+size_t IngressLimiter::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return size_;
+}
+
+uint64_t IngressLimiter::dropped_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return dropped_count_;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
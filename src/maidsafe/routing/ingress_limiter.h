@@ -0,0 +1,56 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_INGRESS_LIMITER_H_
+#define MAIDSAFE_ROUTING_INGRESS_LIMITER_H_
+
+#include <cstdint>
+#include <mutex>
+
+namespace maidsafe {
+
+namespace routing {
+
+// Bounds the number of received messages posted for handling but not yet handled.  Once
+// three quarters of kCapacity_ is in use, only high priority messages are admitted; once it is all
+// in use, nothing is.  Every refusal is counted.
+class IngressLimiter {
+ public:
+  explicit IngressLimiter(size_t capacity);
+  // Returns false if the message should be dropped.  Each true return must be paired with Release.
+  bool TryAdmit(bool high_priority);
+  void Release();
+  size_t size() const;
+  uint64_t dropped_count() const;
+
+ private:
+  IngressLimiter(const IngressLimiter&);
+  IngressLimiter(const IngressLimiter&&);
+  IngressLimiter& operator=(const IngressLimiter&);
+
+  mutable std::mutex mutex_;
+  const size_t kCapacity_;
+  size_t size_;
+  uint64_t dropped_count_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_INGRESS_LIMITER_H_
@@ -0,0 +1,68 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_INLINE_VECTOR_H_
+#define MAIDSAFE_ROUTING_INLINE_VECTOR_H_
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+
+namespace maidsafe {
+
+namespace routing {
+
+// A vector of at most N elements, held in place rather than on the heap, for short lists whose
+// bound is known at compile time (e.g. a group's holders).  Pushing more than N is a programming
+// error.  Cleared elements aren't destroyed until they're overwritten or the InlineVector is, so T
+// should be cheap to keep, e.g. a pointer.
+template <typename T, size_t N>
+class InlineVector {
+ public:
+  typedef T value_type;
+  typedef T* iterator;
+  typedef const T* const_iterator;
+
+  InlineVector() : elements_(), size_(0) {}
+
+  void push_back(const T& value) {
+    assert(size_ < N);
+    elements_[size_++] = value;
+  }
+  void clear() { size_ = 0; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  static size_t capacity() { return N; }
+
+  T& operator[](size_t index) { return elements_[index]; }
+  const T& operator[](size_t index) const { return elements_[index]; }
+  iterator begin() { return elements_.data(); }
+  iterator end() { return elements_.data() + size_; }
+  const_iterator begin() const { return elements_.data(); }
+  const_iterator end() const { return elements_.data() + size_; }
+
+ private:
+  std::array<T, N> elements_;
+  size_t size_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_INLINE_VECTOR_H_
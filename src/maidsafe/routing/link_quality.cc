@@ -0,0 +1,117 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/link_quality.h"
+
+#include <algorithm>
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+// Weight given to each new sample, as for TCP's smoothed round trip time.
+const int kSampleWeightDivisor(8);
+// Avoids treating a very lossy link as infinitely costly.
+const double kMaxLossRate(0.9);
+
+}  // unnamed namespace
+
+LinkQuality::LinkQuality() : mutex_(), estimates_(), last_stamp_(0), total_loss_rate_(0.0) {}
+
+uint64_t LinkQuality::ProbeSent(const NodeId& peer) {
+  uint64_t now(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+      Clock::now().time_since_epoch()).count()));
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Stamps are unique and non-zero, even for probes sent within the same microsecond.
+  last_stamp_ = std::max(now, last_stamp_ + 1);
+  Estimate& estimate(estimates_[peer]);
+  if (estimate.outstanding_stamp != 0) {
+    double increase((1.0 - estimate.loss_rate) / kSampleWeightDivisor);
+    estimate.loss_rate += increase;
+    total_loss_rate_ += increase;
+  }
+  estimate.outstanding_stamp = last_stamp_;
+  return last_stamp_;
+}
+
+void LinkQuality::ProbeAnswered(const NodeId& peer, uint64_t stamp) {
+  std::chrono::microseconds sample(std::chrono::duration_cast<std::chrono::microseconds>(
+      Clock::now().time_since_epoch()).count() - static_cast<int64_t>(stamp));
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(estimates_.find(peer));
+  if (itr == estimates_.end() || stamp == 0 || itr->second.outstanding_stamp != stamp)
+    return;
+  Estimate& estimate(itr->second);
+  estimate.outstanding_stamp = 0;
+  double decrease(estimate.loss_rate / kSampleWeightDivisor);
+  estimate.loss_rate -= decrease;
+  total_loss_rate_ -= decrease;
+  sample = std::max(sample, std::chrono::microseconds(1));
+  if (estimate.smoothed_rtt == std::chrono::microseconds())
+    estimate.smoothed_rtt = sample;
+  else
+    estimate.smoothed_rtt += (sample - estimate.smoothed_rtt) / kSampleWeightDivisor;
+}
+
+void LinkQuality::Remove(const NodeId& peer) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(estimates_.find(peer));
+  if (itr == estimates_.end())
+    return;
+  total_loss_rate_ -= itr->second.loss_rate;
+  estimates_.erase(itr);
+  // Stops rounding errors accumulating over the node's lifetime.
+  if (estimates_.empty())
+    total_loss_rate_ = 0.0;
+}
+
+bool LinkQuality::Cost(const NodeId& peer, std::chrono::microseconds& cost) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(estimates_.find(peer));
+  if (itr == estimates_.end() || itr->second.smoothed_rtt == std::chrono::microseconds())
+    return false;
+  double transmissions(1.0 / (1.0 - std::min(itr->second.loss_rate, kMaxLossRate)));
+  cost = std::chrono::microseconds(
+      static_cast<int64_t>(static_cast<double>(itr->second.smoothed_rtt.count()) * transmissions));
+  return true;
+}
+
+std::chrono::microseconds LinkQuality::SmoothedRtt(const NodeId& peer) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(estimates_.find(peer));
+  return itr == estimates_.end() ? std::chrono::microseconds() : itr->second.smoothed_rtt;
+}
+
+double LinkQuality::LossRate(const NodeId& peer) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(estimates_.find(peer));
+  return itr == estimates_.end() ? 0.0 : itr->second.loss_rate;
+}
+
+double LinkQuality::MeanLossRate() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (estimates_.empty())
+    return 0.0;
+  return std::max(0.0, total_loss_rate_) / static_cast<double>(estimates_.size());
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
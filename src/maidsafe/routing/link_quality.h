@@ -0,0 +1,75 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_LINK_QUALITY_H_
+#define MAIDSAFE_ROUTING_LINK_QUALITY_H_
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+#include "maidsafe/common/node_id.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// Smoothed round trip time and loss estimates for connected peers, fed by routing-level pings.
+// At most one probe per peer is outstanding; sending the next one counts the previous as lost.
+class LinkQuality {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  LinkQuality();
+  // Returns the stamp to be carried by, and echoed back in answer to, the probe.
+  uint64_t ProbeSent(const NodeId& peer);
+  // Answers to anything other than the peer's outstanding probe are ignored.
+  void ProbeAnswered(const NodeId& peer, uint64_t stamp);
+  void Remove(const NodeId& peer);
+  // Returns false if the peer hasn't answered a probe yet.  Otherwise, cost is the smoothed round
+  // trip time scaled by the expected number of transmissions given the loss estimate.
+  bool Cost(const NodeId& peer, std::chrono::microseconds& cost) const;
+  std::chrono::microseconds SmoothedRtt(const NodeId& peer) const;
+  double LossRate(const NodeId& peer) const;
+  // Over all peers with an estimate.  Kept as a running total, so this costs the same however many
+  // peers there are.
+  double MeanLossRate() const;
+
+ private:
+  LinkQuality(const LinkQuality&);
+  LinkQuality& operator=(const LinkQuality&);
+
+  struct Estimate {
+    Estimate() : smoothed_rtt(), loss_rate(0.0), outstanding_stamp(0) {}
+    std::chrono::microseconds smoothed_rtt;  // zero until the first answer
+    double loss_rate;
+    uint64_t outstanding_stamp;  // zero if no probe is outstanding
+  };
+
+  mutable std::mutex mutex_;
+  std::map<NodeId, Estimate> estimates_;
+  uint64_t last_stamp_;
+  double total_loss_rate_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_LINK_QUALITY_H_
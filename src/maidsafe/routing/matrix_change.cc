@@ -18,111 +18,265 @@
 
 #include "maidsafe/routing/matrix_change.h"
 
+#include <algorithm>
+#include <future>
 #include <limits>
+#include <thread>
 #include <utility>
 
+#include "maidsafe/routing/inline_vector.h"
 #include "maidsafe/routing/parameters.h"
 #include "maidsafe/routing/utils.h"
+#include "maidsafe/routing/xor_distance.h"
 
 namespace maidsafe {
 
 namespace routing {
 
+namespace {
+
+// For matrices not published by a GroupMatrix.  Those usually arrive in this order too, so often
+// no sort is needed.
+std::vector<NodeId> SortedToTarget(std::vector<NodeId> ids, const NodeId& target) {
+  auto closer([&target](const NodeId& lhs, const NodeId& rhs) {
+    return NodeId::CloserToTarget(lhs, rhs, target);
+  });
+  if (!std::is_sorted(std::begin(ids), std::end(ids), closer))
+    std::sort(std::begin(ids), std::end(ids), closer);
+  return ids;
+}
+
+// Below this many targets per core, a batch isn't worth splitting across threads.
+const size_t kMinTargetsPerThread(256);
+
+// An id from the old or new matrix along with which of them it appears in.
+struct HolderCandidate {
+  NodeId node_id;
+  bool in_old, in_new;
+};
+
+typedef std::pair<XorDistance, const HolderCandidate*> RankedCandidate;
+
+// The group size CheckHoldersInRange works to, and the lists it keeps a target's holders in.
+// FixedGroup is for a size known at compile time, which keeps the lists on the stack and lets the
+// loops bounded by it be unrolled.
+template <size_t kGroupSize>
+struct FixedGroup {
+  static size_t size() { return kGroupSize; }
+  typedef InlineVector<const HolderCandidate*, kGroupSize> Holders;
+};
+
+struct RuntimeGroup {
+  static size_t size() { return Parameters::group_size; }
+  typedef std::vector<const HolderCandidate*> Holders;
+};
+
+// Fills results[begin, end) as MatrixChange::CheckHolders would for targets[begin, end).
+// candidates is the union of the old and new matrices of the MatrixChange with node_id and radius.
+template <typename Group>
+void CheckHoldersInRange(const std::vector<HolderCandidate>& candidates, const NodeId& node_id,
+                         const XorDistance& radius, const std::vector<NodeId>& targets,
+                         size_t begin, size_t end, std::vector<CheckHoldersResult>& results) {
+  auto by_distance([](const RankedCandidate& lhs, const RankedCandidate& rhs) {
+    return lhs.first < rhs.first;
+  });
+  std::vector<RankedCandidate> ranked;
+  ranked.reserve(candidates.size());
+  typename Group::Holders old_holders, new_holders;
+  for (size_t index(begin); index != end; ++index) {
+    const NodeId& target(targets[index]);
+    CheckHoldersResult& result(results[index]);
+    result.new_holders.clear();
+    result.old_holders.clear();
+
+    ranked.clear();
+    for (const auto& candidate : candidates) {
+      if (candidate.node_id != target)
+        ranked.push_back(std::make_pair(XorDistance(candidate.node_id, target), &candidate));
+    }
+    // Only the closest few are needed, so candidates are sorted a slice at a time until both lists
+    // are full.  One slice of twice the group size nearly always does.
+    old_holders.clear();
+    new_holders.clear();
+    auto sorted_end(std::begin(ranked));
+    for (auto itr(std::begin(ranked)); itr != std::end(ranked) &&
+             (old_holders.size() < Group::size() || new_holders.size() < Group::size()); ++itr) {
+      if (itr == sorted_end) {
+        sorted_end += std::min<ptrdiff_t>(2 * Group::size(), std::end(ranked) - itr);
+        std::partial_sort(itr, sorted_end, std::end(ranked), by_distance);
+      }
+      if (itr->second->in_old && old_holders.size() < Group::size())
+        old_holders.push_back(itr->second);
+      if (itr->second->in_new && new_holders.size() < Group::size())
+        new_holders.push_back(itr->second);
+    }
+
+    // As GetProximalRange, with this node as both node_id and this_node_id.
+    if (target == node_id) {
+      result.proximity_status = GroupRangeStatus::kOutwithRange;
+    } else if (std::any_of(std::begin(new_holders), std::end(new_holders),
+                           [&node_id](const HolderCandidate* holder) {
+                             return holder->node_id == node_id;
+                           })) {
+      result.proximity_status = GroupRangeStatus::kInRange;
+    } else {
+      result.proximity_status = XorDistance(node_id, target) < radius
+                                    ? GroupRangeStatus::kInProximalRange
+                                    : GroupRangeStatus::kOutwithRange;
+    }
+    if (GroupRangeStatus::kInRange != result.proximity_status)
+      continue;
+    // Old holders = Old holders ∩ Lost nodes, i.e. old holders not in the new matrix
+    for (const auto& holder : old_holders) {
+      if (!holder->in_new)
+        result.old_holders.push_back(holder->node_id);
+    }
+    // New holders = All new holders - Old holders, i.e. new holders not among the old ones
+    for (const auto& holder : new_holders) {
+      if (std::find(std::begin(old_holders), std::end(old_holders), holder) ==
+          std::end(old_holders))
+        result.new_holders.push_back(holder->node_id);
+    }
+  }
+}
+
+// Calls function(begin, end) over consecutive sub-ranges of [0, count), on several threads if
+// count is large enough to be worth it.
+template <typename Function>
+void ForEachChunk(size_t count, Function function) {
+  size_t thread_count(std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1U),
+                                       count / kMinTargetsPerThread));
+  if (thread_count < 2) {
+    function(0, count);
+    return;
+  }
+  size_t chunk_size((count + thread_count - 1) / thread_count);
+  std::vector<std::future<void>> chunks;
+  for (size_t begin(chunk_size); begin < count; begin += chunk_size)
+    chunks.push_back(std::async(std::launch::async, function, begin,
+                                std::min(begin + chunk_size, count)));
+  function(0, chunk_size);
+  for (auto& chunk : chunks)
+    chunk.get();
+}
+
+}  // unnamed namespace
+
 MatrixChange::MatrixChange()
     : node_id_(),
-      old_matrix_(),
-      new_matrix_(),
+      old_members_(std::make_shared<const MatrixMembers>()),
+      new_members_(old_members_),
+      difference_mutex_(),
+      difference_computed_(true),
       lost_nodes_(),
       new_nodes_(),
-      radius_() {}
+      radius_(),
+      epoch_(0) {}
 
 MatrixChange::MatrixChange(const MatrixChange& other)
     : node_id_(other.node_id_),
-      old_matrix_(other.old_matrix_),
-      new_matrix_(other.new_matrix_),
-      lost_nodes_(other.lost_nodes_),
-      new_nodes_(other.new_nodes_),
-      radius_(other.radius_) {}
+      old_members_(other.old_members_),
+      new_members_(other.new_members_),
+      difference_mutex_(),
+      difference_computed_(false),
+      lost_nodes_(),
+      new_nodes_(),
+      radius_(other.radius_),
+      epoch_(other.epoch_) {
+  std::lock_guard<std::mutex> lock(other.difference_mutex_);
+  difference_computed_ = other.difference_computed_;
+  lost_nodes_ = other.lost_nodes_;
+  new_nodes_ = other.new_nodes_;
+}
 
 MatrixChange::MatrixChange(MatrixChange&& other)
     : node_id_(std::move(other.node_id_)),
-      old_matrix_(std::move(other.old_matrix_)),
-      new_matrix_(std::move(other.new_matrix_)),
+      old_members_(std::move(other.old_members_)),
+      new_members_(std::move(other.new_members_)),
+      difference_mutex_(),
+      difference_computed_(other.difference_computed_),
       lost_nodes_(std::move(other.lost_nodes_)),
       new_nodes_(std::move(other.new_nodes_)),
-      radius_(std::move(other.radius_)) {}
+      radius_(std::move(other.radius_)),
+      epoch_(other.epoch_) {}
 
 MatrixChange& MatrixChange::operator=(MatrixChange other) {
   swap(*this, other);
   return *this;
 }
 
-MatrixChange::MatrixChange(NodeId this_node_id, const std::vector<NodeId>& old_matrix,
-                           const std::vector<NodeId>& new_matrix)
+MatrixChange::MatrixChange(NodeId this_node_id, std::vector<NodeId> old_matrix,
+                           std::vector<NodeId> new_matrix)
     : node_id_(std::move(this_node_id)),
-      old_matrix_([this](std::vector<NodeId> old_matrix_in)->std::vector<NodeId> {
-        std::sort(std::begin(old_matrix_in), std::end(old_matrix_in),
-                  [this](const NodeId & lhs, const NodeId & rhs) {
-          return NodeId::CloserToTarget(lhs, rhs, node_id_);
-        });
-        return old_matrix_in;
-      }(old_matrix)),
-      new_matrix_([this](std::vector<NodeId> new_matrix_in)->std::vector<NodeId> {
-        std::sort(std::begin(new_matrix_in), std::end(new_matrix_in),
-                  [this](const NodeId & lhs, const NodeId & rhs) {
-          return NodeId::CloserToTarget(lhs, rhs, node_id_);
-        });
-        return new_matrix_in;
-      }(new_matrix)),
-      lost_nodes_([this]()->std::vector<NodeId> {
-        std::vector<NodeId> lost_nodes;
-        std::set_difference(std::begin(old_matrix_), std::end(old_matrix_), std::begin(new_matrix_),
-                            std::end(new_matrix_), std::back_inserter(lost_nodes),
-                            [this](const NodeId & lhs, const NodeId & rhs) {
-          return NodeId::CloserToTarget(lhs, rhs, node_id_);
-        });
-        return lost_nodes;
-      }()),
-      new_nodes_([this]()->std::vector<NodeId> {
-        std::vector<NodeId> new_nodes;
-        std::set_difference(std::begin(new_matrix_), std::end(new_matrix_), std::begin(old_matrix_),
-                            std::end(old_matrix_), std::back_inserter(new_nodes),
-                            [this](const NodeId & lhs, const NodeId & rhs) {
-          return NodeId::CloserToTarget(lhs, rhs, node_id_);
-        });
-        return new_nodes;
-      }()),
-      radius_([this]()->crypto::BigInt {
-        NodeId fcn_distance;
-        if (new_matrix_.size() >= Parameters::closest_nodes_size)
-          fcn_distance = node_id_ ^ new_matrix_[Parameters::closest_nodes_size - 1];
-        else
-          fcn_distance = node_id_ ^ (NodeId(NodeId::kMaxId));  // FIXME
-        return (crypto::BigInt(
-                    (fcn_distance.ToStringEncoded(NodeId::EncodingType::kHex) + 'h').c_str()) *
-                Parameters::proximity_factor);
-      }()) {}
+      old_members_(std::make_shared<const MatrixMembers>(
+          0, SortedToTarget(std::move(old_matrix), node_id_))),
+      new_members_(std::make_shared<const MatrixMembers>(
+          0, SortedToTarget(std::move(new_matrix), node_id_))),
+      difference_mutex_(),
+      difference_computed_(false),
+      lost_nodes_(),
+      new_nodes_(),
+      radius_(Radius()),
+      epoch_(0) {}
+
+MatrixChange::MatrixChange(NodeId this_node_id, std::shared_ptr<const MatrixMembers> old_members,
+                           std::shared_ptr<const MatrixMembers> new_members)
+    : node_id_(std::move(this_node_id)),
+      old_members_(std::move(old_members)),
+      new_members_(std::move(new_members)),
+      difference_mutex_(),
+      difference_computed_(false),
+      lost_nodes_(),
+      new_nodes_(),
+      radius_(Radius()),
+      epoch_(0) {
+  assert(std::is_sorted(std::begin(old_matrix()), std::end(old_matrix()),
+                        [this](const NodeId& lhs, const NodeId& rhs) {
+                          return NodeId::CloserToTarget(lhs, rhs, node_id_);
+                        }));
+}
+
+XorDistance MatrixChange::Radius() const {
+  NodeId fcn_distance;
+  if (new_matrix().size() >= Parameters::closest_nodes_size)
+    fcn_distance = node_id_ ^ new_matrix()[Parameters::closest_nodes_size - 1];
+  else
+    fcn_distance = node_id_ ^ (NodeId(NodeId::kMaxId));  // FIXME
+  return XorDistance(fcn_distance) * Parameters::proximity_factor;
+}
+
+std::vector<NodeId> MatrixChange::lost_nodes() const {
+  ComputeDifference();
+  return lost_nodes_;
+}
+
+std::vector<NodeId> MatrixChange::new_nodes() const {
+  ComputeDifference();
+  return new_nodes_;
+}
+
+void MatrixChange::ComputeDifference() const {
+  std::lock_guard<std::mutex> lock(difference_mutex_);
+  if (difference_computed_)
+    return;
+  auto closer([this](const NodeId& lhs, const NodeId& rhs) {
+    return NodeId::CloserToTarget(lhs, rhs, node_id_);
+  });
+  const std::vector<NodeId>& old_ids(old_matrix()), & new_ids(new_matrix());
+  std::set_difference(std::begin(old_ids), std::end(old_ids), std::begin(new_ids),
+                      std::end(new_ids), std::back_inserter(lost_nodes_), closer);
+  std::set_difference(std::begin(new_ids), std::end(new_ids), std::begin(old_ids),
+                      std::end(old_ids), std::back_inserter(new_nodes_), closer);
+  difference_computed_ = true;
+}
 
 CheckHoldersResult MatrixChange::CheckHolders(const NodeId& target) const {
+  ComputeDifference();
   // Handle cases of lower number of group matrix nodes
   size_t group_size_adjust(Parameters::group_size + 1U);
-  size_t old_holders_size = std::min(old_matrix_.size(), group_size_adjust);
-  size_t new_holders_size = std::min(new_matrix_.size(), group_size_adjust);
-
-  std::vector<NodeId> old_holders(old_holders_size), new_holders(new_holders_size),
-      lost_nodes(lost_nodes_);
-  std::partial_sort_copy(std::begin(old_matrix_), std::end(old_matrix_), std::begin(old_holders),
-                         std::end(old_holders), [target](const NodeId & lhs, const NodeId & rhs) {
-    return NodeId::CloserToTarget(lhs, rhs, target);
-  });
-  std::partial_sort_copy(std::begin(new_matrix_), std::end(new_matrix_), std::begin(new_holders),
-                         std::end(new_holders), [target](const NodeId & lhs, const NodeId & rhs) {
-    return NodeId::CloserToTarget(lhs, rhs, target);
-  });
-  std::sort(std::begin(lost_nodes), std::end(lost_nodes),
-            [target](const NodeId & lhs, const NodeId & rhs) {
-    return NodeId::CloserToTarget(lhs, rhs, target);
-  });
+  std::vector<NodeId> old_holders(RankIdsFromTarget(old_matrix(), target, group_size_adjust)),
+      new_holders(RankIdsFromTarget(new_matrix(), target, group_size_adjust)),
+      lost_nodes(RankIdsFromTarget(lost_nodes_, target, lost_nodes_.size()));
 
   // Remove target == node ids and adjust holder size
   old_holders.erase(std::remove(std::begin(old_holders), std::end(old_holders), target),
@@ -163,13 +317,55 @@ CheckHoldersResult MatrixChange::CheckHolders(const NodeId& target) const {
   return holders_result;
 }
 
+void MatrixChange::CheckHolders(const std::vector<NodeId>& targets,
+                                std::vector<CheckHoldersResult>& results) const {
+  ComputeDifference();
+  // Each target then needs a single ranking of the union of both matrices rather than one of each
+  // matrix plus one of the lost nodes.
+  std::vector<HolderCandidate> candidates;
+  candidates.reserve(old_matrix().size() + new_matrix().size());
+  auto closer([this](const NodeId& lhs, const NodeId& rhs) {
+    return NodeId::CloserToTarget(lhs, rhs, node_id_);
+  });
+  auto old_itr(std::begin(old_matrix())), new_itr(std::begin(new_matrix()));
+  while (old_itr != std::end(old_matrix()) || new_itr != std::end(new_matrix())) {
+    HolderCandidate candidate;
+    if (new_itr == std::end(new_matrix()) ||
+        (old_itr != std::end(old_matrix()) && closer(*old_itr, *new_itr))) {
+      candidate.node_id = *old_itr++;
+      candidate.in_old = true;
+      candidate.in_new = false;
+    } else if (old_itr == std::end(old_matrix()) || closer(*new_itr, *old_itr)) {
+      candidate.node_id = *new_itr++;
+      candidate.in_old = false;
+      candidate.in_new = true;
+    } else {
+      candidate.node_id = *old_itr++;
+      ++new_itr;
+      candidate.in_old = candidate.in_new = true;
+    }
+    candidates.push_back(candidate);
+  }
+
+  results.resize(targets.size());
+  ForEachChunk(targets.size(), [&](size_t begin, size_t end) {
+    if (Parameters::group_size == Parameters::kDefaultGroupSize) {
+      CheckHoldersInRange<FixedGroup<Parameters::kDefaultGroupSize>>(
+          candidates, node_id_, radius_, targets, begin, end, results);
+    } else {
+      CheckHoldersInRange<RuntimeGroup>(candidates, node_id_, radius_, targets, begin, end,
+                                        results);
+    }
+  });
+}
+
 NodeId MatrixChange::ChoosePmidNode(const std::set<NodeId>& online_pmids,
                                     const NodeId& target) const {
   if (online_pmids.empty())
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
 
   LOG(kInfo) << "MatrixChange::ChoosePmidNode having following new_matrix_ : ";
-  for (auto id : new_matrix_)
+  for (auto id : new_matrix())
     LOG(kInfo) << "       new_matrix_ ids     ---  " << HexSubstr(id.string());
   LOG(kInfo) << "MatrixChange::ChoosePmidNode having target : "
                 << HexSubstr(target.string()) << " and following online_pmids : ";
@@ -179,7 +375,7 @@ NodeId MatrixChange::ChoosePmidNode(const std::set<NodeId>& online_pmids,
   // In case storing to PublicPmid, the data shall not be stored on the Vault itself
   // However, the vault will appear in DM's routing table and affect result
   std::vector<NodeId> temp(Parameters::group_size + 1);
-  std::partial_sort_copy(std::begin(new_matrix_), std::end(new_matrix_), std::begin(temp),
+  std::partial_sort_copy(std::begin(new_matrix()), std::end(new_matrix()), std::begin(temp),
                          std::end(temp), [&target](const NodeId& lhs, const NodeId& rhs) {
     return NodeId::CloserToTarget(lhs, rhs, target);
   });
@@ -201,27 +397,58 @@ NodeId MatrixChange::ChoosePmidNode(const std::set<NodeId>& online_pmids,
   return *pmids_itr;
 }
 
+std::vector<NodeId> MatrixChange::ChoosePmidNodes(const std::vector<NodeId>& online_pmids,
+                                                  const std::vector<NodeId>& targets) const {
+  if (online_pmids.empty())
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  assert(std::is_sorted(std::begin(online_pmids), std::end(online_pmids)));
+
+  // ChoosePmidNode walks the pmids once per id closer to target than this node, so only this
+  // node's rank is needed, which is a count rather than a sort.
+  std::vector<NodeId> chosen(targets.size());
+  ForEachChunk(targets.size(), [&](size_t begin, size_t end) {
+    for (size_t index(begin); index != end; ++index) {
+      XorDistance own_distance(node_id_, targets[index]);
+      size_t rank(0);
+      for (const auto& node_id : new_matrix()) {
+        if (XorDistance(node_id, targets[index]) < own_distance)
+          ++rank;
+      }
+      assert(rank <= Parameters::group_size);
+      chosen[index] = online_pmids[rank % online_pmids.size()];
+    }
+  });
+  return chosen;
+}
+
 bool MatrixChange::OldEqualsToNew() const {
-  return old_matrix_ == new_matrix_;
+  return old_members_ == new_members_ || old_matrix() == new_matrix();
 }
 
 void swap(MatrixChange& lhs, MatrixChange& rhs) MAIDSAFE_NOEXCEPT {
   using std::swap;
   swap(lhs.node_id_, rhs.node_id_);
-  swap(lhs.old_matrix_, rhs.old_matrix_);
-  swap(lhs.new_matrix_, rhs.new_matrix_);
+  swap(lhs.old_members_, rhs.old_members_);
+  swap(lhs.new_members_, rhs.new_members_);
+  std::lock(lhs.difference_mutex_, rhs.difference_mutex_);
+  std::lock_guard<std::mutex> lhs_lock(lhs.difference_mutex_, std::adopt_lock);
+  std::lock_guard<std::mutex> rhs_lock(rhs.difference_mutex_, std::adopt_lock);
+  swap(lhs.difference_computed_, rhs.difference_computed_);
   swap(lhs.lost_nodes_, rhs.lost_nodes_);
+  swap(lhs.new_nodes_, rhs.new_nodes_);
   swap(lhs.radius_, rhs.radius_);
+  swap(lhs.epoch_, rhs.epoch_);
 }
 
 void MatrixChange::Print() {
+  ComputeDifference();
   std::string tab("\t"), output("\nMatrix of Node " + DebugId(node_id_) +
                                 " having following entries in old_matrix_ :");
-  for (auto entry : old_matrix_)
+  for (auto entry : old_matrix())
     output.append("\n" + tab + tab+ "entry in old_matrix" + tab + "------" + tab + DebugId(entry));
   output.append("\nMatrix of Node " + DebugId(node_id_) +
                 " having following entries in new_matrix_ :");
-  for (auto entry : new_matrix_)
+  for (auto entry : new_matrix())
     output.append("\n" + tab + tab+ "entry in new_matrix" + tab + "------" + tab + DebugId(entry));
   output.append("\nMatrix of Node " + DebugId(node_id_) +
                 " having following entries in lost_nodes_ :");
@@ -0,0 +1,206 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/matrix_snapshot.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <new>
+
+#include "boost/interprocess/mapped_region.hpp"
+#include "boost/interprocess/shared_memory_object.hpp"
+
+#include "maidsafe/common/error.h"
+
+namespace bi = boost::interprocess;
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace detail {
+
+// The region's layout.  Only lock-free atomics are used, being the only ones which work across
+// processes.
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "Matrix snapshots need lock-free atomic integers");
+
+const size_t kMaxMatrixEntries(320);
+
+struct MatrixSnapshotEntry {
+  std::array<char, NodeId::kSize> node_id;
+  int32_t type;
+};
+
+struct MatrixSnapshotSlot {
+  std::atomic<uint32_t> in_use;
+  std::atomic<uint32_t> sequence;  // odd while the slot is being written
+  std::array<char, NodeId::kSize> node_id;
+  uint32_t entry_count;
+  std::array<MatrixSnapshotEntry, kMaxMatrixEntries> entries;
+};
+
+const uint32_t kRegionMagic(0x4d534e50), kRegionVersion(1);
+const size_t kSlotCount(512);
+
+struct MatrixSnapshotRegion {
+  uint32_t magic, version;
+  std::array<MatrixSnapshotSlot, kSlotCount> slots;
+};
+
+}  // namespace detail
+
+namespace {
+
+const int kReadAttempts(4);
+
+detail::MatrixSnapshotRegion& RegionIn(bi::mapped_region& region) {
+  return *static_cast<detail::MatrixSnapshotRegion*>(region.get_address());
+}
+
+void BeginWrite(detail::MatrixSnapshotSlot& slot) {
+  slot.sequence.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+void EndWrite(detail::MatrixSnapshotSlot& slot) {
+  slot.sequence.fetch_add(1, std::memory_order_release);
+}
+
+void WriteEntries(detail::MatrixSnapshotSlot& slot, const MatrixEntries& entries) {
+  slot.entry_count = static_cast<uint32_t>(std::min(entries.size(), detail::kMaxMatrixEntries));
+  for (uint32_t i(0); i != slot.entry_count; ++i) {
+    std::memcpy(slot.entries[i].node_id.data(), entries[i].first.string().data(), NodeId::kSize);
+    slot.entries[i].type = static_cast<int32_t>(entries[i].second);
+  }
+}
+
+bool ReadSlot(const detail::MatrixSnapshotSlot& slot, uint32_t sequence,
+              MatrixSnapshot& snapshot) {
+  const uint32_t kEntryCount(std::min(slot.entry_count,
+                                      static_cast<uint32_t>(detail::kMaxMatrixEntries)));
+  std::string node_id(slot.node_id.data(), NodeId::kSize);
+  MatrixEntries entries;
+  entries.reserve(kEntryCount);
+  for (uint32_t i(0); i != kEntryCount; ++i) {
+    entries.emplace_back(NodeId(std::string(slot.entries[i].node_id.data(), NodeId::kSize)),
+                         static_cast<MatrixEntryType>(slot.entries[i].type));
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (slot.sequence.load(std::memory_order_relaxed) != sequence)
+    return false;
+  snapshot.node_id = NodeId(node_id);
+  snapshot.entries.swap(entries);
+  return true;
+}
+
+}  // unnamed namespace
+
+const char kMatrixSnapshotRegionName[] = "maidsafe_routing_matrix_snapshots";
+
+MatrixSnapshot::MatrixSnapshot() : node_id(), entries() {}
+
+MatrixSnapshotWriter::MatrixSnapshotWriter(const NodeId& node_id, const std::string& region_name)
+    : region_(), slot_(nullptr) {
+  bi::shared_memory_object shared_memory(bi::open_only, region_name.c_str(), bi::read_write);
+  region_.reset(new bi::mapped_region(shared_memory, bi::read_write));
+  auto& region(RegionIn(*region_));
+  if (region_->get_size() < sizeof(detail::MatrixSnapshotRegion) ||
+      region.magic != detail::kRegionMagic || region.version != detail::kRegionVersion) {
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  for (auto& slot : region.slots) {
+    uint32_t free_slot(0);
+    if (slot.in_use.compare_exchange_strong(free_slot, 1)) {
+      slot_ = &slot;
+      break;
+    }
+  }
+  if (!slot_)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  BeginWrite(*slot_);
+  std::memcpy(slot_->node_id.data(), node_id.string().data(), NodeId::kSize);
+  WriteEntries(*slot_, MatrixEntries());
+  EndWrite(*slot_);
+}
+
+MatrixSnapshotWriter::~MatrixSnapshotWriter() { slot_->in_use.store(0); }
+
+void MatrixSnapshotWriter::Publish(const MatrixEntries& entries) {
+  BeginWrite(*slot_);
+  WriteEntries(*slot_, entries);
+  EndWrite(*slot_);
+}
+
+MatrixSnapshotReader::MatrixSnapshotReader(const std::string& region_name)
+    : kRegionName_(region_name),
+      region_(),
+      sequences_(detail::kSlotCount, 0),
+      last_snapshots_(detail::kSlotCount) {
+  bi::shared_memory_object::remove(kRegionName_.c_str());
+  bi::shared_memory_object shared_memory(bi::create_only, kRegionName_.c_str(), bi::read_write);
+  shared_memory.truncate(sizeof(detail::MatrixSnapshotRegion));
+  region_.reset(new bi::mapped_region(shared_memory, bi::read_write));
+  auto& region(*new (region_->get_address()) detail::MatrixSnapshotRegion);
+  for (auto& slot : region.slots) {
+    slot.in_use.store(0);
+    slot.sequence.store(0);
+    slot.entry_count = 0;
+  }
+  region.version = detail::kRegionVersion;
+  std::atomic_thread_fence(std::memory_order_release);
+  region.magic = detail::kRegionMagic;
+}
+
+MatrixSnapshotReader::~MatrixSnapshotReader() {
+  bi::shared_memory_object::remove(kRegionName_.c_str());
+}
+
+bool MatrixSnapshotReader::Read(std::vector<MatrixSnapshot>& snapshots) {
+  auto& region(RegionIn(*region_));
+  bool changed(false);
+  snapshots.clear();
+  for (size_t index(0); index != detail::kSlotCount; ++index) {
+    const auto& slot(region.slots[index]);
+    if (slot.in_use.load(std::memory_order_acquire) == 0) {
+      // A claimed slot's sequence is only zero again after 2^32 writes, so zero means unread.
+      if (sequences_[index] != 0)
+        changed = true;
+      sequences_[index] = 0;
+      continue;
+    }
+    for (int attempt(0); attempt != kReadAttempts; ++attempt) {
+      const uint32_t kSequence(slot.sequence.load(std::memory_order_acquire));
+      if (kSequence == sequences_[index])
+        break;
+      if (kSequence % 2 == 0 && ReadSlot(slot, kSequence, last_snapshots_[index])) {
+        sequences_[index] = kSequence;
+        changed = true;
+        break;
+      }
+    }
+    if (sequences_[index] != 0)
+      snapshots.push_back(last_snapshots_[index]);
+  }
+  return changed;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
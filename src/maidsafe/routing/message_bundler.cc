@@ -0,0 +1,133 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/message_bundler.h"
+
+#include <memory>
+#include <utility>
+
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/wire_format_lite.h"
+
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+// A field's tag and length prefix, as added to a bundle for each message in it.
+size_t FieldOverhead(size_t size) {
+  return 2 + google::protobuf::io::CodedOutputStream::VarintSize32(static_cast<uint32_t>(size));
+}
+
+}  // unnamed namespace
+
+MessageBundler::MessageBundler(uint32_t max_message_size, uint32_t max_bundle_size)
+    : kMaxMessageSize_(max_message_size), kMaxBundleSize_(max_bundle_size), mutex_(), held_() {}
+
+bool MessageBundler::Add(const NodeId& peer_id, std::string serialised,
+                         rudp::MessageSentFunctor message_sent_functor, std::vector<Send>& ready) {
+  const size_t kSize(serialised.size() + FieldOverhead(serialised.size()));
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (serialised.size() > kMaxMessageSize_ || kSize > kMaxBundleSize_) {
+    // Anything held for the peer goes first, so that it isn't overtaken.
+    auto itr(held_.find(peer_id));
+    if (itr != held_.end()) {
+      ready.push_back(Take(peer_id, itr->second));
+      held_.erase(itr);
+    }
+    Send send;
+    send.peer_id = peer_id;
+    send.serialised.swap(serialised);
+    send.message_sent_functor = std::move(message_sent_functor);
+    ready.push_back(std::move(send));
+    return false;
+  }
+  const bool kWasEmpty(held_.empty());
+  Held& held(held_[peer_id]);
+  if (held.size + kSize > kMaxBundleSize_)
+    ready.push_back(Take(peer_id, held));
+  held.messages.push_back(std::move(serialised));
+  held.functors.push_back(std::move(message_sent_functor));
+  held.size += kSize;
+  return kWasEmpty;
+}
+
+std::vector<MessageBundler::Send> MessageBundler::TakeAll() {
+  std::map<NodeId, Held> held;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    held.swap(held_);
+  }
+  std::vector<Send> sends;
+  sends.reserve(held.size());
+  for (auto& peer : held)
+    sends.push_back(Take(peer.first, peer.second));
+  return sends;
+}
+
+MessageBundler::Send MessageBundler::Take(const NodeId& peer_id, Held& held) {
+  Send send;
+  send.peer_id = peer_id;
+  if (held.messages.size() == 1) {
+    send.serialised.swap(held.messages.front());
+    send.message_sent_functor = std::move(held.functors.front());
+  } else {
+    protobuf::MessageBundle bundle;
+    for (auto& message : held.messages)
+      bundle.add_message()->swap(message);
+    send.serialised = bundle.SerializeAsString();
+    auto functors(std::make_shared<std::vector<rudp::MessageSentFunctor>>());
+    functors->swap(held.functors);
+    send.message_sent_functor = [functors](int result) {
+      for (const auto& functor : *functors) {
+        if (functor)
+          functor(result);
+      }
+    };
+  }
+  held = Held();
+  return send;
+}
+
+bool MessageBundler::Unbundle(const std::string& serialised, std::vector<std::string>& messages) {
+  using google::protobuf::internal::WireFormatLite;
+  google::protobuf::io::CodedInputStream input(
+      reinterpret_cast<const google::protobuf::uint8*>(serialised.data()),
+      static_cast<int>(serialised.size()));
+  if (WireFormatLite::GetTagFieldNumber(input.ReadTag()) !=
+      protobuf::MessageBundle::kMessageFieldNumber) {
+    return false;
+  }
+  protobuf::MessageBundle bundle;
+  if (!bundle.ParseFromString(serialised))
+    return false;
+  messages.clear();
+  messages.reserve(static_cast<size_t>(bundle.message_size()));
+  for (auto& message : *bundle.mutable_message()) {
+    messages.push_back(std::string());
+    messages.back().swap(message);
+  }
+  return true;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
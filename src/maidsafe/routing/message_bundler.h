@@ -0,0 +1,84 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_MESSAGE_BUNDLER_H_
+#define MAIDSAFE_ROUTING_MESSAGE_BUNDLER_H_
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/rudp/managed_connections.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// Packs small serialised messages for the same peer into one MessageBundle, so that a burst of
+// control messages to a peer costs one rudp message rather than one each.  What is held for a
+// peer is handed back by Add once another message wouldn't fit, or else by TakeAll, which the
+// owner calls a short delay after Add first reports something held.  A lone message is handed back
+// as it is, not bundled.
+class MessageBundler {
+ public:
+  struct Send {
+    Send() : peer_id(), serialised(), message_sent_functor() {}
+    NodeId peer_id;
+    std::string serialised;
+    // Fired with the bundle's result for each message in it.
+    rudp::MessageSentFunctor message_sent_functor;
+  };
+
+  MessageBundler(uint32_t max_message_size, uint32_t max_bundle_size);
+  // Appends to ready, in the order to send them, anything to be sent now: whatever was held for
+  // peer_id if serialised doesn't fit with it or is too large to bundle, and then serialised itself
+  // in the latter case.  Returns true if nothing was held for any peer before, but something now
+  // is.
+  bool Add(const NodeId& peer_id, std::string serialised,
+           rudp::MessageSentFunctor message_sent_functor, std::vector<Send>& ready);
+  // Returns and clears everything held.
+  std::vector<Send> TakeAll();
+  // True if serialised is a MessageBundle rather than a Message, in which case its messages are
+  // put in messages.  False if it's not a bundle, or is a malformed one.
+  static bool Unbundle(const std::string& serialised, std::vector<std::string>& messages);
+
+ private:
+  MessageBundler(const MessageBundler&);
+  MessageBundler& operator=(const MessageBundler&);
+
+  struct Held {
+    Held() : messages(), functors(), size(0) {}
+    std::vector<std::string> messages;
+    std::vector<rudp::MessageSentFunctor> functors;
+    size_t size;  // of the bundle they would make
+  };
+  static Send Take(const NodeId& peer_id, Held& held);
+
+  const uint32_t kMaxMessageSize_, kMaxBundleSize_;
+  std::mutex mutex_;
+  std::map<NodeId, Held> held_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_MESSAGE_BUNDLER_H_
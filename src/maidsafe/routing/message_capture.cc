@@ -0,0 +1,142 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/message_capture.h"
+
+#include <cstring>
+#include <limits>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/rudp/managed_connections.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+// In native byte order: kMagic and the capturing node's ID, then for each record its direction,
+// its offset in microseconds, for sent messages the connection ID, and the message's size and
+// bytes.
+const char kMagic[8] = {'M', 'S', 'R', 'C', 'A', 'P', 'T', '1'};
+
+template <typename T>
+void Append(T value, std::string& data) {
+  data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool Read(std::ifstream& file, T& value) {
+  return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+}  // unnamed namespace
+
+const size_t MessageCaptureWriter::kFlushSize;
+
+MessageCaptureWriter::MessageCaptureWriter(const boost::filesystem::path& path,
+                                           const NodeId& this_node_id, uint32_t sample_interval)
+    : kSampleInterval_(sample_interval == 0 ? 1 : sample_interval),
+      kStart_(Clock::now()),
+      count_(0),
+      mutex_(),
+      buffer_(),
+      file_mutex_(),
+      file_(path.string(), std::ios::binary | std::ios::trunc) {
+  file_.write(kMagic, sizeof(kMagic));
+  file_.write(this_node_id.string().data(), NodeId::kSize);
+  file_.flush();
+  if (!file_)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+}
+
+MessageCaptureWriter::~MessageCaptureWriter() { Flush(); }
+
+void MessageCaptureWriter::Record(CaptureDirection direction, const NodeId& connection_id,
+                                  const std::string& serialised) {
+  if (kSampleInterval_ != 1 && count_++ % kSampleInterval_ != 0)
+    return;
+  if (serialised.size() > std::numeric_limits<uint32_t>::max())
+    return;
+  std::unique_lock<std::mutex> lock(mutex_);
+  Append(static_cast<uint8_t>(direction), buffer_);
+  Append(static_cast<uint64_t>(
+             std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - kStart_)
+                 .count()),
+         buffer_);
+  if (direction == CaptureDirection::kSent)
+    buffer_.append(connection_id.string());
+  Append(static_cast<uint32_t>(serialised.size()), buffer_);
+  buffer_.append(serialised);
+  if (buffer_.size() < kFlushSize)
+    return;
+  std::string pending;
+  pending.swap(buffer_);
+  std::lock_guard<std::mutex> file_lock(file_mutex_);
+  lock.unlock();
+  file_.write(pending.data(), pending.size());
+}
+
+void MessageCaptureWriter::Flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  std::string pending;
+  pending.swap(buffer_);
+  std::lock_guard<std::mutex> file_lock(file_mutex_);
+  lock.unlock();
+  file_.write(pending.data(), pending.size());
+  file_.flush();
+}
+
+MessageCaptureReader::MessageCaptureReader(const boost::filesystem::path& path)
+    : file_(path.string(), std::ios::binary), node_id_() {
+  char magic[sizeof(kMagic)];
+  std::string node_id(NodeId::kSize, 0);
+  if (!file_.read(magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+      !file_.read(&node_id[0], NodeId::kSize)) {
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  }
+  node_id_ = NodeId(node_id);
+}
+
+bool MessageCaptureReader::Next(CapturedMessage& message) {
+  uint8_t direction(0);
+  uint64_t offset(0);
+  uint32_t size(0);
+  if (!Read(file_, direction) || !Read(file_, offset) ||
+      direction > static_cast<uint8_t>(CaptureDirection::kSent)) {
+    return false;
+  }
+  message.direction = static_cast<CaptureDirection>(direction);
+  message.offset = std::chrono::microseconds(offset);
+  if (message.direction == CaptureDirection::kSent) {
+    std::string connection_id(NodeId::kSize, 0);
+    if (!file_.read(&connection_id[0], NodeId::kSize))
+      return false;
+    message.connection_id = NodeId(connection_id);
+  } else {
+    message.connection_id = NodeId();
+  }
+  if (!Read(file_, size) || size > rudp::ManagedConnections::kMaxMessageSize())
+    return false;
+  message.serialised.resize(size);
+  return size == 0 || static_cast<bool>(file_.read(&message.serialised[0], size));
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,105 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_MESSAGE_CAPTURE_H_
+#define MAIDSAFE_ROUTING_MESSAGE_CAPTURE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>  // NOLINT
+#include <mutex>
+#include <string>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/node_id.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+enum class CaptureDirection : uint8_t { kReceived = 0, kSent = 1 };
+
+struct CapturedMessage {
+  CapturedMessage() : direction(CaptureDirection::kReceived), offset(), connection_id(),
+                      serialised() {}
+  CaptureDirection direction;
+  std::chrono::microseconds offset;  // since capture began
+  // The connection a sent message left on.  Zero for received messages, as rudp doesn't say which
+  // connection delivered them.
+  NodeId connection_id;
+  std::string serialised;
+};
+
+// Writes serialised messages a node sends and receives to a binary log, for replaying later (see
+// tests/message_replay.h).  Records are appended to a buffer and written out kFlushSize bytes at a
+// time, so recording costs a copy of the message and, for sampled-out messages, only an atomic
+// increment.  Only every sample_interval'th message is recorded.
+class MessageCaptureWriter {
+ public:
+  static const size_t kFlushSize = 64 * 1024;
+
+  // Replaces any file at path.  Throws if it can't be written.
+  MessageCaptureWriter(const boost::filesystem::path& path, const NodeId& this_node_id,
+                       uint32_t sample_interval);
+  // Writes out what is still buffered.
+  ~MessageCaptureWriter();
+  void Record(CaptureDirection direction, const NodeId& connection_id,
+              const std::string& serialised);
+  void Flush();
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  MessageCaptureWriter(const MessageCaptureWriter&);
+  MessageCaptureWriter& operator=(const MessageCaptureWriter&);
+
+  const uint32_t kSampleInterval_;
+  const Clock::time_point kStart_;
+  std::atomic<uint32_t> count_;
+  // Taken before file_mutex_ where both are held, so buffers reach file_ in the order filled.
+  std::mutex mutex_;
+  std::string buffer_;
+  std::mutex file_mutex_;
+  std::ofstream file_;
+};
+
+// Reads back a log written by MessageCaptureWriter.
+class MessageCaptureReader {
+ public:
+  // Throws if path can't be read or isn't a capture.
+  explicit MessageCaptureReader(const boost::filesystem::path& path);
+  // The capturing node's ID.
+  NodeId node_id() const { return node_id_; }
+  // Returns false at the end of the log, or at a truncated record such as a crash leaves.
+  bool Next(CapturedMessage& message);
+
+ private:
+  MessageCaptureReader(const MessageCaptureReader&);
+  MessageCaptureReader& operator=(const MessageCaptureReader&);
+
+  std::ifstream file_;
+  NodeId node_id_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_MESSAGE_CAPTURE_H_
@@ -18,6 +18,9 @@
 
 #include "maidsafe/routing/message_handler.h"
 
+#include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "maidsafe/common/log.h"
@@ -26,10 +29,17 @@
 #include "maidsafe/routing/client_routing_table.h"
 #include "maidsafe/routing/group_change_handler.h"
 #include "maidsafe/routing/message.h"
+#include "maidsafe/routing/message_latency.h"
+#include "maidsafe/routing/message_trace.h"
+#include "maidsafe/routing/metrics.h"
 #include "maidsafe/routing/network_utils.h"
+#include "maidsafe/routing/route_history.h"
 #include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/routing_log.h"
 #include "maidsafe/routing/routing_table.h"
+#include "maidsafe/routing/send_scheduler.h"
 #include "maidsafe/routing/service.h"
+#include "maidsafe/routing/thread_placement.h"
 #include "maidsafe/routing/remove_furthest_node.h"
 #include "maidsafe/routing/utils.h"
 
@@ -39,37 +49,44 @@ namespace routing {
 
 namespace {
 
-SingleToSingleMessage CreateSingleToSingleMessage(const protobuf::Message& proto_message) {
-  return SingleToSingleMessage(proto_message.data(0),
+// The typed message takes over the payload, which proto_message has no further use for.
+std::string TakeContents(protobuf::Message& proto_message) {
+  std::string contents;
+  contents.swap(*proto_message.mutable_data(0));
+  return contents;
+}
+
+SingleToSingleMessage CreateSingleToSingleMessage(protobuf::Message& proto_message) {
+  return SingleToSingleMessage(TakeContents(proto_message),
                                SingleSource(NodeId(proto_message.source_id())),
                                SingleId(NodeId(proto_message.destination_id())),
                                static_cast<Cacheable>(proto_message.cacheable()));
 }
 
-SingleToGroupMessage CreateSingleToGroupMessage(const protobuf::Message& proto_message) {
-  return SingleToGroupMessage(proto_message.data(0),
+SingleToGroupMessage CreateSingleToGroupMessage(protobuf::Message& proto_message) {
+  return SingleToGroupMessage(TakeContents(proto_message),
                               SingleSource(NodeId(proto_message.source_id())),
                               GroupId(NodeId(proto_message.group_destination())),
                               static_cast<Cacheable>(proto_message.cacheable()));
 }
 
-GroupToSingleMessage CreateGroupToSingleMessage(const protobuf::Message& proto_message) {
-  return GroupToSingleMessage(proto_message.data(0),
+GroupToSingleMessage CreateGroupToSingleMessage(protobuf::Message& proto_message) {
+  return GroupToSingleMessage(TakeContents(proto_message),
                               GroupSource(GroupId(NodeId(proto_message.group_source())),
                                           SingleId(NodeId(proto_message.source_id()))),
                               SingleId(NodeId(proto_message.destination_id())),
                               static_cast<Cacheable>(proto_message.cacheable()));
 }
 
-GroupToGroupMessage CreateGroupToGroupMessage(const protobuf::Message& proto_message) {
-  return GroupToGroupMessage(proto_message.data(0),
+GroupToGroupMessage CreateGroupToGroupMessage(protobuf::Message& proto_message) {
+  return GroupToGroupMessage(TakeContents(proto_message),
                              GroupSource(GroupId(NodeId(proto_message.group_source())),
                                          SingleId(NodeId(proto_message.source_id()))),
                              GroupId(NodeId(proto_message.group_destination())),
                              static_cast<Cacheable>(proto_message.cacheable()));
 }
 
-SingleToGroupRelayMessage CreateSingleToGroupRelayMessage(const protobuf::Message& proto_message) {
+SingleToGroupRelayMessage CreateSingleToGroupRelayMessage(protobuf::Message& proto_message) {
   SingleSource single_src(NodeId(proto_message.relay_id()));
   NodeId connection_id(proto_message.relay_connection_id());
   SingleSource single_src_relay_node(NodeId(proto_message.source_id()));
@@ -77,7 +94,7 @@ SingleToGroupRelayMessage CreateSingleToGroupRelayMessage(const protobuf::Messag
                                      connection_id,
                                      single_src_relay_node);
 
-  return SingleToGroupRelayMessage(proto_message.data(0),
+  return SingleToGroupRelayMessage(TakeContents(proto_message),
       single_relay_src,  // relay node
           GroupId(NodeId(proto_message.group_destination())),
               static_cast<Cacheable>(proto_message.cacheable()));
@@ -96,11 +113,13 @@ MessageHandler::MessageHandler(RoutingTable& routing_table,
                                ClientRoutingTable& client_routing_table, NetworkUtils& network,
                                Timer<std::string>& timer, RemoveFurthestNode& remove_furthest_node,
                                GroupChangeHandler& group_change_handler,
-                               NetworkStatistics& network_statistics)
+                               NetworkStatistics& network_statistics,
+                               const InstanceParameters& parameters)
     : routing_table_(routing_table),
       client_routing_table_(client_routing_table),
       network_statistics_(network_statistics),
       network_(network),
+      metrics_(nullptr),
       remove_furthest_node_(remove_furthest_node),
       group_change_handler_(group_change_handler),
       cache_manager_(routing_table_.client_mode()
@@ -108,12 +127,39 @@ MessageHandler::MessageHandler(RoutingTable& routing_table,
                          : (new CacheManager(routing_table_.kNodeId(), network_))),
       timer_(timer),
       response_handler_(new ResponseHandler(routing_table, client_routing_table, network_,
-                                            group_change_handler)),
-      service_(new Service(routing_table, client_routing_table, network_)),
+                                            group_change_handler, parameters)),
+      service_(new Service(routing_table, client_routing_table, network_, parameters)),
       message_received_functor_(),
-      typed_message_received_functors_() {}
+      typed_message_received_functors_(),
+      duplicate_filter_(Parameters::duplicate_filter_window,
+                        Parameters::duplicate_filter_capacity),
+      request_rate_limiter_(parameters.routing_request_rate, parameters.routing_request_burst,
+                            Parameters::max_rate_limited_buckets),
+      stream_reassembler_(parameters.default_response_timeout, Parameters::max_incoming_streams,
+                          Parameters::max_stream_size, Parameters::max_incoming_stream_bytes),
+      upcall_executor_(parameters.upcall_thread_count, Parameters::max_queued_upcalls,
+                       parameters.worker_cpus),
+      signature_verifier_(parameters.signature_thread_count, Parameters::signature_batch_size,
+                          Parameters::signature_verdict_cache_size,
+                          CpusAfter(parameters.worker_cpus, parameters.upcall_thread_count)) {}
 
 void MessageHandler::HandleRoutingMessage(protobuf::Message& message) {
+  // Only requests this node handles itself are limited: those it forwards cost it no more than any
+  // other message, and are for the node handling them to limit.  Repeats never get this far, so
+  // don't use up their source's allowance.
+  if (!request_rate_limiter_.TryAdmit(message)) {
+    ROUTING_LOG(kVerbose) << "Dropping " << MessageTypeString(message) << " from "
+                          << HexSubstr(message.has_source_id() ? message.source_id()
+                                                               : message.relay_id())
+                          << " id: " << message.id() << "; over its rate limit.";
+    if (metrics_)
+      metrics_->Dropped(DropReason::kRateLimited);
+    MessageTrace::Record(message, routing_table_.kNodeId(), TraceDecision::kDropped);
+    return;
+  }
+  if (metrics_)
+    metrics_->Delivered(HopsTaken(message), HopClass::kRouting);
+  MessageTrace::Record(message, routing_table_.kNodeId(), TraceDecision::kDelivered);
   bool request(message.request());
   switch (static_cast<MessageType>(message.type())) {
     case MessageType::kPing:
@@ -136,8 +182,11 @@ void MessageHandler::HandleRoutingMessage(protobuf::Message& message) {
                         : remove_furthest_node_.RemoveResponse(message);
       break;
     case MessageType::kClosestNodesUpdate:
+      if (!message.request()) {
+        group_change_handler_.ResendClosestNodesUpdate(message);
+        break;
+      }
       {
-        assert(message.request());
         auto matrix_update(group_change_handler_.ClosestNodesUpdate(message));
         if (matrix_update.first != NodeId())
           response_handler_->AddMatrixUpdateFromUnvalidatedPeer(matrix_update.first,
@@ -164,71 +213,115 @@ void MessageHandler::HandleRoutingMessage(protobuf::Message& message) {
     network_.SendToClosestNode(message);
 }
 
+protobuf::Message MessageHandler::NodeLevelReplyHeader(const protobuf::Message& request) const {
+  protobuf::Message message_out;
+  message_out.set_request(false);
+  SetHopBudget(network_statistics_.HopBudget(), message_out);
+  message_out.set_destination_id(request.source_id());
+  message_out.set_type(request.type());
+  message_out.set_direct(true);
+  message_out.set_client_node(request.client_node());
+  message_out.set_routing_message(request.routing_message());
+  message_out.set_last_id(routing_table_.kNodeId().string());
+  message_out.set_source_id(routing_table_.kNodeId().string());
+  // Replies to traced requests are traced too, so round trips can be followed.
+  if (request.has_trace_id())
+    message_out.set_trace_id(request.trace_id());
+  if (request.has_id())
+    message_out.set_id(request.id());
+  else
+    ROUTING_LOG(kInfo) << "Message to be sent back had no ID.";
+
+  if (request.has_relay_id())
+    message_out.set_relay_id(request.relay_id());
+
+  if (request.has_relay_connection_id()) {
+    message_out.set_relay_connection_id(request.relay_connection_id());
+  }
+  return message_out;
+}
+
+void MessageHandler::SendNodeLevelReply(protobuf::Message& reply, std::string reply_message) {
+  if (reply_message.empty()) {
+    ROUTING_LOG(kInfo) << "Empty response for message id :" << reply.id();
+    return;
+  }
+  ROUTING_LOG(kSuccess) << " [" << DebugId(routing_table_.kNodeId())
+                        << "] repl : " << MessageTypeString(reply.type(), true) << " from "
+                        << HexSubstr(reply.destination_id()) << "   (id: " << reply.id()
+                        << ")  --NodeLevel Replied--";
+  reply.clear_data();
+  reply.add_data()->swap(reply_message);
+  SetSendPriority(reply);
+  if (routing_table_.client_mode() &&
+      routing_table_.kNodeId().string() == reply.destination_id()) {
+    network_.SendToClosestNode(reply);
+    return;
+  }
+  if (routing_table_.kNodeId().string() != reply.destination_id()) {
+    network_.SendToClosestNode(reply);
+  } else {
+    ROUTING_LOG(kInfo) << "Sending response to self."
+                       << " id: " << reply.id();
+    HandleMessage(reply);
+  }
+}
+
 void MessageHandler::HandleNodeLevelMessageForThisNode(protobuf::Message& message) {
+  if (metrics_)
+    metrics_->Delivered(HopsTaken(message),
+                        message.direct() ? HopClass::kDirect : HopClass::kGroup);
+  MessageTrace::Record(message, routing_table_.kNodeId(), TraceDecision::kDelivered);
   if (IsRequest(message) &&
       !IsClientToClientMessageWithDifferentNodeIds(message, routing_table_.client_mode())) {
-    LOG(kSuccess) << " [" << DebugId(routing_table_.kNodeId())
-                  << "] rcvd : " << MessageTypeString(message) << " from "
-                  << HexSubstr(message.source_id()) << "   (id: " << message.id()
-                  << ")  --NodeLevel--";
-    ReplyFunctor response_functor = [=](const std::string & reply_message) {
-      if (reply_message.empty()) {
-        LOG(kInfo) << "Empty response for message id :" << message.id();
+    ROUTING_LOG(kSuccess) << " [" << DebugId(routing_table_.kNodeId())
+                          << "] rcvd : " << MessageTypeString(message) << " from "
+                          << HexSubstr(message.source_id()) << "   (id: " << message.id()
+                          << ")  --NodeLevel--";
+    if (message.has_stream_id()) {
+      // Each frame is acknowledged once it's held, so a frame which can't be held times out at
+      // the sender and it abandons the stream.  The reassembled payload is handled as a request
+      // with the stream's ID, so the reply to it goes to the sender's task of that ID.
+      protobuf::Message frame_reply(NodeLevelReplyHeader(message));
+      const uint32_t kFrame(message.stream_frame());
+      const StreamReassembler::Result kResult(stream_reassembler_.Add(message));
+      if (kResult == StreamReassembler::Result::kDropped)
         return;
-      }
-      LOG(kSuccess) << " [" << DebugId(routing_table_.kNodeId())
-                    << "] repl : " << MessageTypeString(message) << " from "
-                    << HexSubstr(message.source_id()) << "   (id: " << message.id()
-                    << ")  --NodeLevel Replied--";
-      protobuf::Message message_out;
-      message_out.set_request(false);
-      message_out.set_hops_to_live(Parameters::hops_to_live);
-      message_out.set_destination_id(message.source_id());
-      message_out.set_type(message.type());
-      message_out.set_direct(true);
-      message_out.clear_data();
-      message_out.set_client_node(message.client_node());
-      message_out.set_routing_message(message.routing_message());
-      message_out.add_data(reply_message);
-      message_out.set_last_id(routing_table_.kNodeId().string());
-      message_out.set_source_id(routing_table_.kNodeId().string());
-      if (message.has_id())
-        message_out.set_id(message.id());
-      else
-        LOG(kInfo) << "Message to be sent back had no ID.";
-
-      if (message.has_relay_id())
-        message_out.set_relay_id(message.relay_id());
-
-      if (message.has_relay_connection_id()) {
-        message_out.set_relay_connection_id(message.relay_connection_id());
-      }
-      if (routing_table_.client_mode() &&
-          routing_table_.kNodeId().string() == message_out.destination_id()) {
-        network_.SendToClosestNode(message_out);
+      SendNodeLevelReply(frame_reply, std::to_string(kFrame));
+      if (kResult != StreamReassembler::Result::kComplete)
         return;
-      }
-      if (routing_table_.kNodeId().string() != message_out.destination_id()) {
-        network_.SendToClosestNode(message_out);
-      } else {
-        LOG(kInfo) << "Sending response to self."
-                   << " id: " << message.id();
-        HandleMessage(message_out);
-      }
-    };
-    if (message_received_functor_)
-      message_received_functor_(message.data(0), false, response_functor);
-    else
-      InvokeTypedMessageReceivedFunctor(message);  // typed message received
-  } else if (IsResponse(message)) {                // response
-    LOG(kInfo) << "[" << DebugId(routing_table_.kNodeId())
-               << "] rcvd : " << MessageTypeString(message) << " from "
-               << HexSubstr(message.source_id()) << "   (id: " << message.id()
-               << ")  --NodeLevel--";
+      message.set_id(message.stream_id());
+      message.clear_stream_id();
+      message.clear_stream_frame();
+      message.clear_stream_frame_count();
+    }
+    if (!UncompressData(message)) {
+      LOG(kWarning) << "Dropping message with corrupt payload from "
+                    << HexSubstr(message.source_id()) << " id: " << message.id();
+      return;
+    }
+    MessageLatency::Mark(MessageStage::kUpcall);
+    std::shared_ptr<protobuf::Message> upcall_message(std::make_shared<protobuf::Message>());
+    upcall_message->Swap(&message);
+    if (!upcall_executor_.Post([this, upcall_message]() {
+          InvokeMessageReceivedFunctor(*upcall_message);
+        }, Deadline(*upcall_message))) {
+      LOG(kWarning) << "Dropping node level message from " << HexSubstr(upcall_message->source_id())
+                    << " as the application is too far behind.  id: " << upcall_message->id();
+      if (metrics_)
+        metrics_->Dropped(DropReason::kUpcallQueueFull);
+    }
+  } else if (IsResponse(message)) {  // response
+    ROUTING_LOG(kInfo) << "[" << DebugId(routing_table_.kNodeId())
+                       << "] rcvd : " << MessageTypeString(message) << " from "
+                       << HexSubstr(message.source_id()) << "   (id: " << message.id()
+                       << ")  --NodeLevel--";
     try {
       if (!message.has_id() || message.data_size() != 1)
         BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
-      timer_.AddResponse(message.id(), message.data(0));
+      if (routing_table_.client_mode())
+        network_.relay_links().Answered(message.id());
+      timer_.AddResponse(message.id(), std::move(*message.mutable_data(0)));
     }
     catch (const maidsafe_error& e) {
       LOG(kError) << e.what();
@@ -245,36 +338,60 @@ void MessageHandler::HandleNodeLevelMessageForThisNode(protobuf::Message& messag
 }
 
 void MessageHandler::HandleMessageForThisNode(protobuf::Message& message) {
+  MessageLatency::Mark(MessageStage::kRouted);
   if (RelayDirectMessageIfNeeded(message))
     return;
 
-  LOG(kVerbose) << "Message for this node."
-                << " id: " << message.id();
+  ROUTING_LOG(kVerbose) << "Message for this node."
+                        << " id: " << message.id();
   if (IsRoutingMessage(message))
     HandleRoutingMessage(message);
   else
     HandleNodeLevelMessageForThisNode(message);
 }
 
-void MessageHandler::HandleMessageAsClosestNode(protobuf::Message& message) {
-  LOG(kVerbose) << "This node is in closest proximity to this message destination ID [ "
-                << HexSubstr(message.destination_id()) << " ]."
-                << " id: " << message.id();
+void MessageHandler::VerifyThenHandleMessageForThisNode(protobuf::Message& message) {
+  NodeInfo source;
+  if (!routing_table_.GetNodeInfo(NodeId(message.source_id()), source)) {
+    ROUTING_LOG(kVerbose) << "No public key to check signature of message from "
+                          << HexSubstr(message.source_id()) << " id: " << message.id();
+    return HandleMessageForThisNode(message);
+  }
+  auto signed_message(std::make_shared<protobuf::Message>());
+  signed_message->Swap(&message);
+  std::string signature(signed_message->signature());
+  signature_verifier_.Verify(SignedData(*signed_message), std::move(signature), source.public_key,
+                             [this, signed_message](bool valid) {
+    if (!valid) {
+      LOG(kWarning) << "Dropping message with invalid signature from "
+                    << HexSubstr(signed_message->source_id()) << " id: " << signed_message->id();
+      return;
+    }
+    HandleMessageForThisNode(*signed_message);
+  }, source.encoded_public_key);
+}
+
+void MessageHandler::HandleMessageAsClosestNode(protobuf::Message& message,
+                                                const RouteClassification& route) {
+  MessageLatency::Mark(MessageStage::kRouted);
+  ROUTING_LOG(kVerbose) << "This node is in closest proximity to this message destination ID [ "
+                        << HexSubstr(message.destination_id()) << " ]."
+                        << " id: " << message.id();
   if (IsDirect(message)) {
-    return HandleDirectMessageAsClosestNode(message);
+    return HandleDirectMessageAsClosestNode(message, route);
   } else {
-    return HandleGroupMessageAsClosestNode(message);
+    return HandleGroupMessageAsClosestNode(message, route);
   }
 }
 
-void MessageHandler::HandleDirectMessageAsClosestNode(protobuf::Message& message) {
+void MessageHandler::HandleDirectMessageAsClosestNode(protobuf::Message& message,
+                                                      const RouteClassification& route) {
   assert(message.direct());
   // Dropping direct messages if this node is closest and destination node is not in routing_table_
   // or client_routing_table_.
   NodeId destination_node_id(message.destination_id());
-  if (routing_table_.IsThisNodeClosestToIncludingMatrix(destination_node_id)) {
-    if (routing_table_.Contains(destination_node_id) ||
-        client_routing_table_.Contains(destination_node_id)) {
+  if (route.closest && routing_table_.IsThisNodeClosestToIncludingMatrix(destination_node_id)) {
+    if (route.target_connected || client_routing_table_.Contains(destination_node_id)) {
       return network_.SendToClosestNode(message);
     } else if (!message.has_visited() || !message.visited()) {
       message.set_visited(true);
@@ -289,163 +406,203 @@ void MessageHandler::HandleDirectMessageAsClosestNode(protobuf::Message& message
       return;
     }
   } else {
-    // if (IsCacheableRequest(message))
-    //   return HandleCacheLookup(message);  // forwarding message is done by cache manager
-    // else if (IsCacheableResponse(message))
-    //   StoreCacheCopy(message);  //  Upper layer should take this on seperate thread
-
-    return network_.SendToClosestNode(message);
+    return PassOn(message);
   }
 }
 
-void MessageHandler::HandleGroupMessageAsClosestNode(protobuf::Message& message) {
+void MessageHandler::HandleGroupMessageAsClosestNode(protobuf::Message& message,
+                                                     const RouteClassification& route) {
   assert(!message.direct());
-  bool have_node_with_group_id(routing_table_.Contains(NodeId(message.destination_id())));
   // This node is not closest to the destination node for non-direct message.
-  if (!routing_table_.IsThisNodeClosestTo(NodeId(message.destination_id()), !IsDirect(message)) &&
-      !have_node_with_group_id) {
-    LOG(kInfo) << "This node is not closest, passing it on."
-               << " id: " << message.id();
-    // if (IsCacheableRequest(message))
-    //   return HandleCacheLookup(message);  // forwarding message is done by cache manager
-    // else if (IsCacheableResponse(message))
-    //   StoreCacheCopy(message);  // Upper layer should take this on seperate thread
-    return network_.SendToClosestNode(message);
+  if (!route.closest_ignoring_target && !route.target_connected) {
+    ROUTING_LOG(kInfo) << "This node is not closest, passing it on."
+                       << " id: " << message.id();
+    return PassOn(message);
   }
 
   if (message.has_visited() && !message.visited() &&
-      (routing_table_.size() > Parameters::closest_nodes_size) &&
-      (!routing_table_.IsThisNodeInRange(NodeId(message.destination_id()),
-                                         Parameters::closest_nodes_size))) {
+      (route.table_size > Parameters::closest_nodes_size) && !route.in_close_range) {
     message.set_visited(true);
     return network_.SendToClosestNode(message);
   }
 
-  std::vector<std::string> route_history;
-  if (message.route_history().size() > 1)
-    route_history = std::vector<std::string>(message.route_history().begin(),
-                                             message.route_history().end() - 1);
-  else if ((message.route_history().size() == 1) &&
-           (message.route_history(0) != routing_table_.kNodeId().string()))
-    route_history.push_back(message.route_history(0));
+  const RouteHistory kRouteHistory(message, routing_table_.kNodeId(), false);
 
   // Confirming from group matrix. If this node is closest to the target id or else passing on to
-  // the connected peer which has the closer node.
-  NodeInfo closest_to_group_leader_node;
-  if (!routing_table_.IsThisNodeGroupLeader(NodeId(message.destination_id()),
-                                            closest_to_group_leader_node, route_history)) {
-    assert(NodeId(message.destination_id()) != closest_to_group_leader_node.node_id);
-    return network_.SendToDirectAdjustedRoute(message, closest_to_group_leader_node.node_id,
-                                              closest_to_group_leader_node.connection_id);
+  // the connected peer which has the closer node.  If it is, the replicas to send are found from
+  // the same lookup.
+  const uint16_t kReplication(static_cast<uint16_t>(message.replication()));
+  const bool kValidReplication(kReplication >= 1 && kReplication <= Parameters::group_size);
+  // Less one for this node, which is a replica itself.
+  const GroupRoute kGroupRoute(routing_table_.RouteGroup(
+      NodeId(message.destination_id()), kRouteHistory,
+      static_cast<uint16_t>(kValidReplication ? kReplication - 1 : 0)));
+  if (!kGroupRoute.leader) {
+    assert(NodeId(message.destination_id()) != kGroupRoute.next_hop.node_id);
+    return network_.SendToDirectAdjustedRoute(message, kGroupRoute.next_hop.node_id,
+                                              kGroupRoute.next_hop.connection_id);
   }
 
   // This node is closest so will send to all replicant nodes
-  uint16_t replication(static_cast<uint16_t>(message.replication()));
-  if ((replication < 1) || (replication > Parameters::group_size)) {
+  if (!kValidReplication) {
     LOG(kError) << "Dropping invalid non-direct message."
                 << " id: " << message.id();
     return;
   }
 
-  --replication;  // Will send to self as well
   message.set_direct(true);
   message.clear_route_history();
-  NodeId destination_id(message.destination_id());
   NodeId own_node_id(routing_table_.kNodeId());
-  auto close_from_matrix(routing_table_.GetClosestMatrixNodes(destination_id, replication + 2));
-  close_from_matrix.erase(std::remove_if(close_from_matrix.begin(), close_from_matrix.end(),
-                                         [&destination_id](const NodeInfo & node_info) {
-                            return node_info.node_id == destination_id;
-                          }),
-                          close_from_matrix.end());
-  close_from_matrix.erase(std::remove_if(close_from_matrix.begin(), close_from_matrix.end(),
-                                         [&own_node_id](const NodeInfo & node_info) {
-                            return node_info.node_id == own_node_id;
-                          }),
-                          close_from_matrix.end());
-  while (close_from_matrix.size() > replication)
-    close_from_matrix.pop_back();
+  const std::vector<NodeInfo>& connected_members(kGroupRoute.connected_members);
+  const std::vector<NodeInfo>& other_members(kGroupRoute.other_members);
 
   std::string group_id(message.destination_id());
   std::string group_members("[" + DebugId(routing_table_.kNodeId()) + "]");
 
-  for (const auto& i : close_from_matrix)
+  for (const auto& i : connected_members)
     group_members += std::string("[" + DebugId(i.node_id) + "]");
-  LOG(kInfo) << "Group nodes for group_id " << HexSubstr(group_id) << " : " << group_members;
-
-  for (const auto& i : close_from_matrix) {
-    LOG(kInfo) << "[" << DebugId(own_node_id) << "] - "
-               << "Replicating message to : " << HexSubstr(i.node_id.string())
-               << " [ group_id : " << HexSubstr(group_id) << "]"
-               << " id: " << message.id();
-    message.set_destination_id(i.node_id.string());
-    NodeInfo node;
-    if (routing_table_.GetNodeInfo(i.node_id, node)) {
-      network_.SendToDirect(message, node.node_id, node.connection_id);
-    } else {
-      network_.SendToClosestNode(message);
+  for (const auto& i : other_members)
+    group_members += std::string("[" + DebugId(i.node_id) + "]");
+  ROUTING_LOG(kInfo) << "Group nodes for group_id " << HexSubstr(group_id) << " : "
+                     << group_members;
+
+  // Replicas to connected members share one serialisation of the payload and signature, each
+  // prefixed with its own small header.  These are moved out of, and back into, message.
+  if (!connected_members.empty()) {
+    protobuf::Message body;
+    body.mutable_data()->Swap(message.mutable_data());
+    if (message.has_signature())
+      body.mutable_signature()->swap(*message.mutable_signature());
+    auto encoded_body(std::make_shared<const std::string>(body.SerializePartialAsString()));
+    for (const auto& node : connected_members) {
+      ROUTING_LOG(kInfo) << "[" << DebugId(own_node_id) << "] - "
+                         << "Replicating message to : " << HexSubstr(node.node_id.string())
+                         << " [ group_id : " << HexSubstr(group_id) << "]"
+                         << " id: " << message.id();
+      message.set_destination_id(node.node_id.string());
+      network_.SendEncodedToDirect(message, encoded_body, node.node_id, node.connection_id);
     }
+    message.mutable_data()->Swap(body.mutable_data());
+    if (body.has_signature())
+      message.mutable_signature()->swap(*body.mutable_signature());
+  }
+  for (const auto& i : other_members) {
+    ROUTING_LOG(kInfo) << "[" << DebugId(own_node_id) << "] - "
+                       << "Replicating message to : " << HexSubstr(i.node_id.string())
+                       << " [ group_id : " << HexSubstr(group_id) << "]"
+                       << " id: " << message.id();
+    message.set_destination_id(i.node_id.string());
+    network_.SendToClosestNode(message);
   }
 
   message.set_destination_id(routing_table_.kNodeId().string());
 
   if (IsRoutingMessage(message)) {
-    LOG(kVerbose) << "HandleGroupMessageAsClosestNode if, msg id: " << message.id();
+    ROUTING_LOG(kVerbose) << "HandleGroupMessageAsClosestNode if, msg id: " << message.id();
     HandleRoutingMessage(message);
   } else {
-    LOG(kVerbose) << "HandleGroupMessageAsClosestNode else, msg id: " << message.id();
+    ROUTING_LOG(kVerbose) << "HandleGroupMessageAsClosestNode else, msg id: " << message.id();
     HandleNodeLevelMessageForThisNode(message);
   }
 }
 
-void MessageHandler::HandleMessageAsFarNode(protobuf::Message& message) {
-  if (message.has_visited() &&
-      routing_table_.IsThisNodeClosestTo(NodeId(message.destination_id()), !message.direct()) &&
-      !message.direct() && !message.visited())
+void MessageHandler::HandleMessageAsFarNode(protobuf::Message& message,
+                                            const RouteClassification& route,
+                                            std::shared_ptr<const std::string> encoded_body) {
+  MessageLatency::Mark(MessageStage::kRouted);
+  if (message.has_visited() && route.closest_ignoring_target && !message.direct() &&
+      !message.visited())
     message.set_visited(true);
-  LOG(kVerbose) << "[" << DebugId(routing_table_.kNodeId())
-                << "] is not in closest proximity to this message destination ID [ "
-                << HexSubstr(message.destination_id()) << " ]; sending on."
-                << " id: " << message.id();
-  network_.SendToClosestNode(message);
+  ROUTING_LOG(kVerbose) << "[" << DebugId(routing_table_.kNodeId())
+                        << "] is not in closest proximity to this message destination ID [ "
+                        << HexSubstr(message.destination_id()) << " ]; sending on."
+                        << " id: " << message.id();
+  if (encoded_body) {
+    if (metrics_)
+      metrics_->Forwarded();
+    return network_.SendEncodedToClosestNode(message, std::move(encoded_body));
+  }
+  PassOn(message);
 }
 
-void MessageHandler::HandleMessage(protobuf::Message& message) {
-  LOG(kVerbose) << "[" << DebugId(routing_table_.kNodeId()) << "]"
-                << " MessageHandler::HandleMessage handle message with id: " << message.id();
-  if (!ValidateMessage(message)) {
+void MessageHandler::HandleMessage(protobuf::Message& message,
+                                   std::shared_ptr<const std::string> encoded_body) {
+  ROUTING_LOG(kVerbose) << "[" << DebugId(routing_table_.kNodeId()) << "]"
+                        << " MessageHandler::HandleMessage handle message with id: "
+                        << message.id();
+  if (metrics_)
+    metrics_->MessageIn(message.type());
+  DropReason drop_reason(DropReason::kUninitialised);
+  if (!ValidateMessage(message, drop_reason)) {
+    if (metrics_)
+      metrics_->Dropped(drop_reason);
+    MessageTrace::Record(message, routing_table_.kNodeId(), TraceDecision::kDropped);
     LOG(kWarning) << "Validate message failed， id: " << message.id();
     assert((message.hops_to_live() > 0) && "Message has traversed maximum number of hops allowed");
     return;
   }
+  MessageLatency::Mark(MessageStage::kValidated);
+
+  // Nobody is waiting for the response any more, so neither handling nor passing it on is useful.
+  if (IsExpired(message)) {
+    ROUTING_LOG(kVerbose) << "Dropping expired " << MessageTypeString(message) << " from "
+                          << HexSubstr(message.source_id()) << " id: " << message.id();
+    if (metrics_)
+      metrics_->Dropped(DropReason::kExpired);
+    MessageTrace::Record(message, routing_table_.kNodeId(), TraceDecision::kDropped);
+    return;
+  }
+
+  if (duplicate_filter_.IsDuplicate(message)) {
+    // Repeats are dropped whichever way they came.  One which has already passed through this node
+    // has come round in a loop rather than arriving again by another path, so is counted apart.
+    // Only the duplicate filter catches loops: a looped message which it has forgotten is handled
+    // again.
+    const bool kLooped(HasPassedThrough(message, routing_table_.kNodeId()));
+    ROUTING_LOG(kVerbose) << "Dropping " << (kLooped ? "looped " : "duplicate ")
+                          << MessageTypeString(message) << " from "
+                          << HexSubstr(message.source_id()) << " id: " << message.id();
+    if (metrics_)
+      metrics_->Dropped(kLooped ? DropReason::kRouteLoop : DropReason::kDuplicate);
+    MessageTrace::Record(message, routing_table_.kNodeId(), TraceDecision::kDropped);
+    return;
+  }
 
   // Decrement hops_to_live
   message.set_hops_to_live(message.hops_to_live() - 1);
 
-  if (IsValidCacheableGet(message)) {
-    LOG(kInfo) << "MessageHandler::HandleMessage " << message.id() << " with cache manager";
-    return HandleCacheLookup(message);  // forwarding message is done by cache manager
-  }
-  if (IsValidCacheablePut(message)) {
-    LOG(kInfo) << "MessageHandler::HandleMessage " << message.id() << " StoreCacheCopy";
-    StoreCacheCopy(message);  //  Upper layer should take this on separate thread
+  // ValidateMessage has checked the destination.  What the routing decision needs from the routing
+  // table is read once here, rather than by each check below.
+  const NodeId kDestinationId(message.destination_id());
+  const RouteClassification kRoute(routing_table_.ClassifyRoute(kDestinationId));
+  const bool kDestinationIsClient(client_routing_table_.Contains(kDestinationId));
+
+  if (encoded_body && !IsPassingThrough(message, kRoute, kDestinationIsClient)) {
+    if (!message.MergeFromString(*encoded_body)) {
+      LOG(kWarning) << "Failed to parse payload of " << MessageTypeString(message)
+                    << " id: " << message.id();
+      return;
+    }
+    encoded_body.reset();
   }
 
   // If group message request to self id
   if (IsGroupMessageRequestToSelfId(message)) {
-    LOG(kInfo) << "MessageHandler::HandleMessage " << message.id() << " HandleGroupMessageToSelfId";
+    ROUTING_LOG(kInfo) << "MessageHandler::HandleMessage " << message.id()
+                       << " HandleGroupMessageToSelfId";
     return HandleGroupMessageToSelfId(message);
   }
 
   // If this node is a client
   if (routing_table_.client_mode()) {
-    LOG(kInfo) << "MessageHandler::HandleMessage " << message.id() << " HandleClientMessage";
+    ROUTING_LOG(kInfo) << "MessageHandler::HandleMessage " << message.id()
+                       << " HandleClientMessage";
     return HandleClientMessage(message);
   }
 
   // Relay mode message
   if (message.source_id().empty()) {
-    LOG(kInfo) << "MessageHandler::HandleMessage " << message.id() << " HandleRelayRequest";
+    ROUTING_LOG(kInfo) << "MessageHandler::HandleMessage " << message.id() << " HandleRelayRequest";
     return HandleRelayRequest(message);
   }
 
@@ -458,35 +615,60 @@ void MessageHandler::HandleMessage(protobuf::Message& message) {
 
   // Direct message
   if (message.destination_id() == routing_table_.kNodeId().string()) {
-    LOG(kInfo) << "MessageHandler::HandleMessage " << message.id() << " HandleMessageForThisNode";
+    ROUTING_LOG(kInfo) << "MessageHandler::HandleMessage " << message.id()
+                       << " HandleMessageForThisNode";
+    if (message.has_signature())
+      return VerifyThenHandleMessageForThisNode(message);
     return HandleMessageForThisNode(message);
   }
 
   if (IsRelayResponseForThisNode(message)) {
-    LOG(kInfo) << "MessageHandler::HandleMessage " << message.id() << " HandleRoutingMessage";
+    ROUTING_LOG(kInfo) << "MessageHandler::HandleMessage " << message.id()
+                       << " HandleRoutingMessage";
     return HandleRoutingMessage(message);
   }
 
-  if (client_routing_table_.Contains(NodeId(message.destination_id())) && IsDirect(message)) {
-    LOG(kInfo) << "MessageHandler::HandleMessage " << message.id()
-               << " HandleMessageForNonRoutingNodes";
+  if (kDestinationIsClient && IsDirect(message)) {
+    ROUTING_LOG(kInfo) << "MessageHandler::HandleMessage " << message.id()
+                       << " HandleMessageForNonRoutingNodes";
     return HandleMessageForNonRoutingNodes(message);
   }
 
   // This node is in closest proximity to this message
-  if (routing_table_.IsThisNodeInRange(NodeId(message.destination_id()),
-                                       Parameters::group_size) ||
-      (routing_table_.IsThisNodeClosestTo(NodeId(message.destination_id()), !message.direct()) &&
-       message.visited())) {
-    LOG(kInfo) << "MessageHandler::HandleMessage " << message.id() << " HandleMessageAsClosestNode";
-    return HandleMessageAsClosestNode(message);
+  if (IsClosestNodeFor(message, kRoute)) {
+    ROUTING_LOG(kInfo) << "MessageHandler::HandleMessage " << message.id()
+                       << " HandleMessageAsClosestNode";
+    return HandleMessageAsClosestNode(message, kRoute);
   } else {
-    LOG(kInfo) << "MessageHandler::HandleMessage " << message.id() << " HandleMessageAsFarNode";
-    return HandleMessageAsFarNode(message);
+    ROUTING_LOG(kInfo) << "MessageHandler::HandleMessage " << message.id()
+                       << " HandleMessageAsFarNode";
+    return HandleMessageAsFarNode(message, kRoute, std::move(encoded_body));
   }
 }
 
+bool MessageHandler::IsPassingThrough(protobuf::Message& message, const RouteClassification& route,
+                                      bool destination_is_client) {
+  // Mirrors the checks made by HandleMessage before handing message to HandleMessageAsFarNode.
+  if (IsGroupMessageRequestToSelfId(message) || routing_table_.client_mode() ||
+      message.source_id().empty() || NodeId(message.source_id()).IsZero() ||
+      message.destination_id() == routing_table_.kNodeId().string() ||
+      IsRelayResponseForThisNode(message) || IsValidCacheableGet(message) ||
+      IsValidCacheablePut(message)) {
+    return false;
+  }
+  if (destination_is_client && IsDirect(message))
+    return false;
+  return !IsClosestNodeFor(message, route);
+}
+
+bool MessageHandler::IsClosestNodeFor(const protobuf::Message& message,
+                                      const RouteClassification& route) const {
+  return route.in_group_range ||
+         ((message.direct() ? route.closest : route.closest_ignoring_target) && message.visited());
+}
+
 void MessageHandler::HandleMessageForNonRoutingNodes(protobuf::Message& message) {
+  MessageLatency::Mark(MessageStage::kRouted);
   auto client_routing_nodes(client_routing_table_.GetNodesInfo(NodeId(message.destination_id())));
   assert(!client_routing_nodes.empty() && message.direct());
 // Below bit is not needed currently as SendToClosestNode will do this check anyway
@@ -498,16 +680,17 @@ void MessageHandler::HandleMessageForNonRoutingNodes(protobuf::Message& message)
                   << PrintMessage(message);
     return;
   }
-  LOG(kInfo) << "This node has message destination in its ClientRoutingTable. Dest id : "
-             << HexSubstr(message.destination_id()) << " message id: " << message.id();
+  ROUTING_LOG(kInfo) << "This node has message destination in its ClientRoutingTable. Dest id : "
+                     << HexSubstr(message.destination_id()) << " message id: " << message.id();
   return network_.SendToClosestNode(message);
 }
 
 void MessageHandler::HandleRelayRequest(protobuf::Message& message) {
+  MessageLatency::Mark(MessageStage::kRouted);
   assert(!message.has_source_id());
   if ((message.destination_id() == routing_table_.kNodeId().string()) && IsRequest(message)) {
-    LOG(kVerbose) << "Relay request with this node's ID as destination ID"
-                  << " id: " << message.id();
+    ROUTING_LOG(kVerbose) << "Relay request with this node's ID as destination ID"
+                          << " id: " << message.id();
     // If group message request to this node's id sent by relay requester node
     if ((message.destination_id() == routing_table_.kNodeId().string()) && message.request() &&
         !message.direct()) {
@@ -562,8 +745,8 @@ void MessageHandler::HandleGroupRelayRequestMessageAsClosestNode(protobuf::Messa
   // This node is not closest to the destination node for non-direct message.
   if (!routing_table_.IsThisNodeClosestTo(NodeId(message.destination_id()), !IsDirect(message)) &&
       !have_node_with_group_id) {
-    LOG(kInfo) << "This node is not closest, passing it on."
-               << " id: " << message.id();
+    ROUTING_LOG(kInfo) << "This node is not closest, passing it on."
+                       << " id: " << message.id();
     message.set_source_id(routing_table_.kNodeId().string());
     return network_.SendToClosestNode(message);
   }
@@ -600,13 +783,14 @@ void MessageHandler::HandleGroupRelayRequestMessageAsClosestNode(protobuf::Messa
 
   for (const auto& i : close)
     group_members += std::string("[" + DebugId(i) + "]");
-  LOG(kInfo) << "Group members for group_id " << HexSubstr(group_id) << " are: " << group_members;
+  ROUTING_LOG(kInfo) << "Group members for group_id " << HexSubstr(group_id) << " are: "
+                     << group_members;
   // This node relays back the responses
   message.set_source_id(routing_table_.kNodeId().string());
   for (const auto& i : close) {
-    LOG(kInfo) << "Replicating message to : " << HexSubstr(i.string())
-               << " [ group_id : " << HexSubstr(group_id) << "]"
-               << " id: " << message.id();
+    ROUTING_LOG(kInfo) << "Replicating message to : " << HexSubstr(i.string())
+                       << " [ group_id : " << HexSubstr(group_id) << "]"
+                       << " id: " << message.id();
     message.set_destination_id(i.string());
     NodeInfo node;
     if (routing_table_.GetNodeInfo(i, node)) {
@@ -626,7 +810,7 @@ void MessageHandler::HandleGroupRelayRequestMessageAsClosestNode(protobuf::Messa
 bool MessageHandler::IsRelayResponseForThisNode(protobuf::Message& message) {
   if (IsRoutingMessage(message) && message.has_relay_id() &&
       (message.relay_id() == routing_table_.kNodeId().string())) {
-    LOG(kVerbose) << "Relay response through alternative route";
+    ROUTING_LOG(kVerbose) << "Relay response through alternative route";
     return true;
   } else {
     return false;
@@ -644,8 +828,8 @@ bool MessageHandler::RelayDirectMessageIfNeeded(protobuf::Message& message) {
           (message.destination_id() != message.relay_id())) {
     message.clear_destination_id();
     message.clear_actual_destination_is_relay_id();  // so that it is picked currectly at recepient
-    LOG(kVerbose) << "Relaying request to " << HexSubstr(message.relay_id())
-                  << " id: " << message.id();
+    ROUTING_LOG(kVerbose) << "Relaying request to " << HexSubstr(message.relay_id())
+                          << " id: " << message.id();
     network_.SendToClosestNode(message);
     return true;
   }
@@ -653,18 +837,19 @@ bool MessageHandler::RelayDirectMessageIfNeeded(protobuf::Message& message) {
   // Only direct responses need to be relayed
   if (IsResponse(message) && (message.destination_id() != message.relay_id())) {
     message.clear_destination_id();  // to allow network util to identify it as relay message
-    LOG(kVerbose) << "Relaying response to " << HexSubstr(message.relay_id())
-                  << " id: " << message.id();
+    ROUTING_LOG(kVerbose) << "Relaying response to " << HexSubstr(message.relay_id())
+                          << " id: " << message.id();
     network_.SendToClosestNode(message);
     return true;
   }
 
   // not a relay message response, its for this node
-  //    LOG(kVerbose) << "Not a relay message response, it's for this node";
+  //    ROUTING_LOG(kVerbose) << "Not a relay message response, it's for this node";
   return false;
 }
 
 void MessageHandler::HandleClientMessage(protobuf::Message& message) {
+  MessageLatency::Mark(MessageStage::kRouted);
   assert(routing_table_.client_mode() && "Only client node should handle client messages");
   if (message.source_id().empty()) {  // No relays allowed on client.
     LOG(kWarning) << "Stray message at client node. No relays allowed."
@@ -672,12 +857,12 @@ void MessageHandler::HandleClientMessage(protobuf::Message& message) {
     return;
   }
   if (IsRoutingMessage(message)) {
-    LOG(kVerbose) << "Client Routing Response for " << DebugId(routing_table_.kNodeId())
-                  << " from " << HexSubstr(message.source_id()) << " id: " << message.id();
+    ROUTING_LOG(kVerbose) << "Client Routing Response for " << DebugId(routing_table_.kNodeId())
+                          << " from " << HexSubstr(message.source_id()) << " id: " << message.id();
     HandleRoutingMessage(message);
   } else if ((message.destination_id() == routing_table_.kNodeId().string())) {
-    LOG(kVerbose) << "Client NodeLevel Response for " << DebugId(routing_table_.kNodeId())
-                  << " from " << HexSubstr(message.source_id()) << " id: " << message.id();
+    ROUTING_LOG(kVerbose) << "Client NodeLevel Response for " << DebugId(routing_table_.kNodeId())
+                          << " from " << HexSubstr(message.source_id()) << " id: " << message.id();
     HandleNodeLevelMessageForThisNode(message);
   } else {
     LOG(kWarning) << DebugId(routing_table_.kNodeId()) << " silently drop message "
@@ -693,15 +878,32 @@ bool MessageHandler::IsGroupMessageRequestToSelfId(protobuf::Message& message) {
 }
 
 void MessageHandler::HandleGroupMessageToSelfId(protobuf::Message& message) {
+  MessageLatency::Mark(MessageStage::kRouted);
   assert(message.source_id() == routing_table_.kNodeId().string());
   assert(message.destination_id() == routing_table_.kNodeId().string());
   assert(message.request());
   assert(!message.direct());
-  LOG(kInfo) << "Sending group message to self id. Passing on to the closest peer to replicate";
+  ROUTING_LOG(kInfo)
+      << "Sending group message to self id. Passing on to the closest peer to replicate";
   network_.SendToClosestNode(message);
 }
 
-void MessageHandler::InvokeTypedMessageReceivedFunctor(const protobuf::Message& proto_message) {
+void MessageHandler::InvokeMessageReceivedFunctor(protobuf::Message& message) {
+  if (message_received_functor_) {
+    // Only the header is kept for the reply; the request's payload is left to the application.
+    std::shared_ptr<const protobuf::Message> reply_header(
+        std::make_shared<protobuf::Message>(NodeLevelReplyHeader(message)));
+    ReplyFunctor response_functor = [this, reply_header](std::string reply_message) {
+      protobuf::Message reply(*reply_header);
+      SendNodeLevelReply(reply, std::move(reply_message));
+    };
+    message_received_functor_(message.data(0), false, response_functor);
+  } else {
+    InvokeTypedMessageReceivedFunctor(message);  // typed message received
+  }
+}
+
+void MessageHandler::InvokeTypedMessageReceivedFunctor(protobuf::Message& proto_message) {
   if ((!proto_message.has_group_source() && !proto_message.has_group_destination()) &&
       typed_message_received_functors_.single_to_single) {  // Single to Single
     typed_message_received_functors_.single_to_single(CreateSingleToSingleMessage(proto_message));
@@ -727,6 +929,8 @@ void MessageHandler::InvokeTypedMessageReceivedFunctor(const protobuf::Message&
 
 void MessageHandler::set_message_and_caching_functor(MessageAndCachingFunctors functors) {
   message_received_functor_ = functors.message_received;
+  if (cache_manager_)
+    cache_manager_->set_validate_cache_data_functor(functors.validate_cache_data);
   // Initialise caching functors here
 }
 
@@ -737,6 +941,8 @@ void MessageHandler::set_typed_message_and_caching_functor(TypedMessageAndCachin
   typed_message_received_functors_.group_to_group = functors.group_to_group.message_received;
   typed_message_received_functors_.single_to_group_relay =
       functors.single_to_group_relay.message_received;
+  if (cache_manager_)
+    cache_manager_->set_validate_cache_data_functor(functors.validate_cache_data);
   // Initialise caching functors here
 }
 
@@ -746,7 +952,60 @@ void MessageHandler::set_request_public_key_functor(
   service_->set_request_public_key_functor(request_public_key_functor);
 }
 
+void MessageHandler::SendConnectRequests(const std::vector<NodeId>& peers) {
+  for (const auto& peer : peers)
+    response_handler_->CheckAndSendConnectRequest(peer);
+}
+
+void MessageHandler::SendShortcutConnectRequest(const NodeId& peer) {
+  response_handler_->SendShortcutConnectRequest(peer);
+}
+
+void MessageHandler::set_metrics(Metrics* metrics) {
+  metrics_ = metrics;
+  upcall_executor_.set_metrics(metrics);
+}
+
+void MessageHandler::StartNodeLookup() { response_handler_->StartNodeLookup(); }
+
+size_t MessageHandler::queued_connects() const { return response_handler_->queued_connects(); }
+
+size_t MessageHandler::connects_in_flight() const {
+  return response_handler_->connects_in_flight();
+}
+
+size_t MessageHandler::queued_upcalls() const { return upcall_executor_.queued(); }
+
+void MessageHandler::set_request_public_keys_functor(
+    RequestPublicKeysFunctor request_public_keys_functor) {
+  response_handler_->set_request_public_keys_functor(request_public_keys_functor);
+}
+
+CacheStatistics MessageHandler::cache_statistics() const {
+  return cache_manager_ ? cache_manager_->statistics() : CacheStatistics();
+}
+
+uint32_t MessageHandler::EstimatedCacheGetCount(const NodeId& destination_id,
+                                                const std::string& request_data) const {
+  return cache_manager_ ? cache_manager_->EstimatedGetCount(destination_id, request_data) : 0;
+}
+
+void MessageHandler::PassOn(protobuf::Message& message) {
+  if (metrics_)
+    metrics_->Forwarded();
+  if (IsValidCacheableGet(message)) {
+    ROUTING_LOG(kInfo) << "MessageHandler::PassOn " << message.id() << " with cache manager";
+    return HandleCacheLookup(message);  // forwarding message is done by cache manager
+  }
+  if (IsValidCacheablePut(message)) {
+    ROUTING_LOG(kInfo) << "MessageHandler::PassOn " << message.id() << " StoreCacheCopy";
+    StoreCacheCopy(message);  // the store itself happens on the asio service
+  }
+  network_.SendToClosestNode(message);
+}
+
 void MessageHandler::HandleCacheLookup(protobuf::Message& message) {
+  MessageLatency::Mark(MessageStage::kRouted);
   assert(!routing_table_.client_mode());
   assert(IsCacheableGet(message));
   cache_manager_->HandleGetFromCache(message);
@@ -754,20 +1013,22 @@ void MessageHandler::HandleCacheLookup(protobuf::Message& message) {
 
 void MessageHandler::StoreCacheCopy(const protobuf::Message& message) {
   assert(!routing_table_.client_mode());
-  assert(IsCacheablePut(message));
+  assert(IsCacheablePut(message) || IsCacheableGet(message));
   cache_manager_->AddToCache(message);
 }
 
 bool MessageHandler::IsValidCacheableGet(const protobuf::Message& message) {
-  // TODO(Prakash): need to differentiate between typed and un typed api
-  return (IsCacheableGet(message) && IsNodeLevelMessage(message) && Parameters::caching &&
-          !routing_table_.client_mode());
+  // Only the payload is cached and no typed caching functor is invoked, so this is safe for both
+  // the typed and the string message APIs.  Responses to Gets keep the kGet flag, but only
+  // requests can be answered from the cache.
+  return (IsCacheableGet(message) && IsRequest(message) && IsNodeLevelMessage(message) &&
+          Parameters::caching && !routing_table_.client_mode());
 }
 
 bool MessageHandler::IsValidCacheablePut(const protobuf::Message& message) {
-  // TODO(Prakash): need to differentiate between typed and un typed api
+  // Responses to Gets keep the kGet flag, so are candidates too.
   return (IsNodeLevelMessage(message) && Parameters::caching && !routing_table_.client_mode() &&
-          IsCacheablePut(message) && !IsRequest(message));
+          (IsCacheablePut(message) || IsCacheableGet(message)) && !IsRequest(message));
 }
 
 }  // namespace routing
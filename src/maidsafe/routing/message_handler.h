@@ -19,15 +19,23 @@
 #ifndef MAIDSAFE_ROUTING_MESSAGE_HANDLER_H_
 #define MAIDSAFE_ROUTING_MESSAGE_HANDLER_H_
 
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "maidsafe/rudp/managed_connections.h"
 
 #include "maidsafe/routing/api_config.h"
 #include "maidsafe/routing/cache_manager.h"
+#include "maidsafe/routing/duplicate_filter.h"
+#include "maidsafe/routing/message_stream.h"
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/request_rate_limiter.h"
 #include "maidsafe/routing/response_handler.h"
 #include "maidsafe/routing/service.h"
+#include "maidsafe/routing/signature_verifier.h"
 #include "maidsafe/routing/timer.h"
+#include "maidsafe/routing/upcall_executor.h"
 
 namespace maidsafe {
 
@@ -42,6 +50,7 @@ class MessageHandlerTest;
 class MessageHandlerTest_BEH_HandleInvalidMessage_Test;
 class MessageHandlerTest_BEH_HandleRelay_Test;
 class MessageHandlerTest_BEH_HandleGroupMessage_Test;
+class MessageHandlerTest_BEH_PassOnEncodedPayload_Test;
 class MessageHandlerTest_BEH_HandleNodeLevelMessage_Test;
 class MessageHandlerTest_BEH_ClientRoutingTable_Test;
 }
@@ -62,7 +71,9 @@ class ClientRoutingTable;
 class RoutingTable;
 class RemoveFurthestNode;
 class GroupChangeHandler;
+class Metrics;
 class NetworkStatistics;
+struct RouteClassification;
 
 enum class MessageType : int32_t {
   kPing = 1,
@@ -81,11 +92,33 @@ class MessageHandler {
  public:
   MessageHandler(RoutingTable& routing_table, ClientRoutingTable& client_routing_table,
                  NetworkUtils& network, Timer<std::string>& timer, RemoveFurthestNode& remove_node,
-                 GroupChangeHandler& group_change_handler, NetworkStatistics& network_statistics);
-  void HandleMessage(protobuf::Message& message);
+                 GroupChangeHandler& group_change_handler, NetworkStatistics& network_statistics,
+                 const InstanceParameters& parameters = InstanceParameters());
+  // Where given, |encoded_body| holds the message's payload still serialised (see
+  // ParseMessageHeader).  It is only parsed if this node has more to do than pass the message on.
+  void HandleMessage(protobuf::Message& message,
+                     std::shared_ptr<const std::string> encoded_body = nullptr);
   void set_typed_message_and_caching_functor(TypedMessageAndCachingFunctor functors);
   void set_message_and_caching_functor(MessageAndCachingFunctors functors);
   void set_request_public_key_functor(RequestPublicKeyFunctor request_public_key_functor);
+  void set_request_public_keys_functor(RequestPublicKeysFunctor request_public_keys_functor);
+  // Messages received, forwarded, delivered and dropped are counted in |metrics| if it's set.
+  void set_metrics(Metrics* metrics);
+  // Requests connections to those of 'peers' the routing table would accept.
+  void SendConnectRequests(const std::vector<NodeId>& peers);
+  // See ResponseHandler::SendShortcutConnectRequest.
+  void SendShortcutConnectRequest(const NodeId& peer);
+  // See ResponseHandler::StartNodeLookup.
+  void StartNodeLookup();
+  // See ResponseHandler::queued_connects and connects_in_flight.
+  size_t queued_connects() const;
+  size_t connects_in_flight() const;
+  // Node level messages waiting to be passed to the application (see UpcallExecutor).
+  size_t queued_upcalls() const;
+  // Both are zero for clients, which don't cache.
+  CacheStatistics cache_statistics() const;
+  uint32_t EstimatedCacheGetCount(const NodeId& destination_id,
+                                  const std::string& request_data) const;
 
  private:
   MessageHandler(const MessageHandler&);
@@ -94,11 +127,30 @@ class MessageHandler {
   bool CheckCacheData(protobuf::Message& message);
   void HandleRoutingMessage(protobuf::Message& message);
   void HandleNodeLevelMessageForThisNode(protobuf::Message& message);
+  // Passes a node level request to the application, with a functor for its reply.  The functor
+  // holds only the reply's header, not the request.
+  void InvokeMessageReceivedFunctor(protobuf::Message& message);
+  // The header of a reply to |request|, to which SendNodeLevelReply adds the reply itself.
+  protobuf::Message NodeLevelReplyHeader(const protobuf::Message& request) const;
+  void SendNodeLevelReply(protobuf::Message& reply, std::string reply_message);
   void HandleMessageForThisNode(protobuf::Message& message);
-  void HandleMessageAsClosestNode(protobuf::Message& message);
-  void HandleDirectMessageAsClosestNode(protobuf::Message& message);
-  void HandleGroupMessageAsClosestNode(protobuf::Message& message);
-  void HandleMessageAsFarNode(protobuf::Message& message);
+  // Checks the signature of a signed message from a connected peer on signature_verifier_'s
+  // threads, handling the message there if it's valid.
+  void VerifyThenHandleMessageForThisNode(protobuf::Message& message);
+  // Those taking route are given RoutingTable::ClassifyRoute(message's destination), which
+  // HandleMessage looks up once for all of them.
+  void HandleMessageAsClosestNode(protobuf::Message& message, const RouteClassification& route);
+  void HandleDirectMessageAsClosestNode(protobuf::Message& message,
+                                        const RouteClassification& route);
+  void HandleGroupMessageAsClosestNode(protobuf::Message& message,
+                                       const RouteClassification& route);
+  void HandleMessageAsFarNode(protobuf::Message& message, const RouteClassification& route,
+                              std::shared_ptr<const std::string> encoded_body = nullptr);
+  // True if HandleMessage would only pass message on, which needs none of its payload.
+  bool IsPassingThrough(protobuf::Message& message, const RouteClassification& route,
+                        bool destination_is_client);
+  // The last of HandleMessage's checks, choosing between the closest and far node handlers.
+  bool IsClosestNodeFor(const protobuf::Message& message, const RouteClassification& route) const;
   void HandleRelayRequest(protobuf::Message& message);
   void HandleGroupMessageToSelfId(protobuf::Message& message);
   bool IsRelayResponseForThisNode(protobuf::Message& message);
@@ -108,15 +160,20 @@ class MessageHandler {
   void HandleMessageForNonRoutingNodes(protobuf::Message& message);
   void HandleDirectRelayRequestMessageAsClosestNode(protobuf::Message& message);
   void HandleGroupRelayRequestMessageAsClosestNode(protobuf::Message& message);
+  // Sends on a message this node is not the destination of, serving cacheable Gets from the cache
+  // and keeping a copy of cacheable responses on the way.
+  void PassOn(protobuf::Message& message);
   void HandleCacheLookup(protobuf::Message& message);
   void StoreCacheCopy(const protobuf::Message& message);
   bool IsValidCacheableGet(const protobuf::Message& message);
   bool IsValidCacheablePut(const protobuf::Message& message);
-  void InvokeTypedMessageReceivedFunctor(const protobuf::Message& proto_message);
+  // Moves the payload out of proto_message into the typed message handed to the functor.
+  void InvokeTypedMessageReceivedFunctor(protobuf::Message& proto_message);
   friend class test::MessageHandlerTest;
   friend class test::MessageHandlerTest_BEH_HandleInvalidMessage_Test;
   friend class test::MessageHandlerTest_BEH_HandleRelay_Test;
   friend class test::MessageHandlerTest_BEH_HandleGroupMessage_Test;
+  friend class test::MessageHandlerTest_BEH_PassOnEncodedPayload_Test;
   friend class test::MessageHandlerTest_BEH_HandleNodeLevelMessage_Test;
   friend class test::MessageHandlerTest_BEH_ClientRoutingTable_Test;
 
@@ -124,6 +181,7 @@ class MessageHandler {
   ClientRoutingTable& client_routing_table_;
   NetworkStatistics& network_statistics_;
   NetworkUtils& network_;
+  Metrics* metrics_;
   RemoveFurthestNode& remove_furthest_node_;
   GroupChangeHandler& group_change_handler_;
   std::unique_ptr<CacheManager> cache_manager_;
@@ -132,6 +190,13 @@ class MessageHandler {
   std::shared_ptr<Service> service_;
   MessageReceivedFunctor message_received_functor_;
   detail::TypedMessageRecievedFunctors typed_message_received_functors_;
+  DuplicateFilter duplicate_filter_;
+  RequestRateLimiter request_rate_limiter_;
+  StreamReassembler stream_reassembler_;
+  // Last, so that their threads are joined before anything they call into is destroyed.  The
+  // verifier's threads post to upcall_executor_, so the verifier goes first.
+  UpcallExecutor upcall_executor_;
+  SignatureVerifier signature_verifier_;
 };
 
 }  // namespace routing
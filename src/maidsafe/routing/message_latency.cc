@@ -0,0 +1,152 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/message_latency.h"
+
+#include <algorithm>
+
+#include "boost/thread/tss.hpp"
+
+#include "maidsafe/routing/message_handler.h"
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+const size_t kNodeLevelSlot(9);
+
+size_t TypeSlot(int32_t type) {
+  if (type > 0 && type < static_cast<int32_t>(kNodeLevelSlot))
+    return static_cast<size_t>(type);
+  return type == static_cast<int32_t>(MessageType::kNodeLevel) ? kNodeLevelSlot : 0;
+}
+
+size_t ClassOf(const protobuf::Message& message) {
+  if (!message.has_source_id() || message.has_relay_id())
+    return static_cast<size_t>(DestinationClass::kRelay);
+  return static_cast<size_t>(message.direct() ? DestinationClass::kDirect
+                                              : DestinationClass::kGroup);
+}
+
+void LeaveScope(MessageLatency::Scope*) {}  // Scopes live on the stack of their own thread.
+
+boost::thread_specific_ptr<MessageLatency::Scope>& CurrentScope() {
+  static boost::thread_specific_ptr<MessageLatency::Scope> current_scope(&LeaveScope);
+  return current_scope;
+}
+
+}  // unnamed namespace
+
+LatencyHistogram::LatencyHistogram()
+    : message_type(0),
+      destination_class(DestinationClass::kDirect),
+      stage(MessageStage::kValidated),
+      bucket_counts() {}
+
+uint64_t LatencyHistogram::BucketLowerBound(size_t index) {
+  if (index < 4)
+    return index;
+  return static_cast<uint64_t>(4 + index % 4) << (index / 4 - 1);
+}
+
+uint64_t LatencyHistogram::count() const {
+  uint64_t total(0);
+  for (auto bucket_count : bucket_counts)
+    total += bucket_count;
+  return total;
+}
+
+const size_t MessageLatency::kBucketCount;
+
+size_t MessageLatency::BucketIndex(uint64_t microseconds) {
+  if (microseconds < 4)
+    return static_cast<size_t>(microseconds);
+  size_t most_significant_bit(0);
+  for (uint64_t value(microseconds); value > 1; value >>= 1)
+    ++most_significant_bit;
+  size_t index((most_significant_bit - 1) * 4 + ((microseconds >> (most_significant_bit - 2)) & 3));
+  return std::min(index, kBucketCount - 1);
+}
+
+MessageLatency::Scope::Scope(MessageLatency& message_latency, const protobuf::Message& message,
+                             Clock::time_point received_time)
+    : message_latency_(message_latency),
+      type_slot_(TypeSlot(message.type())),
+      destination_class_(ClassOf(message)),
+      received_time_(received_time),
+      marked_(),
+      outer_scope_(CurrentScope().get()) {
+  marked_.fill(false);
+  CurrentScope().reset(this);
+}
+
+MessageLatency::Scope::~Scope() { CurrentScope().reset(outer_scope_); }
+
+MessageLatency::MessageLatency() : buckets_() {
+  for (auto& type_buckets : buckets_) {
+    for (auto& class_buckets : type_buckets) {
+      for (auto& stage_buckets : class_buckets) {
+        for (auto& bucket : stage_buckets)
+          bucket.store(0);
+      }
+    }
+  }
+}
+
+void MessageLatency::Mark(MessageStage stage) {
+  Scope* scope(CurrentScope().get());
+  size_t stage_index(static_cast<size_t>(stage));
+  if (!scope || scope->marked_[stage_index])
+    return;
+  scope->marked_[stage_index] = true;
+  auto elapsed(std::chrono::duration_cast<std::chrono::microseconds>(
+      Clock::now() - scope->received_time_).count());
+  auto& buckets(scope->message_latency_.buckets_[scope->type_slot_][scope->destination_class_]
+                                                [stage_index]);
+  buckets[BucketIndex(static_cast<uint64_t>(std::max<decltype(elapsed)>(elapsed, 0)))]
+      .fetch_add(1, std::memory_order_relaxed);
+}
+
+std::vector<LatencyHistogram> MessageLatency::Histograms() const {
+  std::vector<LatencyHistogram> histograms;
+  for (size_t type_slot(0); type_slot != buckets_.size(); ++type_slot) {
+    for (size_t class_index(0); class_index != buckets_[type_slot].size(); ++class_index) {
+      for (size_t stage_index(0); stage_index != buckets_[type_slot][class_index].size();
+           ++stage_index) {
+        LatencyHistogram histogram;
+        histogram.message_type = (type_slot == kNodeLevelSlot)
+                                     ? static_cast<int32_t>(MessageType::kNodeLevel)
+                                     : static_cast<int32_t>(type_slot);
+        histogram.destination_class = static_cast<DestinationClass>(class_index);
+        histogram.stage = static_cast<MessageStage>(stage_index);
+        for (const auto& bucket : buckets_[type_slot][class_index][stage_index])
+          histogram.bucket_counts.push_back(bucket.load(std::memory_order_relaxed));
+        if (histogram.count() != 0)
+          histograms.push_back(histogram);
+      }
+    }
+  }
+  return histograms;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
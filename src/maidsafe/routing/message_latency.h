@@ -0,0 +1,86 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_MESSAGE_LATENCY_H_
+#define MAIDSAFE_ROUTING_MESSAGE_LATENCY_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "maidsafe/routing/latency_histogram.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace protobuf {
+class Message;
+}
+
+// Lock-free latency histograms for the stages of handling received messages.  Handling code
+// calls the static Mark at each stage; this is recorded against whichever message the calling
+// thread is handling, as set up by a Scope, and is a no-op if there is none.
+class MessageLatency {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  // Maps a latency in microseconds to its bucket, saturating at the last one.
+  static size_t BucketIndex(uint64_t microseconds);
+  static const size_t kBucketCount = 124;
+
+  class Scope {
+   public:
+    Scope(MessageLatency& message_latency, const protobuf::Message& message,
+          Clock::time_point received_time);
+    ~Scope();
+
+   private:
+    friend class MessageLatency;
+    Scope(const Scope&);
+    Scope& operator=(const Scope&);
+
+    MessageLatency& message_latency_;
+    size_t type_slot_, destination_class_;
+    Clock::time_point received_time_;
+    std::array<bool, 4> marked_;
+    Scope* outer_scope_;
+  };
+
+  MessageLatency();
+  // Only the first Mark of each stage within a Scope is recorded.
+  static void Mark(MessageStage stage);
+  // Returns the histograms with at least one entry
+  std::vector<LatencyHistogram> Histograms() const;
+
+ private:
+  MessageLatency(const MessageLatency&);
+  MessageLatency& operator=(const MessageLatency&);
+
+  typedef std::array<std::atomic<uint64_t>, kBucketCount> Buckets;
+  // Indexed by type slot, destination class and stage.
+  std::array<std::array<std::array<Buckets, 4>, 3>, 10> buckets_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_MESSAGE_LATENCY_H_
@@ -0,0 +1,219 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/message_stream.h"
+
+#include <cassert>
+
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/utils.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+std::pair<std::string, int32_t> StreamKeyOf(const protobuf::Message& message) {
+  return std::make_pair(message.has_source_id() ? message.source_id() : message.relay_id(),
+                        message.stream_id());
+}
+
+}  // unnamed namespace
+
+StreamSender::StreamSender(Timer<std::string>& timer, const protobuf::Message& header,
+                           std::string payload, uint32_t frame_size, uint16_t window,
+                           std::chrono::steady_clock::duration frame_timeout,
+                           SendFunctor send_functor, std::function<void()> failure_functor)
+    : timer_(timer),
+      kHeader_(header),
+      kPayload_(std::move(payload)),
+      kFrameSize_(frame_size),
+      kFrameCount_(FrameCount(kPayload_.size(), frame_size)),
+      kWindow_(window),
+      kFrameTimeout_(frame_timeout),
+      send_functor_(std::move(send_functor)),
+      failure_functor_(std::move(failure_functor)),
+      mutex_(),
+      next_frame_(0),
+      frames_in_flight_(0),
+      failed_(false) {
+  assert(kFrameSize_ > 0 && kWindow_ > 0 && kHeader_.has_stream_id());
+}
+
+uint32_t StreamSender::FrameCount(size_t payload_size, uint32_t frame_size) {
+  return static_cast<uint32_t>((payload_size + frame_size - 1) / frame_size);
+}
+
+void StreamSender::Start() { SendFrames(); }
+
+void StreamSender::SendFrames() {
+  std::vector<protobuf::Message> frames;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (!failed_ && frames_in_flight_ < kWindow_ && next_frame_ < kFrameCount_) {
+      frames.push_back(kHeader_);
+      frames.back().add_data(kPayload_.substr(static_cast<size_t>(next_frame_) * kFrameSize_,
+                                              kFrameSize_));
+      frames.back().set_stream_frame(next_frame_++);
+      frames.back().set_stream_frame_count(kFrameCount_);
+      frames.back().set_id(timer_.NewTaskId());
+      ++frames_in_flight_;
+    }
+  }
+  auto this_ptr(shared_from_this());
+  for (auto& frame : frames) {
+    timer_.AddTask(kFrameTimeout_,
+                   [this_ptr](std::string acknowledgement) {
+                     this_ptr->OnAcknowledgement(acknowledgement);
+                   },
+                   1, frame.id());
+    send_functor_(frame);
+  }
+}
+
+void StreamSender::OnAcknowledgement(const std::string& acknowledgement) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (failed_)
+      return;
+    if (!acknowledgement.empty()) {
+      --frames_in_flight_;
+    } else {
+      failed_ = true;
+    }
+  }
+  if (!acknowledgement.empty())
+    return SendFrames();
+  LOG(kWarning) << "Abandoning stream " << kHeader_.stream_id() << " to "
+                << HexSubstr(kHeader_.destination_id()) << "; a frame was not acknowledged.";
+  failure_functor_();
+}
+
+StreamReassembler::StreamReassembler(Clock::duration timeout, size_t max_streams,
+                                     size_t max_stream_size, size_t max_total_size)
+    : kTimeout_(timeout),
+      kMaxStreams_(max_streams),
+      kMaxStreamSize_(max_stream_size),
+      kMaxTotalSize_(max_total_size),
+      mutex_(),
+      streams_(),
+      total_size_(0) {}
+
+StreamReassembler::Result StreamReassembler::Add(protobuf::Message& message) {
+  const uint32_t kFrameCount(message.stream_frame_count());
+  if (message.data_size() != 1 || message.data(0).empty() ||
+      message.stream_frame() >= kFrameCount) {
+    LOG(kWarning) << "Invalid stream frame dropped, id: " << message.id();
+    return Result::kDropped;
+  }
+  const StreamKey kKey(StreamKeyOf(message));
+  const Clock::time_point kNow(Clock::now());
+  std::lock_guard<std::mutex> lock(mutex_);
+  Prune(kNow);
+  auto itr(streams_.find(kKey));
+  if (itr == streams_.end()) {
+    if (streams_.size() >= kMaxStreams_) {
+      LOG(kWarning) << "Dropping frame of stream " << message.stream_id() << " from "
+                    << HexSubstr(kKey.first) << "; too many streams incomplete.";
+      return Result::kDropped;
+    }
+    itr = streams_.insert(std::make_pair(kKey, Stream(kFrameCount))).first;
+  }
+  Stream& stream(itr->second);
+  if (stream.frame_count != kFrameCount)
+    return Result::kDropped;
+  if (stream.frames.count(message.stream_frame()) != 0)
+    return Result::kHeld;
+  const size_t kFrameSize(message.data(0).size());
+  if (stream.size + kFrameSize > kMaxStreamSize_) {
+    LOG(kWarning) << "Dropping stream " << message.stream_id() << " from "
+                  << HexSubstr(kKey.first) << "; too large.";
+    Erase(itr);
+    return Result::kDropped;
+  }
+  if (total_size_ + kFrameSize > kMaxTotalSize_) {
+    LOG(kWarning) << "Dropping frame of stream " << message.stream_id() << " from "
+                  << HexSubstr(kKey.first) << "; too much of other streams held.";
+    if (stream.frames.empty())
+      streams_.erase(itr);
+    return Result::kDropped;
+  }
+  stream.size += kFrameSize;
+  total_size_ += kFrameSize;
+  stream.frames[message.stream_frame()].swap(*message.mutable_data(0));
+  stream.last_frame_time = kNow;
+  if (stream.frames.size() != kFrameCount)
+    return Result::kHeld;
+
+  std::string payload;
+  payload.reserve(stream.size);
+  for (const auto& frame : stream.frames)
+    payload.append(frame.second);
+  Erase(itr);
+  message.mutable_data(0)->swap(payload);
+  return Result::kComplete;
+}
+
+void StreamReassembler::Prune(Clock::time_point now) {
+  for (auto itr(streams_.begin()); itr != streams_.end();) {
+    if (now - itr->second.last_frame_time > kTimeout_)
+      Erase(itr++);
+    else
+      ++itr;
+  }
+}
+
+void StreamReassembler::Erase(std::map<StreamKey, Stream>::iterator itr) {
+  assert(total_size_ >= itr->second.size);
+  total_size_ -= itr->second.size;
+  streams_.erase(itr);
+}
+
+StreamRoutes::StreamRoutes(size_t capacity)
+    : kCapacity_(capacity), next_hops_(), insertion_order_() {}
+
+StreamRoutes::StreamKey StreamRoutes::Key(const protobuf::Message& message) {
+  return StreamKeyOf(message);
+}
+
+bool StreamRoutes::Get(const protobuf::Message& message, NodeId& next_hop) const {
+  auto itr(next_hops_.find(Key(message)));
+  if (itr == next_hops_.end())
+    return false;
+  next_hop = itr->second;
+  return true;
+}
+
+void StreamRoutes::Set(const protobuf::Message& message, const NodeId& next_hop) {
+  const StreamKey kKey(Key(message));
+  auto result(next_hops_.insert(std::make_pair(kKey, next_hop)));
+  if (!result.second) {
+    result.first->second = next_hop;
+    return;
+  }
+  insertion_order_.push_back(kKey);
+  if (insertion_order_.size() > kCapacity_) {
+    next_hops_.erase(insertion_order_.front());
+    insertion_order_.pop_front();
+  }
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
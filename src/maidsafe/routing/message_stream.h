@@ -0,0 +1,146 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_MESSAGE_STREAM_H_
+#define MAIDSAFE_ROUTING_MESSAGE_STREAM_H_
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+
+#include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/timer.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// Sends a payload too large for a single message as a stream of frames of up to frame_size bytes,
+// keeping up to window of them unacknowledged.  The destination acknowledges each frame as it
+// arrives; if any frame isn't acknowledged within frame_timeout the stream is abandoned and
+// failure_functor is called.  The reassembled payload is delivered with the
+// stream's ID as its message ID, so the reply to it completes a task with that ID.
+class StreamSender : public std::enable_shared_from_this<StreamSender> {
+ public:
+  typedef std::function<void(protobuf::Message& /*frame*/)> SendFunctor;
+
+  // |header| is a node-level request with no data and its stream_id already set.
+  StreamSender(Timer<std::string>& timer, const protobuf::Message& header, std::string payload,
+               uint32_t frame_size, uint16_t window,
+               std::chrono::steady_clock::duration frame_timeout, SendFunctor send_functor,
+               std::function<void()> failure_functor);
+  static uint32_t FrameCount(size_t payload_size, uint32_t frame_size);
+  void Start();
+
+ private:
+  StreamSender(const StreamSender&);
+  StreamSender& operator=(const StreamSender&);
+
+  void SendFrames();
+  void OnAcknowledgement(const std::string& acknowledgement);
+
+  Timer<std::string>& timer_;
+  const protobuf::Message kHeader_;
+  const std::string kPayload_;
+  const uint32_t kFrameSize_, kFrameCount_;
+  const uint16_t kWindow_;
+  const std::chrono::steady_clock::duration kFrameTimeout_;
+  SendFunctor send_functor_;
+  std::function<void()> failure_functor_;
+  std::mutex mutex_;
+  uint32_t next_frame_, frames_in_flight_;
+  bool failed_;
+};
+
+// Collects the frames of streams sent to this node.  Streams are told apart by sender and stream
+// ID, and one which hasn't had a frame for timeout is discarded.
+class StreamReassembler {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  enum class Result { kDropped, kHeld, kComplete };
+
+  // At most max_streams incomplete streams of up to max_stream_size bytes, and max_total_size
+  // bytes between them, are held at once.
+  StreamReassembler(Clock::duration timeout, size_t max_streams, size_t max_stream_size,
+                    size_t max_total_size);
+  // Adds message's frame.  kComplete means it completed its stream and message's data has been
+  // replaced by the whole payload; kHeld that the frame is held (or was already) awaiting the
+  // rest.  Invalid frames, and those of streams which can't be held, are kDropped and shouldn't be
+  // acknowledged.
+  Result Add(protobuf::Message& message);
+
+ private:
+  StreamReassembler(const StreamReassembler&);
+  StreamReassembler& operator=(const StreamReassembler&);
+
+  typedef std::pair<std::string, int32_t> StreamKey;
+  struct Stream {
+    explicit Stream(uint32_t frame_count_in)
+        : frame_count(frame_count_in), frames(), size(0), last_frame_time() {}
+    uint32_t frame_count;
+    std::map<uint32_t, std::string> frames;  // by index, so only frames received take space
+    size_t size;
+    Clock::time_point last_frame_time;
+  };
+
+  void Prune(Clock::time_point now);
+  void Erase(std::map<StreamKey, Stream>::iterator itr);
+
+  const Clock::duration kTimeout_;
+  const size_t kMaxStreams_, kMaxStreamSize_, kMaxTotalSize_;
+  std::mutex mutex_;
+  std::map<StreamKey, Stream> streams_;
+  size_t total_size_;
+};
+
+// The next hops chosen for recent streams' frames, so that each stream's frames follow the same
+// route.  Not threadsafe.
+class StreamRoutes {
+ public:
+  explicit StreamRoutes(size_t capacity);
+  // Returns false if no next hop is held for message's stream.
+  bool Get(const protobuf::Message& message, NodeId& next_hop) const;
+  void Set(const protobuf::Message& message, const NodeId& next_hop);
+
+ private:
+  StreamRoutes(const StreamRoutes&);
+  StreamRoutes& operator=(const StreamRoutes&);
+
+  typedef std::pair<std::string, int32_t> StreamKey;
+  static StreamKey Key(const protobuf::Message& message);
+
+  const size_t kCapacity_;
+  std::map<StreamKey, NodeId> next_hops_;
+  std::deque<StreamKey> insertion_order_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_MESSAGE_STREAM_H_
@@ -0,0 +1,183 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/message_trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include "boost/thread/tss.hpp"
+
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/route_history.h"
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+// Written only by its own thread; the mutex is only ever contended by a dump.
+struct Ring {
+  Ring() : mutex(), events(MessageTrace::kRingCapacity), next(0), size(0) {}
+  std::mutex mutex;
+  std::vector<TraceEvent> events;
+  size_t next, size;
+};
+
+// Rings outlive their threads until their events have been dumped.
+struct Rings {
+  Rings() : mutex(), rings() {}
+  std::mutex mutex;
+  std::vector<std::shared_ptr<Ring>> rings;
+};
+
+Rings& AllRings() {
+  static Rings all_rings;
+  return all_rings;
+}
+
+Ring& ThisThreadsRing() {
+  static boost::thread_specific_ptr<std::shared_ptr<Ring>> this_threads_ring;
+  if (!this_threads_ring.get()) {
+    auto ring(std::make_shared<Ring>());
+    {
+      Rings& all_rings(AllRings());
+      std::lock_guard<std::mutex> lock(all_rings.mutex);
+      all_rings.rings.push_back(ring);
+    }
+    this_threads_ring.reset(new std::shared_ptr<Ring>(ring));
+  }
+  return **this_threads_ring;
+}
+
+void Add(const protobuf::Message& message, const NodeId& this_node_id, TraceDecision decision,
+         uint64_t next_hop, uint32_t queue_delay) {
+  TraceEvent event;
+  event.trace_id = message.trace_id();
+  event.node = RouteHistory::Prefix(this_node_id);
+  event.next_hop = next_hop;
+  event.timestamp = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count());
+  event.queue_delay = queue_delay;
+  event.decision = decision;
+  Ring& ring(ThisThreadsRing());
+  std::lock_guard<std::mutex> lock(ring.mutex);
+  ring.events[ring.next] = event;
+  ring.next = (ring.next + 1) % ring.events.size();
+  ring.size = std::min(ring.size + 1, ring.events.size());
+}
+
+}  // unnamed namespace
+
+TraceEvent::TraceEvent()
+    : trace_id(0),
+      node(0),
+      next_hop(0),
+      timestamp(0),
+      queue_delay(0),
+      decision(TraceDecision::kOriginated) {}
+
+const size_t MessageTrace::kRingCapacity;
+
+void MessageTrace::Sample(protobuf::Message& message, const NodeId& this_node_id) {
+  static std::atomic<uint32_t> sent_count(0);
+  const uint32_t kInterval(Parameters::trace_sample_interval);
+  if (kInterval == 0 || message.has_trace_id() || ++sent_count % kInterval != 0)
+    return;
+  message.set_trace_id((static_cast<uint64_t>(RandomUint32()) << 32) | RandomUint32());
+  Add(message, this_node_id, TraceDecision::kOriginated, 0, 0);
+}
+
+void MessageTrace::Record(const protobuf::Message& message, const NodeId& this_node_id,
+                          TraceDecision decision) {
+  if (message.has_trace_id())
+    Add(message, this_node_id, decision, 0, 0);
+}
+
+void MessageTrace::RecordReceived(const protobuf::Message& message, const NodeId& this_node_id,
+                                  std::chrono::steady_clock::time_point received_time) {
+  if (!message.has_trace_id())
+    return;
+  auto queue_delay(std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - received_time).count());
+  Add(message, this_node_id, TraceDecision::kReceived, 0, static_cast<uint32_t>(queue_delay));
+}
+
+void MessageTrace::RecordSent(const protobuf::Message& message, const NodeId& this_node_id,
+                              const NodeId& next_hop) {
+  if (message.has_trace_id())
+    Add(message, this_node_id, TraceDecision::kSent, RouteHistory::Prefix(next_hop), 0);
+}
+
+void MessageTrace::Clear() {
+  Rings& all_rings(AllRings());
+  std::lock_guard<std::mutex> lock(all_rings.mutex);
+  for (auto& ring : all_rings.rings) {
+    std::lock_guard<std::mutex> ring_lock(ring->mutex);
+    ring->next = ring->size = 0;
+  }
+}
+
+std::vector<TraceEvent> DumpTraceEvents() {
+  std::vector<TraceEvent> events;
+  Rings& all_rings(AllRings());
+  std::lock_guard<std::mutex> lock(all_rings.mutex);
+  for (auto& ring : all_rings.rings) {
+    std::lock_guard<std::mutex> ring_lock(ring->mutex);
+    const size_t kCapacity(ring->events.size());
+    for (size_t i(0); i != ring->size; ++i)
+      events.push_back(ring->events[(ring->next + kCapacity - ring->size + i) % kCapacity]);
+  }
+  // Only the registry still holds the rings of threads which have finished.
+  all_rings.rings.erase(std::remove_if(std::begin(all_rings.rings), std::end(all_rings.rings),
+                                       [](const std::shared_ptr<Ring>& ring) {
+                                         return ring.use_count() == 1;
+                                       }),
+                        std::end(all_rings.rings));
+  std::stable_sort(std::begin(events), std::end(events), [](const TraceEvent& lhs,
+                                                     const TraceEvent& rhs) {
+    return std::tie(lhs.trace_id, lhs.timestamp) < std::tie(rhs.trace_id, rhs.timestamp);
+  });
+  return events;
+}
+
+void WriteTraceEvents(const std::vector<TraceEvent>& events, std::ostream& stream) {
+  const auto kFlags(stream.flags());
+  const auto kFill(stream.fill('0'));
+  for (const auto& event : events) {
+    stream << std::hex << std::setw(16) << event.trace_id << ' ' << std::setw(16) << event.node
+           << ' ' << std::dec << event.timestamp << ' ' << static_cast<int>(event.decision) << ' '
+           << std::hex << std::setw(16) << event.next_hop << ' ' << std::dec << event.queue_delay
+           << '\n';
+  }
+  stream.fill(kFill);
+  stream.flags(kFlags);
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
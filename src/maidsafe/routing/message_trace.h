@@ -0,0 +1,64 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_MESSAGE_TRACE_H_
+#define MAIDSAFE_ROUTING_MESSAGE_TRACE_H_
+
+#include <chrono>
+#include <cstddef>
+
+#include "maidsafe/common/node_id.h"
+
+#include "maidsafe/routing/trace_event.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace protobuf {
+class Message;
+}
+
+// Records TraceEvents for messages carrying a trace_id.  Each recording thread has a ring buffer of
+// its own, so recording takes no shared lock, and only the latest kRingCapacity events per thread
+// are kept.  Untraced messages cost a single field test.
+class MessageTrace {
+ public:
+  static const size_t kRingCapacity = 1024;
+
+  // Gives message a new trace id and records kOriginated if it's the one in
+  // Parameters::trace_sample_interval to be sampled.
+  static void Sample(protobuf::Message& message, const NodeId& this_node_id);
+  static void Record(const protobuf::Message& message, const NodeId& this_node_id,
+                     TraceDecision decision);
+  static void RecordReceived(const protobuf::Message& message, const NodeId& this_node_id,
+                             std::chrono::steady_clock::time_point received_time);
+  static void RecordSent(const protobuf::Message& message, const NodeId& this_node_id,
+                         const NodeId& next_hop);
+  // Discards all recorded events.
+  static void Clear();
+
+ private:
+  MessageTrace();
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_MESSAGE_TRACE_H_
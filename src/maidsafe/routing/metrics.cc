@@ -0,0 +1,280 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/metrics.h"
+
+#include <algorithm>
+#include <functional>
+#include <sstream>
+#include <thread>
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+const size_t kNodeLevelSlot(9);
+const int32_t kNodeLevelType(101);
+
+std::string TypeName(int32_t type) {
+  switch (type) {
+    case 1:
+      return "ping";
+    case 2:
+      return "connect";
+    case 3:
+      return "find_nodes";
+    case 4:
+      return "connect_success";
+    case 5:
+      return "connect_success_acknowledgement";
+    case 6:
+      return "remove";
+    case 7:
+      return "closest_nodes_update";
+    case 8:
+      return "get_group";
+    case kNodeLevelType:
+      return "node_level";
+    default:
+      return "unknown";
+  }
+}
+
+const char* DropReasonName(size_t reason) {
+  static const char* const kNames[] = {"uninitialised", "no_hops_left", "invalid_destination",
+                                       "no_source", "invalid_source", "invalid_relay",
+                                       "must_be_direct", "duplicate", "overloaded",
+                                       "upcall_queue_full", "route_loop", "rate_limited",
+                                       "expired"};
+  static_assert(sizeof(kNames) / sizeof(kNames[0]) == static_cast<size_t>(DropReason::kCount),
+                "Every DropReason needs a name.");
+  return kNames[reason];
+}
+
+const char* HopClassName(size_t hop_class) {
+  static const char* const kNames[] = {"routing", "direct", "group"};
+  static_assert(sizeof(kNames) / sizeof(kNames[0]) == static_cast<size_t>(HopClass::kCount),
+                "Every HopClass needs a name.");
+  return kNames[hop_class];
+}
+
+void WriteMessageCounts(std::ostream& stream, const std::string& name,
+                        const std::map<int32_t, uint64_t>& counts) {
+  stream << "# TYPE " << name << " counter\n";
+  for (const auto& count : counts) {
+    stream << name << "{type=\"" << TypeName(count.first) << "\"} " << count.second << '\n';
+  }
+}
+
+void WriteValue(std::ostream& stream, const std::string& name, const char* type,
+                uint64_t value) {
+  stream << "# TYPE " << name << ' ' << type << '\n' << name << ' ' << value << '\n';
+}
+
+// The last bucket has no upper bound, so only counts towards +Inf.  The sum treats its messages as
+// having taken exactly its number of hops.  labels, if not empty, ends with a comma.
+void WriteHopHistogram(std::ostream& stream, const std::string& name, const std::string& labels,
+                       const std::vector<uint64_t>& hops) {
+  uint64_t cumulative(0), sum(0);
+  for (size_t i(0); i != hops.size(); ++i) {
+    cumulative += hops[i];
+    sum += i * hops[i];
+    if (i + 1 != hops.size())
+      stream << name << "_bucket{" << labels << "le=\"" << i << "\"} " << cumulative << '\n';
+  }
+  const std::string kLabels(labels.empty() ? std::string()
+                                           : "{" + labels.substr(0, labels.size() - 1) + "}");
+  stream << name << "_bucket{" << labels << "le=\"+Inf\"} " << cumulative << '\n' << name
+         << "_sum" << kLabels << ' ' << sum << '\n' << name << "_count" << kLabels << ' '
+         << cumulative << '\n';
+}
+
+}  // unnamed namespace
+
+const char* StartupPhaseName(size_t phase) {
+  static const char* const kNames[] = {"construct", "message_handler", "bootstrap"};
+  static_assert(sizeof(kNames) / sizeof(kNames[0]) == static_cast<size_t>(StartupPhase::kCount),
+                "Every StartupPhase needs a name.");
+  return kNames[phase];
+}
+
+MetricsSnapshot::MetricsSnapshot()
+    : messages_in(),
+      messages_out(),
+      forwarded(0),
+      delivered(0),
+      drops(static_cast<size_t>(DropReason::kCount), 0),
+      hops_taken(Metrics::kHopBuckets, 0),
+      hops_by_class(static_cast<size_t>(HopClass::kCount),
+                    std::vector<uint64_t>(Metrics::kHopBuckets, 0)),
+      send_retries(0),
+      send_failures(0),
+      upcalls(0),
+      upcall_queue_delay_us(0),
+      startup_us(static_cast<size_t>(StartupPhase::kCount), 0),
+      routing_table_size(0),
+      client_routing_table_size(0),
+      group_matrix_size(0),
+      timer_tasks_outstanding(0),
+      connects_queued(0),
+      connects_in_flight(0),
+      upcalls_queued(0) {}
+
+std::string ToPrometheusText(const MetricsSnapshot& snapshot, const std::string& prefix) {
+  std::ostringstream stream;
+  WriteMessageCounts(stream, prefix + "_messages_in_total", snapshot.messages_in);
+  WriteMessageCounts(stream, prefix + "_messages_out_total", snapshot.messages_out);
+  WriteValue(stream, prefix + "_forwarded_total", "counter", snapshot.forwarded);
+  WriteValue(stream, prefix + "_delivered_total", "counter", snapshot.delivered);
+  stream << "# TYPE " << prefix << "_drops_total counter\n";
+  for (size_t i(0); i != snapshot.drops.size(); ++i) {
+    stream << prefix << "_drops_total{reason=\"" << DropReasonName(i) << "\"} "
+           << snapshot.drops[i] << '\n';
+  }
+  stream << "# TYPE " << prefix << "_hops_taken histogram\n";
+  WriteHopHistogram(stream, prefix + "_hops_taken", "", snapshot.hops_taken);
+  stream << "# TYPE " << prefix << "_hops_by_class histogram\n";
+  for (size_t i(0); i != snapshot.hops_by_class.size(); ++i) {
+    WriteHopHistogram(stream, prefix + "_hops_by_class",
+                      std::string("class=\"") + HopClassName(i) + "\",", snapshot.hops_by_class[i]);
+  }
+  WriteValue(stream, prefix + "_send_retries_total", "counter", snapshot.send_retries);
+  WriteValue(stream, prefix + "_send_failures_total", "counter", snapshot.send_failures);
+  WriteValue(stream, prefix + "_upcalls_total", "counter", snapshot.upcalls);
+  WriteValue(stream, prefix + "_upcall_queue_delay_microseconds_total", "counter",
+             snapshot.upcall_queue_delay_us);
+  stream << "# TYPE " << prefix << "_startup_microseconds gauge\n";
+  for (size_t i(0); i != snapshot.startup_us.size(); ++i) {
+    stream << prefix << "_startup_microseconds{phase=\"" << StartupPhaseName(i) << "\"} "
+           << snapshot.startup_us[i] << '\n';
+  }
+  WriteValue(stream, prefix + "_routing_table_size", "gauge", snapshot.routing_table_size);
+  WriteValue(stream, prefix + "_client_routing_table_size", "gauge",
+             snapshot.client_routing_table_size);
+  WriteValue(stream, prefix + "_group_matrix_size", "gauge", snapshot.group_matrix_size);
+  WriteValue(stream, prefix + "_timer_tasks_outstanding", "gauge",
+             snapshot.timer_tasks_outstanding);
+  WriteValue(stream, prefix + "_connects_queued", "gauge", snapshot.connects_queued);
+  WriteValue(stream, prefix + "_connects_in_flight", "gauge", snapshot.connects_in_flight);
+  WriteValue(stream, prefix + "_upcalls_queued", "gauge", snapshot.upcalls_queued);
+  return stream.str();
+}
+
+const size_t ShardedCounter::kShardCount_;
+
+ShardedCounter::ShardedCounter() : shards_() {}
+
+uint64_t ShardedCounter::Value() const {
+  uint64_t total(0);
+  for (const auto& shard : shards_)
+    total += shard.value.load(std::memory_order_relaxed);
+  return total;
+}
+
+// Thread ids are often aligned addresses, so their low bits are mixed in before picking a shard.
+size_t ShardedCounter::ThisThreadShard() {
+  const uint64_t kHash(std::hash<std::thread::id>()(std::this_thread::get_id()));
+  return static_cast<size_t>((kHash * 0x9E3779B97F4A7C15ULL) >> 60) % kShardCount_;
+}
+
+const size_t Metrics::kHopBuckets;
+const size_t Metrics::kTypeSlots_;
+
+Metrics::Metrics()
+    : messages_in_(),
+      messages_out_(),
+      forwarded_(),
+      delivered_(),
+      drops_(),
+      hops_taken_(),
+      hops_by_class_(),
+      send_retries_(),
+      send_failures_(),
+      upcalls_(),
+      upcall_queue_delay_us_(),
+      startup_us_() {
+  for (auto& hops : hops_by_class_) {
+    for (auto& bucket : hops)
+      bucket.store(0);
+  }
+  for (auto& phase : startup_us_)
+    phase.store(0);
+}
+
+void Metrics::Delivered(int32_t hops_taken, HopClass hop_class) {
+  const size_t kBucket(std::min(static_cast<size_t>(std::max(hops_taken, 0)), kHopBuckets - 1));
+  delivered_.Add();
+  hops_taken_[kBucket].Add();
+  hops_by_class_[static_cast<size_t>(hop_class)][kBucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void Metrics::UpcallDequeued(std::chrono::steady_clock::duration queue_delay) {
+  upcalls_.Add();
+  upcall_queue_delay_us_.Add(static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(queue_delay).count()));
+}
+
+void Metrics::StartupPhaseTimed(StartupPhase phase, std::chrono::steady_clock::duration duration) {
+  // At least 1, so that a phase which was reached is never left looking unreached.
+  uint64_t unset(0), microseconds(std::max<uint64_t>(
+      static_cast<uint64_t>(
+          std::chrono::duration_cast<std::chrono::microseconds>(duration).count()), 1));
+  startup_us_[static_cast<size_t>(phase)].compare_exchange_strong(unset, microseconds);
+}
+
+void Metrics::Snapshot(MetricsSnapshot& snapshot) const {
+  for (size_t slot(0); slot != kTypeSlots_; ++slot) {
+    const int32_t kType(slot == kNodeLevelSlot ? kNodeLevelType : static_cast<int32_t>(slot));
+    if (const uint64_t kIn = messages_in_[slot].Value())
+      snapshot.messages_in[kType] = kIn;
+    if (const uint64_t kOut = messages_out_[slot].Value())
+      snapshot.messages_out[kType] = kOut;
+  }
+  snapshot.forwarded = forwarded_.Value();
+  snapshot.delivered = delivered_.Value();
+  snapshot.drops.assign(drops_.size(), 0);
+  for (size_t i(0); i != drops_.size(); ++i)
+    snapshot.drops[i] = drops_[i].Value();
+  snapshot.hops_taken.assign(hops_taken_.size(), 0);
+  for (size_t i(0); i != hops_taken_.size(); ++i)
+    snapshot.hops_taken[i] = hops_taken_[i].Value();
+  snapshot.hops_by_class.assign(hops_by_class_.size(), std::vector<uint64_t>(kHopBuckets, 0));
+  for (size_t i(0); i != hops_by_class_.size(); ++i) {
+    for (size_t j(0); j != kHopBuckets; ++j)
+      snapshot.hops_by_class[i][j] = hops_by_class_[i][j].load(std::memory_order_relaxed);
+  }
+  snapshot.send_retries = send_retries_.Value();
+  snapshot.send_failures = send_failures_.Value();
+  snapshot.upcalls = upcalls_.Value();
+  snapshot.upcall_queue_delay_us = upcall_queue_delay_us_.Value();
+  snapshot.startup_us.assign(startup_us_.size(), 0);
+  for (size_t i(0); i != startup_us_.size(); ++i)
+    snapshot.startup_us[i] = startup_us_[i].load();
+}
+
+size_t Metrics::TypeSlot(int32_t type) {
+  if (type > 0 && type < static_cast<int32_t>(kNodeLevelSlot))
+    return static_cast<size_t>(type);
+  return type == kNodeLevelType ? kNodeLevelSlot : 0;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,104 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_METRICS_H_
+#define MAIDSAFE_ROUTING_METRICS_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "maidsafe/routing/metrics_snapshot.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// A counter split into cache-line sized shards, each thread adding to its own with a relaxed
+// atomic increment, so that busy threads don't contend.  Reads sum the shards.
+class ShardedCounter {
+ public:
+  ShardedCounter();
+  void Add(uint64_t value = 1) {
+    shards_[ThisThreadShard()].value.fetch_add(value, std::memory_order_relaxed);
+  }
+  uint64_t Value() const;
+
+ private:
+  static const size_t kShardCount_ = 16;
+  struct alignas(64) Shard {
+    Shard() : value(0) {}
+    std::atomic<uint64_t> value;
+  };
+
+  ShardedCounter(const ShardedCounter&);
+  ShardedCounter& operator=(const ShardedCounter&);
+  static size_t ThisThreadShard();
+
+  std::array<Shard, kShardCount_> shards_;
+};
+
+// The name the metrics output gives phase, a StartupPhase as an index.
+const char* StartupPhaseName(size_t phase);
+
+// The counters behind Routing::GetMetricsSnapshot.  Recording never takes a lock.
+class Metrics {
+ public:
+  static const size_t kHopBuckets = 64;
+
+  Metrics();
+  void MessageIn(int32_t type) { messages_in_[TypeSlot(type)].Add(); }
+  void MessageOut(int32_t type) { messages_out_[TypeSlot(type)].Add(); }
+  void Forwarded() { forwarded_.Add(); }
+  // hops_taken is the hops_to_live the message was given less that remaining (see HopsTaken).
+  void Delivered(int32_t hops_taken, HopClass hop_class);
+  void Dropped(DropReason reason) { drops_[static_cast<size_t>(reason)].Add(); }
+  void SendRetried() { send_retries_.Add(); }
+  void SendFailed() { send_failures_.Add(); }
+  void UpcallDequeued(std::chrono::steady_clock::duration queue_delay);
+  // Only the first duration given for each phase is kept.
+  void StartupPhaseTimed(StartupPhase phase, std::chrono::steady_clock::duration duration);
+  // Sets the counts in snapshot, leaving its gauges for the caller.
+  void Snapshot(MetricsSnapshot& snapshot) const;
+
+ private:
+  static const size_t kTypeSlots_ = 10;
+
+  Metrics(const Metrics&);
+  Metrics& operator=(const Metrics&);
+  static size_t TypeSlot(int32_t type);
+
+  std::array<ShardedCounter, kTypeSlots_> messages_in_, messages_out_;
+  ShardedCounter forwarded_, delivered_;
+  std::array<ShardedCounter, static_cast<size_t>(DropReason::kCount)> drops_;
+  std::array<ShardedCounter, kHopBuckets> hops_taken_;
+  // Unsharded, as sharding each would cost more memory than the histogram they're a split of.
+  std::array<std::array<std::atomic<uint64_t>, kHopBuckets>,
+             static_cast<size_t>(HopClass::kCount)> hops_by_class_;
+  ShardedCounter send_retries_, send_failures_;
+  ShardedCounter upcalls_, upcall_queue_delay_us_;
+  std::array<std::atomic<uint64_t>, static_cast<size_t>(StartupPhase::kCount)> startup_us_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_METRICS_H_
@@ -57,17 +57,13 @@ void NetworkStatistics::UpdateLocalAverageDistance(std::vector<NodeId>& unique_n
 void NetworkStatistics::UpdateNetworkAverageDistance(const NodeId& distance) {
   if (distance == NodeId())
     return;
-  crypto::BigInt distance_integer(
-      (distance.ToStringEncoded(NodeId::EncodingType::kHex) + 'h').c_str());
+  XorDistance distance_integer(distance);
   {
     std::lock_guard<std::mutex> lock(mutex_);
     network_distance_data_.total_distance += distance_integer;
-    auto average(network_distance_data_.total_distance /
-                 ++network_distance_data_.contributors_count);
-    std::string average_str(NodeId::kSize, '\0');
-    for (auto index(NodeId::kSize - 1); index >= 0; --index)
-      average_str[NodeId::kSize - 1 - index] = average.GetByte(index);
-    network_distance_data_.average_distance = NodeId(average_str);
+    network_distance_data_.average_distance =
+        (network_distance_data_.total_distance / ++network_distance_data_.contributors_count)
+            .ToNodeId();
   }
 }
 
@@ -78,14 +74,36 @@ bool NetworkStatistics::EstimateInGroup(const NodeId& sender_id, const NodeId& i
     std::lock_guard<std::mutex> lock(mutex_);
     local_distance = distance_;
   }
-  return crypto::BigInt(
-             ((info_id ^ sender_id).ToStringEncoded(NodeId::EncodingType::kHex) + 'h').c_str()) <=
-         crypto::BigInt(
-             (local_distance.ToStringEncoded(NodeId::EncodingType::kHex) + 'h').c_str()) *
-             Parameters::accepted_distance_tolerance;
+  return XorDistance(info_id, sender_id) <=
+         XorDistance(local_distance) * Parameters::accepted_distance_tolerance;
 }
 
-NodeId NetworkStatistics::GetDistance() { return distance_; }
+NodeId NetworkStatistics::GetDistance() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return distance_;
+}
+
+uint16_t NetworkStatistics::HopBudget() {
+  const NodeId kDistance(GetDistance());
+  if (!Parameters::adaptive_hops_to_live || kDistance.IsZero())
+    return Parameters::hops_to_live;
+  int leading_zero_bits(0);
+  for (const auto& byte : kDistance.string()) {
+    const unsigned char kByte(static_cast<unsigned char>(byte));
+    if (kByte != 0) {
+      for (unsigned char mask(0x80); (kByte & mask) == 0; mask >>= 1)
+        ++leading_zero_bits;
+      break;
+    }
+    leading_zero_bits += 8;
+  }
+  int log2_group_size(0);
+  while ((1 << log2_group_size) < Parameters::group_size)
+    ++log2_group_size;
+  const int kBudget(2 * (leading_zero_bits + log2_group_size));
+  return static_cast<uint16_t>(std::min<int>(
+      Parameters::hops_to_live, std::max<int>(Parameters::min_hops_to_live, kBudget)));
+}
 
 }  // namespace routing
 
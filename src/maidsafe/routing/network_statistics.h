@@ -19,12 +19,13 @@
 #ifndef MAIDSAFE_ROUTING_NETWORK_STATISTICS_H_
 #define MAIDSAFE_ROUTING_NETWORK_STATISTICS_H_
 
+#include <cstdint>
+#include <mutex>
 #include <vector>
 
-#include "maidsafe/common/crypto.h"
-
 #include "maidsafe/common/node_id.h"
 #include "maidsafe/routing/node_info.h"
+#include "maidsafe/routing/xor_distance.h"
 
 namespace maidsafe {
 
@@ -33,6 +34,7 @@ namespace routing {
 namespace test {
 class NetworkStatisticsTest_BEH_AverageDistance_Test;
 class NetworkStatisticsTest_BEH_IsIdInGroupRange_Test;
+class NetworkStatisticsTest_BEH_HopBudget_Test;
 }
 
 class NetworkStatistics {
@@ -42,16 +44,24 @@ class NetworkStatistics {
   void UpdateNetworkAverageDistance(const NodeId& distance);
   bool EstimateInGroup(const NodeId& sender_id, const NodeId& info_id);
   NodeId GetDistance();
+  // The hops_to_live to give messages this node originates.  Nodes being spread evenly, the
+  // group_size'th closest is about group_size / N of the ID space away in a network of N, which
+  // gives log2(N); greedy routing needs about that many hops, so twice it is allowed.  Clamped as
+  // described at Parameters::adaptive_hops_to_live, and Parameters::hops_to_live until the group's
+  // distance is known.
+  uint16_t HopBudget();
 
   friend class test::NetworkStatisticsTest_BEH_AverageDistance_Test;
   friend class test::NetworkStatisticsTest_BEH_IsIdInGroupRange_Test;
+  friend class test::NetworkStatisticsTest_BEH_HopBudget_Test;
 
  private:
   NetworkStatistics(const NetworkStatistics&);
   NetworkStatistics& operator=(const NetworkStatistics&);
   struct NetworkDistanceData {
     NetworkDistanceData() : contributors_count(), total_distance(), average_distance() {}
-    crypto::BigInt contributors_count, total_distance;
+    uint32_t contributors_count;
+    XorDistance total_distance;
     NodeId average_distance;
   };
   std::mutex mutex_;
@@ -0,0 +1,82 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/network_status_filter.h"
+
+#include <cstdlib>
+
+namespace maidsafe {
+
+namespace routing {
+
+NetworkStatusFilter::NetworkStatusFilter(int hysteresis, Clock::duration min_interval)
+    : mutex_(),
+      kHysteresis_(hysteresis),
+      kMinInterval_(min_interval),
+      reported_any_(false),
+      last_reported_(0),
+      last_report_time_(),
+      has_held_(false),
+      held_(0) {}
+
+NetworkStatusFilter::Verdict NetworkStatusFilter::Offer(int network_status, Clock::time_point now,
+                                                        Clock::duration& retry_after) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!Meaningful(network_status)) {
+    // The application already has a value close to this one, so a held update is stale.
+    has_held_ = false;
+    return Verdict::kDrop;
+  }
+  if (network_status < 0 || !reported_any_ || now - last_report_time_ >= kMinInterval_) {
+    Reported(network_status, now);
+    return Verdict::kReport;
+  }
+  has_held_ = true;
+  held_ = network_status;
+  retry_after = last_report_time_ + kMinInterval_ - now;
+  return Verdict::kHold;
+}
+
+bool NetworkStatusFilter::TakeHeld(Clock::time_point now, int& network_status) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!has_held_ || now - last_report_time_ < kMinInterval_)
+    return false;
+  network_status = held_;
+  Reported(held_, now);
+  return true;
+}
+
+bool NetworkStatusFilter::Meaningful(int network_status) const {
+  if (kHysteresis_ <= 0 || !reported_any_ || network_status < 0 || last_reported_ < 0)
+    return true;
+  if (network_status == last_reported_)
+    return false;
+  return network_status == 0 || network_status == 100 ||
+         std::abs(network_status - last_reported_) >= kHysteresis_;
+}
+
+void NetworkStatusFilter::Reported(int network_status, Clock::time_point now) {
+  reported_any_ = true;
+  last_reported_ = network_status;
+  last_report_time_ = now;
+  has_held_ = false;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
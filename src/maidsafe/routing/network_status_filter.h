@@ -0,0 +1,65 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_NETWORK_STATUS_FILTER_H_
+#define MAIDSAFE_ROUTING_NETWORK_STATUS_FILTER_H_
+
+#include <chrono>
+#include <mutex>
+
+namespace maidsafe {
+
+namespace routing {
+
+// Decides which network status updates are passed on to Functors::network_status, so that churn
+// doesn't cost the application a callback per routing table change.  An update within hysteresis
+// of the last one reported is dropped, unless it's an error code or reaches 0 or 100.  Of the
+// rest, at most one is reported per min_interval; one arriving sooner is held until the interval
+// has passed, and is replaced by any update arriving meanwhile.  Error codes are never held.
+class NetworkStatusFilter {
+ public:
+  typedef std::chrono::steady_clock Clock;
+  enum class Verdict { kReport, kHold, kDrop };
+
+  NetworkStatusFilter(int hysteresis, Clock::duration min_interval);
+  // For kHold, retry_after is set to how long from now TakeHeld will report the update.
+  Verdict Offer(int network_status, Clock::time_point now, Clock::duration& retry_after);
+  // Returns true, setting network_status, if an update is held and due to be reported by now.
+  bool TakeHeld(Clock::time_point now, int& network_status);
+
+ private:
+  NetworkStatusFilter(const NetworkStatusFilter&);
+  NetworkStatusFilter& operator=(const NetworkStatusFilter&);
+  bool Meaningful(int network_status) const;
+  void Reported(int network_status, Clock::time_point now);
+
+  std::mutex mutex_;
+  const int kHysteresis_;
+  const Clock::duration kMinInterval_;
+  bool reported_any_;
+  int last_reported_;
+  Clock::time_point last_report_time_;
+  bool has_held_;
+  int held_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_NETWORK_STATUS_FILTER_H_
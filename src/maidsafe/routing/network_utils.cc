@@ -18,6 +18,11 @@
 
 #include "maidsafe/routing/network_utils.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <utility>
+
 #include "boost/date_time/posix_time/posix_time_config.hpp"
 
 #include "maidsafe/common/log.h"
@@ -26,9 +31,15 @@
 
 #include "maidsafe/routing/bootstrap_file_handler.h"
 #include "maidsafe/routing/client_routing_table.h"
+#include "maidsafe/routing/message_capture.h"
+#include "maidsafe/routing/message_latency.h"
+#include "maidsafe/routing/message_trace.h"
+#include "maidsafe/routing/metrics.h"
 #include "maidsafe/routing/parameters.h"
 #include "maidsafe/routing/return_codes.h"
+#include "maidsafe/routing/route_history.h"
 #include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/routing_log.h"
 #include "maidsafe/routing/routing_table.h"
 #include "maidsafe/routing/utils.h"
 
@@ -46,22 +57,89 @@ typedef boost::unique_lock<boost::shared_mutex> UniqueLock;
 
 namespace routing {
 
-NetworkUtils::NetworkUtils(RoutingTable& routing_table, ClientRoutingTable& client_routing_table)
+SendBatch::SendBatch() : sends_() {}
+
+SendBatch::SendBatch(SendBatch&& other) : sends_(std::move(other.sends_)) {}
+
+void SendBatch::Add(const protobuf::Message& message, const NodeId& peer_connection_id) {
+  Queue(message, peer_connection_id, std::string(),
+        std::make_shared<const std::string>(message.SerializeAsString()));
+}
+
+void SendBatch::Add(const protobuf::Message& message, const std::vector<NodeInfo>& peers) {
+  if (peers.empty())
+    return;
+  auto serialised(std::make_shared<const std::string>(message.SerializeAsString()));
+  for (const auto& peer : peers)
+    Queue(message, peer.connection_id, peer.node_id.string(), serialised);
+}
+
+void SendBatch::Queue(const protobuf::Message& message, const NodeId& peer_connection_id,
+                      std::string destination_id, std::shared_ptr<const std::string> serialised) {
+  QueuedSend queued_send;
+  queued_send.peer_connection_id = peer_connection_id;
+  queued_send.destination_id.swap(destination_id);
+  queued_send.serialised = std::move(serialised);
+  if (message.has_trace_id())
+    queued_send.traced_message = std::make_shared<const protobuf::Message>(message);
+  queued_send.type = message.type();
+  queued_send.priority = MessagePriority(message);
+  sends_.push_back(std::move(queued_send));
+}
+
+NetworkUtils::NetworkUtils(RoutingTable& routing_table, ClientRoutingTable& client_routing_table,
+                           AsioService& asio_service, const InstanceParameters& parameters)
     : running_(true),
       running_mutex_(),
       bootstrap_attempt_(0),
       bootstrap_endpoints_(),
+      bootstrap_cache_(std::make_shared<BootstrapCache>(asio_service)),
       bootstrap_connection_id_(),
       this_node_relay_connection_id_(),
       routing_table_(routing_table),
       client_routing_table_(client_routing_table),
       nat_type_(rudp::NatType::kUnknown),
       new_bootstrap_endpoint_(),
-      rudp_() {}
+      metrics_(nullptr),
+      message_capture_(nullptr),
+      asio_service_(asio_service),
+      kSendRetryInterval_(parameters.send_retry_interval),
+      kMaxSendRetriesInFlight_(parameters.max_send_retries_in_flight),
+      retry_timers_(),
+      retries_in_flight_(),
+      stream_routes_(1024),
+      relay_links_(parameters.default_response_timeout),
+      shortcuts_(routing_table.client_mode() ? 0 : parameters.max_shortcuts,
+                 parameters.shortcut_threshold, parameters.shortcut_idle_timeout),
+      kBundleDelay_(parameters.message_bundle_delay),
+      bundler_(Parameters::max_bundled_message_size, Parameters::max_message_bundle_size),
+      bundle_timer_(asio_service.service()),
+      scheduler_(parameters.max_sends_in_flight_per_peer == 0
+                     ? nullptr
+                     : new SendScheduler(parameters.max_sends_in_flight_per_peer,
+                                         [this](const NodeId & peer_id,
+                                                const std::string & serialised,
+                                                const rudp::MessageSentFunctor & functor) {
+                         DispatchSerialised(peer_id, serialised, functor);
+                       })),
+      rudp_(),
+      handler_guard_() {}
 
 NetworkUtils::~NetworkUtils() {
-  std::lock_guard<std::mutex> lock(running_mutex_);
-  running_ = false;
+  {
+    std::lock_guard<std::mutex> lock(running_mutex_);
+    running_ = false;
+    for (const auto& timer : retry_timers_)
+      timer->cancel();
+    retry_timers_.clear();
+    bundle_timer_.cancel();
+  }
+  // Whatever was still held for bundling will never be sent.  Outside the lock, as the functors
+  // may call back in.
+  for (const auto& send : bundler_.TakeAll()) {
+    if (send.message_sent_functor)
+      send.message_sent_functor(rudp::kSendFailure);
+  }
 }
 
 int NetworkUtils::Bootstrap(const std::vector<Endpoint>& bootstrap_endpoints,
@@ -76,8 +154,6 @@ int NetworkUtils::Bootstrap(const std::vector<Endpoint>& bootstrap_endpoints,
 
   assert(connection_lost_functor && "Must provide a valid functor");
   assert(bootstrap_connection_id_.IsZero() && "bootstrap_connection_id_ must be empty");
-  auto private_key(std::make_shared<asymm::PrivateKey>(routing_table_.kPrivateKey()));
-  auto public_key(std::make_shared<asymm::PublicKey>(routing_table_.kPublicKey()));
 
   if (!bootstrap_endpoints.empty())
     bootstrap_endpoints_ = bootstrap_endpoints;
@@ -98,15 +174,34 @@ int NetworkUtils::Bootstrap(const std::vector<Endpoint>& bootstrap_endpoints,
     LOG(kInfo) << "Appending local live port endpoints: " << bootstrap_endpoints_.back();
   }
 
-  if (bootstrap_endpoints_.empty())
+  // With no endpoints given, every cached contact is tried.  The best ranked endpoints are tried
+  // one at a time so each attempt can be timed and credited to its endpoint; whatever is left goes
+  // to rudp in a single attempt.
+  std::vector<Endpoint> ranked_endpoints(bootstrap_cache_->Rank(bootstrap_endpoints_));
+  if (ranked_endpoints.empty())
     return kInvalidBootstrapContacts;
 
-  int result(rudp_.Bootstrap(/* sorted_ */ bootstrap_endpoints_, message_received_functor,
-                             connection_lost_functor, routing_table_.kConnectionId(), private_key,
-                             public_key, bootstrap_connection_id_, nat_type_, local_endpoint));
+  auto remaining(std::begin(ranked_endpoints));
+  int result(kNoOnlineBootstrapContacts);
+  while (remaining != std::end(ranked_endpoints) &&
+         static_cast<uint16_t>(remaining - std::begin(ranked_endpoints)) <
+             Parameters::max_ranked_bootstrap_attempts) {
+    const auto kStart(std::chrono::steady_clock::now());
+    result = RudpBootstrap(std::vector<Endpoint>(1, *remaining), message_received_functor,
+                           connection_lost_functor, local_endpoint);
+    if (result == kSuccess) {
+      bootstrap_cache_->RecordSuccess(*remaining, std::chrono::steady_clock::now() - kStart);
+      ++remaining;
+      break;
+    }
+    bootstrap_cache_->RecordFailure(*remaining++);
+  }
+  if (result != kSuccess && remaining != std::end(ranked_endpoints)) {
+    result = RudpBootstrap(std::vector<Endpoint>(remaining, std::end(ranked_endpoints)),
+                           message_received_functor, connection_lost_functor, local_endpoint);
+  }
   ++bootstrap_attempt_;
-  // RUDP will return a kZeroId for zero state !!
-  if (result != kSuccess || bootstrap_connection_id_.IsZero()) {
+  if (result != kSuccess) {
     LOG(kError) << "No Online Bootstrap Node found.";
     return kNoOnlineBootstrapContacts;
   }
@@ -117,6 +212,22 @@ int NetworkUtils::Bootstrap(const std::vector<Endpoint>& bootstrap_endpoints,
   return kSuccess;
 }
 
+int NetworkUtils::RudpBootstrap(const std::vector<Endpoint>& bootstrap_endpoints,
+                                const rudp::MessageReceivedFunctor& message_received_functor,
+                                const rudp::ConnectionLostFunctor& connection_lost_functor,
+                                Endpoint local_endpoint) {
+  auto private_key(std::make_shared<asymm::PrivateKey>(routing_table_.kPrivateKey()));
+  auto public_key(std::make_shared<asymm::PublicKey>(routing_table_.kPublicKey()));
+  bootstrap_connection_id_ = NodeId();
+  int result(rudp_.Bootstrap(bootstrap_endpoints, message_received_functor,
+                             connection_lost_functor, routing_table_.kConnectionId(), private_key,
+                             public_key, bootstrap_connection_id_, nat_type_, local_endpoint));
+  // RUDP will return a kZeroId for zero state !!
+  if (result != kSuccess || bootstrap_connection_id_.IsZero())
+    return kNoOnlineBootstrapContacts;
+  return kSuccess;
+}
+
 int NetworkUtils::GetAvailableEndpoint(const NodeId& peer_id,
                                        const rudp::EndpointPair& peer_endpoint_pair,
                                        rudp::EndpointPair& this_endpoint_pair,
@@ -163,20 +274,154 @@ void NetworkUtils::Remove(const NodeId& peer_id) {
       return;
   }
   rudp_.Remove(peer_id);
+  if (scheduler_)
+    scheduler_->Remove(peer_id);
 }
 
 void NetworkUtils::RudpSend(const NodeId& peer_id, const protobuf::Message& message,
-                            const rudp::MessageSentFunctor& message_sent_functor) {
+                            const rudp::MessageSentFunctor& message_sent_functor,
+                            std::shared_ptr<const std::string> encoded_body,
+                            const std::string& destination_id) {
+  {
+    std::lock_guard<std::mutex> lock(running_mutex_);
+    if (!running_)
+      return;
+  }
+  MessageLatency::Mark(MessageStage::kSent);
+  MessageTrace::RecordSent(message, routing_table_.kNodeId(), peer_id);
+  if (metrics_)
+    metrics_->MessageOut(message.type());
+  if (encoded_body || !destination_id.empty()) {
+    // Concatenated serialised fields parse as a single message, and for a repeated singular field
+    // the last one wins.
+    std::string serialised;
+    serialised.reserve(message.ByteSize() + (encoded_body ? encoded_body->size() : 0) +
+                       destination_id.size() + 4);
+    message.AppendToString(&serialised);
+    if (!destination_id.empty()) {
+      protobuf::Message destination;
+      destination.set_destination_id(destination_id);
+      destination.AppendPartialToString(&serialised);
+    }
+    if (encoded_body)
+      serialised.append(*encoded_body);
+    RudpSendSerialised(peer_id, serialised, message_sent_functor, MessagePriority(message));
+  } else {
+    RudpSendSerialised(peer_id, message.SerializeAsString(), message_sent_functor,
+                       MessagePriority(message));
+  }
+  ROUTING_LOG(kVerbose) << "  [" << DebugId(routing_table_.kNodeId())
+                        << "] send : " << MessageTypeString(message) << " to   " << DebugId(peer_id)
+                        << "   (id: " << message.id() << ")"
+                        << " --To Rudp--";
+}
+
+void NetworkUtils::RudpSendSerialised(const NodeId& peer_id, const std::string& serialised,
+                                      const rudp::MessageSentFunctor& message_sent_functor,
+                                      SendPriority priority) {
+  if (message_capture_)
+    message_capture_->Record(CaptureDirection::kSent, peer_id, serialised);
+  if (scheduler_)
+    scheduler_->Send(peer_id, priority, serialised, message_sent_functor);
+  else
+    DispatchSerialised(peer_id, serialised, message_sent_functor);
+}
+
+void NetworkUtils::DispatchSerialised(const NodeId& peer_id, const std::string& serialised,
+                                      const rudp::MessageSentFunctor& message_sent_functor) {
+  if (kBundleDelay_ == std::chrono::microseconds::zero()) {
+    rudp_.Send(peer_id, serialised, message_sent_functor);
+    return;
+  }
+  std::vector<MessageBundler::Send> ready;
+  if (bundler_.Add(peer_id, serialised, message_sent_functor, ready)) {
+    std::lock_guard<std::mutex> lock(running_mutex_);
+    if (running_) {
+      bundle_timer_.expires_from_now(kBundleDelay_);
+      bundle_timer_.async_wait(handler_guard_.Wrap([this](const boost::system::error_code& error) {
+        if (error != boost::asio::error::operation_aborted)
+          FlushBundles();
+      }));
+    }
+  }
+  for (const auto& send : ready)
+    rudp_.Send(send.peer_id, send.serialised, send.message_sent_functor);
+}
+
+void NetworkUtils::FlushBundles() {
+  {
+    std::lock_guard<std::mutex> lock(running_mutex_);
+    if (!running_)
+      return;
+  }
+  for (const auto& send : bundler_.TakeAll())
+    rudp_.Send(send.peer_id, send.serialised, send.message_sent_functor);
+}
+
+void NetworkUtils::Send(SendBatch batch, BatchSentFunctor batch_sent_functor) {
   {
     std::lock_guard<std::mutex> lock(running_mutex_);
     if (!running_)
       return;
   }
-  rudp_.Send(peer_id, message.SerializeAsString(), message_sent_functor);
-  LOG(kVerbose) << "  [" << DebugId(routing_table_.kNodeId())
-                << "] send : " << MessageTypeString(message) << " to   " << DebugId(peer_id)
-                << "   (id: " << message.id() << ")"
-                << " --To Rudp--";
+  if (batch.empty()) {
+    if (batch_sent_functor)
+      batch_sent_functor(0);
+    return;
+  }
+  // All of the batch's sends share one record of progress, rather than each capturing its own
+  // copies of what is logged.
+  struct Progress {
+    Progress(size_t count_in, BatchSentFunctor functor_in, std::string this_id_in)
+        : count(count_in),
+          outstanding(count_in),
+          failed(0),
+          functor(std::move(functor_in)),
+          this_id(std::move(this_id_in)) {}
+    const size_t count;
+    std::atomic<size_t> outstanding, failed;
+    const BatchSentFunctor functor;
+    const std::string this_id;
+  };
+  auto progress(std::make_shared<Progress>(batch.size(), std::move(batch_sent_functor),
+                                           routing_table_.kNodeId().string()));
+  rudp::MessageSentFunctor message_sent_functor([progress](int message_sent) {
+    if (rudp::kSuccess != message_sent)
+      ++progress->failed;
+    if (--progress->outstanding != 0)
+      return;
+    if (progress->failed != 0) {
+      LOG(kError) << progress->failed << " of " << progress->count << " batched sends from "
+                  << HexSubstr(progress->this_id) << " failed";
+    }
+    if (progress->functor)
+      progress->functor(progress->failed);
+  });
+
+  MessageLatency::Mark(MessageStage::kSent);
+  for (const auto& queued_send : batch.sends_) {
+    if (queued_send.traced_message) {
+      MessageTrace::RecordSent(*queued_send.traced_message, routing_table_.kNodeId(),
+                               queued_send.peer_connection_id);
+    }
+    if (metrics_)
+      metrics_->MessageOut(queued_send.type);
+    if (queued_send.destination_id.empty()) {
+      RudpSendSerialised(queued_send.peer_connection_id, *queued_send.serialised,
+                         message_sent_functor, queued_send.priority);
+    } else {
+      std::string serialised;
+      serialised.reserve(queued_send.serialised->size() + queued_send.destination_id.size() + 4);
+      serialised.append(*queued_send.serialised);
+      protobuf::Message destination;
+      destination.set_destination_id(queued_send.destination_id);
+      destination.AppendPartialToString(&serialised);
+      RudpSendSerialised(queued_send.peer_connection_id, serialised, message_sent_functor,
+                         queued_send.priority);
+    }
+  }
+  ROUTING_LOG(kVerbose) << "  [" << DebugId(routing_table_.kNodeId()) << "] sent batch of "
+                        << batch.size() << " --To Rudp--";
 }
 
 void NetworkUtils::SendToDirect(const protobuf::Message& message, const NodeId& peer_connection_id,
@@ -195,7 +440,66 @@ void NetworkUtils::SendToDirectAdjustedRoute(protobuf::Message& message, const N
   SendTo(message, peer_node_id, peer_connection_id);
 }
 
+void NetworkUtils::SendEncodedToDirect(const protobuf::Message& header,
+                                       std::shared_ptr<const std::string> encoded_body,
+                                       const NodeId& peer_node_id,
+                                       const NodeId& peer_connection_id) {
+  assert(encoded_body);
+  SendTo(header, peer_node_id, peer_connection_id, std::move(encoded_body));
+}
+
 void NetworkUtils::SendToClosestNode(const protobuf::Message& message) {
+  DoSendToClosestNode(message, nullptr);
+}
+
+void NetworkUtils::SendAlongDisjointPaths(const protobuf::Message& message,
+                                          uint16_t path_count) {
+  const NodeId kDestinationId(message.destination_id());
+  // Route history must keep room for the other first hops and this node.
+  path_count = std::min(path_count, Parameters::max_route_history);
+  std::vector<NodeId> first_hops;
+  RouteHistory exclude;
+  if (routing_table_.size() > 0 && client_routing_table_.GetNodesInfo(kDestinationId).empty()) {
+    while (first_hops.size() < path_count) {
+      NodeInfo peer(routing_table_.GetNodeForSendingMessage(kDestinationId, exclude));
+      if (peer.node_id.IsZero())
+        break;
+      // A direct connection to the destination leaves nothing to gain from other paths.
+      if (peer.node_id == kDestinationId) {
+        first_hops.clear();
+        break;
+      }
+      first_hops.push_back(peer.node_id);
+      exclude.Add(peer.node_id);
+    }
+  }
+  if (first_hops.size() < 2)
+    return SendToClosestNode(message);
+
+  ROUTING_LOG(kVerbose) << "Sending " << MessageTypeString(message) << " along "
+                        << first_hops.size() << " paths to " << DebugId(kDestinationId) << " id: "
+                        << message.id();
+  for (const auto& first_hop : first_hops) {
+    auto copy(std::make_shared<protobuf::Message>(message));
+    copy->clear_route_history();
+    for (const auto& other_hop : first_hops) {
+      if (other_hop != first_hop)
+        copy->add_route_history(RouteHistory::Prefix(other_hop));
+    }
+    // RecursiveSendOn doesn't exclude the last entry, so this node's ID goes there.
+    copy->add_route_history(RouteHistory::Prefix(routing_table_.kNodeId()));
+    RecursiveSendOn(copy, NodeInfo(), 0, nullptr);
+  }
+}
+
+void NetworkUtils::SendEncodedToClosestNode(const protobuf::Message& header,
+                                            std::shared_ptr<const std::string> encoded_body) {
+  assert(encoded_body);
+  DoSendToClosestNode(header, std::move(encoded_body));
+}
+
+void NetworkUtils::DoSendToClosestNode(const protobuf::Message& message,
+                                       std::shared_ptr<const std::string> encoded_body) {
   // Normal messages
   if (message.has_destination_id() && !message.destination_id().empty()) {
     auto client_routing_nodes(client_routing_table_.GetNodesInfo(NodeId(message.destination_id())));
@@ -207,18 +511,19 @@ void NetworkUtils::SendToClosestNode(const protobuf::Message& message) {
                       << PrintMessage(message);
         return;
       }
-      LOG(kVerbose) << "This node [" << DebugId(routing_table_.kNodeId()) << "] has "
-                    << client_routing_nodes.size()
-                    << " destination node(s) in its non-routing table."
-                    << " id: " << message.id();
+      ROUTING_LOG(kVerbose) << "This node [" << DebugId(routing_table_.kNodeId()) << "] has "
+                            << client_routing_nodes.size()
+                            << " destination node(s) in its non-routing table."
+                            << " id: " << message.id();
 
       for (const auto& i : client_routing_nodes) {
-        LOG(kVerbose) << "Sending message to NRT node with ID " << message.id() << " node_id "
-                      << DebugId(i.node_id) << " connection id " << DebugId(i.connection_id);
-        SendTo(message, i.node_id, i.connection_id);
+        ROUTING_LOG(kVerbose) << "Sending message to NRT node with ID " << message.id()
+                              << " node_id " << DebugId(i.node_id) << " connection id "
+                              << DebugId(i.connection_id);
+        SendTo(message, i.node_id, i.connection_id, encoded_body);
       }
     } else if (routing_table_.size() > 0) {  // getting closer nodes from routing table
-      RecursiveSendOn(message);
+      RecursiveSendOn(std::make_shared<protobuf::Message>(message), NodeInfo(), 0, encoded_body);
     } else {
       LOG(kError) << " No endpoint to send to; aborting send.  Attempt to send a type "
                   << MessageTypeString(message) << " message to " << HexSubstr(message.source_id())
@@ -227,12 +532,12 @@ void NetworkUtils::SendToClosestNode(const protobuf::Message& message) {
     return;
   }
 
-  // Relay message responses only
+  // Relay message responses only.  The relay connection id is the client's rudp connection, so
+  // the message goes straight back on it with no table lookup.
   if (message.has_relay_id() /*&& (IsResponse(message))*/) {
-    protobuf::Message relay_message(message);
-    relay_message.set_destination_id(message.relay_id());  // so that peer identifies it as direct
-    SendTo(relay_message, NodeId(relay_message.relay_id()),
-           NodeId(relay_message.relay_connection_id()));
+    // relay_id as destination so that peer identifies it as direct
+    SendTo(message, NodeId(message.relay_id()), NodeId(message.relay_connection_id()), encoded_body,
+           message.relay_id());
   } else {
     LOG(kError) << "Unable to work out destination; aborting send."
                 << " id: " << message.id() << " message.has_relay_id() ; " << std::boolalpha
@@ -243,24 +548,34 @@ void NetworkUtils::SendToClosestNode(const protobuf::Message& message) {
 }
 
 void NetworkUtils::SendTo(const protobuf::Message& message, const NodeId& peer_node_id,
-                          const NodeId& peer_connection_id) {
+                          const NodeId& peer_connection_id,
+                          std::shared_ptr<const std::string> encoded_body,
+                          const std::string& destination_id) {
   const std::string kThisId(routing_table_.kNodeId().string());
+  // Capture only what is logged, not a copy of the whole message, and format it only if logged.
+  const int32_t kMessageType(message.type()), kMessageId(message.id());
+  const bool kRequest(message.request());
   rudp::MessageSentFunctor message_sent_functor = [=](int message_sent) {
     if (rudp::kSuccess == message_sent) {
-      LOG(kVerbose) << "  [" << HexSubstr(kThisId) << "] sent : " << MessageTypeString(message)
-                    << " to   " << DebugId(peer_node_id) << "   (id: " << message.id() << ")";
+      ROUTING_LOG(kVerbose) << "  [" << HexSubstr(kThisId)
+                            << "] sent : " << MessageTypeString(kMessageType, kRequest) << " to   "
+                            << DebugId(peer_node_id) << "   (id: " << kMessageId << ")";
     } else {
-      LOG(kError) << "Sending type " << MessageTypeString(message) << " message from "
-                  << HexSubstr(kThisId) << " to " << DebugId(peer_node_id) << " failed with code "
-                  << message_sent << " id: " << message.id();
+      LOG(kError) << "Sending type " << MessageTypeString(kMessageType, kRequest)
+                  << " message from " << HexSubstr(kThisId)
+                  << " to " << DebugId(peer_node_id) << " failed with code " << message_sent
+                  << " id: " << kMessageId;
     }
   };
-  LOG(kVerbose) << " >>>>>>>>> rudp send message to connection id " << DebugId(peer_connection_id);
-  RudpSend(peer_connection_id, message, message_sent_functor);
+  ROUTING_LOG(kVerbose) << " >>>>>>>>> rudp send message to connection id "
+                        << DebugId(peer_connection_id);
+  RudpSend(peer_connection_id, message, message_sent_functor, encoded_body, destination_id);
 }
 
-void NetworkUtils::RecursiveSendOn(protobuf::Message message, NodeInfo last_node_attempted,
-                                   int attempt_count) {
+void NetworkUtils::RecursiveSendOn(std::shared_ptr<protobuf::Message> message,
+                                   NodeInfo last_node_attempted, int attempt_count,
+                                   std::shared_ptr<const std::string> encoded_body,
+                                   const NodeId& avoid) {
   {
     std::lock_guard<std::mutex> lock(running_mutex_);
     if (!running_)
@@ -270,7 +585,9 @@ void NetworkUtils::RecursiveSendOn(protobuf::Message message, NodeInfo last_node
     LOG(kWarning) << " Retry attempts failed to send to ["
                   << HexSubstr(last_node_attempted.node_id.string())
                   << "] will drop this node now and try with another node."
-                  << " id: " << message.id();
+                  << " id: " << message->id();
+    if (metrics_)
+      metrics_->SendFailed();
     attempt_count = 0;
     {
       std::lock_guard<std::mutex> lock(running_mutex_);
@@ -281,40 +598,54 @@ void NetworkUtils::RecursiveSendOn(protobuf::Message message, NodeInfo last_node
       // FIXME Should we remove this node or let rudp handle that?
       routing_table_.DropNode(last_node_attempted.connection_id, false);
       client_routing_table_.DropConnection(last_node_attempted.connection_id);
+      shortcuts_.Drop(last_node_attempted.connection_id);
     }
   }
 
-  if (attempt_count > 0)
-    Sleep(std::chrono::milliseconds(50));
-
   const std::string kThisId(routing_table_.kNodeId().string());
-  bool ignore_exact_match(!IsDirect(message));
-  std::vector<std::string> route_history;
+  bool ignore_exact_match(!IsDirect(*message));
   NodeInfo peer;
   {
     std::lock_guard<std::mutex> lock(running_mutex_);
     if (!running_)
       return;
-    if (message.route_history().size() > 1)
-      route_history = std::vector<std::string>(
-          message.route_history().begin(),
-          message.route_history().end() -
-              static_cast<size_t>(!(message.has_visited() && message.visited())));
-    else if ((message.route_history().size() == 1) &&
-             (message.route_history(0) != routing_table_.kNodeId().string()))
-      route_history.push_back(message.route_history(0));
-
-    peer = routing_table_.GetNodeForSendingMessage(NodeId(message.destination_id()), route_history,
-                                                   ignore_exact_match);
-    if (peer.node_id == NodeId() && routing_table_.size() != 0) {
-      peer = routing_table_.GetNodeForSendingMessage(
-          NodeId(message.destination_id()), std::vector<std::string>(), ignore_exact_match);
+    RouteHistory route_history(*message, routing_table_.kNodeId(),
+                               message->has_visited() && message->visited());
+    if (avoid != NodeId())
+      route_history.Add(avoid);
+    // A stream's later frames follow its first while that next hop stays connected.
+    NodeId stream_next_hop;
+    if (!message->has_stream_id() || attempt_count != 0 || avoid != NodeId() ||
+        !stream_routes_.Get(*message, stream_next_hop) ||
+        !routing_table_.GetNodeInfo(stream_next_hop, peer)) {
+      peer = routing_table_.GetNodeForSendingMessage(NodeId(message->destination_id()),
+                                                     route_history, ignore_exact_match);
+      // Falling back to the avoided peer would only queue the message behind its retries again.
+      if (peer.node_id == NodeId() && routing_table_.size() != 0 && avoid == NodeId()) {
+        peer = routing_table_.GetNodeForSendingMessage(
+            NodeId(message->destination_id()), RouteHistory(), ignore_exact_match);
+      }
+    }
+    if (peer.node_id == NodeId() && avoid != NodeId()) {
+      LOG(kWarning) << "No peer other than " << DebugId(avoid)
+                    << " to send on to; dropping the message.  id: " << message->id();
+      if (metrics_)
+        metrics_->SendFailed();
+      return;
     }
     if (peer.node_id == NodeId()) {
       LOG(kError) << "This node's routing table is empty now.  Need to re-bootstrap.";
       return;
     }
-    AdjustRouteHistory(message);
+    // Retries take the routing table's choice, in case it was the shortcut which failed, as do
+    // sends avoiding a busy peer, which may be the shortcut.  Nor is a shortcut taken back to a
+    // node the message has been through.
+    if (attempt_count == 0 && avoid == NodeId())
+      shortcuts_.NextHop(NodeId(message->destination_id()), route_history, ignore_exact_match,
+                         peer);
+    if (message->has_stream_id())
+      stream_routes_.Set(*message, peer.node_id);
+    AdjustRouteHistory(*message);
   }
 
   rudp::MessageSentFunctor message_sent_functor = [=](int message_sent) {
@@ -324,24 +655,24 @@ void NetworkUtils::RecursiveSendOn(protobuf::Message message, NodeInfo last_node
         return;
     }
     if (rudp::kSuccess == message_sent) {
-      LOG(kVerbose) << "  [" << HexSubstr(kThisId) << "] sent : " << MessageTypeString(message)
-                    << " to   " << HexSubstr(peer.node_id.string()) << "   (id: " << message.id()
-                    << ")"
-                    << " dst : " << HexSubstr(message.destination_id());
+      ROUTING_LOG(kVerbose) << "  [" << HexSubstr(kThisId) << "] sent : "
+                            << MessageTypeString(*message) << " to   "
+                            << HexSubstr(peer.node_id.string()) << "   (id: " << message->id()
+                            << ")" << " dst : " << HexSubstr(message->destination_id());
     } else if (rudp::kSendFailure == message_sent) {
-      LOG(kError) << "Sending type " << MessageTypeString(message) << " message from "
+      LOG(kError) << "Sending type " << MessageTypeString(*message) << " message from "
                   << HexSubstr(routing_table_.kNodeId().string()) << " to "
                   << HexSubstr(peer.node_id.string()) << " with destination ID "
-                  << HexSubstr(message.destination_id()) << " failed with code " << message_sent
+                  << HexSubstr(message->destination_id()) << " failed with code " << message_sent
                   << ".  Will retry to Send.  Attempt count = " << attempt_count + 1
-                  << " id: " << message.id();
-      RecursiveSendOn(message, peer, attempt_count + 1);
+                  << " id: " << message->id();
+      ScheduleSendRetry(message, peer, attempt_count + 1, encoded_body);
     } else {
-      LOG(kError) << "Sending type " << MessageTypeString(message) << " message from "
+      LOG(kError) << "Sending type " << MessageTypeString(*message) << " message from "
                   << HexSubstr(kThisId) << " to " << HexSubstr(peer.node_id.string())
-                  << " with destination ID " << HexSubstr(message.destination_id())
+                  << " with destination ID " << HexSubstr(message->destination_id())
                   << " failed with code " << message_sent << "  Will remove node."
-                  << " message id: " << message.id();
+                  << " message id: " << message->id();
       {
         std::lock_guard<std::mutex> lock(running_mutex_);
         if (!running_)
@@ -351,29 +682,80 @@ void NetworkUtils::RecursiveSendOn(protobuf::Message message, NodeInfo last_node
       LOG(kWarning) << " Routing-> removing connection " << DebugId(peer.connection_id);
       routing_table_.DropNode(peer.node_id, false);
       client_routing_table_.DropConnection(peer.connection_id);
-      RecursiveSendOn(message);
+      shortcuts_.Drop(peer.connection_id);
+      RecursiveSendOn(message, NodeInfo(), 0, encoded_body);
     }
   };
-  LOG(kVerbose) << "Rudp recursive send message to " << DebugId(peer.connection_id);
-  RudpSend(peer.connection_id, message, message_sent_functor);
+  ROUTING_LOG(kVerbose) << "Rudp recursive send message to " << DebugId(peer.connection_id);
+  RudpSend(peer.connection_id, *message, message_sent_functor, encoded_body);
 }
 
-void NetworkUtils::AdjustRouteHistory(protobuf::Message& message) {
-  assert(message.route_history().size() <= Parameters::max_routing_table_size);
-  if (std::find(message.route_history().begin(), message.route_history().end(),
-                routing_table_.kNodeId().string()) == message.route_history().end()) {
-    message.add_route_history(routing_table_.kNodeId().string());
-    if (message.route_history().size() > Parameters::max_route_history) {
-      std::vector<std::string> route_history(message.route_history().begin() + 1,
-                                             message.route_history().end());
-      message.clear_route_history();
-      for (const auto& route : route_history) {
-        if (!NodeId(route).IsZero())
-          message.add_route_history(route);
-      }
+void NetworkUtils::ScheduleSendRetry(std::shared_ptr<protobuf::Message> message,
+                                     const NodeInfo& peer, int attempt_count,
+                                     std::shared_ptr<const std::string> encoded_body) {
+  if (metrics_)
+    metrics_->SendRetried();
+  std::shared_ptr<boost::asio::steady_timer> timer;
+  {
+    std::lock_guard<std::mutex> lock(running_mutex_);
+    if (!running_)
+      return;
+    uint16_t& in_flight(retries_in_flight_[peer.node_id]);
+    if (in_flight < kMaxSendRetriesInFlight_) {
+      ++in_flight;
+      timer = std::make_shared<boost::asio::steady_timer>(asio_service_.service());
+      retry_timers_.insert(timer);
+    }
+  }
+  if (!timer) {
+    // The peer is still connected, just busy, so it's kept and only this message goes elsewhere.
+    LOG(kWarning) << "Too many sends waiting to retry via " << DebugId(peer.node_id)
+                  << "; sending this one via another peer.  id: " << message->id();
+    RecursiveSendOn(message, NodeInfo(), 0, encoded_body, peer.node_id);
+    return;
+  }
+
+  const auto kInterval(std::max(kSendRetryInterval_.count(),
+                                static_cast<std::chrono::milliseconds::rep>(1)));
+  timer->expires_from_now(kSendRetryInterval_ * (1 << (attempt_count - 1)) +
+                          std::chrono::milliseconds(RandomUint32() % kInterval));
+  timer->async_wait(handler_guard_.Wrap([=](const boost::system::error_code& error_code) {
+    if (error_code == boost::asio::error::operation_aborted)
+      return;
+    {
+      std::lock_guard<std::mutex> lock(running_mutex_);
+      retry_timers_.erase(timer);
+      auto itr(retries_in_flight_.find(peer.node_id));
+      if (itr != retries_in_flight_.end() && --itr->second == 0)
+        retries_in_flight_.erase(itr);
+      if (!running_)
+        return;
     }
+    RecursiveSendOn(message, peer, attempt_count, encoded_body);
+  }));
+}
+
+void NetworkUtils::AdjustRouteHistory(protobuf::Message& message) {
+  const uint64_t kPrefix(RouteHistory::Prefix(routing_table_.kNodeId()));
+  if (std::find(message.route_history().begin(), message.route_history().end(), kPrefix) !=
+      message.route_history().end()) {
+    return;
   }
-  assert(message.route_history().size() <= Parameters::max_routing_table_size);
+  message.add_route_history(kPrefix);
+  const int kMaxSize(static_cast<int>(
+      std::min(static_cast<size_t>(Parameters::max_route_history), RouteHistory::kCapacity)));
+  const int kExcess(message.route_history_size() - kMaxSize);
+  if (kExcess > 0) {
+    auto route_history(message.mutable_route_history());
+    std::copy(route_history->begin() + kExcess, route_history->end(), route_history->begin());
+    route_history->Truncate(kMaxSize);
+  }
+}
+
+void NetworkUtils::AddToBootstrapFile(const Endpoint& endpoint) { bootstrap_cache_->Add(endpoint); }
+
+bool NetworkUtils::LoadBootstrapCache(const boost::filesystem::path& path) {
+  return bootstrap_cache_->Load(path);
 }
 
 void NetworkUtils::set_new_bootstrap_endpoint_functor(
@@ -381,6 +763,12 @@ void NetworkUtils::set_new_bootstrap_endpoint_functor(
   new_bootstrap_endpoint_ = new_bootstrap_endpoint;
 }
 
+void NetworkUtils::set_metrics(Metrics* metrics) { metrics_ = metrics; }
+
+void NetworkUtils::set_message_capture(MessageCaptureWriter* message_capture) {
+  message_capture_ = message_capture;
+}
+
 void NetworkUtils::clear_bootstrap_connection_info() {
   bootstrap_connection_id_ = NodeId();
   this_node_relay_connection_id_ = NodeId();
@@ -396,8 +784,14 @@ maidsafe::NodeId NetworkUtils::this_node_relay_connection_id() const {
   return this_node_relay_connection_id_;
 }
 
+RelayLinks& NetworkUtils::relay_links() { return relay_links_; }
+
+ShortcutTable& NetworkUtils::shortcuts() { return shortcuts_; }
+
 rudp::NatType NetworkUtils::nat_type() const { return nat_type_; }
 
+AsioService& NetworkUtils::asio_service() { return asio_service_; }
+
 }  // namespace routing
 
 }  // namespace maidsafe
@@ -19,17 +19,33 @@
 #ifndef MAIDSAFE_ROUTING_NETWORK_UTILS_H_
 #define MAIDSAFE_ROUTING_NETWORK_UTILS_H_
 
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <set>
 #include <string>
 #include <vector>
 
 #include "boost/asio/ip/udp.hpp"
+#include "boost/asio/steady_timer.hpp"
+#include "boost/filesystem/path.hpp"
 
+#include "maidsafe/common/asio_service.h"
 #include "maidsafe/common/node_id.h"
 #include "maidsafe/rudp/managed_connections.h"
 
 #include "maidsafe/routing/api_config.h"
+#include "maidsafe/routing/bootstrap_cache.h"
+#include "maidsafe/routing/handler_guard.h"
+#include "maidsafe/routing/message_bundler.h"
+#include "maidsafe/routing/message_stream.h"
 #include "maidsafe/routing/node_info.h"
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/relay_links.h"
+#include "maidsafe/routing/send_scheduler.h"
+#include "maidsafe/routing/shortcut_table.h"
 #include "maidsafe/routing/timer.h"
 
 namespace maidsafe {
@@ -41,6 +57,8 @@ class Message;
 }
 
 class ClientRoutingTable;
+class Metrics;
+class MessageCaptureWriter;
 class RoutingTable;
 
 namespace test {
@@ -48,9 +66,48 @@ class GenericNode;
 class MockNetworkUtils;
 }
 
+// Fired once all of a batch's messages have been handed to rudp and their results are known.
+typedef std::function<void(size_t /*failed_count*/)> BatchSentFunctor;
+
+// Messages queued to be sent together by NetworkUtils::Send.  Each message is serialised once, as
+// it's added, however many peers it is queued for.
+class SendBatch {
+ public:
+  SendBatch();
+  SendBatch(SendBatch&& other);
+  // Queues |message| to be sent on |peer_connection_id| as it is.
+  void Add(const protobuf::Message& message, const NodeId& peer_connection_id);
+  // Queues |message| for each of |peers|, each copy's destination_id overridden by the peer's ID
+  // as the serialised message is sent (see NetworkUtils::RudpSend).
+  void Add(const protobuf::Message& message, const std::vector<NodeInfo>& peers);
+  size_t size() const { return sends_.size(); }
+  bool empty() const { return sends_.empty(); }
+
+  friend class NetworkUtils;
+
+ private:
+  SendBatch(const SendBatch&);
+  SendBatch& operator=(const SendBatch&);
+
+  struct QueuedSend {
+    NodeId peer_connection_id;
+    std::string destination_id;
+    std::shared_ptr<const std::string> serialised;
+    std::shared_ptr<const protobuf::Message> traced_message;  // set only if it has a trace_id
+    int32_t type;
+    SendPriority priority;
+  };
+  void Queue(const protobuf::Message& message, const NodeId& peer_connection_id,
+             std::string destination_id, std::shared_ptr<const std::string> serialised);
+
+  std::vector<QueuedSend> sends_;
+};
+
 class NetworkUtils {
  public:
-  NetworkUtils(RoutingTable& routing_table, ClientRoutingTable& client_routing_table);
+  NetworkUtils(RoutingTable& routing_table, ClientRoutingTable& client_routing_table,
+               AsioService& asio_service,
+               const InstanceParameters& parameters = InstanceParameters());
   virtual ~NetworkUtils();
   int Bootstrap(const std::vector<boost::asio::ip::udp::endpoint>& bootstrap_endpoints,
                 const rudp::MessageReceivedFunctor& message_received_functor,
@@ -72,15 +129,47 @@ class NetworkUtils {
                             const NodeId& peer_connection_id);
   void SendToDirectAdjustedRoute(protobuf::Message& message, const NodeId& peer_node_id,
                                  const NodeId& peer_connection_id);
+  // As SendToDirect, with |encoded_body| appended to the serialised |header| (see
+  // SendEncodedToClosestNode).
+  virtual void SendEncodedToDirect(const protobuf::Message& header,
+                                   std::shared_ptr<const std::string> encoded_body,
+                                   const NodeId& peer_node_id, const NodeId& peer_connection_id);
+  // Hands all of |batch| to rudp together.  In place of a MessageSentFunctor per message,
+  // |batch_sent_functor| is fired once with the number of them rudp failed to send.  Neither is
+  // fired if this has been stopped.
+  void Send(SendBatch batch, BatchSentFunctor batch_sent_functor = nullptr);
   // Handles relay response messages.  Also leave destination ID empty if needs to send as a relay
   // response message
   virtual void SendToClosestNode(const protobuf::Message& message);
+  // Sends a copy of message via each of up to path_count peers, chosen as for SendToClosestNode but
+  // each excluding those already chosen.  Each copy carries the other copies' first hops in its
+  // route history, so they are avoided further along its path too.
+  void SendAlongDisjointPaths(const protobuf::Message& message, uint16_t path_count);
+  // As SendToClosestNode, but |encoded_body| holds already serialised fields (e.g. the data) which
+  // are appended to the serialised |header| on each send, so the body is shared rather than copied
+  // into the message.
+  virtual void SendEncodedToClosestNode(const protobuf::Message& header,
+                                        std::shared_ptr<const std::string> encoded_body);
   void AddToBootstrapFile(const boost::asio::ip::udp::endpoint& endpoint);
+  // Bootstrap contacts and how joining via each went are kept in, and ranked using, this file.
+  bool LoadBootstrapCache(const boost::filesystem::path& path);
   void clear_bootstrap_connection_info();
   void set_new_bootstrap_endpoint_functor(NewBootstrapEndpointFunctor new_bootstrap_endpoint);
+  // Messages sent, send retries and sends given up on are counted in |metrics| if it's set.
+  void set_metrics(Metrics* metrics);
+  // Each message handed to rudp is also written to |message_capture| if it's set.  Only to be set
+  // before Bootstrap.
+  void set_message_capture(MessageCaptureWriter* message_capture);
   NodeId bootstrap_connection_id() const;
   NodeId this_node_relay_connection_id() const;
+  // A client's requests in flight on each of its connections (see Parameters::client_relay_links).
+  RelayLinks& relay_links();
+  // A vault's connections to far nodes outside its routing table (see Parameters::max_shortcuts).
+  // Messages are sent on via one whenever it's closer to their destination than the next hop the
+  // routing table offers.
+  ShortcutTable& shortcuts();
   rudp::NatType nat_type() const;
+  AsioService& asio_service();
 
   friend class test::GenericNode;
   friend class test::MockNetworkUtils;
@@ -90,25 +179,74 @@ class NetworkUtils {
   NetworkUtils(const NetworkUtils&&);
   NetworkUtils& operator=(const NetworkUtils&);
 
+  int RudpBootstrap(const std::vector<boost::asio::ip::udp::endpoint>& bootstrap_endpoints,
+                    const rudp::MessageReceivedFunctor& message_received_functor,
+                    const rudp::ConnectionLostFunctor& connection_lost_functor,
+                    boost::asio::ip::udp::endpoint local_endpoint);
+
+  // Where given, |encoded_body| is appended to the serialised message (see
+  // SendEncodedToClosestNode).  A non-empty |destination_id| is appended after the message too,
+  // which overrides the message's own destination_id for the recipient without copying it.
   void RudpSend(const NodeId& peer_id, const protobuf::Message& message,
-                const rudp::MessageSentFunctor& message_sent_functor);
+                const rudp::MessageSentFunctor& message_sent_functor,
+                std::shared_ptr<const std::string> encoded_body = nullptr,
+                const std::string& destination_id = std::string());
+  // Hands serialised to scheduler_ if it's set, and otherwise on to DispatchSerialised.
+  void RudpSendSerialised(const NodeId& peer_id, const std::string& serialised,
+                          const rudp::MessageSentFunctor& message_sent_functor,
+                          SendPriority priority);
+  // Hands serialised to rudp, or to bundler_ if bundling is on.
+  void DispatchSerialised(const NodeId& peer_id, const std::string& serialised,
+                          const rudp::MessageSentFunctor& message_sent_functor);
+  void FlushBundles();
   void SendTo(const protobuf::Message& message, const NodeId& peer_node_id,
-              const NodeId& peer_connection_id);
-  void RecursiveSendOn(protobuf::Message message, NodeInfo last_node_attempted = NodeInfo(),
-                       int attempt_count = 0);
+              const NodeId& peer_connection_id,
+              std::shared_ptr<const std::string> encoded_body = nullptr,
+              const std::string& destination_id = std::string());
+  void DoSendToClosestNode(const protobuf::Message& message,
+                           std::shared_ptr<const std::string> encoded_body);
+  // The message is shared with any retries, so it is copied once on entry rather than per attempt.
+  // A non-zero avoid is a still connected peer the next hop mustn't be, e.g. one with too many
+  // retries waiting already.
+  void RecursiveSendOn(std::shared_ptr<protobuf::Message> message,
+                       NodeInfo last_node_attempted = NodeInfo(), int attempt_count = 0,
+                       std::shared_ptr<const std::string> encoded_body = nullptr,
+                       const NodeId& avoid = NodeId());
+  // Waits out the backoff on a timer rather than a thread, then resumes RecursiveSendOn.
+  void ScheduleSendRetry(std::shared_ptr<protobuf::Message> message, const NodeInfo& peer,
+                         int attempt_count, std::shared_ptr<const std::string> encoded_body);
   void AdjustRouteHistory(protobuf::Message& message);
 
   bool running_;
   std::mutex running_mutex_;
   uint16_t bootstrap_attempt_;
   std::vector<boost::asio::ip::udp::endpoint> bootstrap_endpoints_;
+  std::shared_ptr<BootstrapCache> bootstrap_cache_;
   NodeId bootstrap_connection_id_;
   NodeId this_node_relay_connection_id_;
   RoutingTable& routing_table_;
   ClientRoutingTable& client_routing_table_;
   rudp::NatType nat_type_;
   NewBootstrapEndpointFunctor new_bootstrap_endpoint_;
+  Metrics* metrics_;
+  MessageCaptureWriter* message_capture_;
+  AsioService& asio_service_;
+  const std::chrono::milliseconds kSendRetryInterval_;
+  const uint16_t kMaxSendRetriesInFlight_;
+  std::set<std::shared_ptr<boost::asio::steady_timer>> retry_timers_;
+  std::map<NodeId, uint16_t> retries_in_flight_;
+  StreamRoutes stream_routes_;  // guarded by running_mutex_
+  RelayLinks relay_links_;
+  ShortcutTable shortcuts_;
+  const std::chrono::microseconds kBundleDelay_;
+  MessageBundler bundler_;
+  boost::asio::steady_timer bundle_timer_;  // guarded by running_mutex_
+  // Null unless InstanceParameters::max_sends_in_flight_per_peer is set.  Before rudp_, whose
+  // sent functors call into it.
+  std::unique_ptr<SendScheduler> scheduler_;
   rudp::ManagedConnections rudp_;
+  // Last, so that retry timer handlers run by a shared asio_service_ don't outlive the rest.
+  HandlerGuard handler_guard_;
 };
 
 }  // namespace routing
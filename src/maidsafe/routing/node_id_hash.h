@@ -0,0 +1,49 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_NODE_ID_HASH_H_
+#define MAIDSAFE_ROUTING_NODE_ID_HASH_H_
+
+#include <cstring>
+#include <functional>
+#include <string>
+
+#include "maidsafe/common/node_id.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// Hash for NodeId-keyed unordered containers.  NodeIds are hashes themselves, so their leading
+// bytes are already well distributed.
+struct NodeIdHash {
+  size_t operator()(const NodeId& node_id) const {
+    const std::string& id(node_id.string());
+    if (id.size() < sizeof(size_t))
+      return std::hash<std::string>()(id);
+    size_t hash(0);
+    std::memcpy(&hash, id.data(), sizeof(hash));
+    return hash;
+  }
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_NODE_ID_HASH_H_
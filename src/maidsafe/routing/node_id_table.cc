@@ -0,0 +1,88 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/node_id_table.h"
+
+#include <cassert>
+#include <iterator>
+#include <limits>
+#include <utility>
+
+namespace maidsafe {
+
+namespace routing {
+
+const NodeIdTable::Handle NodeIdTable::kInvalidHandle(std::numeric_limits<Handle>::max());
+
+NodeIdTable::NodeIdTable() : references_(), node_ids_(), free_handles_(), index_() {}
+
+NodeIdTable::Handle NodeIdTable::Acquire(const NodeId& node_id) {
+  auto found(index_.find(node_id));
+  if (found != std::end(index_)) {
+    ++references_[found->second];
+    return found->second;
+  }
+  Handle handle;
+  if (free_handles_.empty()) {
+    assert(references_.size() < kInvalidHandle);
+    handle = static_cast<Handle>(references_.size());
+    references_.push_back(0);
+    node_ids_.push_back(NodeId());
+  } else {
+    handle = *free_handles_.begin();
+    free_handles_.erase(free_handles_.begin());
+  }
+  references_[handle] = 1;
+  node_ids_[handle] = node_id;
+  index_.insert(std::make_pair(node_id, handle));
+  return handle;
+}
+
+bool NodeIdTable::Release(const NodeId& node_id) {
+  const Handle kHandle(Find(node_id));
+  return kHandle != kInvalidHandle && Release(kHandle);
+}
+
+bool NodeIdTable::Release(Handle handle) {
+  assert(handle < references_.size() && references_[handle] != 0);
+  if (--references_[handle] != 0)
+    return false;
+  index_.erase(node_ids_[handle]);
+  node_ids_[handle] = NodeId();
+  free_handles_.insert(handle);
+  // Free handles at the top are given up, along with their storage once most of it is unused.
+  while (!free_handles_.empty() && *free_handles_.rbegin() + 1 == references_.size()) {
+    free_handles_.erase(std::prev(free_handles_.end()));
+    references_.pop_back();
+    node_ids_.pop_back();
+  }
+  if (references_.size() < references_.capacity() / 4) {
+    references_.shrink_to_fit();
+    node_ids_.shrink_to_fit();
+  }
+  return true;
+}
+
+NodeIdTable::Handle NodeIdTable::Find(const NodeId& node_id) const {
+  auto found(index_.find(node_id));
+  return found == std::end(index_) ? kInvalidHandle : found->second;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
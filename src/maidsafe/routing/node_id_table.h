@@ -0,0 +1,82 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_NODE_ID_TABLE_H_
+#define MAIDSAFE_ROUTING_NODE_ID_TABLE_H_
+
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+
+#include "maidsafe/routing/node_id_hash.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// Interns the node IDs held by a routing structure, so that each distinct ID is stored once and is
+// known by a small integer handle, so that the owner can keep per-ID data in a vector indexed by
+// handle.  Each Acquire of an ID adds a reference to it and each Release drops one; a handle stays
+// valid until its ID's last reference is dropped, after which it may be handed out again for
+// another ID.  The lowest free handle is always reused first, so handles stay below handle_limit()
+// and the table's storage shrinks again as IDs are released.  Not thread-safe; the owner's lock
+// guards it.
+class NodeIdTable {
+ public:
+  typedef uint32_t Handle;
+  static const Handle kInvalidHandle;
+
+  NodeIdTable();
+
+  Handle Acquire(const NodeId& node_id);
+  // Returns true if this dropped node_id's last reference.  Nothing happens if it's not held.
+  bool Release(const NodeId& node_id);
+  // As above, for a handle which is held.
+  bool Release(Handle handle);
+  // kInvalidHandle if node_id isn't held.
+  Handle Find(const NodeId& node_id) const;
+  bool Contains(const NodeId& node_id) const { return index_.count(node_id) != 0; }
+
+  // The ID a held handle stands for.
+  const NodeId& node_id(Handle handle) const { return node_ids_[handle]; }
+  uint32_t references(Handle handle) const { return references_[handle]; }
+  size_t size() const { return index_.size(); }
+  // One more than the highest handle held, so an owner's vector indexed by handle can be trimmed
+  // to this size.
+  size_t handle_limit() const { return references_.size(); }
+
+ private:
+  NodeIdTable(const NodeIdTable&);
+  NodeIdTable& operator=(const NodeIdTable&);
+
+  // By handle; zero for free handles.
+  std::vector<uint32_t> references_;
+  std::vector<NodeId> node_ids_;
+  // Free handles below handle_limit(), for reuse.
+  std::set<Handle> free_handles_;
+  std::unordered_map<NodeId, Handle, NodeIdHash> index_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_NODE_ID_TABLE_H_
@@ -19,6 +19,8 @@
 #include "maidsafe/routing/node_info.h"
 
 #include <limits>
+#include <string>
+#include <utility>
 
 #include "maidsafe/routing/routing.pb.h"
 
@@ -30,6 +32,7 @@ NodeInfo::NodeInfo()
     : node_id(),
       connection_id(),
       public_key(),
+      encoded_public_key(),
       rank(),
       bucket(kInvalidBucket),
       nat_type(rudp::NatType::kUnknown),
@@ -39,6 +42,7 @@ NodeInfo::NodeInfo(const NodeInfo& other)
     : node_id(other.node_id),
       connection_id(other.connection_id),
       public_key(other.public_key),
+      encoded_public_key(other.encoded_public_key),
       rank(other.rank),
       bucket(other.bucket),
       nat_type(other.nat_type),
@@ -48,6 +52,7 @@ NodeInfo::NodeInfo(NodeInfo&& other)
     : node_id(std::move(other.node_id)),
       connection_id(std::move(other.connection_id)),
       public_key(std::move(other.public_key)),
+      encoded_public_key(std::move(other.encoded_public_key)),
       rank(std::move(other.rank)),
       bucket(std::move(other.bucket)),
       nat_type(std::move(other.nat_type)),
@@ -59,7 +64,11 @@ NodeInfo& NodeInfo::operator=(NodeInfo other) {
 }
 
 NodeInfo::NodeInfo(const serialised_type& serialised_message)
-    : connection_id(), public_key(), bucket(kInvalidBucket), nat_type(rudp::NatType::kUnknown) {
+    : connection_id(),
+      public_key(),
+      encoded_public_key(),
+      bucket(kInvalidBucket),
+      nat_type(rudp::NatType::kUnknown) {
   protobuf::NodeInfo proto_node_info;
   if (!proto_node_info.ParseFromString(serialised_message->string()))
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
@@ -95,12 +104,24 @@ void swap(NodeInfo& lhs, NodeInfo& rhs) MAIDSAFE_NOEXCEPT {
   swap(lhs.node_id, rhs.node_id);
   swap(lhs.connection_id, rhs.connection_id);
   swap(lhs.public_key, rhs.public_key);
+  swap(lhs.encoded_public_key, rhs.encoded_public_key);
   swap(lhs.rank, rhs.rank);
   swap(lhs.bucket, rhs.bucket);
   swap(lhs.nat_type, rhs.nat_type);
   swap(lhs.dimension_list, rhs.dimension_list);
 }
 
+void CacheEncodedPublicKey(NodeInfo& node_info) {
+  if (node_info.encoded_public_key)
+    return;
+  std::string encoded;
+  try {
+    encoded = asymm::EncodeKey(node_info.public_key).string();
+  }
+  catch (const std::exception&) {}
+  node_info.encoded_public_key = std::make_shared<const std::string>(std::move(encoded));
+}
+
 }  // namespace routing
 
 }  // namespace maidsafe
@@ -0,0 +1,153 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/node_lookup.h"
+
+#include <algorithm>
+
+#include "maidsafe/common/log.h"
+
+#include "maidsafe/routing/parameters.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+NodeLookup::NodeLookup(AsioService& asio_service, const NodeId& target_id,
+                       QueryFunctor query_functor)
+    : mutex_(),
+      asio_service_(asio_service),
+      kTargetId_(target_id),
+      query_functor_(query_functor),
+      candidates_(),
+      finished_(false) {}
+
+NodeLookup::~NodeLookup() {
+  for (auto& candidate : candidates_) {
+    if (candidate.timer)
+      candidate.timer->cancel();
+  }
+}
+
+void NodeLookup::AddResponse(const NodeId& peer_id, const std::vector<NodeId>& nodes) {
+  std::vector<NodeId> peers;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (finished_)
+      return;
+    auto add([this](const NodeId& node_id, State state) -> Candidate* {
+      if (node_id.IsZero() || node_id == kTargetId_)
+        return nullptr;
+      auto itr(std::find_if(std::begin(candidates_), std::end(candidates_),
+                            [&node_id](const Candidate& candidate) {
+        return candidate.node_id == node_id;
+      }));
+      if (itr != std::end(candidates_))
+        return &*itr;
+      itr = std::upper_bound(std::begin(candidates_), std::end(candidates_), node_id,
+                             [this](const NodeId& lhs, const Candidate& rhs) {
+        return NodeId::CloserToTarget(lhs, rhs.node_id, kTargetId_);
+      });
+      return &*candidates_.insert(itr, Candidate(node_id, state));
+    });
+
+    Candidate* responder(add(peer_id, State::kResponded));
+    if (responder) {
+      if (responder->timer)
+        responder->timer->cancel();
+      responder->timer.reset();
+      responder->state = State::kResponded;
+    }
+    for (const auto& node_id : nodes)
+      add(node_id, State::kNotQueried);
+    peers = NextQueries();
+  }
+  SendQueries(peers);
+}
+
+bool NodeLookup::finished() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return finished_;
+}
+
+std::vector<NodeId> NodeLookup::NextQueries() {
+  size_t in_flight(std::count_if(std::begin(candidates_), std::end(candidates_),
+                                 [](const Candidate& candidate) {
+    return candidate.state == State::kInFlight;
+  }));
+  std::vector<NodeId> peers;
+  uint16_t considered(0);
+  std::weak_ptr<NodeLookup> this_weak_ptr(shared_from_this());
+  for (auto& candidate : candidates_) {
+    if (considered == Parameters::closest_nodes_size ||
+        in_flight >= Parameters::find_nodes_alpha)
+      break;
+    if (candidate.state == State::kTimedOut)
+      continue;
+    ++considered;
+    if (candidate.state != State::kNotQueried)
+      continue;
+    candidate.state = State::kInFlight;
+    candidate.timer = std::make_shared<boost::asio::steady_timer>(asio_service_.service());
+    candidate.timer->expires_from_now(Parameters::find_nodes_query_timeout);
+    NodeId peer_id(candidate.node_id);
+    candidate.timer->async_wait([this_weak_ptr, peer_id](const boost::system::error_code& error) {
+      if (error == boost::asio::error::operation_aborted)
+        return;
+      if (std::shared_ptr<NodeLookup> node_lookup = this_weak_ptr.lock())
+        node_lookup->OnTimeout(peer_id);
+    });
+    peers.push_back(peer_id);
+    ++in_flight;
+  }
+  if (in_flight == 0) {
+    finished_ = true;
+    LOG(kVerbose) << "Lookup for " << DebugId(kTargetId_) << " finished with "
+                  << candidates_.size() << " candidates";
+  }
+  return peers;
+}
+
+void NodeLookup::OnTimeout(const NodeId& peer_id) {
+  std::vector<NodeId> peers;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (finished_)
+      return;
+    auto itr(std::find_if(std::begin(candidates_), std::end(candidates_),
+                          [&peer_id](const Candidate& candidate) {
+      return candidate.node_id == peer_id;
+    }));
+    if (itr == std::end(candidates_) || itr->state != State::kInFlight)
+      return;
+    LOG(kVerbose) << "FindNodes to " << DebugId(peer_id) << " timed out";
+    itr->state = State::kTimedOut;
+    itr->timer.reset();
+    peers = NextQueries();
+  }
+  SendQueries(peers);
+}
+
+void NodeLookup::SendQueries(const std::vector<NodeId>& peers) {
+  for (const auto& peer_id : peers)
+    query_functor_(peer_id);
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
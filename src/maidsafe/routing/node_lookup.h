@@ -0,0 +1,83 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_NODE_LOOKUP_H_
+#define MAIDSAFE_ROUTING_NODE_LOOKUP_H_
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "boost/asio/steady_timer.hpp"
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/node_id.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// Iterative lookup of the nodes closest to a target.  Each FindNodes response names further
+// candidates; up to Parameters::find_nodes_alpha requests are kept in flight to the closest ones
+// not yet asked, each given up on after Parameters::find_nodes_query_timeout.  The lookup finishes
+// once the closest Parameters::closest_nodes_size candidates which haven't timed out have all
+// answered.
+class NodeLookup : public std::enable_shared_from_this<NodeLookup> {
+ public:
+  // Sends a FindNodes request for the target to the given peer.
+  typedef std::function<void(const NodeId& /*peer_id*/)> QueryFunctor;
+
+  NodeLookup(AsioService& asio_service, const NodeId& target_id, QueryFunctor query_functor);
+  ~NodeLookup();
+  // Records the nodes returned by 'peer_id' and sends further requests as required.  Responses from
+  // peers this lookup didn't ask (e.g. to a routed FindNodes) seed it.
+  void AddResponse(const NodeId& peer_id, const std::vector<NodeId>& nodes);
+  bool finished() const;
+
+ private:
+  enum class State { kNotQueried, kInFlight, kResponded, kTimedOut };
+  struct Candidate {
+    Candidate(const NodeId& node_id_in, State state_in)
+        : node_id(node_id_in), state(state_in), timer() {}
+    NodeId node_id;
+    State state;
+    std::shared_ptr<boost::asio::steady_timer> timer;
+  };
+
+  NodeLookup(const NodeLookup&);
+  NodeLookup(const NodeLookup&&);
+  NodeLookup& operator=(const NodeLookup&);
+  // Must be called with mutex_ locked.  Returns the peers to be sent requests.
+  std::vector<NodeId> NextQueries();
+  void OnTimeout(const NodeId& peer_id);
+  void SendQueries(const std::vector<NodeId>& peers);
+
+  mutable std::mutex mutex_;
+  AsioService& asio_service_;
+  const NodeId kTargetId_;
+  QueryFunctor query_functor_;
+  std::vector<Candidate> candidates_;  // closest to kTargetId_ first
+  bool finished_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_NODE_LOOKUP_H_
@@ -18,6 +18,8 @@
 
 #include "maidsafe/routing/parameters.h"
 
+#include <algorithm>
+
 #include "maidsafe/rudp/parameters.h"
 #include "maidsafe/rudp/managed_connections.h"
 
@@ -27,10 +29,14 @@ namespace maidsafe {
 
 namespace routing {
 
-uint16_t Parameters::thread_count(8);
+uint16_t Parameters::thread_count(2);
+uint16_t Parameters::message_dispatch_strands(16);
+uint32_t Parameters::max_queued_messages(10000);
 uint16_t Parameters::num_chunks_to_cache(100);
+uint32_t Parameters::cache_capacity_bytes(32 * 1024 * 1024);
 uint16_t Parameters::closest_nodes_size(8);
-uint16_t Parameters::group_size(4);
+const uint16_t Parameters::kDefaultGroupSize;
+uint16_t Parameters::group_size(Parameters::kDefaultGroupSize);
 uint16_t Parameters::proximity_factor(2);
 uint16_t Parameters::max_routing_table_size(64);
 uint16_t Parameters::routing_table_size_threshold(max_routing_table_size / 4);
@@ -38,22 +44,81 @@ uint16_t Parameters::max_routing_table_size_for_client(8);
 uint16_t Parameters::max_client_routing_table_size(max_routing_table_size);
 uint16_t Parameters::bucket_target_size(1);
 std::chrono::steady_clock::duration Parameters::default_response_timeout(std::chrono::seconds(10));
+bool Parameters::request_deadlines(false);
 std::chrono::seconds Parameters::find_node_interval(10);
 std::chrono::seconds Parameters::recovery_time_lag(5);
 std::chrono::seconds Parameters::re_bootstrap_time_lag(10);
+uint16_t Parameters::max_ranked_bootstrap_attempts(4);
+std::chrono::seconds Parameters::bootstrap_cache_flush_interval(10);
+std::chrono::seconds Parameters::routing_snapshot_interval(60);
 std::chrono::seconds Parameters::find_close_node_interval(3);
+uint16_t Parameters::interval_backoff_limit(8);
+uint16_t Parameters::interval_tighten_limit(4);
+uint16_t Parameters::find_nodes_alpha(3);
+std::chrono::steady_clock::duration Parameters::find_nodes_query_timeout(std::chrono::seconds(2));
+std::chrono::milliseconds Parameters::find_nodes_memo_ttl(500);
+uint16_t Parameters::find_nodes_memo_size(64);
+uint16_t Parameters::max_concurrent_connects(16);
+uint16_t Parameters::max_queued_connects(256);
+std::chrono::steady_clock::duration Parameters::connect_attempt_timeout(std::chrono::seconds(10));
+std::chrono::milliseconds Parameters::closest_nodes_update_interval(100);
+std::chrono::seconds Parameters::matrix_digest_interval(0);
+uint16_t Parameters::matrix_epoch_history(256);
+std::chrono::milliseconds Parameters::change_notification_interval(20);
+int Parameters::network_status_hysteresis(0);
+std::chrono::milliseconds Parameters::network_status_min_interval(0);
+bool Parameters::weighted_network_status(false);
+std::chrono::milliseconds Parameters::connection_loss_batch_interval(50);
 uint16_t Parameters::find_node_repeats_per_num_requested(3);
 uint16_t Parameters::maximum_find_close_node_failures(10);
 uint16_t Parameters::max_route_history(5);
 uint16_t Parameters::hops_to_live(50);
+bool Parameters::adaptive_hops_to_live(true);
+uint16_t Parameters::min_hops_to_live(8);
+std::chrono::milliseconds Parameters::send_retry_interval(50);
+uint16_t Parameters::max_send_retries_in_flight(16);
+std::chrono::microseconds Parameters::message_bundle_delay(0);
+uint32_t Parameters::max_bundled_message_size(1024);
+uint32_t Parameters::max_message_bundle_size(16 * 1024);
+uint16_t Parameters::max_sends_in_flight_per_peer(0);
+uint32_t Parameters::bulk_message_size(64 * 1024);
+std::chrono::seconds Parameters::link_probe_interval(30);
+uint16_t Parameters::max_link_probes(0);
+std::chrono::milliseconds Parameters::network_viewer_update_interval(500);
+uint16_t Parameters::link_preference_factor(2);
+std::chrono::steady_clock::duration Parameters::duplicate_filter_window(std::chrono::seconds(10));
+uint16_t Parameters::duplicate_filter_capacity(4096);
+uint32_t Parameters::routing_request_rate(0);
+uint32_t Parameters::routing_request_burst(20);
+uint32_t Parameters::max_rate_limited_buckets(4096);
+uint32_t Parameters::max_spare_response_states(4096);
+uint16_t Parameters::client_relay_links(0);
+uint16_t Parameters::max_shortcuts(0);
+uint16_t Parameters::shortcut_threshold(8);
+std::chrono::seconds Parameters::shortcut_idle_timeout(120);
 uint16_t Parameters::accepted_distance_tolerance(1);
 uint16_t Parameters::greedy_fraction(Parameters::max_routing_table_size * 3 / 4);
 uint16_t Parameters::split_avoidance(4);
 uint16_t Parameters::routing_table_ready_to_response(Parameters::greedy_fraction * 9 / 10);
 bptime::time_duration Parameters::connect_rpc_prune_timeout(
     rudp::Parameters::rendezvous_connect_timeout * 2);
+std::chrono::milliseconds Parameters::public_key_batch_window(20);
+std::chrono::seconds Parameters::public_key_cache_ttl(600);
+uint16_t Parameters::signature_thread_count(2);
+uint16_t Parameters::signature_batch_size(16);
+uint32_t Parameters::signature_verdict_cache_size(4096);
+uint16_t Parameters::upcall_thread_count(0);
+uint32_t Parameters::max_queued_upcalls(1024);
+uint16_t Parameters::compression_level(1);
+uint16_t Parameters::get_group_batch_size(64);
+std::chrono::seconds Parameters::get_group_cache_ttl(10);
+uint16_t Parameters::get_group_cache_size(256);
 // 10 KB of book keeping data for Routing
 uint32_t Parameters::max_data_size(rudp::ManagedConnections::kMaxMessageSize() - 10240);
+uint32_t Parameters::max_stream_size(64 * 1024 * 1024);
+uint16_t Parameters::stream_window(8);
+uint16_t Parameters::max_incoming_streams(16);
+uint32_t Parameters::max_incoming_stream_bytes(128 * 1024 * 1024);
 bool Parameters::append_maidsafe_endpoints(false);
 // TODO(Prakash): BEFORE_RELEASE revisit below preprocessor directives to remove internal endpoints
 #if defined QA_BUILD || defined TESTING
@@ -67,6 +132,60 @@ bool Parameters::append_maidsafe_local_endpoints(false);
 bool Parameters::append_local_live_port_endpoint(false);
 // TODO(Prakash): BEFORE_RELEASE enable caching after persona tests are passing
 bool Parameters::caching(false);
+bool Parameters::message_logging(true);
+uint32_t Parameters::trace_sample_interval(0);
+
+InstanceParameters::InstanceParameters()
+    : message_dispatch_strands(Parameters::message_dispatch_strands),
+      max_queued_messages(Parameters::max_queued_messages),
+      max_routing_table_size(Parameters::max_routing_table_size),
+      routing_table_size_threshold(Parameters::routing_table_size_threshold),
+      max_routing_table_size_for_client(Parameters::max_routing_table_size_for_client),
+      max_client_routing_table_size(Parameters::max_client_routing_table_size),
+      bucket_target_size(Parameters::bucket_target_size),
+      greedy_fraction(Parameters::greedy_fraction),
+      default_response_timeout(Parameters::default_response_timeout),
+      send_retry_interval(Parameters::send_retry_interval),
+      max_send_retries_in_flight(Parameters::max_send_retries_in_flight),
+      message_bundle_delay(Parameters::message_bundle_delay),
+      max_sends_in_flight_per_peer(Parameters::max_sends_in_flight_per_peer),
+      routing_request_rate(Parameters::routing_request_rate),
+      routing_request_burst(Parameters::routing_request_burst),
+      max_link_probes(Parameters::max_link_probes),
+      max_shortcuts(Parameters::max_shortcuts),
+      shortcut_threshold(Parameters::shortcut_threshold),
+      shortcut_idle_timeout(Parameters::shortcut_idle_timeout),
+      upcall_thread_count(Parameters::upcall_thread_count),
+      signature_thread_count(Parameters::signature_thread_count),
+      worker_cpus(),
+      client_matrix_rows(true) {}
+
+const uint16_t InstanceParameters::kLargeRoutingTableSize;
+
+InstanceParameters InstanceParameters::LeanClient() {
+  InstanceParameters parameters;
+  parameters.message_dispatch_strands = 1;
+  parameters.max_queued_messages = 256;
+  parameters.max_client_routing_table_size = 0;
+  parameters.max_send_retries_in_flight = 2;
+  parameters.client_matrix_rows = false;
+  parameters.upcall_thread_count = 0;
+  parameters.signature_thread_count = 0;
+  return parameters;
+}
+
+InstanceParameters InstanceParameters::LargeTable(uint16_t table_size) {
+  InstanceParameters parameters;
+  parameters.max_routing_table_size = table_size;
+  parameters.routing_table_size_threshold = static_cast<uint16_t>(table_size / 4);
+  parameters.greedy_fraction = static_cast<uint16_t>(table_size * 3 / 4);
+  // Enough per bucket that each hop resolves several bits of the target, rather than one.
+  parameters.bucket_target_size = std::max(Parameters::bucket_target_size,
+                                           static_cast<uint16_t>(table_size / 64));
+  parameters.max_link_probes = Parameters::max_routing_table_size;
+  return parameters;
+}
+
 }  // namespace routing
 
 }  // namespace maidsafe
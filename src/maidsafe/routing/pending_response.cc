@@ -0,0 +1,254 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/pending_response.h"
+
+#include <cassert>
+#include <utility>
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace detail {
+
+CompletionState::CompletionState()
+    : mutex_(),
+      cond_var_(),
+      expected_count_(0),
+      delivered_count_(0),
+      taken_count_(0),
+      responses_(),
+      on_response_(),
+      on_ready_(),
+      references_(0),
+      pool_() {}
+
+std::function<void(std::string)> CompletionState::Completer() {
+  AddReference();
+  // Capturing only the pointer keeps the functor within std::function's small buffer.
+  return [this](std::string response) { Deliver(std::move(response)); };
+}
+
+void CompletionState::Deliver(std::string response) {
+  std::function<void(std::string)> on_response;
+  std::function<void()> on_ready;
+  bool last(false);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    assert(delivered_count_ < expected_count_);
+    last = (++delivered_count_ == expected_count_);
+    if (on_response_)
+      on_response = on_response_;
+    else
+      responses_.push_back(std::move(response));
+    on_ready.swap(on_ready_);
+  }
+  cond_var_.notify_all();
+  if (on_response)
+    on_response(std::move(response));
+  if (on_ready)
+    on_ready();
+  if (last)
+    Release();
+}
+
+bool CompletionState::ready() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return IsReady();
+}
+
+bool CompletionState::IsReady() const {
+  return responses_.size() > taken_count_ || delivered_count_ == expected_count_;
+}
+
+bool CompletionState::Take(std::string& response) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cond_var_.wait(lock, [this] { return IsReady(); });
+  if (responses_.size() == taken_count_)
+    return false;
+  response = std::move(responses_[taken_count_++]);
+  return true;
+}
+
+bool CompletionState::TakeFor(const std::chrono::steady_clock::duration& timeout,
+                              std::string& response) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!cond_var_.wait_for(lock, timeout, [this] { return IsReady(); }) ||
+      responses_.size() == taken_count_)
+    return false;
+  response = std::move(responses_[taken_count_++]);
+  return true;
+}
+
+void CompletionState::Then(std::function<void(std::string)> on_response) {
+  std::vector<std::string> received;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    on_response_ = on_response;
+    for (; taken_count_ != responses_.size(); ++taken_count_)
+      received.push_back(std::move(responses_[taken_count_]));
+  }
+  for (auto& response : received)
+    on_response(std::move(response));
+}
+
+void CompletionState::OnReady(std::function<void()> on_ready) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!IsReady()) {
+      on_ready_ = std::move(on_ready);
+      return;
+    }
+  }
+  on_ready();
+}
+
+void CompletionState::AddReference() { ++references_; }
+
+void CompletionState::Release() {
+  if (--references_ != 0)
+    return;
+  // The pool may go when its last in-use state does, so it's held until this has been returned.
+  std::shared_ptr<CompletionPool> pool(std::move(pool_));
+  pool->Return(this);
+}
+
+void CompletionState::Reset(int expected_count, std::shared_ptr<CompletionPool> pool) {
+  expected_count_ = expected_count;
+  delivered_count_ = 0;
+  taken_count_ = 0;
+  responses_.clear();
+  responses_.reserve(static_cast<size_t>(expected_count));
+  on_response_ = nullptr;
+  on_ready_ = nullptr;
+  references_ = 1;
+  pool_ = std::move(pool);
+}
+
+CompletionPool::CompletionPool(size_t max_spare) : kMaxSpare_(max_spare), mutex_(), spare_() {
+  spare_.reserve(kMaxSpare_);
+}
+
+CompletionPool::~CompletionPool() {
+  for (auto state : spare_)
+    delete state;
+}
+
+CompletionState* CompletionPool::Acquire(int expected_count) {
+  assert(expected_count > 0);
+  CompletionState* state(nullptr);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!spare_.empty()) {
+      state = spare_.back();
+      spare_.pop_back();
+    }
+  }
+  if (!state)
+    state = new CompletionState;
+  state->Reset(expected_count, shared_from_this());
+  return state;
+}
+
+void CompletionPool::Return(CompletionState* state) {
+  // Drops what the finished request's callbacks hold before the state is reused.
+  state->on_response_ = nullptr;
+  state->on_ready_ = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (spare_.size() < kMaxSpare_) {
+      spare_.push_back(state);
+      return;
+    }
+  }
+  delete state;
+}
+
+size_t CompletionPool::spare_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return spare_.size();
+}
+
+}  // namespace detail
+
+PendingResponse::PendingResponse() : state_(nullptr) {}
+
+PendingResponse::PendingResponse(detail::CompletionState* state) : state_(state) {}
+
+PendingResponse::PendingResponse(PendingResponse&& other) MAIDSAFE_NOEXCEPT
+    : state_(other.state_) {
+  other.state_ = nullptr;
+}
+
+PendingResponse& PendingResponse::operator=(PendingResponse&& other) MAIDSAFE_NOEXCEPT {
+  std::swap(state_, other.state_);
+  return *this;
+}
+
+PendingResponse::~PendingResponse() {
+  if (state_)
+    state_->Release();
+}
+
+bool PendingResponse::ready() const { return state_->ready(); }
+
+std::string PendingResponse::get() {
+  std::string response;
+  state_->Take(response);
+  return response;
+}
+
+bool PendingResponse::WaitFor(const std::chrono::steady_clock::duration& timeout,
+                              std::string& response) {
+  return state_->TakeFor(timeout, response);
+}
+
+void PendingResponse::Then(std::function<void(std::string)> on_response) {
+  state_->Then(std::move(on_response));
+}
+
+GroupResponses::GroupResponses() : state_(nullptr) {}
+
+GroupResponses::GroupResponses(detail::CompletionState* state) : state_(state) {}
+
+GroupResponses::GroupResponses(GroupResponses&& other) MAIDSAFE_NOEXCEPT : state_(other.state_) {
+  other.state_ = nullptr;
+}
+
+GroupResponses& GroupResponses::operator=(GroupResponses&& other) MAIDSAFE_NOEXCEPT {
+  std::swap(state_, other.state_);
+  return *this;
+}
+
+GroupResponses::~GroupResponses() {
+  if (state_)
+    state_->Release();
+}
+
+int GroupResponses::expected_count() const { return state_->expected_count(); }
+
+bool GroupResponses::Next(std::string& response) { return state_->Take(response); }
+
+void GroupResponses::Then(std::function<void(std::string)> on_response) {
+  state_->Then(std::move(on_response));
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
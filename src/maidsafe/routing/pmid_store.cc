@@ -0,0 +1,153 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/pmid_store.h"
+
+#include <cstring>
+#include <fstream>  // NOLINT
+#include <string>
+
+#include "boost/interprocess/file_mapping.hpp"
+#include "boost/interprocess/mapped_region.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+
+#include "maidsafe/passport/passport.h"
+
+namespace bi = boost::interprocess;
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+// The indexed format, in native byte order: kMagic, the pmid count, then for each pmid its ID
+// with the offset and size of its serialised form, then the serialised pmids.
+const char kMagic[8] = {'M', 'S', 'P', 'M', 'I', 'D', 'S', '1'};
+const size_t kHeaderSize(sizeof(kMagic) + sizeof(uint64_t));
+const size_t kIndexEntrySize(NodeId::kSize + 2 * sizeof(uint64_t));
+
+uint64_t ReadUint64(const char* data) {
+  uint64_t value(0);
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+void AppendUint64(uint64_t value, std::string& data) {
+  data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+bool IsIndexed(const boost::filesystem::path& path) {
+  std::ifstream file(path.string(), std::ios::binary);
+  char magic[sizeof(kMagic)];
+  return file.read(magic, sizeof(magic)) && std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+}  // unnamed namespace
+
+PmidStore::PmidStore(const boost::filesystem::path& path)
+    : file_(), region_(), count_(0), listed_pmids_() {
+  if (!IsIndexed(path)) {
+    listed_pmids_ = passport::detail::ReadPmidList(path);
+    count_ = listed_pmids_.size();
+    return;
+  }
+  file_.reset(new bi::file_mapping(path.string().c_str(), bi::read_only));
+  region_.reset(new bi::mapped_region(*file_, bi::read_only));
+  if (region_->get_size() < kHeaderSize)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  const uint64_t kCount(
+      ReadUint64(static_cast<const char*>(region_->get_address()) + sizeof(kMagic)));
+  if (kCount > (region_->get_size() - kHeaderSize) / kIndexEntrySize)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  count_ = static_cast<size_t>(kCount);
+}
+
+PmidStore::~PmidStore() {}
+
+const char* PmidStore::IndexEntry(size_t index) const {
+  return static_cast<const char*>(region_->get_address()) + kHeaderSize + index * kIndexEntrySize;
+}
+
+NodeId PmidStore::node_id(size_t index) const {
+  if (index >= count_)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  if (!region_)
+    return NodeId(listed_pmids_[index].name()->string());
+  return NodeId(std::string(IndexEntry(index), NodeId::kSize));
+}
+
+passport::Pmid PmidStore::pmid(size_t index) const {
+  if (index >= count_)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  if (!region_)
+    return listed_pmids_[index];
+  const uint64_t kOffset(ReadUint64(IndexEntry(index) + NodeId::kSize)),
+      kSize(ReadUint64(IndexEntry(index) + NodeId::kSize + sizeof(uint64_t)));
+  if (kSize == 0 || kOffset > region_->get_size() || kSize > region_->get_size() - kOffset)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  const char* serialised(static_cast<const char*>(region_->get_address()) + kOffset);
+  return passport::ParsePmid(NonEmptyString(std::string(serialised, static_cast<size_t>(kSize))));
+}
+
+size_t PmidStore::Find(const NodeId& node_id) const {
+  const std::string kId(node_id.string());
+  for (size_t index(0); index != count_; ++index) {
+    if (region_ ? std::memcmp(IndexEntry(index), kId.data(), NodeId::kSize) == 0
+                : listed_pmids_[index].name()->string() == kId) {
+      return index;
+    }
+  }
+  return count_;
+}
+
+bool WritePmidStore(const boost::filesystem::path& path,
+                    const std::vector<passport::Pmid>& pmids) {
+  try {
+    std::vector<std::string> serialised_pmids;
+    serialised_pmids.reserve(pmids.size());
+    for (const auto& pmid : pmids)
+      serialised_pmids.push_back(passport::SerialisePmid(pmid).string());
+
+    std::string index(kMagic, sizeof(kMagic));
+    AppendUint64(pmids.size(), index);
+    uint64_t offset(kHeaderSize + pmids.size() * kIndexEntrySize);
+    for (size_t i(0); i != pmids.size(); ++i) {
+      index.append(pmids[i].name()->string());
+      AppendUint64(offset, index);
+      AppendUint64(serialised_pmids[i].size(), index);
+      offset += serialised_pmids[i].size();
+    }
+
+    std::ofstream file(path.string(), std::ios::binary | std::ios::trunc);
+    file.write(index.data(), index.size());
+    for (const auto& serialised_pmid : serialised_pmids)
+      file.write(serialised_pmid.data(), serialised_pmid.size());
+    return static_cast<bool>(file.flush());
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Failed to write pmids to " << path << ": " << e.what();
+    return false;
+  }
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,78 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_PMID_STORE_H_
+#define MAIDSAFE_ROUTING_PMID_STORE_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/node_id.h"
+
+#include "maidsafe/passport/types.h"
+
+namespace boost {
+namespace interprocess {
+class file_mapping;
+class mapped_region;
+}
+}
+
+namespace maidsafe {
+
+namespace routing {
+
+// The pmids of a test network, as written by routing_key_helper.  Files written by WritePmidStore
+// are mapped rather than read, and hold each pmid's ID in an index, so a node can find and parse
+// its own identity without parsing every other.  Files in passport's list format (see
+// passport::detail::WritePmidList) are still accepted, but are parsed whole.
+class PmidStore {
+ public:
+  // Throws if the file can't be read or parsed.
+  explicit PmidStore(const boost::filesystem::path& path);
+  ~PmidStore();
+  size_t size() const { return count_; }
+  // Both throw if index is out of range; pmid also throws if that entry can't be parsed.
+  NodeId node_id(size_t index) const;
+  passport::Pmid pmid(size_t index) const;
+  // The index of the pmid with this ID, or size() if there's none.
+  size_t Find(const NodeId& node_id) const;
+
+ private:
+  PmidStore(const PmidStore&);
+  PmidStore& operator=(const PmidStore&);
+  const char* IndexEntry(size_t index) const;
+
+  std::unique_ptr<boost::interprocess::file_mapping> file_;
+  std::unique_ptr<boost::interprocess::mapped_region> region_;
+  size_t count_;
+  std::vector<passport::Pmid> listed_pmids_;  // only for files in passport's list format
+};
+
+// Writes pmids in PmidStore's indexed format, replacing any file at path.  Returns false on
+// failure.
+bool WritePmidStore(const boost::filesystem::path& path, const std::vector<passport::Pmid>& pmids);
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_PMID_STORE_H_
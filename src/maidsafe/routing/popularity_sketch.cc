@@ -0,0 +1,72 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/popularity_sketch.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+namespace maidsafe {
+
+namespace routing {
+
+PopularitySketch::PopularitySketch(size_t width, size_t depth)
+    : kWidth_(std::max(width, static_cast<size_t>(1))),
+      kDepth_(std::max(depth, static_cast<size_t>(1))),
+      kSampleSize_(kWidth_ * 10),
+      counts_(kWidth_ * kDepth_, 0),
+      additions_(0) {}
+
+void PopularitySketch::Add(const std::string& key) {
+  size_t hash(std::hash<std::string>()(key));
+  for (size_t row(0); row != kDepth_; ++row) {
+    uint32_t& count(counts_[Index(hash, row)]);
+    if (count != std::numeric_limits<uint32_t>::max())
+      ++count;
+  }
+  if (++additions_ == kSampleSize_)
+    Age();
+}
+
+uint32_t PopularitySketch::Estimate(const std::string& key) const {
+  size_t hash(std::hash<std::string>()(key));
+  uint32_t estimate(std::numeric_limits<uint32_t>::max());
+  for (size_t row(0); row != kDepth_; ++row)
+    estimate = std::min(estimate, counts_[Index(hash, row)]);
+  return estimate;
+}
+
+size_t PopularitySketch::Index(size_t hash, size_t row) const {
+  // A differently seeded mix of the one hash per row (splitmix64's finaliser).
+  uint64_t mixed(static_cast<uint64_t>(hash) + (row + 1) * 0x9E3779B97F4A7C15ULL);
+  mixed = (mixed ^ (mixed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  mixed = (mixed ^ (mixed >> 27)) * 0x94D049BB133111EBULL;
+  mixed ^= mixed >> 31;
+  return row * kWidth_ + static_cast<size_t>(mixed % kWidth_);
+}
+
+void PopularitySketch::Age() {
+  for (auto& count : counts_)
+    count /= 2;
+  additions_ /= 2;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,54 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_POPULARITY_SKETCH_H_
+#define MAIDSAFE_ROUTING_POPULARITY_SKETCH_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace maidsafe {
+
+namespace routing {
+
+// Count-Min sketch of how often keys have been seen.  Estimates are never below the true count
+// since the last aging, and exceed it only through hash collisions.  Once width * 10 keys have
+// been added, every count is halved, so the estimates follow recent traffic.  Not thread-safe.
+class PopularitySketch {
+ public:
+  PopularitySketch(size_t width, size_t depth);
+  void Add(const std::string& key);
+  uint32_t Estimate(const std::string& key) const;
+
+ private:
+  PopularitySketch(const PopularitySketch&);
+  PopularitySketch& operator=(const PopularitySketch&);
+  size_t Index(size_t hash, size_t row) const;
+  void Age();
+
+  const size_t kWidth_, kDepth_, kSampleSize_;
+  std::vector<uint32_t> counts_;  // kDepth_ rows of kWidth_
+  size_t additions_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_POPULARITY_SKETCH_H_
@@ -0,0 +1,175 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/public_key_requester.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "maidsafe/common/log.h"
+
+#include "maidsafe/routing/parameters.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+const size_t PublicKeyRequester::kMaxCachedKeys;
+
+PublicKeyRequester::PublicKeyRequester(AsioService& asio_service,
+                                       std::chrono::steady_clock::duration response_timeout)
+    : kResponseTimeout_(response_timeout),
+      mutex_(),
+      request_public_key_(),
+      request_public_keys_(),
+      pending_(),
+      batch_(),
+      cache_(),
+      batch_timer_(asio_service.service()) {}
+
+PublicKeyRequester::~PublicKeyRequester() { batch_timer_.cancel(); }
+
+void PublicKeyRequester::set_request_public_key_functor(
+    RequestPublicKeyFunctor request_public_key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  request_public_key_ = request_public_key;
+}
+
+void PublicKeyRequester::set_request_public_keys_functor(
+    RequestPublicKeysFunctor request_public_keys) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  request_public_keys_ = request_public_keys;
+}
+
+bool PublicKeyRequester::enabled() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return request_public_key_ || request_public_keys_;
+}
+
+void PublicKeyRequester::RequestPublicKey(const NodeId& node_id,
+                                          GivePublicKeyFunctor give_public_key) {
+  const auto kNow(std::chrono::steady_clock::now());
+  RequestPublicKeyFunctor request_public_key;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto cached(cache_.find(node_id));
+    if (cached != std::end(cache_)) {
+      if (cached->second.expiry > kNow) {
+        asymm::PublicKey public_key(cached->second.public_key);
+        lock.unlock();
+        LOG(kVerbose) << "Using cached public key for " << DebugId(node_id);
+        return give_public_key(public_key);
+      }
+      cache_.erase(cached);
+    }
+
+    PendingRequest& pending(pending_[node_id]);
+    pending.callbacks.push_back(std::move(give_public_key));
+    // A lookup still in progress is shared; one unanswered for too long is retried.
+    if (pending.callbacks.size() > 1 &&
+        kNow - pending.requested < kResponseTimeout_)
+      return;
+    pending.requested = kNow;
+
+    if (!request_public_keys_) {
+      request_public_key = request_public_key_;
+    } else {
+      batch_.push_back(node_id);
+      if (batch_.size() == 1) {
+        std::weak_ptr<PublicKeyRequester> this_weak_ptr(shared_from_this());
+        batch_timer_.expires_from_now(Parameters::public_key_batch_window);
+        batch_timer_.async_wait([this_weak_ptr](const boost::system::error_code& error_code) {
+          if (error_code == boost::asio::error::operation_aborted)
+            return;
+          if (std::shared_ptr<PublicKeyRequester> requester = this_weak_ptr.lock())
+            requester->SendBatch();
+        });
+      }
+    }
+  }
+
+  if (request_public_key) {
+    std::weak_ptr<PublicKeyRequester> this_weak_ptr(shared_from_this());
+    request_public_key(node_id, [this_weak_ptr, node_id](asymm::PublicKey public_key) {
+      if (std::shared_ptr<PublicKeyRequester> requester = this_weak_ptr.lock())
+        requester->GiveKey(node_id, public_key);
+    });
+  }
+}
+
+void PublicKeyRequester::SendBatch() {
+  std::vector<NodeId> node_ids;
+  RequestPublicKeysFunctor request_public_keys;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    node_ids.swap(batch_);
+    request_public_keys = request_public_keys_;
+  }
+  if (node_ids.empty() || !request_public_keys)
+    return;
+  LOG(kVerbose) << "Requesting public keys for " << node_ids.size() << " peers";
+  std::weak_ptr<PublicKeyRequester> this_weak_ptr(shared_from_this());
+  request_public_keys(node_ids, [this_weak_ptr](const NodeId& node_id,
+                                                const asymm::PublicKey& public_key) {
+    if (std::shared_ptr<PublicKeyRequester> requester = this_weak_ptr.lock())
+      requester->GiveKey(node_id, public_key);
+  });
+}
+
+void PublicKeyRequester::GiveKey(const NodeId& node_id, const asymm::PublicKey& public_key) {
+  std::vector<GivePublicKeyFunctor> callbacks;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto pending(pending_.find(node_id));
+    if (pending != std::end(pending_)) {
+      callbacks.swap(pending->second.callbacks);
+      pending_.erase(pending);
+    }
+    if (asymm::ValidateKey(public_key))
+      CacheKey(node_id, public_key);
+  }
+  for (const auto& callback : callbacks)
+    callback(public_key);
+}
+
+void PublicKeyRequester::CacheKey(const NodeId& node_id, const asymm::PublicKey& public_key) {
+  const auto kNow(std::chrono::steady_clock::now());
+  if (cache_.size() >= kMaxCachedKeys && cache_.count(node_id) == 0) {
+    for (auto itr(std::begin(cache_)); itr != std::end(cache_);) {
+      if (itr->second.expiry <= kNow)
+        itr = cache_.erase(itr);
+      else
+        ++itr;
+    }
+    if (cache_.size() >= kMaxCachedKeys) {
+      cache_.erase(std::min_element(
+          std::begin(cache_), std::end(cache_),
+          [](const std::pair<const NodeId, CachedKey>& lhs,
+             const std::pair<const NodeId, CachedKey>& rhs) {
+            return lhs.second.expiry < rhs.second.expiry;
+          }));
+    }
+  }
+  CachedKey& cached(cache_[node_id]);
+  cached.public_key = public_key;
+  cached.expiry = kNow + Parameters::public_key_cache_ttl;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
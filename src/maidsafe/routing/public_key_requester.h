@@ -0,0 +1,94 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_PUBLIC_KEY_REQUESTER_H_
+#define MAIDSAFE_ROUTING_PUBLIC_KEY_REQUESTER_H_
+
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "boost/asio/steady_timer.hpp"
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/rsa.h"
+
+#include "maidsafe/routing/api_config.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// Looks up peers' public keys through the upper layer.  Requests for the same peer are coalesced.
+// If a RequestPublicKeysFunctor is set, requests arriving within
+// Parameters::public_key_batch_window of each other are passed to it as one batch; otherwise each
+// peer is passed to the RequestPublicKeyFunctor.  Valid keys are cached for
+// Parameters::public_key_cache_ttl, so peers reconnecting within that time are validated without a
+// lookup.
+class PublicKeyRequester : public std::enable_shared_from_this<PublicKeyRequester> {
+ public:
+  // Keys cached at most.  Expired keys, then those expiring soonest, make way for new ones.
+  static const size_t kMaxCachedKeys = 1024;
+
+  // A lookup unanswered for response_timeout is retried by the next request for the same peer.
+  PublicKeyRequester(AsioService& asio_service,
+                     std::chrono::steady_clock::duration response_timeout);
+  ~PublicKeyRequester();
+  void set_request_public_key_functor(RequestPublicKeyFunctor request_public_key);
+  void set_request_public_keys_functor(RequestPublicKeysFunctor request_public_keys);
+  // True if either functor has been set.
+  bool enabled() const;
+  // Calls 'give_public_key' with the key for 'node_id', synchronously if it's cached.
+  void RequestPublicKey(const NodeId& node_id, GivePublicKeyFunctor give_public_key);
+
+ private:
+  struct CachedKey {
+    asymm::PublicKey public_key;
+    std::chrono::steady_clock::time_point expiry;
+  };
+  struct PendingRequest {
+    std::vector<GivePublicKeyFunctor> callbacks;
+    std::chrono::steady_clock::time_point requested;
+  };
+
+  PublicKeyRequester(const PublicKeyRequester&);
+  PublicKeyRequester(const PublicKeyRequester&&);
+  PublicKeyRequester& operator=(const PublicKeyRequester&);
+  void SendBatch();
+  void GiveKey(const NodeId& node_id, const asymm::PublicKey& public_key);
+  void CacheKey(const NodeId& node_id, const asymm::PublicKey& public_key);
+
+  const std::chrono::steady_clock::duration kResponseTimeout_;
+  mutable std::mutex mutex_;
+  RequestPublicKeyFunctor request_public_key_;
+  RequestPublicKeysFunctor request_public_keys_;
+  std::map<NodeId, PendingRequest> pending_;
+  std::vector<NodeId> batch_;
+  std::map<NodeId, CachedKey> cache_;
+  boost::asio::steady_timer batch_timer_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_PUBLIC_KEY_REQUESTER_H_
@@ -29,26 +29,40 @@ NodeId RandomNodeHelper::Get() const {
   assert(node_ids_.size() <= kMaxSize_);
   if (node_ids_.empty())
     return NodeId();
-  return node_ids_[(node_ids_.size() == kMaxSize_) ? 0 : (RandomUint32() % node_ids_.size())];
+  return node_ids_[RandomUint32() % node_ids_.size()];
 }
 
 void RandomNodeHelper::Add(const NodeId& node_id) {
   assert(!node_id.IsZero());
   std::lock_guard<std::mutex> lock(mutex_);
-  if (std::find(node_ids_.begin(), node_ids_.end(), node_id) != node_ids_.end())
+  if (indices_.count(node_id) != 0)
     return;
 
-  node_ids_.push_back(node_id);
-  if (node_ids_.size() > kMaxSize_)
-    node_ids_.erase(node_ids_.begin());
+  if (node_ids_.size() < kMaxSize_) {
+    indices_.insert(std::make_pair(node_id, node_ids_.size()));
+    node_ids_.push_back(node_id);
+    return;
+  }
+  next_replaced_ %= node_ids_.size();
+  indices_.erase(node_ids_[next_replaced_]);
+  indices_.insert(std::make_pair(node_id, next_replaced_));
+  node_ids_[next_replaced_++] = node_id;
 }
 
 void RandomNodeHelper::Remove(const NodeId& node_id) {
   assert(!node_id.IsZero());
   std::lock_guard<std::mutex> lock(mutex_);
-  auto itr(std::find(node_ids_.begin(), node_ids_.end(), node_id));
-  if (itr != node_ids_.end())
-    node_ids_.erase(itr);
+  auto itr(indices_.find(node_id));
+  if (itr == indices_.end())
+    return;
+  // The last ID fills the gap, so the held IDs stay contiguous.
+  const size_t kIndex(itr->second);
+  indices_.erase(itr);
+  if (kIndex != node_ids_.size() - 1) {
+    node_ids_[kIndex] = node_ids_.back();
+    indices_[node_ids_[kIndex]] = kIndex;
+  }
+  node_ids_.pop_back();
 }
 
 }  // namespace routing
@@ -20,17 +20,20 @@
 #define MAIDSAFE_ROUTING_RANDOM_NODE_HELPER_H_
 
 #include <mutex>
+#include <unordered_map>
 #include <vector>
 
 #include "maidsafe/common/node_id.h"
 
+#include "maidsafe/routing/node_id_hash.h"
+
 namespace maidsafe {
 
 namespace routing {
 
 class RandomNodeHelper {
  public:
-  RandomNodeHelper() : node_ids_(), mutex_(), kMaxSize_(100) {}
+  RandomNodeHelper() : node_ids_(), indices_(), next_replaced_(0), mutex_(), kMaxSize_(100) {}
   NodeId Get() const;
   void Add(const NodeId& node_id);
   void Remove(const NodeId& node_id);
@@ -40,7 +43,11 @@ class RandomNodeHelper {
   RandomNodeHelper(const RandomNodeHelper&&);
   RandomNodeHelper& operator=(const RandomNodeHelper&);
 
+  // Once full, each new ID replaces the one at next_replaced_, which cycles through the slots.
+  // indices_ maps each held ID to its slot, so every operation is constant time.
   std::vector<NodeId> node_ids_;
+  std::unordered_map<NodeId, size_t, NodeIdHash> indices_;
+  size_t next_replaced_;
   mutable std::mutex mutex_;
   const size_t kMaxSize_;
 };
@@ -0,0 +1,155 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/relay_links.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+// Weight given to each new sample, as for LinkQuality's round trip times.
+const int kSampleWeightDivisor(8);
+
+}  // unnamed namespace
+
+RelayLinks::RelayLinks(Clock::duration lifetime)
+    : kLifetime_(lifetime), mutex_(), requests_(), links_(), expiry_order_() {}
+
+NodeId RelayLinks::Choose(const std::vector<NodeId>& candidates) const {
+  if (candidates.empty())
+    return NodeId();
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto load([this](const NodeId& link) {
+    auto itr(links_.find(link));
+    return itr == links_.end() ? std::make_pair(size_t(0), std::chrono::microseconds())
+                               : std::make_pair(itr->second.in_flight, itr->second.smoothed_rtt);
+  });
+  auto best(std::begin(candidates));
+  auto best_load(load(*best));
+  for (auto itr(std::next(best)); itr != std::end(candidates); ++itr) {
+    auto candidate_load(load(*itr));
+    if (candidate_load < best_load) {
+      best = itr;
+      best_load = candidate_load;
+    }
+  }
+  return *best;
+}
+
+void RelayLinks::Sent(const NodeId& link, std::shared_ptr<const protobuf::Message> request) {
+  assert(request->has_id());
+  const auto kNow(Clock::now());
+  std::lock_guard<std::mutex> lock(mutex_);
+  Expire(kNow);
+  auto itr(requests_.find(request->id()));
+  if (itr != requests_.end())
+    Erase(itr);
+  Request& entry(requests_[request->id()]);
+  entry.link = link;
+  entry.sent = kNow;
+  entry.message = std::move(request);
+  ++links_[link].in_flight;
+  expiry_order_.emplace_back(kNow, entry.message->id());
+}
+
+void RelayLinks::Answered(int32_t request_id) {
+  const auto kNow(Clock::now());
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(requests_.find(request_id));
+  if (itr == requests_.end())
+    return;
+  std::chrono::microseconds sample(std::max(
+      std::chrono::duration_cast<std::chrono::microseconds>(kNow - itr->second.sent),
+      std::chrono::microseconds(1)));
+  Link& link(links_[itr->second.link]);
+  if (link.smoothed_rtt == std::chrono::microseconds())
+    link.smoothed_rtt = sample;
+  else
+    link.smoothed_rtt += (sample - link.smoothed_rtt) / kSampleWeightDivisor;
+  Erase(itr);
+}
+
+std::vector<RelayLinks::LostRequest> RelayLinks::Lost(const NodeId& link) {
+  std::vector<LostRequest> lost;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Expire(Clock::now());
+    for (auto itr(std::begin(requests_)); itr != std::end(requests_);) {
+      if (itr->second.link == link) {
+        LostRequest request;
+        request.sent = itr->second.sent;
+        request.message = std::move(itr->second.message);
+        lost.push_back(std::move(request));
+        itr = requests_.erase(itr);
+      } else {
+        ++itr;
+      }
+    }
+    links_.erase(link);
+  }
+  std::stable_sort(std::begin(lost), std::end(lost), [](const LostRequest& lhs,
+                                                        const LostRequest& rhs) {
+    return lhs.sent < rhs.sent;
+  });
+  return lost;
+}
+
+std::chrono::microseconds RelayLinks::SmoothedRtt(const NodeId& link) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(links_.find(link));
+  return itr == links_.end() ? std::chrono::microseconds() : itr->second.smoothed_rtt;
+}
+
+size_t RelayLinks::in_flight(const NodeId& link) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(links_.find(link));
+  return itr == links_.end() ? 0 : itr->second.in_flight;
+}
+
+size_t RelayLinks::in_flight() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return requests_.size();
+}
+
+void RelayLinks::Erase(Requests::iterator request) {
+  auto link(links_.find(request->second.link));
+  if (link != links_.end() && link->second.in_flight != 0)
+    --link->second.in_flight;
+  requests_.erase(request);
+}
+
+void RelayLinks::Expire(Clock::time_point now) {
+  while (!expiry_order_.empty() && expiry_order_.front().first + kLifetime_ <= now) {
+    auto itr(requests_.find(expiry_order_.front().second));
+    // A request resent since is left to its later entry.
+    if (itr != requests_.end() && itr->second.sent == expiry_order_.front().first)
+      Erase(itr);
+    expiry_order_.pop_front();
+  }
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
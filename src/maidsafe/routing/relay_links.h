@@ -0,0 +1,100 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_RELAY_LINKS_H_
+#define MAIDSAFE_ROUTING_RELAY_LINKS_H_
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace protobuf {
+class Message;
+}
+
+// The requests a client has in flight over each of its connections to the network, so that new
+// requests can be spread over those connections and those in flight resent over another at once
+// if one is lost.  Each connection's round trip time is smoothed from the requests answered on it.
+class RelayLinks {
+ public:
+  typedef std::chrono::steady_clock Clock;
+  struct LostRequest {
+    Clock::time_point sent;  // when last sent, so a resend can take its time off the time left
+    std::shared_ptr<const protobuf::Message> message;
+  };
+
+  // Requests left unanswered for |lifetime| are forgotten; timing them out is left to the Timer.
+  explicit RelayLinks(Clock::duration lifetime);
+  // Of |candidates|, the one with fewest requests in flight, then with the lowest smoothed round
+  // trip time, then the earliest.  Zero if candidates is empty.
+  NodeId Choose(const std::vector<NodeId>& candidates) const;
+  // Records |request|, which must have an ID, as sent on |link|.  Recording a request again, e.g.
+  // when it's resent, moves it to the new link.
+  void Sent(const NodeId& link, std::shared_ptr<const protobuf::Message> request);
+  // The first response to a request ends its tracking and is timed against its link.
+  void Answered(int32_t request_id);
+  // Forgets |link|, returning the requests still in flight on it, oldest first.
+  std::vector<LostRequest> Lost(const NodeId& link);
+  // Zero until a request sent on |link| has been answered.
+  std::chrono::microseconds SmoothedRtt(const NodeId& link) const;
+  size_t in_flight(const NodeId& link) const;
+  size_t in_flight() const;
+
+ private:
+  RelayLinks(const RelayLinks&);
+  RelayLinks& operator=(const RelayLinks&);
+
+  struct Request {
+    NodeId link;
+    Clock::time_point sent;
+    std::shared_ptr<const protobuf::Message> message;
+  };
+  struct Link {
+    Link() : in_flight(0), smoothed_rtt() {}
+    size_t in_flight;
+    std::chrono::microseconds smoothed_rtt;
+  };
+  typedef std::map<int32_t, Request> Requests;
+
+  void Erase(Requests::iterator request);
+  void Expire(Clock::time_point now);
+
+  const Clock::duration kLifetime_;
+  mutable std::mutex mutex_;
+  Requests requests_;
+  std::map<NodeId, Link> links_;
+  // In the order sent, which is also the order they expire in.  Entries may be stale.
+  std::deque<std::pair<Clock::time_point, int32_t>> expiry_order_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_RELAY_LINKS_H_
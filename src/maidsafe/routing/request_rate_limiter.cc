@@ -0,0 +1,111 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/request_rate_limiter.h"
+
+#include <algorithm>
+
+#include "maidsafe/routing/message_handler.h"
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+bool IsLimited(const protobuf::Message& message) {
+  if (!message.routing_message() || !message.request())
+    return false;
+  switch (static_cast<MessageType>(message.type())) {
+    case MessageType::kFindNodes:
+    case MessageType::kGetGroup:
+    case MessageType::kConnect:
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // unnamed namespace
+
+RequestRateLimiter::RequestRateLimiter(uint32_t rate, uint32_t burst, size_t max_buckets)
+    : kRate_(rate),
+      kBurst_(std::max(burst, 1U)),
+      kMaxBuckets_(std::max(max_buckets, static_cast<size_t>(1))),
+      mutex_(),
+      buckets_(),
+      refused_count_(0) {}
+
+bool RequestRateLimiter::TryAdmit(const protobuf::Message& message, Clock::time_point now) {
+  if (kRate_ == 0 || !IsLimited(message))
+    return true;
+  BucketId bucket_id(message.has_source_id() ? message.source_id() : message.relay_id(),
+                     message.type());
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto bucket(buckets_.find(bucket_id));
+  if (bucket == std::end(buckets_)) {
+    if (buckets_.size() >= kMaxBuckets_)
+      Evict(now);
+    bucket = buckets_.insert(std::make_pair(std::move(bucket_id), Bucket(kBurst_, now))).first;
+  } else {
+    Refill(bucket->second, now);
+  }
+  if (bucket->second.tokens < 1.0) {
+    ++refused_count_;
+    return false;
+  }
+  bucket->second.tokens -= 1.0;
+  return true;
+}
+
+uint64_t RequestRateLimiter::refused_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return refused_count_;
+}
+
+void RequestRateLimiter::Refill(Bucket& bucket, Clock::time_point now) const {
+  if (now <= bucket.refilled)
+    return;
+  const double kElapsed(std::chrono::duration<double>(now - bucket.refilled).count());
+  bucket.tokens = std::min(static_cast<double>(kBurst_), bucket.tokens + kElapsed * kRate_);
+  bucket.refilled = now;
+}
+
+void RequestRateLimiter::Evict(Clock::time_point now) {
+  // A full bucket is no different from none, so those go first.  Failing any, the one refilled
+  // longest ago does.
+  auto oldest(std::end(buckets_));
+  for (auto itr(std::begin(buckets_)); itr != std::end(buckets_);) {
+    Bucket refilled(itr->second);
+    Refill(refilled, now);
+    if (refilled.tokens >= kBurst_) {
+      itr = buckets_.erase(itr);
+      continue;
+    }
+    if (oldest == std::end(buckets_) || itr->second.refilled < oldest->second.refilled)
+      oldest = itr;
+    ++itr;
+  }
+  if (buckets_.size() >= kMaxBuckets_)
+    buckets_.erase(oldest);
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,79 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_REQUEST_RATE_LIMITER_H_
+#define MAIDSAFE_ROUTING_REQUEST_RATE_LIMITER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace protobuf {
+class Message;
+}
+
+// Token buckets bounding how often each source may send the routing requests which cost a node
+// the most to handle: FindNodes, GetGroup and Connect.  A request's source is its source ID or,
+// for a relayed request, its relay ID.  Each source has a bucket per request type, holding up to
+// kBurst_ tokens and refilled at kRate_ a second; a request finding its bucket empty is refused.
+// At most kMaxBuckets_ buckets are kept, those idle long enough to have refilled going first.
+class RequestRateLimiter {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  // A rate of zero admits everything.
+  RequestRateLimiter(uint32_t rate, uint32_t burst, size_t max_buckets);
+  // Returns false if the message should be dropped.  Other messages are always admitted.
+  bool TryAdmit(const protobuf::Message& message) { return TryAdmit(message, Clock::now()); }
+  bool TryAdmit(const protobuf::Message& message, Clock::time_point now);
+  uint64_t refused_count() const;
+
+ private:
+  typedef std::pair<std::string, int32_t> BucketId;  // source and message type
+  struct Bucket {
+    Bucket(double tokens_in, Clock::time_point refilled_in)
+        : tokens(tokens_in), refilled(refilled_in) {}
+    double tokens;
+    Clock::time_point refilled;
+  };
+
+  RequestRateLimiter(const RequestRateLimiter&);
+  RequestRateLimiter& operator=(const RequestRateLimiter&);
+  void Refill(Bucket& bucket, Clock::time_point now) const;
+  // Makes room for one more bucket.
+  void Evict(Clock::time_point now);
+
+  const uint32_t kRate_, kBurst_;
+  const size_t kMaxBuckets_;
+  mutable std::mutex mutex_;
+  std::map<BucketId, Bucket> buckets_;
+  uint64_t refused_count_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_REQUEST_RATE_LIMITER_H_
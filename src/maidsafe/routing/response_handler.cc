@@ -18,6 +18,7 @@
 
 #include "maidsafe/routing/response_handler.h"
 
+#include <map>
 #include <memory>
 #include <vector>
 #include <string>
@@ -51,25 +52,45 @@ typedef boost::asio::ip::udp::endpoint Endpoint;
   const int kMaxUnvalidatedUpdates(64);
 #endif
 
+// Exceeds any bucket's shortfall, so that close group candidates always go first.
+const uint32_t kCloseGroupConnectValue(1 << 16);
+
 }  // unnamed namespace
 
 ResponseHandler::ResponseHandler(RoutingTable& routing_table,
                                  ClientRoutingTable& client_routing_table, NetworkUtils& network,
-                                 GroupChangeHandler& group_change_handler)
+                                 GroupChangeHandler& group_change_handler,
+                                 const InstanceParameters& parameters)
     : mutex_(), routing_table_(routing_table), client_routing_table_(client_routing_table),
-      network_(network), group_change_handler_(group_change_handler), request_public_key_functor_(),
+      network_(network), group_change_handler_(group_change_handler),
+      kMaxRoutingTableSize_(parameters.max_routing_table_size),
+      kMaxRoutingTableSizeForClient_(parameters.max_routing_table_size_for_client),
+      public_key_requester_(std::make_shared<PublicKeyRequester>(
+          network.asio_service(), parameters.default_response_timeout)),
+      node_lookup_(),
+      connection_scheduler_(std::make_shared<ConnectionScheduler>(
+          network.asio_service(), routing_table.kNodeId(), Parameters::max_concurrent_connects,
+          Parameters::max_queued_connects, Parameters::connect_attempt_timeout)),
+      start_connect_functor_set_(),
       unvalidated_matrix_updates() {}
 
-ResponseHandler::~ResponseHandler() {}
+ResponseHandler::~ResponseHandler() {
+  connection_scheduler_->set_start_connect_functor(nullptr);
+}
 
 void ResponseHandler::Ping(protobuf::Message& message) {
   // Always direct, never pass on
 
-  // TODO(dirvine): do we need this and where and how can I update the response
   protobuf::PingResponse ping_response;
-  if (ping_response.ParseFromString(message.data(0))) {
-    // do stuff here
+  protobuf::PingRequest ping_request;
+  if (!ping_response.ParseFromString(message.data(0)) ||
+      !ping_request.ParseFromString(ping_response.original_request())) {
+    LOG(kError) << "Could not parse ping response";
+    return;
   }
+  if (ping_request.has_probe_stamp())
+    routing_table_.link_quality().ProbeAnswered(NodeId(message.source_id()),
+                                                ping_request.probe_stamp());
 }
 
 void ResponseHandler::Connect(protobuf::Message& message) {
@@ -86,27 +107,33 @@ void ResponseHandler::Connect(protobuf::Message& message) {
     return;
   }
 
+  // Unless rudp is now connecting, the handshake has ended here.
+  const NodeId kRequestedPeerId(connect_request.peer_id());
   if (connect_response.answer() == protobuf::ConnectResponseType::kRejected) {
     LOG(kInfo) << "Peer rejected this node's connection request."
                << " id: " << message.id();
+    connection_scheduler_->Completed(kRequestedPeerId);
     return;
   }
 
   if (connect_response.answer() == protobuf::ConnectResponseType::kConnectAttemptAlreadyRunning) {
     LOG(kInfo) << "Already ongoing connection attempt with : "
                << HexSubstr(connect_response.contact().node_id());
+    connection_scheduler_->Completed(kRequestedPeerId);
     return;
   }
 
   if (NodeId(connect_response.contact().node_id()).IsZero()) {
     LOG(kError) << "Invalid contact details";
+    connection_scheduler_->Completed(kRequestedPeerId);
     return;
   }
 
   NodeInfo node_to_add;
   node_to_add.node_id = NodeId(connect_response.contact().node_id());
   if (routing_table_.CheckNode(node_to_add) ||
-      (node_to_add.node_id == network_.bootstrap_connection_id())) {
+      (node_to_add.node_id == network_.bootstrap_connection_id()) ||
+      (connect_request.shortcut() && network_.shortcuts().IsExpected(node_to_add.node_id))) {
     rudp::EndpointPair peer_endpoint_pair;
     peer_endpoint_pair.external =
         GetEndpointFromProtobuf(connect_response.contact().public_endpoint());
@@ -116,6 +143,7 @@ void ResponseHandler::Connect(protobuf::Message& message) {
     if (peer_endpoint_pair.external.address().is_unspecified() &&
         peer_endpoint_pair.local.address().is_unspecified()) {
       LOG(kError) << "Invalid peer endpoint details";
+      connection_scheduler_->Completed(kRequestedPeerId);
       return;
     }
 
@@ -140,9 +168,12 @@ void ResponseHandler::Connect(protobuf::Message& message) {
             close_ids, routing_table_.client_mode()));
         network_.SendToDirect(connect_success_ack, peer_node_id, peer_connection_id);
       }
+    } else {
+      connection_scheduler_->Completed(kRequestedPeerId);
     }
   } else {
     LOG(kVerbose) << "Already added node";
+    connection_scheduler_->Completed(kRequestedPeerId);
   }
 }
 
@@ -183,16 +214,74 @@ void ResponseHandler::FindNodes(const protobuf::Message& message) {
 
   LOG(kVerbose) << find_node_result;
 
+  // An extended response gives each node's NAT type, so nodes this one can't reach aren't asked to
+  // connect, and the public keys of those which are asked are looked up straight away, alongside
+  // the connection attempts, rather than each only once its connection has been made.
+  std::map<std::string, protobuf::NatType> nat_types;
+  for (const auto& contact : find_nodes_response.contacts())
+    nat_types[contact.node_id()] = contact.nat_type();
+  bool symmetric(network_.nat_type() == rudp::NatType::kSymmetric);
+  bool prefetch_keys(!nat_types.empty() && public_key_requester_->enabled());
+
+  std::vector<NodeId> nodes;
   for (int i = 0; i < find_nodes_response.nodes_size(); ++i) {
-    if (!find_nodes_response.nodes(i).empty())
-      CheckAndSendConnectRequest(NodeId(find_nodes_response.nodes(i)));
+    if (!find_nodes_response.nodes(i).empty()) {
+      nodes.push_back(NodeId(find_nodes_response.nodes(i)));
+      auto nat_type(nat_types.find(find_nodes_response.nodes(i)));
+      if (symmetric && nat_type != std::end(nat_types) &&
+          nat_type->second == protobuf::NatType::kSymmetric) {
+        LOG(kVerbose) << "Not connecting to " << DebugId(nodes.back())
+                      << ", as both nodes are behind symmetric NATs";
+        continue;
+      }
+      if (CheckAndSendConnectRequest(nodes.back()) && prefetch_keys)
+        public_key_requester_->RequestPublicKey(nodes.back(), [](asymm::PublicKey) {});
+    }
+  }
+
+  std::shared_ptr<NodeLookup> node_lookup;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    node_lookup = node_lookup_;
   }
+  if (node_lookup && NodeId(find_nodes_request.target_node()) == routing_table_.kNodeId() &&
+      message.has_source_id())
+    node_lookup->AddResponse(NodeId(message.source_id()), nodes);
+}
+
+void ResponseHandler::StartNodeLookup() {
+  std::weak_ptr<ResponseHandler> response_handler_weak_ptr(shared_from_this());
+  auto node_lookup(std::make_shared<NodeLookup>(
+      network_.asio_service(), routing_table_.kNodeId(),
+      [response_handler_weak_ptr](const NodeId& peer_id) {
+        if (std::shared_ptr<ResponseHandler> response_handler = response_handler_weak_ptr.lock())
+          response_handler->SendFindNodesRequest(peer_id);
+      }));
+  std::lock_guard<std::mutex> lock(mutex_);
+  node_lookup_ = node_lookup;
 }
 
-void ResponseHandler::SendConnectRequest(const NodeId peer_node_id) {
+void ResponseHandler::SendFindNodesRequest(const NodeId& peer_id) {
+  // Until this node is in some routing table, requests go by way of its bootstrap connection.
+  bool relay_message(routing_table_.size() == 0);
+  if (relay_message && network_.bootstrap_connection_id().IsZero())
+    return;
+  protobuf::Message find_nodes_rpc(rpcs::FindNodes(
+      routing_table_.kNodeId(), routing_table_.kNodeId(), Parameters::closest_nodes_size,
+      relay_message, network_.this_node_relay_connection_id(), true));
+  find_nodes_rpc.set_destination_id(peer_id.string());
+  find_nodes_rpc.set_direct(true);
+  if (relay_message)
+    network_.SendToDirect(find_nodes_rpc, network_.bootstrap_connection_id(),
+                          rudp::MessageSentFunctor());
+  else
+    network_.SendToClosestNode(find_nodes_rpc);
+}
+
+bool ResponseHandler::SendConnectRequest(const NodeId peer_node_id, bool shortcut) {
   if (network_.bootstrap_connection_id().IsZero() && (routing_table_.size() == 0)) {
     LOG(kWarning) << "Need to re bootstrap !";
-    return;
+    return false;
   }
   bool send_to_bootstrap_connection((routing_table_.size() < Parameters::closest_nodes_size) &&
                                     !network_.bootstrap_connection_id().IsZero());
@@ -201,10 +290,10 @@ void ResponseHandler::SendConnectRequest(const NodeId peer_node_id) {
 
   if (peer.node_id == NodeId(routing_table_.kNodeId())) {
     //    LOG(kInfo) << "Can't send connect request to self !";
-    return;
+    return false;
   }
 
-  if (routing_table_.CheckNode(peer)) {
+  if (shortcut || routing_table_.CheckNode(peer)) {
     LOG(kVerbose) << "CheckNode succeeded for node " << DebugId(peer.node_id);
     rudp::EndpointPair this_endpoint_pair, peer_endpoint_pair;
     rudp::NatType this_nat_type(rudp::NatType::kUnknown);
@@ -222,7 +311,7 @@ void ResponseHandler::SendConnectRequest(const NodeId peer_node_id) {
       } else {
         LOG(kVerbose) << "Already ongoing attempt to : " << DebugId(peer.node_id);
       }
-      return;
+      return false;
     }
     assert((!this_endpoint_pair.external.address().is_unspecified() ||
             !this_endpoint_pair.local.address().is_unspecified()) &&
@@ -236,7 +325,8 @@ void ResponseHandler::SendConnectRequest(const NodeId peer_node_id) {
     }
     protobuf::Message connect_rpc(rpcs::Connect(
         peer.node_id, this_endpoint_pair, routing_table_.kNodeId(), routing_table_.kConnectionId(),
-        routing_table_.client_mode(), this_nat_type, relay_message, relay_connection_id));
+        routing_table_.client_mode(), this_nat_type, relay_message, relay_connection_id,
+        shortcut));
     LOG(kVerbose) << "Sending Connect RPC to " << DebugId(peer.node_id)
                   << " message id : " << connect_rpc.id();
     if (send_to_bootstrap_connection)
@@ -244,7 +334,9 @@ void ResponseHandler::SendConnectRequest(const NodeId peer_node_id) {
                             network_.bootstrap_connection_id());
     else
       network_.SendToClosestNode(connect_rpc);
+    return true;
   }
+  return false;
 }
 
 void ResponseHandler::ConnectSuccessAcknowledgement(protobuf::Message& message) {
@@ -292,18 +384,21 @@ void ResponseHandler::ValidateAndCompleteConnectionToClient(const NodeInfo& peer
                                                             const std::vector<NodeId>& close_ids) {
   if (ValidateAndAddToRoutingTable(network_, routing_table_, client_routing_table_, peer.node_id,
                                    peer.connection_id, asymm::PublicKey(), true)) {
+    connection_scheduler_->Completed(peer.node_id);
     if (from_requestor) {
       HandleSuccessAcknowledgementAsReponder(peer, true);
     } else {
       HandleSuccessAcknowledgementAsRequestor(close_ids);
     }
+  } else {
+    connection_scheduler_->Completed(peer.node_id);
   }
 }
 
 void ResponseHandler::ValidateAndCompleteConnectionToNonClient(
     const NodeInfo& peer, bool from_requestor, const std::vector<NodeId>& close_ids) {
   std::weak_ptr<ResponseHandler> response_handler_weak_ptr = shared_from_this();
-  if (request_public_key_functor_) {
+  if (public_key_requester_->enabled()) {
     auto validate_node([=](const asymm::PublicKey& key) {
       LOG(kInfo) << "Validation callback called with public key for " << DebugId(peer.node_id);
       if (std::shared_ptr<ResponseHandler> response_handler = response_handler_weak_ptr.lock()) {
@@ -320,10 +415,13 @@ void ResponseHandler::ValidateAndCompleteConnectionToNonClient(
             unvalidated_matrix_updates.erase(matrix_update_itr);
           }
         }
-        if (ValidateAndAddToRoutingTable(response_handler->network_,
-                                         response_handler->routing_table_,
-                                         response_handler->client_routing_table_, peer.node_id,
-                                         peer.connection_id, key, false, matrix_update)) {
+        bool added(ValidateAndAddToRoutingTable(response_handler->network_,
+                                                response_handler->routing_table_,
+                                                response_handler->client_routing_table_,
+                                                peer.node_id, peer.connection_id, key, false,
+                                                matrix_update));
+        response_handler->connection_scheduler_->Completed(peer.node_id);
+        if (added) {
           if (from_requestor) {
             response_handler->HandleSuccessAcknowledgementAsReponder(peer, false);
           } else {
@@ -332,13 +430,12 @@ void ResponseHandler::ValidateAndCompleteConnectionToNonClient(
         }
       }
     });
-    request_public_key_functor_(peer.node_id, validate_node);
+    public_key_requester_->RequestPublicKey(peer.node_id, validate_node);
   }
 }
 
 void ResponseHandler::HandleSuccessAcknowledgementAsReponder(NodeInfo peer, bool client) {
-  auto count =
-      (client ? Parameters::max_routing_table_size_for_client : Parameters::max_routing_table_size);
+  auto count = (client ? kMaxRoutingTableSizeForClient_ : kMaxRoutingTableSize_);
   std::vector<NodeId> close_ids_for_peer(routing_table_.GetClosestNodes(peer.node_id, count));
   auto itr(std::find_if(close_ids_for_peer.begin(), close_ids_for_peer.end(),
                         [=](const NodeId & node_id)->bool {
@@ -363,16 +460,67 @@ void ResponseHandler::HandleSuccessAcknowledgementAsRequestor(
   }
 }
 
-void ResponseHandler::CheckAndSendConnectRequest(const NodeId& node_id) {
-  uint16_t limit(routing_table_.client_mode() ? Parameters::max_routing_table_size_for_client
-                                              : Parameters::greedy_fraction);
+bool ResponseHandler::CheckAndSendConnectRequest(const NodeId& node_id) {
+  uint16_t limit(routing_table_.client_mode() ? kMaxRoutingTableSizeForClient_
+                                              : routing_table_.kGreedySize());
   if ((routing_table_.size() < limit) ||
       NodeId::CloserToTarget(
           node_id, routing_table_.GetNthClosestNode(routing_table_.kNodeId(), limit).node_id,
-          routing_table_.kNodeId()))
-    SendConnectRequest(node_id);
+          routing_table_.kNodeId())) {
+    SetStartConnectFunctor();
+    return connection_scheduler_->Add(node_id, ConnectValue(node_id));
+  }
+  return false;
 }
 
+bool ResponseHandler::SendShortcutConnectRequest(const NodeId& node_id) {
+  NodeInfo peer;
+  peer.node_id = node_id;
+  if (routing_table_.Contains(node_id) || network_.shortcuts().Contains(node_id))
+    return false;
+  if (routing_table_.CheckNode(peer))
+    return CheckAndSendConnectRequest(node_id);
+  if (routing_table_.size() < Parameters::closest_nodes_size ||
+      !network_.shortcuts().Expect(node_id))
+    return false;
+  LOG(kVerbose) << "Asking for a shortcut to " << DebugId(node_id);
+  // Queued behind any routing table candidates, which matter more, rather than started at once.
+  SetStartConnectFunctor();
+  return connection_scheduler_->Add(node_id, 0);
+}
+
+void ResponseHandler::SetStartConnectFunctor() {
+  std::call_once(start_connect_functor_set_, [this] {
+    // The scheduler starts connects from its own timer, which may fire after this handler is gone.
+    std::weak_ptr<ResponseHandler> response_handler_weak_ptr(shared_from_this());
+    connection_scheduler_->set_start_connect_functor(
+        [response_handler_weak_ptr](const NodeId& peer_id) {
+          std::shared_ptr<ResponseHandler> response_handler(response_handler_weak_ptr.lock());
+          if (!response_handler)
+            return false;
+          // Still a shortcut only if it hasn't been forgotten while queued.
+          return response_handler->SendConnectRequest(
+              peer_id, response_handler->network_.shortcuts().IsExpected(peer_id));
+        });
+  });
+}
+
+uint32_t ResponseHandler::ConnectValue(const NodeId& peer_id) {
+  uint32_t value(0);
+  if ((routing_table_.size() < Parameters::closest_nodes_size) ||
+      NodeId::CloserToTarget(peer_id, routing_table_.close_boundaries()->furthest_close_node,
+                             routing_table_.kNodeId()))
+    value += kCloseGroupConnectValue;
+  size_t bucket_size(routing_table_.BucketSize(peer_id));
+  if (bucket_size < routing_table_.kBucketTargetSize())
+    value += static_cast<uint32_t>(routing_table_.kBucketTargetSize() - bucket_size);
+  return value;
+}
+
+size_t ResponseHandler::queued_connects() const { return connection_scheduler_->queued(); }
+
+size_t ResponseHandler::connects_in_flight() const { return connection_scheduler_->in_flight(); }
+
 void ResponseHandler::CloseNodeUpdateForClient(protobuf::Message& message) {
   assert(routing_table_.client_mode());
   if (message.destination_id() != routing_table_.kNodeId().string()) {
@@ -433,11 +581,12 @@ void ResponseHandler::GetGroup(Timer<std::string>& timer, protobuf::Message& mes
 }
 
 void ResponseHandler::set_request_public_key_functor(RequestPublicKeyFunctor request_public_key) {
-  request_public_key_functor_ = request_public_key;
+  public_key_requester_->set_request_public_key_functor(request_public_key);
 }
 
-RequestPublicKeyFunctor ResponseHandler::request_public_key_functor() const {
-  return request_public_key_functor_;
+void ResponseHandler::set_request_public_keys_functor(
+    RequestPublicKeysFunctor request_public_keys) {
+  public_key_requester_->set_request_public_keys_functor(request_public_keys);
 }
 
 }  // namespace routing
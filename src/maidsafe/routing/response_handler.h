@@ -19,6 +19,7 @@
 #ifndef MAIDSAFE_ROUTING_RESPONSE_HANDLER_H_
 #define MAIDSAFE_ROUTING_RESPONSE_HANDLER_H_
 
+#include <memory>
 #include <mutex>
 #include <string>
 #include <vector>
@@ -32,6 +33,10 @@
 #include "maidsafe/rudp/managed_connections.h"
 
 #include "maidsafe/routing/api_config.h"
+#include "maidsafe/routing/connection_scheduler.h"
+#include "maidsafe/routing/node_lookup.h"
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/public_key_requester.h"
 #include "maidsafe/routing/timer.h"
 
 namespace maidsafe {
@@ -54,24 +59,45 @@ class GroupChangeHandler;
 class ResponseHandler : public std::enable_shared_from_this<ResponseHandler> {
  public:
   ResponseHandler(RoutingTable& routing_table, ClientRoutingTable& client_routing_table,
-                  NetworkUtils& network, GroupChangeHandler& group_change_handler);
+                  NetworkUtils& network, GroupChangeHandler& group_change_handler,
+                  const InstanceParameters& parameters = InstanceParameters());
   virtual ~ResponseHandler();
   virtual void Ping(protobuf::Message& message);
   virtual void Connect(protobuf::Message& message);
   virtual void FindNodes(const protobuf::Message& message);
   virtual void ConnectSuccessAcknowledgement(protobuf::Message& message);
   void set_request_public_key_functor(RequestPublicKeyFunctor request_public_key);
-  RequestPublicKeyFunctor request_public_key_functor() const;
+  void set_request_public_keys_functor(RequestPublicKeysFunctor request_public_keys);
   void GetGroup(Timer<std::string>& timer, protobuf::Message& message);
   void CloseNodeUpdateForClient(protobuf::Message& message);
   void AddMatrixUpdateFromUnvalidatedPeer(const NodeId& node_id,
                                           const std::vector<NodeInfo>& matrix_update);
+  // Returns true if a Connect request was sent, or queued to be sent once fewer handshakes are
+  // running (see ConnectionScheduler).
+  bool CheckAndSendConnectRequest(const NodeId& node_id);
+  // Asks for a connection to |node_id| as a shortcut (see ShortcutTable), or as a routing table
+  // peer if the routing table would take it.  Either way the request goes through the
+  // ConnectionScheduler, a shortcut with the lowest value.  Returns true if it was sent or queued.
+  bool SendShortcutConnectRequest(const NodeId& node_id);
+  // Peers waiting to be sent a Connect request, and handshakes not yet completed.
+  size_t queued_connects() const;
+  size_t connects_in_flight() const;
+  // Starts a lookup of the nodes closest to this node, in place of any lookup still running.  Its
+  // requests are sent as FindNodes responses arrive.
+  void StartNodeLookup();
 
   friend class test::ResponseHandlerTest_BEH_ConnectAttempts_Test;
 
  private:
-  void SendConnectRequest(const NodeId peer_node_id);
-  void CheckAndSendConnectRequest(const NodeId& node_id);
+  // A |shortcut| request is sent whether the routing table would take the peer or not.
+  bool SendConnectRequest(const NodeId peer_node_id, bool shortcut = false);
+  // Peers which would join the close group come before all others; after that, peers in the
+  // emptiest buckets come first.
+  uint32_t ConnectValue(const NodeId& peer_id);
+  // Gives connection_scheduler_ a functor holding this handler weakly.  Done on first use, as
+  // shared_from_this can't be called during construction.
+  void SetStartConnectFunctor();
+  void SendFindNodesRequest(const NodeId& peer_id);
   void HandleSuccessAcknowledgementAsRequestor(const std::vector<NodeId>& close_ids);
   void HandleSuccessAcknowledgementAsReponder(NodeInfo peer, bool client);
   void ValidateAndCompleteConnectionToClient(const NodeInfo& peer, bool from_requestor,
@@ -84,7 +110,11 @@ class ResponseHandler : public std::enable_shared_from_this<ResponseHandler> {
   ClientRoutingTable& client_routing_table_;
   NetworkUtils& network_;
   GroupChangeHandler& group_change_handler_;
-  RequestPublicKeyFunctor request_public_key_functor_;
+  const uint16_t kMaxRoutingTableSize_, kMaxRoutingTableSizeForClient_;
+  std::shared_ptr<PublicKeyRequester> public_key_requester_;
+  std::shared_ptr<NodeLookup> node_lookup_;
+  std::shared_ptr<ConnectionScheduler> connection_scheduler_;
+  std::once_flag start_connect_functor_set_;
   std::deque<std::pair<NodeId, std::vector<NodeInfo>>> unvalidated_matrix_updates;
 };
 
@@ -0,0 +1,101 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/route_history.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+const size_t RouteHistory::kCapacity;
+
+uint64_t RouteHistory::Prefix(const NodeId& node_id) {
+  const std::string& id(node_id.string());
+  uint64_t prefix(0);
+  for (size_t index(0); index != sizeof(prefix) && index != id.size(); ++index)
+    prefix = (prefix << 8) | static_cast<unsigned char>(id[index]);
+  return prefix;
+}
+
+RouteHistory::RouteHistory() : prefixes_(), size_(0), summary_(0) {}
+
+RouteHistory::RouteHistory(const protobuf::Message& message, const NodeId& this_node_id,
+                           bool include_last)
+    : prefixes_(), size_(0), summary_(0) {
+  const int kSize(message.route_history_size());
+  if (kSize == 1) {
+    if (message.route_history(0) != Prefix(this_node_id))
+      AddPrefix(message.route_history(0));
+    return;
+  }
+  for (int index(0); index < kSize - (include_last ? 0 : 1); ++index)
+    AddPrefix(message.route_history(index));
+}
+
+void RouteHistory::Add(const NodeId& node_id) { AddPrefix(Prefix(node_id)); }
+
+void RouteHistory::AddPrefix(uint64_t prefix) {
+  if (size_ == kCapacity)
+    return;
+  prefixes_[size_++] = prefix;
+  summary_ |= (1ULL << (prefix % 64));
+}
+
+bool RouteHistory::Contains(const NodeId& node_id) const {
+  const uint64_t kPrefix(Prefix(node_id));
+  if ((summary_ & (1ULL << (kPrefix % 64))) == 0)
+    return false;
+  return std::find(prefixes_.begin(), prefixes_.begin() + size_, kPrefix) !=
+         prefixes_.begin() + size_;
+}
+
+bool RouteHistory::HasCloserThan(const NodeId& node_id, const NodeId& target) const {
+  const uint64_t kTarget(Prefix(target));
+  const uint64_t kDistance(Prefix(node_id) ^ kTarget);
+  // Distances tied over the leading 64 bits are taken as not closer.
+  return std::any_of(prefixes_.begin(), prefixes_.begin() + size_, [&](uint64_t prefix) {
+    return prefix != kTarget && (prefix ^ kTarget) < kDistance;
+  });
+}
+
+std::string RouteHistory::DebugString() const {
+  std::ostringstream stream;
+  stream << std::hex << std::setfill('0');
+  for (size_t index(0); index != size_; ++index)
+    stream << (index == 0 ? "" : ", ") << std::setw(16) << prefixes_[index];
+  return stream.str();
+}
+
+bool IsExcluded(const std::vector<std::string>& exclude, const NodeId& node_id) {
+  return std::find(exclude.begin(), exclude.end(), node_id.string()) != exclude.end();
+}
+
+bool HasPassedThrough(const protobuf::Message& message, const NodeId& node_id) {
+  return std::find(message.route_history().begin(), message.route_history().end(),
+                   RouteHistory::Prefix(node_id)) != message.route_history().end();
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
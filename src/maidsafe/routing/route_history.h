@@ -0,0 +1,84 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_ROUTE_HISTORY_H_
+#define MAIDSAFE_ROUTING_ROUTE_HISTORY_H_
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace protobuf {
+class Message;
+}
+
+// Nodes a message has recently passed through, as carried in its route_history field: the leading
+// 64 bits of each node's ID.  Prefixes of random IDs are unique in practice, and keep message
+// headers small.  Entries are held in a fixed-size array behind a one-word summary, so building a
+// RouteHistory doesn't allocate and most membership tests are a single mask.
+class RouteHistory {
+ public:
+  // Parameters::max_route_history is capped at this.
+  static const size_t kCapacity = 16;
+
+  static uint64_t Prefix(const NodeId& node_id);
+
+  RouteHistory();
+  // The entries of message's route history, except for the last (the previous hop) unless
+  // include_last is set.  A sole entry is included unless it is this node's.
+  RouteHistory(const protobuf::Message& message, const NodeId& this_node_id, bool include_last);
+
+  // Has no effect when full.
+  void Add(const NodeId& node_id);
+  bool Contains(const NodeId& node_id) const;
+  // Returns true if an entry other than target's own is closer to target than node_id.
+  bool HasCloserThan(const NodeId& node_id, const NodeId& target) const;
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  std::string DebugString() const;
+
+ private:
+  void AddPrefix(uint64_t prefix);
+
+  std::array<uint64_t, kCapacity> prefixes_;
+  size_t size_;
+  uint64_t summary_;  // bit (prefix % 64) is set for each entry
+};
+
+inline bool IsExcluded(const RouteHistory& exclude, const NodeId& node_id) {
+  return exclude.Contains(node_id);
+}
+
+bool IsExcluded(const std::vector<std::string>& exclude, const NodeId& node_id);
+
+// True if node_id is among the hops in message's route history, i.e. the message has already
+// passed through that node.
+bool HasPassedThrough(const protobuf::Message& message, const NodeId& node_id);
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_ROUTE_HISTORY_H_
@@ -17,7 +17,16 @@
     use of the MaidSafe Software.                                                                 */
 
 #include "maidsafe/routing/routing_api.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/error.h"
+
 #include "maidsafe/routing/routing_impl.h"
+#include "maidsafe/routing/thread_placement.h"
 
 namespace maidsafe {
 
@@ -28,13 +37,38 @@ typedef boost::asio::ip::udp::endpoint Endpoint;
 }
 
 template <>
-Routing::Routing(const NodeId& node_id)
+Routing::Routing(const NodeId& node_id, uint16_t thread_count,
+                 const InstanceParameters& parameters)
+    : pimpl_() {
+  InitialisePimpl(true, node_id, asymm::GenerateKeyPair(), thread_count, parameters);
+}
+
+template <>
+Routing::Routing(const NodeId& node_id, std::shared_ptr<AsioService> asio_service,
+                 const InstanceParameters& parameters)
     : pimpl_() {
-  InitialisePimpl(true, node_id, asymm::GenerateKeyPair());
+  InitialisePimpl(true, node_id, asymm::GenerateKeyPair(), std::move(asio_service), parameters);
 }
 
-void Routing::InitialisePimpl(bool client_mode, const NodeId& node_id, const asymm::Keys& keys) {
-  pimpl_.reset(new Impl(client_mode, node_id, keys));
+void Routing::InitialisePimpl(bool client_mode, const NodeId& node_id, const asymm::Keys& keys,
+                              uint16_t thread_count, const InstanceParameters& parameters) {
+  const uint16_t kThreadCount(std::max(thread_count, static_cast<uint16_t>(1)));
+  auto asio_service(std::make_shared<AsioService>(kThreadCount));
+  PinAsioThreads(*asio_service, kThreadCount, parameters.worker_cpus);
+  // The upcall and signature threads carry on from the CPU after these threads'.
+  InstanceParameters impl_parameters(parameters);
+  impl_parameters.worker_cpus = CpusAfter(parameters.worker_cpus, kThreadCount);
+  InitialisePimpl(client_mode, node_id, keys, std::move(asio_service), impl_parameters);
+}
+
+void Routing::InitialisePimpl(bool client_mode, const NodeId& node_id, const asymm::Keys& keys,
+                              std::shared_ptr<AsioService> asio_service,
+                              const InstanceParameters& parameters) {
+  if (!asio_service)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  const auto kStart(std::chrono::steady_clock::now());
+  pimpl_.reset(new Impl(client_mode, node_id, keys, std::move(asio_service), parameters));
+  pimpl_->ConstructionTimed(std::chrono::steady_clock::now() - kStart);
 }
 
 void Routing::Join(Functors functors, std::vector<Endpoint> peer_endpoints) {
@@ -72,17 +106,61 @@ void Routing::Send(const GroupToSingleRelayMessage& message) {
   pimpl_->Send(message);
 }
 
+void Routing::Send(SingleToSingleMessage&& message) {
+  pimpl_->Send(std::move(message));
+}
+
+void Routing::Send(SingleToGroupMessage&& message) {
+  pimpl_->Send(std::move(message));
+}
+
+void Routing::Send(GroupToSingleMessage&& message) {
+  pimpl_->Send(std::move(message));
+}
+
+void Routing::Send(GroupToGroupMessage&& message) {
+  pimpl_->Send(std::move(message));
+}
+
+void Routing::Send(GroupToSingleRelayMessage&& message) {
+  pimpl_->Send(std::move(message));
+}
+
+void Routing::Send(SingleToSingleMessage&& message, uint16_t path_count) {
+  pimpl_->Send(std::move(message), path_count);
+}
+
 
 void Routing::SendDirect(const NodeId& destination_id, const std::string& message,
                          bool cacheable, ResponseFunctor response_functor) {
   return pimpl_->SendDirect(destination_id, message, cacheable, response_functor);
 }
 
+void Routing::SendDirect(const NodeId& destination_id, const std::string& message,
+                         bool cacheable, ResponseFunctor response_functor, uint16_t path_count) {
+  return pimpl_->SendDirect(destination_id, message, cacheable, response_functor, path_count);
+}
+
+PendingResponse Routing::SendDirect(const NodeId& destination_id, const std::string& message,
+                                    bool cacheable) {
+  return pimpl_->SendDirect(destination_id, message, cacheable);
+}
+
+void Routing::SendStream(const NodeId& destination_id, std::string message,
+                         ResponseFunctor response_functor) {
+  return pimpl_->SendStream(destination_id, std::move(message), response_functor);
+}
+
 void Routing::SendGroup(const NodeId& destination_id, const std::string& message,
                         bool cacheable, ResponseFunctor response_functor) {
   return pimpl_->SendGroup(destination_id, message, cacheable, response_functor);
 }
 
+GroupResponses Routing::SendGroup(const NodeId& destination_id, const std::string& message,
+                                  bool cacheable) {
+  return pimpl_->SendGroup(destination_id, message, cacheable);
+}
+
 bool Routing::ClosestToId(const NodeId& target_id) { return pimpl_->ClosestToId(target_id); }
 
 GroupRangeStatus Routing::IsNodeIdInGroupRange(const NodeId& group_id) const {
@@ -94,6 +172,11 @@ GroupRangeStatus Routing::IsNodeIdInGroupRange(const NodeId& group_id,
   return pimpl_->IsNodeIdInGroupRange(group_id, node_id);
 }
 
+void Routing::IsNodeIdInGroupRange(const std::vector<NodeId>& group_ids,
+                                   std::vector<GroupRangeStatus>& results) const {
+  pimpl_->IsNodeIdInGroupRange(group_ids, results);
+}
+
 NodeId Routing::RandomConnectedNode() { return pimpl_->RandomConnectedNode(); }
 
 bool Routing::EstimateInGroup(const NodeId& sender_id, const NodeId& info_id) const {
@@ -104,12 +187,58 @@ std::future<std::vector<NodeId>> Routing::GetGroup(const NodeId& group_id) {
   return pimpl_->GetGroup(group_id);
 }
 
+std::future<std::vector<std::vector<NodeId>>> Routing::GetGroups(
+    const std::vector<NodeId>& group_ids) {
+  return pimpl_->GetGroups(group_ids);
+}
+
 NodeId Routing::kNodeId() const { return pimpl_->kNodeId(); }
 
 int Routing::network_status() { return pimpl_->network_status(); }
 
+uint64_t Routing::dropped_message_count() const { return pimpl_->dropped_message_count(); }
+
+std::vector<LatencyHistogram> Routing::latency_histograms() const {
+  return pimpl_->latency_histograms();
+}
+
+MetricsSnapshot Routing::GetMetricsSnapshot() const { return pimpl_->GetMetricsSnapshot(); }
+
+bool Routing::UseBootstrapCache(const boost::filesystem::path& path) {
+  return pimpl_->UseBootstrapCache(path);
+}
+
+bool Routing::UseRoutingSnapshot(const boost::filesystem::path& path) {
+  return pimpl_->UseRoutingSnapshot(path);
+}
+
+void Routing::UseNetworkManifest(const std::vector<NodeId>& node_ids) {
+  pimpl_->UseNetworkManifest(node_ids);
+}
+
+bool Routing::CaptureMessages(const boost::filesystem::path& path, uint32_t sample_interval) {
+  return pimpl_->CaptureMessages(path, sample_interval);
+}
+
+CacheStatistics Routing::cache_statistics() const { return pimpl_->cache_statistics(); }
+
+RecoveryIntervals Routing::recovery_intervals() const { return pimpl_->recovery_intervals(); }
+
+uint32_t Routing::EstimatedCacheGetCount(const NodeId& destination_id,
+                                         const std::string& request_data) const {
+  return pimpl_->EstimatedCacheGetCount(destination_id, request_data);
+}
+
+std::shared_ptr<MatrixChange> Routing::MatrixChangeSince(uint64_t epoch) const {
+  return pimpl_->MatrixChangeSince(epoch);
+}
+
 std::vector<NodeInfo> Routing::ClosestNodes() { return pimpl_->ClosestNodes(); }
 
+std::shared_ptr<const MatrixNodes> Routing::ClosestNodesSnapshot() const {
+  return pimpl_->ClosestNodesSnapshot();
+}
+
 bool Routing::IsConnectedVault(const NodeId& node_id) { return pimpl_->IsConnectedVault(node_id); }
 
 bool Routing::IsConnectedClient(const NodeId& node_id) {
@@ -18,7 +18,13 @@
 
 #include "maidsafe/routing/routing_impl.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <type_traits>
 
 #include "maidsafe/common/log.h"
@@ -30,10 +36,14 @@
 
 #include "maidsafe/routing/bootstrap_file_handler.h"
 #include "maidsafe/routing/message.h"
+#include "maidsafe/routing/message_bundler.h"
 #include "maidsafe/routing/message_handler.h"
+#include "maidsafe/routing/message_trace.h"
+#include "maidsafe/routing/message_stream.h"
 #include "maidsafe/routing/node_info.h"
 #include "maidsafe/routing/return_codes.h"
 #include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/routing_log.h"
 #include "maidsafe/routing/rpcs.h"
 #include "maidsafe/routing/utils.h"
 #include "maidsafe/routing/network_statistics.h"
@@ -48,12 +58,34 @@ namespace {
 
 typedef boost::asio::ip::udp::endpoint Endpoint;
 
+// Responses awaited for a node level group message.
+const int kGroupResponseCount(4);
+
+// Routing control traffic and responses to our own requests keep being admitted after requests
+// from others start to be shed.
+bool IsHighPriority(const protobuf::Message& message) {
+  if (IsResponse(message))
+    return true;
+  if (!IsRoutingMessage(message))
+    return false;
+  switch (static_cast<MessageType>(message.type())) {
+    case MessageType::kConnect:
+    case MessageType::kConnectSuccess:
+    case MessageType::kConnectSuccessAcknowledgement:
+    case MessageType::kRemove:
+    case MessageType::kClosestNodesUpdate:
+      return true;
+    default:
+      return false;
+  }
+}
+
 }  // unnamed namespace
 
 namespace detail {}  // namespace detail
 
 template <>
-void Routing::Impl::Send(const GroupToSingleRelayMessage& message) {
+void Routing::Impl::Send(GroupToSingleRelayMessage message) {
   assert(!functors_.message_and_caching.message_received &&
          "Not allowed with string type message API");
   protobuf::Message proto_message = CreateNodeLevelMessage(message);
@@ -62,23 +94,26 @@ void Routing::Impl::Send(const GroupToSingleRelayMessage& message) {
 }
 
 template <>
-protobuf::Message Routing::Impl::CreateNodeLevelMessage(const GroupToSingleRelayMessage& message) {
+protobuf::Message Routing::Impl::CreateNodeLevelMessage(GroupToSingleRelayMessage& message) {
   protobuf::Message proto_message;
   proto_message.set_destination_id(message.receiver.relay_node->string());
   proto_message.set_routing_message(false);
-  proto_message.add_data(message.contents);
+  proto_message.add_data()->swap(message.contents);
   proto_message.set_type(static_cast<int32_t>(MessageType::kNodeLevel));
 
   proto_message.set_cacheable(static_cast<int32_t>(message.cacheable));
   proto_message.set_client_node(routing_table_.client_mode());
 
   proto_message.set_request(true);
-  proto_message.set_hops_to_live(Parameters::hops_to_live);
+  SetHopBudget(network_statistics_.HopBudget(), proto_message);
+  SetSendPriority(proto_message);
 
   AddGroupSourceRelatedFields(message, proto_message,
                               detail::is_group_source<GroupToSingleRelayMessage>());
   AddDestinationTypeRelatedFields(proto_message,
                                   detail::is_group_destination<GroupToSingleRelayMessage>());
+  if (message.compress && message.cacheable == Cacheable::kNone)
+    CompressData(proto_message);
 
   // add relay information
   proto_message.set_relay_id(message.receiver.node_id->string());
@@ -89,30 +124,69 @@ protobuf::Message Routing::Impl::CreateNodeLevelMessage(const GroupToSingleRelay
   return proto_message;
 }
 
-Routing::Impl::Impl(bool client_mode, const NodeId& node_id, const asymm::Keys& keys)
+Routing::Impl::Impl(bool client_mode, const NodeId& node_id, const asymm::Keys& keys,
+                    std::shared_ptr<AsioService> asio_service,
+                    const InstanceParameters& parameters)
     : network_status_mutex_(),
       network_status_(kNotJoined),
       network_statistics_(node_id),
-      routing_table_(client_mode, node_id, keys, network_statistics_),
+      kParameters_(parameters),
+      routing_table_(client_mode, node_id, keys, network_statistics_, kParameters_),
       kNodeId_(node_id),
+      kRpcTemplates_(node_id, client_mode),
       running_(true),
       running_mutex_(),
       functors_(),
       random_node_helper_(),
       // TODO(Prakash) : don't create client_routing_table for client nodes (wrap both)
-      client_routing_table_(node_id),
+      client_routing_table_(node_id, kParameters_),
       remove_furthest_node_(routing_table_, network_),
       group_change_handler_(routing_table_, client_routing_table_, network_),
+      ingress_limiter_(kParameters_.max_queued_messages),
+      message_latency_(),
+      metrics_(),
+      group_cache_(Parameters::get_group_cache_ttl, Parameters::get_group_cache_size),
+      response_pool_(std::make_shared<detail::CompletionPool>(
+          Parameters::max_spare_response_states)),
+      change_batcher_(),
+      network_status_filter_(Parameters::network_status_hysteresis,
+                             Parameters::network_status_min_interval),
+      lost_connections_mutex_(),
+      lost_connections_(),
+      snapshot_path_(),
+      snapshot_peers_(),
+      manifest_peers_(),
+      message_capture_(),
+      find_node_interval_(Parameters::find_node_interval),
+      recovery_time_lag_(Parameters::recovery_time_lag),
+      re_bootstrap_time_lag_(Parameters::re_bootstrap_time_lag),
+      find_close_node_interval_(Parameters::find_close_node_interval),
+      close_group_changes_(0),
+      link_probe_cursor_(0),
+      message_handler_once_(),
+      message_handler_built_(false),
       message_handler_(),
-      asio_service_(2),
-      network_(routing_table_, client_routing_table_),
-      timer_(asio_service_),
-      re_bootstrap_timer_(asio_service_.service()),
-      recovery_timer_(asio_service_.service()),
-      setup_timer_(asio_service_.service()) {
-  message_handler_.reset(new MessageHandler(routing_table_, client_routing_table_, network_, timer_,
-                                            remove_furthest_node_, group_change_handler_,
-                                            network_statistics_));
+      asio_service_(std::move(asio_service)),
+      network_(routing_table_, client_routing_table_, *asio_service_, kParameters_),
+      timer_(*asio_service_),
+      re_bootstrap_timer_(asio_service_->service()),
+      recovery_timer_(asio_service_->service()),
+      setup_timer_(asio_service_->service()),
+      closest_nodes_update_timer_(asio_service_->service()),
+      change_notification_timer_(asio_service_->service()),
+      connection_loss_timer_(asio_service_->service()),
+      snapshot_timer_(asio_service_->service()),
+      link_probe_timer_(asio_service_->service()),
+      network_viewer_timer_(asio_service_->service()),
+      network_status_timer_(asio_service_->service()),
+      matrix_digest_timer_(asio_service_->service()),
+      dispatch_strands_(),
+      handler_guard_() {
+  for (uint16_t index(0); index < std::max(kParameters_.message_dispatch_strands,
+                                           static_cast<uint16_t>(1)); ++index) {
+    dispatch_strands_.emplace_back(new boost::asio::io_service::strand(asio_service_->service()));
+  }
+  network_.set_metrics(&metrics_);
   LOG(kInfo) << (client_mode ? "client " : "non-client ") << "node. Id : " << DebugId(kNodeId_);
   assert((client_mode || !node_id.IsZero()) && "Server Nodes cannot be created without valid keys");
 }
@@ -120,8 +194,15 @@ Routing::Impl::Impl(bool client_mode, const NodeId& node_id, const asymm::Keys&
 Routing::Impl::~Impl() {
   LOG(kVerbose) << "~Impl " << DebugId(kNodeId_) << ", connection id "
                 << DebugId(routing_table_.kConnectionId());
-  std::lock_guard<std::mutex> lock(running_mutex_);
-  running_ = false;
+  {
+    std::lock_guard<std::mutex> lock(running_mutex_);
+    running_ = false;
+    snapshot_timer_.cancel();
+  }
+  // A snapshot timer handler already running would write the ".new" file alongside the final save,
+  // so it's waited for first.  Nothing else is left to run the guarded handlers for.
+  handler_guard_.Close();
+  SaveRoutingSnapshot();
 }
 
 void Routing::Impl::Join(const Functors& functors, const std::vector<Endpoint>& peer_endpoints) {
@@ -134,26 +215,59 @@ void Routing::Impl::Join(const Functors& functors, const std::vector<Endpoint>&
   }
 }
 
+MessageHandler& Routing::Impl::message_handler() {
+  std::call_once(message_handler_once_, [this] {
+    const auto kStart(std::chrono::steady_clock::now());
+    message_handler_.reset(new MessageHandler(routing_table_, client_routing_table_, network_,
+                                              timer_, remove_furthest_node_,
+                                              group_change_handler_, network_statistics_,
+                                              kParameters_));
+    message_handler_->set_metrics(&metrics_);
+    metrics_.StartupPhaseTimed(StartupPhase::kMessageHandler,
+                               std::chrono::steady_clock::now() - kStart);
+    message_handler_built_ = true;
+  });
+  return *message_handler_;
+}
+
+void Routing::Impl::ConstructionTimed(std::chrono::steady_clock::duration duration) {
+  metrics_.StartupPhaseTimed(StartupPhase::kConstruct, duration);
+}
+
 void Routing::Impl::ConnectFunctors(const Functors& functors) {
   functors_ = functors;
   routing_table_.InitialiseFunctors([this](int network_status_in) {
+                                      bool dropped(false);
                                       {
                                         std::lock_guard<std::mutex> lock(network_status_mutex_);
+                                        dropped = network_status_in < network_status_;
                                         network_status_ = network_status_in;
                                       }
-                                      NotifyNetworkStatus(network_status_in);
+                                      if (dropped) {
+                                        find_node_interval_.Tighten();
+                                        recovery_time_lag_.Tighten();
+                                      }
+                                      if (change_batcher_.AddNetworkStatus(network_status_in))
+                                        ScheduleChangeNotifications();
                                     },
                                     [this](const NodeInfo & node, bool internal_rudp_only) {
                                       RemoveNode(node, internal_rudp_only);
                                     },
-                                    [this]() { remove_furthest_node_.RemoveNodeRequest(); },
+                                    [this]() {
+                                      if (change_batcher_.AddRemoveFurthestNode())
+                                        ScheduleChangeNotifications();
+                                    },
                                     [this](const std::vector<NodeInfo> new_nodes,
                                            const std::vector<NodeInfo> old_nodes) {
-                                      std::lock_guard<std::mutex> lock(running_mutex_);
-                                      if (running_)
-                                        group_change_handler_.SendClosestNodesUpdateRpcs(new_nodes,
-                                                                                         old_nodes);
-                                    }, functors.matrix_changed);
+                                      QueueClosestNodesUpdate(new_nodes, old_nodes);
+                                    },
+                                    [this](std::shared_ptr<MatrixChange> matrix_change) {
+                                      if (!matrix_change)
+                                        return;
+                                      group_cache_.Invalidate(*matrix_change);
+                                      if (change_batcher_.AddMatrixChange(matrix_change))
+                                        ScheduleChangeNotifications();
+                                    });
   // only one of MessageAndCachingFunctors or TypedMessageAndCachingFunctor should be provided
   assert(!functors.message_and_caching.message_received !=
          !functors.typed_message_and_caching.single_to_single.message_received);
@@ -168,11 +282,12 @@ void Routing::Impl::ConnectFunctors(const Functors& functors) {
            !functors.typed_message_and_caching.single_to_group_relay.message_received);
   }
   if (functors.message_and_caching.message_received)
-    message_handler_->set_message_and_caching_functor(functors.message_and_caching);
+    message_handler().set_message_and_caching_functor(functors.message_and_caching);
   else
-    message_handler_->set_typed_message_and_caching_functor(functors.typed_message_and_caching);
+    message_handler().set_typed_message_and_caching_functor(functors.typed_message_and_caching);
 
-  message_handler_->set_request_public_key_functor(functors.request_public_key);
+  message_handler().set_request_public_key_functor(functors.request_public_key);
+  message_handler().set_request_public_keys_functor(functors.request_public_keys);
   network_.set_new_bootstrap_endpoint_functor(functors.new_bootstrap_endpoint);
 }
 
@@ -181,23 +296,39 @@ void Routing::Impl::BootstrapFromTheseEndpoints(const std::vector<Endpoint>& end
              << endpoints[0] << ", this node's ID: " << DebugId(kNodeId_)
              << (routing_table_.client_mode() ? " Client" : "");
   if (routing_table_.size() > 0) {
-    for (uint16_t i = 0; i < routing_table_.size(); ++i) {
-      NodeInfo remove_node = routing_table_.GetClosestNode(kNodeId_);
-      network_.Remove(remove_node.connection_id);
-      routing_table_.DropNode(remove_node.node_id, true);
-    }
+    std::vector<NodeId> node_ids(routing_table_.GetClosestNodes(
+        kNodeId_, static_cast<uint16_t>(routing_table_.size())));
+    for (const auto& dropped_node : routing_table_.DropNodes(node_ids, true))
+      network_.Remove(dropped_node.connection_id);
     NotifyNetworkStatus(static_cast<int>(routing_table_.size()));
   }
   DoJoin(endpoints);
 }
 
 void Routing::Impl::DoJoin(const std::vector<Endpoint>& endpoints) {
+  const auto kBootstrapStart(std::chrono::steady_clock::now());
   int return_value(DoBootstrap(endpoints));
   if (kSuccess != return_value)
     return NotifyNetworkStatus(return_value);
+  metrics_.StartupPhaseTimed(StartupPhase::kBootstrap,
+                             std::chrono::steady_clock::now() - kBootstrapStart);
 
   assert(!network_.bootstrap_connection_id().IsZero() &&
          "Bootstrap connection id must be populated by now.");
+  if (!snapshot_peers_.empty()) {
+    LOG(kInfo) << "[" << DebugId(kNodeId_) << "] requesting connections to "
+               << snapshot_peers_.size() << " peers from routing snapshot";
+    message_handler().SendConnectRequests(snapshot_peers_);
+  }
+  if (!manifest_peers_.empty()) {
+    LOG(kInfo) << "[" << DebugId(kNodeId_) << "] requesting connections to "
+               << manifest_peers_.size() << " peers from network manifest";
+    message_handler().SendConnectRequests(manifest_peers_);
+  }
+  ScheduleRoutingSnapshot();
+  ScheduleLinkProbes();
+  ScheduleMatrixDigests();
+  ScheduleGroupMatrixPublication();
   FindClosestNode(boost::system::error_code(), 0);
   NotifyNetworkStatus(return_value);
 }
@@ -235,16 +366,21 @@ void Routing::Impl::FindClosestNode(const boost::system::error_code& error_code,
     assert(!network_.bootstrap_connection_id().IsZero() && "Only after bootstrapping succeeds");
     assert(!network_.this_node_relay_connection_id().IsZero() &&
            "Relay connection id should be set after bootstrapping succeeds");
+    // The response to the first FindNodes seeds a lookup which then queries the closest nodes it
+    // hears of in parallel, rather than waiting for further rounds of this loop.
+    message_handler().StartNodeLookup();
+    find_close_node_interval_.Reset();
   } else {
     if (routing_table_.size() > 0) {
+      re_bootstrap_time_lag_.Reset();
       std::lock_guard<std::mutex> lock(running_mutex_);
       if (!running_)
         return;
       // Exit the loop & start recovery loop
       LOG(kVerbose) << "[" << DebugId(kNodeId_) << "] Added a node in routing table."
                     << " Terminating setup loop & Scheduling recovery loop.";
-      recovery_timer_.expires_from_now(Parameters::find_node_interval);
-      recovery_timer_.async_wait([=](const boost::system::error_code & error_code) {
+      recovery_timer_.expires_from_now(find_node_interval_.current());
+      AsyncWait(recovery_timer_, [=](const boost::system::error_code & error_code) {
         if (error_code != boost::asio::error::operation_aborted)
           ReSendFindNodeRequest(error_code, false);
       });
@@ -260,7 +396,7 @@ void Routing::Impl::FindClosestNode(const boost::system::error_code& error_code,
 
   int num_nodes_requested(1 + attempts / Parameters::find_node_repeats_per_num_requested);
   protobuf::Message find_node_rpc(rpcs::FindNodes(kNodeId_, kNodeId_, num_nodes_requested, true,
-                                                  network_.this_node_relay_connection_id()));
+                                                  network_.this_node_relay_connection_id(), true));
   LOG(kVerbose) << "   [" << DebugId(kNodeId_) << "] (attempt " << attempts << ")"
                 << " requesting " << num_nodes_requested << " nodes"
                 << "   (id: " << find_node_rpc.id() << ")";
@@ -282,8 +418,11 @@ void Routing::Impl::FindClosestNode(const boost::system::error_code& error_code,
   std::lock_guard<std::mutex> lock(running_mutex_);
   if (!running_)
     return;
-  setup_timer_.expires_from_now(Parameters::find_close_node_interval);
-  setup_timer_.async_wait([=](boost::system::error_code error_code_local) {
+  // Successive attempts are spaced further apart, as a bootstrap node which hasn't answered yet is
+  // unlikely to answer the next request sooner.
+  setup_timer_.expires_from_now(find_close_node_interval_.current());
+  find_close_node_interval_.Backoff();
+  AsyncWait(setup_timer_, [=](boost::system::error_code error_code_local) {
     if (error_code_local != boost::asio::error::operation_aborted)
       FindClosestNode(error_code_local, attempts);
   });
@@ -343,11 +482,12 @@ int Routing::Impl::ZeroStateJoin(const Functors& functors, const Endpoint& local
                << DebugId(network_.bootstrap_connection_id()) << ", Routing table size - "
                << routing_table_.size() << ", Node id : " << DebugId(kNodeId_);
 
+    ScheduleGroupMatrixPublication();
     std::lock_guard<std::mutex> lock(running_mutex_);
     if (!running_)
       return kNetworkShuttingDown;
-    recovery_timer_.expires_from_now(Parameters::find_node_interval);
-    recovery_timer_.async_wait([=](const boost::system::error_code & error_code) {
+    recovery_timer_.expires_from_now(find_node_interval_.current());
+    AsyncWait(recovery_timer_, [=](const boost::system::error_code & error_code) {
       if (error_code != boost::asio::error::operation_aborted)
         ReSendFindNodeRequest(error_code, false);
     });
@@ -358,11 +498,86 @@ int Routing::Impl::ZeroStateJoin(const Functors& functors, const Endpoint& local
   }
 }
 
+void Routing::Impl::Send(SingleToSingleMessage message, uint16_t path_count) {
+  assert(!functors_.message_and_caching.message_received &&
+         "Not allowed with string type message API");
+  protobuf::Message proto_message = CreateNodeLevelMessage(message);
+  // Copies are recognised at the destination by source and message ID.
+  if (path_count > 1)
+    proto_message.set_id(timer_.NewTaskId());
+  SendMessage(message.receiver, proto_message, path_count);
+}
+
 void Routing::Impl::SendDirect(const NodeId& destination_id, const std::string& data,
-                               bool cacheable, ResponseFunctor response_functor) {
+                               bool cacheable, ResponseFunctor response_functor,
+                               uint16_t path_count) {
+  assert(!functors_.typed_message_and_caching.single_to_single.message_received &&
+         "Not allowed with typed Message API");
+  Send(destination_id, data, DestinationType::kDirect, cacheable, response_functor, path_count);
+}
+
+PendingResponse Routing::Impl::SendDirect(const NodeId& destination_id, const std::string& data,
+                                          bool cacheable) {
+  assert(!functors_.typed_message_and_caching.single_to_single.message_received &&
+         "Not allowed with typed Message API");
+  // Checked first, so that nothing throws between the Completer being made and the Timer taking
+  // it over.
+  CheckSendParameters(destination_id, data);
+  PendingResponse pending(response_pool_->Acquire(1));
+  Send(destination_id, data, DestinationType::kDirect, cacheable,
+       pending.state()->Completer());
+  return pending;
+}
+
+void Routing::Impl::SendStream(const NodeId& destination_id, std::string data,
+                               ResponseFunctor response_functor) {
   assert(!functors_.typed_message_and_caching.single_to_single.message_received &&
          "Not allowed with typed Message API");
-  Send(destination_id, data, DestinationType::kDirect, cacheable, response_functor);
+  if (data.size() <= Parameters::max_data_size)
+    return SendDirect(destination_id, data, false, response_functor);
+  if (destination_id.IsZero()) {
+    LOG(kError) << "Invalid destination ID, aborted send";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_node_id));
+  }
+  if (data.size() > Parameters::max_stream_size) {
+    LOG(kError) << "Stream size not allowed : " << data.size();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+
+  protobuf::Message header(CreateNodeLevelPartialMessage(destination_id, DestinationType::kDirect,
+                                                         std::string(), false));
+  header.clear_data();
+  const TaskId kStreamId(timer_.NewTaskId());
+  header.set_stream_id(kStreamId);
+  // Each frame is small enough to send alone, but together they are a bulk transfer.
+  header.set_priority(static_cast<int32_t>(SendPriority::kBulk));
+  if (response_functor) {
+    // Frames are acknowledged a window at a time, each window within the usual response timeout.
+    const uint32_t kFrameCount(StreamSender::FrameCount(data.size(), Parameters::max_data_size));
+    timer_.AddTask(kParameters_.default_response_timeout *
+                       static_cast<int>(1 + (kFrameCount - 1) / Parameters::stream_window),
+                   response_functor, 1, kStreamId);
+  }
+  auto stream_sender(std::make_shared<StreamSender>(
+      timer_, header, std::move(data), Parameters::max_data_size, Parameters::stream_window,
+      kParameters_.default_response_timeout,
+      [this, destination_id](protobuf::Message& frame) { SendMessage(destination_id, frame); },
+      [this, kStreamId, response_functor]() {
+        if (!response_functor)
+          return;
+        {
+          std::lock_guard<std::mutex> lock(running_mutex_);
+          if (!running_)
+            return;
+        }
+        try {
+          timer_.CancelTask(kStreamId);
+        }
+        catch (const maidsafe_error& error) {
+          LOG(kVerbose) << "Stream " << kStreamId << " already finished: " << error.what();
+        }
+      }));
+  stream_sender->Start();
 }
 
 void Routing::Impl::SendGroup(const NodeId& destination_id, const std::string& data,
@@ -372,32 +587,65 @@ void Routing::Impl::SendGroup(const NodeId& destination_id, const std::string& d
   Send(destination_id, data, DestinationType::kGroup, cacheable, response_functor);
 }
 
+GroupResponses Routing::Impl::SendGroup(const NodeId& destination_id, const std::string& data,
+                                        bool cacheable) {
+  assert(!functors_.typed_message_and_caching.single_to_single.message_received &&
+         "Not allowed with typed Message API");
+  CheckSendParameters(destination_id, data);
+  GroupResponses responses(response_pool_->Acquire(kGroupResponseCount));
+  Send(destination_id, data, DestinationType::kGroup, cacheable,
+       responses.state()->Completer());
+  return responses;
+}
+
 void Routing::Impl::Send(const NodeId& destination_id, const std::string& data,
                          const DestinationType& destination_type, bool cacheable,
-                         ResponseFunctor response_functor) {
+                         ResponseFunctor response_functor, uint16_t path_count) {
   CheckSendParameters(destination_id, data);
   protobuf::Message proto_message =
       CreateNodeLevelPartialMessage(destination_id, destination_type, data, cacheable);
   uint16_t expected_response_count(1);
   if (response_functor) {
     if (DestinationType::kGroup == destination_type)
-      expected_response_count = 4;
+      expected_response_count = kGroupResponseCount;
     proto_message.set_id(timer_.NewTaskId());
-    timer_.AddTask(Parameters::default_response_timeout, response_functor, expected_response_count,
-                   proto_message.id());
+    SetTimeLeft(kParameters_.default_response_timeout, proto_message);
+    timer_.AddTask(kParameters_.default_response_timeout, response_functor,
+                   expected_response_count, proto_message.id());
   } else {
-    proto_message.set_id(0);
+    proto_message.set_id(path_count > 1 ? timer_.NewTaskId() : 0);
   }
-  SendMessage(destination_id, proto_message);
+  if (response_functor && path_count <= 1 && routing_table_.client_mode() &&
+      Parameters::client_relay_links != 0) {
+    MessageTrace::Sample(proto_message, kNodeId_);
+    return SendOverRelayLink(std::make_shared<protobuf::Message>(std::move(proto_message)));
+  }
+  SendMessage(destination_id, proto_message, path_count);
 }
 
-void Routing::Impl::SendMessage(const NodeId& destination_id, protobuf::Message& proto_message) {
+void Routing::Impl::SendMessage(const NodeId& destination_id, protobuf::Message& proto_message,
+                                uint16_t path_count) {
+  MessageTrace::Sample(proto_message, kNodeId_);
   if (routing_table_.size() == 0) {  // Partial join state
     PartiallyJoinedSend(proto_message);
   } else {  // Normal node
     proto_message.set_source_id(kNodeId_.string());
-    if (kNodeId_ != destination_id) {
-      network_.SendToClosestNode(proto_message);
+    if (kNodeId_ != destination_id && path_count > 1) {
+      proto_message.set_multipath(true);
+      network_.SendAlongDisjointPaths(proto_message, path_count);
+    } else if (kNodeId_ != destination_id) {
+      if (network_.shortcuts().CountSend(destination_id))
+        RequestShortcut(destination_id, proto_message.direct());
+      // A group message can skip the greedy hops if the group's leader is known and connected.
+      NodeId leader;
+      NodeInfo leader_info;
+      if (!proto_message.direct() && group_cache_.GetLeader(destination_id, leader) &&
+          routing_table_.GetNodeInfo(leader, leader_info)) {
+        network_.SendToDirectAdjustedRoute(proto_message, leader_info.node_id,
+                                           leader_info.connection_id);
+      } else {
+        network_.SendToClosestNode(proto_message);
+      }
     } else if (routing_table_.client_mode()) {
       LOG(kVerbose) << "Client sending request to self id";
       network_.SendToClosestNode(proto_message);
@@ -408,6 +656,25 @@ void Routing::Impl::SendMessage(const NodeId& destination_id, protobuf::Message&
   }
 }
 
+void Routing::Impl::RequestShortcut(const NodeId& destination_id, bool direct) {
+  // Those in range of the close group are a hop or two away already.
+  if (routing_table_.IsNodeIdInGroupRange(destination_id) == GroupRangeStatus::kInRange)
+    return;
+  NodeId peer_id(destination_id);
+  std::vector<NodeId> group;
+  if (!direct && !group_cache_.GetLeader(destination_id, peer_id)) {
+    if (!group_cache_.Get(destination_id, group) || group.empty()) {
+      GetGroup(destination_id);  // so that the group is known by the next request
+      return;
+    }
+    peer_id = *std::min_element(std::begin(group), std::end(group),
+                                [&](const NodeId& lhs, const NodeId& rhs) {
+                                  return NodeId::CloserToTarget(lhs, rhs, destination_id);
+                                });
+  }
+  message_handler().SendShortcutConnectRequest(peer_id);
+}
+
 // Partial join state
 void Routing::Impl::PartiallyJoinedSend(protobuf::Message& proto_message) {
   proto_message.set_relay_id(kNodeId_.string());
@@ -418,7 +685,7 @@ void Routing::Impl::PartiallyJoinedSend(protobuf::Message& proto_message) {
     std::lock_guard<std::mutex> lock(running_mutex_);
     if (!running_)
       return;
-    asio_service_.service().post([=]() {
+    Post([=]() {
       if (rudp::kSuccess != result) {
         timer_.CancelTask(proto_message.id());
         LOG(kError) << "Partial join Session Ended, Send not allowed anymore";
@@ -436,6 +703,59 @@ void Routing::Impl::PartiallyJoinedSend(protobuf::Message& proto_message) {
   network_.SendToDirect(proto_message, bootstrap_connection_id, message_sent);
 }
 
+void Routing::Impl::SendOverRelayLink(std::shared_ptr<protobuf::Message> proto_message) {
+  if (routing_table_.size() == 0) {
+    NodeId bootstrap_connection_id(network_.bootstrap_connection_id());
+    if (bootstrap_connection_id.IsZero()) {
+      LOG(kWarning) << "No connection left to send request on.  id: " << proto_message->id();
+      return;  // left to time out
+    }
+    // Recorded only once sent, as the recorded message mustn't change.
+    PartiallyJoinedSend(*proto_message);
+    return network_.relay_links().Sent(bootstrap_connection_id, proto_message);
+  }
+
+  // A request first sent while partially joined no longer needs relaying.
+  proto_message->clear_relay_id();
+  proto_message->clear_relay_connection_id();
+  proto_message->set_source_id(kNodeId_.string());
+  const NodeId kDestinationId(proto_message->destination_id());
+  std::vector<NodeInfo> links;
+  std::vector<NodeId> link_ids;
+  for (const auto& node_id :
+       routing_table_.GetClosestNodes(kDestinationId, Parameters::client_relay_links)) {
+    NodeInfo node;
+    if (routing_table_.GetNodeInfo(node_id, node)) {
+      links.push_back(node);
+      link_ids.push_back(node.connection_id);
+    }
+  }
+  const NodeId kLinkId(network_.relay_links().Choose(link_ids));
+  auto link(std::find_if(std::begin(links), std::end(links), [&kLinkId](const NodeInfo& node) {
+    return node.connection_id == kLinkId;
+  }));
+  if (link == std::end(links))
+    return network_.SendToClosestNode(*proto_message);
+  network_.SendToDirect(*proto_message, link->node_id, link->connection_id);
+  network_.relay_links().Sent(link->connection_id, proto_message);
+}
+
+void Routing::Impl::FailOverRelayLink(const NodeId& connection_id) {
+  for (const auto& request : network_.relay_links().Lost(connection_id)) {
+    auto message(std::make_shared<protobuf::Message>(*request.message));
+    // The time it spent on the lost connection comes off what the requester will wait.
+    DeductTimeLeft(request.sent, *message);
+    if (IsExpired(*message)) {
+      LOG(kInfo) << "[" << DebugId(kNodeId_) << "] not resending expired request id: "
+                 << message->id() << " in flight on lost connection " << DebugId(connection_id);
+      continue;
+    }
+    LOG(kInfo) << "[" << DebugId(kNodeId_) << "] resending request id: " << message->id()
+               << " in flight on lost connection " << DebugId(connection_id);
+    SendOverRelayLink(std::move(message));
+  }
+}
+
 protobuf::Message Routing::Impl::CreateNodeLevelPartialMessage(
     const NodeId& destination_id, const DestinationType& destination_type, const std::string& data,
     bool cacheable) {
@@ -449,7 +769,8 @@ protobuf::Message Routing::Impl::CreateNodeLevelPartialMessage(
   proto_message.set_direct((DestinationType::kDirect == destination_type));
   proto_message.set_client_node(routing_table_.client_mode());
   proto_message.set_request(true);
-  proto_message.set_hops_to_live(Parameters::hops_to_live);
+  SetHopBudget(network_statistics_.HopBudget(), proto_message);
+  SetSendPriority(proto_message);
   uint16_t replication(1);
   if (DestinationType::kGroup == destination_type) {
     proto_message.set_visited(false);
@@ -487,6 +808,11 @@ GroupRangeStatus Routing::Impl::IsNodeIdInGroupRange(const NodeId& group_id,
   return routing_table_.IsNodeIdInGroupRange(group_id, node_id);
 }
 
+void Routing::Impl::IsNodeIdInGroupRange(const std::vector<NodeId>& group_ids,
+                                         std::vector<GroupRangeStatus>& results) {
+  routing_table_.IsNodeIdInGroupRange(group_ids, results);
+}
+
 NodeId Routing::Impl::RandomConnectedNode() { return routing_table_.RandomConnectedNode(); }
 
 bool Routing::Impl::EstimateInGroup(const NodeId& sender_id, const NodeId& info_id) {
@@ -494,101 +820,404 @@ bool Routing::Impl::EstimateInGroup(const NodeId& sender_id, const NodeId& info_
           network_statistics_.EstimateInGroup(sender_id, info_id));
 }
 
+bool Routing::Impl::GetLocalGroup(const NodeId& group_id, std::vector<NodeId>& group) {
+  // Until the close group is known, an empty table would claim every group as its own.
+  if (routing_table_.client_mode() || routing_table_.size() < Parameters::closest_nodes_size ||
+      routing_table_.IsNodeIdInGroupRange(group_id) != GroupRangeStatus::kInRange)
+    return false;
+  group = routing_table_.GetGroup(group_id);
+  return true;
+}
+
 std::future<std::vector<NodeId>> Routing::Impl::GetGroup(const NodeId& group_id) {
   auto promise(std::make_shared<std::promise<std::vector<NodeId>>>());
   auto future(promise->get_future());
-  auto callback = [promise](const std::string & response) {
+  GetGroup(group_id, [promise](std::vector<NodeId> group) { promise->set_value(group); });
+  return std::move(future);
+}
+
+void Routing::Impl::GetGroup(const NodeId& group_id,
+                             std::function<void(std::vector<NodeId>)> on_group) {
+  std::vector<NodeId> group;
+  if (GetLocalGroup(group_id, group) || group_cache_.Get(group_id, group))
+    return on_group(group);
+  auto callback = [this, on_group, group_id](const std::string & response) {
     std::vector<NodeId> nodes_id;
+    NodeId leader;
     if (!response.empty()) {
       protobuf::GetGroup get_group;
       if (get_group.ParseFromString(response)) {
         try {
           for (const auto& id : get_group.group_nodes_id())
             nodes_id.push_back(NodeId(id));
+          // The responder was reached by routing towards group_id, so is the group's closest node.
+          leader = NodeId(get_group.node_id());
         }
         catch (std::exception& ex) {
           LOG(kError) << "Failed to parse response of GetGroup : " << ex.what();
+          nodes_id.clear();
         }
       }
     }
-    promise->set_value(nodes_id);
+    group_cache_.Add(group_id, nodes_id, leader);
+    on_group(nodes_id);
   };
-  protobuf::Message get_group_message(rpcs::GetGroup(group_id, kNodeId_));
+  protobuf::Message get_group_message(kRpcTemplates_.GetGroup(group_id));
   get_group_message.set_id(timer_.NewTaskId());
-  timer_.AddTask(Parameters::default_response_timeout, callback, 1, get_group_message.id());
+  timer_.AddTask(kParameters_.default_response_timeout, callback, 1, get_group_message.id());
   network_.SendToClosestNode(get_group_message);
+}
+
+namespace {
+
+struct PendingGroups {
+  explicit PendingGroups(size_t count) : mutex(), groups(count), outstanding(0), promise() {}
+  std::mutex mutex;
+  std::vector<std::vector<NodeId>> groups;
+  size_t outstanding;
+  std::promise<std::vector<std::vector<NodeId>>> promise;
+};
+
+// Marks one outstanding request of pending complete, fulfilling its promise if it was the last.
+void FinishRequest(PendingGroups& pending) {
+  std::unique_lock<std::mutex> lock(pending.mutex);
+  if (--pending.outstanding == 0) {
+    lock.unlock();
+    pending.promise.set_value(std::move(pending.groups));
+  }
+}
+
+std::vector<NodeId> ParseGroup(
+    const google::protobuf::RepeatedPtrField<std::string>& group_nodes_id) {
+  std::vector<NodeId> nodes_id;
+  for (const auto& id : group_nodes_id)
+    nodes_id.push_back(NodeId(id));
+  return nodes_id;
+}
+
+}  // unnamed namespace
+
+std::future<std::vector<std::vector<NodeId>>> Routing::Impl::GetGroups(
+    const std::vector<NodeId>& group_ids) {
+  auto pending(std::make_shared<PendingGroups>(group_ids.size()));
+  auto future(pending->promise.get_future());
+  // Ids whose requests would leave this node via the same peer are asked about together.
+  std::vector<std::pair<NodeId, std::vector<size_t>>> batches;
+  std::map<NodeId, size_t> open_batch;
+  for (size_t i(0); i != group_ids.size(); ++i) {
+    if (GetLocalGroup(group_ids[i], pending->groups[i]) ||
+        group_cache_.Get(group_ids[i], pending->groups[i]))
+      continue;
+    NodeId next_hop(routing_table_.GetClosestNode(group_ids[i]).node_id);
+    auto itr(open_batch.find(next_hop));
+    if (itr == open_batch.end() ||
+        batches[itr->second].second.size() == Parameters::get_group_batch_size) {
+      open_batch[next_hop] = batches.size();
+      batches.emplace_back(next_hop, std::vector<size_t>(1, i));
+    } else {
+      batches[itr->second].second.push_back(i);
+    }
+  }
+  if (batches.empty()) {
+    pending->promise.set_value(std::move(pending->groups));
+    return std::move(future);
+  }
+  pending->outstanding = batches.size();
+
+  for (const auto& batch : batches) {
+    const std::vector<size_t> indices(batch.second);
+    std::vector<NodeId> batch_group_ids;
+    for (auto index : indices)
+      batch_group_ids.push_back(group_ids[index]);
+    auto callback = [this, pending, indices, batch_group_ids](const std::string& response) {
+      // Positions in the batch of ids the responder didn't answer for, to be asked about alone.
+      std::vector<size_t> unanswered;
+      {
+        std::lock_guard<std::mutex> lock(pending->mutex);
+        NodeId leader;
+        if (!response.empty()) {
+          protobuf::GetGroup get_group;
+          if (get_group.ParseFromString(response)) {
+            try {
+              pending->groups[indices.front()] = ParseGroup(get_group.group_nodes_id());
+              leader = NodeId(get_group.node_id());
+              // Nodes predating batched requests answer only for the first id, and others flag
+              // the ids whose groups they aren't in.
+              for (size_t j(1); j < indices.size(); ++j) {
+                const int kAnswer(static_cast<int>(j) - 1);
+                if (kAnswer >= get_group.additional_groups_size() ||
+                    get_group.additional_groups(kAnswer).out_of_range()) {
+                  unanswered.push_back(j);
+                } else {
+                  pending->groups[indices[j]] =
+                      ParseGroup(get_group.additional_groups(kAnswer).group_nodes_id());
+                }
+              }
+            }
+            catch (std::exception& ex) {
+              LOG(kError) << "Failed to parse response of GetGroup : " << ex.what();
+              unanswered.clear();
+            }
+          }
+        }
+        // The responder is only known to lead the first group.
+        group_cache_.Add(batch_group_ids.front(), pending->groups[indices.front()], leader);
+        for (size_t j(1), k(0); j < indices.size(); ++j) {
+          if (k != unanswered.size() && unanswered[k] == j)
+            ++k;
+          else
+            group_cache_.Add(batch_group_ids[j], pending->groups[indices[j]]);
+        }
+        pending->outstanding += unanswered.size();
+      }
+      for (auto j : unanswered) {
+        const size_t kIndex(indices[j]);
+        GetGroup(batch_group_ids[j], [pending, kIndex](std::vector<NodeId> group) {
+          {
+            std::lock_guard<std::mutex> lock(pending->mutex);
+            pending->groups[kIndex] = std::move(group);
+          }
+          FinishRequest(*pending);
+        });
+      }
+      FinishRequest(*pending);
+    };
+    protobuf::Message get_group_message(kRpcTemplates_.GetGroup(
+        batch_group_ids.front(),
+        std::vector<NodeId>(std::next(batch_group_ids.begin()), batch_group_ids.end())));
+    get_group_message.set_id(timer_.NewTaskId());
+    timer_.AddTask(kParameters_.default_response_timeout, callback, 1, get_group_message.id());
+    network_.SendToClosestNode(get_group_message);
+  }
   return std::move(future);
 }
 
+// Parsing happens here, in rudp's delivery order, so that the sender is known before handing the
+// message to that sender's strand.  Messages from one peer are then handled in arrival order while
+// different peers' messages proceed in parallel.  Only the header is parsed; the payload is left
+// for the message handler, which doesn't need it if the message is just passing through.
 void Routing::Impl::OnMessageReceived(const std::string& message) {
+  std::vector<std::string> bundled;
+  if (!MessageBundler::Unbundle(message, bundled))
+    return OnUnbundledMessageReceived(message);
+  // Bundles hold only messages, never bundles, so anything else in one is dropped as malformed.
+  for (const auto& bundled_message : bundled)
+    OnUnbundledMessageReceived(bundled_message);
+}
+
+void Routing::Impl::OnUnbundledMessageReceived(const std::string& message) {
+  auto received_time(MessageLatency::Clock::now());
+  if (message_capture_)
+    message_capture_->Record(CaptureDirection::kReceived, NodeId(), message);
+  // The header and payload share one allocation, which the handlers' pointers to each keep alive.
+  struct Received {
+    protobuf::Message header;
+    std::string encoded_body;
+  };
+  auto received(std::make_shared<Received>());
+  std::shared_ptr<protobuf::Message> pb_message(received, &received->header);
+  std::shared_ptr<std::string> encoded_body(received, &received->encoded_body);
+  if (!ParseMessageHeader(message, *pb_message, *encoded_body)) {
+    LOG(kWarning) << "Message received, failed to parse";
+    return;
+  }
+  if (encoded_body->empty())
+    encoded_body.reset();
   std::lock_guard<std::mutex> lock(running_mutex_);
-  if (running_)
-    asio_service_.service().post([=]() { DoOnMessageReceived(message); });  // NOLINT (Fraser)
-}
-
-void Routing::Impl::DoOnMessageReceived(const std::string& message) {
-  protobuf::Message pb_message;
-  if (pb_message.ParseFromString(message)) {
-    bool relay_message(!pb_message.has_source_id());
-    LOG(kVerbose) << "   [" << DebugId(kNodeId_) << "] rcvd : " << MessageTypeString(pb_message)
-                  << " from " << (relay_message ? HexSubstr(pb_message.relay_id())
-                                                : HexSubstr(pb_message.source_id())) << " to "
-                  << HexSubstr(pb_message.destination_id()) << "   (id: " << pb_message.id() << ")"
-                  << (relay_message ? " --Relay--" : "");
-    if ((!pb_message.client_node() && pb_message.has_source_id()) ||
-        (!pb_message.direct() && !pb_message.request())) {
-      NodeId source_id(pb_message.source_id());
-      if (!source_id.IsZero())
-        random_node_helper_.Add(source_id);
-    }
-    {
+  if (!running_)
+    return;
+  if (!ingress_limiter_.TryAdmit(IsHighPriority(*pb_message))) {
+    LOG(kWarning) << "[" << DebugId(kNodeId_) << "] dropping received "
+                  << MessageTypeString(*pb_message) << " (id: " << pb_message->id()
+                  << "); too many messages awaiting handling.";
+    return;
+  }
+  Post(DispatchStrand(*pb_message), [=]() {
+    DoOnMessageReceived(*pb_message, encoded_body, received_time);
+    ingress_limiter_.Release();
+  });
+}
+
+boost::asio::io_service::strand& Routing::Impl::DispatchStrand(
+    const protobuf::Message& message) {
+  const std::string& sender(message.has_source_id() ? message.source_id() : message.relay_id());
+  return *dispatch_strands_[std::hash<std::string>()(sender) % dispatch_strands_.size()];
+}
+
+void Routing::Impl::DoOnMessageReceived(protobuf::Message& pb_message,
+                                        std::shared_ptr<const std::string> encoded_body,
+                                        MessageLatency::Clock::time_point received_time) {
+  MessageLatency::Scope latency_scope(message_latency_, pb_message, received_time);
+  MessageTrace::RecordReceived(pb_message, kNodeId_, received_time);
+  bool relay_message(!pb_message.has_source_id());
+  ROUTING_LOG(kVerbose) << "   [" << DebugId(kNodeId_) << "] rcvd : "
+                        << MessageTypeString(pb_message) << " from "
+                        << (relay_message ? HexSubstr(pb_message.relay_id())
+                                          : HexSubstr(pb_message.source_id()))
+                        << " to " << HexSubstr(pb_message.destination_id()) << "   (id: "
+                        << pb_message.id() << ")" << (relay_message ? " --Relay--" : "");
+  if ((!pb_message.client_node() && pb_message.has_source_id()) ||
+      (!pb_message.direct() && !pb_message.request())) {
+    NodeId source_id(pb_message.source_id());
+    if (!source_id.IsZero())
+      random_node_helper_.Add(source_id);
+  }
+  {
+    std::lock_guard<std::mutex> lock(running_mutex_);
+    if (!running_)
+      return;
+  }
+  // Time spent waiting for a dispatch strand counts against the request's time_left.
+  DeductTimeLeft(received_time, pb_message);
+  message_handler().HandleMessage(pb_message, std::move(encoded_body));
+}
+
+// Close group changes arriving within Parameters::closest_nodes_update_interval of the first are
+// folded into a single round of ClosestNodesUpdate messages carrying the latest state.
+void Routing::Impl::QueueClosestNodesUpdate(const std::vector<NodeInfo>& new_nodes,
+                                            const std::vector<NodeInfo>& old_nodes) {
+  ++close_group_changes_;
+  std::lock_guard<std::mutex> lock(running_mutex_);
+  if (!running_ || !group_change_handler_.QueueClosestNodesUpdate(new_nodes, old_nodes))
+    return;
+  closest_nodes_update_timer_.expires_from_now(Parameters::closest_nodes_update_interval);
+  AsyncWait(closest_nodes_update_timer_, [this](const boost::system::error_code& error_code) {
+    if (error_code == boost::asio::error::operation_aborted)
+      return;
+    std::lock_guard<std::mutex> lock(running_mutex_);
+    if (running_)
+      group_change_handler_.SendQueuedClosestNodesUpdate();
+  });
+}
+
+// Routing table changes only record their effects in change_batcher_, so that the thread making
+// them isn't held up by the functors, and a burst of changes is acted on once.
+void Routing::Impl::ScheduleChangeNotifications() {
+  std::lock_guard<std::mutex> lock(running_mutex_);
+  if (!running_)
+    return;
+  change_notification_timer_.expires_from_now(Parameters::change_notification_interval);
+  AsyncWait(change_notification_timer_, [this](const boost::system::error_code& error_code) {
+    if (error_code != boost::asio::error::operation_aborted)
+      DeliverChangeNotifications();
+  });
+}
+
+void Routing::Impl::DeliverChangeNotifications() {
+  {
+    std::lock_guard<std::mutex> lock(running_mutex_);
+    if (!running_)
+      return;
+  }
+  ChangeBatcher::Batch batch(change_batcher_.Take());
+  if (batch.has_network_status)
+    FilterNetworkStatus(batch.network_status);
+  if (batch.matrix_change && functors_.matrix_changed)
+    functors_.matrix_changed(batch.matrix_change);
+  if (batch.remove_furthest_node)
+    remove_furthest_node_.RemoveNodeRequest();
+}
+
+void Routing::Impl::FilterNetworkStatus(int network_status) {
+  NetworkStatusFilter::Clock::duration retry_after;
+  switch (network_status_filter_.Offer(network_status, NetworkStatusFilter::Clock::now(),
+                                       retry_after)) {
+    case NetworkStatusFilter::Verdict::kReport:
+      NotifyNetworkStatus(network_status);
+      break;
+    case NetworkStatusFilter::Verdict::kHold: {
       std::lock_guard<std::mutex> lock(running_mutex_);
       if (!running_)
         return;
+      network_status_timer_.expires_from_now(retry_after);
+      AsyncWait(network_status_timer_, [this](const boost::system::error_code& error_code) {
+        if (error_code != boost::asio::error::operation_aborted)
+          DeliverHeldNetworkStatus();
+      });
+      break;
     }
-    message_handler_->HandleMessage(pb_message);
-  } else {
-    LOG(kWarning) << "Message received, failed to parse";
+    case NetworkStatusFilter::Verdict::kDrop:
+      break;
   }
 }
 
+void Routing::Impl::DeliverHeldNetworkStatus() {
+  {
+    std::lock_guard<std::mutex> lock(running_mutex_);
+    if (!running_)
+      return;
+  }
+  int network_status(0);
+  if (network_status_filter_.TakeHeld(NetworkStatusFilter::Clock::now(), network_status))
+    NotifyNetworkStatus(network_status);
+}
+
+// A flapping interface can lose dozens of connections at once.  Handling them together drops them
+// from the routing table in one go, so that the close group changes once and one recovery lookup
+// follows, rather than one of each per connection.
 void Routing::Impl::OnConnectionLost(const NodeId& lost_connection_id) {
+  {
+    std::lock_guard<std::mutex> lock(lost_connections_mutex_);
+    lost_connections_.push_back(lost_connection_id);
+    if (lost_connections_.size() != 1)
+      return;
+  }
   std::lock_guard<std::mutex> lock(running_mutex_);
-  if (running_)
-    asio_service_.service().post([=]() { DoOnConnectionLost(lost_connection_id); });  // NOLINT
-                                                                                      // (Fraser)
+  if (!running_)
+    return;
+  connection_loss_timer_.expires_from_now(Parameters::connection_loss_batch_interval);
+  AsyncWait(connection_loss_timer_, [this](const boost::system::error_code& error_code) {
+    if (error_code != boost::asio::error::operation_aborted)
+      DoOnConnectionsLost();
+  });
 }
 
-void Routing::Impl::DoOnConnectionLost(const NodeId& lost_connection_id) {
-  LOG(kVerbose) << DebugId(kNodeId_) << "  Routing::ConnectionLost with -----------"
-                << DebugId(lost_connection_id);
+void Routing::Impl::DoOnConnectionsLost() {
+  std::vector<NodeId> lost_connections;
+  {
+    std::lock_guard<std::mutex> lock(lost_connections_mutex_);
+    lost_connections.swap(lost_connections_);
+  }
+  LOG(kVerbose) << DebugId(kNodeId_) << "  Routing::ConnectionLost with "
+                << lost_connections.size() << " connection(s)";
   {
     std::lock_guard<std::mutex> lock(running_mutex_);
     if (!running_)
       return;
   }
 
-  NodeInfo dropped_node;
-  bool resend(
-      routing_table_.GetNodeInfo(lost_connection_id, dropped_node) &&
-      routing_table_.IsThisNodeInRange(dropped_node.node_id, Parameters::closest_nodes_size));
+  bool resend(false);
+  for (const auto& lost_connection_id : lost_connections) {
+    NodeInfo node;
+    if (routing_table_.GetNodeInfo(lost_connection_id, node) &&
+        routing_table_.IsThisNodeInRange(node.node_id, Parameters::closest_nodes_size))
+      resend = true;
+  }
 
   // Checking routing table
-  dropped_node = routing_table_.DropNode(lost_connection_id, true);
-  if (!dropped_node.node_id.IsZero()) {
+  std::vector<NodeInfo> dropped_nodes(routing_table_.DropNodes(lost_connections, true));
+  for (const auto& dropped_node : dropped_nodes) {
     LOG(kWarning) << "[" << DebugId(kNodeId_) << "]"
                   << "Lost connection with routing node " << DebugId(dropped_node.node_id);
     random_node_helper_.Remove(dropped_node.node_id);
   }
 
-  // Checking non-routing table
-  if (dropped_node.node_id.IsZero()) {
-    resend = false;
-    dropped_node = client_routing_table_.DropConnection(lost_connection_id);
+  for (const auto& lost_connection_id : lost_connections) {
+    // rudp reports connections lost by connection id, which needn't be the peer's node id.
+    if (std::any_of(std::begin(dropped_nodes), std::end(dropped_nodes),
+                    [&lost_connection_id](const NodeInfo& dropped_node) {
+                      return dropped_node.connection_id == lost_connection_id;
+                    }))
+      continue;
+    // Checking non-routing table
+    NodeInfo dropped_node(client_routing_table_.DropConnection(lost_connection_id));
     if (!dropped_node.node_id.IsZero()) {
       LOG(kWarning) << "[" << DebugId(kNodeId_) << "]"
                     << "Lost connection with non-routing node "
                     << HexSubstr(dropped_node.node_id.string());
+    } else if (network_.shortcuts().Drop(lost_connection_id)) {
+      LOG(kVerbose) << "[" << DebugId(kNodeId_) << "]"
+                    << "Lost shortcut connection " << DebugId(lost_connection_id);
     } else if (!network_.bootstrap_connection_id().IsZero() &&
                lost_connection_id == network_.bootstrap_connection_id()) {
       LOG(kWarning) << "[" << DebugId(kNodeId_) << "]"
@@ -610,14 +1239,18 @@ void Routing::Impl::DoOnConnectionLost(const NodeId& lost_connection_id) {
     }
   }
 
+  // Only once the lost connections are out of the routing table, so none is chosen again.
+  for (const auto& lost_connection_id : lost_connections)
+    FailOverRelayLink(lost_connection_id);
+
   if (resend) {
     std::lock_guard<std::mutex> lock(running_mutex_);
     if (!running_)
       return;
     // Close node lost, get more nodes
     LOG(kWarning) << "Lost close node, getting more.";
-    recovery_timer_.expires_from_now(Parameters::recovery_time_lag);
-    recovery_timer_.async_wait([=](const boost::system::error_code &error_code) {
+    recovery_timer_.expires_from_now(recovery_time_lag_.current());
+    AsyncWait(recovery_timer_, [=](const boost::system::error_code &error_code) {
       if (error_code != boost::asio::error::operation_aborted)
         ReSendFindNodeRequest(error_code, true);
     });
@@ -629,6 +1262,7 @@ void Routing::Impl::RemoveNode(const NodeInfo& node, bool internal_rudp_only) {
     return;
 
   network_.Remove(node.connection_id);
+  FailOverRelayLink(node.connection_id);
   if (internal_rudp_only) {  // No recovery
     LOG(kInfo) << "Routing: removed node : " << DebugId(node.node_id)
                << ". Removed internal rudp connection id : " << DebugId(node.connection_id);
@@ -648,8 +1282,8 @@ void Routing::Impl::RemoveNode(const NodeInfo& node, bool internal_rudp_only) {
     // Close node removed by routing, get more nodes
     LOG(kWarning) << "[" << DebugId(kNodeId_)
                   << "] Removed close node, sending find node to get more nodes.";
-    recovery_timer_.expires_from_now(Parameters::recovery_time_lag);
-    recovery_timer_.async_wait([=](const boost::system::error_code & error_code) {
+    recovery_timer_.expires_from_now(recovery_time_lag_.current());
+    AsyncWait(recovery_timer_, [=](const boost::system::error_code & error_code) {
       if (error_code != boost::asio::error::operation_aborted)
         ReSendFindNodeRequest(error_code, true);
     });
@@ -688,16 +1322,26 @@ void Routing::Impl::ReSendFindNodeRequest(const boost::system::error_code& error
     if (ignore_size && (routing_table_.size() > routing_table_.kThresholdSize()))
       num_nodes_requested = static_cast<int>(Parameters::closest_nodes_size);
     else
-      num_nodes_requested = static_cast<int>(Parameters::greedy_fraction);
+      num_nodes_requested = static_cast<int>(routing_table_.kGreedySize());
 
-    protobuf::Message find_node_rpc(rpcs::FindNodes(kNodeId_, kNodeId_, num_nodes_requested));
+    message_handler().StartNodeLookup();
+    protobuf::Message find_node_rpc(kRpcTemplates_.FindNodes(kNodeId_, num_nodes_requested));
     network_.SendToClosestNode(find_node_rpc);
 
+    // Rounds are spaced further apart while the close group is settled, and closer together when
+    // more than a close group's worth of changes were seen since the last round.
+    if (close_group_changes_.exchange(0) > Parameters::closest_nodes_size) {
+      find_node_interval_.Tighten();
+      recovery_time_lag_.Tighten();
+    } else {
+      find_node_interval_.Backoff();
+      recovery_time_lag_.Backoff();
+    }
     std::lock_guard<std::mutex> lock(running_mutex_);
     if (!running_)
       return;
-    recovery_timer_.expires_from_now(Parameters::find_node_interval);
-    recovery_timer_.async_wait([=](boost::system::error_code error_code_local) {
+    recovery_timer_.expires_from_now(find_node_interval_.current());
+    AsyncWait(recovery_timer_, [=](boost::system::error_code error_code_local) {
       if (error_code != boost::asio::error::operation_aborted)
         ReSendFindNodeRequest(error_code_local, false);
     });
@@ -708,8 +1352,9 @@ void Routing::Impl::ReBootstrap() {
   std::lock_guard<std::mutex> lock(running_mutex_);
   if (!running_)
     return;
-  re_bootstrap_timer_.expires_from_now(Parameters::re_bootstrap_time_lag);
-  re_bootstrap_timer_.async_wait([=](boost::system::error_code error_code_local) {
+  re_bootstrap_timer_.expires_from_now(re_bootstrap_time_lag_.current());
+  re_bootstrap_time_lag_.Backoff();
+  AsyncWait(re_bootstrap_timer_, [=](boost::system::error_code error_code_local) {
     if (error_code_local != boost::asio::error::operation_aborted)
       DoReBootstrap(error_code_local);
   });
@@ -740,8 +1385,196 @@ int Routing::Impl::network_status() {
   return network_status_;
 }
 
+uint64_t Routing::Impl::dropped_message_count() const { return ingress_limiter_.dropped_count(); }
+
+std::vector<LatencyHistogram> Routing::Impl::latency_histograms() const {
+  return message_latency_.Histograms();
+}
+
+MetricsSnapshot Routing::Impl::GetMetricsSnapshot() {
+  MetricsSnapshot snapshot;
+  metrics_.Snapshot(snapshot);
+  snapshot.drops[static_cast<size_t>(DropReason::kOverloaded)] = ingress_limiter_.dropped_count();
+  snapshot.routing_table_size = routing_table_.size();
+  snapshot.client_routing_table_size = client_routing_table_.size();
+  snapshot.group_matrix_size = routing_table_.GetMatrixNodes().size();
+  snapshot.timer_tasks_outstanding = timer_.task_count();
+  if (message_handler_built_) {
+    snapshot.connects_queued = message_handler_->queued_connects();
+    snapshot.connects_in_flight = message_handler_->connects_in_flight();
+    snapshot.upcalls_queued = message_handler_->queued_upcalls();
+  }
+  return snapshot;
+}
+
+bool Routing::Impl::UseRoutingSnapshot(const fs::path& path) {
+  snapshot_path_ = path;
+  return ReadRoutingSnapshot(path, snapshot_peers_);
+}
+
+bool Routing::Impl::CaptureMessages(const fs::path& path, uint32_t sample_interval) {
+  try {
+    message_capture_.reset(new MessageCaptureWriter(path, kNodeId_, sample_interval));
+  }
+  catch (const std::exception& e) {
+    LOG(kWarning) << "Can't capture messages to " << path << ": " << e.what();
+    message_capture_.reset();
+  }
+  network_.set_message_capture(message_capture_.get());
+  return message_capture_ != nullptr;
+}
+
+void Routing::Impl::UseNetworkManifest(const std::vector<NodeId>& node_ids) {
+  manifest_peers_.clear();
+  std::copy_if(std::begin(node_ids), std::end(node_ids), std::back_inserter(manifest_peers_),
+               [this](const NodeId& node_id) { return node_id != kNodeId_; });
+  // The closest are the peers the routing table is surest to keep; requests for the rest would
+  // mostly be refused.
+  const size_t kWanted(std::min(manifest_peers_.size(),
+                                static_cast<size_t>(routing_table_.kMaxSize())));
+  std::partial_sort(std::begin(manifest_peers_), std::begin(manifest_peers_) + kWanted,
+                    std::end(manifest_peers_), [this](const NodeId& lhs, const NodeId& rhs) {
+    return NodeId::CloserToTarget(lhs, rhs, kNodeId_);
+  });
+  manifest_peers_.resize(kWanted);
+}
+
+void Routing::Impl::ScheduleRoutingSnapshot() {
+  if (snapshot_path_.empty())
+    return;
+  std::lock_guard<std::mutex> lock(running_mutex_);
+  if (!running_)
+    return;
+  snapshot_timer_.expires_from_now(Parameters::routing_snapshot_interval);
+  AsyncWait(snapshot_timer_, [=](const boost::system::error_code& error_code) {
+    if (error_code == boost::asio::error::operation_aborted)
+      return;
+    SaveRoutingSnapshot();
+    ScheduleRoutingSnapshot();
+  });
+}
+
+void Routing::Impl::ScheduleLinkProbes() {
+  std::lock_guard<std::mutex> lock(running_mutex_);
+  if (!running_)
+    return;
+  link_probe_timer_.expires_from_now(Parameters::link_probe_interval);
+  AsyncWait(link_probe_timer_, [=](const boost::system::error_code& error_code) {
+    if (error_code == boost::asio::error::operation_aborted)
+      return;
+    ProbeLinks();
+    ScheduleLinkProbes();
+  });
+}
+
+void Routing::Impl::ScheduleMatrixDigests() {
+  if (routing_table_.client_mode() ||
+      Parameters::matrix_digest_interval == std::chrono::seconds(0))
+    return;
+  std::lock_guard<std::mutex> lock(running_mutex_);
+  if (!running_)
+    return;
+  matrix_digest_timer_.expires_from_now(Parameters::matrix_digest_interval);
+  AsyncWait(matrix_digest_timer_, [=](const boost::system::error_code& error_code) {
+    if (error_code == boost::asio::error::operation_aborted)
+      return;
+    group_change_handler_.SendRowDigests();
+    ScheduleMatrixDigests();
+  });
+}
+
+void Routing::Impl::ScheduleGroupMatrixPublication() {
+  if (!routing_table_.network_viewer_enabled())
+    return;
+  std::lock_guard<std::mutex> lock(running_mutex_);
+  if (!running_)
+    return;
+  network_viewer_timer_.expires_from_now(Parameters::network_viewer_update_interval);
+  AsyncWait(network_viewer_timer_, [=](const boost::system::error_code& error_code) {
+    if (error_code == boost::asio::error::operation_aborted)
+      return;
+    routing_table_.PublishGroupMatrix();
+    ScheduleGroupMatrixPublication();
+  });
+}
+
+void Routing::Impl::ProbeLinks() {
+  SendBatch batch;
+  std::vector<NodeId> node_ids(routing_table_.GetClosestNodes(kNodeId_, routing_table_.kMaxSize()));
+  const size_t kCloseCount(std::min(node_ids.size(),
+                                    static_cast<size_t>(Parameters::closest_nodes_size)));
+  if (kParameters_.max_link_probes != 0 &&
+      node_ids.size() > kCloseCount + kParameters_.max_link_probes) {
+    // The rest are taken in turn, so each far peer is probed every few rounds.
+    const size_t kFarCount(node_ids.size() - kCloseCount);
+    std::vector<NodeId> probed(node_ids.begin(), node_ids.begin() + kCloseCount);
+    for (uint16_t i(0); i != kParameters_.max_link_probes; ++i)
+      probed.push_back(node_ids[kCloseCount + (link_probe_cursor_ + i) % kFarCount]);
+    link_probe_cursor_ = (link_probe_cursor_ + kParameters_.max_link_probes) % kFarCount;
+    node_ids.swap(probed);
+  }
+  for (const auto& node_id : node_ids) {
+    NodeInfo node;
+    if (!routing_table_.GetNodeInfo(node_id, node))
+      continue;
+    batch.Add(kRpcTemplates_.Ping(node_id, routing_table_.link_quality().ProbeSent(node_id)),
+              node.connection_id);
+  }
+  network_.Send(std::move(batch));
+  for (const auto& idle_connection_id : network_.shortcuts().TakeIdle()) {
+    LOG(kVerbose) << "Closing idle shortcut connection " << DebugId(idle_connection_id);
+    network_.Remove(idle_connection_id);
+  }
+}
+
+void Routing::Impl::SaveRoutingSnapshot() {
+  if (snapshot_path_.empty() || routing_table_.size() == 0)
+    return;
+  std::vector<NodeInfo> nodes;
+  for (const auto& node_id :
+       routing_table_.GetClosestNodes(kNodeId_, routing_table_.kMaxSize())) {
+    NodeInfo node;
+    if (routing_table_.GetNodeInfo(node_id, node))
+      nodes.push_back(node);
+  }
+  if (!WriteRoutingSnapshot(nodes, routing_table_.GetMatrixNodes(), snapshot_path_))
+    LOG(kWarning) << "Failed to save routing snapshot to " << snapshot_path_;
+}
+
+bool Routing::Impl::UseBootstrapCache(const fs::path& path) {
+  return network_.LoadBootstrapCache(path);
+}
+
+CacheStatistics Routing::Impl::cache_statistics() const {
+  return message_handler_built_ ? message_handler_->cache_statistics() : CacheStatistics();
+}
+
+RecoveryIntervals Routing::Impl::recovery_intervals() const {
+  RecoveryIntervals intervals;
+  intervals.find_node_interval = find_node_interval_.current();
+  intervals.recovery_time_lag = recovery_time_lag_.current();
+  intervals.re_bootstrap_time_lag = re_bootstrap_time_lag_.current();
+  intervals.find_close_node_interval = find_close_node_interval_.current();
+  return intervals;
+}
+
+uint32_t Routing::Impl::EstimatedCacheGetCount(const NodeId& destination_id,
+                                               const std::string& request_data) const {
+  return message_handler_built_
+             ? message_handler_->EstimatedCacheGetCount(destination_id, request_data)
+             : 0;
+}
+
+std::shared_ptr<MatrixChange> Routing::Impl::MatrixChangeSince(uint64_t epoch) const {
+  return routing_table_.MatrixChangeSince(epoch);
+}
+
 std::vector<NodeInfo> Routing::Impl::ClosestNodes() { return routing_table_.GetMatrixNodes(); }
 
+std::shared_ptr<const MatrixNodes> Routing::Impl::ClosestNodesSnapshot() const {
+  return routing_table_.matrix_nodes();
+}
+
 bool Routing::Impl::IsConnectedVault(const NodeId& node_id) {
   return routing_table_.IsConnected(node_id);
 }
@@ -19,13 +19,19 @@
 #ifndef MAIDSAFE_ROUTING_ROUTING_IMPL_H_
 #define MAIDSAFE_ROUTING_ROUTING_IMPL_H_
 
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "boost/asio/steady_timer.hpp"
+#include "boost/asio/strand.hpp"
 #include "boost/asio/ip/udp.hpp"
+#include "boost/filesystem/path.hpp"
 #include "boost/system/error_code.hpp"
 
 #include "maidsafe/common/asio_service.h"
@@ -33,16 +39,29 @@
 
 #include "maidsafe/common/rsa.h"
 
+#include "maidsafe/routing/adaptive_interval.h"
 #include "maidsafe/routing/api_config.h"
+#include "maidsafe/routing/change_batcher.h"
 #include "maidsafe/routing/client_routing_table.h"
+#include "maidsafe/routing/group_cache.h"
 #include "maidsafe/routing/group_change_handler.h"
+#include "maidsafe/routing/handler_guard.h"
+#include "maidsafe/routing/ingress_limiter.h"
+#include "maidsafe/routing/message_capture.h"
 #include "maidsafe/routing/message_handler.h"
+#include "maidsafe/routing/message_latency.h"
+#include "maidsafe/routing/metrics.h"
+#include "maidsafe/routing/network_status_filter.h"
 #include "maidsafe/routing/network_utils.h"
+#include "maidsafe/routing/pending_response.h"
 #include "maidsafe/routing/random_node_helper.h"
+#include "maidsafe/routing/recovery_intervals.h"
 #include "maidsafe/routing/remove_furthest_node.h"
 #include "maidsafe/routing/routing_api.h"
 #include "maidsafe/routing/routing.pb.h"
 #include "maidsafe/routing/routing_table.h"
+#include "maidsafe/routing/rpc_templates.h"
+#include "maidsafe/routing/send_scheduler.h"
 #include "maidsafe/routing/timer.h"
 
 namespace maidsafe {
@@ -98,7 +117,9 @@ class GenericNode;
 
 class Routing::Impl {
  public:
-  Impl(bool client_mode, const NodeId& node_id, const asymm::Keys& keys);
+  Impl(bool client_mode, const NodeId& node_id, const asymm::Keys& keys,
+       std::shared_ptr<AsioService> asio_service,
+       const InstanceParameters& parameters = InstanceParameters());
   ~Impl();
 
   void Join(const Functors& functors,
@@ -108,15 +129,26 @@ class Routing::Impl {
   int ZeroStateJoin(const Functors& functors, const boost::asio::ip::udp::endpoint& local_endpoint,
                     const boost::asio::ip::udp::endpoint& peer_endpoint, const NodeInfo& peer_info);
 
+  // New API.  message.contents is moved into the outgoing protobuf rather than copied.
   template <typename T>
-  void Send(const T& message);  // New API
+  void Send(T message);
+
+  void Send(SingleToSingleMessage message, uint16_t path_count);
 
   void SendDirect(const NodeId& destination_id, const std::string& data, bool cacheable,
+                  ResponseFunctor response_functor, uint16_t path_count = 1);
+
+  PendingResponse SendDirect(const NodeId& destination_id, const std::string& data,
+                             bool cacheable);
+
+  void SendStream(const NodeId& destination_id, std::string data,
                   ResponseFunctor response_functor);
 
   void SendGroup(const NodeId& destination_id, const std::string& data, bool cacheable,
                  ResponseFunctor response_functor);
 
+  GroupResponses SendGroup(const NodeId& destination_id, const std::string& data, bool cacheable);
+
   NodeId GetRandomExistingNode() const { return random_node_helper_.Get(); }
 
   bool ClosestToId(const NodeId& node_id);
@@ -125,17 +157,48 @@ class Routing::Impl {
 
   GroupRangeStatus IsNodeIdInGroupRange(const NodeId& group_id, const NodeId& node_id);
 
+  void IsNodeIdInGroupRange(const std::vector<NodeId>& group_ids,
+                            std::vector<GroupRangeStatus>& results);
+
   NodeId RandomConnectedNode();
 
   bool EstimateInGroup(const NodeId& sender_id, const NodeId& info_id);
 
   std::future<std::vector<NodeId>> GetGroup(const NodeId& group_id);
 
+  std::future<std::vector<std::vector<NodeId>>> GetGroups(const std::vector<NodeId>& group_ids);
+
   NodeId kNodeId() const;
 
   int network_status();
 
+  uint64_t dropped_message_count() const;
+
+  std::vector<LatencyHistogram> latency_histograms() const;
+
+  MetricsSnapshot GetMetricsSnapshot();
+  // Records how long the Routing constructor took (see StartupPhase::kConstruct).
+  void ConstructionTimed(std::chrono::steady_clock::duration duration);
+
+  bool UseBootstrapCache(const boost::filesystem::path& path);
+
+  bool UseRoutingSnapshot(const boost::filesystem::path& path);
+
+  void UseNetworkManifest(const std::vector<NodeId>& node_ids);
+
+  bool CaptureMessages(const boost::filesystem::path& path, uint32_t sample_interval);
+
+  CacheStatistics cache_statistics() const;
+
+  RecoveryIntervals recovery_intervals() const;
+
+  uint32_t EstimatedCacheGetCount(const NodeId& destination_id,
+                                  const std::string& request_data) const;
+
+  std::shared_ptr<MatrixChange> MatrixChangeSince(uint64_t epoch) const;
+
   std::vector<NodeInfo> ClosestNodes();
+  std::shared_ptr<const MatrixNodes> ClosestNodesSnapshot() const;
 
   bool IsConnectedVault(const NodeId& node_id);
   bool IsConnectedClient(const NodeId& node_id);
@@ -147,6 +210,9 @@ class Routing::Impl {
   Impl(const Impl&&);
   Impl& operator=(const Impl&);
 
+  // Builds message_handler_, with the threads of its own that it starts, on first use: a Routing
+  // object which only ever sends before it's destroyed never needs it.
+  MessageHandler& message_handler();
   void ConnectFunctors(const Functors& functors);
   void BootstrapFromTheseEndpoints(const std::vector<boost::asio::ip::udp::endpoint>& endpoints);
   void DoJoin(const std::vector<boost::asio::ip::udp::endpoint>& endpoints);
@@ -155,25 +221,75 @@ class Routing::Impl {
   void DoReBootstrap(const boost::system::error_code& error_code);
   void FindClosestNode(const boost::system::error_code& error_code, int attempts);
   void ReSendFindNodeRequest(const boost::system::error_code& error_code, bool ignore_size);
+  void ScheduleRoutingSnapshot();
+  void SaveRoutingSnapshot();
+  // Pings each routing table peer every Parameters::link_probe_interval, for next hop selection,
+  // or if InstanceParameters::max_link_probes is set, the close group and that many others in turn.
+  // Idle shortcuts are closed on the same rounds.
+  void ScheduleLinkProbes();
+  void ProbeLinks();
+  // Sends row digests every Parameters::matrix_digest_interval, if it's non-zero.
+  void ScheduleMatrixDigests();
+  // Publishes routing_table_'s group matrix every Parameters::network_viewer_update_interval, if
+  // network_viewer is running.
+  void ScheduleGroupMatrixPublication();
+  // Unpacks a MessageBundle, if message is one, into its messages.
   void OnMessageReceived(const std::string& message);
-  void DoOnMessageReceived(const std::string& message);
+  void OnUnbundledMessageReceived(const std::string& message);
+  boost::asio::io_service::strand& DispatchStrand(const protobuf::Message& message);
+  // Each handler is wrapped by handler_guard_, as asio_service_ may outlive this.
+  template <typename Handler>
+  void AsyncWait(boost::asio::steady_timer& timer, Handler handler);
+  template <typename Handler>
+  void Post(Handler handler);
+  template <typename Handler>
+  void Post(boost::asio::io_service::strand& strand, Handler handler);
+  void DoOnMessageReceived(protobuf::Message& pb_message,
+                           std::shared_ptr<const std::string> encoded_body,
+                           MessageLatency::Clock::time_point received_time);
+  void QueueClosestNodesUpdate(const std::vector<NodeInfo>& new_nodes,
+                               const std::vector<NodeInfo>& old_nodes);
+  // Delivers what change_batcher_ holds Parameters::change_notification_interval from now.
+  void ScheduleChangeNotifications();
+  void DeliverChangeNotifications();
+  // Passes network_status to the functor unless network_status_filter_ drops or holds it.
+  void FilterNetworkStatus(int network_status);
+  void DeliverHeldNetworkStatus();
+  // Queues lost_connection_id, to be handled with any others lost within
+  // Parameters::connection_loss_batch_interval.
   void OnConnectionLost(const NodeId& lost_connection_id);
-  void DoOnConnectionLost(const NodeId& lost_connection_id);
+  void DoOnConnectionsLost();
   void RemoveNode(const NodeInfo& node, bool internal_rudp_only);
   bool ConfirmGroupMembers(const NodeId& node1, const NodeId& node2);
   void NotifyNetworkStatus(int return_code) const;
+  // True if this node's group matrix covers group_id's group, which is then put in group.
+  bool GetLocalGroup(const NodeId& group_id, std::vector<NodeId>& group);
+  // As the public GetGroup, but passes the group to on_group, possibly before returning.
+  void GetGroup(const NodeId& group_id, std::function<void(std::vector<NodeId>)> on_group);
   void Send(const NodeId& destination_id, const std::string& data,
             const DestinationType& destination_type, bool cacheable,
-            ResponseFunctor response_functor);
-  void SendMessage(const NodeId& destination_id, protobuf::Message& proto_message);
+            ResponseFunctor response_functor, uint16_t path_count = 1);
+  // If path_count is more than 1 and this node has joined, the message is sent along as many
+  // disjoint paths.
+  void SendMessage(const NodeId& destination_id, protobuf::Message& proto_message,
+                   uint16_t path_count = 1);
   void PartiallyJoinedSend(protobuf::Message& proto_message);
+  // Asks for a shortcut to a far destination, or for a group to its closest member, once it's
+  // known (see ShortcutTable).
+  void RequestShortcut(const NodeId& destination_id, bool direct);
+  // Sends a client's request on whichever of its connections RelayLinks chooses, recording it so
+  // that it can be resent on another should that connection be lost.
+  void SendOverRelayLink(std::shared_ptr<protobuf::Message> proto_message);
+  // Resends the requests in flight on a lost or removed connection.
+  void FailOverRelayLink(const NodeId& connection_id);
   protobuf::Message CreateNodeLevelPartialMessage(const NodeId& destination_id,
                                                   const DestinationType& destination_type,
                                                   const std::string& data, bool cacheable);
   void CheckSendParameters(const NodeId& destination_id, const std::string& data);
 
+  // Moves message.contents into the returned protobuf.
   template <typename T>
-  protobuf::Message CreateNodeLevelMessage(const T& message);
+  protobuf::Message CreateNodeLevelMessage(T& message);
   template <typename T>
   void AddGroupSourceRelatedFields(const T& message, protobuf::Message& proto_message,
                                    std::true_type);
@@ -187,8 +303,10 @@ class Routing::Impl {
   std::mutex network_status_mutex_;
   int network_status_;
   NetworkStatistics network_statistics_;
+  const InstanceParameters kParameters_;
   RoutingTable routing_table_;
   const NodeId kNodeId_;
+  const RpcTemplates kRpcTemplates_;
   bool running_;
   std::mutex running_mutex_;
   Functors functors_;
@@ -196,25 +314,72 @@ class Routing::Impl {
   ClientRoutingTable client_routing_table_;
   RemoveFurthestNode remove_furthest_node_;
   GroupChangeHandler group_change_handler_;
+  IngressLimiter ingress_limiter_;
+  MessageLatency message_latency_;
+  Metrics metrics_;
+  GroupCache group_cache_;
+  // Completion states for PendingResponse and GroupResponses, which keep it alive while in use.
+  std::shared_ptr<detail::CompletionPool> response_pool_;
+  // Routing table changes not yet passed on to the functors acting on them.
+  ChangeBatcher change_batcher_;
+  NetworkStatusFilter network_status_filter_;
+  std::mutex lost_connections_mutex_;
+  std::vector<NodeId> lost_connections_;  // not yet handled by DoOnConnectionsLost
+  // Set before Join and not changed afterwards.
+  boost::filesystem::path snapshot_path_;
+  std::vector<NodeId> snapshot_peers_;
+  std::vector<NodeId> manifest_peers_;  // see UseNetworkManifest
+  // Null unless CaptureMessages was called.  Declared before network_, which writes to it.
+  std::unique_ptr<MessageCaptureWriter> message_capture_;
+  // Used in place of the like-named Parameters.
+  AdaptiveInterval find_node_interval_, recovery_time_lag_, re_bootstrap_time_lag_,
+      find_close_node_interval_;
+  std::atomic<uint32_t> close_group_changes_;  // since the last recovery round
+  size_t link_probe_cursor_;  // how far ProbeLinks has got through the peers beyond the close group
   // The following variables' declarations should remain the last ones in this class and should stay
   // in the order: message_handler_, asio_service_, network_, all timers.  This is important for the
   // proper destruction of the routing library, i.e. to avoid segmentation faults.
+  std::once_flag message_handler_once_;
+  std::atomic<bool> message_handler_built_;  // for readers not wanting to build it
   std::unique_ptr<MessageHandler> message_handler_;
-  AsioService asio_service_;
+  std::shared_ptr<AsioService> asio_service_;  // possibly shared with other Routing objects
   NetworkUtils network_;
   Timer<std::string> timer_;
-  boost::asio::steady_timer re_bootstrap_timer_, recovery_timer_, setup_timer_;
+  boost::asio::steady_timer re_bootstrap_timer_, recovery_timer_, setup_timer_,
+      closest_nodes_update_timer_, change_notification_timer_, connection_loss_timer_,
+      snapshot_timer_, link_probe_timer_, network_viewer_timer_, network_status_timer_,
+      matrix_digest_timer_;
+  // Received messages are hashed by sender onto one of these to keep per-peer ordering.
+  std::vector<std::unique_ptr<boost::asio::io_service::strand>> dispatch_strands_;
+  // Last, so that it's closed before anything its handlers use is destroyed; asio_service_ may run
+  // them after this has gone.
+  HandlerGuard handler_guard_;
 };
 
 template <>
-void Routing::Impl::Send(const GroupToSingleRelayMessage& message);
+void Routing::Impl::Send(GroupToSingleRelayMessage message);
 
 template <>
-protobuf::Message Routing::Impl::CreateNodeLevelMessage(const GroupToSingleRelayMessage& message);
+protobuf::Message Routing::Impl::CreateNodeLevelMessage(GroupToSingleRelayMessage& message);
 
 // Implementations
+template <typename Handler>
+void Routing::Impl::AsyncWait(boost::asio::steady_timer& timer, Handler handler) {
+  timer.async_wait(handler_guard_.Wrap(std::move(handler)));
+}
+
+template <typename Handler>
+void Routing::Impl::Post(Handler handler) {
+  asio_service_->service().post(handler_guard_.Wrap(std::move(handler)));
+}
+
+template <typename Handler>
+void Routing::Impl::Post(boost::asio::io_service::strand& strand, Handler handler) {
+  strand.post(handler_guard_.Wrap(std::move(handler)));
+}
+
 template <typename T>
-void Routing::Impl::Send(const T& message) {  // FIXME(Fix caching)
+void Routing::Impl::Send(T message) {  // FIXME(Fix caching)
   assert(!functors_.message_and_caching.message_received &&
          "Not allowed with string type message API");
   protobuf::Message proto_message = CreateNodeLevelMessage(message);
@@ -232,21 +397,24 @@ template <typename T>
 void Routing::Impl::AddGroupSourceRelatedFields(const T&, protobuf::Message&, std::false_type) {}
 
 template <typename T>
-protobuf::Message Routing::Impl::CreateNodeLevelMessage(const T& message) {
+protobuf::Message Routing::Impl::CreateNodeLevelMessage(T& message) {
   protobuf::Message proto_message;
   proto_message.set_destination_id(message.receiver->string());
   proto_message.set_routing_message(false);
-  proto_message.add_data(message.contents);
+  proto_message.add_data()->swap(message.contents);
   proto_message.set_type(static_cast<int32_t>(MessageType::kNodeLevel));
 
   proto_message.set_cacheable(static_cast<int32_t>(message.cacheable));
   proto_message.set_client_node(routing_table_.client_mode());
 
   proto_message.set_request(true);
-  proto_message.set_hops_to_live(Parameters::hops_to_live);
+  SetHopBudget(network_statistics_.HopBudget(), proto_message);
 
   AddGroupSourceRelatedFields(message, proto_message, detail::is_group_source<T>());
   AddDestinationTypeRelatedFields(proto_message, detail::is_group_destination<T>());
+  if (message.compress && message.cacheable == Cacheable::kNone)
+    CompressData(proto_message);
+  SetSendPriority(proto_message);
 //  proto_message.set_id(RandomUint32() % 10000);  // Enable for tracing node level messages
   return proto_message;
 }
@@ -0,0 +1,51 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_ROUTING_LOG_H_
+#define MAIDSAFE_ROUTING_ROUTING_LOG_H_
+
+#include "maidsafe/common/log.h"
+
+#include "maidsafe/routing/parameters.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// True if per-message logging is compiled in and Parameters::message_logging is set.  Building the
+// library with MAIDSAFE_ROUTING_NO_MESSAGE_LOGGING defined (the RoutingMessageLogging CMake option)
+// makes this a constant false, so the logging it guards is removed altogether.
+inline bool MessageLoggingEnabled() {
+#ifdef MAIDSAFE_ROUTING_NO_MESSAGE_LOGGING
+  return false;
+#else
+  return Parameters::message_logging;
+#endif
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+// For logging on the paths every message takes.  Unlike LOG, nothing streamed into it is evaluated
+// unless MessageLoggingEnabled(), so its HexSubstr, DebugId and MessageTypeString calls cost
+// nothing when per-message logging is off.
+#define ROUTING_LOG(level) \
+  if (!::maidsafe::routing::MessageLoggingEnabled()) {} else LOG(level)  // NOLINT
+
+#endif  // MAIDSAFE_ROUTING_ROUTING_LOG_H_
@@ -20,64 +20,89 @@
 
 #include <algorithm>
 #include <bitset>
+#include <chrono>
 #include <limits>
 #include <map>
+#include <string>
+#include <utility>
 
 #include "maidsafe/common/log.h"
 #include "maidsafe/common/utils.h"
-#include "maidsafe/common/tools/network_viewer.h"
 
 #include "maidsafe/routing/parameters.h"
 #include "maidsafe/routing/node_info.h"
 #include "maidsafe/routing/return_codes.h"
 #include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/routing_log.h"
+#include "maidsafe/routing/utils.h"
+#include "maidsafe/routing/xor_distance.h"
 
 namespace maidsafe {
 
 namespace routing {
 
+namespace {
+
+// nodes is sorted by distance from node_id.
+std::shared_ptr<const CloseBoundaries> MakeCloseBoundaries(const NodeId& node_id,
+                                                           const std::vector<NodeInfo>& nodes) {
+  auto boundaries(std::make_shared<CloseBoundaries>());
+  const NodeId kOutOfRange(NodeId(NodeId::kMaxId) ^ node_id);
+  auto nth([&](size_t n) { return nodes.size() < n ? kOutOfRange : nodes[n - 1].node_id; });
+  boundaries->furthest_close_node = nth(Parameters::closest_nodes_size);
+  boundaries->furthest_client_close_node = nth(2 * Parameters::closest_nodes_size);
+  boundaries->close_distance = node_id ^ boundaries->furthest_close_node;
+  return boundaries;
+}
+
+// True if lhs and rhs differ at bit, counted as in RoutingTable::BucketIndex with 0 the lowest.
+bool BitDiffers(const std::string& raw_lhs, const std::string& raw_rhs, int32_t bit) {
+  const size_t kByte(NodeId::kSize - 1 - static_cast<size_t>(bit) / 8);
+  return ((static_cast<unsigned char>(raw_lhs[kByte] ^ raw_rhs[kByte]) >> (bit % 8)) & 1) != 0;
+}
+
+}  // unnamed namespace
+
 RoutingTable::RoutingTable(bool client_mode, const NodeId& node_id, const asymm::Keys& keys,
-                           NetworkStatistics& network_statistics)
+                           NetworkStatistics& network_statistics,
+                           const InstanceParameters& parameters)
     : kClientMode_(client_mode),
       kNodeId_(node_id),
       kConnectionId_(kClientMode_ ? NodeId(NodeId::kRandomId) : kNodeId_),
       kKeys_(keys),
-      kMaxSize_(kClientMode_ ? Parameters::max_routing_table_size_for_client
-                             : Parameters::max_routing_table_size),
-      kThresholdSize_(kClientMode_ ? Parameters::max_routing_table_size_for_client
-                                   : Parameters::routing_table_size_threshold),
+      kMaxSize_(kClientMode_ ? parameters.max_routing_table_size_for_client
+                             : parameters.max_routing_table_size),
+      kThresholdSize_(kClientMode_ ? parameters.max_routing_table_size_for_client
+                                   : parameters.routing_table_size_threshold),
+      kBucketTargetSize_(parameters.bucket_target_size),
+      kGreedySize_(parameters.greedy_fraction),
+      kKeepsMatrixRows_(!kClientMode_ || parameters.client_matrix_rows),
       mutex_(),
-      furthest_closest_node_id_((NodeId(NodeId::kMaxId) ^ node_id)),
+      close_boundaries_(MakeCloseBoundaries(node_id, std::vector<NodeInfo>())),
       remove_node_functor_(),
       network_status_functor_(),
       remove_furthest_node_(),
       connected_group_change_functor_(),
       nodes_(),
       group_matrix_(kNodeId_, client_mode),
-      ipc_message_queue_(),
-      network_statistics_(network_statistics) {
+      matrix_snapshot_writer_(),
+      group_matrix_changed_(false),
+      version_(0),
+      matrix_epoch_(0),
+      matrix_history_(),
+      network_statistics_(network_statistics),
+      link_quality_() {
 #ifdef TESTING
   try {
-    ipc_message_queue_.reset(new boost::interprocess::message_queue(
-        boost::interprocess::open_only, network_viewer::kMessageQueueName.c_str()));
-    if (static_cast<uint16_t>(ipc_message_queue_->get_max_msg_size()) <
-        (Parameters::closest_nodes_size + 1) * Parameters::closest_nodes_size * 2 * NodeId::kSize) {
-      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
-    }
+    matrix_snapshot_writer_.reset(new MatrixSnapshotWriter(kNodeId_));
   }
   catch (const std::exception&) {
-    ipc_message_queue_.reset();
+    matrix_snapshot_writer_.reset();
   }
 #endif
 }
 
-RoutingTable::~RoutingTable() {
-  if (ipc_message_queue_) {
-    network_viewer::MatrixRecord matrix_record(kNodeId_);
-    std::string serialised_matrix(matrix_record.Serialise());
-    ipc_message_queue_->try_send(serialised_matrix.c_str(), serialised_matrix.size(), 0);
-  }
-}
+RoutingTable::~RoutingTable() {}
 
 void RoutingTable::InitialiseFunctors(
     NetworkStatusFunctor network_status_functor,
@@ -127,11 +152,12 @@ bool RoutingTable::AddOrCheckNode(NodeInfo peer, bool remove,
   uint16_t routing_table_size(0);
   std::shared_ptr<MatrixChange> matrix_change;
 
-  if (remove)
+  if (remove) {
     SetBucketIndex(peer);
-  std::vector<NodeId> unique_nodes;
+    CacheEncodedPublicKey(peer);
+  }
   {
-    std::unique_lock<std::mutex> lock(mutex_);
+    std::unique_lock<boost::shared_mutex> lock(mutex_);
     auto found(Find(peer.node_id, lock));
     if (found.first) {
       LOG(kVerbose) << "Node " << DebugId(peer.node_id) << " already in routing table.";
@@ -141,20 +167,16 @@ bool RoutingTable::AddOrCheckNode(NodeInfo peer, bool remove,
     if (MakeSpaceForNodeToBeAdded(peer, remove, removed_node, lock)) {
       if (remove) {
         assert(peer.bucket != NodeInfo::kInvalidBucket);
-        nodes_.push_back(peer);
+        InsertNode(peer, lock);
         old_connected_close_nodes = group_matrix_.GetConnectedPeers();
         matrix_change = UpdateCloseNodeChange(lock, peer, new_connected_close_nodes, matrix_update);
-        if (nodes_.size() > Parameters::greedy_fraction)
+        RecordMatrixChange(matrix_change, lock);
+        if (nodes_.size() > kGreedySize_)
           remove_furthest_node = true;
-        if (nodes_.size() >= Parameters::closest_nodes_size) {
-          NthElementSortFromTarget(kNodeId_, Parameters::closest_nodes_size, lock);
-          furthest_closest_node_id_ = nodes_[Parameters::closest_nodes_size - 1].node_id;
-        }
       }
       return_value = true;
     }
     routing_table_size = static_cast<uint16_t>(nodes_.size());
-    unique_nodes = group_matrix_.GetUniqueNodeIds();
   }
 
   if (return_value && remove) {  // Firing functors on Add only
@@ -170,10 +192,11 @@ bool RoutingTable::AddOrCheckNode(NodeInfo peer, bool remove,
     UpdateConnectedPeersMatrix(new_connected_close_nodes, old_connected_close_nodes);
 
     if ((matrix_change != nullptr) && !matrix_change->OldEqualsToNew()) {
+      std::vector<NodeId> unique_nodes(matrix_change->new_members()->ids);
       network_statistics_.UpdateLocalAverageDistance(unique_nodes);
       if (matrix_change_functor_)
         matrix_change_functor_(matrix_change);
-      IpcSendGroupMatrix();
+      group_matrix_changed_ = true;
     }
 
     if (peer.nat_type == rudp::NatType::kOther) {  // Usable as bootstrap endpoint
@@ -194,37 +217,38 @@ NodeInfo RoutingTable::DropNode(const NodeId& node_to_drop, bool routing_only) {
   std::vector<NodeInfo> new_connected_close_nodes, old_connected_close_nodes;
   NodeInfo dropped_node;
   std::shared_ptr<MatrixChange> matrix_change;
-  std::vector<NodeId> unique_nodes;
+  // Includes any close node added in place of the dropped one, unlike matrix_change.
+  std::shared_ptr<const MatrixMembers> members;
   {
-    std::unique_lock<std::mutex> lock(mutex_);
+    std::unique_lock<boost::shared_mutex> lock(mutex_);
     auto found(Find(node_to_drop, lock));
     if (found.first) {
       dropped_node = *found.second;
       nodes_.erase(found.second);
+      MembershipChanged(lock);
+      link_quality_.Remove(node_to_drop);
       old_connected_close_nodes = group_matrix_.GetConnectedPeers();
       matrix_change = group_matrix_.RemoveConnectedPeer(dropped_node);
       new_connected_close_nodes = group_matrix_.GetConnectedPeers();
       if (new_connected_close_nodes.size() != old_connected_close_nodes.size()) {
         if (nodes_.size() >= Parameters::closest_nodes_size) {
-          PartialSortFromTarget(kNodeId_, Parameters::closest_nodes_size, lock);
-          furthest_closest_node_id_ = nodes_[Parameters::closest_nodes_size - 1].node_id;
           group_matrix_.AddConnectedPeer(nodes_[Parameters::closest_nodes_size - 1]);
           new_connected_close_nodes = group_matrix_.GetConnectedPeers();
-        } else {
-          furthest_closest_node_id_ = (NodeId(NodeId::kMaxId) ^ kNodeId_);
         }
       }
     }
-    unique_nodes = group_matrix_.GetUniqueNodeIds();
+    members = group_matrix_.members();
+    RecordMatrixChange(matrix_change, lock);
   }
 
   UpdateConnectedPeersMatrix(new_connected_close_nodes, old_connected_close_nodes);
 
   if ((matrix_change != nullptr) && !matrix_change->OldEqualsToNew()) {
+    std::vector<NodeId> unique_nodes(members->ids);
     network_statistics_.UpdateLocalAverageDistance(unique_nodes);
     if (matrix_change_functor_)
       matrix_change_functor_(matrix_change);
-    IpcSendGroupMatrix();
+    group_matrix_changed_ = true;
   }
 
   if (!dropped_node.node_id.IsZero()) {
@@ -243,13 +267,185 @@ NodeInfo RoutingTable::DropNode(const NodeId& node_to_drop, bool routing_only) {
   return dropped_node;
 }
 
+// Peers are taken closest first, so that those joining the close group displace as few others as
+// possible.  If the table has room for them all, nothing can be evicted, and they are merged into
+// nodes_ in one pass rather than inserted one at a time.
+std::vector<NodeInfo> RoutingTable::AddNodes(std::vector<NodeInfo> peers) {
+  peers.erase(std::remove_if(std::begin(peers), std::end(peers), [this](const NodeInfo & peer) {
+                if (peer.node_id.IsZero() || peer.node_id == kNodeId_ ||
+                    !asymm::ValidateKey(peer.public_key)) {
+                  LOG(kInfo) << "Not adding invalid node " << DebugId(peer.node_id);
+                  return true;
+                }
+                return false;
+              }),
+              std::end(peers));
+  for (auto& peer : peers) {
+    SetBucketIndex(peer);
+    CacheEncodedPublicKey(peer);
+  }
+  auto closer([this](const NodeInfo & lhs, const NodeInfo & rhs) {
+    return NodeId::CloserToTarget(lhs.node_id, rhs.node_id, kNodeId_);
+  });
+  std::sort(std::begin(peers), std::end(peers), closer);
+  peers.erase(std::unique(std::begin(peers), std::end(peers),
+                          [](const NodeInfo & lhs, const NodeInfo & rhs) {
+                return lhs.node_id == rhs.node_id;
+              }),
+              std::end(peers));
+
+  std::vector<NodeInfo> added_nodes, removed_nodes, new_connected_close_nodes,
+      old_connected_close_nodes;
+  std::shared_ptr<MatrixChange> matrix_change;
+  bool remove_furthest_node(false);
+  uint16_t routing_table_size(0);
+  {
+    std::unique_lock<boost::shared_mutex> lock(mutex_);
+    auto old_members(group_matrix_.members());
+    old_connected_close_nodes = group_matrix_.GetConnectedPeers();
+    const bool kMerge(nodes_.size() + peers.size() <= kMaxSize_);
+    for (const auto& peer : peers) {
+      NodeInfo removed_node;
+      if (Find(peer.node_id, lock).first ||
+          !MakeSpaceForNodeToBeAdded(peer, true, removed_node, lock))
+        continue;
+      if (kMerge) {
+        if (std::any_of(std::begin(added_nodes), std::end(added_nodes),
+                        [&peer](const NodeInfo & added) {
+              return *added.encoded_public_key == *peer.encoded_public_key;
+            }))
+          continue;
+      } else {
+        InsertNode(peer, lock);
+      }
+      added_nodes.push_back(peer);
+      if (!removed_node.node_id.IsZero()) {
+        auto removed_added(std::find_if(std::begin(added_nodes), std::end(added_nodes),
+                                        [&removed_node](const NodeInfo & added) {
+          return added.node_id == removed_node.node_id;
+        }));
+        if (removed_added != std::end(added_nodes))
+          added_nodes.erase(removed_added);
+        removed_nodes.push_back(removed_node);
+      }
+    }
+    if (kMerge && !added_nodes.empty()) {
+      auto middle(nodes_.insert(std::end(nodes_), std::begin(added_nodes), std::end(added_nodes)));
+      std::inplace_merge(std::begin(nodes_), middle, std::end(nodes_), closer);
+      MembershipChanged(lock);
+    }
+
+    for (const auto& peer : added_nodes) {
+      if (nodes_.size() <= Parameters::closest_nodes_size ||
+          !NodeId::CloserToTarget(nodes_[Parameters::closest_nodes_size - 1].node_id,
+                                  peer.node_id, kNodeId_))
+        group_matrix_.AddConnectedPeer(peer);
+    }
+    new_connected_close_nodes = group_matrix_.GetConnectedPeers();
+    matrix_change = std::make_shared<MatrixChange>(
+        MatrixChange(kNodeId_, std::move(old_members), group_matrix_.members()));
+    RecordMatrixChange(matrix_change, lock);
+    remove_furthest_node = nodes_.size() > kGreedySize_;
+    routing_table_size = static_cast<uint16_t>(nodes_.size());
+  }
+
+  if (added_nodes.empty() && removed_nodes.empty())
+    return added_nodes;
+
+  UpdateNetworkStatus(routing_table_size);
+  for (const auto& removed_node : removed_nodes) {
+    LOG(kVerbose) << "Routing table removed node id : " << DebugId(removed_node.node_id)
+                  << ", connection id : " << DebugId(removed_node.connection_id);
+    if (remove_node_functor_)
+      remove_node_functor_(removed_node, false);
+  }
+  UpdateConnectedPeersMatrix(new_connected_close_nodes, old_connected_close_nodes);
+  if (!matrix_change->OldEqualsToNew()) {
+    std::vector<NodeId> unique_nodes(matrix_change->new_members()->ids);
+    network_statistics_.UpdateLocalAverageDistance(unique_nodes);
+    if (matrix_change_functor_)
+      matrix_change_functor_(matrix_change);
+    group_matrix_changed_ = true;
+  }
+  if (remove_furthest_node) {
+    LOG(kVerbose) << "[" << DebugId(kNodeId_) << "] Removing furthest node....";
+    if (remove_furthest_node_)
+      remove_furthest_node_();
+  }
+  LOG(kInfo) << PrintRoutingTable();
+  return added_nodes;
+}
+
+// Close group places vacated by the dropped nodes are refilled from the closest remaining nodes
+// once all have gone.
+std::vector<NodeInfo> RoutingTable::DropNodes(const std::vector<NodeId>& nodes_to_drop,
+                                              bool routing_only) {
+  std::vector<NodeInfo> dropped_nodes, new_connected_close_nodes, old_connected_close_nodes;
+  std::shared_ptr<MatrixChange> matrix_change;
+  uint16_t routing_table_size(0);
+  {
+    std::unique_lock<boost::shared_mutex> lock(mutex_);
+    auto old_members(group_matrix_.members());
+    old_connected_close_nodes = group_matrix_.GetConnectedPeers();
+    for (const auto& node_to_drop : nodes_to_drop) {
+      auto found(Find(node_to_drop, lock));
+      if (!found.first)
+        continue;
+      dropped_nodes.push_back(*found.second);
+      nodes_.erase(found.second);
+      link_quality_.Remove(node_to_drop);
+      group_matrix_.RemoveConnectedPeer(dropped_nodes.back());
+    }
+    if (!dropped_nodes.empty()) {
+      MembershipChanged(lock);
+      std::vector<NodeInfo> connected_close_nodes(group_matrix_.GetConnectedPeers());
+      size_t close_count(std::min(nodes_.size(),
+                                  static_cast<size_t>(Parameters::closest_nodes_size)));
+      for (size_t i(0); i != close_count; ++i) {
+        if (std::none_of(std::begin(connected_close_nodes), std::end(connected_close_nodes),
+                         [&](const NodeInfo & connected) {
+              return connected.node_id == nodes_[i].node_id;
+            }))
+          group_matrix_.AddConnectedPeer(nodes_[i]);
+      }
+    }
+    new_connected_close_nodes = group_matrix_.GetConnectedPeers();
+    matrix_change = std::make_shared<MatrixChange>(
+        MatrixChange(kNodeId_, std::move(old_members), group_matrix_.members()));
+    RecordMatrixChange(matrix_change, lock);
+    routing_table_size = static_cast<uint16_t>(nodes_.size());
+  }
+
+  if (dropped_nodes.empty())
+    return dropped_nodes;
+
+  UpdateConnectedPeersMatrix(new_connected_close_nodes, old_connected_close_nodes);
+  if (!matrix_change->OldEqualsToNew()) {
+    std::vector<NodeId> unique_nodes(matrix_change->new_members()->ids);
+    network_statistics_.UpdateLocalAverageDistance(unique_nodes);
+    if (matrix_change_functor_)
+      matrix_change_functor_(matrix_change);
+    group_matrix_changed_ = true;
+  }
+  UpdateNetworkStatus(routing_table_size);
+  for (const auto& dropped_node : dropped_nodes) {
+    LOG(kVerbose) << DebugId(kNodeId()) << "Routing table dropped node id : "
+                  << DebugId(dropped_node.node_id) << ", connection id : "
+                  << DebugId(dropped_node.connection_id);
+    if (remove_node_functor_ && !routing_only)
+      remove_node_functor_(dropped_node, false);
+  }
+  LOG(kInfo) << PrintRoutingTable();
+  return dropped_nodes;
+}
+
 bool RoutingTable::IsThisNodeGroupLeader(const NodeId& target_id, NodeInfo& connected_peer) {
   NodeId current_closest_id(kNodeId_);
   NodeId closest_peer_id(GetClosestNode(target_id, true).node_id);
   if (NodeId::CloserToTarget(closest_peer_id, current_closest_id, target_id))
     current_closest_id = closest_peer_id;
 
-  std::unique_lock<std::mutex> lock(mutex_);
+  boost::shared_lock<boost::shared_mutex> lock(mutex_);
   group_matrix_.GetBetterNodeForSendingMessage(target_id, true, current_closest_id);
   if (current_closest_id != kNodeId_) {
     auto found(Find(current_closest_id, lock));
@@ -262,44 +458,60 @@ bool RoutingTable::IsThisNodeGroupLeader(const NodeId& target_id, NodeInfo& conn
 }
 
 bool RoutingTable::IsThisNodeGroupLeader(const NodeId& target_id, NodeInfo& connected_peer,
-                                         const std::vector<std::string>& exclude) {
+                                         const RouteHistory& exclude) {
+  GroupRoute route(RouteGroup(target_id, exclude, 0));
+  if (!route.leader)
+    connected_peer = route.next_hop;
+  return route.leader;
+}
+
+GroupRoute RoutingTable::RouteGroup(const NodeId& target_id, const RouteHistory& exclude,
+                                    uint16_t replicas) {
+  GroupRoute route;
+  boost::shared_lock<boost::shared_mutex> lock(mutex_);
   NodeInfo current_closest;
   current_closest.node_id = kNodeId_;
-  NodeInfo closest_peer(GetClosestNode(target_id, exclude, true));
+  NodeInfo closest_peer(GetClosestNodeExcluding(target_id, exclude, true, lock));
   if (NodeId::CloserToTarget(closest_peer.node_id, current_closest.node_id, target_id))
     current_closest = closest_peer;
-  {
-    std::unique_lock<std::mutex> lock(mutex_);
-    group_matrix_.GetBetterNodeForSendingMessage(target_id, exclude, true, current_closest);
-    if (current_closest.node_id != kNodeId_) {
-      auto found(Find(current_closest.node_id, lock));
-      if (found.first) {
-        connected_peer = *found.second;
-        return false;
-      }
+  group_matrix_.GetBetterNodeForSendingMessage(target_id, exclude, true, current_closest);
+  if (current_closest.node_id != kNodeId_) {
+    auto found(Find(current_closest.node_id, lock));
+    if (found.first) {
+      route.next_hop = *found.second;
+      return route;
     }
   }
-  for (const auto& excluded : exclude) {
-    try {
-      NodeId excluded_id(excluded);
-      if (excluded_id != target_id && NodeId::CloserToTarget(excluded_id, kNodeId_, target_id)) {
-        if (connected_peer.node_id.IsZero())
-          connected_peer = closest_peer;
-        return false;
-      }
-    }
-    catch (const std::exception& ex) {
-      LOG(kError) << "Got invalid string for Node ID. Exception: " << ex.what();
-    }
+  if (exclude.HasCloserThan(kNodeId_, target_id)) {
+    route.next_hop = closest_peer;
+    return route;
   }
-  return true;
+
+  route.leader = true;
+  if (replicas == 0)
+    return route;
+  // Two more than needed are ranked, as the target and this node may be among them.
+  for (const auto& member : RankFromTarget(group_matrix_.unique_nodes_.begin(),
+                                           group_matrix_.unique_nodes_.end(), target_id,
+                                           static_cast<size_t>(replicas) + 2)) {
+    if (member->node_id == target_id || member->node_id == kNodeId_)
+      continue;
+    if (route.connected_members.size() + route.other_members.size() == replicas)
+      break;
+    auto found(Find(member->node_id, lock));
+    if (found.first)
+      route.connected_members.push_back(*found.second);
+    else
+      route.other_members.push_back(*member);
+  }
+  return route;
 }
 
 bool RoutingTable::ClosestToId(const NodeId& target_id) {
   if (target_id == kNodeId_)
     return false;
 
-  std::unique_lock<std::mutex> lock(mutex_);
+  boost::shared_lock<boost::shared_mutex> lock(mutex_);
   if (nodes_.empty())  // should return false ?
     return true;
 
@@ -310,11 +522,11 @@ bool RoutingTable::ClosestToId(const NodeId& target_id) {
       return NodeId::CloserToTarget(kNodeId_, nodes_.at(0).node_id, target_id);
   }
 
-  PartialSortFromTarget(target_id, 2, lock);
+  std::vector<NodeInfo> closest_nodes(GetClosestFromTarget(target_id, 2, lock));
   uint16_t index(0);
-  if (nodes_.at(0).node_id == target_id)
+  if (closest_nodes.at(0).node_id == target_id)
     index = 1;
-  if (!NodeId::CloserToTarget(kNodeId_, nodes_.at(index).node_id, target_id))
+  if (!NodeId::CloserToTarget(kNodeId_, closest_nodes.at(index).node_id, target_id))
     return false;
 
   return group_matrix_.ClosestToId(target_id);
@@ -326,37 +538,41 @@ GroupRangeStatus RoutingTable::IsNodeIdInGroupRange(const NodeId& group_id) cons
 
 GroupRangeStatus RoutingTable::IsNodeIdInGroupRange(const NodeId& group_id,
                                                     const NodeId& node_id) const {
-  std::lock_guard<std::mutex> lock(mutex_);
+  // The group matrix publishes what this needs as a snapshot, so no lock is taken.
   return group_matrix_.IsNodeIdInGroupRange(group_id, node_id);
 }
 
+void RoutingTable::IsNodeIdInGroupRange(const std::vector<NodeId>& group_ids,
+                                        std::vector<GroupRangeStatus>& results) const {
+  auto group_range(group_matrix_.group_range());
+  results.resize(group_ids.size());
+  for (size_t i(0); i != group_ids.size(); ++i)
+    results[i] = group_range->IsNodeIdInGroupRange(group_ids[i], kNodeId_);
+}
+
 NodeId RoutingTable::RandomConnectedNode() {
-  std::unique_lock<std::mutex> lock(mutex_);
+  boost::shared_lock<boost::shared_mutex> lock(mutex_);
   assert(nodes_.size() > Parameters::closest_nodes_size &&
          "Shouldn't call RandomConnectedNode when routing table size is <= closest_nodes_size");
   if (nodes_.size() <= Parameters::closest_nodes_size)
     return NodeId();
 
-  PartialSortFromTarget(kNodeId_, static_cast<uint16_t>(nodes_.size()), lock);
   size_t index(Parameters::closest_nodes_size +
                RandomUint32() % (nodes_.size() - Parameters::closest_nodes_size));
   return nodes_.at(index).node_id;
 }
 
-std::vector<NodeInfo> RoutingTable::GetMatrixNodes() {
-  std::lock_guard<std::mutex> lock(mutex_);
-  return group_matrix_.GetUniqueNodes();
-}
+std::vector<NodeInfo> RoutingTable::GetMatrixNodes() { return matrix_nodes()->nodes; }
 
 bool RoutingTable::IsConnected(const NodeId& node_id) {
   if (Contains(node_id))
     return true;
-  std::lock_guard<std::mutex> lock(mutex_);
+  boost::shared_lock<boost::shared_mutex> lock(mutex_);
   return group_matrix_.Contains(node_id);
 }
 
 bool RoutingTable::GetNodeInfo(const NodeId& node_id, NodeInfo& peer) const {
-  std::unique_lock<std::mutex> lock(mutex_);
+  boost::shared_lock<boost::shared_mutex> lock(mutex_);
   auto found(Find(node_id, lock));
   if (found.first)
     peer = *found.second;
@@ -364,10 +580,9 @@ bool RoutingTable::GetNodeInfo(const NodeId& node_id, NodeInfo& peer) const {
 }
 
 bool RoutingTable::IsThisNodeInRange(const NodeId& target_id, const uint16_t range) {
-  std::unique_lock<std::mutex> lock(mutex_);
+  boost::shared_lock<boost::shared_mutex> lock(mutex_);
   if (nodes_.size() < range)
     return true;
-  NthElementSortFromTarget(kNodeId_, range, lock);
   return NodeId::CloserToTarget(target_id, nodes_[range - 1].node_id, kNodeId_);
 }
 
@@ -396,28 +611,59 @@ bool RoutingTable::IsThisNodeClosestToIncludingMatrix(const NodeId& target_id,
     return false;
 
   NodeId connected_peer;
-  std::lock_guard<std::mutex> lock(mutex_);
+  boost::shared_lock<boost::shared_mutex> lock(mutex_);
   return group_matrix_.IsThisNodeGroupLeader(target_id, connected_peer);  // use connected peer?
 }
 
 bool RoutingTable::Contains(const NodeId& node_id) const {
-  std::unique_lock<std::mutex> lock(mutex_);
+  boost::shared_lock<boost::shared_mutex> lock(mutex_);
   return Find(node_id, lock).first;
 }
 
-bool RoutingTable::ConfirmGroupMembers(const NodeId& node1, const NodeId& node2) {
-  NodeId difference = kNodeId_ ^ FurthestCloseNode();
-  return (node1 ^ node2) < difference;
+RouteClassification RoutingTable::ClassifyRoute(const NodeId& target_id) const {
+  RouteClassification route;
+  boost::shared_lock<boost::shared_mutex> lock(mutex_);
+  route.table_size = nodes_.size();
+  auto in_range([&](uint16_t range) {
+    return nodes_.size() < range ||
+           NodeId::CloserToTarget(target_id, nodes_[range - 1].node_id, kNodeId_);
+  });
+  route.in_group_range = in_range(Parameters::group_size);
+  route.in_close_range = in_range(Parameters::closest_nodes_size);
+  route.target_connected = Find(target_id, lock).first;
+  if (target_id.IsZero())
+    return route;
+  // As GetClosestNode, with and without ignoring an exact match.
+  std::vector<NodeInfo> closest_nodes(GetClosestFromTarget(target_id, 2, lock));
+  auto closer_than([&](size_t index) {
+    return index >= closest_nodes.size() ||
+           NodeId::CloserToTarget(kNodeId_, closest_nodes[index].node_id, target_id);
+  });
+  route.closest = closer_than(0);
+  route.closest_ignoring_target = route.target_connected ? closer_than(1) : route.closest;
+  return route;
+}
+
+bool RoutingTable::ConfirmGroupMembers(const NodeId& node1, const NodeId& node2) const {
+  return (node1 ^ node2) < close_boundaries()->close_distance;
+}
+
+std::shared_ptr<const CloseBoundaries> RoutingTable::close_boundaries() const {
+  return std::atomic_load(&close_boundaries_);
 }
 
 void RoutingTable::GroupUpdateFromConnectedPeer(const NodeId& peer,
-                                                const std::vector<NodeInfo>& nodes) {
+                                                const std::vector<NodeInfo>& nodes,
+                                                uint32_t version) {
+  if (!kKeepsMatrixRows_)
+    return;
   std::shared_ptr<MatrixChange> matrix_change;
   std::vector<NodeInfo> new_connected_peers, old_connected_peers;
   {
-    std::unique_lock<std::mutex> lock(mutex_);
-    std::vector<NodeId> old_unique_ids(group_matrix_.GetUniqueNodeIds());
+    std::unique_lock<boost::shared_mutex> lock(mutex_);
     old_connected_peers = group_matrix_.GetConnectedPeers();
+    // Taken before peer is added, so that the change reported includes peer itself.
+    auto old_members(group_matrix_.members());
     if (std::find_if(old_connected_peers.begin(), old_connected_peers.end(),
                      [peer](const NodeInfo & node_info) { return node_info.node_id == peer; }) ==
         old_connected_peers.end()) {
@@ -426,12 +672,85 @@ void RoutingTable::GroupUpdateFromConnectedPeer(const NodeId& peer,
         return;
       group_matrix_.AddConnectedPeer(*found.second);
     }
-    matrix_change = group_matrix_.UpdateFromConnectedPeer(peer, nodes, old_unique_ids);
+    matrix_change =
+        group_matrix_.UpdateFromConnectedPeer(peer, nodes, version, std::move(old_members));
+    RecordMatrixChange(matrix_change, lock);
+    new_connected_peers = group_matrix_.GetConnectedPeers();
+  }
+  if (matrix_change_functor_ && !matrix_change->OldEqualsToNew())
+    matrix_change_functor_(matrix_change);
+  UpdateConnectedPeersMatrix(new_connected_peers, old_connected_peers);
+}
+
+bool RoutingTable::GroupDeltaFromConnectedPeer(const NodeId& peer,
+                                               const std::vector<NodeInfo>& added_nodes,
+                                               const std::vector<NodeId>& removed_nodes,
+                                               uint32_t base_version, uint32_t version) {
+  std::shared_ptr<MatrixChange> matrix_change;
+  std::vector<NodeInfo> new_connected_peers, old_connected_peers;
+  {
+    std::unique_lock<boost::shared_mutex> lock(mutex_);
+    old_connected_peers = group_matrix_.GetConnectedPeers();
+    matrix_change = group_matrix_.PatchFromConnectedPeer(peer, added_nodes, removed_nodes,
+                                                         base_version, version);
+    if (!matrix_change)
+      return false;
+    RecordMatrixChange(matrix_change, lock);
     new_connected_peers = group_matrix_.GetConnectedPeers();
   }
-  if (!matrix_change->OldEqualsToNew() && matrix_change_functor_)
+  if (matrix_change_functor_ && !matrix_change->OldEqualsToNew())
     matrix_change_functor_(matrix_change);
   UpdateConnectedPeersMatrix(new_connected_peers, old_connected_peers);
+  return true;
+}
+
+bool RoutingTable::GroupRowMatchesDigest(const NodeId& peer, uint32_t version,
+                                         uint64_t digest) const {
+  boost::shared_lock<boost::shared_mutex> lock(mutex_);
+  return group_matrix_.RowMatchesDigest(peer, version, digest);
+}
+
+uint64_t RoutingTable::matrix_epoch() const {
+  boost::shared_lock<boost::shared_mutex> lock(mutex_);
+  return matrix_epoch_;
+}
+
+std::shared_ptr<MatrixChange> RoutingTable::MatrixChangeSince(uint64_t epoch) const {
+  boost::shared_lock<boost::shared_mutex> lock(mutex_);
+  if (epoch > matrix_epoch_)
+    return nullptr;
+  // The matrix as it was at epoch is what the change after it started from.  Changes the matrix
+  // goes through unreported (e.g. re-adding a close peer on a drop) are picked up by ending at the
+  // matrix as it is now.
+  std::shared_ptr<const MatrixMembers> old_members;
+  if (epoch == matrix_epoch_) {
+    old_members = group_matrix_.members();
+  } else {
+    // matrix_history_ ends with the matrix before the change at matrix_epoch_.
+    if (epoch + matrix_history_.size() < matrix_epoch_)
+      return nullptr;
+    old_members = matrix_history_[static_cast<size_t>(epoch + matrix_history_.size() -
+                                                      matrix_epoch_)];
+  }
+  auto matrix_change(std::make_shared<MatrixChange>(
+      MatrixChange(kNodeId_, std::move(old_members), group_matrix_.members())));
+  matrix_change->epoch_ = matrix_epoch_;
+  return matrix_change;
+}
+
+void RoutingTable::RecordMatrixChange(const std::shared_ptr<MatrixChange>& matrix_change,
+                                      std::unique_lock<boost::shared_mutex>& lock) {
+  assert(lock.owns_lock());
+  static_cast<void>(lock);
+  // Without a functor the group update paths don't collect the old matrix, and there's no
+  // consumer to catch up.
+  if (!matrix_change_functor_ || !matrix_change || matrix_change->OldEqualsToNew() ||
+      Parameters::matrix_epoch_history == 0)
+    return;
+  matrix_change->epoch_ = ++matrix_epoch_;
+  matrix_history_.push_back(matrix_change->old_members_);
+  while (matrix_history_.size() > Parameters::matrix_epoch_history)
+    matrix_history_.pop_front();
 }
 
 void RoutingTable::UpdateConnectedPeersMatrix(const std::vector<NodeInfo>& new_connected_peers,
@@ -447,15 +766,16 @@ void RoutingTable::UpdateConnectedPeersMatrix(const std::vector<NodeInfo>& new_c
 }
 
 std::shared_ptr<MatrixChange> RoutingTable::UpdateCloseNodeChange(
-    std::unique_lock<std::mutex>& lock, const NodeInfo& peer,
+    std::unique_lock<boost::shared_mutex>& lock, const NodeInfo& peer,
     std::vector<NodeInfo>& new_connected_nodes, const std::vector<NodeInfo>& matrix_update) {
   assert(lock.owns_lock());
+  static_cast<void>(lock);
   std::shared_ptr<MatrixChange> matrix_change;
-  PartialSortFromTarget(kNodeId_, Parameters::closest_nodes_size, lock);
   if ((nodes_.size() < Parameters::closest_nodes_size ||
        !NodeId::CloserToTarget(nodes_[Parameters::closest_nodes_size - 1].node_id, peer.node_id,
                                kNodeId_))) {
-    matrix_change = group_matrix_.AddConnectedPeer(peer, matrix_update);
+    matrix_change = group_matrix_.AddConnectedPeer(
+        peer, kKeepsMatrixRows_ ? matrix_update : std::vector<NodeInfo>());
   }
   new_connected_nodes = group_matrix_.GetConnectedPeers();
   return matrix_change;
@@ -463,8 +783,14 @@ std::shared_ptr<MatrixChange> RoutingTable::UpdateCloseNodeChange(
 
 // bucket 0 is us, 511 is furthest bucket (should fill first)
 void RoutingTable::SetBucketIndex(NodeInfo& node_info) const {
+  node_info.bucket = BucketIndex(node_info.node_id);
+}
+
+// The bucket is the index of the most significant bit in which node_id differs from kNodeId_, so
+// every node in a given bucket is further from kNodeId_ than every node in a lower bucket.
+int32_t RoutingTable::BucketIndex(const NodeId& node_id) const {
   std::string holder_raw_id(kNodeId_.string());
-  std::string node_raw_id(node_info.node_id.string());
+  std::string node_raw_id(node_id.string());
   int16_t byte_index(0);
   while (byte_index != NodeId::kSize) {
     if (holder_raw_id[byte_index] != node_raw_id[byte_index]) {
@@ -476,21 +802,22 @@ void RoutingTable::SetBucketIndex(NodeInfo& node_info) const {
           break;
         ++bit_index;
       }
-      node_info.bucket = (8 * (NodeId::kSize - byte_index)) - bit_index - 1;
-      return;
+      return (8 * (NodeId::kSize - byte_index)) - bit_index - 1;
     }
     ++byte_index;
   }
-  node_info.bucket = 0;
+  return 0;
 }
 
 bool RoutingTable::CheckPublicKeyIsUnique(const NodeInfo& node,
-                                          std::unique_lock<std::mutex>& lock) const {
+                                          std::unique_lock<boost::shared_mutex>& lock) const {
   assert(lock.owns_lock());
   static_cast<void>(lock);
-  // If we already have a duplicate public key return false
-  if (std::find_if(nodes_.begin(), nodes_.end(), [node](const NodeInfo & node_info) {
-        return asymm::MatchingKeys(node_info.public_key, node.public_key);
+  // If we already have a duplicate public key return false.  Every node held, and node, has its key
+  // encoded already, so this compares bytes rather than encoding each key again.
+  assert(node.encoded_public_key);
+  if (std::find_if(nodes_.begin(), nodes_.end(), [&node](const NodeInfo & node_info) {
+        return *node_info.encoded_public_key == *node.encoded_public_key;
       }) != nodes_.end()) {
     LOG(kInfo) << "Already have node with this public key";
     return false;
@@ -514,7 +841,7 @@ bool RoutingTable::CheckPublicKeyIsUnique(const NodeInfo& node,
 
 bool RoutingTable::MakeSpaceForNodeToBeAdded(const NodeInfo& node, bool remove,
                                              NodeInfo& removed_node,
-                                             std::unique_lock<std::mutex>& lock) {
+                                             std::unique_lock<boost::shared_mutex>& lock) {
   assert(lock.owns_lock());
 
   if (remove && !CheckPublicKeyIsUnique(node, lock))
@@ -523,7 +850,6 @@ bool RoutingTable::MakeSpaceForNodeToBeAdded(const NodeInfo& node, bool remove,
   if (nodes_.size() < kMaxSize_)
     return true;
 
-  PartialSortFromTarget(kNodeId_, Parameters::closest_nodes_size, lock);
   NodeInfo furthest_close_node = nodes_[Parameters::closest_nodes_size - 1];
   auto const furthest_close_node_iter = nodes_.begin() + (Parameters::closest_nodes_size - 1);
 
@@ -537,83 +863,194 @@ bool RoutingTable::MakeSpaceForNodeToBeAdded(const NodeInfo& node, bool remove,
     return true;
   }
 
-  uint16_t size(Parameters::bucket_target_size + 1);
-  for (auto it = furthest_close_node_iter; it != nodes_.end(); ++it) {
-    if (node.bucket >= (*it).bucket)  // Stop searching as it's worthless
-      return false;
-    // Safety net
-    if ((nodes_.end() - it) < size)  // Reached end of checkable area
-      return false;
+  // Otherwise space is made in the largest bucket further from this node than node's own, so long
+  // as it holds more than kBucketTargetSize_ + 1 nodes and at least two more than node's bucket
+  // will, which keeps the buckets balanced rather than letting the most populous far ones crowd
+  // out the nearer ones.  Of equally large buckets, the furthest gives up a node.
+  auto bucket_upper_bound([this](int32_t bucket, std::vector<NodeInfo>::iterator from) {
+    return std::upper_bound(from, nodes_.end(), bucket,
+                            [](int32_t lhs, const NodeInfo & rhs) { return lhs < rhs.bucket; });
+  });
+  // CheckNode's node has no bucket set.
+  const int32_t kBucket(BucketIndex(node.node_id));
+  auto own_bucket_begin(std::lower_bound(nodes_.begin(), nodes_.end(), kBucket,
+                                         [](const NodeInfo & lhs, int32_t rhs) {
+    return lhs.bucket < rhs;
+  }));
+  auto own_bucket_end(bucket_upper_bound(kBucket, own_bucket_begin));
+  const size_t kOwnBucketSize(static_cast<size_t>(own_bucket_end - own_bucket_begin) + 1);
+  const size_t kMinimumSize(std::max(static_cast<size_t>(kBucketTargetSize_), kOwnBucketSize) + 2);
+  size_t largest_size(0);
+  auto largest_begin(nodes_.end()), largest_end(nodes_.end());
+  for (auto bucket_begin(own_bucket_end); bucket_begin != nodes_.end();) {
+    auto bucket_end(bucket_upper_bound(bucket_begin->bucket, bucket_begin));
+    const size_t kSize(static_cast<size_t>(bucket_end - bucket_begin));
+    if (kSize >= kMinimumSize && kSize >= largest_size) {
+      largest_size = kSize;
+      largest_begin = bucket_begin;
+      largest_end = bucket_end;
+    }
+    bucket_begin = bucket_end;
+  }
+  if (largest_begin == nodes_.end())
+    return false;
+  if (remove) {
+    auto removable(SlowestLink(largest_begin, largest_end, [](const NodeInfo&) { return false; }));
+    removed_node = *removable;
+    nodes_.erase(removable);
+  }
+  return true;
+}
 
-    if ((*it).bucket == (*(it + size)).bucket) {
-      // Here we know the node should fit into a bucket if the bucket has too many nodes AND node to
-      // add has a lower bucket index
-      assert(node.bucket < (*it).bucket);
-      if (remove) {
-        removed_node = *it;
-        nodes_.erase(it);
+std::vector<NodeInfo>::iterator RoutingTable::SlowestLink(
+    std::vector<NodeInfo>::iterator first, std::vector<NodeInfo>::iterator last,
+    const std::function<bool(const NodeInfo&)>& skip) const {
+  auto slowest(last);
+  std::chrono::microseconds worst_cost(std::chrono::microseconds::min());
+  for (auto it(first); it != last; ++it) {
+    if (skip(*it))
+      continue;
+    std::chrono::microseconds cost;
+    if (link_quality_.Cost(it->node_id, cost)) {
+      if (cost > worst_cost) {
+        worst_cost = cost;
+        slowest = it;
       }
-      return true;
+    } else if (slowest == last) {
+      slowest = it;
     }
   }
-  return false;
+  return slowest;
+}
+
+void RoutingTable::InsertNode(const NodeInfo& peer,
+                              std::unique_lock<boost::shared_mutex>& lock) {
+  nodes_.insert(std::upper_bound(nodes_.begin(), nodes_.end(), peer,
+                                 [this](const NodeInfo & lhs, const NodeInfo & rhs) {
+                  return NodeId::CloserToTarget(lhs.node_id, rhs.node_id, kNodeId_);
+                }),
+                peer);
+  MembershipChanged(lock);
 }
 
-uint16_t RoutingTable::PartialSortFromTarget(const NodeId& target, uint16_t number,
-                                             std::unique_lock<std::mutex>& lock) {
+void RoutingTable::MembershipChanged(std::unique_lock<boost::shared_mutex>& lock) {
   assert(lock.owns_lock());
   static_cast<void>(lock);
-  uint16_t count = std::min(number, static_cast<uint16_t>(nodes_.size()));
-  std::partial_sort(nodes_.begin(), nodes_.begin() + count, nodes_.end(),
-                    [target](const NodeInfo & lhs, const NodeInfo & rhs) {
-    return NodeId::CloserToTarget(lhs.node_id, rhs.node_id, target);
-  });
-  return count;
+  ++version_;
+  std::atomic_store(&close_boundaries_, MakeCloseBoundaries(kNodeId_, nodes_));
 }
 
-void RoutingTable::NthElementSortFromTarget(const NodeId& target, uint16_t nth_element,
-                                            std::unique_lock<std::mutex>& lock) {
+// Since nodes_ is ordered by bucket, the closest nodes to any target are found by ranking whole
+// buckets of nodes_ in order of distance from it, starting at its own, rather than by reordering
+// the whole table.  For a target in bucket b:
+//  - every node in bucket b is closer to it than any node in another bucket;
+//  - a bucket j below b is closer than every bucket below it if the target differs from this node
+//    at bit j, and further than all of them otherwise, so those buckets come next, in that order;
+//  - each bucket above b lies wholly closer to it than the next.
+template <typename Lock>
+std::vector<NodeInfo> RoutingTable::GetClosestFromTarget(const NodeId& target, uint16_t number,
+                                                         Lock& lock) const {
   assert(lock.owns_lock());
   static_cast<void>(lock);
-  assert((nodes_.size() >= nth_element) &&
-         "This should only be called when n is at max the size of RT");
-#ifndef __GNUC__
-  std::nth_element(nodes_.begin(), nodes_.begin() + nth_element - 1, nodes_.end(),
-                   [target](const NodeInfo & lhs, const NodeInfo & rhs) {
-                       return NodeId::CloserToTarget(lhs.node_id, rhs.node_id, target);
-                   });
-#else
-// BEFORE_RELEASE use std::nth_element() for all platform when min required Gcc version is 4.8.3
-// http://gcc.gnu.org/bugzilla/show_bug.cgi?id=58800 Bug fixed in gcc 4.8.3
-  std::partial_sort(nodes_.begin(), nodes_.begin() + nth_element - 1, nodes_.end(),
-                    [target](const NodeInfo & lhs, const NodeInfo & rhs) {
-                        return NodeId::CloserToTarget(lhs.node_id, rhs.node_id, target);
-                    });
-#endif
+  size_t count(std::min(static_cast<size_t>(number), nodes_.size()));
+  if (target == kNodeId_)
+    return std::vector<NodeInfo>(nodes_.begin(), nodes_.begin() + count);
+
+  typedef std::vector<NodeInfo>::const_iterator Iterator;
+  auto bucket_end([this](Iterator from) {
+    return std::upper_bound(from, nodes_.end(), from->bucket,
+                            [](int32_t lhs, const NodeInfo & rhs) { return lhs < rhs.bucket; });
+  });
+  std::vector<NodeInfo> closest_nodes;
+  closest_nodes.reserve(count);
+  auto take([&](Iterator first, Iterator last) {
+    for (const auto& node_info : RankFromTarget(first, last, target, count - closest_nodes.size()))
+      closest_nodes.push_back(*node_info);
+    return closest_nodes.size() == count;
+  });
+
+  const int32_t kTargetBucket(BucketIndex(target));
+  std::vector<std::pair<Iterator, Iterator>> lower_buckets;
+  Iterator itr(nodes_.begin());
+  for (; itr != nodes_.end() && itr->bucket < kTargetBucket; itr = lower_buckets.back().second)
+    lower_buckets.emplace_back(itr, bucket_end(itr));
+  if (itr != nodes_.end() && itr->bucket == kTargetBucket) {
+    const Iterator kEnd(bucket_end(itr));
+    if (take(itr, kEnd))
+      return closest_nodes;
+    itr = kEnd;
+  }
+  if (!lower_buckets.empty()) {
+    const std::string kRawTarget(target.string()), kRawNodeId(kNodeId_.string());
+    auto differs([&](const std::pair<Iterator, Iterator>& bucket) {
+      return BitDiffers(kRawTarget, kRawNodeId, bucket.first->bucket);
+    });
+    for (auto lower(lower_buckets.rbegin()); lower != lower_buckets.rend(); ++lower) {
+      if (differs(*lower) && take(lower->first, lower->second))
+        return closest_nodes;
+    }
+    for (const auto& lower : lower_buckets) {
+      if (!differs(lower) && take(lower.first, lower.second))
+        return closest_nodes;
+    }
+  }
+  while (itr != nodes_.end()) {
+    const Iterator kEnd(bucket_end(itr));
+    if (take(itr, kEnd))
+      break;
+    itr = kEnd;
+  }
+  return closest_nodes;
 }
 
-NodeId RoutingTable::FurthestCloseNode() {
-  return GetNthClosestNode(kNodeId_, Parameters::closest_nodes_size).node_id;
+NodeId RoutingTable::FurthestCloseNode() const {
+  return close_boundaries()->furthest_close_node;
 }
 
 NodeInfo RoutingTable::GetClosestNode(const NodeId& target_id, bool ignore_exact_match) {
-  std::unique_lock<std::mutex> lock(mutex_);
-  int sorted_count(PartialSortFromTarget(target_id, 2, lock));
-  if (sorted_count == 0)
+  boost::shared_lock<boost::shared_mutex> lock(mutex_);
+  std::vector<NodeInfo> closest_nodes(GetClosestFromTarget(target_id, 2, lock));
+  if (closest_nodes.empty())
     return NodeInfo();
-  if (ignore_exact_match && (nodes_[0].node_id == target_id))
-    return (sorted_count == 1) ? NodeInfo() : nodes_[1];
-  return nodes_[0];
+  if (ignore_exact_match && (closest_nodes[0].node_id == target_id))
+    return (closest_nodes.size() == 1) ? NodeInfo() : closest_nodes[1];
+  return closest_nodes[0];
 }
 
 NodeInfo RoutingTable::GetClosestNode(const NodeId& target_id,
                                       const std::vector<std::string>& exclude,
                                       bool ignore_exact_match) {
+  return GetClosestNodeExcluding(target_id, exclude, ignore_exact_match);
+}
+
+NodeInfo RoutingTable::GetClosestNode(const NodeId& target_id, const RouteHistory& exclude,
+                                      bool ignore_exact_match) {
+  return GetClosestNodeExcluding(target_id, exclude, ignore_exact_match);
+}
+
+template <typename Exclusions>
+NodeInfo RoutingTable::GetClosestNodeExcluding(const NodeId& target_id, const Exclusions& exclude,
+                                               bool ignore_exact_match) {
+  boost::shared_lock<boost::shared_mutex> lock(mutex_);
+  return GetClosestNodeExcluding(target_id, exclude, ignore_exact_match, lock);
+}
+
+// Considers the same nodes as GetClosestNodeInfo(target_id, Parameters::closest_nodes_size,
+// ignore_exact_match).
+template <typename Exclusions, typename Lock>
+NodeInfo RoutingTable::GetClosestNodeExcluding(const NodeId& target_id, const Exclusions& exclude,
+                                               bool ignore_exact_match, Lock& lock) const {
   std::vector<NodeInfo> closest_nodes(
-      GetClosestNodeInfo(target_id, Parameters::closest_nodes_size, ignore_exact_match));
-  for (const auto& node_info : closest_nodes) {
-    if (std::find(exclude.begin(), exclude.end(), node_info.node_id.string()) == exclude.end())
-      return node_info;
+      GetClosestFromTarget(target_id, Parameters::closest_nodes_size + 1, lock));
+  auto begin(closest_nodes.begin());
+  if (ignore_exact_match && begin != closest_nodes.end() && begin->node_id == target_id)
+    ++begin;
+  auto end(closest_nodes.end() - begin > Parameters::closest_nodes_size
+               ? begin + Parameters::closest_nodes_size
+               : closest_nodes.end());
+  for (auto itr(begin); itr != end; ++itr) {
+    if (!IsExcluded(exclude, itr->node_id))
+      return *itr;
   }
   return NodeInfo();
 }
@@ -635,49 +1072,95 @@ NodeInfo RoutingTable::GetNodeForSendingMessage(const NodeId& target_id,
 */
 
 NodeInfo RoutingTable::GetNodeForSendingMessage(const NodeId& target_id,
-                                                const std::vector<std::string>& exclude,
+                                                const RouteHistory& exclude,
                                                 bool ignore_exact_match) {
   NodeInfo current_peer(GetClosestNode(target_id, exclude, ignore_exact_match));
   if (current_peer.node_id != target_id) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    boost::shared_lock<boost::shared_mutex> lock(mutex_);
     group_matrix_.GetBetterNodeForSendingMessage(target_id, exclude, ignore_exact_match,
                                                  current_peer);
+    PreferFasterLink(target_id, exclude, current_peer, lock);
   }
-  std::string excluded_ids;
-  for (const auto& excluded_id : exclude) {
-    excluded_ids.append("\t");
-    excluded_ids.append(HexSubstr(excluded_id));
-  }
-  LOG(kVerbose) << "[" << DebugId(kNodeId_) << "] - best node to send to is "
-                << DebugId(current_peer.node_id) << " (Excluded: " << excluded_ids << ")";
+  ROUTING_LOG(kVerbose) << "[" << DebugId(kNodeId_) << "] - best node to send to is "
+                        << DebugId(current_peer.node_id) << " (Excluded: " << exclude.DebugString()
+                        << ")";
   return current_peer;
 }
 
-NodeInfo RoutingTable::GetRemovableNode(std::vector<std::string> attempted) {
-  std::map<uint32_t, uint16_t> bucket_rank_map;
-  std::unique_lock<std::mutex> lock(mutex_);
-  PartialSortFromTarget(kNodeId_, static_cast<uint16_t>(nodes_.size()), lock);
-
-  auto const from_iterator(nodes_.begin() + Parameters::closest_nodes_size);
-
-  for (auto it = from_iterator; it != nodes_.end(); ++it) {
-    if (std::find(attempted.begin(), attempted.end(), ((*it).node_id.string())) ==
-        attempted.end()) {
-      auto bucket_iter = bucket_rank_map.find((*it).bucket);
-      if (bucket_iter != bucket_rank_map.end()) {
-        (*bucket_iter).second++;
-      } else {
-        bucket_rank_map.insert(bucket_rank_map.begin(), std::pair<int, int>((*it).bucket, 1));
-      }
+template <typename Lock>
+void RoutingTable::PreferFasterLink(const NodeId& target_id, const RouteHistory& exclude,
+                                    NodeInfo& current_peer, Lock& lock) const {
+  assert(lock.owns_lock());
+  static_cast<void>(lock);
+  std::chrono::microseconds best_cost;
+  if (current_peer.node_id.IsZero() || current_peer.node_id == target_id ||
+      !link_quality_.Cost(current_peer.node_id, best_cost)) {
+    return;
+  }
+  const XorDistance kOwnDistance(kNodeId_, target_id);
+  const XorDistance kMaxDistance(XorDistance(current_peer.node_id, target_id) *
+                                 Parameters::proximity_factor);
+  const NodeInfo* faster_peer(nullptr);
+  // The last hops are left to XOR closeness and the group matrix.
+  if (!NodeId::CloserToTarget(close_boundaries()->furthest_close_node, target_id, kNodeId_))
+    return;
+  for (const auto& node : nodes_) {
+    if (node.node_id == current_peer.node_id || node.node_id == target_id ||
+        exclude.Contains(node.node_id)) {
+      continue;
+    }
+    // Every hop must still get closer to the target than this node, so messages can't loop.
+    const XorDistance kDistance(node.node_id, target_id);
+    if (!(kDistance < kOwnDistance) || kMaxDistance < kDistance)
+      continue;
+    std::chrono::microseconds cost;
+    if (link_quality_.Cost(node.node_id, cost) &&
+        cost * Parameters::link_preference_factor <= best_cost) {
+      best_cost = cost * Parameters::link_preference_factor;
+      faster_peer = &node;
     }
   }
+  if (faster_peer) {
+    LOG(kVerbose) << "[" << DebugId(kNodeId_) << "] preferring faster link to "
+                  << DebugId(faster_peer->node_id) << " over " << DebugId(current_peer.node_id)
+                  << " for target " << DebugId(target_id);
+    current_peer = *faster_peer;
+  }
+}
+
+// Buckets beyond the close nodes are contiguous ranges of nodes_, so each one's size is found by
+// binary search.  Within the fullest, the peer with the worst measured link goes first.
+NodeInfo RoutingTable::GetRemovableNode(std::vector<std::string> attempted) {
+  boost::shared_lock<boost::shared_mutex> lock(mutex_);
+  if (nodes_.size() <= Parameters::closest_nodes_size)
+    return NodeInfo();
+  std::map<int32_t, uint16_t> attempted_per_bucket;
+  for (const auto& node_id : attempted)
+    ++attempted_per_bucket[BucketIndex(NodeId(node_id))];
+  auto is_attempted([&attempted](const NodeInfo & node) {
+    return std::find(attempted.begin(), attempted.end(), node.node_id.string()) != attempted.end();
+  });
 
-  int32_t max_bucket(0), max_bucket_count(1);
-  for (auto& elem : bucket_rank_map) {
-    if ((elem).second >= max_bucket_count) {
-      max_bucket = (elem).first;
-      max_bucket_count = (elem).second;
+  auto max_bucket_begin(nodes_.end()), max_bucket_end(nodes_.end());
+  int32_t max_bucket(0);
+  int max_bucket_count(1);
+  for (auto bucket_begin(nodes_.begin() + Parameters::closest_nodes_size);
+       bucket_begin != nodes_.end();) {
+    const int32_t kBucket(bucket_begin->bucket);
+    auto bucket_end(std::upper_bound(bucket_begin, nodes_.end(), kBucket,
+                                     [](int32_t lhs, const NodeInfo & rhs) {
+      return lhs < rhs.bucket;
+    }));
+    auto attempted_itr(attempted_per_bucket.find(kBucket));
+    const int kCount(static_cast<int>(bucket_end - bucket_begin) -
+                     (attempted_itr == attempted_per_bucket.end() ? 0 : attempted_itr->second));
+    if (kCount >= max_bucket_count) {
+      max_bucket = kBucket;
+      max_bucket_count = kCount;
+      max_bucket_begin = bucket_begin;
+      max_bucket_end = bucket_end;
     }
+    bucket_begin = bucket_end;
   }
 
   LOG(kVerbose) << "[" << DebugId(kNodeId_) << "] max_bucket " << max_bucket << " count "
@@ -686,24 +1169,15 @@ NodeInfo RoutingTable::GetRemovableNode(std::vector<std::string> attempted) {
     return nodes_[Parameters::closest_nodes_size + Parameters::group_size];
   }
 
-  NodeInfo removable_node;
-  for (auto it(from_iterator); it != nodes_.end(); ++it) {
-    if (((*it).bucket == max_bucket) &&
-        std::find(attempted.begin(), attempted.end(), (*it).node_id.string()) == attempted.end()) {
-      removable_node = (*it);
-      break;
-    }
-  }
-  LOG(kVerbose) << "[" << DebugId(kNodeId_) << "] Proposed removable ["
-                << DebugId(removable_node.node_id) << "]";
-  return removable_node;
+  auto removable_node(SlowestLink(max_bucket_begin, max_bucket_end, is_attempted));
+  NodeInfo result(removable_node != max_bucket_end ? *removable_node : NodeInfo());
+  LOG(kVerbose) << "[" << DebugId(kNodeId_) << "] Proposed removable [" << DebugId(result.node_id)
+                << "]";
+  return result;
 }
 
 void RoutingTable::GetNodesNeedingGroupUpdates(std::vector<NodeInfo>& nodes_needing_update) {
-  std::unique_lock<std::mutex> lock(mutex_);
-  int sorted_count(PartialSortFromTarget(kNodeId_, Parameters::closest_nodes_size, lock));
-  if (sorted_count == 0)
-    return;
+  boost::shared_lock<boost::shared_mutex> lock(mutex_);
   for (auto iter(nodes_.begin());
        iter != (nodes_.begin() +
                 std::min(Parameters::closest_nodes_size, static_cast<uint16_t>(nodes_.size())));
@@ -715,87 +1189,100 @@ void RoutingTable::GetNodesNeedingGroupUpdates(std::vector<NodeInfo>& nodes_need
 
 NodeInfo RoutingTable::GetNthClosestNode(const NodeId& target_id, uint16_t node_number) {
   assert((node_number > 0) && "Node number starts with position 1");
-  std::unique_lock<std::mutex> lock(mutex_);
+  boost::shared_lock<boost::shared_mutex> lock(mutex_);
   if (nodes_.size() < node_number) {
     NodeInfo node_info;
     node_info.node_id = (NodeId(NodeId::kMaxId) ^ kNodeId_);
     return node_info;
   }
-  NthElementSortFromTarget(target_id, node_number, lock);
-  return nodes_[node_number - 1];
+  return GetClosestFromTarget(target_id, node_number, lock).back();
 }
 
 std::vector<NodeId> RoutingTable::GetClosestNodes(const NodeId& target_id, uint16_t number_to_get) {
   std::vector<NodeId> close_nodes;
-  std::unique_lock<std::mutex> lock(mutex_);
-  int sorted_count(PartialSortFromTarget(target_id, number_to_get, lock));
-
-  for (int i = 0; i != sorted_count; ++i)
-    close_nodes.push_back(nodes_[i].node_id);
+  boost::shared_lock<boost::shared_mutex> lock(mutex_);
+  for (const auto& node_info : GetClosestFromTarget(target_id, number_to_get, lock))
+    close_nodes.push_back(node_info.node_id);
   return close_nodes;
 }
 
 std::vector<NodeInfo> RoutingTable::GetClosestMatrixNodes(const NodeId& target_id,
                                                           uint16_t number_to_get) {
-  std::vector<NodeInfo> closest_matrix_nodes(GetMatrixNodes());
-  size_t sorting_size(std::min(static_cast<size_t>(number_to_get), closest_matrix_nodes.size()));
-  std::partial_sort(closest_matrix_nodes.begin(), closest_matrix_nodes.begin() + sorting_size,
-                    closest_matrix_nodes.end(),
-                    [&target_id](const NodeInfo & lhs, const NodeInfo & rhs) {
-    return NodeId::CloserToTarget(lhs.node_id, rhs.node_id, target_id);
-  });
-  closest_matrix_nodes.resize(sorting_size);
+  std::vector<NodeInfo> closest_matrix_nodes;
+  boost::shared_lock<boost::shared_mutex> lock(mutex_);
+  for (const auto& node_info : RankFromTarget(group_matrix_.unique_nodes_.begin(),
+                                              group_matrix_.unique_nodes_.end(), target_id,
+                                              number_to_get))
+    closest_matrix_nodes.push_back(*node_info);
   return closest_matrix_nodes;
 }
 
 std::vector<NodeId> RoutingTable::GetGroup(const NodeId& target_id) {
-  std::vector<NodeInfo> nodes(GetMatrixNodes());
   std::vector<NodeId> group;
-  std::partial_sort(nodes.begin(), nodes.begin() + Parameters::group_size, nodes.end(),
-                    [&](const NodeInfo & lhs, const NodeInfo & rhs) {
-    return NodeId::CloserToTarget(lhs.node_id, rhs.node_id, target_id);
-  });
-  for (auto iter(nodes.begin()); iter != nodes.begin() + Parameters::group_size; ++iter)
-    group.push_back(iter->node_id);
+  boost::shared_lock<boost::shared_mutex> lock(mutex_);
+  for (const auto& node_info : RankFromTarget(group_matrix_.unique_nodes_.begin(),
+                                              group_matrix_.unique_nodes_.end(), target_id,
+                                              Parameters::group_size))
+    group.push_back(node_info->node_id);
   return group;
 }
 
+void RoutingTable::GetGroups(const std::vector<NodeId>& target_ids,
+                             std::vector<std::vector<NodeId>>& groups) {
+  groups.resize(target_ids.size());
+  boost::shared_lock<boost::shared_mutex> lock(mutex_);
+  for (size_t i(0); i != target_ids.size(); ++i) {
+    groups[i].clear();
+    for (const auto& node_info : RankFromTarget(group_matrix_.unique_nodes_.begin(),
+                                                group_matrix_.unique_nodes_.end(),
+                                                target_ids[i], Parameters::group_size))
+      groups[i].push_back(node_info->node_id);
+  }
+}
+
 std::vector<NodeInfo> RoutingTable::GetClosestNodeInfo(const NodeId& target_id,
                                                        uint16_t number_to_get,
                                                        bool ignore_exact_match) {
-  std::unique_lock<std::mutex> lock(mutex_);
-  int sorted_count(PartialSortFromTarget(target_id, number_to_get + 1, lock));
-  if (sorted_count == 0)
-    return std::vector<NodeInfo>();
-
-  auto itr(nodes_.begin());
-  if (ignore_exact_match && ((*itr).node_id == target_id)) {
-    return (sorted_count == 1)
-               ? std::vector<NodeInfo>()
-               : std::vector<NodeInfo>(nodes_.begin() + 1, nodes_.begin() + sorted_count);
+  boost::shared_lock<boost::shared_mutex> lock(mutex_);
+  std::vector<NodeInfo> closest_nodes(GetClosestFromTarget(target_id, number_to_get + 1, lock));
+  if (closest_nodes.empty())
+    return closest_nodes;
+
+  if (ignore_exact_match && (closest_nodes.front().node_id == target_id)) {
+    closest_nodes.erase(closest_nodes.begin());
+    return closest_nodes;
   }
 
-  return std::vector<NodeInfo>(
-      nodes_.begin(), nodes_.begin() + std::min(sorted_count, static_cast<int>(number_to_get)));
+  if (closest_nodes.size() > number_to_get)
+    closest_nodes.resize(number_to_get);
+  return closest_nodes;
 }
 
+// nodes_ is ordered by distance from kNodeId_, and no two IDs are the same distance from it.
 std::pair<bool, std::vector<NodeInfo>::iterator> RoutingTable::Find(
-    const NodeId& node_id, std::unique_lock<std::mutex>& lock) {
+    const NodeId& node_id, std::unique_lock<boost::shared_mutex>& lock) {
   assert(lock.owns_lock());
   static_cast<void>(lock);
-  auto itr(std::find_if(nodes_.begin(), nodes_.end(), [&node_id](const NodeInfo & node_info) {
-    return node_info.node_id == node_id;
+  auto itr(std::lower_bound(nodes_.begin(), nodes_.end(), node_id,
+                            [this](const NodeInfo & lhs, const NodeId & rhs) {
+    return NodeId::CloserToTarget(lhs.node_id, rhs, kNodeId_);
   }));
+  if (itr != nodes_.end() && itr->node_id != node_id)
+    itr = nodes_.end();
   return std::make_pair(itr != nodes_.end(), itr);
 }
 
-std::pair<bool, std::vector<NodeInfo>::const_iterator> RoutingTable::Find(
-    const NodeId& node_id, std::unique_lock<std::mutex>& lock) const {
+template <typename Lock>
+std::pair<bool, std::vector<NodeInfo>::const_iterator> RoutingTable::Find(const NodeId& node_id,
+                                                                          Lock& lock) const {
   assert(lock.owns_lock());
   static_cast<void>(lock);
-  auto itr(std::find_if(nodes_.begin(), nodes_.end(), [&node_id](const NodeInfo & node_info) {
-    return node_info.node_id == node_id;
+  auto itr(std::lower_bound(nodes_.begin(), nodes_.end(), node_id,
+                            [this](const NodeInfo & lhs, const NodeId & rhs) {
+    return NodeId::CloserToTarget(lhs.node_id, rhs, kNodeId_);
   }));
+  if (itr != nodes_.end() && itr->node_id != node_id)
+    itr = nodes_.end();
   return std::make_pair(itr != nodes_.end(), itr);
 }
 
@@ -806,63 +1293,78 @@ void RoutingTable::UpdateNetworkStatus(uint16_t size) const {
   if (!network_status_functor_)
     return;
 #endif
-  network_status_functor_(static_cast<int>(size) * 100 / kMaxSize_);
-  LOG(kVerbose) << DebugId(kNodeId_) << " Updating network status !!! " << (size * 100) / kMaxSize_;
+  int network_status(static_cast<int>(size) * 100 / kMaxSize_);
+  if (Parameters::weighted_network_status) {
+    // Half for how full the table is and half for how complete the close group is, scaled by the
+    // share of messages expected to get through.  Each part is kept current as peers come and go,
+    // so none of them needs the table or the link estimates walked.
+    double close_group(static_cast<double>(std::min(size, Parameters::closest_nodes_size)) /
+                       static_cast<double>(Parameters::closest_nodes_size));
+    network_status = static_cast<int>((network_status + close_group * 100) / 2 *
+                                      (1.0 - link_quality_.MeanLossRate()) + 0.5);
+  }
+  network_status_functor_(network_status);
+  LOG(kVerbose) << DebugId(kNodeId_) << " Updating network status !!! " << network_status;
 }
 
 size_t RoutingTable::size() const {
-  std::lock_guard<std::mutex> lock(mutex_);
+  boost::shared_lock<boost::shared_mutex> lock(mutex_);
   return nodes_.size();
 }
 
-void RoutingTable::IpcSendGroupMatrix() const {
-  if (ipc_message_queue_) {
-    network_viewer::MatrixRecord matrix_record(kNodeId_);
+size_t RoutingTable::BucketSize(const NodeId& node_id) const {
+  const int32_t kBucket(BucketIndex(node_id));
+  boost::shared_lock<boost::shared_mutex> lock(mutex_);
+  auto bucket_begin(std::lower_bound(nodes_.begin(), nodes_.end(), kBucket,
+                                     [](const NodeInfo & lhs, int32_t rhs) {
+    return lhs.bucket < rhs;
+  }));
+  auto bucket_end(std::upper_bound(bucket_begin, nodes_.end(), kBucket,
+                                   [](int32_t lhs, const NodeInfo & rhs) {
+    return lhs < rhs.bucket;
+  }));
+  return static_cast<size_t>(bucket_end - bucket_begin);
+}
+
+void RoutingTable::PublishGroupMatrix() {
+  if (matrix_snapshot_writer_ && group_matrix_changed_.exchange(false)) {
+    MatrixEntries entries;
     std::vector<NodeInfo> matrix, close;
     {
-      std::lock_guard<std::mutex> lock(mutex_);
+      boost::shared_lock<boost::shared_mutex> lock(mutex_);
       matrix = group_matrix_.GetUniqueNodes();
       close = group_matrix_.GetConnectedPeers();
     }
     std::string printout("\tMatrix sent by: " + DebugId(kNodeId_) + "\n");
     for (const auto& matrix_element : matrix) {
-      matrix_record.AddElement(matrix_element.node_id, network_viewer::ChildType::kMatrix);
+      entries.emplace_back(matrix_element.node_id, MatrixEntryType::kMatrix);
       printout += "\t\t" + DebugId(matrix_element.node_id) + " - kMatrix\n";
     }
 
-    std::sort(std::begin(close), std::end(close),
-              [this](const NodeInfo & lhs, const NodeInfo & rhs) {
-      return NodeId::CloserToTarget(lhs.node_id, rhs.node_id, kNodeId_);
-    });
-
     size_t index(0);
     size_t limit(std::min(static_cast<size_t>(Parameters::group_size), close.size()));
     for (; index < limit; ++index) {
-      matrix_record.AddElement(close[index].node_id, network_viewer::ChildType::kGroup);
+      entries.emplace_back(close[index].node_id, MatrixEntryType::kGroup);
       printout += "\t\t" + DebugId(close[index].node_id) + " - kGroup\n";
     }
     for (; index < close.size(); ++index) {
-      matrix_record.AddElement(close[index].node_id, network_viewer::ChildType::kClosest);
+      entries.emplace_back(close[index].node_id, MatrixEntryType::kClosest);
       printout += "\t\t" + DebugId(close[index].node_id) + " - kClosest\n";
     }
     LOG(kInfo) << printout << '\n';
-    std::string serialised_matrix(matrix_record.Serialise());
-    ipc_message_queue_->try_send(serialised_matrix.c_str(), serialised_matrix.size(), 0);
+    matrix_snapshot_writer_->Publish(entries);
   }
 }
 
 std::string RoutingTable::PrintRoutingTable() {
   std::vector<NodeInfo> rt;
   {
-    std::lock_guard<std::mutex> lock(mutex_);
-    std::sort(nodes_.begin(), nodes_.end(), [&](const NodeInfo & lhs, const NodeInfo & rhs) {
-      return NodeId::CloserToTarget(lhs.node_id, rhs.node_id, kNodeId_);
-    });
+    boost::shared_lock<boost::shared_mutex> lock(mutex_);
     rt = nodes_;
   }
   std::string s = "\n\n[" + DebugId(kNodeId_) +
                   "] This node's own routing table and peer connections:\n" +
-                  "Routing table size: " + std::to_string(nodes_.size()) + "\n";
+                  "Routing table size: " + std::to_string(rt.size()) + "\n";
   for (const auto& node : rt) {
     s += std::string("\tPeer ") + "[" + DebugId(node.node_id) + "]" + "-->";
     s += DebugId(node.connection_id) + " && xored ";
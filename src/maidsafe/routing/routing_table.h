@@ -19,7 +19,9 @@
 #ifndef MAIDSAFE_ROUTING_ROUTING_TABLE_H_
 #define MAIDSAFE_ROUTING_ROUTING_TABLE_H_
 
+#include <atomic>
 #include <cstdint>
+#include <deque>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -28,7 +30,8 @@
 
 #include "boost/asio/ip/udp.hpp"
 #include "boost/filesystem/path.hpp"
-#include "boost/interprocess/ipc/message_queue.hpp"
+#include "boost/thread/locks.hpp"
+#include "boost/thread/shared_mutex.hpp"
 
 #include "maidsafe/common/node_id.h"
 #include "maidsafe/common/rsa.h"
@@ -37,8 +40,11 @@
 
 #include "maidsafe/routing/api_config.h"
 #include "maidsafe/routing/group_matrix.h"
+#include "maidsafe/routing/link_quality.h"
+#include "maidsafe/routing/matrix_snapshot.h"
 #include "maidsafe/routing/network_statistics.h"
 #include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/route_history.h"
 
 namespace maidsafe {
 
@@ -53,6 +59,7 @@ class RoutingTableTest_FUNC_OrderedGroupChange_Test;
 class RoutingTableTest_FUNC_ReverseOrderedGroupChange_Test;
 class RoutingTableTest_BEH_CheckMockSendGroupChangeRpcs_Test;
 class RoutingTableTest_BEH_GroupUpdateFromConnectedPeer_Test;
+class RoutingTableTest_BEH_GroupUpdateFromUnmatchedPeer_Test;
 class NetworkStatisticsTest_BEH_IsIdInGroupRange_Test;
 class RoutingTableTest_FUNC_IsNodeIdInGroupRange_Test;
 }
@@ -67,11 +74,47 @@ struct NodeInfo;
 typedef std::function<void(std::vector<NodeInfo> /*new*/, std::vector<NodeInfo> /*old*/)>
                            ConnectedGroupChangeFunctor;
 
+// What MessageHandler needs to decide where a message goes, all read from one snapshot of the
+// table (see RoutingTable::ClassifyRoute).
+struct RouteClassification {
+  RouteClassification()
+      : in_group_range(false), in_close_range(false), closest(false),
+        closest_ignoring_target(false), target_connected(false), table_size(0) {}
+  bool in_group_range;  // as IsThisNodeInRange(target, Parameters::group_size)
+  bool in_close_range;  // as IsThisNodeInRange(target, Parameters::closest_nodes_size)
+  bool closest;  // as IsThisNodeClosestTo(target, false)
+  bool closest_ignoring_target;  // as IsThisNodeClosestTo(target, true)
+  bool target_connected;  // as Contains(target)
+  size_t table_size;
+};
+
+// Where a group message goes from a node close to its group (see RoutingTable::RouteGroup).
+struct GroupRoute {
+  GroupRoute() : leader(false), next_hop(), connected_members(), other_members() {}
+  bool leader;
+  NodeInfo next_hop;  // if not the leader
+  // If the leader, the other members to replicate to, closest first, split by whether this node
+  // is connected to them.
+  std::vector<NodeInfo> connected_members, other_members;
+};
+
+// The edges of a node's close group and of the wider range its clients must be within, each as
+// for RoutingTable::GetNthClosestNode, i.e. kMaxId ^ the node's ID while it has too few peers.
+struct CloseBoundaries {
+  CloseBoundaries() : furthest_close_node(), furthest_client_close_node(), close_distance() {}
+  NodeId furthest_close_node;         // the closest_nodes_size'th closest peer
+  NodeId furthest_client_close_node;  // the 2 * closest_nodes_size'th closest peer
+  NodeId close_distance;              // from the node to furthest_close_node
+};
+
 class RoutingTable {
  public:
   RoutingTable(bool client_mode, const NodeId& node_id, const asymm::Keys& keys,
-               NetworkStatistics& network_statistics);
+               NetworkStatistics& network_statistics,
+               const InstanceParameters& parameters = InstanceParameters());
   virtual ~RoutingTable();
+  // The functors are called on the thread changing the table, once mutex_ is released, so should
+  // do little more than note what needs doing (see Routing::Impl::ScheduleChangeNotifications).
   void InitialiseFunctors(NetworkStatusFunctor network_status_functor,
                           std::function<void(const NodeInfo&, bool)> remove_node_functor,
                           RemoveFurthestUnnecessaryNode remove_furthest_node,
@@ -81,47 +124,100 @@ class RoutingTable {
                const std::vector<NodeInfo>& matrix_update = std::vector<NodeInfo>());
   bool CheckNode(const NodeInfo& peer);
   NodeInfo DropNode(const NodeId& node_to_drop, bool routing_only);
+  // As AddNode or DropNode for each of a set of nodes, but under one lock, and with each functor
+  // fired once for the whole set, with a single MatrixChange.  Each returns the nodes it added or
+  // dropped.
+  std::vector<NodeInfo> AddNodes(std::vector<NodeInfo> peers);
+  std::vector<NodeInfo> DropNodes(const std::vector<NodeId>& nodes_to_drop, bool routing_only);
   bool ClosestToId(const NodeId& target_id);
 
   GroupRangeStatus IsNodeIdInGroupRange(const NodeId& group_id) const;
   GroupRangeStatus IsNodeIdInGroupRange(const NodeId& group_id, const NodeId& node_id) const;
+  // Sets results[i] to IsNodeIdInGroupRange(group_ids[i]), all against the same snapshot.
+  void IsNodeIdInGroupRange(const std::vector<NodeId>& group_ids,
+                            std::vector<GroupRangeStatus>& results) const;
 
   bool IsThisNodeGroupLeader(const NodeId& target_id, NodeInfo& connected_peer);
   bool IsThisNodeGroupLeader(const NodeId& target_id, NodeInfo& connected_peer,
-                             const std::vector<std::string>& exclude);
+                             const RouteHistory& exclude);
   bool GetNodeInfo(const NodeId& node_id, NodeInfo& node_info) const;
   bool IsThisNodeInRange(const NodeId& target_id, uint16_t range);
   bool IsThisNodeClosestTo(const NodeId& target_id, bool ignore_exact_match = false);
   bool IsThisNodeClosestToIncludingMatrix(const NodeId& target_id, bool ignore_exact_match = false);
   bool Contains(const NodeId& node_id) const;
-  bool ConfirmGroupMembers(const NodeId& node1, const NodeId& node2);
-  void GroupUpdateFromConnectedPeer(const NodeId& peer, const std::vector<NodeInfo>& nodes);
+  // Answers the Contains, IsThisNodeInRange and IsThisNodeClosestTo queries HandleMessage makes for
+  // target_id under one lock, from one lookup.
+  RouteClassification ClassifyRoute(const NodeId& target_id) const;
+  // As IsThisNodeGroupLeader, then if this node is the leader, as GetClosestMatrixNodes for up to
+  // replicas members other than this node and target_id, with GetNodeInfo for each, under one
+  // lock.
+  GroupRoute RouteGroup(const NodeId& target_id, const RouteHistory& exclude, uint16_t replicas);
+  bool ConfirmGroupMembers(const NodeId& node1, const NodeId& node2) const;
+  // Republished whenever a peer is added or dropped.  Safe to call without taking the lock
+  // guarding the rest of the table.
+  std::shared_ptr<const CloseBoundaries> close_boundaries() const;
+  void GroupUpdateFromConnectedPeer(const NodeId& peer, const std::vector<NodeInfo>& nodes,
+                                    uint32_t version = 0);
+  // Returns false if the delta doesn't apply to what is held for peer, which must then resend
+  // its full row.
+  bool GroupDeltaFromConnectedPeer(const NodeId& peer, const std::vector<NodeInfo>& added_nodes,
+                                   const std::vector<NodeId>& removed_nodes,
+                                   uint32_t base_version, uint32_t version);
   void GroupUpdateFromUnvalidatedPeer(const NodeId& peer, const std::vector<NodeInfo>& nodes);
+  // See GroupMatrix::RowMatchesDigest.
+  bool GroupRowMatchesDigest(const NodeId& peer, uint32_t version, uint64_t digest) const;
   NodeId RandomConnectedNode();
   std::vector<NodeInfo> GetMatrixNodes();
+  // The group matrix's nodes as last published, read without taking the table's lock.
+  std::shared_ptr<const MatrixNodes> matrix_nodes() const { return group_matrix_.nodes(); }
   bool IsConnected(const NodeId& node_id);
   // Returns default-constructed NodeId if routing table size is zero
   NodeInfo GetClosestNode(const NodeId& target_id, bool ignore_exact_match = false);
   NodeInfo GetClosestNode(const NodeId& target_id, const std::vector<std::string>& exclude,
                           bool ignore_exact_match = false);
+  NodeInfo GetClosestNode(const NodeId& target_id, const RouteHistory& exclude,
+                          bool ignore_exact_match = false);
   //  NodeInfo GetNodeForSendingMessage(const NodeId& target_id, bool ignore_exact_match = false);
-  NodeInfo GetNodeForSendingMessage(const NodeId& target_id,
-                                    const std::vector<std::string>& exclude,
+  NodeInfo GetNodeForSendingMessage(const NodeId& target_id, const RouteHistory& exclude,
                                     bool ignore_exact_match = false);
   // Returns max NodeId if routing table size is less than requested node_number
   NodeInfo GetNthClosestNode(const NodeId& target_id, uint16_t node_number);
   std::vector<NodeId> GetClosestNodes(const NodeId& target_id, uint16_t number_to_get);
   std::vector<NodeInfo> GetClosestMatrixNodes(const NodeId& target_id, uint16_t number_to_get);
   std::vector<NodeId> GetGroup(const NodeId& target_id);
+  // Sets groups[i] to GetGroup(target_ids[i]) under a single lock.
+  void GetGroups(const std::vector<NodeId>& target_ids, std::vector<std::vector<NodeId>>& groups);
   NodeInfo GetRemovableNode(std::vector<std::string> attempted = std::vector<std::string>());
   void GetNodesNeedingGroupUpdates(std::vector<NodeInfo>& nodes_needing_update);
   size_t size() const;
+  // Number of nodes held in the bucket node_id would fall in.
+  size_t BucketSize(const NodeId& node_id) const;
+  // Changes whenever a node is added or dropped.
+  uint64_t version() const { return version_; }
+  // Each matrix change passed to the MatrixChangedFunctor advances the epoch, and the matrices
+  // the last Parameters::matrix_epoch_history of them started from are kept.  That is one sorted
+  // vector of member ids per epoch, shared with the MatrixChange reported then while that lives,
+  // but not the change itself or its lost and new nodes.  MatrixChangeSince returns the net change
+  // from the matrix at epoch (a MatrixChange::epoch) to now, as one MatrixChange with the current
+  // epoch, or nullptr if epoch is no longer held (or is in the future).
+  uint64_t matrix_epoch() const;
+  std::shared_ptr<MatrixChange> MatrixChangeSince(uint64_t epoch) const;
+  uint16_t kMaxSize() const { return kMaxSize_; }
   uint16_t kThresholdSize() const { return kThresholdSize_; }
+  uint16_t kBucketTargetSize() const { return kBucketTargetSize_; }
+  uint16_t kGreedySize() const { return kGreedySize_; }
   NodeId kNodeId() const { return kNodeId_; }
   asymm::PrivateKey kPrivateKey() const { return kKeys_.private_key; }
   asymm::PublicKey kPublicKey() const { return kKeys_.public_key; }
   NodeId kConnectionId() const { return kConnectionId_; }
   bool client_mode() const { return kClientMode_; }
+  LinkQuality& link_quality() { return link_quality_; }
+  // True if network_viewer was running when this was constructed (TESTING builds only).
+  bool network_viewer_enabled() const { return matrix_snapshot_writer_ != nullptr; }
+  // Sends the group matrix to network_viewer if it has changed since it was last sent.  Changes
+  // only mark it as changed, so that table updates don't pay for building the record; Routing
+  // publishes it every Parameters::network_viewer_update_interval.
+  void PublishGroupMatrix();
 
   friend class test::GenericNode;
   friend class GroupChangeHandler;
@@ -130,6 +226,7 @@ class RoutingTable {
   friend class test::RoutingTableTest_FUNC_ReverseOrderedGroupChange_Test;
   friend class test::RoutingTableTest_BEH_CheckMockSendGroupChangeRpcs_Test;
   friend class test::RoutingTableTest_BEH_GroupUpdateFromConnectedPeer_Test;
+  friend class test::RoutingTableTest_BEH_GroupUpdateFromUnmatchedPeer_Test;
   friend class test::NetworkStatisticsTest_BEH_IsIdInGroupRange_Test;
   friend class test::RoutingTableTest_FUNC_IsNodeIdInGroupRange_Test;
 
@@ -139,31 +236,58 @@ class RoutingTable {
   bool AddOrCheckNode(NodeInfo node, bool remove,
                       const std::vector<NodeInfo>& matrix_update = std::vector<NodeInfo>());
   void SetBucketIndex(NodeInfo& node_info) const;
-  bool CheckPublicKeyIsUnique(const NodeInfo& node, std::unique_lock<std::mutex>& lock) const;
+  bool CheckPublicKeyIsUnique(const NodeInfo& node,
+                              std::unique_lock<boost::shared_mutex>& lock) const;
   NodeInfo ResolveConnectionDuplication(const NodeInfo& new_duplicate_node, bool local_endpoint,
                                         NodeInfo& existing_node);
   std::shared_ptr<MatrixChange> UpdateCloseNodeChange(
-      std::unique_lock<std::mutex>& lock, const NodeInfo& peer,
+      std::unique_lock<boost::shared_mutex>& lock, const NodeInfo& peer,
       std::vector<NodeInfo>& new_connected_nodes,
       const std::vector<NodeInfo>& matrix_update = std::vector<NodeInfo>());
   bool MakeSpaceForNodeToBeAdded(const NodeInfo& node, bool remove, NodeInfo& removed_node,
-                                 std::unique_lock<std::mutex>& lock);
-  uint16_t PartialSortFromTarget(const NodeId& target, uint16_t number,
-                                 std::unique_lock<std::mutex>& lock);
-  void NthElementSortFromTarget(const NodeId& target, uint16_t nth_element,
-                                std::unique_lock<std::mutex>& lock);
-  NodeId FurthestCloseNode();
+                                 std::unique_lock<boost::shared_mutex>& lock);
+  // The node in [first, last) over the most costly link, ignoring those skip returns true for.
+  // Nodes not yet probed are kept until they have been, unless none in the range have.  Returns
+  // last if every node is skipped.
+  std::vector<NodeInfo>::iterator SlowestLink(
+      std::vector<NodeInfo>::iterator first, std::vector<NodeInfo>::iterator last,
+      const std::function<bool(const NodeInfo&)>& skip) const;
+  int32_t BucketIndex(const NodeId& node_id) const;
+  void InsertNode(const NodeInfo& peer, std::unique_lock<boost::shared_mutex>& lock);
+  // Read-only helpers accept either an exclusive or a shared lock on mutex_.
+  template <typename Lock>
+  std::vector<NodeInfo> GetClosestFromTarget(const NodeId& target, uint16_t number,
+                                             Lock& lock) const;
+  NodeId FurthestCloseNode() const;
+  // Counts a change to nodes_, republishing close_boundaries_.
+  void MembershipChanged(std::unique_lock<boost::shared_mutex>& lock);
+  // Swaps current_peer for a peer making comparable progress towards target_id over a much faster
+  // link, unless target_id is within this node's close group.  The caller must hold a lock on
+  // mutex_, which isn't recursive.
+  template <typename Lock>
+  void PreferFasterLink(const NodeId& target_id, const RouteHistory& exclude,
+                        NodeInfo& current_peer, Lock& lock) const;
+  template <typename Exclusions>
+  NodeInfo GetClosestNodeExcluding(const NodeId& target_id, const Exclusions& exclude,
+                                   bool ignore_exact_match);
+  template <typename Exclusions, typename Lock>
+  NodeInfo GetClosestNodeExcluding(const NodeId& target_id, const Exclusions& exclude,
+                                   bool ignore_exact_match, Lock& lock) const;
   std::vector<NodeInfo> GetClosestNodeInfo(const NodeId& target_id, uint16_t number_to_get,
                                            bool ignore_exact_match = false);
-  std::pair<bool, std::vector<NodeInfo>::iterator> Find(const NodeId& node_id,
-                                                        std::unique_lock<std::mutex>& lock);
-  std::pair<bool, std::vector<NodeInfo>::const_iterator> Find(
-      const NodeId& node_id, std::unique_lock<std::mutex>& lock) const;
+  std::pair<bool, std::vector<NodeInfo>::iterator> Find(
+      const NodeId& node_id, std::unique_lock<boost::shared_mutex>& lock);
+  template <typename Lock>
+  std::pair<bool, std::vector<NodeInfo>::const_iterator> Find(const NodeId& node_id,
+                                                              Lock& lock) const;
   void UpdateNetworkStatus(uint16_t size) const;
   void UpdateConnectedPeersMatrix(const std::vector<NodeInfo>& new_connected_peers,
                                   const std::vector<NodeInfo>& old_connected_peers);
+  // Gives matrix_change the next epoch and keeps its old matrix in matrix_history_, if it's to be
+  // reported.
+  void RecordMatrixChange(const std::shared_ptr<MatrixChange>& matrix_change,
+                          std::unique_lock<boost::shared_mutex>& lock);
 
-  void IpcSendGroupMatrix() const;
   std::string PrintRoutingTable();
   void PrintGroupMatrix();
 
@@ -173,17 +297,31 @@ class RoutingTable {
   const asymm::Keys kKeys_;
   const uint16_t kMaxSize_;
   const uint16_t kThresholdSize_;
-  mutable std::mutex mutex_;
-  NodeId furthest_closest_node_id_;
+  const uint16_t kBucketTargetSize_;
+  const uint16_t kGreedySize_;
+  // False for a client whose InstanceParameters::client_matrix_rows is unset.
+  const bool kKeepsMatrixRows_;
+  // Lookups take a shared lock, so they only contend with adding, dropping or updating nodes.
+  mutable boost::shared_mutex mutex_;
+  // Only accessed through std::atomic_load and std::atomic_store.
+  std::shared_ptr<const CloseBoundaries> close_boundaries_;
   std::function<void(const NodeInfo&, bool)> remove_node_functor_;
   NetworkStatusFunctor network_status_functor_;
   RemoveFurthestUnnecessaryNode remove_furthest_node_;
   ConnectedGroupChangeFunctor connected_group_change_functor_;
   MatrixChangedFunctor matrix_change_functor_;
+  // Kept sorted by distance from kNodeId_, and hence grouped into ascending buckets.
   std::vector<NodeInfo> nodes_;
   GroupMatrix group_matrix_;
-  std::unique_ptr<boost::interprocess::message_queue> ipc_message_queue_;
+  std::unique_ptr<MatrixSnapshotWriter> matrix_snapshot_writer_;
+  std::atomic<bool> group_matrix_changed_;
+  std::atomic<uint64_t> version_;
+  // The matrices the recorded changes started from, oldest first, the last of them from the change
+  // at matrix_epoch_.
+  uint64_t matrix_epoch_;
+  std::deque<std::shared_ptr<const MatrixMembers>> matrix_history_;
   NetworkStatistics& network_statistics_;
+  LinkQuality link_quality_;
 };
 
 }  // namespace routing
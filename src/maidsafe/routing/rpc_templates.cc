@@ -0,0 +1,135 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/rpc_templates.h"
+
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/message_handler.h"
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/route_history.h"
+#include "maidsafe/routing/rpcs.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+protobuf::Message RequestTemplate(const NodeId& this_node_id, MessageType type, bool direct,
+                                  bool client_node) {
+  protobuf::Message message;
+  message.set_source_id(this_node_id.string());
+  message.set_routing_message(true);
+  message.set_direct(direct);
+  message.set_replication(1);
+  message.set_type(static_cast<int32_t>(type));
+  message.set_request(true);
+  message.set_client_node(client_node);
+  message.set_hops_to_live(Parameters::hops_to_live);
+  return message;
+}
+
+protobuf::Message PingTemplate(const NodeId& this_node_id, bool client_node) {
+  protobuf::Message message(RequestTemplate(this_node_id, MessageType::kPing, true, client_node));
+  protobuf::PingRequest ping_request;
+  ping_request.set_ping(true);
+  message.add_data(ping_request.SerializeAsString());
+  return message;
+}
+
+protobuf::Message FindNodesTemplate(const NodeId& this_node_id) {
+  protobuf::Message message(
+      RequestTemplate(this_node_id, MessageType::kFindNodes, false, false));
+  message.set_last_id(this_node_id.string());
+  message.add_route_history(RouteHistory::Prefix(this_node_id));
+  message.set_visited(false);
+  protobuf::FindNodesRequest find_nodes;
+  find_nodes.set_want_contacts(true);
+  message.add_data(find_nodes.SerializePartialAsString());
+  return message;
+}
+
+protobuf::Message GetGroupTemplate(const NodeId& this_node_id) {
+  protobuf::Message message(RequestTemplate(this_node_id, MessageType::kGetGroup, false, false));
+  message.set_visited(false);
+  message.add_data(std::string());
+  return message;
+}
+
+// The varying fields of the request are appended by the caller to data(0), already serialised:
+// parsing merges them with the prepared ones.
+protobuf::Message FromTemplate(const protobuf::Message& request_template, const NodeId& node_id) {
+  assert(!node_id.IsZero() && "Invalid node_id");
+  protobuf::Message message(request_template);
+  message.set_destination_id(node_id.string());
+  return message;
+}
+
+}  // unnamed namespace
+
+RpcTemplates::RpcTemplates(const NodeId& this_node_id, bool client_node)
+    : kPing_(PingTemplate(this_node_id, client_node)),
+      kFindNodes_(FindNodesTemplate(this_node_id)),
+      kGetGroup_(GetGroupTemplate(this_node_id)) {
+  assert(!this_node_id.IsZero() && "Invalid my node_id");
+}
+
+protobuf::Message RpcTemplates::Ping(const NodeId& node_id, uint64_t probe_stamp) const {
+  protobuf::Message message(FromTemplate(kPing_, node_id));
+  protobuf::PingRequest ping_request;
+  if (probe_stamp != 0)
+    ping_request.set_probe_stamp(probe_stamp);
+#ifdef TESTING
+  ping_request.set_timestamp(GetTimeStamp());
+#endif
+  ping_request.AppendPartialToString(message.mutable_data(0));
+  assert(message.IsInitialized() && "Uninitialised message");
+  return message;
+}
+
+protobuf::Message RpcTemplates::FindNodes(const NodeId& node_id, int num_nodes_requested) const {
+  protobuf::Message message(FromTemplate(kFindNodes_, node_id));
+  message.set_id(NewRpcId());
+  protobuf::FindNodesRequest find_nodes;
+  find_nodes.set_num_nodes_requested(num_nodes_requested);
+  find_nodes.set_target_node(node_id.string());
+#ifdef TESTING
+  find_nodes.set_timestamp(GetTimeStamp());
+#endif
+  find_nodes.AppendToString(message.mutable_data(0));
+  assert(message.IsInitialized() && "Uninitialised message");
+  return message;
+}
+
+protobuf::Message RpcTemplates::GetGroup(const NodeId& node_id,
+                                         const std::vector<NodeId>& additional_node_ids) const {
+  protobuf::Message message(FromTemplate(kGetGroup_, node_id));
+  message.set_id(NewRpcId());
+  protobuf::GetGroup get_group;
+  get_group.set_node_id(node_id.string());
+  for (const auto& additional_node_id : additional_node_ids)
+    get_group.add_additional_node_ids(additional_node_id.string());
+  get_group.AppendToString(message.mutable_data(0));
+  assert(message.IsInitialized() && "Uninitialised message");
+  return message;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
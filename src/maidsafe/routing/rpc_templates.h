@@ -0,0 +1,61 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_RPC_TEMPLATES_H_
+#define MAIDSAFE_ROUTING_RPC_TEMPLATES_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// Builds this node's frequent maintenance RPCs from messages prepared once, holding every field
+// which is the same for each request.  Making one is then a copy of the prepared message, with its
+// destination and id set and the varying fields of its request appended, already serialised, to
+// the prepared ones.  The messages are otherwise those of the rpcs functions of the same names.
+class RpcTemplates {
+ public:
+  RpcTemplates(const NodeId& this_node_id, bool client_node);
+  // See rpcs::Ping.  Unlike that, the ping is marked as coming from a client if this node is one.
+  protobuf::Message Ping(const NodeId& node_id, uint64_t probe_stamp = 0) const;
+  // See rpcs::FindNodes: this doesn't relay, and always asks for contacts.
+  protobuf::Message FindNodes(const NodeId& node_id, int num_nodes_requested) const;
+  // See rpcs::GetGroup.
+  protobuf::Message GetGroup(const NodeId& node_id,
+                             const std::vector<NodeId>& additional_node_ids =
+                                 std::vector<NodeId>()) const;
+
+ private:
+  RpcTemplates(const RpcTemplates&);
+  RpcTemplates& operator=(const RpcTemplates&);
+
+  const protobuf::Message kPing_, kFindNodes_, kGetGroup_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_RPC_TEMPLATES_H_
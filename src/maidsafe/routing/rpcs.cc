@@ -18,12 +18,15 @@
 
 #include "maidsafe/routing/rpcs.h"
 
+#include <limits>
+
 #include "maidsafe/common/log.h"
 #include "maidsafe/common/node_id.h"
 #include "maidsafe/routing/node_info.h"
 #include "maidsafe/common/utils.h"
 
 #include "maidsafe/routing/message_handler.h"
+#include "maidsafe/routing/route_history.h"
 #include "maidsafe/routing/routing.pb.h"
 #include "maidsafe/routing/utils.h"
 
@@ -33,13 +36,19 @@ namespace routing {
 
 namespace rpcs {
 
+int32_t NewRpcId() {
+  return static_cast<int32_t>(RandomUint32() % std::numeric_limits<int32_t>::max()) + 1;
+}
+
 // This is maybe not required and might be removed
-protobuf::Message Ping(const NodeId& node_id, const std::string& identity) {
+protobuf::Message Ping(const NodeId& node_id, const std::string& identity, uint64_t probe_stamp) {
   assert(!node_id.IsZero() && "Invalid node_id");
   assert(!identity.empty() && "Invalid identity");
   protobuf::Message message;
   protobuf::PingRequest ping_request;
   ping_request.set_ping(true);
+  if (probe_stamp != 0)
+    ping_request.set_probe_stamp(probe_stamp);
 #ifdef TESTING
   ping_request.set_timestamp(GetTimeStamp());
 #endif
@@ -60,7 +69,7 @@ protobuf::Message Ping(const NodeId& node_id, const std::string& identity) {
 protobuf::Message Connect(const NodeId& node_id, const rudp::EndpointPair& our_endpoint,
                           const NodeId& this_node_id, const NodeId& this_connection_id,
                           bool client_node, rudp::NatType nat_type, bool relay_message,
-                          NodeId relay_connection_id) {
+                          NodeId relay_connection_id, bool shortcut) {
   assert(!node_id.IsZero() && "Invalid node_id");
   assert(!this_node_id.IsZero() && "Invalid my node_id");
   assert(!this_connection_id.IsZero() && "Invalid this_connection_id");
@@ -76,10 +85,12 @@ protobuf::Message Connect(const NodeId& node_id, const rudp::EndpointPair& our_e
   contact->set_node_id(this_node_id.string());
   contact->set_connection_id(this_connection_id.string());
   contact->set_nat_type(NatTypeProtobuf(nat_type));
+  if (shortcut)
+    protobuf_connect_request.set_shortcut(true);
 #ifdef TESTING
   protobuf_connect_request.set_timestamp(GetTimeStamp());
 #endif
-  message.set_id(RandomUint32() % 10000);
+  message.set_id(NewRpcId());
   message.set_destination_id(node_id.string());
   message.set_routing_message(true);
   message.add_data(protobuf_connect_request.SerializeAsString());
@@ -121,7 +132,7 @@ protobuf::Message Remove(const NodeId& node_id, const NodeId& this_node_id,
   message.set_direct(true);
   message.set_replication(1);
   message.set_type(static_cast<int32_t>(MessageType::kRemove));
-  message.set_id(RandomUint32() % 10000);
+  message.set_id(NewRpcId());
   message.set_client_node(false);
   message.set_hops_to_live(Parameters::hops_to_live);
   message.set_source_id(this_node_id.string());
@@ -132,13 +143,15 @@ protobuf::Message Remove(const NodeId& node_id, const NodeId& this_node_id,
 
 protobuf::Message FindNodes(const NodeId& node_id, const NodeId& this_node_id,
                             int num_nodes_requested, bool relay_message,
-                            NodeId relay_connection_id) {
+                            NodeId relay_connection_id, bool want_contacts) {
   assert(!node_id.IsZero() && "Invalid node_id");
   assert(!this_node_id.IsZero() && "Invalid my node_id");
   protobuf::Message message;
   protobuf::FindNodesRequest find_nodes;
   find_nodes.set_num_nodes_requested(num_nodes_requested);
   find_nodes.set_target_node(node_id.string());
+  if (want_contacts)
+    find_nodes.set_want_contacts(true);
 #ifdef TESTING
   find_nodes.set_timestamp(GetTimeStamp());
 #endif
@@ -150,10 +163,10 @@ protobuf::Message FindNodes(const NodeId& node_id, const NodeId& this_node_id,
   message.set_replication(1);
   message.set_type(static_cast<int32_t>(MessageType::kFindNodes));
   message.set_request(true);
-  message.add_route_history(this_node_id.string());
+  message.add_route_history(RouteHistory::Prefix(this_node_id));
   message.set_client_node(false);
   message.set_visited(false);
-  message.set_id(RandomUint32() % 10000);
+  message.set_id(NewRpcId());
   if (!relay_message) {
     message.set_source_id(this_node_id.string());
   } else {
@@ -185,12 +198,11 @@ protobuf::Message ConnectSuccess(const NodeId& node_id, const NodeId& this_node_
   message.set_direct(true);
   message.set_replication(1);
   message.set_type(static_cast<int32_t>(MessageType::kConnectSuccess));
-  message.set_id(0);
   message.set_client_node(client_node);
   message.set_hops_to_live(Parameters::hops_to_live);
   message.set_source_id(this_node_id.string());
   message.set_request(true);
-  message.set_id(RandomUint32() % 10000);
+  message.set_id(NewRpcId());
   assert(message.IsInitialized() && "Unintialised message");
   return message;
 }
@@ -217,30 +229,21 @@ protobuf::Message ConnectSuccessAcknowledgement(const NodeId& node_id, const Nod
   message.set_direct(true);
   message.set_replication(1);
   message.set_type(static_cast<int32_t>(MessageType::kConnectSuccessAcknowledgement));
-  message.set_id(0);
   message.set_client_node(client_node);
   message.set_hops_to_live(Parameters::hops_to_live);
   message.set_source_id(this_node_id.string());
   message.set_request(false);
-  message.set_id(RandomUint32() % 10000);
+  message.set_id(NewRpcId());
   assert(message.IsInitialized() && "Unintialised message");
   return message;
 }
 
-protobuf::Message ClosestNodesUpdate(const NodeId& node_id, const NodeId& my_node_id,
-                                     const std::vector<NodeInfo>& closest_nodes) {
-  assert(!node_id.IsZero() && "Invalid node_id");
-  assert(!my_node_id.IsZero() && "Invalid my node_id");
-  // assert(!close_nodes.empty() && "Empty close nodes");
+namespace {
+
+protobuf::Message ClosestNodesUpdateMessage(
+    const NodeId& node_id, const NodeId& my_node_id,
+    const protobuf::ClosestNodesUpdate& closest_nodes_update) {
   protobuf::Message message;
-  protobuf::ClosestNodesUpdate closest_nodes_update;
-  closest_nodes_update.set_node(my_node_id.string());
-  for (const auto& i : closest_nodes) {
-    protobuf::BasicNodeInfo* basic_node_info;
-    basic_node_info = closest_nodes_update.add_nodes_info();
-    basic_node_info->set_node_id(i.node_id.string());
-    basic_node_info->set_rank(i.rank);
-  }
   message.set_destination_id(node_id.string());
   message.set_source_id(my_node_id.string());
   message.set_routing_message(true);
@@ -251,17 +254,75 @@ protobuf::Message ClosestNodesUpdate(const NodeId& node_id, const NodeId& my_nod
   message.set_request(true);
   message.set_client_node(false);
   message.set_hops_to_live(Parameters::hops_to_live);
-  message.set_id(RandomUint32() % 10000);
+  message.set_id(NewRpcId());
   assert(message.IsInitialized() && "Unintialised message");
   return message;
 }
 
-protobuf::Message GetGroup(const NodeId& node_id, const NodeId& my_node_id) {
+void AddBasicNodeInfos(const std::vector<NodeInfo>& nodes,
+                       protobuf::ClosestNodesUpdate& closest_nodes_update) {
+  for (const auto& i : nodes) {
+    protobuf::BasicNodeInfo* basic_node_info;
+    basic_node_info = closest_nodes_update.add_nodes_info();
+    basic_node_info->set_node_id(i.node_id.string());
+    basic_node_info->set_rank(i.rank);
+  }
+}
+
+}  // unnamed namespace
+
+protobuf::Message ClosestNodesUpdate(const NodeId& node_id, const NodeId& my_node_id,
+                                     const std::vector<NodeInfo>& closest_nodes,
+                                     uint32_t version) {
+  assert(!node_id.IsZero() && "Invalid node_id");
+  assert(!my_node_id.IsZero() && "Invalid my node_id");
+  // assert(!close_nodes.empty() && "Empty close nodes");
+  protobuf::ClosestNodesUpdate closest_nodes_update;
+  closest_nodes_update.set_node(my_node_id.string());
+  AddBasicNodeInfos(closest_nodes, closest_nodes_update);
+  if (version != 0)
+    closest_nodes_update.set_version(version);
+  return ClosestNodesUpdateMessage(node_id, my_node_id, closest_nodes_update);
+}
+
+protobuf::Message ClosestNodesUpdateDelta(const NodeId& node_id, const NodeId& my_node_id,
+                                          const std::vector<NodeInfo>& added_nodes,
+                                          const std::vector<NodeId>& removed_nodes,
+                                          uint32_t base_version, uint32_t version) {
+  assert(!node_id.IsZero() && "Invalid node_id");
+  assert(!my_node_id.IsZero() && "Invalid my node_id");
+  assert(base_version != 0 && version != 0 && "Deltas must be versioned");
+  protobuf::ClosestNodesUpdate closest_nodes_update;
+  closest_nodes_update.set_node(my_node_id.string());
+  AddBasicNodeInfos(added_nodes, closest_nodes_update);
+  for (const auto& removed_node : removed_nodes)
+    closest_nodes_update.add_removed_nodes(removed_node.string());
+  closest_nodes_update.set_base_version(base_version);
+  closest_nodes_update.set_version(version);
+  return ClosestNodesUpdateMessage(node_id, my_node_id, closest_nodes_update);
+}
+
+protobuf::Message ClosestNodesUpdateDigest(const NodeId& node_id, const NodeId& my_node_id,
+                                           uint32_t version, uint64_t digest) {
+  assert(!node_id.IsZero() && "Invalid node_id");
+  assert(!my_node_id.IsZero() && "Invalid my node_id");
+  assert(version != 0 && "Digests must be versioned");
+  protobuf::ClosestNodesUpdate closest_nodes_update;
+  closest_nodes_update.set_node(my_node_id.string());
+  closest_nodes_update.set_version(version);
+  closest_nodes_update.set_digest(digest);
+  return ClosestNodesUpdateMessage(node_id, my_node_id, closest_nodes_update);
+}
+
+protobuf::Message GetGroup(const NodeId& node_id, const NodeId& my_node_id,
+                           const std::vector<NodeId>& additional_node_ids) {
   assert(!node_id.IsZero() && "Invalid node_id");
   assert(!my_node_id.IsZero() && "Invalid my node_id");
   protobuf::Message message;
   protobuf::GetGroup get_group;
   get_group.set_node_id(node_id.string());
+  for (const auto& additional_node_id : additional_node_ids)
+    get_group.add_additional_node_ids(additional_node_id.string());
   message.add_data(get_group.SerializeAsString());
   message.set_destination_id(node_id.string());
   message.set_source_id(my_node_id.string());
@@ -273,7 +334,7 @@ protobuf::Message GetGroup(const NodeId& node_id, const NodeId& my_node_id) {
   message.set_client_node(false);
   message.set_hops_to_live(Parameters::hops_to_live);
   message.set_visited(false);
-  message.set_id(RandomUint32() % 10000);
+  message.set_id(NewRpcId());
   assert(message.IsInitialized() && "Unintialised message");
   return message;
 }
@@ -19,6 +19,7 @@
 #ifndef MAIDSAFE_ROUTING_RPCS_H_
 #define MAIDSAFE_ROUTING_RPCS_H_
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -40,21 +41,30 @@ class Message;
 
 namespace rpcs {
 
-protobuf::Message Ping(const NodeId& node_id, const std::string& identity);
+// A random id for a routing RPC, non-zero and from the whole positive range of the id field.
+// DuplicateFilter tells RPCs with the same source, destination and type apart by their ids alone,
+// and ids from a range as small as 10000 would repeat within about a hundred RPCs.
+int32_t NewRpcId();
+
+// A non-zero probe_stamp is echoed back for measuring the link to node_id.
+protobuf::Message Ping(const NodeId& node_id, const std::string& identity,
+                       uint64_t probe_stamp = 0);
 
 protobuf::Message Connect(const NodeId& node_id, const rudp::EndpointPair& our_endpoint,
                           const NodeId& this_node_id, const NodeId& this_connection_id,
                           bool client_node = false,
                           rudp::NatType nat_type = rudp::NatType::kUnknown,
-                          bool relay_message = false, NodeId relay_connection_id = NodeId());
+                          bool relay_message = false, NodeId relay_connection_id = NodeId(),
+                          bool shortcut = false);
 
 protobuf::Message Remove(const NodeId& node_id, const NodeId& this_node_id,
                          const NodeId& this_connection_id,
                          const std::vector<std::string>& attempted_nodes);
 
+// With want_contacts, the response also gives the NAT type of each node found.
 protobuf::Message FindNodes(const NodeId& node_id, const NodeId& this_node_id,
                             int num_nodes_requested, bool relay_message = false,
-                            NodeId relay_connection_id = NodeId());
+                            NodeId relay_connection_id = NodeId(), bool want_contacts = false);
 
 protobuf::Message ProxyConnect(const NodeId& node_id, const NodeId& this_node_id,
                                const rudp::EndpointPair& endpoint_pair, bool relay_message = false,
@@ -71,9 +81,20 @@ protobuf::Message ConnectSuccessAcknowledgement(const NodeId& node_id, const Nod
                                                 bool client_node);
 
 protobuf::Message ClosestNodesUpdate(const NodeId& node_id, const NodeId& my_node_id,
-                                     const std::vector<NodeInfo>& closest_nodes);
+                                     const std::vector<NodeInfo>& closest_nodes,
+                                     uint32_t version = 0);
+
+protobuf::Message ClosestNodesUpdateDelta(const NodeId& node_id, const NodeId& my_node_id,
+                                          const std::vector<NodeInfo>& added_nodes,
+                                          const std::vector<NodeId>& removed_nodes,
+                                          uint32_t base_version, uint32_t version);
+
+protobuf::Message ClosestNodesUpdateDigest(const NodeId& node_id, const NodeId& my_node_id,
+                                           uint32_t version, uint64_t digest);
 
-protobuf::Message GetGroup(const NodeId& node_id, const NodeId& my_node_id);
+// The group of each of additional_node_ids is returned too, by whichever node answers for node_id.
+protobuf::Message GetGroup(const NodeId& node_id, const NodeId& my_node_id,
+                           const std::vector<NodeId>& additional_node_ids = std::vector<NodeId>());
 
 }  // namespace rpcs
 
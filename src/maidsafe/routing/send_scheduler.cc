@@ -0,0 +1,178 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/send_scheduler.h"
+
+#include <utility>
+#include <vector>
+
+#include "maidsafe/rudp/return_codes.h"
+
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+// Bytes each class may send per turn, in the ratio 8:4:1.
+const std::array<int64_t, 3> kQuanta = {{64 * 1024, 32 * 1024, 8 * 1024}};
+
+}  // unnamed namespace
+
+SendPriority MessagePriority(const protobuf::Message& message) {
+  if (message.has_priority() &&
+      message.priority() >= static_cast<int32_t>(SendPriority::kControl) &&
+      message.priority() <= static_cast<int32_t>(SendPriority::kBulk)) {
+    return static_cast<SendPriority>(message.priority());
+  }
+  return message.routing_message() ? SendPriority::kControl : SendPriority::kInteractive;
+}
+
+void SetSendPriority(protobuf::Message& message) {
+  if (message.routing_message())
+    return;
+  size_t data_size(0);
+  for (const auto& data : message.data())
+    data_size += data.size();
+  if (data_size >= Parameters::bulk_message_size)
+    message.set_priority(static_cast<int32_t>(SendPriority::kBulk));
+  else
+    message.clear_priority();
+}
+
+const size_t SendScheduler::kClassCount;
+
+SendScheduler::SendScheduler(uint16_t max_in_flight, DispatchFunctor dispatch)
+    : kMaxInFlight_(max_in_flight), kDispatch_(std::move(dispatch)), mutex_(), peers_() {}
+
+void SendScheduler::Send(const NodeId& peer_id, SendPriority priority, std::string serialised,
+                         rudp::MessageSentFunctor message_sent_functor) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    PeerQueues& peer(peers_[peer_id]);
+    Queued queued;
+    queued.serialised.swap(serialised);
+    queued.message_sent_functor = std::move(message_sent_functor);
+    peer.queues[static_cast<size_t>(priority)].push_back(std::move(queued));
+    ++peer.queued;
+  }
+  DispatchQueued(peer_id);
+}
+
+void SendScheduler::Remove(const NodeId& peer_id) {
+  std::vector<rudp::MessageSentFunctor> discarded;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto itr(peers_.find(peer_id));
+    if (itr == peers_.end())
+      return;
+    for (auto& queue : itr->second.queues) {
+      for (auto& queued : queue)
+        discarded.push_back(std::move(queued.message_sent_functor));
+    }
+    // Messages in flight still report back, so their count is kept.
+    if (itr->second.in_flight == 0) {
+      peers_.erase(itr);
+    } else {
+      uint16_t in_flight(itr->second.in_flight);
+      itr->second = PeerQueues();
+      itr->second.in_flight = in_flight;
+    }
+  }
+  for (const auto& functor : discarded) {
+    if (functor)
+      functor(rudp::kSendFailure);
+  }
+}
+
+size_t SendScheduler::queued(const NodeId& peer_id) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(peers_.find(peer_id));
+  return itr == peers_.end() ? 0 : itr->second.queued;
+}
+
+void SendScheduler::DispatchQueued(const NodeId& peer_id) {
+  for (;;) {
+    Queued next;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto itr(peers_.find(peer_id));
+      if (itr == peers_.end())
+        return;
+      PeerQueues& peer(itr->second);
+      if (peer.in_flight >= kMaxInFlight_ || !TakeNext(peer, next)) {
+        if (peer.in_flight == 0 && peer.queued == 0)
+          peers_.erase(itr);
+        return;
+      }
+      ++peer.in_flight;
+    }
+    Dispatch(peer_id, next);
+  }
+}
+
+bool SendScheduler::TakeNext(PeerQueues& peer, Queued& next) {
+  if (peer.queued == 0)
+    return false;
+  // Each class with messages waiting, visited in turn, earns its quantum and sends while what it
+  // has earned covers the message at its head.  A class with nothing waiting keeps no credit.
+  for (;;) {
+    std::deque<Queued>& queue(peer.queues[peer.current]);
+    int64_t& deficit(peer.deficits[peer.current]);
+    if (queue.empty()) {
+      deficit = 0;
+    } else {
+      if (!peer.credited) {
+        deficit += kQuanta[peer.current];
+        peer.credited = true;
+      }
+      const int64_t kSize(static_cast<int64_t>(queue.front().serialised.size()));
+      if (deficit >= kSize) {
+        deficit -= kSize;
+        next = std::move(queue.front());
+        queue.pop_front();
+        --peer.queued;
+        return true;
+      }
+    }
+    peer.current = (peer.current + 1) % kClassCount;
+    peer.credited = false;
+  }
+}
+
+void SendScheduler::Dispatch(const NodeId& peer_id, Queued& queued) {
+  rudp::MessageSentFunctor message_sent_functor(std::move(queued.message_sent_functor));
+  kDispatch_(peer_id, queued.serialised, [this, peer_id, message_sent_functor](int result) {
+    if (message_sent_functor)
+      message_sent_functor(result);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto itr(peers_.find(peer_id));
+      if (itr != peers_.end() && itr->second.in_flight != 0)
+        --itr->second.in_flight;
+    }
+    DispatchQueued(peer_id);
+  });
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,104 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_SEND_SCHEDULER_H_
+#define MAIDSAFE_ROUTING_SEND_SCHEDULER_H_
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/rudp/managed_connections.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace protobuf {
+class Message;
+}
+
+enum class SendPriority : int32_t { kControl = 0, kInteractive = 1, kBulk = 2 };
+
+// Routing messages are control traffic, and node level messages interactive unless their sender
+// marked them bulk (see SetSendPriority).  A message's priority field, where set, overrides this.
+SendPriority MessagePriority(const protobuf::Message& message);
+// Marks a node level message bulk if its data is at least Parameters::bulk_message_size, so that
+// each hop sends it as such.
+void SetSendPriority(protobuf::Message& message);
+
+// Queues each peer's outbound messages by priority, handing at most max_in_flight (non-zero) of
+// them at a time to dispatch and so to rudp.  As each is reported sent, the next is chosen by
+// deficit round robin across the classes, weighted 8:4:1 by bytes, so bulk transfers keep a share
+// of the link without holding up control traffic queued behind them.  A message already handed
+// to rudp isn't preempted.
+class SendScheduler {
+ public:
+  typedef std::function<void(const NodeId& /*peer_id*/, const std::string& /*serialised*/,
+                             const rudp::MessageSentFunctor& /*message_sent_functor*/)>
+      DispatchFunctor;
+
+  SendScheduler(uint16_t max_in_flight, DispatchFunctor dispatch);
+  void Send(const NodeId& peer_id, SendPriority priority, std::string serialised,
+            rudp::MessageSentFunctor message_sent_functor);
+  // Discards what is queued for peer_id, firing each discarded message's functor with
+  // rudp::kSendFailure.
+  void Remove(const NodeId& peer_id);
+  size_t queued(const NodeId& peer_id) const;
+
+ private:
+  SendScheduler(const SendScheduler&);
+  SendScheduler& operator=(const SendScheduler&);
+
+  struct Queued {
+    Queued() : serialised(), message_sent_functor() {}
+    std::string serialised;
+    rudp::MessageSentFunctor message_sent_functor;
+  };
+  static const size_t kClassCount = 3;
+  struct PeerQueues {
+    PeerQueues() : queues(), deficits(), current(0), credited(false), queued(0), in_flight(0) {}
+    std::array<std::deque<Queued>, kClassCount> queues;
+    std::array<int64_t, kClassCount> deficits;
+    size_t current;  // the class being served
+    bool credited;   // whether current has had its quantum this turn
+    size_t queued;
+    uint16_t in_flight;
+  };
+
+  // Dispatches queued messages for peer_id while it has fewer than kMaxInFlight_ in flight.
+  void DispatchQueued(const NodeId& peer_id);
+  static bool TakeNext(PeerQueues& peer, Queued& next);
+  void Dispatch(const NodeId& peer_id, Queued& queued);
+
+  const uint16_t kMaxInFlight_;
+  const DispatchFunctor kDispatch_;
+  mutable std::mutex mutex_;
+  std::map<NodeId, PeerQueues> peers_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_SEND_SCHEDULER_H_
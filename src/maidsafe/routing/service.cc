@@ -50,11 +50,13 @@ typedef boost::asio::ip::udp::endpoint Endpoint;
 }  // unnamed namespace
 
 Service::Service(RoutingTable& routing_table, ClientRoutingTable& client_routing_table,
-                 NetworkUtils& network)
+                 NetworkUtils& network, const InstanceParameters& parameters)
     : routing_table_(routing_table),
       client_routing_table_(client_routing_table),
       network_(network),
-      request_public_key_functor_() {}
+      kMaxRoutingTableSizeForClient_(parameters.max_routing_table_size_for_client),
+      request_public_key_functor_(),
+      find_nodes_memo_(Parameters::find_nodes_memo_ttl, Parameters::find_nodes_memo_size) {}
 
 Service::~Service() {}
 
@@ -151,13 +153,15 @@ void Service::Connect(protobuf::Message& message) {
   bool check_node_succeeded(false);
   if (message.client_node()) {  // Client node, check non-routing table
     LOG(kVerbose) << "Client connect request - will check non-routing table.";
-    NodeId furthest_close_node_id =
-        routing_table_.GetNthClosestNode(routing_table_.kNodeId(),
-                                         2 * Parameters::closest_nodes_size).node_id;
-    check_node_succeeded = client_routing_table_.CheckNode(peer_node, furthest_close_node_id);
+    check_node_succeeded = client_routing_table_.CheckNode(
+        peer_node, routing_table_.close_boundaries()->furthest_client_close_node);
   } else {
     LOG(kVerbose) << "Server connect request - will check routing table.";
     check_node_succeeded = routing_table_.CheckNode(peer_node);
+    // A far vault may still be taken as a shortcut, if this node keeps them.
+    if (!check_node_succeeded && connect_request.shortcut() && !routing_table_.client_mode() &&
+        !routing_table_.Contains(peer_node.node_id))
+      check_node_succeeded = network_.shortcuts().Expect(peer_node.node_id, true);
   }
 
   if (check_node_succeeded) {
@@ -238,17 +242,45 @@ void Service::FindNodes(protobuf::Message& message) {
   LOG(kVerbose) << "[" << DebugId(routing_table_.kNodeId()) << "]"
                 << " parsed find node request for target id : "
                 << HexSubstr(find_nodes.target_node());
-  protobuf::FindNodesResponse found_nodes;
-  std::vector<NodeId> nodes(
-      routing_table_.GetClosestNodes(NodeId(find_nodes.target_node()),
-                                     static_cast<uint16_t>(find_nodes.num_nodes_requested() - 1)));
-  found_nodes.add_nodes(routing_table_.kNodeId().string());
-
-  for (const auto& node : nodes)
-    found_nodes.add_nodes(node.string());
+  const NodeId kTarget(find_nodes.target_node());
+  const uint32_t kCount(static_cast<uint32_t>(find_nodes.num_nodes_requested()));
+  const bool kWantContacts(find_nodes.want_contacts());
+  // Read before the lookup, so that a table change made during it drops the memoised result.
+  const uint64_t kTableVersion(routing_table_.version());
+  std::string serialised_nodes;
+  if (find_nodes_memo_.Get(kTarget, kCount, kWantContacts, kTableVersion, serialised_nodes)) {
+    LOG(kVerbose) << "Responding Find node with memoised contacts.";
+  } else {
+    protobuf::FindNodesResponse found_nodes;
+    std::vector<NodeId> nodes(
+        routing_table_.GetClosestNodes(kTarget, static_cast<uint16_t>(kCount - 1)));
+    found_nodes.add_nodes(routing_table_.kNodeId().string());
+
+    for (const auto& node : nodes)
+      found_nodes.add_nodes(node.string());
+
+    if (kWantContacts) {
+      protobuf::FoundContact* contact(found_nodes.add_contacts());
+      contact->set_node_id(routing_table_.kNodeId().string());
+      contact->set_nat_type(NatTypeProtobuf(network_.nat_type()));
+      for (const auto& node : nodes) {
+        NodeInfo node_info;
+        contact = found_nodes.add_contacts();
+        contact->set_node_id(node.string());
+        if (routing_table_.GetNodeInfo(node, node_info))
+          contact->set_nat_type(NatTypeProtobuf(node_info.nat_type));
+      }
+    }
 
-  LOG(kVerbose) << "Responding Find node with " << found_nodes.nodes_size() << " contacts.";
+    LOG(kVerbose) << "Responding Find node with " << found_nodes.nodes_size() << " contacts.";
+    serialised_nodes = found_nodes.SerializePartialAsString();
+    find_nodes_memo_.Add(kTarget, kCount, kWantContacts, kTableVersion, serialised_nodes);
+  }
 
+  // Serialised messages concatenated parse as one, so the fields set per request are serialised
+  // apart from the memoised ones and appended.  Without contacts, this is byte for byte what
+  // serialising the whole response would give.
+  protobuf::FindNodesResponse found_nodes;
   found_nodes.set_original_request(message.data(0));
   found_nodes.set_original_signature(message.signature());
 #ifdef TESTING
@@ -264,7 +296,7 @@ void Service::FindNodes(protobuf::Message& message) {
   message.set_source_id(routing_table_.kNodeId().string());
   message.clear_route_history();
   message.clear_data();
-  message.add_data(found_nodes.SerializeAsString());
+  message.add_data(serialised_nodes + found_nodes.SerializeAsString());
   message.set_direct(true);
   message.set_replication(1);
   message.set_client_node(routing_table_.client_mode());
@@ -308,7 +340,7 @@ void Service::ConnectSuccessFromResponder(NodeInfo& peer, bool client) {
     return;
   }
   auto count =
-      (client ? Parameters::max_routing_table_size_for_client : Parameters::greedy_fraction);
+      (client ? kMaxRoutingTableSizeForClient_ : routing_table_.kGreedySize());
   std::vector<NodeId> close_ids_for_peer(routing_table_.GetClosestNodes(peer.node_id, count));
 
   auto itr(std::find_if(close_ids_for_peer.begin(), close_ids_for_peer.end(),
@@ -333,6 +365,27 @@ void Service::GetGroup(protobuf::Message& message) {
   get_group.set_node_id(routing_table_.kNodeId().string());
   for (const auto& node_id : close_nodes_id)
     get_group.add_group_nodes_id(node_id.string());
+  if (get_group.additional_node_ids_size() != 0) {
+    std::vector<NodeId> additional_node_ids;
+    for (const auto& additional_node_id : get_group.additional_node_ids())
+      additional_node_ids.push_back(NodeId(additional_node_id));
+    // The request was routed towards node_id only, so this node may be far from the others'
+    // groups.  Those it can't answer for are flagged, for the requester to ask about separately.
+    std::vector<GroupRangeStatus> statuses;
+    routing_table_.IsNodeIdInGroupRange(additional_node_ids, statuses);
+    std::vector<std::vector<NodeId>> additional_groups;
+    routing_table_.GetGroups(additional_node_ids, additional_groups);
+    for (size_t i(0); i != additional_groups.size(); ++i) {
+      auto group(get_group.add_additional_groups());
+      if (statuses[i] != GroupRangeStatus::kInRange) {
+        group->set_out_of_range(true);
+        continue;
+      }
+      for (const auto& node_id : additional_groups[i])
+        group->add_group_nodes_id(node_id.string());
+    }
+    get_group.clear_additional_node_ids();
+  }
   message.clear_route_history();
   message.set_destination_id(message.source_id());
   message.set_source_id(routing_table_.kNodeId().string());
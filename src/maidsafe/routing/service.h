@@ -19,9 +19,12 @@
 #ifndef MAIDSAFE_ROUTING_SERVICE_H_
 #define MAIDSAFE_ROUTING_SERVICE_H_
 
+#include <cstdint>
 #include <memory>
 
 #include "maidsafe/routing/api_config.h"
+#include "maidsafe/routing/find_nodes_memo.h"
+#include "maidsafe/routing/parameters.h"
 
 namespace maidsafe {
 
@@ -38,7 +41,7 @@ class RoutingTable;
 class Service {
  public:
   Service(RoutingTable& routing_table, ClientRoutingTable& client_routing_table,
-          NetworkUtils& network);
+          NetworkUtils& network, const InstanceParameters& parameters = InstanceParameters());
   virtual ~Service();
   // Handle all incoming requests and send back reply
   virtual void Ping(protobuf::Message& message);
@@ -57,7 +60,9 @@ class Service {
   RoutingTable& routing_table_;
   ClientRoutingTable& client_routing_table_;
   NetworkUtils& network_;
+  const uint16_t kMaxRoutingTableSizeForClient_;
   RequestPublicKeyFunctor request_public_key_functor_;
+  FindNodesMemo find_nodes_memo_;
 };
 
 }  // namespace routing
@@ -0,0 +1,195 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/shortcut_table.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+// Send counts are kept for at most this many destinations, all being reset once there are more.
+const size_t kMaxCountedDestinations(1024);
+
+}  // unnamed namespace
+
+ShortcutTable::ShortcutTable(uint16_t capacity, uint16_t threshold, Clock::duration idle_timeout)
+    : kCapacity_(capacity),
+      kThreshold_(std::max(threshold, static_cast<uint16_t>(1))),
+      kIdleTimeout_(idle_timeout),
+      mutex_(),
+      send_counts_(),
+      expected_(),
+      shortcuts_() {}
+
+bool ShortcutTable::CountSend(const NodeId& destination_id) {
+  if (!enabled())
+    return false;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (send_counts_.size() >= kMaxCountedDestinations &&
+      send_counts_.find(destination_id) == std::end(send_counts_))
+    send_counts_.clear();
+  uint16_t& count(send_counts_[destination_id]);
+  if (++count < kThreshold_)
+    return false;
+  send_counts_.erase(destination_id);
+  return true;
+}
+
+bool ShortcutTable::Expect(const NodeId& peer_id, bool inbound) {
+  if (!enabled())
+    return false;
+  const auto kNow(Clock::now());
+  std::lock_guard<std::mutex> lock(mutex_);
+  ExpireExpected(kNow);
+  if (std::any_of(std::begin(shortcuts_), std::end(shortcuts_),
+                  [&](const Shortcut& shortcut) { return shortcut.peer.node_id == peer_id; }))
+    return false;
+  auto itr(expected_.find(peer_id));
+  if (itr != std::end(expected_)) {
+    // One both ends have asked for counts as this node's own.
+    itr->second.since = kNow;
+    itr->second.inbound = itr->second.inbound && inbound;
+    return true;
+  }
+  if (inbound && shortcuts_.size() >= kCapacity_)
+    return false;
+  if (std::count_if(std::begin(expected_), std::end(expected_),
+                    [&](const std::pair<const NodeId, Expected>& expected) {
+                      return expected.second.inbound == inbound;
+                    }) >= kCapacity_)
+    return false;
+  Expected expected;
+  expected.since = kNow;
+  expected.inbound = inbound;
+  expected_.insert(std::make_pair(peer_id, expected));
+  return true;
+}
+
+bool ShortcutTable::IsExpected(const NodeId& peer_id) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(expected_.find(peer_id));
+  return itr != std::end(expected_) && itr->second.since + kIdleTimeout_ > Clock::now();
+}
+
+bool ShortcutTable::Add(const NodeInfo& peer, NodeId& evicted_connection_id) {
+  evicted_connection_id = NodeId();
+  const auto kNow(Clock::now());
+  std::lock_guard<std::mutex> lock(mutex_);
+  ExpireExpected(kNow);
+  auto expected(expected_.find(peer.node_id));
+  if (expected == std::end(expected_))
+    return false;
+  const bool kInbound(expected->second.inbound);
+  expected_.erase(expected);
+  if (shortcuts_.size() >= kCapacity_) {
+    if (kInbound)
+      return false;
+    auto least_recent(std::min_element(std::begin(shortcuts_), std::end(shortcuts_),
+                                       [](const Shortcut& lhs, const Shortcut& rhs) {
+                                         return lhs.last_used < rhs.last_used;
+                                       }));
+    evicted_connection_id = least_recent->peer.connection_id;
+    shortcuts_.erase(least_recent);
+  }
+  Shortcut shortcut;
+  shortcut.peer = peer;
+  shortcut.last_used = kNow;
+  shortcuts_.push_back(shortcut);
+  return true;
+}
+
+bool ShortcutTable::NextHop(const NodeId& target_id, bool ignore_exact_match, NodeInfo& peer) {
+  return NextHop(target_id, RouteHistory(), ignore_exact_match, peer);
+}
+
+bool ShortcutTable::NextHop(const NodeId& target_id, const RouteHistory& exclude,
+                            bool ignore_exact_match, NodeInfo& peer) {
+  if (!enabled())
+    return false;
+  std::lock_guard<std::mutex> lock(mutex_);
+  Shortcut* closest(nullptr);
+  for (auto& shortcut : shortcuts_) {
+    if ((ignore_exact_match && shortcut.peer.node_id == target_id) ||
+        IsExcluded(exclude, shortcut.peer.node_id))
+      continue;
+    const NodeId& best(closest ? closest->peer.node_id : peer.node_id);
+    if (NodeId::CloserToTarget(shortcut.peer.node_id, best, target_id))
+      closest = &shortcut;
+  }
+  if (!closest)
+    return false;
+  closest->last_used = Clock::now();
+  peer = closest->peer;
+  return true;
+}
+
+bool ShortcutTable::Drop(const NodeId& connection_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(std::find_if(std::begin(shortcuts_), std::end(shortcuts_),
+                        [&](const Shortcut& shortcut) {
+                          return shortcut.peer.connection_id == connection_id;
+                        }));
+  if (itr == std::end(shortcuts_))
+    return false;
+  shortcuts_.erase(itr);
+  return true;
+}
+
+std::vector<NodeId> ShortcutTable::TakeIdle() {
+  std::vector<NodeId> idle;
+  const auto kNow(Clock::now());
+  std::lock_guard<std::mutex> lock(mutex_);
+  ExpireExpected(kNow);
+  auto first_idle(std::partition(std::begin(shortcuts_), std::end(shortcuts_),
+                                 [&](const Shortcut& shortcut) {
+                                   return shortcut.last_used + kIdleTimeout_ > kNow;
+                                 }));
+  for (auto itr(first_idle); itr != std::end(shortcuts_); ++itr)
+    idle.push_back(itr->peer.connection_id);
+  shortcuts_.erase(first_idle, std::end(shortcuts_));
+  return idle;
+}
+
+bool ShortcutTable::Contains(const NodeId& node_id) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return std::any_of(std::begin(shortcuts_), std::end(shortcuts_),
+                     [&](const Shortcut& shortcut) { return shortcut.peer.node_id == node_id; });
+}
+
+size_t ShortcutTable::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return shortcuts_.size();
+}
+
+void ShortcutTable::ExpireExpected(Clock::time_point now) {
+  for (auto itr(std::begin(expected_)); itr != std::end(expected_);) {
+    if (itr->second.since + kIdleTimeout_ <= now)
+      itr = expected_.erase(itr);
+    else
+      ++itr;
+  }
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
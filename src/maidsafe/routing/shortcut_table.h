@@ -0,0 +1,104 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_SHORTCUT_TABLE_H_
+#define MAIDSAFE_ROUTING_SHORTCUT_TABLE_H_
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+
+#include "maidsafe/routing/node_info.h"
+#include "maidsafe/routing/route_history.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// Direct connections a vault keeps to far nodes it sends to often, outside its routing table so
+// that they neither take a bucket's place nor are offered to others as close nodes.  Sends to a
+// destination are counted, and once there have been enough a shortcut is asked for; the
+// connection handshake is then let through although the routing table would refuse the peer.
+// Shortcuts are evicted least recently used first, and closed once idle.  One asked for by a far
+// node is only taken while there is room, so that remote peers can't evict this node's own.  At
+// most capacity connections of either kind are expected at a time.
+class ShortcutTable {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  // Zero |capacity| disables the table.
+  ShortcutTable(uint16_t capacity, uint16_t threshold, Clock::duration idle_timeout);
+  bool enabled() const { return kCapacity_ != 0; }
+  // Counts a send to |destination_id|, returning true each time it has been sent to threshold
+  // more times.
+  bool CountSend(const NodeId& destination_id);
+  // Records that a connection to |peer_id| is to be made as a shortcut, |inbound| if the peer asked
+  // for it.  False if the table is disabled, already holds the peer or already expects capacity
+  // connections of that kind, or if the peer asked and the table is full.  Unless added within the
+  // idle timeout, it's forgotten.
+  bool Expect(const NodeId& peer_id, bool inbound = false);
+  bool IsExpected(const NodeId& peer_id) const;
+  // Adds |peer| if it was expected, and for an inbound one, if there is still room.  If that evicts
+  // another shortcut, |evicted_connection_id| is set to its connection, which is for the caller to
+  // close.
+  bool Add(const NodeInfo& peer, NodeId& evicted_connection_id);
+  // Where a shortcut is closer to |target_id| than |peer|, the routing table's choice of next hop,
+  // replaces peer with the closest such shortcut.  Unless |ignore_exact_match| is false, a shortcut
+  // to target_id itself is not chosen, as for RoutingTable::GetNodeForSendingMessage.
+  bool NextHop(const NodeId& target_id, bool ignore_exact_match, NodeInfo& peer);
+  // As above, skipping any shortcut in |exclude|, e.g. one the message has already passed through.
+  bool NextHop(const NodeId& target_id, const RouteHistory& exclude, bool ignore_exact_match,
+               NodeInfo& peer);
+  // Returns true if |connection_id| was a shortcut's.
+  bool Drop(const NodeId& connection_id);
+  // Removes the shortcuts unused for the idle timeout, returning their connections to be closed.
+  std::vector<NodeId> TakeIdle();
+  bool Contains(const NodeId& node_id) const;
+  size_t size() const;
+
+ private:
+  ShortcutTable(const ShortcutTable&);
+  ShortcutTable& operator=(const ShortcutTable&);
+
+  struct Shortcut {
+    NodeInfo peer;
+    Clock::time_point last_used;
+  };
+  struct Expected {
+    Clock::time_point since;
+    bool inbound;
+  };
+  void ExpireExpected(Clock::time_point now);
+
+  const uint16_t kCapacity_, kThreshold_;
+  const Clock::duration kIdleTimeout_;
+  mutable std::mutex mutex_;
+  std::map<NodeId, uint16_t> send_counts_;
+  std::map<NodeId, Expected> expected_;
+  std::vector<Shortcut> shortcuts_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_SHORTCUT_TABLE_H_
@@ -0,0 +1,175 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/signature_verifier.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/log.h"
+
+#include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/thread_placement.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+std::string SignedData(const protobuf::Message& message) {
+  protobuf::Message signed_fields;
+  signed_fields.set_source_id(message.source_id());
+  signed_fields.set_type(message.type());
+  signed_fields.set_id(message.id());
+  signed_fields.set_request(message.request());
+  signed_fields.mutable_data()->CopyFrom(message.data());
+  return signed_fields.SerializePartialAsString();
+}
+
+SignatureVerifier::SignatureVerifier(uint16_t thread_count, uint16_t batch_size,
+                                     size_t cache_size, const std::vector<uint32_t>& cpus)
+    : kThreadCount_(thread_count),
+      kBatchSize_(std::max(batch_size, static_cast<uint16_t>(1))),
+      kCacheSize_(cache_size),
+      mutex_(),
+      jobs_(),
+      draining_(0),
+      stopped_(false),
+      verdicts_(),
+      verdict_order_(),
+      asio_service_(kThreadCount_ == 0 ? nullptr : new AsioService(kThreadCount_)) {
+  if (asio_service_)
+    PinAsioThreads(*asio_service_, kThreadCount_, cpus);
+}
+
+SignatureVerifier::~SignatureVerifier() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+    jobs_.clear();
+  }
+  if (asio_service_)
+    asio_service_->Stop();
+}
+
+void SignatureVerifier::Verify(std::string data, std::string signature,
+                               const asymm::PublicKey& public_key,
+                               VerdictFunctor verdict_functor,
+                               std::shared_ptr<const std::string> encoded_public_key) {
+  std::string key;
+  try {
+    key = crypto::Hash<crypto::SHA512>(encoded_public_key && !encoded_public_key->empty()
+                                           ? *encoded_public_key
+                                           : asymm::EncodeKey(public_key).string()).string() +
+          crypto::Hash<crypto::SHA512>(data + signature).string();
+  } catch (const std::exception& e) {
+    LOG(kWarning) << "Can't verify signature: " << e.what();
+    return verdict_functor(false);
+  }
+  bool valid(false);
+  if (CachedVerdict(key, valid))
+    return verdict_functor(valid);
+
+  Enqueue([=]() {
+    bool valid(false);
+    try {
+      valid = asymm::CheckSignature(asymm::PlainText(data), asymm::Signature(signature),
+                                    public_key);
+    } catch (const std::exception& e) {
+      LOG(kWarning) << "Failed to check signature: " << e.what();
+    }
+    CacheVerdict(key, valid);
+    verdict_functor(valid);
+  });
+}
+
+void SignatureVerifier::Sign(std::string data, const asymm::PrivateKey& private_key,
+                             SignedFunctor signed_functor) {
+  Enqueue([=]() {
+    std::string signature;
+    try {
+      signature = asymm::Sign(asymm::PlainText(data), private_key).string();
+    } catch (const std::exception& e) {
+      LOG(kError) << "Failed to sign: " << e.what();
+    }
+    signed_functor(signature);
+  });
+}
+
+void SignatureVerifier::Enqueue(std::function<void()> job) {
+  if (!asio_service_)
+    return job();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopped_)
+      return;
+    jobs_.push_back(std::move(job));
+    // Threads already draining will pick this job up.
+    if (draining_ == kThreadCount_ || jobs_.size() <= draining_)
+      return;
+    ++draining_;
+  }
+  asio_service_->service().post([this]() { Drain(); });
+}
+
+void SignatureVerifier::Drain() {
+  std::vector<std::function<void()>> batch;
+  for (;;) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stopped_ || jobs_.empty()) {
+        --draining_;
+        return;
+      }
+      while (!jobs_.empty() && batch.size() < kBatchSize_) {
+        batch.push_back(std::move(jobs_.front()));
+        jobs_.pop_front();
+      }
+    }
+    for (auto& job : batch)
+      job();
+    batch.clear();
+  }
+}
+
+bool SignatureVerifier::CachedVerdict(const std::string& key, bool& valid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(verdicts_.find(key));
+  if (itr == verdicts_.end())
+    return false;
+  valid = itr->second;
+  return true;
+}
+
+void SignatureVerifier::CacheVerdict(const std::string& key, bool valid) {
+  if (kCacheSize_ == 0)
+    return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!verdicts_.insert(std::make_pair(key, valid)).second)
+    return;
+  verdict_order_.push_back(key);
+  if (verdict_order_.size() > kCacheSize_) {
+    verdicts_.erase(verdict_order_.front());
+    verdict_order_.pop_front();
+  }
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
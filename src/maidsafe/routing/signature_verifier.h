@@ -0,0 +1,92 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_SIGNATURE_VERIFIER_H_
+#define MAIDSAFE_ROUTING_SIGNATURE_VERIFIER_H_
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/rsa.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace protobuf {
+class Message;
+}
+
+// The bytes a routing message's signature covers: those of its fields which aren't changed on the
+// way, serialised.
+std::string SignedData(const protobuf::Message& message);
+
+// Checks and makes RSA signatures on threads of its own, so that the asio threads aren't held up
+// by them.  Queued jobs are taken up to batch_size at a time, and each verdict is cached against a
+// hash of the public key, data and signature, so repeated checks of the same message are free.
+// Functors are called on one of this object's threads, or synchronously for a cached verdict.  With
+// no threads, jobs are run at once on the calling thread.
+class SignatureVerifier {
+ public:
+  typedef std::function<void(bool /*valid*/)> VerdictFunctor;
+  typedef std::function<void(std::string /*signature*/)> SignedFunctor;
+
+  // The threads are pinned to the CPUs given, if any (see PinAsioThreads).
+  SignatureVerifier(uint16_t thread_count, uint16_t batch_size, size_t cache_size,
+                    const std::vector<uint32_t>& cpus = std::vector<uint32_t>());
+  ~SignatureVerifier();
+  // |encoded_public_key|, if given, is public_key as asymm::EncodeKey gives it (see
+  // NodeInfo::encoded_public_key), saving encoding it again here.
+  void Verify(std::string data, std::string signature, const asymm::PublicKey& public_key,
+              VerdictFunctor verdict_functor,
+              std::shared_ptr<const std::string> encoded_public_key = nullptr);
+  // |signed_functor| is given an empty signature if signing fails.
+  void Sign(std::string data, const asymm::PrivateKey& private_key, SignedFunctor signed_functor);
+
+ private:
+  SignatureVerifier(const SignatureVerifier&);
+  SignatureVerifier& operator=(const SignatureVerifier&);
+
+  void Enqueue(std::function<void()> job);
+  void Drain();
+  bool CachedVerdict(const std::string& key, bool& valid);
+  void CacheVerdict(const std::string& key, bool valid);
+
+  const uint16_t kThreadCount_, kBatchSize_;
+  const size_t kCacheSize_;
+  std::mutex mutex_;
+  std::deque<std::function<void()>> jobs_;
+  uint16_t draining_;
+  bool stopped_;
+  std::map<std::string, bool> verdicts_;
+  std::deque<std::string> verdict_order_;
+  std::unique_ptr<AsioService> asio_service_;  // null if kThreadCount_ is 0
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_SIGNATURE_VERIFIER_H_
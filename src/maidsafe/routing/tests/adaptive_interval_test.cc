@@ -0,0 +1,54 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/adaptive_interval.h"
+#include "maidsafe/routing/parameters.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(AdaptiveIntervalTest, BEH_StaysWithinLimits) {
+  const std::chrono::steady_clock::duration kBase(std::chrono::seconds(8));
+  AdaptiveInterval interval(kBase);
+  EXPECT_EQ(kBase, interval.current());
+  interval.Backoff();
+  EXPECT_EQ(kBase * 2, interval.current());
+  for (int i(0); i != 20; ++i)
+    interval.Backoff();
+  EXPECT_EQ(kBase * Parameters::interval_backoff_limit, interval.current());
+  interval.Tighten();
+  EXPECT_EQ(kBase * Parameters::interval_backoff_limit / 2, interval.current());
+  for (int i(0); i != 20; ++i)
+    interval.Tighten();
+  EXPECT_EQ(kBase / Parameters::interval_tighten_limit, interval.current());
+  interval.Reset();
+  EXPECT_EQ(kBase, interval.current());
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,317 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/config.h"
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/rsa.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/client_routing_table.h"
+#include "maidsafe/routing/group_change_handler.h"
+#include "maidsafe/routing/message.h"
+#include "maidsafe/routing/message_handler.h"
+#include "maidsafe/routing/network_statistics.h"
+#include "maidsafe/routing/network_utils.h"
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/remove_furthest_node.h"
+#include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/routing_table.h"
+#include "maidsafe/routing/timer.h"
+#include "maidsafe/routing/utils.h"
+#include "maidsafe/routing/tests/test_utils.h"
+
+// Allocations are counted, while a counter is live, on the thread which made it.  This replaces the
+// global operator new for all of TESTrouting, so it must stay cheap when not counting.
+namespace {
+
+std::atomic<bool> g_counting(false);
+std::atomic<std::thread::id> g_counting_thread;
+std::atomic<size_t> g_allocations(0);
+
+}  // unnamed namespace
+
+void* operator new(std::size_t size) {
+  if (g_counting.load(std::memory_order_relaxed) &&
+      std::this_thread::get_id() == g_counting_thread.load(std::memory_order_relaxed)) {
+    ++g_allocations;
+  }
+  void* allocated(std::malloc(size == 0 ? 1 : size));
+  if (!allocated)
+    throw std::bad_alloc();
+  return allocated;
+}
+
+void operator delete(void* allocated) MAIDSAFE_NOEXCEPT { std::free(allocated); }
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+// Extra data entries added to each message for the second of a test's two runs.  Copying a message
+// allocates at least once per data entry, so a path which doesn't copy what it's given handles the
+// heavier messages with fewer than this many more allocations each.
+const size_t kExtraDataEntries(16);
+
+class AllocationCounter {
+ public:
+  AllocationCounter() : kStart_(g_allocations.load()) {
+    g_counting_thread = std::this_thread::get_id();
+    g_counting = true;
+  }
+  ~AllocationCounter() { g_counting = false; }
+  size_t count() const { return g_allocations.load() - kStart_; }
+
+ private:
+  AllocationCounter(const AllocationCounter&);
+  AllocationCounter& operator=(const AllocationCounter&);
+
+  const size_t kStart_;
+};
+
+// Drops what it's given to send, so only the handler's own allocations are counted.  (Mocks
+// allocate as they match calls.)
+class DroppingNetworkUtils : public NetworkUtils {
+ public:
+  DroppingNetworkUtils(RoutingTable& routing_table, ClientRoutingTable& client_routing_table,
+                       AsioService& asio_service)
+      : NetworkUtils(routing_table, client_routing_table, asio_service), sends(0) {}
+  virtual void SendToDirect(const protobuf::Message& /*message*/, const NodeId& /*peer_node_id*/,
+                            const NodeId& /*peer_connection_id*/) {
+    ++sends;
+  }
+  virtual void SendEncodedToDirect(const protobuf::Message& /*header*/,
+                                   std::shared_ptr<const std::string> /*encoded_body*/,
+                                   const NodeId& /*peer_node_id*/,
+                                   const NodeId& /*peer_connection_id*/) {
+    ++sends;
+  }
+  virtual void SendToClosestNode(const protobuf::Message& /*message*/) { ++sends; }
+  virtual void SendEncodedToClosestNode(const protobuf::Message& /*header*/,
+                                        std::shared_ptr<const std::string> /*encoded_body*/) {
+    ++sends;
+  }
+
+  std::atomic<size_t> sends;
+};
+
+NodeId FlipLastBit(const NodeId& node_id) {
+  std::string id(node_id.string());
+  id.back() ^= 1;
+  return NodeId(id);
+}
+
+}  // unnamed namespace
+
+class AllocationCountTest : public testing::Test {
+ protected:
+  static const int kWarmUp = 8;
+  static const int kMessages = 64;
+
+  AllocationCountTest()
+      : kNodeId_(NodeId::kRandomId),
+        network_statistics_(kNodeId_),
+        routing_table_(false, kNodeId_, asymm::GenerateKeyPair(), network_statistics_),
+        client_routing_table_(kNodeId_),
+        asio_service_(2),
+        network_(routing_table_, client_routing_table_, asio_service_),
+        timer_(asio_service_),
+        remove_furthest_node_(routing_table_, network_),
+        group_change_handler_(routing_table_, client_routing_table_, network_),
+        message_handler_(),
+        peers_(),
+        next_id_(0) {
+    for (int i(0); i != 2 * Parameters::closest_nodes_size; ++i) {
+      NodeInfo peer(MakeNode());
+      if (routing_table_.AddNode(peer))
+        peers_.push_back(peer.node_id);
+    }
+    std::sort(std::begin(peers_), std::end(peers_), [this](const NodeId& lhs, const NodeId& rhs) {
+      return NodeId::CloserToTarget(lhs, rhs, kNodeId_);
+    });
+    message_handler_.reset(new MessageHandler(routing_table_, client_routing_table_, network_,
+                                              timer_, remove_furthest_node_,
+                                              group_change_handler_, network_statistics_));
+    MessageAndCachingFunctors functors;
+    functors.message_received = [](const std::string&, bool, ReplyFunctor) {};  // NOLINT
+    message_handler_->set_message_and_caching_functor(functors);
+  }
+
+  // A destination one of this node's furthest peers is closer to, so messages to it are passed on.
+  NodeId FarDestination(size_t from_furthest = 0) const {
+    return FlipLastBit(peers_[peers_.size() - 1 - from_furthest]);
+  }
+
+  protobuf::Message NodeLevelRequest(const NodeId& destination_id, bool direct) {
+    protobuf::Message message;
+    message.set_source_id(NodeId(NodeId::kRandomId).string());
+    message.set_destination_id(destination_id.string());
+    message.set_routing_message(false);
+    message.set_direct(direct);
+    message.set_request(true);
+    message.set_client_node(false);
+    message.set_hops_to_live(Parameters::hops_to_live);
+    message.set_type(static_cast<int32_t>(MessageType::kNodeLevel));
+    message.set_id(++next_id_);
+    message.add_data(RandomString(1024));
+    return message;
+  }
+
+  // Mean allocations made handling each of kMessages messages from make_message, after kWarmUp
+  // untimed ones fill the handler's caches and containers.  Headers are given with their encoded
+  // body where encoded is true, as OnMessageReceived does.
+  template <typename MakeMessage>
+  size_t AllocationsPerMessage(MakeMessage make_message, bool encoded, size_t expected_sends) {
+    size_t allocations(0);
+    for (int i(0); i != kWarmUp + kMessages; ++i) {
+      protobuf::Message header(make_message());
+      std::shared_ptr<const std::string> encoded_body;
+      if (encoded) {
+        const std::string kSerialised(header.SerializeAsString());
+        auto body(std::make_shared<std::string>());
+        header.Clear();
+        EXPECT_TRUE(ParseMessageHeader(kSerialised, header, *body));
+        encoded_body = body;
+      }
+      const size_t kSends(network_.sends);
+      {
+        AllocationCounter counter;
+        message_handler_->HandleMessage(header, std::move(encoded_body));
+        if (i >= kWarmUp)
+          allocations += counter.count();
+      }
+      EXPECT_EQ(expected_sends, network_.sends - kSends);
+    }
+    return (allocations + kMessages - 1) / kMessages;
+  }
+
+  // Expects make_message's messages to be handled without copying them, by comparing allocations
+  // per message with those for the same messages carrying kExtraDataEntries more data entries.
+  // Both figures are recorded as properties of the test's result.
+  template <typename MakeMessage>
+  void ExpectNoCopies(MakeMessage make_message, bool encoded, size_t expected_sends) {
+    const size_t kPerMessage(AllocationsPerMessage(make_message, encoded, expected_sends));
+    const size_t kPerHeavierMessage(AllocationsPerMessage([&]()->protobuf::Message {
+      protobuf::Message message(make_message());
+      for (size_t i(0); i != kExtraDataEntries; ++i)
+        message.add_data(RandomString(1024));
+      return message;
+    }, encoded, expected_sends));
+    RecordProperty("allocations_per_message", static_cast<int>(kPerMessage));
+    RecordProperty("allocations_per_heavier_message", static_cast<int>(kPerHeavierMessage));
+    EXPECT_LT(kPerHeavierMessage, kPerMessage + kExtraDataEntries);
+  }
+
+  const NodeId kNodeId_;
+  NetworkStatistics network_statistics_;
+  RoutingTable routing_table_;
+  ClientRoutingTable client_routing_table_;
+  AsioService asio_service_;
+  DroppingNetworkUtils network_;
+  Timer<std::string> timer_;
+  RemoveFurthestNode remove_furthest_node_;
+  GroupChangeHandler group_change_handler_;
+  std::unique_ptr<MessageHandler> message_handler_;
+  std::vector<NodeId> peers_;  // closest to this node first
+  int32_t next_id_;
+};
+
+TEST_F(AllocationCountTest, BEH_DirectForward) {
+  const NodeId kDestination(FarDestination());
+  ExpectNoCopies([&] { return NodeLevelRequest(kDestination, true); }, true, 1);
+}
+
+TEST_F(AllocationCountTest, BEH_RelayRequest) {
+  const NodeId kDestination(FarDestination());
+  ExpectNoCopies([&]()->protobuf::Message {
+                   protobuf::Message message(NodeLevelRequest(kDestination, true));
+                   message.clear_source_id();
+                   message.set_relay_id(NodeId(NodeId::kRandomId).string());
+                   message.set_relay_connection_id(NodeId(NodeId::kRandomId).string());
+                   return message;
+                 }, false, 1);
+}
+
+TEST_F(AllocationCountTest, BEH_GroupFanOut) {
+  // Not this node's own ID, but one it is closest to, so it leads the group.
+  const NodeId kGroupId(FlipLastBit(kNodeId_));
+  const uint16_t kReplication(Parameters::group_size);
+  ExpectNoCopies([&]()->protobuf::Message {
+                   protobuf::Message message(NodeLevelRequest(kGroupId, false));
+                   message.set_replication(kReplication);
+                   return message;
+                 }, true, kReplication - 1U);
+}
+
+TEST_F(AllocationCountTest, BEH_CacheHit) {
+  ScopedParameter<bool> caching(Parameters::caching, true);
+  // A Get passed on, then its response coming back through this node, fill the cache.
+  const NodeId kDestination(FarDestination()), kRequester(FarDestination(1));
+  protobuf::Message get(NodeLevelRequest(kDestination, true));
+  get.set_source_id(kRequester.string());
+  get.set_cacheable(static_cast<int32_t>(Cacheable::kGet));
+  const std::string kRequestData(get.data(0));
+  // The response's random data isn't self-certifying, so it's let through by the upper layer.
+  MessageAndCachingFunctors functors;
+  functors.message_received = [](const std::string&, bool, ReplyFunctor) {};  // NOLINT
+  functors.validate_cache_data = [kRequestData](const std::string& request, const std::string&) {
+    return request == kRequestData;
+  };
+  message_handler_->set_message_and_caching_functor(functors);
+  protobuf::Message response(get);
+  message_handler_->HandleMessage(get);
+  response.set_source_id(kDestination.string());
+  response.set_destination_id(kRequester.string());
+  response.set_request(false);
+  response.set_data(0, RandomString(1024));
+  message_handler_->HandleMessage(response);
+  for (int i(0); i != 100 && message_handler_->cache_statistics().bytes_stored == 0; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  ASSERT_NE(0U, message_handler_->cache_statistics().bytes_stored);
+
+  const uint64_t kHits(message_handler_->cache_statistics().hits);
+  // The cache key is made from the first data entry only, so the heavier requests hit too.
+  ExpectNoCopies([&]()->protobuf::Message {
+                   protobuf::Message message(NodeLevelRequest(kDestination, true));
+                   message.set_cacheable(static_cast<int32_t>(Cacheable::kGet));
+                   message.set_data(0, kRequestData);
+                   return message;
+                 }, false, 1);
+  EXPECT_EQ(kHits + 2 * (kWarmUp + kMessages), message_handler_->cache_statistics().hits);
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,106 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/bootstrap_cache.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+typedef boost::asio::ip::udp::endpoint Endpoint;
+
+Endpoint MakeEndpoint(uint16_t port) {
+  return Endpoint(boost::asio::ip::address::from_string("192.168.0.1"), port);
+}
+
+}  // unnamed namespace
+
+TEST(BootstrapCacheTest, BEH_RanksByJoinTime) {
+  AsioService asio_service(1);
+  auto cache(std::make_shared<BootstrapCache>(asio_service));
+  std::vector<Endpoint> endpoints;
+  for (uint16_t port(1000); port != 1006; ++port)
+    endpoints.push_back(MakeEndpoint(port));
+  endpoints.push_back(endpoints.front());
+
+  cache->RecordFailure(endpoints[0]);
+  cache->RecordSuccess(endpoints[2], std::chrono::milliseconds(500));
+  cache->RecordSuccess(endpoints[4], std::chrono::milliseconds(100));
+  cache->RecordSuccess(endpoints[5], std::chrono::milliseconds(200));
+  cache->RecordFailure(endpoints[5]);
+  cache->RecordFailure(endpoints[5]);
+
+  std::vector<Endpoint> expected;
+  expected.push_back(endpoints[4]);
+  expected.push_back(endpoints[2]);
+  expected.push_back(endpoints[5]);
+  expected.push_back(endpoints[1]);
+  expected.push_back(endpoints[3]);
+  expected.push_back(endpoints[0]);
+  EXPECT_EQ(expected, cache->Rank(endpoints));
+  EXPECT_EQ(1U, cache->Rank(std::vector<Endpoint>(1, endpoints[3])).size());
+  // The cache holds only the endpoints it has heard about.
+  EXPECT_EQ(4U, cache->Rank(std::vector<Endpoint>()).size());
+  asio_service.Stop();
+}
+
+TEST(BootstrapCacheTest, BEH_PersistsAcrossLoads) {
+  maidsafe::test::TestPath test_path(maidsafe::test::CreateTestPath("MaidSafe_TestBootstrapCache"));
+  boost::filesystem::path path(*test_path / "bootstrap_cache");
+  AsioService asio_service(1);
+  {
+    auto cache(std::make_shared<BootstrapCache>(asio_service));
+    EXPECT_TRUE(cache->Load(path));
+    cache->Add(MakeEndpoint(1000));
+    cache->RecordSuccess(MakeEndpoint(1001), std::chrono::milliseconds(10));
+    cache->RecordFailure(MakeEndpoint(1002));
+    cache->Remove(MakeEndpoint(1003));
+    // Writes are batched, so nothing reaches the disk until the flush.
+    EXPECT_FALSE(boost::filesystem::exists(path));
+    cache->Flush();
+    EXPECT_TRUE(boost::filesystem::exists(path));
+    cache->Remove(MakeEndpoint(1000));
+  }  // flushes the removal
+
+  auto cache(std::make_shared<BootstrapCache>(asio_service));
+  EXPECT_TRUE(cache->Load(path));
+  std::vector<Endpoint> expected;
+  expected.push_back(MakeEndpoint(1001));
+  expected.push_back(MakeEndpoint(1002));
+  EXPECT_EQ(expected, cache->Rank(std::vector<Endpoint>()));
+  EXPECT_FALSE(boost::filesystem::exists(path.string() + ".new"));
+  asio_service.Stop();
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
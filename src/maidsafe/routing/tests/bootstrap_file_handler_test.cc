@@ -0,0 +1,64 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <vector>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/bootstrap_file_handler.h"
+#include "maidsafe/routing/tests/test_utils.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(BootstrapFileHandlerTest, BEH_RoutingSnapshot) {
+  maidsafe::test::TestPath test_path(maidsafe::test::CreateTestPath("MaidSafe_TestSnapshot"));
+  boost::filesystem::path snapshot_path(*test_path / "routing_snapshot");
+  std::vector<NodeId> peers(1, NodeId(NodeId::kRandomId));
+  EXPECT_TRUE(ReadRoutingSnapshot(snapshot_path, peers));
+  EXPECT_TRUE(peers.empty());
+
+  std::vector<NodeInfo> nodes, matrix_nodes;
+  for (int i(0); i != 4; ++i)
+    nodes.push_back(MakeNode());
+  matrix_nodes.push_back(nodes.front());  // duplicates are only returned once
+  matrix_nodes.push_back(MakeNode());
+  EXPECT_TRUE(WriteRoutingSnapshot(nodes, matrix_nodes, snapshot_path));
+  EXPECT_TRUE(ReadRoutingSnapshot(snapshot_path, peers));
+  ASSERT_EQ(5U, peers.size());
+  for (size_t i(0); i != nodes.size(); ++i)
+    EXPECT_EQ(nodes[i].node_id, peers[i]);
+  EXPECT_EQ(matrix_nodes.back().node_id, peers.back());
+
+  ASSERT_TRUE(WriteFile(snapshot_path, "not a snapshot"));
+  EXPECT_FALSE(ReadRoutingSnapshot(snapshot_path, peers));
+  EXPECT_TRUE(peers.empty());
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,78 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <memory>
+#include <string>
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/cache_store.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+std::shared_ptr<const std::string> Value(size_t size) {
+  return std::make_shared<const std::string>(size, 'v');
+}
+
+}  // unnamed namespace
+
+TEST(CacheStoreTest, BEH_BoundedByBytesAndEntries) {
+  CacheStore store(100, 3);
+  store.Put("a", Value(39));
+  store.Put("b", Value(39));
+  EXPECT_EQ(2U, store.size());
+  EXPECT_EQ(80U, store.bytes());
+  store.Put("c", Value(39));  // exceeds the byte limit, so the oldest goes
+  EXPECT_EQ(nullptr, store.Get("a"));
+  EXPECT_NE(nullptr, store.Get("b"));
+  EXPECT_NE(nullptr, store.Get("c"));
+  store.Put("big", Value(100));  // can never fit
+  EXPECT_EQ(nullptr, store.Get("big"));
+  EXPECT_EQ(2U, store.size());
+
+  CacheStore small_store(1000, 3);
+  for (const auto& key : {"1", "2", "3", "4"})
+    small_store.Put(key, Value(1));
+  EXPECT_EQ(3U, small_store.size());
+  EXPECT_EQ(nullptr, small_store.Get("1"));
+}
+
+TEST(CacheStoreTest, BEH_PopularEntriesSurviveScans) {
+  CacheStore store(1000, 100);
+  store.Put("popular", Value(99));
+  ASSERT_NE(nullptr, store.Get("popular"));  // promoted to the protected segment
+  for (int i(0); i != 100; ++i)
+    store.Put("one-off " + std::to_string(i), Value(90));
+  auto popular(store.Get("popular"));
+  ASSERT_NE(nullptr, popular);
+  EXPECT_EQ(99U, popular->size());
+  EXPECT_EQ(nullptr, store.Get("one-off 0"));
+  EXPECT_LE(store.bytes(), 1000U);
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
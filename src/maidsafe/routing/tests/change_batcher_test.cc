@@ -0,0 +1,79 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <memory>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/change_batcher.h"
+#include "maidsafe/routing/matrix_change.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(ChangeBatcherTest, BEH_CoalescesUntilTaken) {
+  ChangeBatcher batcher;
+  EXPECT_FALSE(batcher.Take().has_network_status);
+  EXPECT_TRUE(batcher.AddNetworkStatus(10));
+  EXPECT_FALSE(batcher.AddNetworkStatus(20));
+  EXPECT_FALSE(batcher.AddRemoveFurthestNode());
+  EXPECT_FALSE(batcher.AddRemoveFurthestNode());
+  ChangeBatcher::Batch batch(batcher.Take());
+  EXPECT_TRUE(batch.has_network_status);
+  EXPECT_EQ(20, batch.network_status);
+  EXPECT_TRUE(batch.remove_furthest_node);
+  EXPECT_EQ(nullptr, batch.matrix_change);
+
+  EXPECT_TRUE(batcher.AddRemoveFurthestNode());
+  batch = batcher.Take();
+  EXPECT_FALSE(batch.has_network_status);
+  EXPECT_TRUE(batch.remove_furthest_node);
+}
+
+TEST(ChangeBatcherTest, BEH_MergesMatrixChanges) {
+  NodeId this_node_id(NodeId::kRandomId), first(NodeId::kRandomId), second(NodeId::kRandomId);
+  std::vector<NodeId> none, with_first(1, first), with_both{ first, second };
+  ChangeBatcher batcher;
+  EXPECT_FALSE(batcher.AddMatrixChange(nullptr));
+  EXPECT_TRUE(batcher.AddMatrixChange(
+      std::make_shared<MatrixChange>(MatrixChange(this_node_id, none, with_first))));
+  EXPECT_FALSE(batcher.AddMatrixChange(
+      std::make_shared<MatrixChange>(MatrixChange(this_node_id, with_first, with_both))));
+  std::shared_ptr<MatrixChange> matrix_change(batcher.Take().matrix_change);
+  ASSERT_NE(nullptr, matrix_change);
+  EXPECT_TRUE(matrix_change->lost_nodes().empty());
+  EXPECT_EQ(2U, matrix_change->new_nodes().size());
+
+  // Changes which cancel out aren't reported.
+  batcher.AddMatrixChange(
+      std::make_shared<MatrixChange>(MatrixChange(this_node_id, with_both, with_first)));
+  batcher.AddMatrixChange(
+      std::make_shared<MatrixChange>(MatrixChange(this_node_id, with_first, with_both)));
+  EXPECT_EQ(nullptr, batcher.Take().matrix_change);
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
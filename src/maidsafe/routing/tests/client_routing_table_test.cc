@@ -289,6 +289,30 @@ TEST_F(ClientRoutingTableTest, FUNC_GetNodesInfo) {
   }
 }
 
+TEST_F(ClientRoutingTableTest, BEH_DropOneOfSeveralConnections) {
+  ClientRoutingTable client_routing_table(node_id_);
+
+  PopulateNodes(2);
+  SortFromTarget(client_routing_table.kNodeId(), nodes_);
+
+  NodeInfo node(MakeNode());
+  node.node_id = nodes_.at(0).node_id;
+  EXPECT_TRUE(client_routing_table.AddNode(nodes_.at(0), nodes_.at(1).node_id));
+  EXPECT_TRUE(client_routing_table.AddNode(node, nodes_.at(1).node_id));
+  EXPECT_EQ(2, client_routing_table.GetNodesInfo(node.node_id).size());
+
+  EXPECT_EQ(node.connection_id,
+            client_routing_table.DropConnection(node.connection_id).connection_id);
+  EXPECT_TRUE(client_routing_table.Contains(node.node_id));
+  std::vector<NodeInfo> nodes_info(client_routing_table.GetNodesInfo(node.node_id));
+  ASSERT_EQ(1, nodes_info.size());
+  EXPECT_EQ(nodes_.at(0).connection_id, nodes_info.at(0).connection_id);
+
+  EXPECT_EQ(1, client_routing_table.DropNodes(node.node_id).size());
+  EXPECT_FALSE(client_routing_table.Contains(node.node_id));
+  EXPECT_EQ(0, client_routing_table.size());
+}
+
 TEST_F(ClientRoutingTableTest, FUNC_IsConnected) {
   ClientRoutingTable client_routing_table(node_id_);
 
@@ -0,0 +1,159 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/connection_scheduler.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+class ConnectionSchedulerTest : public testing::Test {
+ protected:
+  ConnectionSchedulerTest()
+      : asio_service_(1), node_id_(NodeId::kRandomId), mutex_(), started_(), refuse_(false) {}
+
+  ~ConnectionSchedulerTest() { asio_service_.Stop(); }
+
+  std::shared_ptr<ConnectionScheduler> MakeScheduler(size_t max_in_flight, size_t max_queued,
+                                                     std::chrono::steady_clock::duration timeout =
+                                                         std::chrono::seconds(10)) {
+    auto scheduler(std::make_shared<ConnectionScheduler>(asio_service_, node_id_, max_in_flight,
+                                                         max_queued, timeout));
+    scheduler->set_start_connect_functor([this](const NodeId& peer) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      started_.push_back(peer);
+      return !refuse_;
+    });
+    return scheduler;
+  }
+
+  std::vector<NodeId> started() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return started_;
+  }
+
+  AsioService asio_service_;
+  NodeId node_id_;
+  std::mutex mutex_;
+  std::vector<NodeId> started_;
+  std::atomic<bool> refuse_;
+};
+
+TEST_F(ConnectionSchedulerTest, BEH_BoundsHandshakesInFlight) {
+  auto scheduler(MakeScheduler(2, 10));
+  std::vector<NodeId> peers;
+  for (int i(0); i != 5; ++i) {
+    peers.push_back(NodeId(NodeId::kRandomId));
+    EXPECT_TRUE(scheduler->Add(peers.back(), 1));
+  }
+  EXPECT_EQ(2U, started().size());
+  EXPECT_EQ(2U, scheduler->in_flight());
+  EXPECT_EQ(3U, scheduler->queued());
+  // Repeats of queued or running peers aren't queued again.
+  EXPECT_TRUE(scheduler->Add(peers[0], 1));
+  EXPECT_TRUE(scheduler->Add(peers[4], 1));
+  EXPECT_EQ(3U, scheduler->queued());
+
+  scheduler->Completed(started()[0]);
+  EXPECT_EQ(3U, started().size());
+  EXPECT_EQ(2U, scheduler->in_flight());
+  EXPECT_EQ(2U, scheduler->queued());
+  // Completing a peer not in flight frees nothing.
+  scheduler->Completed(NodeId(NodeId::kRandomId));
+  EXPECT_EQ(3U, started().size());
+}
+
+TEST_F(ConnectionSchedulerTest, BEH_StartsMostValuableFirst) {
+  auto scheduler(MakeScheduler(1, 10));
+  NodeId first(NodeId::kRandomId), low(NodeId::kRandomId), high(NodeId::kRandomId),
+      raised(NodeId::kRandomId);
+  scheduler->Add(first, 0);
+  scheduler->Add(low, 1);
+  scheduler->Add(high, 5);
+  scheduler->Add(raised, 2);
+  scheduler->Add(raised, 9);  // keeps the higher of its values
+  for (int i(0); i != 3; ++i)
+    scheduler->Completed(started().back());
+  std::vector<NodeId> expected = { first, raised, high, low };
+  EXPECT_EQ(expected, started());
+
+  // Of equally valued peers, the one closer to this node goes first.
+  NodeId blocker(NodeId::kRandomId), closer(NodeId::kRandomId), further(NodeId::kRandomId);
+  if (NodeId::CloserToTarget(further, closer, node_id_))
+    std::swap(closer, further);
+  scheduler->Completed(low);
+  scheduler->Add(blocker, 0);
+  scheduler->Add(further, 3);
+  scheduler->Add(closer, 3);
+  scheduler->Completed(blocker);
+  EXPECT_EQ(closer, started().back());
+}
+
+TEST_F(ConnectionSchedulerTest, BEH_DropsLeastValuableWhenFull) {
+  auto scheduler(MakeScheduler(1, 2));
+  NodeId running(NodeId::kRandomId), low(NodeId::kRandomId), mid(NodeId::kRandomId),
+      high(NodeId::kRandomId), lowest(NodeId::kRandomId);
+  scheduler->Add(running, 0);
+  scheduler->Add(low, 1);
+  scheduler->Add(mid, 2);
+  EXPECT_TRUE(scheduler->Add(high, 3));
+  EXPECT_FALSE(scheduler->Add(lowest, 0));
+  EXPECT_EQ(2U, scheduler->queued());
+  scheduler->Completed(running);
+  scheduler->Completed(high);
+  scheduler->Completed(mid);
+  std::vector<NodeId> expected = { running, high, mid };
+  EXPECT_EQ(expected, started());
+}
+
+TEST_F(ConnectionSchedulerTest, BEH_FreesSlotOnRefusalOrTimeout) {
+  refuse_ = true;
+  auto scheduler(MakeScheduler(1, 10, std::chrono::milliseconds(50)));
+  scheduler->Add(NodeId(NodeId::kRandomId), 0);
+  scheduler->Add(NodeId(NodeId::kRandomId), 0);
+  EXPECT_EQ(2U, started().size());
+  EXPECT_EQ(0U, scheduler->in_flight());
+
+  refuse_ = false;
+  scheduler->Add(NodeId(NodeId::kRandomId), 0);
+  scheduler->Add(NodeId(NodeId::kRandomId), 0);
+  EXPECT_EQ(3U, started().size());
+  for (int i(0); i != 100 && started().size() != 4; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(4U, started().size());
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,91 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <thread>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/duplicate_filter.h"
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+protobuf::Message MakeMessage(int32_t id) {
+  protobuf::Message message;
+  message.set_source_id(NodeId(NodeId::kRandomId).string());
+  message.set_destination_id(NodeId(NodeId::kRandomId).string());
+  message.set_id(id);
+  message.set_type(101);
+  message.set_request(true);
+  message.set_direct(true);
+  return message;
+}
+
+}  // unnamed namespace
+
+TEST(DuplicateFilterTest, BEH_DropsRepeatsWithinWindow) {
+  DuplicateFilter filter(std::chrono::milliseconds(200), 16);
+  protobuf::Message message(MakeMessage(1));
+  EXPECT_FALSE(filter.IsDuplicate(message));
+  message.set_hops_to_live(message.hops_to_live() - 1);
+  message.add_route_history(0x0123456789abcdefULL);
+  EXPECT_TRUE(filter.IsDuplicate(message));
+
+  protobuf::Message other(message);
+  other.set_destination_id(NodeId(NodeId::kRandomId).string());
+  EXPECT_FALSE(filter.IsDuplicate(other));
+  other = message;
+  other.set_visited(true);
+  EXPECT_FALSE(filter.IsDuplicate(other));
+  other = message;
+  other.set_request(false);
+  EXPECT_FALSE(filter.IsDuplicate(other));
+
+  // Without an ID, copies can't be told from distinct messages.
+  protobuf::Message untracked(MakeMessage(0));
+  EXPECT_FALSE(filter.IsDuplicate(untracked));
+  EXPECT_FALSE(filter.IsDuplicate(untracked));
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(250));
+  EXPECT_FALSE(filter.IsDuplicate(message));
+  EXPECT_TRUE(filter.IsDuplicate(message));
+}
+
+TEST(DuplicateFilterTest, BEH_MemoryIsBounded) {
+  const size_t kCapacity(8);
+  DuplicateFilter filter(std::chrono::hours(1), kCapacity);
+  protobuf::Message first(MakeMessage(1));
+  EXPECT_FALSE(filter.IsDuplicate(first));
+  for (size_t i(0); i != kCapacity * 2; ++i)
+    EXPECT_FALSE(filter.IsDuplicate(MakeMessage(static_cast<int32_t>(i + 2))));
+  EXPECT_FALSE(filter.IsDuplicate(first));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,86 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/find_nodes_memo.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(FindNodesMemoTest, BEH_ReusesOnlyIdenticalRequests) {
+  FindNodesMemo memo(std::chrono::seconds(10), 8);
+  NodeId target(NodeId::kRandomId), other_target(NodeId::kRandomId);
+  std::string nodes;
+  EXPECT_FALSE(memo.Get(target, 4, false, 1, nodes));
+  memo.Add(target, 4, false, 1, "nodes");
+  EXPECT_TRUE(memo.Get(target, 4, false, 1, nodes));
+  EXPECT_EQ("nodes", nodes);
+  EXPECT_FALSE(memo.Get(target, 5, false, 1, nodes));
+  EXPECT_FALSE(memo.Get(other_target, 4, false, 1, nodes));
+  EXPECT_FALSE(memo.Get(target, 4, true, 1, nodes));
+}
+
+TEST(FindNodesMemoTest, BEH_DropsEntriesOnTableChange) {
+  FindNodesMemo memo(std::chrono::seconds(10), 8);
+  NodeId target(NodeId::kRandomId);
+  std::string nodes;
+  memo.Add(target, 4, false, 1, "nodes");
+  EXPECT_FALSE(memo.Get(target, 4, false, 2, nodes));
+  // Once a newer version has been seen, older entries are neither served nor added.
+  EXPECT_FALSE(memo.Get(target, 4, false, 1, nodes));
+  memo.Add(target, 4, false, 1, "stale nodes");
+  EXPECT_FALSE(memo.Get(target, 4, false, 1, nodes));
+  memo.Add(target, 4, false, 2, "new nodes");
+  EXPECT_TRUE(memo.Get(target, 4, false, 2, nodes));
+  EXPECT_EQ("new nodes", nodes);
+}
+
+TEST(FindNodesMemoTest, BEH_ExpiresAndStaysBounded) {
+  FindNodesMemo memo(std::chrono::milliseconds(100), 2);
+  NodeId target(NodeId::kRandomId);
+  std::string nodes;
+  memo.Add(target, 4, false, 0, "nodes");
+  std::this_thread::sleep_for(std::chrono::milliseconds(150));
+  EXPECT_FALSE(memo.Get(target, 4, false, 0, nodes));
+
+  memo.Add(target, 1, false, 0, "1");
+  memo.Add(target, 2, false, 0, "2");
+  EXPECT_TRUE(memo.Get(target, 1, false, 0, nodes));
+  memo.Add(target, 3, false, 0, "3");
+  EXPECT_TRUE(memo.Get(target, 3, false, 0, nodes));
+  EXPECT_FALSE(memo.Get(target, 1, false, 0, nodes) && memo.Get(target, 2, false, 0, nodes));
+
+  FindNodesMemo disabled(std::chrono::seconds(10), 0);
+  disabled.Add(target, 4, false, 0, "nodes");
+  EXPECT_FALSE(disabled.Get(target, 4, false, 0, nodes));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,137 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/group_cache.h"
+#include "maidsafe/routing/matrix_change.h"
+#include "maidsafe/routing/parameters.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+std::vector<NodeId> MakeGroup() {
+  std::vector<NodeId> group;
+  for (int i(0); i != 4; ++i)
+    group.push_back(NodeId(NodeId::kRandomId));
+  return group;
+}
+
+// Returns group_id with its last byte changed by distance, so is that far from group_id.
+NodeId NearbyId(const NodeId& group_id, unsigned char distance) {
+  std::string id(group_id.string());
+  id.back() ^= static_cast<char>(distance);
+  return NodeId(id);
+}
+
+}  // unnamed namespace
+
+TEST(GroupCacheTest, BEH_ExpiresAndClears) {
+  GroupCache cache(std::chrono::milliseconds(200), 8);
+  NodeId group_id(NodeId::kRandomId);
+  std::vector<NodeId> group(MakeGroup()), cached;
+  EXPECT_FALSE(cache.Get(group_id, cached));
+  cache.Add(group_id, std::vector<NodeId>());
+  EXPECT_FALSE(cache.Get(group_id, cached));
+
+  cache.Add(group_id, group);
+  ASSERT_TRUE(cache.Get(group_id, cached));
+  EXPECT_EQ(group, cached);
+  cache.Clear();
+  EXPECT_FALSE(cache.Get(group_id, cached));
+
+  cache.Add(group_id, group);
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  EXPECT_FALSE(cache.Get(group_id, cached));
+}
+
+TEST(GroupCacheTest, BEH_EvictsLeastRecentlyUsedWhenFull) {
+  GroupCache cache(std::chrono::seconds(10), 4);
+  std::vector<NodeId> group_ids;
+  for (int i(0); i != 4; ++i) {
+    group_ids.push_back(NodeId(NodeId::kRandomId));
+    cache.Add(group_ids.back(), MakeGroup());
+  }
+  std::vector<NodeId> cached;
+  EXPECT_TRUE(cache.Get(group_ids.front(), cached));
+  group_ids.push_back(NodeId(NodeId::kRandomId));
+  cache.Add(group_ids.back(), MakeGroup());
+  EXPECT_FALSE(cache.Get(group_ids[1], cached));
+  for (int i(0); i != 5; ++i) {
+    if (i != 1)
+      EXPECT_TRUE(cache.Get(group_ids[i], cached));
+  }
+}
+
+TEST(GroupCacheTest, BEH_Leader) {
+  GroupCache cache(std::chrono::seconds(10), 4);
+  NodeId group_id(NodeId::kRandomId), leader;
+  std::vector<NodeId> group(MakeGroup());
+  cache.Add(group_id, group);
+  EXPECT_FALSE(cache.GetLeader(group_id, leader));
+  cache.Add(group_id, group, group.front());
+  ASSERT_TRUE(cache.GetLeader(group_id, leader));
+  EXPECT_EQ(group.front(), leader);
+}
+
+TEST(GroupCacheTest, BEH_InvalidateTouchedGroups) {
+  ASSERT_EQ(4, Parameters::group_size);
+  GroupCache cache(std::chrono::seconds(10), 8);
+  NodeId this_node_id(NodeId::kRandomId), near_group_id(NodeId::kRandomId),
+      far_group_id(NodeId::kRandomId);
+  std::vector<NodeId> near_group, far_group;
+  for (unsigned char distance(2); distance != 6; ++distance) {
+    near_group.push_back(NearbyId(near_group_id, distance));
+    far_group.push_back(NearbyId(far_group_id, distance));
+  }
+  std::vector<NodeId> cached;
+
+  // A new node further from both groups than their members touches neither.
+  NodeId unrelated(NodeId::kRandomId);
+  cache.Add(near_group_id, near_group);
+  cache.Add(far_group_id, far_group);
+  cache.Invalidate(MatrixChange(this_node_id, std::vector<NodeId>(1, this_node_id),
+                                std::vector<NodeId>{this_node_id, unrelated}));
+  EXPECT_TRUE(cache.Get(near_group_id, cached));
+  EXPECT_TRUE(cache.Get(far_group_id, cached));
+
+  // Losing a member, or gaining a node closer than the furthest member, touches the group.
+  cache.Invalidate(MatrixChange(this_node_id, std::vector<NodeId>{this_node_id, near_group[2]},
+                                std::vector<NodeId>(1, this_node_id)));
+  EXPECT_FALSE(cache.Get(near_group_id, cached));
+  EXPECT_TRUE(cache.Get(far_group_id, cached));
+  cache.Invalidate(MatrixChange(this_node_id, std::vector<NodeId>(1, this_node_id),
+                                std::vector<NodeId>{this_node_id, NearbyId(far_group_id, 1)}));
+  EXPECT_FALSE(cache.Get(far_group_id, cached));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
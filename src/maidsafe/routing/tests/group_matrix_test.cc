@@ -16,6 +16,7 @@
     See the Licences for the specific language governing permissions and limitations relating to
     use of the MaidSafe Software.                                                                 */
 
+#include <algorithm>
 #include <bitset>
 #include <memory>
 #include <numeric>
@@ -28,6 +29,7 @@
 #include "maidsafe/common/utils.h"
 #include "maidsafe/routing/group_matrix.h"
 #include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/route_history.h"
 #include "maidsafe/routing/tests/test_utils.h"
 
 namespace maidsafe {
@@ -85,12 +87,12 @@ TEST_F(IsThisNodeGroupLeaderGroupMatrixTest, BEH_TwoSmallRowsCaseA) {
   std::vector<NodeInfo> row;
   matrix.AddConnectedPeer(nodes_.at(2));
   row.push_back(nodes_.at(0));
-  matrix.UpdateFromConnectedPeer(nodes_.at(2).node_id, row, std::vector<NodeId>());
+  matrix.UpdateFromConnectedPeer(nodes_.at(2).node_id, row);
 
   matrix.AddConnectedPeer(nodes_.at(3));
   row.clear();
   row.push_back(nodes_.at(1));
-  matrix.UpdateFromConnectedPeer(nodes_.at(3).node_id, row, std::vector<NodeId>());
+  matrix.UpdateFromConnectedPeer(nodes_.at(3).node_id, row);
 
   NodeId connected_peer;
   EXPECT_FALSE(matrix.IsThisNodeGroupLeader(target_id_, connected_peer));
@@ -104,12 +106,12 @@ TEST_F(IsThisNodeGroupLeaderGroupMatrixTest, BEH_TwoSmallRowsCaseB) {
   std::vector<NodeInfo> row;
   matrix.AddConnectedPeer(nodes_.at(2));
   row.push_back(nodes_.at(1));
-  matrix.UpdateFromConnectedPeer(nodes_.at(2).node_id, row, std::vector<NodeId>());
+  matrix.UpdateFromConnectedPeer(nodes_.at(2).node_id, row);
 
   matrix.AddConnectedPeer(nodes_.at(3));
   row.clear();
   row.push_back(nodes_.at(0));
-  matrix.UpdateFromConnectedPeer(nodes_.at(3).node_id, row, std::vector<NodeId>());
+  matrix.UpdateFromConnectedPeer(nodes_.at(3).node_id, row);
 
   NodeId connected_peer;
   EXPECT_FALSE(matrix.IsThisNodeGroupLeader(target_id_, connected_peer));
@@ -126,9 +128,9 @@ TEST_F(IsThisNodeGroupLeaderGroupMatrixTest, BEH_ThreeEqualRows) {
   matrix.AddConnectedPeer(nodes_.at(2));
   matrix.AddConnectedPeer(nodes_.at(1));
   matrix.AddConnectedPeer(nodes_.at(3));
-  matrix.UpdateFromConnectedPeer(nodes_.at(2).node_id, row, std::vector<NodeId>());
-  matrix.UpdateFromConnectedPeer(nodes_.at(1).node_id, row, std::vector<NodeId>());
-  matrix.UpdateFromConnectedPeer(nodes_.at(3).node_id, row, std::vector<NodeId>());
+  matrix.UpdateFromConnectedPeer(nodes_.at(2).node_id, row);
+  matrix.UpdateFromConnectedPeer(nodes_.at(1).node_id, row);
+  matrix.UpdateFromConnectedPeer(nodes_.at(3).node_id, row);
 
   NodeId connected_peer;
   EXPECT_FALSE(matrix.IsThisNodeGroupLeader(target_id_, connected_peer));
@@ -145,13 +147,13 @@ TEST_F(IsThisNodeGroupLeaderGroupMatrixTest, BEH_TargetInMatrix) {
   std::vector<NodeInfo> row;
   row.push_back(nodes_.at(0));
   for (uint16_t i(2); i <= Parameters::closest_nodes_size; i += 2)
-    matrix.UpdateFromConnectedPeer(nodes_.at(i).node_id, row, std::vector<NodeId>());
+    matrix.UpdateFromConnectedPeer(nodes_.at(i).node_id, row);
   row.clear();
   NodeInfo target_node_info;
   target_node_info.node_id = target_id_;
   row.push_back(target_node_info);
   for (uint16_t i(1); i <= Parameters::closest_nodes_size; i += 2)
-    matrix.UpdateFromConnectedPeer(nodes_.at(i).node_id, row, std::vector<NodeId>());
+    matrix.UpdateFromConnectedPeer(nodes_.at(i).node_id, row);
 
   NodeId connected_peer;
   EXPECT_FALSE(matrix.IsThisNodeGroupLeader(target_id_, connected_peer));
@@ -168,7 +170,7 @@ TEST_F(IsThisNodeGroupLeaderGroupMatrixTest, BEH_IsGroupLeader) {
   row.push_back(nodes_.at(0));
   for (uint16_t i(1); i <= Parameters::closest_nodes_size; ++i) {
     matrix.AddConnectedPeer(nodes_.at(i));
-    matrix.UpdateFromConnectedPeer(nodes_.at(i).node_id, row, std::vector<NodeId>());
+    matrix.UpdateFromConnectedPeer(nodes_.at(i).node_id, row);
   }
 
   NodeId connected_peer;
@@ -266,7 +268,7 @@ TEST_P(GroupMatrixTest, BEH_OneRowOnly) {
   }
   matrix_.AddConnectedPeer(row_1);
   EXPECT_EQ(1, matrix_.GetConnectedPeers().size());
-  matrix_.UpdateFromConnectedPeer(row_1.node_id, row_entries_1, std::vector<NodeId>());
+  matrix_.UpdateFromConnectedPeer(row_1.node_id, row_entries_1);
   EXPECT_EQ(1, matrix_.GetConnectedPeers().size());
 
   // Check row contents
@@ -295,7 +297,7 @@ TEST_P(GroupMatrixTest, BEH_OneRowOnly) {
     node_info.node_id = NodeId(NodeId::kRandomId);
     row_entries_1.push_back(node_info);
   }
-  matrix_.UpdateFromConnectedPeer(row_1.node_id, row_entries_1, std::vector<NodeId>());
+  matrix_.UpdateFromConnectedPeer(row_1.node_id, row_entries_1);
   EXPECT_EQ(1, matrix_.GetConnectedPeers().size());
 
   // Check row contents
@@ -389,7 +391,7 @@ TEST_P(GroupMatrixTest, BEH_RowsContainSameNodes) {
   std::vector<NodeInfo> row_result;
   for (const auto& row_id : row_ids) {
     matrix_.AddConnectedPeer(row_id);
-    matrix_.UpdateFromConnectedPeer(row_id.node_id, row_entries, std::vector<NodeId>());
+    matrix_.UpdateFromConnectedPeer(row_id.node_id, row_entries);
     EXPECT_FALSE(matrix_.IsRowEmpty(row_id));
     EXPECT_TRUE(matrix_.GetRow(row_id.node_id, row_result));
     EXPECT_EQ(row_result.size(), row_entries.size());
@@ -459,10 +461,97 @@ TEST_P(GroupMatrixTest, BEH_UpdateFromNonPeer) {
     ++i;
   }
 
-  matrix_.UpdateFromConnectedPeer(node_id_1.node_id, row_entries, std::vector<NodeId>());
+  matrix_.UpdateFromConnectedPeer(node_id_1.node_id, row_entries);
   EXPECT_EQ(0, matrix_.GetConnectedPeers().size());
 }
 
+TEST_P(GroupMatrixTest, BEH_PatchFromConnectedPeer) {
+  NodeInfo peer;
+  peer.node_id = NodeId(NodeId::kRandomId);
+  std::vector<NodeInfo> row_entries;
+  NodeInfo node_info;
+  for (int i(0); i != 3; ++i) {
+    node_info.node_id = NodeId(NodeId::kRandomId);
+    row_entries.push_back(node_info);
+  }
+  matrix_.AddConnectedPeer(peer);
+  // The row has no version yet, so a delta can't be applied to it.
+  EXPECT_EQ(nullptr, matrix_.PatchFromConnectedPeer(peer.node_id, std::vector<NodeInfo>(),
+                                                    std::vector<NodeId>(), 1, 2));
+  matrix_.UpdateFromConnectedPeer(peer.node_id, row_entries, 1);
+
+  node_info.node_id = NodeId(NodeId::kRandomId);
+  std::vector<NodeInfo> added_nodes(1, node_info);
+  std::vector<NodeId> removed_nodes(1, row_entries.front().node_id);
+  EXPECT_EQ(nullptr, matrix_.PatchFromConnectedPeer(peer.node_id, added_nodes, removed_nodes, 2,
+                                                    3));
+  EXPECT_NE(nullptr, matrix_.PatchFromConnectedPeer(peer.node_id, added_nodes, removed_nodes, 1,
+                                                    2));
+  row_entries.erase(row_entries.begin());
+  row_entries.push_back(node_info);
+  std::vector<NodeInfo> row_result;
+  EXPECT_TRUE(matrix_.GetRow(peer.node_id, row_result));
+  EXPECT_TRUE(CompareListOfNodeInfos(row_entries, row_result));
+
+  // The same delta again is now based on a stale version.
+  EXPECT_EQ(nullptr, matrix_.PatchFromConnectedPeer(peer.node_id, added_nodes, removed_nodes, 1,
+                                                    2));
+}
+
+TEST_P(GroupMatrixTest, BEH_RowMatchesDigest) {
+  NodeInfo peer;
+  peer.node_id = NodeId(NodeId::kRandomId);
+  std::vector<NodeInfo> row_entries;
+  NodeInfo node_info;
+  for (int i(0); i != 3; ++i) {
+    node_info.node_id = NodeId(NodeId::kRandomId);
+    row_entries.push_back(node_info);
+  }
+  std::vector<NodeInfo> reversed(row_entries.rbegin(), row_entries.rend());
+  const uint64_t kDigest(GroupMatrix::RowDigest(row_entries));
+  EXPECT_EQ(kDigest, GroupMatrix::RowDigest(reversed));
+
+  matrix_.AddConnectedPeer(peer);
+  // Unversioned rows never match.
+  matrix_.UpdateFromConnectedPeer(peer.node_id, reversed);
+  EXPECT_FALSE(matrix_.RowMatchesDigest(peer.node_id, 0, kDigest));
+  matrix_.UpdateFromConnectedPeer(peer.node_id, reversed, 1);
+  EXPECT_TRUE(matrix_.RowMatchesDigest(peer.node_id, 1, kDigest));
+  EXPECT_FALSE(matrix_.RowMatchesDigest(peer.node_id, 2, kDigest));
+  EXPECT_FALSE(matrix_.RowMatchesDigest(NodeId(NodeId::kRandomId), 1, kDigest));
+
+  row_entries.pop_back();
+  EXPECT_FALSE(matrix_.RowMatchesDigest(peer.node_id, 1, GroupMatrix::RowDigest(row_entries)));
+}
+
+TEST_P(GroupMatrixTest, BEH_SharedNodeOutlivesOneRow) {
+  NodeInfo peer_1, peer_2, shared_node;
+  peer_1.node_id = NodeId(NodeId::kRandomId);
+  peer_2.node_id = NodeId(NodeId::kRandomId);
+  shared_node.node_id = NodeId(NodeId::kRandomId);
+  std::vector<NodeInfo> row_entries(1, shared_node);
+  matrix_.AddConnectedPeer(peer_1, row_entries);
+  matrix_.AddConnectedPeer(peer_2, row_entries);
+  size_t expected_size(client_mode_ ? 3 : 4);
+  EXPECT_EQ(expected_size, matrix_.GetUniqueNodes().size());
+  EXPECT_TRUE(matrix_.Contains(shared_node.node_id));
+
+  matrix_.RemoveConnectedPeer(peer_1);
+  EXPECT_EQ(expected_size - 1, matrix_.GetUniqueNodes().size());
+  EXPECT_FALSE(matrix_.Contains(peer_1.node_id));
+  EXPECT_TRUE(matrix_.Contains(shared_node.node_id));
+
+  matrix_.UpdateFromConnectedPeer(peer_2.node_id, std::vector<NodeInfo>());
+  EXPECT_FALSE(matrix_.Contains(shared_node.node_id));
+  EXPECT_EQ(expected_size - 2, matrix_.GetUniqueNodes().size());
+  std::vector<NodeInfo> unique_nodes(matrix_.GetUniqueNodes());
+  EXPECT_TRUE(std::is_sorted(unique_nodes.begin(), unique_nodes.end(),
+                             [this](const NodeInfo& lhs, const NodeInfo& rhs) {
+                               return NodeId::CloserToTarget(lhs.node_id, rhs.node_id,
+                                                             own_node_id_);
+                             }));
+}
+
 TEST_P(GroupMatrixTest, BEH_AddUpdateGetRemovePeers) {
   // Add peers
   std::vector<NodeInfo> row_ids;
@@ -492,7 +581,7 @@ TEST_P(GroupMatrixTest, BEH_AddUpdateGetRemovePeers) {
       node_info.node_id = NodeId(NodeId::kRandomId);
       row_entries.push_back(node_info);
     }
-    matrix_.UpdateFromConnectedPeer(row_id.node_id, row_entries, std::vector<NodeId>());
+    matrix_.UpdateFromConnectedPeer(row_id.node_id, row_entries);
     EXPECT_FALSE(matrix_.IsRowEmpty(row_id));
     EXPECT_TRUE(matrix_.GetRow(row_id.node_id, row_result));
     EXPECT_TRUE(CompareListOfNodeInfos(row_result, row_entries));
@@ -556,9 +645,9 @@ TEST_P(GroupMatrixTest, BEH_GetConnectedPeerFor) {
     row_entries_3.push_back(node_info);
     ++i;
   }
-  matrix_.UpdateFromConnectedPeer(row_1.node_id, row_entries_1, std::vector<NodeId>());
-  matrix_.UpdateFromConnectedPeer(row_2.node_id, row_entries_2, std::vector<NodeId>());
-  matrix_.UpdateFromConnectedPeer(row_3.node_id, row_entries_3, std::vector<NodeId>());
+  matrix_.UpdateFromConnectedPeer(row_1.node_id, row_entries_1);
+  matrix_.UpdateFromConnectedPeer(row_2.node_id, row_entries_2);
+  matrix_.UpdateFromConnectedPeer(row_3.node_id, row_entries_3);
   std::vector<NodeInfo> row_result;
   EXPECT_FALSE(matrix_.IsRowEmpty(row_1));
   EXPECT_TRUE(matrix_.GetRow(row_1.node_id, row_result));
@@ -584,7 +673,7 @@ TEST_P(GroupMatrixTest, BEH_GetConnectedPeerFor) {
       row_entries.push_back(node);
     }
     matrix_.AddConnectedPeer(node_info);
-    matrix_.UpdateFromConnectedPeer(row_id, row_entries, std::vector<NodeId>());
+    matrix_.UpdateFromConnectedPeer(row_id, row_entries);
     EXPECT_TRUE(matrix_.GetRow(row_id, row_result));
     EXPECT_TRUE(CompareListOfNodeInfos(row_result, row_entries));
   }
@@ -622,7 +711,7 @@ TEST_P(GroupMatrixTest, BEH_ClosestToId) {
       row_entries.push_back(node);
     }
     matrix_.AddConnectedPeer(row_entry);
-    matrix_.UpdateFromConnectedPeer(row_entry.node_id, row_entries, std::vector<NodeId>());
+    matrix_.UpdateFromConnectedPeer(row_entry.node_id, row_entries);
     known_nodes.push_back(row_entry);
     for (const auto& node_id : row_entries)
       known_nodes.push_back(node_id);
@@ -659,7 +748,7 @@ TEST_P(GroupMatrixTest, BEH_IsNodeIdInGroupRange) {
       row_entries.push_back(node);
     }
     matrix_.AddConnectedPeer(row_entry);
-    matrix_.UpdateFromConnectedPeer(row_entry.node_id, row_entries, std::vector<NodeId>());
+    matrix_.UpdateFromConnectedPeer(row_entry.node_id, row_entries);
     node_ids.push_back(row_entry);
     for (const auto& node_id : row_entries)
       node_ids.push_back(node_id);
@@ -713,7 +802,7 @@ TEST_P(GroupMatrixTest, BEH_IsNodeIdInGroupRangeDifferentNode) {
       row_entries.push_back(node);
     }
     matrix_.AddConnectedPeer(row_entry);
-    matrix_.UpdateFromConnectedPeer(row_entry.node_id, row_entries, std::vector<NodeId>());
+    matrix_.UpdateFromConnectedPeer(row_entry.node_id, row_entries);
     node_ids.push_back(row_entry);
     for (const auto& node_id : row_entries)
       node_ids.push_back(node_id);
@@ -774,7 +863,7 @@ TEST_P(GroupMatrixTest, BEH_UpdateFromConnectedPeer) {
     row_entries_1.push_back(node_info);
     ++i;
   }
-  matrix_.UpdateFromConnectedPeer(row_1.node_id, row_entries_1, std::vector<NodeId>());
+  matrix_.UpdateFromConnectedPeer(row_1.node_id, row_entries_1);
   std::vector<NodeInfo> row_result;
   EXPECT_FALSE(matrix_.IsRowEmpty(row_1));
   EXPECT_TRUE(matrix_.GetRow(row_1.node_id, row_result));
@@ -793,7 +882,7 @@ TEST_P(GroupMatrixTest, BEH_UpdateFromConnectedPeer) {
       row_entries.push_back(node);
     }
     matrix_.AddConnectedPeer(row_id);
-    matrix_.UpdateFromConnectedPeer(row_id.node_id, row_entries, std::vector<NodeId>());
+    matrix_.UpdateFromConnectedPeer(row_id.node_id, row_entries);
     if (length == 0)
       EXPECT_TRUE(matrix_.IsRowEmpty(row_id));
     else
@@ -815,7 +904,7 @@ TEST_P(GroupMatrixTest, BEH_UpdateFromConnectedPeer) {
     row_entries_2.push_back(node);
     ++j;
   }
-  matrix_.UpdateFromConnectedPeer(row_1.node_id, row_entries_2, std::vector<NodeId>());
+  matrix_.UpdateFromConnectedPeer(row_1.node_id, row_entries_2);
 
   // Check matrix row contains all the new nodes and none of the old ones
   EXPECT_TRUE(matrix_.GetRow(row_1.node_id, row_result));
@@ -857,12 +946,35 @@ TEST_P(GroupMatrixTest, BEH_CheckUniqueNodeList) {
       row_entries.push_back(new_row_entry);
       node_ids.push_back(new_row_entry);
     }
-    matrix_.UpdateFromConnectedPeer(row_id.node_id, row_entries, std::vector<NodeId>());
+    matrix_.UpdateFromConnectedPeer(row_id.node_id, row_entries);
     SortNodeInfosFromTarget(own_node_id_, node_ids);
     EXPECT_TRUE(CompareListOfNodeInfos(node_ids, matrix_.GetUniqueNodes()));
   }
 }
 
+TEST_P(GroupMatrixTest, BEH_ConnectedPeersSortedFromOwnId) {
+  std::vector<NodeInfo> row_ids;
+  while (row_ids.size() < Parameters::closest_nodes_size) {
+    row_ids.push_back(MakeNode());
+    matrix_.AddConnectedPeer(row_ids.back());
+    SortNodeInfosFromTarget(own_node_id_, row_ids);
+    auto connected_peers(matrix_.GetConnectedPeers());
+    ASSERT_EQ(row_ids.size(), connected_peers.size());
+    for (size_t i(0); i < row_ids.size(); ++i)
+      EXPECT_EQ(row_ids.at(i).node_id, connected_peers.at(i).node_id);
+  }
+
+  while (!row_ids.empty()) {
+    size_t index(RandomUint32() % row_ids.size());
+    matrix_.RemoveConnectedPeer(row_ids.at(index));
+    row_ids.erase(row_ids.begin() + index);
+    auto connected_peers(matrix_.GetConnectedPeers());
+    ASSERT_EQ(row_ids.size(), connected_peers.size());
+    for (size_t i(0); i < row_ids.size(); ++i)
+      EXPECT_EQ(row_ids.at(i).node_id, connected_peers.at(i).node_id);
+  }
+}
+
 TEST_P(GroupMatrixTest, BEH_GetAllConnectedPeers) {
   // Add rows to matrix and check GetUniqueNodes
   std::vector<NodeInfo> row_ids;
@@ -887,8 +999,7 @@ TEST_P(GroupMatrixTest, BEH_GetAllConnectedPeers) {
   std::vector<NodeInfo> row_content;
   while (row_content.size() < Parameters::closest_nodes_size) {
     row_content.push_back(MakeNode());
-    matrix_.UpdateFromConnectedPeer(row_ids.at(row_content.size() - 1).node_id, row_content,
-                                    std::vector<NodeId>());
+    matrix_.UpdateFromConnectedPeer(row_ids.at(row_content.size() - 1).node_id, row_content);
   }
 
   // Verify GetAllConnectedPeers
@@ -900,6 +1011,74 @@ TEST_P(GroupMatrixTest, BEH_GetAllConnectedPeers) {
   }
 }
 
+TEST_P(GroupMatrixTest, BEH_GetBetterNodeMatchesRowScan) {
+  // Rows draw from a shared pool, so most members are listed by several peers.
+  std::vector<NodeInfo> pool(4 * Parameters::closest_nodes_size), peers;
+  for (auto& node_info : pool)
+    node_info.node_id = NodeId(NodeId::kRandomId);
+  pool.push_back(own_node_info_);
+  for (uint16_t i(0); i != Parameters::closest_nodes_size; ++i) {
+    peers.push_back(pool[i]);
+    matrix_.AddConnectedPeer(peers.back());
+  }
+  for (const auto& peer : peers) {
+    std::vector<NodeInfo> row;
+    for (uint32_t i(RandomUint32() % Parameters::closest_nodes_size + 1); i != 0; --i) {
+      const auto& entry(pool[RandomUint32() % pool.size()]);
+      if (entry.node_id != peer.node_id)
+        row.push_back(entry);
+    }
+    matrix_.UpdateFromConnectedPeer(peer.node_id, row);
+  }
+  std::vector<std::vector<NodeInfo>> rows;
+  for (const auto& peer : matrix_.GetConnectedPeers()) {
+    std::vector<NodeInfo> row;
+    ASSERT_TRUE(matrix_.GetRow(peer.node_id, row));
+    row.insert(row.begin(), peer);
+    rows.push_back(row);
+  }
+
+  for (int trial(0); trial != 100; ++trial) {
+    NodeId target_id(trial % 4 == 0 ? pool[RandomUint32() % pool.size()].node_id
+                                    : NodeId(NodeId::kRandomId));
+    bool ignore_exact_match(trial % 2 == 0);
+    RouteHistory exclude;
+    for (int i(trial % 3); i != 0; --i)
+      exclude.Add(pool[RandomUint32() % pool.size()].node_id);
+    auto eligible([&](const NodeId& node_id) {
+      return !(ignore_exact_match && node_id == target_id) && !exclude.Contains(node_id);
+    });
+
+    // The closest eligible member of any row with an eligible head, as a full scan finds it.
+    NodeId best_id(own_node_id_);
+    for (const auto& row : rows) {
+      if (!eligible(row.front().node_id))
+        continue;
+      for (const auto& node_info : row) {
+        if (node_info.node_id != own_node_id_ && eligible(node_info.node_id) &&
+            NodeId::CloserToTarget(node_info.node_id, best_id, target_id))
+          best_id = node_info.node_id;
+      }
+    }
+
+    NodeInfo current_closest_peer(own_node_info_);
+    matrix_.GetBetterNodeForSendingMessage(target_id, exclude, ignore_exact_match,
+                                           current_closest_peer);
+    if (best_id == own_node_id_) {
+      EXPECT_EQ(own_node_id_, current_closest_peer.node_id);
+      continue;
+    }
+    EXPECT_TRUE(eligible(current_closest_peer.node_id));
+    std::vector<NodeInfo> row;
+    ASSERT_TRUE(matrix_.GetRow(current_closest_peer.node_id, row));
+    row.push_back(current_closest_peer);
+    EXPECT_NE(std::end(row), std::find_if(std::begin(row), std::end(row),
+                                          [&](const NodeInfo& node_info) {
+                                            return node_info.node_id == best_id;
+                                          }));
+  }
+}
+
 TEST_P(GroupMatrixTest, BEH_Prune) {
   const size_t kNodesSize(10);
   std::vector<NodeInfo> all_nodes_info;
@@ -927,8 +1106,8 @@ TEST_P(GroupMatrixTest, BEH_Prune) {
     std::sort(copy.begin(), copy.end(), [current_id](const NodeInfo & lhs, const NodeInfo & rhs) {
       return NodeId::CloserToTarget(lhs.node_id, rhs.node_id, current_id);
     });
-    matrix_.UpdateFromConnectedPeer(current_id, std::vector<NodeInfo>(copy.begin() + 1, copy.end()),
-                                    std::vector<NodeId>());
+    matrix_.UpdateFromConnectedPeer(current_id,
+                                    std::vector<NodeInfo>(copy.begin() + 1, copy.end()));
   }
   auto connected_peers(matrix_.GetConnectedPeers());
   auto far_node_itr(
@@ -971,18 +1150,18 @@ TEST_P(GroupMatrixTest, BEH_CheckAssertions) {
 
 // Update row using zero ID
 #ifndef NDEBUG
-  EXPECT_DEATH(matrix_.UpdateFromConnectedPeer(zero_id, row, std::vector<NodeId>()), "");
+  EXPECT_DEATH(matrix_.UpdateFromConnectedPeer(zero_id, row), "");
 #else
-  EXPECT_NO_THROW(matrix_.UpdateFromConnectedPeer(zero_id, row, std::vector<NodeId>()));
+  EXPECT_NO_THROW(matrix_.UpdateFromConnectedPeer(zero_id, row));
 #endif
 
   // Update row using too big row size
   while (row.size() < static_cast<size_t>(Parameters::max_routing_table_size + 1))
     row.push_back(NodeInfo());
 #ifndef NDEBUG
-  EXPECT_DEATH(matrix_.UpdateFromConnectedPeer(random_id_1, row, std::vector<NodeId>()), "");
+  EXPECT_DEATH(matrix_.UpdateFromConnectedPeer(random_id_1, row), "");
 #else
-  EXPECT_NO_THROW(matrix_.UpdateFromConnectedPeer(random_id_1, row, std::vector<NodeId>()));
+  EXPECT_NO_THROW(matrix_.UpdateFromConnectedPeer(random_id_1, row));
 #endif
 
   // Add too many rows
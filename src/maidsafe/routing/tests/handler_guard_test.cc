@@ -0,0 +1,80 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/handler_guard.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(HandlerGuardTest, BEH_WrappedHandlersRunUntilClosed) {
+  HandlerGuard guard;
+  int sum(0);
+  auto add(guard.Wrap([&sum](int value) { sum += value; }));
+  add(1);
+  add(2);
+  EXPECT_EQ(3, sum);
+  guard.Close();
+  add(4);
+  EXPECT_EQ(3, sum);
+}
+
+TEST(HandlerGuardTest, BEH_HandlersOutliveTheirGuard) {
+  bool called(false);
+  std::function<void()> handler;
+  {
+    HandlerGuard guard;
+    handler = guard.Wrap([&called] { called = true; });
+  }
+  handler();
+  EXPECT_FALSE(called);
+}
+
+TEST(HandlerGuardTest, BEH_CloseWaitsForRunningHandlers) {
+  HandlerGuard guard;
+  std::promise<void> started, release;
+  std::atomic<bool> finished(false);
+  auto release_future(release.get_future().share());
+  std::thread runner(guard.Wrap([&] {
+    started.set_value();
+    release_future.wait();
+    finished = true;
+  }));
+  started.get_future().wait();
+  auto closed(std::async(std::launch::async, [&guard] { guard.Close(); }));
+  EXPECT_EQ(std::future_status::timeout, closed.wait_for(std::chrono::milliseconds(100)));
+  release.set_value();
+  closed.get();
+  EXPECT_TRUE(finished);
+  runner.join();
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,53 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/ingress_limiter.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(IngressLimiterTest, BEH_ShedsLowPriorityFirst) {
+  IngressLimiter limiter(8);
+  for (int i(0); i < 6; ++i)
+    EXPECT_TRUE(limiter.TryAdmit(false));
+  EXPECT_FALSE(limiter.TryAdmit(false));
+  EXPECT_EQ(1U, limiter.dropped_count());
+
+  EXPECT_TRUE(limiter.TryAdmit(true));
+  EXPECT_TRUE(limiter.TryAdmit(true));
+  EXPECT_FALSE(limiter.TryAdmit(true));
+  EXPECT_EQ(8U, limiter.size());
+  EXPECT_EQ(2U, limiter.dropped_count());
+
+  for (int i(0); i < 3; ++i)
+    limiter.Release();
+  EXPECT_TRUE(limiter.TryAdmit(false));
+  EXPECT_EQ(6U, limiter.size());
+  EXPECT_EQ(2U, limiter.dropped_count());
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
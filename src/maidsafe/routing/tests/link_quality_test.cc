@@ -0,0 +1,75 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <thread>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/link_quality.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(LinkQualityTest, BEH_EstimatesRttAndLoss) {
+  LinkQuality link_quality;
+  NodeId peer(NodeId::kRandomId);
+  std::chrono::microseconds cost;
+  EXPECT_FALSE(link_quality.Cost(peer, cost));
+
+  uint64_t stamp(link_quality.ProbeSent(peer));
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  link_quality.ProbeAnswered(peer, stamp + 1);
+  EXPECT_FALSE(link_quality.Cost(peer, cost));
+  link_quality.ProbeAnswered(peer, stamp);
+  ASSERT_TRUE(link_quality.Cost(peer, cost));
+  EXPECT_GE(link_quality.SmoothedRtt(peer), std::chrono::milliseconds(20));
+  EXPECT_EQ(link_quality.SmoothedRtt(peer), cost);
+  EXPECT_DOUBLE_EQ(0.0, link_quality.LossRate(peer));
+
+  // A second answer to the same probe is ignored.
+  link_quality.ProbeAnswered(peer, stamp);
+  EXPECT_GE(link_quality.SmoothedRtt(peer), std::chrono::milliseconds(20));
+
+  // Unanswered probes raise the loss estimate, and hence the cost.
+  link_quality.ProbeSent(peer);
+  link_quality.ProbeSent(peer);
+  EXPECT_LT(0.0, link_quality.LossRate(peer));
+  std::chrono::microseconds lossy_cost;
+  ASSERT_TRUE(link_quality.Cost(peer, lossy_cost));
+  EXPECT_LT(cost, lossy_cost);
+
+  EXPECT_DOUBLE_EQ(link_quality.LossRate(peer), link_quality.MeanLossRate());
+  NodeId other_peer(NodeId::kRandomId);
+  link_quality.ProbeAnswered(other_peer, link_quality.ProbeSent(other_peer));
+  EXPECT_DOUBLE_EQ(link_quality.LossRate(peer) / 2, link_quality.MeanLossRate());
+
+  link_quality.Remove(peer);
+  EXPECT_FALSE(link_quality.Cost(peer, cost));
+  EXPECT_DOUBLE_EQ(0.0, link_quality.MeanLossRate());
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
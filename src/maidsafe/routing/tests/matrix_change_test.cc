@@ -10,6 +10,7 @@
  *  the explicit written permission of the board of directors of maidsafe.net. *
  ******************************************************************************/
 
+#include <algorithm>
 #include <bitset>
 #include <map>
 #include <memory>
@@ -182,6 +183,64 @@ TEST_F(MatrixChangeTest, BEH_CheckHolders) {
     DoCheckHoldersTest(matrix_change);
 }
 
+TEST_F(MatrixChangeTest, BEH_BatchCheckHolders) {
+  // Drop a few nodes and add a few others so that there are old and new holders to find.
+  for (auto i(0); i != 3; ++i) {
+    new_matrix_.erase(new_matrix_.begin() + 1 + RandomUint32() % (new_matrix_.size() - 1));
+    new_matrix_.push_back(NodeId(NodeId::kRandomId));
+  }
+  MatrixChange matrix_change(kNodeId_, old_matrix_, new_matrix_);
+  std::vector<NodeId> targets;
+  for (auto i(0); i != 2000; ++i)
+    targets.push_back(NodeId(NodeId::kRandomId));
+  // Targets which are themselves in the matrices
+  targets.push_back(old_matrix_.back());
+  targets.push_back(new_matrix_.back());
+
+  std::vector<CheckHoldersResult> results;
+  for (auto round(0); round != 2; ++round) {
+    matrix_change.CheckHolders(targets, results);
+    ASSERT_EQ(targets.size(), results.size());
+    for (size_t i(0); i != targets.size(); ++i) {
+      auto expected(matrix_change.CheckHolders(targets[i]));
+      ASSERT_EQ(expected.proximity_status, results[i].proximity_status);
+      ASSERT_EQ(expected.new_holders, results[i].new_holders);
+      ASSERT_EQ(expected.old_holders, results[i].old_holders);
+    }
+    targets.resize(10);
+  }
+}
+
+// Other group sizes than Parameters::kDefaultGroupSize take the batch's unspecialised path.
+TEST_F(MatrixChangeTest, BEH_BatchCheckHoldersOtherGroupSize) {
+  for (auto i(0); i != 3; ++i) {
+    new_matrix_.erase(new_matrix_.begin() + 1 + RandomUint32() % (new_matrix_.size() - 1));
+    new_matrix_.push_back(NodeId(NodeId::kRandomId));
+  }
+  MatrixChange matrix_change(kNodeId_, old_matrix_, new_matrix_);
+  std::vector<NodeId> targets;
+  for (auto i(0); i != 500; ++i)
+    targets.push_back(NodeId(NodeId::kRandomId));
+  targets.push_back(old_matrix_.back());
+
+  const uint16_t kGroupSize(Parameters::group_size);
+  Parameters::group_size = Parameters::kDefaultGroupSize - 1;
+  std::vector<CheckHoldersResult> results;
+  matrix_change.CheckHolders(targets, results);
+  std::vector<CheckHoldersResult> expected;
+  for (const auto& target : targets)
+    expected.push_back(matrix_change.CheckHolders(target));
+  Parameters::group_size = kGroupSize;
+
+  ASSERT_EQ(expected.size(), results.size());
+  for (size_t i(0); i != targets.size(); ++i) {
+    ASSERT_EQ(expected[i].proximity_status, results[i].proximity_status);
+    ASSERT_EQ(expected[i].new_holders, results[i].new_holders);
+    ASSERT_EQ(expected[i].old_holders, results[i].old_holders);
+    ASSERT_GE(Parameters::kDefaultGroupSize - 1U, results[i].new_holders.size());
+  }
+}
+
 TEST_F(MatrixChangeTest, BEH_GroupMatrixUpdating) {
   GroupMatrix group_matrix(kNodeId_, false);
   for (auto& node : old_matrix_) {
@@ -223,6 +282,41 @@ TEST_F(MatrixChangeTest, BEH_GroupMatrixUpdating) {
   }
 }
 
+TEST_F(MatrixChangeTest, BEH_SharesPublishedMembers) {
+  GroupMatrix group_matrix(kNodeId_, false);
+  NodeInfo first, second;
+  first.node_id = old_matrix_.at(1);
+  second.node_id = old_matrix_.at(2);
+  auto first_change(group_matrix.AddConnectedPeer(first));
+  auto second_change(group_matrix.AddConnectedPeer(second));
+  // Consecutive changes share the matrix between them, and it stays sorted to this node.
+  EXPECT_EQ(first_change->new_members(), second_change->old_members());
+  EXPECT_EQ(group_matrix.members(), second_change->new_members());
+  EXPECT_LT(first_change->new_members()->version, second_change->new_members()->version);
+  std::vector<NodeId> sorted(second_change->new_members()->ids);
+  SortIdsFromTarget(kNodeId_, sorted);
+  EXPECT_EQ(sorted, second_change->new_members()->ids);
+  EXPECT_EQ(1U, second_change->new_nodes().size());
+  // The nodes themselves are republished with the members, at the same version.
+  auto nodes(group_matrix.nodes());
+  EXPECT_EQ(second_change->new_members()->version, nodes->version);
+  ASSERT_EQ(second_change->new_members()->ids.size(), nodes->nodes.size());
+  for (size_t i(0); i != nodes->nodes.size(); ++i)
+    EXPECT_EQ(second_change->new_members()->ids[i], nodes->nodes[i].node_id);
+
+  // Nothing is republished by an update which leaves the unique nodes as they were.
+  auto unchanged(group_matrix.AddConnectedPeer(first));
+  EXPECT_EQ(unchanged->old_members(), unchanged->new_members());
+  EXPECT_EQ(nodes, group_matrix.nodes());
+  EXPECT_TRUE(unchanged->lost_nodes().empty());
+  EXPECT_TRUE(unchanged->new_nodes().empty());
+
+  MatrixChange copy(*second_change);
+  EXPECT_EQ(second_change->old_members(), copy.old_members());
+  EXPECT_EQ(second_change->new_members(), copy.new_members());
+  EXPECT_EQ(second_change->new_nodes(), copy.new_nodes());
+}
+
 void Choose(const std::set<NodeId>& online_pmids,
             const NodeId& kTarget,
             const std::vector<MatrixChange>& owners,
@@ -305,6 +399,37 @@ TEST(SingleMatrixChangeTest, BEH_ChoosePmidNode) {
   Choose(online_pmids, kTarget, owners, kGroupSize, kGroupSize);
   Choose(online_pmids, kTarget, owners, kGroupSize, kGroupSize + 1);
   Choose(online_pmids, kTarget, owners, kGroupSize, kGroupSize + 2);
+
+  // The bulk variant must agree with the single one, target by target.  Each owner is given the
+  // random targets it is one of the group_size + 1 closest to, as ChoosePmidNode requires.
+  std::vector<NodeId> sorted_pmids(std::begin(online_pmids), std::end(online_pmids));
+  EXPECT_THROW(owners[0].ChoosePmidNodes(std::vector<NodeId>(), std::vector<NodeId>(1, kTarget)),
+               maidsafe_error);
+  std::vector<NodeId> random_targets;
+  for (int i(0); i != 4000; ++i)
+    random_targets.emplace_back(NodeId::kRandomId);
+  for (const auto& owner : owners) {
+    const NodeId kOwnerId(owner.node_id_);
+    std::vector<NodeId> targets;
+    for (const auto& target : random_targets) {
+      auto closer(std::count_if(std::begin(new_matrix), std::end(new_matrix),
+                                [&](const NodeId& node_id) {
+        return NodeId::CloserToTarget(node_id, kOwnerId, target);
+      }));
+      if (closer <= kGroupSize)
+        targets.push_back(target);
+    }
+    ASSERT_FALSE(targets.empty());
+    auto chosen(owner.ChoosePmidNodes(sorted_pmids, targets));
+    ASSERT_EQ(targets.size(), chosen.size());
+    std::set<NodeId> distinct_choices;
+    for (size_t i(0); i != targets.size(); ++i) {
+      ASSERT_EQ(owner.ChoosePmidNode(online_pmids, targets[i]), chosen[i]);
+      distinct_choices.insert(chosen[i]);
+    }
+    // The targets put the owner at different ranks, so not every target gets the same pmid.
+    EXPECT_GT(distinct_choices.size(), 1U);
+  }
 }
 
 }  // namespace test
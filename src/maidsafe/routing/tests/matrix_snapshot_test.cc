@@ -0,0 +1,117 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/matrix_snapshot.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+// A region of the tests' own, so that neither a running network_viewer nor nodes publishing to its
+// region, nor another run of these tests, can interfere.
+std::string TestRegionName() {
+  return std::string(kMatrixSnapshotRegionName) + "_test_" + RandomAlphaNumericString(8);
+}
+
+}  // unnamed namespace
+
+TEST(MatrixSnapshotTest, BEH_WritersNeedReader) {
+  const std::string kRegionName(TestRegionName());
+  { MatrixSnapshotReader reader(kRegionName); }  // removes the region on destruction
+  EXPECT_THROW(MatrixSnapshotWriter(NodeId(NodeId::kRandomId), kRegionName), std::exception);
+}
+
+TEST(MatrixSnapshotTest, BEH_ReadsPublishedSnapshots) {
+  const std::string kRegionName(TestRegionName());
+  MatrixSnapshotReader reader(kRegionName);
+  std::vector<MatrixSnapshot> snapshots;
+  EXPECT_FALSE(reader.Read(snapshots));
+  EXPECT_TRUE(snapshots.empty());
+
+  const NodeId kNodeId(NodeId::kRandomId), kPeerId(NodeId::kRandomId);
+  {
+    MatrixSnapshotWriter writer(kNodeId, kRegionName);
+    EXPECT_TRUE(reader.Read(snapshots));
+    ASSERT_EQ(1U, snapshots.size());
+    EXPECT_EQ(kNodeId, snapshots.front().node_id);
+    EXPECT_TRUE(snapshots.front().entries.empty());
+
+    writer.Publish(MatrixEntries(1, std::make_pair(kPeerId, MatrixEntryType::kGroup)));
+    EXPECT_TRUE(reader.Read(snapshots));
+    ASSERT_EQ(1U, snapshots.size());
+    ASSERT_EQ(1U, snapshots.front().entries.size());
+    EXPECT_EQ(kPeerId, snapshots.front().entries.front().first);
+    EXPECT_EQ(MatrixEntryType::kGroup, snapshots.front().entries.front().second);
+    // Unchanged snapshots are still returned.
+    EXPECT_FALSE(reader.Read(snapshots));
+    EXPECT_EQ(1U, snapshots.size());
+  }
+  EXPECT_TRUE(reader.Read(snapshots));
+  EXPECT_TRUE(snapshots.empty());
+}
+
+TEST(MatrixSnapshotTest, FUNC_ReadsAreConsistentWhileWriting) {
+  const std::string kRegionName(TestRegionName());
+  MatrixSnapshotReader reader(kRegionName);
+  const NodeId kNodeId(NodeId::kRandomId), kPeerId(NodeId::kRandomId);
+  MatrixSnapshotWriter writer(kNodeId, kRegionName);
+  std::vector<MatrixSnapshot> snapshots;
+  ASSERT_TRUE(reader.Read(snapshots));
+  std::atomic<bool> stop(false);
+  std::thread publisher([&] {
+    MatrixEntries large(100, std::make_pair(kPeerId, MatrixEntryType::kMatrix));
+    MatrixEntries small(3, std::make_pair(kNodeId, MatrixEntryType::kClosest));
+    while (!stop) {
+      writer.Publish(large);
+      writer.Publish(small);
+    }
+  });
+  for (int i(0); i != 10000; ++i) {
+    reader.Read(snapshots);
+    EXPECT_EQ(1U, snapshots.size());
+    if (snapshots.empty())
+      break;
+    const auto& entries(snapshots.front().entries);
+    if (entries.size() == 100) {
+      EXPECT_EQ(kPeerId, entries.back().first);
+    } else if (!entries.empty()) {
+      EXPECT_EQ(3U, entries.size());
+      EXPECT_EQ(MatrixEntryType::kClosest, entries.back().second);
+    }
+  }
+  stop = true;
+  publisher.join();
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
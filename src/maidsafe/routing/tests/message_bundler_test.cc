@@ -0,0 +1,138 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/rudp/return_codes.h"
+
+#include "maidsafe/routing/message_bundler.h"
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+std::string SerialisedMessage(int32_t id, size_t data_size) {
+  protobuf::Message message;
+  message.set_routing_message(true);
+  message.set_direct(true);
+  message.set_client_node(false);
+  message.set_request(true);
+  message.set_hops_to_live(10);
+  message.set_id(id);
+  message.set_destination_id(NodeId(NodeId::kRandomId).string());
+  message.add_data(RandomString(data_size));
+  return message.SerializeAsString();
+}
+
+}  // unnamed namespace
+
+TEST(MessageBundlerTest, BEH_BundlesPerPeer) {
+  MessageBundler bundler(1024, 16 * 1024);
+  NodeId peer(NodeId::kRandomId), other_peer(NodeId::kRandomId);
+  std::vector<std::string> sent;
+  int results(0);
+  auto count_result([&results](int result) {
+    if (result == rudp::kSuccess)
+      ++results;
+  });
+  std::vector<MessageBundler::Send> ready;
+  for (int32_t i(0); i != 3; ++i) {
+    sent.push_back(SerialisedMessage(i, 100));
+    EXPECT_EQ(i == 0, bundler.Add(peer, sent.back(), count_result, ready));
+  }
+  std::string lone(SerialisedMessage(3, 100));
+  EXPECT_FALSE(bundler.Add(other_peer, lone, count_result, ready));
+  EXPECT_TRUE(ready.empty());
+
+  std::vector<MessageBundler::Send> sends(bundler.TakeAll());
+  ASSERT_EQ(2U, sends.size());
+  EXPECT_TRUE(bundler.TakeAll().empty());
+  for (const auto& send : sends) {
+    std::vector<std::string> messages;
+    if (send.peer_id == peer) {
+      ASSERT_TRUE(MessageBundler::Unbundle(send.serialised, messages));
+      EXPECT_EQ(sent, messages);
+    } else {
+      EXPECT_EQ(other_peer, send.peer_id);
+      EXPECT_FALSE(MessageBundler::Unbundle(send.serialised, messages));
+      EXPECT_EQ(lone, send.serialised);
+    }
+    send.message_sent_functor(rudp::kSuccess);
+  }
+  // Each message's own functor hears the result.
+  EXPECT_EQ(4, results);
+}
+
+TEST(MessageBundlerTest, BEH_LargeMessagesAndFullBundlesGoAtOnce) {
+  MessageBundler bundler(1024, 2048);
+  NodeId peer(NodeId::kRandomId);
+  std::vector<MessageBundler::Send> ready;
+  std::string large(SerialisedMessage(0, 2000));
+  EXPECT_FALSE(bundler.Add(peer, large, nullptr, ready));
+  ASSERT_EQ(1U, ready.size());
+  EXPECT_EQ(large, ready.front().serialised);
+  EXPECT_TRUE(bundler.TakeAll().empty());
+
+  // The third doesn't fit with the first two, which go as one bundle.
+  ready.clear();
+  EXPECT_TRUE(bundler.Add(peer, SerialisedMessage(1, 800), nullptr, ready));
+  EXPECT_FALSE(bundler.Add(peer, SerialisedMessage(2, 800), nullptr, ready));
+  EXPECT_TRUE(ready.empty());
+  EXPECT_FALSE(bundler.Add(peer, SerialisedMessage(3, 800), nullptr, ready));
+  ASSERT_EQ(1U, ready.size());
+  EXPECT_LE(ready.front().serialised.size(), 2048U);
+  std::vector<std::string> messages;
+  ASSERT_TRUE(MessageBundler::Unbundle(ready.front().serialised, messages));
+  EXPECT_EQ(2U, messages.size());
+  ASSERT_EQ(1U, bundler.TakeAll().size());
+}
+
+TEST(MessageBundlerTest, BEH_LargeMessageDoesntOvertakeHeldOnes) {
+  MessageBundler bundler(1024, 2048);
+  NodeId peer(NodeId::kRandomId), other_peer(NodeId::kRandomId);
+  std::vector<MessageBundler::Send> ready;
+  std::string small(SerialisedMessage(0, 100)), other(SerialisedMessage(1, 100)),
+      large(SerialisedMessage(2, 2000));
+  EXPECT_TRUE(bundler.Add(peer, small, nullptr, ready));
+  EXPECT_FALSE(bundler.Add(other_peer, other, nullptr, ready));
+  EXPECT_FALSE(bundler.Add(peer, large, nullptr, ready));
+  ASSERT_EQ(2U, ready.size());
+  EXPECT_EQ(small, ready.front().serialised);
+  EXPECT_EQ(large, ready.back().serialised);
+
+  // Only the other peer's message is left held.
+  std::vector<MessageBundler::Send> sends(bundler.TakeAll());
+  ASSERT_EQ(1U, sends.size());
+  EXPECT_EQ(other_peer, sends.front().peer_id);
+  EXPECT_EQ(other, sends.front().serialised);
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,103 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <string>
+#include <vector>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/message_capture.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(MessageCaptureTest, BEH_RoundTrip) {
+  maidsafe::test::TestPath test_path(maidsafe::test::CreateTestPath("MaidSafe_TestCapture"));
+  const boost::filesystem::path kCapturePath(*test_path / "capture");
+  const NodeId kNodeId(NodeId::kRandomId), kConnectionId(NodeId::kRandomId);
+  const std::string kLarge(RandomString(MessageCaptureWriter::kFlushSize + 1));
+  {
+    MessageCaptureWriter writer(kCapturePath, kNodeId, 1);
+    writer.Record(CaptureDirection::kReceived, kConnectionId, "received");
+    writer.Record(CaptureDirection::kSent, kConnectionId, "sent");
+    writer.Record(CaptureDirection::kReceived, NodeId(), "");
+    writer.Record(CaptureDirection::kSent, kConnectionId, kLarge);  // flushes
+    writer.Record(CaptureDirection::kReceived, NodeId(), "last");  // written on destruction
+  }
+
+  MessageCaptureReader reader(kCapturePath);
+  EXPECT_EQ(kNodeId, reader.node_id());
+  std::vector<CapturedMessage> messages;
+  CapturedMessage message;
+  while (reader.Next(message))
+    messages.push_back(message);
+  ASSERT_EQ(5U, messages.size());
+  EXPECT_EQ(CaptureDirection::kReceived, messages[0].direction);
+  EXPECT_EQ(NodeId(), messages[0].connection_id);  // only kept for sent messages
+  EXPECT_EQ("received", messages[0].serialised);
+  EXPECT_EQ(CaptureDirection::kSent, messages[1].direction);
+  EXPECT_EQ(kConnectionId, messages[1].connection_id);
+  EXPECT_EQ("sent", messages[1].serialised);
+  EXPECT_TRUE(messages[2].serialised.empty());
+  EXPECT_EQ(kLarge, messages[3].serialised);
+  EXPECT_EQ("last", messages[4].serialised);
+  for (size_t i(1); i != messages.size(); ++i)
+    EXPECT_LE(messages[i - 1].offset, messages[i].offset);
+
+  // A capture cut short, as by a crash, yields the records before the cut.
+  std::string contents;
+  ASSERT_TRUE(ReadFile(kCapturePath, &contents));
+  ASSERT_TRUE(WriteFile(kCapturePath, contents.substr(0, contents.size() - 2)));
+  MessageCaptureReader truncated_reader(kCapturePath);
+  size_t count(0);
+  while (truncated_reader.Next(message))
+    ++count;
+  EXPECT_EQ(4U, count);
+
+  ASSERT_TRUE(WriteFile(kCapturePath, "not a capture"));
+  EXPECT_THROW(MessageCaptureReader bad_reader(kCapturePath), std::exception);
+}
+
+TEST(MessageCaptureTest, BEH_Sampling) {
+  maidsafe::test::TestPath test_path(maidsafe::test::CreateTestPath("MaidSafe_TestCapture"));
+  const boost::filesystem::path kCapturePath(*test_path / "capture");
+  {
+    MessageCaptureWriter writer(kCapturePath, NodeId(NodeId::kRandomId), 3);
+    for (int i(0); i != 10; ++i)
+      writer.Record(CaptureDirection::kReceived, NodeId(), std::to_string(i));
+  }
+  MessageCaptureReader reader(kCapturePath);
+  std::vector<std::string> recorded;
+  CapturedMessage message;
+  while (reader.Next(message))
+    recorded.push_back(message.serialised);
+  EXPECT_EQ((std::vector<std::string>{"0", "3", "6", "9"}), recorded);
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
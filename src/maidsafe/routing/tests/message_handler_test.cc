@@ -17,6 +17,8 @@
     use of the MaidSafe Software.                                                                 */
 
 #include <chrono>
+#include <memory>
+#include <string>
 
 #include "maidsafe/common/asio_service.h"
 #include "maidsafe/common/utils.h"
@@ -33,10 +35,12 @@
 #include "maidsafe/routing/tests/test_utils.h"
 #include "maidsafe/routing/client_routing_table.h"
 #include "maidsafe/routing/group_change_handler.h"
+#include "maidsafe/routing/metrics.h"
 #include "maidsafe/routing/parameters.h"
 #include "maidsafe/routing/routing.pb.h"
 #include "maidsafe/routing/routing_table.h"
 #include "maidsafe/routing/timer.h"
+#include "maidsafe/routing/utils.h"
 
 namespace maidsafe {
 
@@ -73,7 +77,7 @@ class MessageHandlerTest : public testing::Test {
     table_.reset(
         new MockRoutingTable(false, node_id, asymm::GenerateKeyPair(), *network_statistics_));
     ntable_.reset(new ClientRoutingTable(table_->kNodeId()));
-    utils_.reset(new MockNetworkUtils(*table_, *ntable_));
+    utils_.reset(new MockNetworkUtils(*table_, *ntable_, asio_service_));
     group_change_handler_.reset(new GroupChangeHandler(*table_, *ntable_, *utils_));
     service_.reset(new MockService(*table_, *ntable_, *utils_));
     response_handler_.reset(
@@ -280,28 +284,31 @@ TEST_F(MessageHandlerTest, BEH_HandleGroupMessage) {
                        [&](const NodeId & node_id) { return node_id == close_info_.node_id; }),
         closest_nodes.end());
     EXPECT_CALL(*utils_, SendToClosestNode(testing::_)).Times(0);
-    EXPECT_CALL(*utils_,
-                SendToDirect(testing::AllOf(testing::Property(&protobuf::Message::destination_id,
-                                                              closest_nodes.at(0).string()),
-                                            testing::Property(&protobuf::Message::direct, true),
-                                            testing::Property(&protobuf::Message::request, true)),
-                             testing::_, testing::_))
+    EXPECT_CALL(*utils_, SendEncodedToDirect(
+                             testing::AllOf(
+                                 testing::Property(&protobuf::Message::destination_id,
+                                                   closest_nodes.at(0).string()),
+                                 testing::Property(&protobuf::Message::direct, true),
+                                 testing::Property(&protobuf::Message::request, true)),
+                             testing::_, testing::_, testing::_))
         .Times(1)
         .RetiresOnSaturation();
-    EXPECT_CALL(*utils_,
-                SendToDirect(testing::AllOf(testing::Property(&protobuf::Message::destination_id,
-                                                              closest_nodes.at(1).string()),
-                                            testing::Property(&protobuf::Message::direct, true),
-                                            testing::Property(&protobuf::Message::request, true)),
-                             testing::_, testing::_))
+    EXPECT_CALL(*utils_, SendEncodedToDirect(
+                             testing::AllOf(
+                                 testing::Property(&protobuf::Message::destination_id,
+                                                   closest_nodes.at(1).string()),
+                                 testing::Property(&protobuf::Message::direct, true),
+                                 testing::Property(&protobuf::Message::request, true)),
+                             testing::_, testing::_, testing::_))
         .Times(1)
         .RetiresOnSaturation();
-    EXPECT_CALL(*utils_,
-                SendToDirect(testing::AllOf(testing::Property(&protobuf::Message::destination_id,
-                                                              closest_nodes.at(2).string()),
-                                            testing::Property(&protobuf::Message::direct, true),
-                                            testing::Property(&protobuf::Message::request, true)),
-                             testing::_, testing::_))
+    EXPECT_CALL(*utils_, SendEncodedToDirect(
+                             testing::AllOf(
+                                 testing::Property(&protobuf::Message::destination_id,
+                                                   closest_nodes.at(2).string()),
+                                 testing::Property(&protobuf::Message::direct, true),
+                                 testing::Property(&protobuf::Message::request, true)),
+                             testing::_, testing::_, testing::_))
         .Times(1)
         .RetiresOnSaturation();
     //    EXPECT_CALL(*table_, IsNodeIdInGroupRange(testing::_, testing::_)).Times(1);
@@ -358,28 +365,31 @@ TEST_F(MessageHandlerTest, BEH_HandleGroupMessage) {
     NodeId destination_id(GenerateUniqueRandomId(table_->kNodeId(), 4));
     std::vector<NodeId> closest_nodes(table_->GetClosestNodes(table_->kNodeId(), 4));
     EXPECT_CALL(*utils_, SendToClosestNode(testing::_)).Times(0);
-    EXPECT_CALL(*utils_,
-                SendToDirect(testing::AllOf(testing::Property(&protobuf::Message::destination_id,
-                                                              closest_nodes.at(0).string()),
-                                            testing::Property(&protobuf::Message::direct, true),
-                                            testing::Property(&protobuf::Message::request, true)),
-                             testing::_, testing::_))
+    EXPECT_CALL(*utils_, SendEncodedToDirect(
+                             testing::AllOf(
+                                 testing::Property(&protobuf::Message::destination_id,
+                                                   closest_nodes.at(0).string()),
+                                 testing::Property(&protobuf::Message::direct, true),
+                                 testing::Property(&protobuf::Message::request, true)),
+                             testing::_, testing::_, testing::_))
         .Times(1)
         .RetiresOnSaturation();
-    EXPECT_CALL(*utils_,
-                SendToDirect(testing::AllOf(testing::Property(&protobuf::Message::destination_id,
-                                                              closest_nodes.at(1).string()),
-                                            testing::Property(&protobuf::Message::direct, true),
-                                            testing::Property(&protobuf::Message::request, true)),
-                             testing::_, testing::_))
+    EXPECT_CALL(*utils_, SendEncodedToDirect(
+                             testing::AllOf(
+                                 testing::Property(&protobuf::Message::destination_id,
+                                                   closest_nodes.at(1).string()),
+                                 testing::Property(&protobuf::Message::direct, true),
+                                 testing::Property(&protobuf::Message::request, true)),
+                             testing::_, testing::_, testing::_))
         .Times(1)
         .RetiresOnSaturation();
-    EXPECT_CALL(*utils_,
-                SendToDirect(testing::AllOf(testing::Property(&protobuf::Message::destination_id,
-                                                              closest_nodes.at(2).string()),
-                                            testing::Property(&protobuf::Message::direct, true),
-                                            testing::Property(&protobuf::Message::request, true)),
-                             testing::_, testing::_))
+    EXPECT_CALL(*utils_, SendEncodedToDirect(
+                             testing::AllOf(
+                                 testing::Property(&protobuf::Message::destination_id,
+                                                   closest_nodes.at(2).string()),
+                                 testing::Property(&protobuf::Message::direct, true),
+                                 testing::Property(&protobuf::Message::request, true)),
+                             testing::_, testing::_, testing::_))
         .Times(1)
         .RetiresOnSaturation();
     EXPECT_CALL(*service_, FindNodes(testing::_))
@@ -416,28 +426,31 @@ TEST_F(MessageHandlerTest, BEH_HandleGroupMessage) {
                     testing::Property(&protobuf::Message::destination_id, source_id.string()))))
         .Times(1)
         .RetiresOnSaturation();
-    EXPECT_CALL(*utils_,
-                SendToDirect(testing::AllOf(testing::Property(&protobuf::Message::destination_id,
-                                                              closest_nodes.at(0).string()),
-                                            testing::Property(&protobuf::Message::direct, true),
-                                            testing::Property(&protobuf::Message::request, true)),
-                             testing::_, testing::_))
+    EXPECT_CALL(*utils_, SendEncodedToDirect(
+                             testing::AllOf(
+                                 testing::Property(&protobuf::Message::destination_id,
+                                                   closest_nodes.at(0).string()),
+                                 testing::Property(&protobuf::Message::direct, true),
+                                 testing::Property(&protobuf::Message::request, true)),
+                             testing::_, testing::_, testing::_))
         .Times(1)
         .RetiresOnSaturation();
-    EXPECT_CALL(*utils_,
-                SendToDirect(testing::AllOf(testing::Property(&protobuf::Message::destination_id,
-                                                              closest_nodes.at(1).string()),
-                                            testing::Property(&protobuf::Message::direct, true),
-                                            testing::Property(&protobuf::Message::request, true)),
-                             testing::_, testing::_))
+    EXPECT_CALL(*utils_, SendEncodedToDirect(
+                             testing::AllOf(
+                                 testing::Property(&protobuf::Message::destination_id,
+                                                   closest_nodes.at(1).string()),
+                                 testing::Property(&protobuf::Message::direct, true),
+                                 testing::Property(&protobuf::Message::request, true)),
+                             testing::_, testing::_, testing::_))
         .Times(1)
         .RetiresOnSaturation();
-    EXPECT_CALL(*utils_,
-                SendToDirect(testing::AllOf(testing::Property(&protobuf::Message::destination_id,
-                                                              closest_nodes.at(2).string()),
-                                            testing::Property(&protobuf::Message::direct, true),
-                                            testing::Property(&protobuf::Message::request, true)),
-                             testing::_, testing::_))
+    EXPECT_CALL(*utils_, SendEncodedToDirect(
+                             testing::AllOf(
+                                 testing::Property(&protobuf::Message::destination_id,
+                                                   closest_nodes.at(2).string()),
+                                 testing::Property(&protobuf::Message::direct, true),
+                                 testing::Property(&protobuf::Message::request, true)),
+                             testing::_, testing::_, testing::_))
         .Times(1)
         .RetiresOnSaturation();
     //    EXPECT_CALL(*table_, IsNodeIdInGroupRange(testing::_, testing::_)).Times(1);
@@ -471,28 +484,31 @@ TEST_F(MessageHandlerTest, BEH_HandleGroupMessage) {
     message.set_client_node(true);
     std::vector<NodeId> closest_nodes(table_->GetClosestNodes(table_->kNodeId(), 4));
     EXPECT_CALL(*utils_, SendToClosestNode(testing::_)).Times(0);
-    EXPECT_CALL(*utils_,
-                SendToDirect(testing::AllOf(testing::Property(&protobuf::Message::destination_id,
-                                                              closest_nodes.at(0).string()),
-                                            testing::Property(&protobuf::Message::direct, true),
-                                            testing::Property(&protobuf::Message::request, true)),
-                             testing::_, testing::_))
+    EXPECT_CALL(*utils_, SendEncodedToDirect(
+                             testing::AllOf(
+                                 testing::Property(&protobuf::Message::destination_id,
+                                                   closest_nodes.at(0).string()),
+                                 testing::Property(&protobuf::Message::direct, true),
+                                 testing::Property(&protobuf::Message::request, true)),
+                             testing::_, testing::_, testing::_))
         .Times(1)
         .RetiresOnSaturation();
-    EXPECT_CALL(*utils_,
-                SendToDirect(testing::AllOf(testing::Property(&protobuf::Message::destination_id,
-                                                              closest_nodes.at(1).string()),
-                                            testing::Property(&protobuf::Message::direct, true),
-                                            testing::Property(&protobuf::Message::request, true)),
-                             testing::_, testing::_))
+    EXPECT_CALL(*utils_, SendEncodedToDirect(
+                             testing::AllOf(
+                                 testing::Property(&protobuf::Message::destination_id,
+                                                   closest_nodes.at(1).string()),
+                                 testing::Property(&protobuf::Message::direct, true),
+                                 testing::Property(&protobuf::Message::request, true)),
+                             testing::_, testing::_, testing::_))
         .Times(1)
         .RetiresOnSaturation();
-    EXPECT_CALL(*utils_,
-                SendToDirect(testing::AllOf(testing::Property(&protobuf::Message::destination_id,
-                                                              closest_nodes.at(2).string()),
-                                            testing::Property(&protobuf::Message::direct, true),
-                                            testing::Property(&protobuf::Message::request, true)),
-                             testing::_, testing::_))
+    EXPECT_CALL(*utils_, SendEncodedToDirect(
+                             testing::AllOf(
+                                 testing::Property(&protobuf::Message::destination_id,
+                                                   closest_nodes.at(2).string()),
+                                 testing::Property(&protobuf::Message::direct, true),
+                                 testing::Property(&protobuf::Message::request, true)),
+                             testing::_, testing::_, testing::_))
         .Times(1)
         .RetiresOnSaturation();
     EXPECT_CALL(*service_, FindNodes(testing::_))
@@ -530,28 +546,31 @@ TEST_F(MessageHandlerTest, BEH_HandleGroupMessage) {
                     testing::Property(&protobuf::Message::destination_id, ""))))
         .Times(1)
         .RetiresOnSaturation();
-    EXPECT_CALL(*utils_,
-                SendToDirect(testing::AllOf(testing::Property(&protobuf::Message::destination_id,
-                                                              closest_nodes.at(0).string()),
-                                            testing::Property(&protobuf::Message::direct, true),
-                                            testing::Property(&protobuf::Message::request, true)),
-                             testing::_, testing::_))
+    EXPECT_CALL(*utils_, SendEncodedToDirect(
+                             testing::AllOf(
+                                 testing::Property(&protobuf::Message::destination_id,
+                                                   closest_nodes.at(0).string()),
+                                 testing::Property(&protobuf::Message::direct, true),
+                                 testing::Property(&protobuf::Message::request, true)),
+                             testing::_, testing::_, testing::_))
         .Times(1)
         .RetiresOnSaturation();
-    EXPECT_CALL(*utils_,
-                SendToDirect(testing::AllOf(testing::Property(&protobuf::Message::destination_id,
-                                                              closest_nodes.at(1).string()),
-                                            testing::Property(&protobuf::Message::direct, true),
-                                            testing::Property(&protobuf::Message::request, true)),
-                             testing::_, testing::_))
+    EXPECT_CALL(*utils_, SendEncodedToDirect(
+                             testing::AllOf(
+                                 testing::Property(&protobuf::Message::destination_id,
+                                                   closest_nodes.at(1).string()),
+                                 testing::Property(&protobuf::Message::direct, true),
+                                 testing::Property(&protobuf::Message::request, true)),
+                             testing::_, testing::_, testing::_))
         .Times(1)
         .RetiresOnSaturation();
-    EXPECT_CALL(*utils_,
-                SendToDirect(testing::AllOf(testing::Property(&protobuf::Message::destination_id,
-                                                              closest_nodes.at(2).string()),
-                                            testing::Property(&protobuf::Message::direct, true),
-                                            testing::Property(&protobuf::Message::request, true)),
-                             testing::_, testing::_))
+    EXPECT_CALL(*utils_, SendEncodedToDirect(
+                             testing::AllOf(
+                                 testing::Property(&protobuf::Message::destination_id,
+                                                   closest_nodes.at(2).string()),
+                                 testing::Property(&protobuf::Message::direct, true),
+                                 testing::Property(&protobuf::Message::request, true)),
+                             testing::_, testing::_, testing::_))
         .Times(1)
         .RetiresOnSaturation();
     EXPECT_CALL(*table_, IsNodeIdInGroupRange(testing::_, result))
@@ -632,6 +651,173 @@ TEST_F(MessageHandlerTest, BEH_HandleNodeLevelMessage) {
   }
 }
 
+TEST_F(MessageHandlerTest, BEH_UncompressBeforeUpcall) {
+  MessageHandler message_handler(*table_, *ntable_, *utils_, timer_, *remove_furthest_node_,
+                                 *group_change_handler_, *network_statistics_);
+  std::string payload(1000, 'a'), received;
+  MessageAndCachingFunctors functors;
+  functors.message_received = [&](const std::string & message, const bool & /*cache_lookup*/,
+                                  ReplyFunctor /*reply_functor*/) { received = message; };
+  message_handler.set_message_and_caching_functor(functors);
+
+  protobuf::Message message;
+  message.set_hops_to_live(1);
+  message.set_routing_message(false);
+  message.set_direct(true);
+  message.set_request(true);
+  message.set_client_node(false);
+  message.set_source_id(NodeId(NodeId::kRandomId).string());
+  message.set_destination_id(table_->kNodeId().string());
+  message.set_id(5484);
+  message.add_data(payload);
+  CompressData(message);
+  ASSERT_TRUE(message.compressed());
+  EXPECT_GT(payload.size(), message.data(0).size());
+
+  message_handler.HandleMessage(message);
+  EXPECT_EQ(payload, received);
+}
+
+TEST_F(MessageHandlerTest, BEH_HandleMultipathCopiesOnce) {
+  MessageHandler message_handler(*table_, *ntable_, *utils_, timer_, *remove_furthest_node_,
+                                 *group_change_handler_, *network_statistics_);
+  message_handler.service_ = service_;
+  message_handler.response_handler_ = response_handler_;
+  message_handler.set_message_and_caching_functor(message_and_caching_functor_);
+  protobuf::Message message;
+  message.set_hops_to_live(1);
+  message.set_routing_message(false);
+  message.set_direct(true);
+  message.set_request(true);
+  message.set_client_node(false);
+  message.set_source_id(NodeId(NodeId::kRandomId).string());
+  message.set_destination_id(table_->kNodeId().string());
+  message.set_id(5484);
+  message.set_multipath(true);
+  message.add_data("DATA");
+
+  // Only the first copy is answered.
+  EXPECT_CALL(*utils_, SendToClosestNode(testing::_)).Times(1);
+  for (int copy(0); copy != 3; ++copy) {
+    protobuf::Message copy_message(message);
+    message_handler.HandleMessage(copy_message);
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  EXPECT_TRUE(cond_var_.wait_for(lock, std::chrono::seconds(1), [this]()->bool {
+    return messages_received_ != 0;
+  }));  // NOLINT
+  EXPECT_FALSE(cond_var_.wait_for(lock, std::chrono::milliseconds(100), [this]()->bool {
+    return messages_received_ > 1;
+  }));  // NOLINT
+  EXPECT_EQ(1, messages_received_);
+}
+
+TEST_F(MessageHandlerTest, BEH_DropExpiredMessage) {
+  MessageHandler message_handler(*table_, *ntable_, *utils_, timer_, *remove_furthest_node_,
+                                 *group_change_handler_, *network_statistics_);
+  message_handler.service_ = service_;
+  message_handler.response_handler_ = response_handler_;
+  message_handler.set_message_and_caching_functor(message_and_caching_functor_);
+  Metrics metrics;
+  message_handler.set_metrics(&metrics);
+  protobuf::Message message;
+  message.set_hops_to_live(1);
+  message.set_routing_message(false);
+  message.set_direct(true);
+  message.set_request(true);
+  message.set_client_node(false);
+  message.set_source_id(NodeId(NodeId::kRandomId).string());
+  message.set_destination_id(table_->kNodeId().string());
+  message.set_id(7301);
+  message.add_data("DATA");
+
+  // Neither handled nor passed on once its requester has stopped waiting.
+  EXPECT_CALL(*utils_, SendToClosestNode(testing::_)).Times(0);
+  protobuf::Message expired(message);
+  expired.set_time_left(0);
+  message_handler.HandleMessage(expired);
+  MetricsSnapshot snapshot;
+  metrics.Snapshot(snapshot);
+  EXPECT_EQ(1U, snapshot.drops.at(static_cast<size_t>(DropReason::kExpired)));
+  std::unique_lock<std::mutex> lock(mutex_);
+  EXPECT_FALSE(cond_var_.wait_for(lock, std::chrono::milliseconds(100), [this]()->bool {
+    return messages_received_ != 0;
+  }));  // NOLINT
+  lock.unlock();
+  testing::Mock::VerifyAndClearExpectations(utils_.get());
+
+  // With time left, the same request is answered.
+  EXPECT_CALL(*utils_, SendToClosestNode(testing::_)).Times(1);
+  message.set_id(7302);
+  message.set_time_left(1000);
+  message_handler.HandleMessage(message);
+  lock.lock();
+  EXPECT_TRUE(cond_var_.wait_for(lock, std::chrono::seconds(1), [this]()->bool {
+    return messages_received_ != 0;
+  }));  // NOLINT
+}
+
+TEST_F(MessageHandlerTest, BEH_PassOnEncodedPayload) {
+  MessageHandler message_handler(*table_, *ntable_, *utils_, timer_, *remove_furthest_node_,
+                                 *group_change_handler_, *network_statistics_);
+  message_handler.service_ = service_;
+  message_handler.response_handler_ = response_handler_;
+  message_handler.set_message_and_caching_functor(message_and_caching_functor_);
+  while (table_->size() < Parameters::group_size) {
+    NodeInfo node_info(MakeNodeInfoAndKeys().node_info);
+    node_info.node_id = GenerateUniqueRandomId(table_->kNodeId(), 20);
+    table_->AddNode(node_info);
+  }
+  protobuf::Message message;
+  message.set_hops_to_live(2);
+  message.set_routing_message(false);
+  message.set_direct(true);
+  message.set_request(true);
+  message.set_client_node(false);
+  message.set_visited(false);
+  message.set_source_id(NodeId(NodeId::kRandomId).string());
+  message.set_id(5485);
+  message.add_data("DATA");
+  message.set_signature("SIGNATURE");
+
+  {  // Message passing through is sent on with its payload still encoded
+    message.set_destination_id(NodeId(NodeId::kRandomId).string());
+    protobuf::Message header;
+    std::string body;
+    ASSERT_TRUE(ParseMessageHeader(message.SerializeAsString(), header, body));
+    EXPECT_EQ(0, header.data_size());
+    EXPECT_FALSE(header.has_signature());
+    auto encoded_body(std::make_shared<const std::string>(body));
+    EXPECT_CALL(*utils_, SendToClosestNode(testing::_)).Times(0);
+    EXPECT_CALL(*utils_,
+                SendEncodedToClosestNode(
+                    testing::AllOf(testing::Property(&protobuf::Message::data_size, 0),
+                                   testing::Property(&protobuf::Message::hops_to_live, 1)),
+                    encoded_body)).Times(1).RetiresOnSaturation();
+    message_handler.HandleMessage(header, encoded_body);
+
+    protobuf::Message forwarded(header);
+    ASSERT_TRUE(forwarded.MergeFromString(body));
+    EXPECT_EQ("DATA", forwarded.data(0));
+    EXPECT_EQ("SIGNATURE", forwarded.signature());
+  }
+  {  // Message for this node has its payload parsed
+    message.set_destination_id(table_->kNodeId().string());
+    message.set_id(5486);
+    protobuf::Message header;
+    std::string body;
+    ASSERT_TRUE(ParseMessageHeader(message.SerializeAsString(), header, body));
+    EXPECT_CALL(*utils_, SendEncodedToClosestNode(testing::_, testing::_)).Times(0);
+    EXPECT_CALL(*utils_, SendToClosestNode(testing::_)).Times(1).RetiresOnSaturation();
+    message_handler.HandleMessage(header, std::make_shared<const std::string>(body));
+    std::unique_lock<std::mutex> lock(mutex_);
+    EXPECT_TRUE(cond_var_.wait_for(lock, std::chrono::seconds(1), [this]()->bool {
+      return messages_received_ != 0;
+    }));  // NOLINT
+    EXPECT_EQ(1, messages_received_);
+  }
+}
+
 TEST_F(MessageHandlerTest, BEH_ClientRoutingTable) {
   auto maid(MakeMaid());
   asymm::Keys keys;
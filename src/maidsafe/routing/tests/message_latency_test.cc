@@ -0,0 +1,77 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <limits>
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/message_handler.h"
+#include "maidsafe/routing/message_latency.h"
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(MessageLatencyTest, BEH_BucketBounds) {
+  for (size_t index(0); index + 1 != MessageLatency::kBucketCount; ++index) {
+    uint64_t lower_bound(LatencyHistogram::BucketLowerBound(index));
+    EXPECT_LT(lower_bound, LatencyHistogram::BucketLowerBound(index + 1));
+    EXPECT_EQ(index, MessageLatency::BucketIndex(lower_bound));
+    uint64_t upper_bound(LatencyHistogram::BucketLowerBound(index + 1) - 1);
+    EXPECT_EQ(index, MessageLatency::BucketIndex(upper_bound));
+  }
+  EXPECT_EQ(MessageLatency::kBucketCount - 1,
+            MessageLatency::BucketIndex(std::numeric_limits<uint64_t>::max()));
+}
+
+TEST(MessageLatencyTest, BEH_RecordsFirstMarkInScope) {
+  MessageLatency message_latency;
+  MessageLatency::Mark(MessageStage::kValidated);  // no scope, so not recorded
+  EXPECT_TRUE(message_latency.Histograms().empty());
+
+  protobuf::Message message;
+  message.set_type(static_cast<int32_t>(MessageType::kFindNodes));
+  message.set_source_id(NodeId(NodeId::kRandomId).string());
+  message.set_direct(false);
+  {
+    MessageLatency::Scope scope(message_latency, message, MessageLatency::Clock::now());
+    MessageLatency::Mark(MessageStage::kValidated);
+    MessageLatency::Mark(MessageStage::kSent);
+    MessageLatency::Mark(MessageStage::kSent);
+  }
+  MessageLatency::Mark(MessageStage::kUpcall);
+
+  auto histograms(message_latency.Histograms());
+  ASSERT_EQ(2U, histograms.size());
+  for (const auto& histogram : histograms) {
+    EXPECT_EQ(static_cast<int32_t>(MessageType::kFindNodes), histogram.message_type);
+    EXPECT_EQ(DestinationClass::kGroup, histogram.destination_class);
+    EXPECT_EQ(1U, histogram.count());
+  }
+  EXPECT_EQ(MessageStage::kValidated, histograms[0].stage);
+  EXPECT_EQ(MessageStage::kSent, histograms[1].stage);
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
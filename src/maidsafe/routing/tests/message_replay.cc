@@ -0,0 +1,119 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/tests/message_replay.h"
+
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/rsa.h"
+
+#include "maidsafe/routing/client_routing_table.h"
+#include "maidsafe/routing/group_change_handler.h"
+#include "maidsafe/routing/message_capture.h"
+#include "maidsafe/routing/message_handler.h"
+#include "maidsafe/routing/network_statistics.h"
+#include "maidsafe/routing/remove_furthest_node.h"
+#include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/routing_table.h"
+#include "maidsafe/routing/timer.h"
+#include "maidsafe/routing/utils.h"
+#include "maidsafe/routing/tests/mock_network_utils.h"
+#include "maidsafe/routing/tests/test_utils.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+ReplayReport ReplayCapture(const boost::filesystem::path& path, double speed) {
+  typedef std::chrono::steady_clock Clock;
+  // The whole capture is read before replaying, so that reading it isn't timed.
+  MessageCaptureReader reader(path);
+  std::vector<CapturedMessage> received;
+  std::set<NodeId> peers;
+  CapturedMessage captured;
+  while (reader.Next(captured)) {
+    if (captured.direction == CaptureDirection::kSent)
+      peers.insert(captured.connection_id);
+    else
+      received.push_back(captured);
+  }
+
+  const NodeId kNodeId(reader.node_id());
+  NetworkStatistics network_statistics(kNodeId);
+  RoutingTable routing_table(false, kNodeId, asymm::GenerateKeyPair(), network_statistics);
+  ClientRoutingTable client_routing_table(kNodeId);
+  AsioService asio_service(2);
+  testing::NiceMock<MockNetworkUtils> network(routing_table, client_routing_table, asio_service);
+  Timer<std::string> timer(asio_service);
+  RemoveFurthestNode remove_furthest_node(routing_table, network);
+  GroupChangeHandler group_change_handler(routing_table, client_routing_table, network);
+  for (const auto& peer : peers) {
+    NodeInfo node_info(MakeNode());
+    node_info.node_id = peer;
+    node_info.connection_id = peer;
+    routing_table.AddNode(node_info);
+  }
+  MessageHandler message_handler(routing_table, client_routing_table, network, timer,
+                                 remove_furthest_node, group_change_handler, network_statistics);
+  MessageAndCachingFunctors functors;
+  functors.message_received = [](const std::string&, bool, ReplyFunctor) {};  // NOLINT
+  functors.have_cache_data = [](std::string&) { return false; };  // NOLINT
+  functors.store_cache_data = [](const std::string&) {};  // NOLINT
+  message_handler.set_message_and_caching_functor(functors);
+
+  ReplayReport report;
+  report.received = received.size();
+  const auto kStart(Clock::now());
+  for (const auto& message : received) {
+    if (speed > 0.0) {
+      std::this_thread::sleep_until(
+          kStart + std::chrono::duration_cast<Clock::duration>(
+                       std::chrono::duration<double, std::micro>(
+                           static_cast<double>(message.offset.count()) / speed)));
+    }
+    // Messages are captured once unbundled, so each record is a single message.
+    protobuf::Message header;
+    auto encoded_body(std::make_shared<std::string>());
+    if (!ParseMessageHeader(message.serialised, header, *encoded_body)) {
+      ++report.unparsed;
+      continue;
+    }
+    if (encoded_body->empty())
+      encoded_body.reset();
+    const auto kHandleStart(Clock::now());
+    message_handler.HandleMessage(header, encoded_body);
+    report.handling += Clock::now() - kHandleStart;
+    ++report.handled;
+  }
+  report.elapsed = Clock::now() - kStart;
+  return report;
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
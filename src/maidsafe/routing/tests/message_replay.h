@@ -0,0 +1,55 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_TESTS_MESSAGE_REPLAY_H_
+#define MAIDSAFE_ROUTING_TESTS_MESSAGE_REPLAY_H_
+
+#include <chrono>
+#include <cstdint>
+
+#include "boost/filesystem/path.hpp"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+struct ReplayReport {
+  ReplayReport() : received(0), handled(0), unparsed(0), elapsed(), handling() {}
+  uint64_t received;  // received messages in the capture
+  uint64_t handled;   // those given to the message handler
+  uint64_t unparsed;  // those which failed to parse
+  // From the first message to the last, and spent in MessageHandler::HandleMessage.
+  std::chrono::steady_clock::duration elapsed, handling;
+};
+
+// Feeds the messages received in a capture written by MessageCaptureWriter to a MessageHandler
+// with the capturing node's ID, in the order they were received.  The handler's routing table
+// holds each peer the node sent to, so messages take the paths they did, but its sends go to a
+// MockNetworkUtils and so nowhere.  With speed 0 messages are handled back to back; otherwise the
+// capture's timing is kept, sped up by speed.  Throws if the capture can't be read.
+ReplayReport ReplayCapture(const boost::filesystem::path& path, double speed);
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_TESTS_MESSAGE_REPLAY_H_
@@ -0,0 +1,226 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/message_stream.h"
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/timer.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+protobuf::Message MakeFrame(const NodeId& source_id, int32_t stream_id, uint32_t frame,
+                            uint32_t frame_count, const std::string& data) {
+  protobuf::Message message;
+  message.set_source_id(source_id.string());
+  message.set_stream_id(stream_id);
+  message.set_stream_frame(frame);
+  message.set_stream_frame_count(frame_count);
+  message.add_data(data);
+  return message;
+}
+
+}  // unnamed namespace
+
+typedef StreamReassembler::Result Result;
+
+TEST(MessageStreamTest, BEH_ReassembleOutOfOrder) {
+  StreamReassembler reassembler(std::chrono::seconds(10), 4, 1024, 4096);
+  NodeId source_id(NodeId::kRandomId);
+  protobuf::Message frame(MakeFrame(source_id, 1, 2, 3, "ghi"));
+  EXPECT_EQ(Result::kHeld, reassembler.Add(frame));
+  frame = MakeFrame(source_id, 1, 0, 3, "abc");
+  EXPECT_EQ(Result::kHeld, reassembler.Add(frame));
+  frame = MakeFrame(source_id, 1, 0, 3, "abc");
+  EXPECT_EQ(Result::kHeld, reassembler.Add(frame));  // duplicate
+  frame = MakeFrame(source_id, 1, 3, 3, "jkl");
+  EXPECT_EQ(Result::kDropped, reassembler.Add(frame));  // out of range
+  frame = MakeFrame(source_id, 1, 0, 2, "abc");
+  EXPECT_EQ(Result::kDropped, reassembler.Add(frame));  // wrong frame count
+  frame = MakeFrame(source_id, 1, 1, 3, "def");
+  ASSERT_EQ(Result::kComplete, reassembler.Add(frame));
+  ASSERT_EQ(1, frame.data_size());
+  EXPECT_EQ("abcdefghi", frame.data(0));
+
+  // A stream from another sender with the same ID is separate.
+  frame = MakeFrame(NodeId(NodeId::kRandomId), 1, 0, 2, "abc");
+  EXPECT_EQ(Result::kHeld, reassembler.Add(frame));
+  frame = MakeFrame(source_id, 1, 0, 1, "xyz");
+  EXPECT_EQ(Result::kComplete, reassembler.Add(frame));
+  EXPECT_EQ("xyz", frame.data(0));
+}
+
+TEST(MessageStreamTest, BEH_ReassemblerLimits) {
+  StreamReassembler reassembler(std::chrono::milliseconds(50), 1, 8, 1024);
+  NodeId source_id(NodeId::kRandomId);
+  protobuf::Message frame(MakeFrame(source_id, 1, 0, 2, "abcd"));
+  EXPECT_EQ(Result::kHeld, reassembler.Add(frame));
+  frame = MakeFrame(source_id, 2, 0, 1, "abcd");
+  // only one incomplete stream may be held
+  EXPECT_EQ(Result::kDropped, reassembler.Add(frame));
+
+  // Stale streams are discarded.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  frame = MakeFrame(source_id, 1, 1, 2, "efgh");
+  EXPECT_EQ(Result::kHeld, reassembler.Add(frame));
+  frame = MakeFrame(source_id, 1, 0, 2, "abcd");
+  ASSERT_EQ(Result::kComplete, reassembler.Add(frame));
+  EXPECT_EQ("abcdefgh", frame.data(0));
+
+  // Streams larger than the limit are dropped.
+  frame = MakeFrame(source_id, 3, 0, 2, "abcd");
+  EXPECT_EQ(Result::kHeld, reassembler.Add(frame));
+  frame = MakeFrame(source_id, 3, 1, 2, "efghi");
+  EXPECT_EQ(Result::kDropped, reassembler.Add(frame));
+  frame = MakeFrame(source_id, 3, 0, 2, "abcd");
+  EXPECT_EQ(Result::kHeld, reassembler.Add(frame));  // the dropped stream starts afresh
+}
+
+TEST(MessageStreamTest, BEH_ReassemblerTotalLimit) {
+  StreamReassembler reassembler(std::chrono::seconds(10), 4, 8, 10);
+  NodeId source_id(NodeId::kRandomId);
+  protobuf::Message frame(MakeFrame(source_id, 1, 0, 2, "abcd"));
+  EXPECT_EQ(Result::kHeld, reassembler.Add(frame));
+  frame = MakeFrame(source_id, 2, 0, 2, "abcd");
+  EXPECT_EQ(Result::kHeld, reassembler.Add(frame));
+  frame = MakeFrame(source_id, 3, 0, 2, "abcd");
+  EXPECT_EQ(Result::kDropped, reassembler.Add(frame));  // 12 bytes would be held
+  frame = MakeFrame(source_id, 2, 1, 2, "ef");
+  EXPECT_EQ(Result::kComplete, reassembler.Add(frame));
+  EXPECT_EQ("abcdef", frame.data(0));
+
+  // The completed stream's bytes are no longer counted.
+  frame = MakeFrame(source_id, 3, 0, 2, "abcd");
+  EXPECT_EQ(Result::kHeld, reassembler.Add(frame));
+  frame = MakeFrame(source_id, 4, 0, 2, "abc");
+  EXPECT_EQ(Result::kDropped, reassembler.Add(frame));
+}
+
+TEST(MessageStreamTest, BEH_SenderKeepsWindow) {
+  AsioService asio_service(2);
+  Timer<std::string> timer(asio_service);
+  std::mutex mutex;
+  std::condition_variable cond_var;
+  std::vector<protobuf::Message> frames;
+  bool failed(false);
+  protobuf::Message header;
+  header.set_destination_id(NodeId(NodeId::kRandomId).string());
+  header.set_stream_id(timer.NewTaskId());
+  const std::string kPayload("abcdefghij");
+  auto sender(std::make_shared<StreamSender>(
+      timer, header, kPayload, 3, 2, Parameters::default_response_timeout,
+      [&](protobuf::Message& frame) {
+        std::lock_guard<std::mutex> lock(mutex);
+        frames.push_back(frame);
+        cond_var.notify_all();
+      },
+      [&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        failed = true;
+        cond_var.notify_all();
+      }));
+  sender->Start();
+  std::unique_lock<std::mutex> lock(mutex);
+  ASSERT_EQ(2U, frames.size());
+  for (size_t acknowledged(0); acknowledged != 4; ++acknowledged) {
+    const TaskId kFrameId(frames.at(acknowledged).id());
+    lock.unlock();
+    timer.AddResponse(kFrameId, std::to_string(acknowledged));
+    lock.lock();
+    ASSERT_TRUE(cond_var.wait_for(lock, std::chrono::seconds(1), [&] {
+      return frames.size() == std::min<size_t>(acknowledged + 3, 4);
+    }));
+  }
+  std::string reassembled;
+  for (uint32_t i(0); i != frames.size(); ++i) {
+    EXPECT_EQ(header.stream_id(), frames.at(i).stream_id());
+    EXPECT_EQ(i, frames.at(i).stream_frame());
+    EXPECT_EQ(4U, frames.at(i).stream_frame_count());
+    reassembled += frames.at(i).data(0);
+  }
+  EXPECT_EQ(kPayload, reassembled);
+  EXPECT_FALSE(failed);
+}
+
+TEST(MessageStreamTest, BEH_SenderFailsOnTimeout) {
+  AsioService asio_service(2);
+  Timer<std::string> timer(asio_service);
+  std::mutex mutex;
+  std::condition_variable cond_var;
+  int sent_count(0), failure_count(0);
+  protobuf::Message header;
+  header.set_destination_id(NodeId(NodeId::kRandomId).string());
+  header.set_stream_id(timer.NewTaskId());
+  auto sender(std::make_shared<StreamSender>(
+      timer, header, std::string(10, 'a'), 3, 1, std::chrono::milliseconds(100),
+      [&](protobuf::Message&) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++sent_count;
+      },
+      [&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++failure_count;
+        cond_var.notify_all();
+      }));
+  sender->Start();
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    EXPECT_TRUE(cond_var.wait_for(lock, std::chrono::seconds(2), [&] {
+      return failure_count != 0;
+    }));
+    EXPECT_EQ(1, sent_count);
+    EXPECT_EQ(1, failure_count);
+  }
+}
+
+TEST(MessageStreamTest, BEH_StreamRoutes) {
+  StreamRoutes stream_routes(2);
+  NodeId source_id(NodeId::kRandomId), next_hop(NodeId::kRandomId), found;
+  protobuf::Message first(MakeFrame(source_id, 1, 0, 2, "a")),
+      second(MakeFrame(source_id, 2, 0, 2, "a")), third(MakeFrame(source_id, 3, 0, 2, "a"));
+  EXPECT_FALSE(stream_routes.Get(first, found));
+  stream_routes.Set(first, next_hop);
+  ASSERT_TRUE(stream_routes.Get(first, found));
+  EXPECT_EQ(next_hop, found);
+  stream_routes.Set(second, next_hop);
+  stream_routes.Set(third, next_hop);
+  EXPECT_FALSE(stream_routes.Get(first, found));
+  EXPECT_TRUE(stream_routes.Get(third, found));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,127 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/message_trace.h"
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/route_history.h"
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+class MessageTraceTest : public testing::Test {
+ protected:
+  MessageTraceTest()
+      : kSampleInterval_(Parameters::trace_sample_interval), kNodeId_(NodeId::kRandomId) {
+    MessageTrace::Clear();
+  }
+  ~MessageTraceTest() { Parameters::trace_sample_interval = kSampleInterval_; }
+
+  const uint32_t kSampleInterval_;
+  const NodeId kNodeId_;
+};
+
+TEST_F(MessageTraceTest, BEH_SamplesOneInInterval) {
+  Parameters::trace_sample_interval = 0;
+  protobuf::Message message;
+  for (int i(0); i != 10; ++i)
+    MessageTrace::Sample(message, kNodeId_);
+  EXPECT_FALSE(message.has_trace_id());
+
+  Parameters::trace_sample_interval = 4;
+  int sampled(0);
+  for (int i(0); i != 40; ++i) {
+    message.clear_trace_id();
+    MessageTrace::Sample(message, kNodeId_);
+    if (message.has_trace_id())
+      ++sampled;
+  }
+  EXPECT_EQ(10, sampled);
+  auto events(DumpTraceEvents());
+  ASSERT_EQ(10U, events.size());
+  for (const auto& event : events) {
+    EXPECT_EQ(TraceDecision::kOriginated, event.decision);
+    EXPECT_EQ(RouteHistory::Prefix(kNodeId_), event.node);
+  }
+}
+
+TEST_F(MessageTraceTest, BEH_RecordsOnlyTracedMessages) {
+  protobuf::Message untraced, traced;
+  traced.set_trace_id(0x0123456789abcdefULL);
+  const NodeId kNextHop(NodeId::kRandomId);
+  for (const auto* message : { &untraced, &traced }) {
+    MessageTrace::RecordReceived(*message, kNodeId_, std::chrono::steady_clock::now());
+    MessageTrace::RecordSent(*message, kNodeId_, kNextHop);
+  }
+  // Recorded on another thread, into that thread's buffer.
+  std::thread([&] { MessageTrace::Record(traced, kNextHop, TraceDecision::kDelivered); }).join();
+
+  auto events(DumpTraceEvents());
+  ASSERT_EQ(3U, events.size());
+  EXPECT_EQ(TraceDecision::kReceived, events[0].decision);
+  EXPECT_EQ(TraceDecision::kSent, events[1].decision);
+  EXPECT_EQ(RouteHistory::Prefix(kNextHop), events[1].next_hop);
+  EXPECT_EQ(TraceDecision::kDelivered, events[2].decision);
+  EXPECT_EQ(RouteHistory::Prefix(kNextHop), events[2].node);
+  for (const auto& event : events)
+    EXPECT_EQ(traced.trace_id(), event.trace_id);
+  // The finished thread's buffer was released by the dump.
+  EXPECT_EQ(2U, DumpTraceEvents().size());
+
+  std::ostringstream stream;
+  WriteTraceEvents(std::vector<TraceEvent>(1, events[1]), stream);
+  std::istringstream line(stream.str());
+  std::string trace_id, node, next_hop;
+  uint64_t timestamp(0);
+  int decision(0);
+  uint32_t queue_delay(1);
+  line >> trace_id >> node >> timestamp >> decision >> next_hop >> queue_delay;
+  EXPECT_EQ("0123456789abcdef", trace_id);
+  EXPECT_EQ(16U, node.size());
+  EXPECT_EQ(events[1].timestamp, timestamp);
+  EXPECT_EQ(static_cast<int>(TraceDecision::kSent), decision);
+  EXPECT_EQ(16U, next_hop.size());
+  EXPECT_EQ(0U, queue_delay);
+}
+
+TEST_F(MessageTraceTest, BEH_KeepsLatestEvents) {
+  protobuf::Message message;
+  for (uint64_t i(0); i != MessageTrace::kRingCapacity + 10; ++i) {
+    message.set_trace_id(i);
+    MessageTrace::Record(message, kNodeId_, TraceDecision::kDelivered);
+  }
+  auto events(DumpTraceEvents());
+  ASSERT_EQ(MessageTrace::kRingCapacity, events.size());
+  EXPECT_EQ(10U, events.front().trace_id);
+  EXPECT_EQ(MessageTrace::kRingCapacity + 9, events.back().trace_id);
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
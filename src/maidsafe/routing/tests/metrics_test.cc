@@ -0,0 +1,122 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/metrics.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(MetricsTest, BEH_CountsFromManyThreads) {
+  Metrics metrics;
+  std::vector<std::thread> threads;
+  for (int i(0); i != 8; ++i) {
+    threads.emplace_back([&metrics] {
+      for (int j(0); j != 1000; ++j) {
+        metrics.MessageIn(3);
+        metrics.MessageOut(101);
+        metrics.Delivered(j % 4, j % 2 == 0 ? HopClass::kDirect : HopClass::kGroup);
+      }
+      metrics.Forwarded();
+      metrics.SendRetried();
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  metrics.MessageIn(55);
+  metrics.Dropped(DropReason::kDuplicate);
+  metrics.Delivered(1000, HopClass::kRouting);
+
+  MetricsSnapshot snapshot;
+  metrics.Snapshot(snapshot);
+  EXPECT_EQ(8000U, snapshot.messages_in[3]);
+  EXPECT_EQ(1U, snapshot.messages_in[0]);
+  EXPECT_EQ(8000U, snapshot.messages_out[101]);
+  EXPECT_EQ(1U, snapshot.messages_out.size());
+  EXPECT_EQ(8U, snapshot.forwarded);
+  EXPECT_EQ(8001U, snapshot.delivered);
+  EXPECT_EQ(8U, snapshot.send_retries);
+  EXPECT_EQ(0U, snapshot.send_failures);
+  EXPECT_EQ(1U, snapshot.drops[static_cast<size_t>(DropReason::kDuplicate)]);
+  EXPECT_EQ(2000U, snapshot.hops_taken[0]);
+  EXPECT_EQ(2000U, snapshot.hops_taken[3]);
+  EXPECT_EQ(1U, snapshot.hops_taken.back());
+  ASSERT_EQ(static_cast<size_t>(HopClass::kCount), snapshot.hops_by_class.size());
+  const auto& kDirectHops(snapshot.hops_by_class[static_cast<size_t>(HopClass::kDirect)]);
+  const auto& kGroupHops(snapshot.hops_by_class[static_cast<size_t>(HopClass::kGroup)]);
+  EXPECT_EQ(2000U, kDirectHops[0]);
+  EXPECT_EQ(0U, kDirectHops[1]);
+  EXPECT_EQ(2000U, kGroupHops[3]);
+  EXPECT_EQ(1U, snapshot.hops_by_class[static_cast<size_t>(HopClass::kRouting)].back());
+}
+
+TEST(MetricsTest, BEH_StartupPhases) {
+  Metrics metrics;
+  metrics.StartupPhaseTimed(StartupPhase::kConstruct, std::chrono::milliseconds(3));
+  metrics.StartupPhaseTimed(StartupPhase::kConstruct, std::chrono::milliseconds(5));
+  metrics.StartupPhaseTimed(StartupPhase::kBootstrap, std::chrono::steady_clock::duration(0));
+  MetricsSnapshot snapshot;
+  metrics.Snapshot(snapshot);
+  ASSERT_EQ(static_cast<size_t>(StartupPhase::kCount), snapshot.startup_us.size());
+  EXPECT_EQ(3000U, snapshot.startup_us[static_cast<size_t>(StartupPhase::kConstruct)]);
+  EXPECT_EQ(0U, snapshot.startup_us[static_cast<size_t>(StartupPhase::kMessageHandler)]);
+  EXPECT_EQ(1U, snapshot.startup_us[static_cast<size_t>(StartupPhase::kBootstrap)]);
+  EXPECT_NE(std::string::npos, ToPrometheusText(snapshot, "test").find(
+                                   "test_startup_microseconds{phase=\"construct\"} 3000\n"));
+}
+
+TEST(MetricsTest, BEH_PrometheusText) {
+  Metrics metrics;
+  metrics.MessageIn(2);
+  metrics.Delivered(0, HopClass::kDirect);
+  metrics.Delivered(2, HopClass::kGroup);
+  metrics.Dropped(DropReason::kRouteLoop);
+  MetricsSnapshot snapshot;
+  metrics.Snapshot(snapshot);
+  snapshot.routing_table_size = 12;
+  const std::string kText(ToPrometheusText(snapshot, "test"));
+  EXPECT_NE(std::string::npos, kText.find("test_messages_in_total{type=\"connect\"} 1\n"));
+  EXPECT_NE(std::string::npos, kText.find("# TYPE test_hops_taken histogram\n"));
+  EXPECT_NE(std::string::npos, kText.find("test_hops_taken_bucket{le=\"1\"} 1\n"));
+  EXPECT_NE(std::string::npos, kText.find("test_hops_taken_bucket{le=\"+Inf\"} 2\n"));
+  EXPECT_NE(std::string::npos, kText.find("test_hops_taken_sum 2\n"));
+  EXPECT_NE(std::string::npos, kText.find("test_drops_total{reason=\"overloaded\"} 0\n"));
+  EXPECT_NE(std::string::npos, kText.find("test_drops_total{reason=\"route_loop\"} 1\n"));
+  EXPECT_NE(std::string::npos,
+            kText.find("test_hops_by_class_bucket{class=\"group\",le=\"1\"} 0\n"));
+  EXPECT_NE(std::string::npos,
+            kText.find("test_hops_by_class_bucket{class=\"group\",le=\"2\"} 1\n"));
+  EXPECT_NE(std::string::npos, kText.find("test_hops_by_class_count{class=\"direct\"} 1\n"));
+  EXPECT_NE(std::string::npos,
+            kText.find("# TYPE test_routing_table_size gauge\ntest_routing_table_size 12\n"));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -19,6 +19,7 @@
 #ifndef MAIDSAFE_ROUTING_TESTS_MOCK_NETWORK_UTILS_H_
 #define MAIDSAFE_ROUTING_TESTS_MOCK_NETWORK_UTILS_H_
 
+#include <memory>
 #include <string>
 
 #include "gmock/gmock.h"
@@ -34,13 +35,21 @@ namespace test {
 
 class MockNetworkUtils : public NetworkUtils {
  public:
-  MockNetworkUtils(RoutingTable& routing_table, ClientRoutingTable& client_routing_table);
+  MockNetworkUtils(RoutingTable& routing_table, ClientRoutingTable& client_routing_table,
+                   AsioService& asio_service);
   virtual ~MockNetworkUtils();
 
   MOCK_METHOD1(SendToClosestNode, void(const protobuf::Message& message));
   MOCK_METHOD1(MarkConnectionAsValid, int(const NodeId& peer_id));
   MOCK_METHOD3(SendToDirect, void(const protobuf::Message& message, const NodeId& peer,
                                   const NodeId& connection));
+  MOCK_METHOD4(SendEncodedToDirect,
+               void(const protobuf::Message& header,
+                    std::shared_ptr<const std::string> encoded_body, const NodeId& peer,
+                    const NodeId& connection));
+  MOCK_METHOD2(SendEncodedToClosestNode,
+               void(const protobuf::Message& header,
+                    std::shared_ptr<const std::string> encoded_body));
   MOCK_METHOD3(Add, int(const NodeId& peer_id, const rudp::EndpointPair& peer_endpoint_pair,
                         const std::string& validation_data));
   MOCK_METHOD4(GetAvailableEndpoint,
@@ -16,9 +16,11 @@
     See the Licences for the specific language governing permissions and limitations relating to
     use of the MaidSafe Software.                                                                 */
 
+#include <algorithm>
 #include <bitset>
 #include <memory>
 #include <numeric>
+#include <string>
 #include <vector>
 
 #include "maidsafe/common/node_id.h"
@@ -43,7 +45,7 @@ TEST(NetworkStatisticsTest, BEH_AverageDistance) {
   EXPECT_EQ(network_statistics.network_distance_data_.average_distance, average);
 
   node_id = NodeId();
-  network_statistics.network_distance_data_.total_distance = crypto::BigInt::Zero();
+  network_statistics.network_distance_data_.total_distance = XorDistance();
   network_statistics.network_distance_data_.average_distance = NodeId();
   average = node_id;
   network_statistics.UpdateNetworkAverageDistance(node_id);
@@ -51,14 +53,13 @@ TEST(NetworkStatisticsTest, BEH_AverageDistance) {
 
   node_id = NodeId(NodeId::kMaxId);
   network_statistics.network_distance_data_.total_distance =
-      crypto::BigInt((node_id.ToStringEncoded(NodeId::EncodingType::kHex) + 'h').c_str()) *
-      network_statistics.network_distance_data_.contributors_count;
+      XorDistance(node_id) * network_statistics.network_distance_data_.contributors_count;
   average = node_id;
   network_statistics.UpdateNetworkAverageDistance(node_id);
   EXPECT_EQ(network_statistics.network_distance_data_.average_distance, average);
 
   network_statistics.network_distance_data_.contributors_count = 0;
-  network_statistics.network_distance_data_.total_distance = crypto::BigInt::Zero();
+  network_statistics.network_distance_data_.total_distance = XorDistance();
 
   std::vector<NodeId> distances_as_node_id;
   std::vector<crypto::BigInt> distances_as_bigint;
@@ -112,6 +113,38 @@ TEST(NetworkStatisticsTest, BEH_IsIdInGroupRange) {
   }
 }
 
+TEST(NetworkStatisticsTest, BEH_HopBudget) {
+  NetworkStatistics network_statistics(NodeId(NodeId::kRandomId));
+  EXPECT_EQ(Parameters::hops_to_live, network_statistics.HopBudget());
+
+  int log2_group_size(0);
+  while ((1 << log2_group_size) < Parameters::group_size)
+    ++log2_group_size;
+  // 20 leading zero bits: a network of about 2^20 * group_size nodes.
+  std::string distance(NodeId::kSize, '\xff');
+  distance[0] = distance[1] = '\0';
+  distance[2] = '\x0f';
+  network_statistics.distance_ = NodeId(distance);
+  const int kExpected(std::min<int>(Parameters::hops_to_live,
+                                    std::max<int>(Parameters::min_hops_to_live,
+                                                  2 * (20 + log2_group_size))));
+  EXPECT_EQ(kExpected, network_statistics.HopBudget());
+
+  network_statistics.distance_ = NodeId(NodeId::kMaxId);
+  EXPECT_EQ(std::max<int>(Parameters::min_hops_to_live, 2 * log2_group_size),
+            network_statistics.HopBudget());
+
+  distance.assign(NodeId::kSize - 1, '\0');
+  distance.push_back('\x01');
+  network_statistics.distance_ = NodeId(distance);
+  EXPECT_EQ(Parameters::hops_to_live, network_statistics.HopBudget());
+
+  network_statistics.distance_ = NodeId(NodeId::kMaxId);
+  Parameters::adaptive_hops_to_live = false;
+  EXPECT_EQ(Parameters::hops_to_live, network_statistics.HopBudget());
+  Parameters::adaptive_hops_to_live = true;
+}
+
 }  // namespace test
 }  // namespace routing
 }  // namespace maidsafe
@@ -0,0 +1,100 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/network_status_filter.h"
+#include "maidsafe/routing/return_codes.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(NetworkStatusFilterTest, BEH_DefaultsReportEverything) {
+  NetworkStatusFilter filter(0, NetworkStatusFilter::Clock::duration());
+  NetworkStatusFilter::Clock::time_point now(NetworkStatusFilter::Clock::now());
+  NetworkStatusFilter::Clock::duration retry_after;
+  for (int status : {10, 10, 11, static_cast<int>(kNotJoined), 12})
+    EXPECT_EQ(NetworkStatusFilter::Verdict::kReport, filter.Offer(status, now, retry_after));
+  int held(0);
+  EXPECT_FALSE(filter.TakeHeld(now, held));
+}
+
+TEST(NetworkStatusFilterTest, BEH_Hysteresis) {
+  NetworkStatusFilter filter(5, NetworkStatusFilter::Clock::duration());
+  NetworkStatusFilter::Clock::time_point now(NetworkStatusFilter::Clock::now());
+  NetworkStatusFilter::Clock::duration retry_after;
+  EXPECT_EQ(NetworkStatusFilter::Verdict::kReport, filter.Offer(50, now, retry_after));
+  EXPECT_EQ(NetworkStatusFilter::Verdict::kDrop, filter.Offer(54, now, retry_after));
+  EXPECT_EQ(NetworkStatusFilter::Verdict::kDrop, filter.Offer(46, now, retry_after));
+  EXPECT_EQ(NetworkStatusFilter::Verdict::kReport, filter.Offer(55, now, retry_after));
+  EXPECT_EQ(NetworkStatusFilter::Verdict::kReport, filter.Offer(kNotJoined, now, retry_after));
+  EXPECT_EQ(NetworkStatusFilter::Verdict::kReport, filter.Offer(56, now, retry_after));
+  EXPECT_EQ(NetworkStatusFilter::Verdict::kDrop, filter.Offer(56, now, retry_after));
+  EXPECT_EQ(NetworkStatusFilter::Verdict::kReport, filter.Offer(98, now, retry_after));
+  EXPECT_EQ(NetworkStatusFilter::Verdict::kReport, filter.Offer(100, now, retry_after));
+}
+
+TEST(NetworkStatusFilterTest, BEH_RateLimit) {
+  const std::chrono::milliseconds kInterval(100);
+  NetworkStatusFilter filter(0, kInterval);
+  NetworkStatusFilter::Clock::time_point now(NetworkStatusFilter::Clock::now());
+  NetworkStatusFilter::Clock::duration retry_after;
+  EXPECT_EQ(NetworkStatusFilter::Verdict::kReport, filter.Offer(10, now, retry_after));
+  now += std::chrono::milliseconds(40);
+  EXPECT_EQ(NetworkStatusFilter::Verdict::kHold, filter.Offer(20, now, retry_after));
+  EXPECT_EQ(std::chrono::milliseconds(60), retry_after);
+  EXPECT_EQ(NetworkStatusFilter::Verdict::kHold, filter.Offer(30, now, retry_after));
+  int held(0);
+  EXPECT_FALSE(filter.TakeHeld(now, held));
+
+  // Only the latest held update is reported, once the interval has passed.
+  now += retry_after;
+  EXPECT_TRUE(filter.TakeHeld(now, held));
+  EXPECT_EQ(30, held);
+  EXPECT_FALSE(filter.TakeHeld(now, held));
+
+  // Error codes aren't held.
+  EXPECT_EQ(NetworkStatusFilter::Verdict::kReport, filter.Offer(kNotJoined, now, retry_after));
+  EXPECT_EQ(NetworkStatusFilter::Verdict::kHold, filter.Offer(40, now, retry_after));
+  now += kInterval;
+  EXPECT_TRUE(filter.TakeHeld(now, held));
+  EXPECT_EQ(40, held);
+}
+
+TEST(NetworkStatusFilterTest, BEH_HeldUpdateDroppedOnceStale) {
+  NetworkStatusFilter filter(5, std::chrono::milliseconds(100));
+  NetworkStatusFilter::Clock::time_point now(NetworkStatusFilter::Clock::now());
+  NetworkStatusFilter::Clock::duration retry_after;
+  EXPECT_EQ(NetworkStatusFilter::Verdict::kReport, filter.Offer(50, now, retry_after));
+  EXPECT_EQ(NetworkStatusFilter::Verdict::kHold, filter.Offer(60, now, retry_after));
+  // Back near the reported value before the held one was due.
+  EXPECT_EQ(NetworkStatusFilter::Verdict::kDrop, filter.Offer(52, now, retry_after));
+  int held(0);
+  EXPECT_FALSE(filter.TakeHeld(now + std::chrono::milliseconds(100), held));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
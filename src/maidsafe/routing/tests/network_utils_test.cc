@@ -74,7 +74,7 @@ TEST(NetworkUtilsTest, BEH_ProcessSendDirectInvalidEndpoint) {
   RoutingTable routing_table(false, node_id, asymm::GenerateKeyPair(), network_statistics);
   ClientRoutingTable client_routing_table(routing_table.kNodeId());
   AsioService asio_service(1);
-  NetworkUtils network(routing_table, client_routing_table);
+  NetworkUtils network(routing_table, client_routing_table, asio_service);
   network.SendToClosestNode(message);
 }
 
@@ -94,10 +94,47 @@ TEST(NetworkUtilsTest, BEH_ProcessSendUnavailableDirectEndpoint) {
   ClientRoutingTable client_routing_table(routing_table.kNodeId());
   Endpoint endpoint(GetLocalIp(), maidsafe::test::GetRandomPort());
   AsioService asio_service(1);
-  NetworkUtils network(routing_table, client_routing_table);
+  NetworkUtils network(routing_table, client_routing_table, asio_service);
   network.SendToDirect(message, NodeId(NodeId::kRandomId), NodeId(NodeId::kRandomId));
 }
 
+TEST(NetworkUtilsTest, BEH_SendBatchToUnavailablePeers) {
+  protobuf::Message message;
+  message.set_routing_message(true);
+  message.set_client_node(false);
+  message.set_request(true);
+  message.add_data("data");
+  message.set_direct(true);
+  message.set_type(10);
+  message.set_hops_to_live(Parameters::hops_to_live);
+  NodeId node_id(NodeId::kRandomId);
+  NetworkStatistics network_statistics(node_id);
+  RoutingTable routing_table(false, node_id, asymm::GenerateKeyPair(), network_statistics);
+  ClientRoutingTable client_routing_table(routing_table.kNodeId());
+  AsioService asio_service(1);
+  NetworkUtils network(routing_table, client_routing_table, asio_service);
+
+  size_t empty_batch_failures(1);
+  network.Send(SendBatch(), [&](size_t failed_count) { empty_batch_failures = failed_count; });
+  EXPECT_EQ(0U, empty_batch_failures);
+
+  SendBatch batch;
+  std::vector<NodeInfo> peers(2);
+  for (auto& peer : peers) {
+    peer.node_id = NodeId(NodeId::kRandomId);
+    peer.connection_id = peer.node_id;
+  }
+  batch.Add(message, peers);
+  batch.Add(message, NodeId(NodeId::kRandomId));
+  EXPECT_EQ(3U, batch.size());
+  std::promise<size_t> promise;
+  auto future(promise.get_future());
+  network.Send(std::move(batch),
+               [&promise](size_t failed_count) { promise.set_value(failed_count); });
+  ASSERT_EQ(std::future_status::ready, future.wait_for(std::chrono::seconds(10)));
+  EXPECT_EQ(3U, future.get());
+}
+
 TEST(NetworkUtilsTest, FUNC_ProcessSendDirectEndpoint) {
   const int kMessageCount(10);
   rudp::ManagedConnections rudp1, rudp2;
@@ -210,7 +247,7 @@ TEST(NetworkUtilsTest, FUNC_ProcessSendDirectEndpoint) {
   NodeId node_id3(routing_table.kNodeId());
   ClientRoutingTable client_routing_table(routing_table.kNodeId());
   AsioService asio_service(1);
-  NetworkUtils network(routing_table, client_routing_table);
+  NetworkUtils network(routing_table, client_routing_table, asio_service);
 
   std::vector<Endpoint> bootstrap_endpoint(1, endpoint2);
   EXPECT_EQ(kSuccess, network.Bootstrap(bootstrap_endpoint, message_received_functor3,
@@ -270,7 +307,7 @@ TEST(NetworkUtilsTest, FUNC_ProcessSendRecursiveSendOn) {
   NodeId node_id3(routing_table.kNodeId());
   ClientRoutingTable client_routing_table(routing_table.kNodeId());
   AsioService asio_service(1);
-  NetworkUtils network(routing_table, client_routing_table);
+  NetworkUtils network(routing_table, client_routing_table, asio_service);
 
   rudp::MessageReceivedFunctor message_received_functor1 = [](const std::string & message) {
     LOG(kInfo) << " -- Received: " << message;
@@ -0,0 +1,98 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/node_id_table.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(NodeIdTableTest, BEH_AcquireAndRelease) {
+  NodeIdTable table;
+  NodeId first(NodeId::kRandomId), second(NodeId::kRandomId);
+  EXPECT_EQ(NodeIdTable::kInvalidHandle, table.Find(first));
+  EXPECT_FALSE(table.Release(first));
+
+  auto first_handle(table.Acquire(first));
+  EXPECT_EQ(first_handle, table.Acquire(first));
+  auto second_handle(table.Acquire(second));
+  EXPECT_NE(first_handle, second_handle);
+  EXPECT_EQ(2U, table.size());
+  EXPECT_EQ(2U, table.references(first_handle));
+  EXPECT_EQ(1U, table.references(second_handle));
+  EXPECT_EQ(first, table.node_id(first_handle));
+  EXPECT_EQ(second, table.node_id(second_handle));
+
+  EXPECT_FALSE(table.Release(first));
+  EXPECT_TRUE(table.Contains(first));
+  EXPECT_TRUE(table.Release(first));
+  EXPECT_FALSE(table.Contains(first));
+  EXPECT_EQ(1U, table.size());
+
+  // The released handle is reused.
+  NodeId third(NodeId::kRandomId);
+  EXPECT_EQ(first_handle, table.Acquire(third));
+  EXPECT_EQ(first_handle, table.Find(third));
+  EXPECT_EQ(third, table.node_id(first_handle));
+  EXPECT_EQ(second_handle, table.Find(second));
+
+  // Released by handle, as by ID.
+  EXPECT_TRUE(table.Release(second_handle));
+  EXPECT_FALSE(table.Contains(second));
+  EXPECT_EQ(1U, table.size());
+}
+
+TEST(NodeIdTableTest, BEH_ReclaimsReleasedHandles) {
+  NodeIdTable table;
+  std::vector<NodeId> node_ids;
+  for (int i(0); i != 100; ++i) {
+    node_ids.push_back(NodeId(NodeId::kRandomId));
+    EXPECT_EQ(static_cast<NodeIdTable::Handle>(i), table.Acquire(node_ids.back()));
+  }
+  EXPECT_EQ(100U, table.handle_limit());
+
+  // Handles freed below the highest are reused lowest first.
+  EXPECT_TRUE(table.Release(node_ids[40]));
+  EXPECT_TRUE(table.Release(node_ids[20]));
+  EXPECT_EQ(100U, table.handle_limit());
+  node_ids[20] = NodeId(NodeId::kRandomId);
+  EXPECT_EQ(20U, table.Acquire(node_ids[20]));
+
+  // Releasing the highest handles gives up every free handle above those still held.
+  for (int i(99); i != 40; --i)
+    EXPECT_TRUE(table.Release(node_ids[i]));
+  EXPECT_EQ(40U, table.handle_limit());
+  EXPECT_EQ(40U, table.size());
+  for (int i(0); i != 40; ++i)
+    EXPECT_TRUE(table.Release(node_ids[i]));
+  EXPECT_EQ(0U, table.handle_limit());
+  EXPECT_EQ(0U, table.size());
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
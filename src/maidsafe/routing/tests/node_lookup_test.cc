@@ -0,0 +1,130 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/node_lookup.h"
+#include "maidsafe/routing/parameters.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+class NodeLookupTest : public testing::Test {
+ protected:
+  NodeLookupTest()
+      : asio_service_(2),
+        target_id_(NodeId::kRandomId),
+        nodes_(),
+        unresponsive_(),
+        mutex_(),
+        queried_(),
+        lookup_(),
+        old_timeout_(Parameters::find_nodes_query_timeout) {
+    for (int i(0); i != 100; ++i)
+      nodes_.push_back(NodeId(NodeId::kRandomId));
+    std::sort(std::begin(nodes_), std::end(nodes_), [this](const NodeId& lhs, const NodeId& rhs) {
+      return NodeId::CloserToTarget(lhs, rhs, target_id_);
+    });
+    Parameters::find_nodes_query_timeout = std::chrono::milliseconds(50);
+  }
+
+  ~NodeLookupTest() {
+    Parameters::find_nodes_query_timeout = old_timeout_;
+    asio_service_.Stop();
+  }
+
+  // Nodes know the four nodes closest to them in the ordering by distance to the target, so each
+  // hop moves the lookup only a short way towards the target.
+  std::vector<NodeId> KnownBy(const NodeId& node_id) const {
+    auto itr(std::find(std::begin(nodes_), std::end(nodes_), node_id));
+    auto begin(itr - std::min<std::ptrdiff_t>(4, itr - std::begin(nodes_)));
+    return std::vector<NodeId>(begin, std::min(begin + 8, std::end(nodes_)));
+  }
+
+  std::shared_ptr<NodeLookup> MakeLookup() {
+    auto lookup(std::make_shared<NodeLookup>(asio_service_, target_id_, [this](const NodeId& peer) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queried_.push_back(peer);
+      if (unresponsive_.count(peer) == 0) {
+        std::vector<NodeId> known(KnownBy(peer));
+        asio_service_.service().post([this, peer, known] {
+          if (std::shared_ptr<NodeLookup> lookup = lookup_.lock())
+            lookup->AddResponse(peer, known);
+        });
+      }
+    }));
+    lookup_ = lookup;
+    return lookup;
+  }
+
+  bool WaitForFinish(const std::shared_ptr<NodeLookup>& lookup) {
+    for (int i(0); i != 200 && !lookup->finished(); ++i)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    return lookup->finished();
+  }
+
+  AsioService asio_service_;
+  NodeId target_id_;
+  std::vector<NodeId> nodes_;  // closest to target_id_ first
+  std::set<NodeId> unresponsive_;
+  std::mutex mutex_;
+  std::vector<NodeId> queried_;
+  std::weak_ptr<NodeLookup> lookup_;
+  std::chrono::steady_clock::duration old_timeout_;
+};
+
+TEST_F(NodeLookupTest, BEH_FindsClosestNodes) {
+  auto lookup(MakeLookup());
+  lookup->AddResponse(nodes_.back(), KnownBy(nodes_.back()));
+  ASSERT_TRUE(WaitForFinish(lookup));
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (uint16_t i(0); i != Parameters::closest_nodes_size; ++i)
+    EXPECT_NE(std::end(queried_), std::find(std::begin(queried_), std::end(queried_), nodes_[i]));
+  std::set<NodeId> unique_queried(std::begin(queried_), std::end(queried_));
+  EXPECT_EQ(queried_.size(), unique_queried.size());
+}
+
+TEST_F(NodeLookupTest, BEH_SkipsUnresponsiveNodes) {
+  unresponsive_.insert(nodes_[0]);
+  unresponsive_.insert(nodes_[2]);
+  auto lookup(MakeLookup());
+  lookup->AddResponse(nodes_.back(), KnownBy(nodes_.back()));
+  ASSERT_TRUE(WaitForFinish(lookup));
+  std::lock_guard<std::mutex> lock(mutex_);
+  // The closest responsive nodes are still all asked, despite the timeouts.
+  for (uint16_t i(0); i != Parameters::closest_nodes_size + 2; ++i)
+    EXPECT_NE(std::end(queried_), std::find(std::begin(queried_), std::end(queried_), nodes_[i]));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,136 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/pending_response.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(PendingResponseTest, BEH_StateIsReused) {
+  auto pool(std::make_shared<detail::CompletionPool>(1));
+  detail::CompletionState* first_state(nullptr);
+  {
+    PendingResponse pending(pool->Acquire(1));
+    first_state = pending.state();
+    auto completer(pending.state()->Completer());
+    EXPECT_FALSE(pending.ready());
+    completer("response");
+    EXPECT_TRUE(pending.ready());
+    EXPECT_EQ("response", pending.get());
+    EXPECT_EQ(0, pool->spare_count());
+  }
+  EXPECT_EQ(1, pool->spare_count());
+
+  // The response may outlive the handle, and vice versa.
+  std::function<void(std::string)> completer;
+  {
+    PendingResponse pending(pool->Acquire(1));
+    EXPECT_EQ(first_state, pending.state());
+    completer = pending.state()->Completer();
+  }
+  EXPECT_EQ(0, pool->spare_count());
+  completer(std::string());
+  EXPECT_EQ(1, pool->spare_count());
+
+  // Beyond max_spare, released states are freed.
+  PendingResponse first(pool->Acquire(1)), second(pool->Acquire(1));
+  first.state()->Completer()(std::string());
+  second.state()->Completer()(std::string());
+  first = PendingResponse();
+  second = PendingResponse();
+  EXPECT_EQ(1, pool->spare_count());
+}
+
+TEST(PendingResponseTest, BEH_WaitAndThen) {
+  auto pool(std::make_shared<detail::CompletionPool>(4));
+  PendingResponse pending(pool->Acquire(1));
+  auto completer(pending.state()->Completer());
+  std::string response;
+  EXPECT_FALSE(pending.WaitFor(std::chrono::milliseconds(10), response));
+  std::thread responder([completer]() { completer("late"); });
+  EXPECT_TRUE(pending.WaitFor(std::chrono::seconds(10), response));
+  EXPECT_EQ("late", response);
+  responder.join();
+
+  // A callback given before the response is called on delivery, and one given after at once.
+  std::vector<std::string> responses;
+  PendingResponse before(pool->Acquire(1)), after(pool->Acquire(1));
+  auto before_completer(before.state()->Completer()), after_completer(after.state()->Completer());
+  before.Then([&](std::string reply) { responses.push_back(reply); });
+  EXPECT_TRUE(responses.empty());
+  before_completer("before");
+  after_completer("after");
+  after.Then([&](std::string reply) { responses.push_back(reply); });
+  ASSERT_EQ(2, responses.size());
+  EXPECT_EQ("before", responses[0]);
+  EXPECT_EQ("after", responses[1]);
+}
+
+TEST(PendingResponseTest, BEH_GroupResponsesRange) {
+  auto pool(std::make_shared<detail::CompletionPool>(4));
+  GroupResponses group(pool->Acquire(4));
+  EXPECT_EQ(4, group.expected_count());
+  auto completer(group.state()->Completer());
+  std::thread responder([completer]() {
+    completer("1");
+    completer("2");
+    completer(std::string());  // as for a timeout
+    completer("4");
+  });
+  std::vector<std::string> responses;
+  std::string response;
+  while (group.Next(response))
+    responses.push_back(response);
+  responder.join();
+  ASSERT_EQ(4, responses.size());
+  EXPECT_EQ("1", responses[0]);
+  EXPECT_TRUE(responses[2].empty());
+  EXPECT_FALSE(group.Next(response));
+
+  // Those already taken by Next aren't passed to a later callback.
+  GroupResponses mixed(pool->Acquire(3));
+  auto mixed_completer(mixed.state()->Completer());
+  mixed_completer("taken");
+  mixed_completer("kept");
+  EXPECT_TRUE(mixed.Next(response));
+  EXPECT_EQ("taken", response);
+  responses.clear();
+  mixed.Then([&](std::string reply) { responses.push_back(reply); });
+  mixed_completer("later");
+  ASSERT_EQ(2, responses.size());
+  EXPECT_EQ("kept", responses[0]);
+  EXPECT_EQ("later", responses[1]);
+  EXPECT_FALSE(mixed.Next(response));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
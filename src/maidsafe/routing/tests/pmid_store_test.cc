@@ -0,0 +1,84 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <vector>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/passport/passport.h"
+
+#include "maidsafe/routing/pmid_store.h"
+#include "maidsafe/routing/tests/test_utils.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+class PmidStoreTest : public testing::Test {
+ protected:
+  PmidStoreTest()
+      : test_path_(maidsafe::test::CreateTestPath("MaidSafe_TestPmidStore")), pmids_() {
+    for (int i(0); i != 3; ++i)
+      pmids_.push_back(MakePmid());
+  }
+
+  void ExpectMatches(const PmidStore& pmid_store) {
+    ASSERT_EQ(pmids_.size(), pmid_store.size());
+    for (size_t i(0); i != pmids_.size(); ++i) {
+      const NodeId kNodeId(pmids_[i].name()->string());
+      EXPECT_EQ(kNodeId, pmid_store.node_id(i));
+      EXPECT_EQ(i, pmid_store.Find(kNodeId));
+      EXPECT_TRUE(asymm::MatchingKeys(pmids_[i].public_key(), pmid_store.pmid(i).public_key()));
+    }
+    EXPECT_EQ(pmid_store.size(), pmid_store.Find(NodeId(NodeId::kRandomId)));
+    EXPECT_THROW(pmid_store.node_id(pmids_.size()), std::exception);
+    EXPECT_THROW(pmid_store.pmid(pmids_.size()), std::exception);
+  }
+
+  maidsafe::test::TestPath test_path_;
+  std::vector<passport::Pmid> pmids_;
+};
+
+TEST_F(PmidStoreTest, BEH_IndexedFormat) {
+  const boost::filesystem::path kPath(*test_path_ / "pmids.dat");
+  ASSERT_TRUE(WritePmidStore(kPath, pmids_));
+  ExpectMatches(PmidStore(kPath));
+}
+
+TEST_F(PmidStoreTest, BEH_ListFormat) {
+  const boost::filesystem::path kPath(*test_path_ / "pmids_list.dat");
+  ASSERT_TRUE(passport::detail::WritePmidList(kPath, pmids_));
+  ExpectMatches(PmidStore(kPath));
+}
+
+TEST_F(PmidStoreTest, BEH_TruncatedIndex) {
+  const boost::filesystem::path kPath(*test_path_ / "pmids.dat");
+  ASSERT_TRUE(WritePmidStore(kPath, pmids_));
+  boost::filesystem::resize_file(kPath, 24);
+  EXPECT_THROW(PmidStore pmid_store(kPath), std::exception);
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,57 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <string>
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/popularity_sketch.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(PopularitySketchTest, BEH_EstimatesNeverUndercount) {
+  PopularitySketch sketch(256, 4);
+  EXPECT_EQ(0U, sketch.Estimate("popular"));
+  for (int i(0); i != 100; ++i)
+    sketch.Add("popular");
+  for (int i(0); i != 500; ++i)
+    sketch.Add("one-off " + std::to_string(i));
+  EXPECT_GE(sketch.Estimate("popular"), 100U);
+  EXPECT_LT(sketch.Estimate("popular"), 110U);
+  EXPECT_GE(sketch.Estimate("one-off 7"), 1U);
+  EXPECT_LT(sketch.Estimate("one-off 7"), 10U);
+}
+
+TEST(PopularitySketchTest, BEH_CountsAgeWithTraffic) {
+  PopularitySketch sketch(10, 2);  // ages every 100 additions
+  for (int i(0); i != 99; ++i)
+    sketch.Add("key");
+  EXPECT_EQ(99U, sketch.Estimate("key"));
+  sketch.Add("key");
+  EXPECT_EQ(50U, sketch.Estimate("key"));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,201 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/rsa.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/public_key_requester.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+class PublicKeyRequesterTest : public testing::Test {
+ protected:
+  PublicKeyRequesterTest()
+      : asio_service_(1),
+        requester_(std::make_shared<PublicKeyRequester>(asio_service_,
+                                                        Parameters::default_response_timeout)),
+        public_key_(asymm::GenerateKeyPair().public_key),
+        mutex_(),
+        cond_var_(),
+        lookups_(),
+        pending_(),
+        old_batch_window_(Parameters::public_key_batch_window),
+        old_cache_ttl_(Parameters::public_key_cache_ttl) {}
+
+  ~PublicKeyRequesterTest() {
+    Parameters::public_key_batch_window = old_batch_window_;
+    Parameters::public_key_cache_ttl = old_cache_ttl_;
+    requester_.reset();
+    asio_service_.Stop();
+  }
+
+  // Each lookup is recorded; answer_now gives the key at once, otherwise it's held in pending_.
+  void UseSingleLookups(bool answer_now) {
+    requester_->set_request_public_key_functor([this, answer_now](
+        NodeId node_id, GivePublicKeyFunctor give_public_key) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        lookups_.push_back(std::vector<NodeId>(1, node_id));
+        if (!answer_now) {
+          pending_.push_back(give_public_key);
+          return;
+        }
+      }
+      give_public_key(public_key_);
+    });
+  }
+
+  size_t lookup_count() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lookups_.size();
+  }
+
+  AsioService asio_service_;
+  std::shared_ptr<PublicKeyRequester> requester_;
+  asymm::PublicKey public_key_;
+  std::mutex mutex_;
+  std::condition_variable cond_var_;
+  std::vector<std::vector<NodeId>> lookups_;
+  std::vector<GivePublicKeyFunctor> pending_;
+  const std::chrono::milliseconds old_batch_window_;
+  const std::chrono::seconds old_cache_ttl_;
+};
+
+TEST_F(PublicKeyRequesterTest, BEH_CoalescesRequestsForSamePeer) {
+  UseSingleLookups(false);
+  EXPECT_FALSE(PublicKeyRequester(asio_service_, Parameters::default_response_timeout).enabled());
+  EXPECT_TRUE(requester_->enabled());
+  const NodeId kPeer(NodeId::kRandomId);
+  int given(0);
+  auto count_valid([&](asymm::PublicKey public_key) {
+    if (asymm::ValidateKey(public_key))
+      ++given;
+  });
+  requester_->RequestPublicKey(kPeer, count_valid);
+  requester_->RequestPublicKey(kPeer, count_valid);
+  ASSERT_EQ(1U, lookup_count());
+  EXPECT_EQ(0, given);
+  // A request for another peer isn't held up by the first.
+  requester_->RequestPublicKey(NodeId(NodeId::kRandomId), count_valid);
+  ASSERT_EQ(2U, lookup_count());
+
+  pending_.front()(public_key_);
+  EXPECT_EQ(2, given);
+  // The key is now cached, so no further lookup is made.
+  requester_->RequestPublicKey(kPeer, count_valid);
+  EXPECT_EQ(2U, lookup_count());
+  EXPECT_EQ(3, given);
+}
+
+TEST_F(PublicKeyRequesterTest, BEH_BatchesRequestsWithinWindow) {
+  Parameters::public_key_batch_window = std::chrono::milliseconds(50);
+  requester_->set_request_public_keys_functor([this](std::vector<NodeId> node_ids,
+                                                     GivePublicKeysFunctor give_public_keys) {
+    for (const auto& node_id : node_ids)
+      give_public_keys(node_id, public_key_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    lookups_.push_back(node_ids);
+    cond_var_.notify_one();
+  });
+  std::vector<NodeId> peers;
+  size_t given(0);
+  for (int i(0); i != 3; ++i) {
+    peers.push_back(NodeId(NodeId::kRandomId));
+    requester_->RequestPublicKey(peers.back(), [&](asymm::PublicKey) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++given;
+    });
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  EXPECT_TRUE(lookups_.empty());
+  ASSERT_TRUE(cond_var_.wait_for(lock, std::chrono::seconds(5),
+                                 [this] { return !lookups_.empty(); }));
+  ASSERT_EQ(1U, lookups_.size());
+  EXPECT_EQ(peers, lookups_.front());
+  EXPECT_EQ(3U, given);
+}
+
+TEST_F(PublicKeyRequesterTest, BEH_CachesValidKeysForTtl) {
+  UseSingleLookups(true);
+  const NodeId kPeer(NodeId::kRandomId);
+  requester_->RequestPublicKey(kPeer, [](asymm::PublicKey) {});
+  requester_->RequestPublicKey(kPeer, [](asymm::PublicKey) {});
+  EXPECT_EQ(1U, lookup_count());
+
+  // A key cached for no time at all expires at once.
+  Parameters::public_key_cache_ttl = std::chrono::seconds(0);
+  const NodeId kShortLivedPeer(NodeId::kRandomId);
+  requester_->RequestPublicKey(kShortLivedPeer, [](asymm::PublicKey) {});
+  requester_->RequestPublicKey(kShortLivedPeer, [](asymm::PublicKey) {});
+  EXPECT_EQ(3U, lookup_count());
+
+  // Invalid keys aren't cached.
+  requester_->set_request_public_key_functor([this](NodeId node_id,
+                                                    GivePublicKeyFunctor give_public_key) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      lookups_.push_back(std::vector<NodeId>(1, node_id));
+    }
+    give_public_key(asymm::PublicKey());
+  });
+  Parameters::public_key_cache_ttl = old_cache_ttl_;
+  const NodeId kInvalidPeer(NodeId::kRandomId);
+  requester_->RequestPublicKey(kInvalidPeer, [](asymm::PublicKey) {});
+  requester_->RequestPublicKey(kInvalidPeer, [](asymm::PublicKey) {});
+  EXPECT_EQ(5U, lookup_count());
+}
+
+TEST_F(PublicKeyRequesterTest, BEH_EvictsSoonestToExpireWhenFull) {
+  UseSingleLookups(true);
+  Parameters::public_key_cache_ttl = std::chrono::seconds(500);
+  const NodeId kFirstPeer(NodeId::kRandomId);
+  requester_->RequestPublicKey(kFirstPeer, [](asymm::PublicKey) {});
+  Parameters::public_key_cache_ttl = std::chrono::seconds(600);
+  std::vector<NodeId> peers;
+  for (size_t i(0); i != PublicKeyRequester::kMaxCachedKeys; ++i) {
+    peers.push_back(NodeId(NodeId::kRandomId));
+    requester_->RequestPublicKey(peers.back(), [](asymm::PublicKey) {});
+  }
+  ASSERT_EQ(PublicKeyRequester::kMaxCachedKeys + 1, lookup_count());
+
+  // The rest are all still cached, but the first peer's key, expiring soonest, made way.
+  for (const auto& peer : peers)
+    requester_->RequestPublicKey(peer, [](asymm::PublicKey) {});
+  EXPECT_EQ(PublicKeyRequester::kMaxCachedKeys + 1, lookup_count());
+  requester_->RequestPublicKey(kFirstPeer, [](asymm::PublicKey) {});
+  EXPECT_EQ(PublicKeyRequester::kMaxCachedKeys + 2, lookup_count());
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
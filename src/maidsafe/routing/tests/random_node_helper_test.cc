@@ -0,0 +1,69 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/random_node_helper.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(RandomNodeHelperTest, BEH_AddGetRemove) {
+  RandomNodeHelper random_node_helper;
+  EXPECT_TRUE(random_node_helper.Get().IsZero());
+
+  std::vector<NodeId> node_ids;
+  for (int i(0); i != 100; ++i) {
+    node_ids.push_back(NodeId(NodeId::kRandomId));
+    random_node_helper.Add(node_ids.back());
+    random_node_helper.Add(node_ids.back());
+  }
+  // Once full, Get should still pick from all held IDs rather than always the same one.
+  std::set<NodeId> got;
+  for (int i(0); i != 1000; ++i) {
+    NodeId node_id(random_node_helper.Get());
+    EXPECT_NE(node_ids.end(), std::find(node_ids.begin(), node_ids.end(), node_id));
+    got.insert(node_id);
+  }
+  EXPECT_LT(1U, got.size());
+
+  // Adding beyond capacity replaces the earliest ID.
+  NodeId newest(NodeId::kRandomId);
+  random_node_helper.Add(newest);
+  for (const auto& node_id : node_ids)
+    random_node_helper.Remove(node_id);
+  for (int i(0); i != 10; ++i)
+    EXPECT_EQ(newest, random_node_helper.Get());
+
+  random_node_helper.Remove(newest);
+  EXPECT_TRUE(random_node_helper.Get().IsZero());
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,110 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/relay_links.h"
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+std::shared_ptr<const protobuf::Message> Request(int32_t id) {
+  auto request(std::make_shared<protobuf::Message>());
+  request->set_id(id);
+  return request;
+}
+
+}  // unnamed namespace
+
+TEST(RelayLinksTest, BEH_ChoosesLeastLoadedThenFastestLink) {
+  RelayLinks relay_links(std::chrono::seconds(10));
+  NodeId first(NodeId::kRandomId), second(NodeId::kRandomId);
+  std::vector<NodeId> links(1, first);
+  links.push_back(second);
+  EXPECT_TRUE(relay_links.Choose(std::vector<NodeId>()).IsZero());
+  EXPECT_EQ(first, relay_links.Choose(links));
+
+  relay_links.Sent(first, Request(1));
+  EXPECT_EQ(second, relay_links.Choose(links));
+  relay_links.Sent(second, Request(2));
+  EXPECT_EQ(first, relay_links.Choose(links));
+  EXPECT_EQ(2U, relay_links.in_flight());
+
+  // Both idle again, the link which answered sooner wins.
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  relay_links.Answered(2);
+  relay_links.Answered(2);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  relay_links.Answered(1);
+  EXPECT_EQ(0U, relay_links.in_flight());
+  EXPECT_LT(relay_links.SmoothedRtt(second), relay_links.SmoothedRtt(first));
+  EXPECT_EQ(second, relay_links.Choose(links));
+}
+
+TEST(RelayLinksTest, BEH_LostLinkReturnsRequestsInFlight) {
+  RelayLinks relay_links(std::chrono::seconds(10));
+  NodeId lost(NodeId::kRandomId), kept(NodeId::kRandomId);
+  relay_links.Sent(lost, Request(3));
+  relay_links.Sent(kept, Request(1));
+  relay_links.Sent(lost, Request(2));
+  relay_links.Sent(lost, Request(4));
+  relay_links.Answered(4);
+  // Resending moves a request to its new link.
+  relay_links.Sent(kept, Request(1));
+  EXPECT_EQ(2U, relay_links.in_flight(lost));
+  EXPECT_EQ(1U, relay_links.in_flight(kept));
+
+  auto requests(relay_links.Lost(lost));
+  ASSERT_EQ(2U, requests.size());
+  EXPECT_EQ(3, requests.front().message->id());
+  EXPECT_EQ(2, requests.back().message->id());
+  EXPECT_LE(requests.front().sent, requests.back().sent);
+  EXPECT_EQ(0U, relay_links.in_flight(lost));
+  EXPECT_EQ(1U, relay_links.in_flight());
+  EXPECT_TRUE(relay_links.Lost(lost).empty());
+}
+
+TEST(RelayLinksTest, BEH_ForgetsRequestsPastTheirLifetime) {
+  RelayLinks relay_links(std::chrono::milliseconds(20));
+  NodeId link(NodeId::kRandomId);
+  relay_links.Sent(link, Request(1));
+  std::this_thread::sleep_for(std::chrono::milliseconds(40));
+  relay_links.Sent(link, Request(2));
+  EXPECT_EQ(1U, relay_links.in_flight(link));
+  auto requests(relay_links.Lost(link));
+  ASSERT_EQ(1U, requests.size());
+  EXPECT_EQ(2, requests.front().message->id());
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
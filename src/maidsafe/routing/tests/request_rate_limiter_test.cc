@@ -0,0 +1,122 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <string>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/message_handler.h"
+#include "maidsafe/routing/request_rate_limiter.h"
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+protobuf::Message MakeRequest(const std::string& source_id, MessageType type) {
+  protobuf::Message message;
+  message.set_source_id(source_id);
+  message.set_destination_id(NodeId(NodeId::kRandomId).string());
+  message.set_routing_message(true);
+  message.set_request(true);
+  message.set_direct(true);
+  message.set_type(static_cast<int32_t>(type));
+  return message;
+}
+
+}  // unnamed namespace
+
+TEST(RequestRateLimiterTest, BEH_LimitsEachSourceAndType) {
+  typedef RequestRateLimiter::Clock Clock;
+  RequestRateLimiter limiter(10, 3, 16);
+  const std::string kSource(NodeId(NodeId::kRandomId).string());
+  const protobuf::Message kFindNodes(MakeRequest(kSource, MessageType::kFindNodes));
+  const Clock::time_point kStart(Clock::now());
+  for (int i(0); i != 3; ++i)
+    EXPECT_TRUE(limiter.TryAdmit(kFindNodes, kStart));
+  EXPECT_FALSE(limiter.TryAdmit(kFindNodes, kStart));
+  EXPECT_EQ(1U, limiter.refused_count());
+
+  // Other types from the same source, and other sources, have buckets of their own.
+  EXPECT_TRUE(limiter.TryAdmit(MakeRequest(kSource, MessageType::kConnect), kStart));
+  EXPECT_TRUE(limiter.TryAdmit(
+      MakeRequest(NodeId(NodeId::kRandomId).string(), MessageType::kFindNodes), kStart));
+  // A relayed request is charged to its relay ID.
+  protobuf::Message relayed(MakeRequest(kSource, MessageType::kFindNodes));
+  relayed.clear_source_id();
+  relayed.set_relay_id(NodeId(NodeId::kRandomId).string());
+  EXPECT_TRUE(limiter.TryAdmit(relayed, kStart));
+
+  // Responses, node level messages and cheaper requests aren't limited.
+  protobuf::Message response(kFindNodes);
+  response.set_request(false);
+  EXPECT_TRUE(limiter.TryAdmit(response, kStart));
+  EXPECT_TRUE(limiter.TryAdmit(MakeRequest(kSource, MessageType::kPing), kStart));
+  protobuf::Message node_level(kFindNodes);
+  node_level.set_routing_message(false);
+  EXPECT_TRUE(limiter.TryAdmit(node_level, kStart));
+  EXPECT_EQ(1U, limiter.refused_count());
+
+  // The bucket refills at the rate given, up to the burst.
+  EXPECT_TRUE(limiter.TryAdmit(kFindNodes, kStart + std::chrono::milliseconds(100)));
+  EXPECT_FALSE(limiter.TryAdmit(kFindNodes, kStart + std::chrono::milliseconds(100)));
+  const Clock::time_point kLater(kStart + std::chrono::seconds(10));
+  for (int i(0); i != 3; ++i)
+    EXPECT_TRUE(limiter.TryAdmit(kFindNodes, kLater));
+  EXPECT_FALSE(limiter.TryAdmit(kFindNodes, kLater));
+  EXPECT_EQ(3U, limiter.refused_count());
+}
+
+TEST(RequestRateLimiterTest, BEH_ZeroRateAdmitsEverything) {
+  RequestRateLimiter limiter(0, 1, 16);
+  const protobuf::Message kRequest(
+      MakeRequest(NodeId(NodeId::kRandomId).string(), MessageType::kGetGroup));
+  for (int i(0); i != 100; ++i)
+    EXPECT_TRUE(limiter.TryAdmit(kRequest));
+  EXPECT_EQ(0U, limiter.refused_count());
+}
+
+TEST(RequestRateLimiterTest, BEH_BucketsAreBounded) {
+  typedef RequestRateLimiter::Clock Clock;
+  RequestRateLimiter limiter(1, 1, 2);
+  const Clock::time_point kStart(Clock::now());
+  const protobuf::Message kFirst(
+      MakeRequest(NodeId(NodeId::kRandomId).string(), MessageType::kFindNodes));
+  const protobuf::Message kSecond(
+      MakeRequest(NodeId(NodeId::kRandomId).string(), MessageType::kFindNodes));
+  EXPECT_TRUE(limiter.TryAdmit(kFirst, kStart));
+  EXPECT_TRUE(limiter.TryAdmit(kSecond, kStart + std::chrono::milliseconds(1)));
+  // A third source evicts the bucket refilled longest ago, as neither has refilled yet.
+  EXPECT_TRUE(limiter.TryAdmit(
+      MakeRequest(NodeId(NodeId::kRandomId).string(), MessageType::kFindNodes),
+      kStart + std::chrono::milliseconds(2)));
+  EXPECT_TRUE(limiter.TryAdmit(kFirst, kStart + std::chrono::milliseconds(3)));
+  EXPECT_FALSE(limiter.TryAdmit(kFirst, kStart + std::chrono::milliseconds(3)));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -20,6 +20,7 @@
 #include <memory>
 #include <vector>
 
+#include "maidsafe/common/asio_service.h"
 #include "maidsafe/common/log.h"
 #include "maidsafe/common/test.h"
 #include "maidsafe/common/utils.h"
@@ -50,12 +51,13 @@ namespace test {
 class ResponseHandlerTest : public testing::Test {
  public:
   ResponseHandlerTest()
-      : node_id_(NodeId::kRandomId),
+      : asio_service_(1),
+        node_id_(NodeId::kRandomId),
         network_statistics_(node_id_),
         routing_table_(false, NodeId(NodeId::kRandomId), asymm::GenerateKeyPair(),
                        network_statistics_),
         client_routing_table_(routing_table_.kNodeId()),
-        network_(routing_table_, client_routing_table_),
+        network_(routing_table_, client_routing_table_, asio_service_),
         group_change_handler_(routing_table_, client_routing_table_, network_),
         response_handler_(routing_table_, client_routing_table_, network_, group_change_handler_) {}
 
@@ -196,6 +198,7 @@ class ResponseHandlerTest : public testing::Test {
     return ComposeMsg(ComposePingResponse(ping_request.SerializeAsString()).SerializeAsString());
   }
 
+  AsioService asio_service_;
   NodeId node_id_;
   NetworkStatistics network_statistics_;
   RoutingTable routing_table_;
@@ -355,16 +358,14 @@ TEST_F(ResponseHandlerTest, BEH_ConnectSuccessAcknowledgement) {
   std::shared_ptr<ResponseHandler> response_handler(std::make_shared<ResponseHandler>(
       routing_table_, client_routing_table_, network_, group_change_handler_));
 
-  // request_public_key_functor_ doesn't setup
+  // No public key lookup is set up yet
   message =
       ComposeMsg(ComposeConnectSuccessAcknowledgement(node_id, connection_id).SerializeAsString());
   response_handler->ConnectSuccessAcknowledgement(message);
 
-  // Setup request_public_key_functor_ testing accessor/modifier
-  EXPECT_EQ(nullptr, response_handler->request_public_key_functor());
+  // Set up public key lookups
   response_handler->set_request_public_key_functor(
       boost::bind(&ResponseHandlerTest::RequestPublicKey, this, _1, _2));
-  EXPECT_NE(nullptr, response_handler->request_public_key_functor());
 
   // Rudp failed to validate connection
   EXPECT_CALL(network_, MarkConnectionAsValid(testing::_)).WillOnce(testing::Return(-350020));
@@ -0,0 +1,81 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/route_history.h"
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(RouteHistoryTest, BEH_BuildFromMessage) {
+  NodeId own_id(NodeId::kRandomId), first(NodeId::kRandomId), last(NodeId::kRandomId);
+  protobuf::Message message;
+  message.add_route_history(RouteHistory::Prefix(own_id));
+  EXPECT_TRUE(RouteHistory(message, own_id, false).empty());
+  EXPECT_TRUE(RouteHistory(message, first, false).Contains(own_id));
+
+  message.clear_route_history();
+  message.add_route_history(RouteHistory::Prefix(first));
+  message.add_route_history(RouteHistory::Prefix(last));
+  RouteHistory excluding_last(message, own_id, false);
+  EXPECT_EQ(1U, excluding_last.size());
+  EXPECT_TRUE(excluding_last.Contains(first));
+  EXPECT_FALSE(excluding_last.Contains(last));
+  RouteHistory including_last(message, own_id, true);
+  EXPECT_EQ(2U, including_last.size());
+  EXPECT_TRUE(including_last.Contains(last));
+  EXPECT_FALSE(including_last.Contains(own_id));
+}
+
+TEST(RouteHistoryTest, BEH_AddAndCompare) {
+  RouteHistory route_history;
+  std::vector<NodeId> node_ids;
+  for (size_t i(0); i != RouteHistory::kCapacity + 1; ++i) {
+    node_ids.push_back(NodeId(NodeId::kRandomId));
+    route_history.Add(node_ids.back());
+  }
+  EXPECT_EQ(RouteHistory::kCapacity, route_history.size());
+  EXPECT_TRUE(route_history.Contains(node_ids.front()));
+  EXPECT_FALSE(route_history.Contains(node_ids.back()));
+
+  NodeId target(NodeId::kRandomId), node_id(NodeId::kRandomId);
+  RouteHistory closer;
+  closer.Add(target);
+  EXPECT_FALSE(closer.HasCloserThan(node_id, target));
+  for (const auto& candidate : node_ids) {
+    if (NodeId::CloserToTarget(candidate, node_id, target)) {
+      closer.Add(candidate);
+      EXPECT_TRUE(closer.HasCloserThan(node_id, target));
+      break;
+    }
+  }
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
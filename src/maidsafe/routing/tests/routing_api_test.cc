@@ -29,6 +29,7 @@
 #include "boost/filesystem/exception.hpp"
 #include "boost/progress.hpp"
 
+#include "maidsafe/common/asio_service.h"
 #include "maidsafe/common/node_id.h"
 #include "maidsafe/common/test.h"
 #include "maidsafe/common/utils.h"
@@ -118,6 +119,50 @@ TEST(APITest, BEH_API_ZeroState) {
   LOG(kInfo) << "done!!!";
 }
 
+TEST(APITest, BEH_API_ZeroStateOnSharedAsioService) {
+  auto pmid1(MakePmid()), pmid2(MakePmid());
+  NodeInfoAndPrivateKey node1(MakeNodeInfoAndKeysWithPmid(pmid1));
+  NodeInfoAndPrivateKey node2(MakeNodeInfoAndKeysWithPmid(pmid2));
+  std::map<NodeId, asymm::PublicKey> key_map;
+  key_map.insert(std::make_pair(node1.node_info.node_id, pmid1.public_key()));
+  key_map.insert(std::make_pair(node2.node_info.node_id, pmid2.public_key()));
+
+  // Both nodes, and a client which never joins, run on the same single thread.
+  auto asio_service(std::make_shared<AsioService>(1));
+  std::unique_ptr<Routing> routing1(new Routing(pmid1, asio_service));
+  std::unique_ptr<Routing> routing2(new Routing(pmid2, asio_service));
+  std::unique_ptr<Routing> client(new Routing(NodeId(NodeId::kRandomId), asio_service));
+
+  Functors functors1, functors2;
+  functors1.network_status = [](int) {};  // NOLINT
+  functors1.message_and_caching.message_received = no_ops_message_received_functor;
+  functors1.request_public_key = [&](const NodeId & node_id, GivePublicKeyFunctor give_key) {
+    auto itr(key_map.find(node_id));
+    if (key_map.end() != itr)
+      give_key((*itr).second);
+  };
+  functors2 = functors1;
+  Endpoint endpoint1(maidsafe::GetLocalIp(), maidsafe::test::GetRandomPort()),
+      endpoint2(maidsafe::GetLocalIp(), maidsafe::test::GetRandomPort());
+  auto a1 = std::async(std::launch::async, [&] {
+    return routing1->ZeroStateJoin(functors1, endpoint1, endpoint2, node2.node_info);
+  });
+  auto a2 = std::async(std::launch::async, [&] {
+    return routing2->ZeroStateJoin(functors2, endpoint2, endpoint1, node1.node_info);
+  });
+  EXPECT_EQ(kSuccess, a2.get());
+  EXPECT_EQ(kSuccess, a1.get());
+
+  // Each can go while the service, and the others, carry on.
+  client.reset();
+  routing1.reset();
+  EXPECT_EQ(2, asio_service.use_count());
+  routing2.reset();
+  EXPECT_EQ(1, asio_service.use_count());
+  std::shared_ptr<AsioService> no_asio_service;
+  EXPECT_THROW(Routing routing(pmid1, no_asio_service), std::exception);
+}
+
 TEST(APITest, DISABLED_BEH_API_ZeroStateWithDuplicateNode) {
   rudp::Parameters::bootstrap_connection_lifespan = boost::posix_time::seconds(5);
   auto pmid1(MakePmid()), pmid2(MakePmid()), pmid3(MakePmid());
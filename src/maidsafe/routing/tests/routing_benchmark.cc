@@ -0,0 +1,685 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+// Times the routing library's hot paths.  Inputs are generated from a fixed seed, so runs with the
+// same --seed time the same work, and results can be written as JSON for regression tracking.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>   // NOLINT
+#include <functional>
+#include <iomanip>
+#include <iostream>  // NOLINT
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined MAIDSAFE_LINUX
+#include <unistd.h>
+#endif
+
+#include "boost/program_options.hpp"
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/rsa.h"
+
+#include "maidsafe/routing/group_matrix.h"
+#include "maidsafe/routing/matrix_change.h"
+#include "maidsafe/routing/metrics.h"
+#include "maidsafe/routing/network_statistics.h"
+#include "maidsafe/routing/node_info.h"
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/route_history.h"
+#include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/routing_api.h"
+#include "maidsafe/routing/routing_table.h"
+#include "maidsafe/routing/timer.h"
+#include "maidsafe/routing/xor_distance.h"
+#include "maidsafe/routing/tests/message_replay.h"
+#include "maidsafe/routing/tests/simulated_network.h"
+
+namespace po = boost::program_options;
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace benchmark {
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Result {
+  std::string name;
+  uint64_t iterations;
+  double nanoseconds_per_op;
+};
+
+class IdSource {
+ public:
+  explicit IdSource(uint32_t seed) : engine_(seed) {}
+  NodeId NextId() {
+    std::string id(NodeId::kSize, 0);
+    for (auto& byte : id)
+      byte = static_cast<char>(engine_() & 0xff);
+    return NodeId(id);
+  }
+  std::vector<NodeId> NextIds(size_t count) {
+    std::vector<NodeId> ids;
+    for (size_t i(0); i != count; ++i)
+      ids.push_back(NextId());
+    return ids;
+  }
+
+ private:
+  std::mt19937 engine_;
+};
+
+// Runs each benchmark whose name contains filter, calling op(iterations) with doubling iteration
+// counts until a batch takes at least min_time.  op performs about that many operations and returns
+// how many it performed.
+class Runner {
+ public:
+  Runner(Clock::duration min_time, std::string filter)
+      : kMinTime_(min_time), kFilter_(std::move(filter)), results_() {}
+  void Run(const std::string& name, const std::function<uint64_t(uint64_t)>& op) {
+    if (name.find(kFilter_) == std::string::npos)
+      return;
+    op(1);  // warm up
+    for (uint64_t iterations(1);; iterations *= 2) {
+      auto start(Clock::now());
+      uint64_t performed(op(iterations));
+      auto elapsed(Clock::now() - start);
+      if (elapsed >= kMinTime_ || iterations >= (1ULL << 30)) {
+        Result result;
+        result.name = name;
+        result.iterations = performed;
+        result.nanoseconds_per_op =
+            static_cast<double>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) /
+            static_cast<double>(std::max(performed, static_cast<uint64_t>(1)));
+        results_.push_back(result);
+        return;
+      }
+    }
+  }
+  const std::vector<Result>& results() const { return results_; }
+
+ private:
+  const Clock::duration kMinTime_;
+  const std::string kFilter_;
+  std::vector<Result> results_;
+};
+
+NodeInfo MakeNode(const NodeId& node_id, const asymm::PublicKey& public_key) {
+  NodeInfo node;
+  node.node_id = node_id;
+  node.connection_id = node_id;
+  node.public_key = public_key;
+  return node;
+}
+
+void BenchmarkRoutingTable(uint32_t seed, const asymm::Keys& keys, Runner& runner) {
+  for (size_t table_size(8); table_size <= 64; table_size *= 2) {
+    IdSource ids(seed);
+    const NodeId kOwnId(ids.NextId());
+    std::vector<NodeInfo> nodes;
+    for (const auto& node_id : ids.NextIds(table_size))
+      nodes.push_back(MakeNode(node_id, keys.public_key));
+    const std::vector<NodeId> kTargets(ids.NextIds(1024));
+    const std::string kSuffix("/" + std::to_string(table_size));
+
+    // Includes constructing the table, spread over its table_size additions.
+    runner.Run("RoutingTable::AddNode" + kSuffix, [&](uint64_t iterations) {
+      uint64_t performed(0);
+      while (performed < iterations) {
+        NetworkStatistics network_statistics(kOwnId);
+        RoutingTable routing_table(false, kOwnId, keys, network_statistics);
+        for (const auto& node : nodes)
+          routing_table.AddNode(node);
+        performed += table_size;
+      }
+      return performed;
+    });
+
+    NetworkStatistics network_statistics(kOwnId);
+    RoutingTable routing_table(false, kOwnId, keys, network_statistics);
+    for (const auto& node : nodes)
+      routing_table.AddNode(node);
+    runner.Run("RoutingTable::GetClosestNode" + kSuffix, [&](uint64_t iterations) {
+      for (uint64_t i(0); i != iterations; ++i)
+        routing_table.GetClosestNode(kTargets[i % kTargets.size()]);
+      return iterations;
+    });
+    const RouteHistory kExclude;
+    runner.Run("RoutingTable::GetNodeForSendingMessage" + kSuffix, [&](uint64_t iterations) {
+      for (uint64_t i(0); i != iterations; ++i)
+        routing_table.GetNodeForSendingMessage(kTargets[i % kTargets.size()], kExclude);
+      return iterations;
+    });
+  }
+}
+
+void BenchmarkGroupMatrix(uint32_t seed, const asymm::Keys& keys, Runner& runner) {
+  IdSource ids(seed);
+  const NodeId kOwnId(ids.NextId());
+  GroupMatrix group_matrix(kOwnId, false);
+  std::vector<NodeInfo> peers;
+  for (const auto& node_id : ids.NextIds(Parameters::closest_nodes_size))
+    peers.push_back(MakeNode(node_id, keys.public_key));
+  // Two versions of each peer's row, alternated so that every update changes the matrix.
+  std::vector<std::vector<NodeInfo>> rows[2];
+  std::shared_ptr<MatrixChange> matrix_change;
+  for (const auto& peer : peers) {
+    for (auto& versions : rows) {
+      versions.push_back(std::vector<NodeInfo>());
+      for (const auto& node_id : ids.NextIds(Parameters::closest_nodes_size))
+        versions.back().push_back(MakeNode(node_id, keys.public_key));
+    }
+    matrix_change = group_matrix.AddConnectedPeer(peer, rows[0].back());
+  }
+
+  runner.Run("GroupMatrix::UpdateFromConnectedPeer", [&](uint64_t iterations) {
+    for (uint64_t i(0); i != iterations; ++i) {
+      const size_t kPeer(i % peers.size());
+      const size_t kVersion(((i / peers.size()) + 1) % 2);
+      group_matrix.UpdateFromConnectedPeer(peers[kPeer].node_id, rows[kVersion][kPeer]);
+    }
+    return iterations;
+  });
+
+  const std::vector<NodeId> kTargets(ids.NextIds(1024));
+  runner.Run("MatrixChange::CheckHolders", [&](uint64_t iterations) {
+    for (uint64_t i(0); i != iterations; ++i)
+      matrix_change->CheckHolders(kTargets[i % kTargets.size()]);
+    return iterations;
+  });
+  std::vector<CheckHoldersResult> holders;
+  runner.Run("MatrixChange::CheckHolders/batch", [&](uint64_t iterations) {
+    uint64_t performed(0);
+    for (; performed < iterations; performed += kTargets.size())
+      matrix_change->CheckHolders(kTargets, holders);
+    return performed;
+  });
+}
+
+// Picking the closest few of a thousand candidates, by comparator and by precomputed distances.
+void BenchmarkRanking(uint32_t seed, Runner& runner) {
+  IdSource ids(seed);
+  std::vector<NodeInfo> candidates;
+  for (const auto& node_id : ids.NextIds(1000)) {
+    NodeInfo node_info;
+    node_info.node_id = node_id;
+    candidates.push_back(node_info);
+  }
+  const std::vector<NodeId> kTargets(ids.NextIds(64));
+  const size_t kCount(Parameters::closest_nodes_size);
+  runner.Run("NodeId::CloserToTarget/partial_sort 1000", [&](uint64_t iterations) {
+    for (uint64_t i(0); i != iterations; ++i) {
+      const NodeId& target(kTargets[i % kTargets.size()]);
+      std::vector<NodeInfo> copy(candidates);
+      std::partial_sort(copy.begin(), copy.begin() + kCount, copy.end(),
+                        [&target](const NodeInfo & lhs, const NodeInfo & rhs) {
+        return NodeId::CloserToTarget(lhs.node_id, rhs.node_id, target);
+      });
+    }
+    return iterations;
+  });
+  runner.Run("RankFromTarget/1000", [&](uint64_t iterations) {
+    for (uint64_t i(0); i != iterations; ++i)
+      RankFromTarget(candidates.begin(), candidates.end(), kTargets[i % kTargets.size()], kCount);
+    return iterations;
+  });
+}
+
+void BenchmarkNetworkStatistics(uint32_t seed, Runner& runner) {
+  IdSource ids(seed);
+  const NodeId kOwnId(ids.NextId());
+  NetworkStatistics network_statistics(kOwnId);
+  std::vector<NodeId> unique_nodes(ids.NextIds(Parameters::closest_nodes_size));
+  network_statistics.UpdateLocalAverageDistance(unique_nodes);
+  const std::vector<NodeId> kSenders(ids.NextIds(1024)), kInfos(ids.NextIds(1024));
+  runner.Run("NetworkStatistics::EstimateInGroup", [&](uint64_t iterations) {
+    for (uint64_t i(0); i != iterations; ++i) {
+      network_statistics.EstimateInGroup(kSenders[i % kSenders.size()],
+                                         kInfos[(i * 7) % kInfos.size()]);
+    }
+    return iterations;
+  });
+}
+
+void BenchmarkTimer(Runner& runner) {
+  AsioService asio_service(1);
+  Timer<std::string> timer(asio_service);
+  const std::string kResponse(64, 'r');
+  const Timer<std::string>::ResponseFunctor kFunctor([](std::string) {});  // NOLINT
+  runner.Run("Timer::AddTask+AddResponse", [&](uint64_t iterations) {
+    for (uint64_t i(0); i != iterations; ++i) {
+      TaskId task_id(timer.NewTaskId());
+      timer.AddTask(std::chrono::seconds(10), kFunctor, 1, task_id);
+      timer.AddResponse(task_id, kResponse);
+    }
+    return iterations;
+  });
+}
+
+void BenchmarkProtobuf(uint32_t seed, Runner& runner) {
+  IdSource ids(seed);
+  protobuf::Message message;
+  message.set_source_id(ids.NextId().string());
+  message.set_destination_id(ids.NextId().string());
+  message.set_routing_message(false);
+  message.set_direct(false);
+  message.set_replication(Parameters::group_size);
+  message.set_type(101);
+  message.set_id(1234);
+  message.set_client_node(false);
+  message.set_request(true);
+  message.set_hops_to_live(Parameters::hops_to_live);
+  message.add_data(std::string(1024, 'd'));
+  for (uint64_t i(0); i != 4; ++i)
+    message.add_route_history(i << 40);
+  std::string serialised;
+  runner.Run("protobuf::Message::Serialize/1KiB", [&](uint64_t iterations) {
+    for (uint64_t i(0); i != iterations; ++i) {
+      serialised.clear();
+      message.SerializeToString(&serialised);
+    }
+    return iterations;
+  });
+  protobuf::Message parsed;
+  runner.Run("protobuf::Message::Parse/1KiB", [&](uint64_t iterations) {
+    for (uint64_t i(0); i != iterations; ++i)
+      parsed.ParseFromString(serialised);
+    return iterations;
+  });
+}
+
+void WriteJson(std::ostream& stream, uint32_t seed, const std::vector<Result>& results) {
+  stream << "{\n  \"seed\": " << seed << ",\n  \"benchmarks\": [\n";
+  for (size_t i(0); i != results.size(); ++i) {
+    stream << "    {\"name\": \"" << results[i].name << "\", \"iterations\": "
+           << results[i].iterations << ", \"ns_per_op\": " << std::fixed << std::setprecision(2)
+           << results[i].nanoseconds_per_op << "}" << (i + 1 == results.size() ? "\n" : ",\n");
+  }
+  stream << "  ]\n}\n";
+}
+
+void PrintChurnReport(std::ostream& stream, size_t node_count, const test::ChurnReport& report) {
+  typedef std::chrono::duration<double, std::milli> Milliseconds;
+  stream << std::fixed << std::setprecision(2) << "Churn replay over " << node_count
+         << " nodes, " << report.events << " events (" << report.unsettled_events
+         << " unsettled)\n"
+         << "  time to stable: mean "
+         << std::chrono::duration_cast<Milliseconds>(report.mean_time_to_stable).count()
+         << " ms, max "
+         << std::chrono::duration_cast<Milliseconds>(report.max_time_to_stable).count()
+         << " ms\n"
+         << "  per event: " << report.connects_per_event << " Connect, "
+         << report.find_nodes_per_event << " FindNodes, "
+         << report.closest_nodes_updates_per_event << " ClosestNodesUpdate, "
+         << report.matrix_changes_per_event << " matrix changes\n"
+         << "  matrix changes per node per second: " << report.matrix_changes_per_node_second
+         << "\n  CPU per node: " << report.cpu_microseconds_per_node << " us\n";
+}
+
+void WriteChurnJson(std::ostream& stream, uint32_t seed, size_t node_count,
+                    const test::ChurnReport& report) {
+  typedef std::chrono::duration<double, std::milli> Milliseconds;
+  stream << std::fixed << std::setprecision(2) << "{\n  \"seed\": " << seed
+         << ",\n  \"nodes\": " << node_count << ",\n  \"events\": " << report.events
+         << ",\n  \"unsettled_events\": " << report.unsettled_events
+         << ",\n  \"mean_time_to_stable_ms\": "
+         << std::chrono::duration_cast<Milliseconds>(report.mean_time_to_stable).count()
+         << ",\n  \"max_time_to_stable_ms\": "
+         << std::chrono::duration_cast<Milliseconds>(report.max_time_to_stable).count()
+         << ",\n  \"connects_per_event\": " << report.connects_per_event
+         << ",\n  \"find_nodes_per_event\": " << report.find_nodes_per_event
+         << ",\n  \"closest_nodes_updates_per_event\": "
+         << report.closest_nodes_updates_per_event
+         << ",\n  \"matrix_changes_per_event\": " << report.matrix_changes_per_event
+         << ",\n  \"matrix_changes_per_node_second\": " << report.matrix_changes_per_node_second
+         << ",\n  \"cpu_us_per_node\": " << report.cpu_microseconds_per_node << "\n}\n";
+}
+
+// Replays trace_path, or if that's empty event_count alternating joins and leaves interval apart,
+// against a simulated network of node_count nodes.
+int RunChurn(uint32_t seed, size_t node_count, const std::string& trace_path, size_t event_count,
+             std::chrono::milliseconds interval, const std::string& json_path) {
+  std::vector<test::ChurnEvent> trace;
+  if (trace_path.empty()) {
+    trace = test::MakeChurnTrace(event_count, interval);
+  } else {
+    std::ifstream trace_file(trace_path);
+    if (!trace_file || !test::ParseChurnTrace(trace_file, trace)) {
+      std::cout << "Failed to read churn trace " << trace_path << '\n';
+      return 1;
+    }
+  }
+  test::SimulatedNetwork network(seed, test::LinkProfile());
+  network.Populate(node_count);
+  const test::ChurnReport kReport(test::ReplayChurn(network, trace));
+  PrintChurnReport(std::cout, node_count, kReport);
+  if (!json_path.empty()) {
+    std::ofstream json(json_path);
+    WriteChurnJson(json, seed, node_count, kReport);
+    if (!json) {
+      std::cout << "Failed to write " << json_path << '\n';
+      return 1;
+    }
+  }
+  return 0;
+}
+
+struct HopResult {
+  uint16_t table_size;
+  double mean_entries;  // routing table entries per node, once populated
+  test::SimulationStatistics statistics;
+};
+
+// Sends message_count messages between random nodes of a simulated network of node_count nodes
+// for each routing table size from the default up to InstanceParameters::kLargeRoutingTableSize,
+// doubling each time, and reports the hops they took.
+int RunHops(uint32_t seed, size_t node_count, size_t message_count, const std::string& json_path) {
+  std::vector<HopResult> results;
+  for (uint32_t table_size(Parameters::max_routing_table_size);
+       table_size <= InstanceParameters::kLargeRoutingTableSize && table_size < node_count;
+       table_size *= 2) {
+    const InstanceParameters kParameters(
+        table_size == Parameters::max_routing_table_size
+            ? InstanceParameters()
+            : InstanceParameters::LargeTable(static_cast<uint16_t>(table_size)));
+    test::SimulatedNetwork network(seed, test::LinkProfile(), kParameters);
+    network.Populate(node_count);
+    const std::vector<NodeId> kNodeIds(network.LiveNodeIds());
+    size_t entries(0);
+    for (const auto& node_id : kNodeIds)
+      entries += network.routing_table(node_id).size();
+    std::mt19937 engine(seed);
+    std::uniform_int_distribution<size_t> distribution(0, kNodeIds.size() - 1);
+    for (size_t i(0); i != message_count; ++i)
+      network.Send(kNodeIds[distribution(engine)], kNodeIds[distribution(engine)], false);
+    network.Run();
+    HopResult result;
+    result.table_size = static_cast<uint16_t>(table_size);
+    result.mean_entries = static_cast<double>(entries) / kNodeIds.size();
+    result.statistics = network.statistics();
+    results.push_back(result);
+    std::cout << std::fixed << std::setprecision(2) << "table size " << std::setw(5)
+              << table_size << ": " << std::setw(8) << result.mean_entries << " entries, "
+              << result.statistics.AverageHops() << " mean hops, " << result.statistics.max_hops
+              << " max, " << result.statistics.messages_delivered << " of "
+              << result.statistics.messages_sent << " delivered\n";
+  }
+  if (!json_path.empty()) {
+    std::ofstream json(json_path);
+    json << std::fixed << std::setprecision(2) << "{\n  \"seed\": " << seed
+         << ",\n  \"nodes\": " << node_count << ",\n  \"messages\": " << message_count
+         << ",\n  \"results\": [\n";
+    for (size_t i(0); i != results.size(); ++i) {
+      json << "    {\"table_size\": " << results[i].table_size
+           << ", \"mean_entries\": " << results[i].mean_entries
+           << ", \"mean_hops\": " << results[i].statistics.AverageHops()
+           << ", \"max_hops\": " << results[i].statistics.max_hops
+           << ", \"delivered\": " << results[i].statistics.messages_delivered << "}"
+           << (i + 1 == results.size() ? "\n" : ",\n");
+    }
+    json << "  ]\n}\n";
+    if (!json) {
+      std::cout << "Failed to write " << json_path << '\n';
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// This process's resident memory in bytes, or 0 where that isn't known.
+size_t ResidentBytes() {
+#if defined MAIDSAFE_LINUX
+  std::ifstream statm("/proc/self/statm");
+  size_t total_pages(0), resident_pages(0);
+  if (statm >> total_pages >> resident_pages)
+    return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+  return 0;
+}
+
+// Resident memory per client, once settled, of client_count unjoined clients each on one thread.
+size_t ClientResidentBytes(size_t client_count, const InstanceParameters& parameters) {
+  const size_t kBefore(ResidentBytes());
+  std::vector<std::unique_ptr<Routing>> clients;
+  for (size_t i(0); i != client_count; ++i)
+    clients.emplace_back(new Routing(NodeId(NodeId::kRandomId), 1, parameters));
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+  const size_t kAfter(ResidentBytes());
+  return kAfter > kBefore ? (kAfter - kBefore) / client_count : 0;
+}
+
+// Compares the steady-state resident memory of client_count lean clients against that of default
+// clients measured in the same run, and against budget_bytes per client where that is non-zero.
+// The budget is meant to be one recorded from an earlier run on the same platform.
+int RunClientRss(size_t client_count, size_t budget_bytes, const std::string& json_path) {
+  if (ResidentBytes() == 0) {
+    std::cout << "Resident memory isn't available on this platform\n";
+    return 1;
+  }
+  const size_t kDefaultBytes(ClientResidentBytes(client_count, InstanceParameters())),
+      kLeanBytes(ClientResidentBytes(client_count, InstanceParameters::LeanClient()));
+  const bool kLeaner(kLeanBytes < kDefaultBytes),
+      kWithinBudget(budget_bytes == 0 || kLeanBytes <= budget_bytes);
+  std::cout << client_count << " clients, resident KiB per client: default " << kDefaultBytes / 1024
+            << ", lean " << kLeanBytes / 1024;
+  if (budget_bytes != 0)
+    std::cout << " (budget " << budget_bytes / 1024 << ")";
+  std::cout << (kLeaner ? "" : " NOT LEANER") << (kWithinBudget ? "" : " OVER BUDGET") << '\n';
+  if (!json_path.empty()) {
+    std::ofstream json(json_path);
+    json << "{\n  \"clients\": " << client_count << ",\n  \"default_bytes_per_client\": "
+         << kDefaultBytes << ",\n  \"lean_bytes_per_client\": " << kLeanBytes
+         << ",\n  \"lean_budget_bytes\": " << budget_bytes << "\n}\n";
+    if (!json) {
+      std::cout << "Failed to write " << json_path << '\n';
+      return 1;
+    }
+  }
+  return kLeaner && kWithinBudget ? 0 : 1;
+}
+
+// Times the construction of client_count unjoined clients in turn, along with the startup phases
+// each recorded.  An unjoined client builds no message handling, so only the construct phase is
+// reached here; BENCHrouting_e2e reports all three phases for clients joining a network.
+int RunClientStartup(size_t client_count, const std::string& json_path) {
+  typedef std::chrono::duration<double, std::micro> Microseconds;
+  Microseconds construct_total(0);
+  std::vector<double> phase_totals(static_cast<size_t>(StartupPhase::kCount), 0.0);
+  for (size_t i(0); i != client_count; ++i) {
+    const auto kStart(std::chrono::steady_clock::now());
+    Routing client(NodeId(NodeId::kRandomId), 1);
+    construct_total += std::chrono::steady_clock::now() - kStart;
+    const MetricsSnapshot kSnapshot(client.GetMetricsSnapshot());
+    for (size_t phase(0); phase != phase_totals.size(); ++phase)
+      phase_totals[phase] += static_cast<double>(kSnapshot.startup_us[phase]);
+  }
+  const double kCount(static_cast<double>(client_count));
+  std::cout << client_count << " clients, mean microseconds: construct "
+            << construct_total.count() / kCount << '\n';
+  for (size_t phase(0); phase != phase_totals.size(); ++phase) {
+    std::cout << "  " << StartupPhaseName(phase) << " phase " << phase_totals[phase] / kCount
+              << (phase_totals[phase] == 0.0 ? " (not reached)" : "") << '\n';
+  }
+  if (!json_path.empty()) {
+    std::ofstream json(json_path);
+    json << "{\n  \"clients\": " << client_count << ",\n  \"construct_us\": "
+         << construct_total.count() / kCount;
+    for (size_t phase(0); phase != phase_totals.size(); ++phase) {
+      json << ",\n  \"" << StartupPhaseName(phase) << "_phase_us\": "
+           << phase_totals[phase] / kCount;
+    }
+    json << "\n}\n";
+    if (!json) {
+      std::cout << "Failed to write " << json_path << '\n';
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Replays the received messages of a capture made with Routing::CaptureMessages against a
+// MessageHandler (see test::ReplayCapture), reporting how long handling them took.
+int RunReplay(const std::string& capture_path, double speed, const std::string& json_path) {
+  test::ReplayReport report;
+  try {
+    report = test::ReplayCapture(capture_path, speed);
+  }
+  catch (const std::exception& e) {
+    std::cout << "Failed to replay " << capture_path << ": " << e.what() << '\n';
+    return 1;
+  }
+  typedef std::chrono::duration<double, std::micro> Microseconds;
+  const double kElapsedUs(std::chrono::duration_cast<Microseconds>(report.elapsed).count()),
+      kHandlingUs(std::chrono::duration_cast<Microseconds>(report.handling).count()),
+      kPerMessageUs(report.handled == 0 ? 0.0 : kHandlingUs / report.handled);
+  std::cout << report.received << " messages replayed in " << kElapsedUs / 1000.0 << " ms, "
+            << report.unparsed << " unparsed, mean handling " << kPerMessageUs << " us\n";
+  if (!json_path.empty()) {
+    std::ofstream json(json_path);
+    json << "{\n  \"capture\": \"" << capture_path << "\",\n  \"speed\": " << speed
+         << ",\n  \"received\": " << report.received << ",\n  \"handled\": " << report.handled
+         << ",\n  \"unparsed\": " << report.unparsed << ",\n  \"elapsed_us\": " << kElapsedUs
+         << ",\n  \"handling_us\": " << kHandlingUs << ",\n  \"handling_us_per_message\": "
+         << kPerMessageUs << "\n}\n";
+    if (!json) {
+      std::cout << "Failed to write " << json_path << '\n';
+      return 1;
+    }
+  }
+  return 0;
+}
+
+}  // unnamed namespace
+
+}  // namespace benchmark
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+int main(int argc, char** argv) {
+  using maidsafe::routing::benchmark::Result;
+  namespace bm = maidsafe::routing::benchmark;
+  uint32_t seed(1);
+  int min_time_ms(200), churn_interval_ms(1000);
+  size_t churn_nodes(0), churn_events(100), client_rss(0), client_rss_budget(0),
+      client_startup(0), hop_nodes(0), hop_messages(1000);
+  double replay_speed(0.0);
+  std::string json_path, filter, churn_trace, replay;
+  po::options_description description("BENCHrouting options");
+  description.add_options()("help,h", "Print this message.")(
+      "seed", po::value<uint32_t>(&seed)->default_value(seed), "Seed for generated ids.")(
+      "min_time_ms", po::value<int>(&min_time_ms)->default_value(min_time_ms),
+      "Minimum duration of each benchmark's timed batch.")(
+      "filter", po::value<std::string>(&filter), "Only run benchmarks whose names contain this.")(
+      "json", po::value<std::string>(&json_path), "Also write results as JSON to this file.")(
+      "churn_nodes", po::value<size_t>(&churn_nodes),
+      "Instead of the microbenchmarks, replay churn against a simulated network of this many "
+      "nodes.")(
+      "churn_trace", po::value<std::string>(&churn_trace),
+      "File of \"<milliseconds> join|leave\" lines to replay.  If not given, joins and leaves "
+      "alternate.")(
+      "churn_events", po::value<size_t>(&churn_events)->default_value(churn_events),
+      "Number of generated churn events.")(
+      "churn_interval_ms", po::value<int>(&churn_interval_ms)->default_value(churn_interval_ms),
+      "Time between generated churn events.")(
+      "hop_nodes", po::value<size_t>(&hop_nodes),
+      "Instead of the microbenchmarks, measure hop counts against routing table size in a "
+      "simulated network of this many nodes.")(
+      "hop_messages", po::value<size_t>(&hop_messages)->default_value(hop_messages),
+      "Number of messages sent per routing table size.")(
+      "client_rss", po::value<size_t>(&client_rss),
+      "Instead of the microbenchmarks, measure the resident memory of this many lean clients "
+      "against that of default clients.")(
+      "client_rss_budget", po::value<size_t>(&client_rss_budget),
+      "Resident bytes per lean client to fail --client_rss above, as recorded by an earlier run.")(
+      "client_startup", po::value<size_t>(&client_startup),
+      "Instead of the microbenchmarks, time the construction of this many unjoined clients.")(
+      "replay", po::value<std::string>(&replay),
+      "Instead of the microbenchmarks, replay the received messages of this capture (see "
+      "Routing::CaptureMessages) against a message handler.")(
+      "replay_speed", po::value<double>(&replay_speed)->default_value(replay_speed),
+      "Multiple of the capture's own timing to replay at; 0 replays as fast as possible.");
+  try {
+    po::variables_map variables_map;
+    po::store(po::parse_command_line(argc, argv, description), variables_map);
+    po::notify(variables_map);
+    if (variables_map.count("help")) {
+      std::cout << description << '\n';
+      return 0;
+    }
+  }
+  catch (const std::exception& e) {
+    std::cout << "Error: " << e.what() << '\n' << description << '\n';
+    return 1;
+  }
+
+  if (churn_nodes != 0) {
+    return bm::RunChurn(seed, churn_nodes, churn_trace, churn_events,
+                        std::chrono::milliseconds(churn_interval_ms), json_path);
+  }
+
+  if (hop_nodes != 0)
+    return bm::RunHops(seed, hop_nodes, hop_messages, json_path);
+
+  if (client_rss != 0)
+    return bm::RunClientRss(client_rss, client_rss_budget, json_path);
+
+  if (client_startup != 0)
+    return bm::RunClientStartup(client_startup, json_path);
+
+  if (!replay.empty())
+    return bm::RunReplay(replay, replay_speed, json_path);
+
+  bm::Runner runner(std::chrono::milliseconds(min_time_ms), filter);
+  const maidsafe::asymm::Keys kKeys(maidsafe::asymm::GenerateKeyPair());
+  bm::BenchmarkRoutingTable(seed, kKeys, runner);
+  bm::BenchmarkGroupMatrix(seed, kKeys, runner);
+  bm::BenchmarkRanking(seed, runner);
+  bm::BenchmarkNetworkStatistics(seed, runner);
+  bm::BenchmarkTimer(runner);
+  bm::BenchmarkProtobuf(seed, runner);
+
+  const std::vector<Result>& results(runner.results());
+  for (const auto& result : results) {
+    std::cout << std::left << std::setw(48) << result.name << std::right << std::setw(12)
+              << result.iterations << std::setw(14) << std::fixed << std::setprecision(2)
+              << result.nanoseconds_per_op << " ns/op\n";
+  }
+  if (!json_path.empty()) {
+    std::ofstream json(json_path);
+    bm::WriteJson(json, seed, results);
+    if (!json) {
+      std::cout << "Failed to write " << json_path << '\n';
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,311 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+// Measures end-to-end throughput and latency over a loopback network of real Routing objects (see
+// GenericNetwork), driven by the same LoadGenerator as routing_node's load command.  Each scenario
+// is run closed loop at each payload size, and results can be written as JSON for tracking across
+// releases; the "schema" field changes only if existing fields do.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <fstream>   // NOLINT
+#include <iomanip>
+#include <iostream>  // NOLINT
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "boost/program_options.hpp"
+
+#include "maidsafe/common/node_id.h"
+
+#include "maidsafe/routing/metrics.h"
+#include "maidsafe/routing/metrics_snapshot.h"
+#include "maidsafe/routing/routing_api.h"
+#include "maidsafe/routing/tests/routing_network.h"
+#include "maidsafe/routing/tools/load_generator.h"
+
+namespace po = boost::program_options;
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace benchmark {
+
+namespace {
+
+const int kJsonSchema(1);
+
+enum class Scenario { kDirect, kGroup, kTyped, kClient };
+
+const char* ScenarioName(Scenario scenario) {
+  switch (scenario) {
+    case Scenario::kDirect:
+      return "direct";
+    case Scenario::kGroup:
+      return "group";
+    case Scenario::kTyped:
+      return "typed";
+    default:
+      return "client";
+  }
+}
+
+struct E2eResult {
+  E2eResult() : scenario(), payload_size(0), report(), cpu_us_per_message(0.0), hops() {}
+  Scenario scenario;
+  size_t payload_size;
+  test::LoadReport report;
+  double cpu_us_per_message;
+  // hops[i] is the number of node level messages delivered after i hops, across all nodes.
+  std::vector<uint64_t> hops;
+};
+
+// Node level messages delivered after each number of hops, summed over the network's nodes.
+std::vector<uint64_t> DeliveredHops(const test::GenericNetwork& network) {
+  std::vector<uint64_t> hops;
+  for (const auto& node : network.nodes_) {
+    const MetricsSnapshot kSnapshot(node->routing()->GetMetricsSnapshot());
+    for (auto hop_class : {HopClass::kDirect, HopClass::kGroup}) {
+      if (static_cast<size_t>(hop_class) >= kSnapshot.hops_by_class.size())
+        continue;
+      const auto& counts(kSnapshot.hops_by_class[static_cast<size_t>(hop_class)]);
+      hops.resize(std::max(hops.size(), counts.size()));
+      for (size_t i(0); i != counts.size(); ++i)
+        hops[i] += counts[i];
+    }
+  }
+  return hops;
+}
+
+// Mean microseconds each StartupPhase took across the network's clients, which have all joined.
+std::vector<double> ClientStartupMeans(const test::GenericNetwork& network) {
+  std::vector<double> means(static_cast<size_t>(StartupPhase::kCount), 0.0);
+  const size_t kClientCount(network.nodes_.size() - network.ClientIndex());
+  if (kClientCount == 0)
+    return means;
+  for (size_t i(network.ClientIndex()); i != network.nodes_.size(); ++i) {
+    const MetricsSnapshot kSnapshot(network.nodes_[i]->routing()->GetMetricsSnapshot());
+    for (size_t phase(0); phase != means.size() && phase != kSnapshot.startup_us.size(); ++phase)
+      means[phase] += static_cast<double>(kSnapshot.startup_us[phase]) / kClientCount;
+  }
+  return means;
+}
+
+E2eResult RunScenario(test::GenericNetwork& network, Scenario scenario, size_t payload_size,
+                      const test::LoadProfile& base_profile) {
+  // Clients' messages are relayed through the vaults they're connected to.
+  const size_t kSource(scenario == Scenario::kClient ? network.ClientIndex()
+                                                     : network.ClientIndex() - 1);
+  std::vector<NodeId> destinations;
+  for (size_t i(0); i != network.ClientIndex(); ++i) {
+    if (i != kSource)
+      destinations.push_back(network.nodes_[i]->node_id());
+  }
+  test::LoadProfile profile(base_profile);
+  profile.payload_size = profile.max_payload_size = payload_size;
+  profile.direct_weight = scenario == Scenario::kDirect || scenario == Scenario::kClient ? 1 : 0;
+  profile.group_weight = scenario == Scenario::kGroup ? 1 : 0;
+  profile.typed_weight = scenario == Scenario::kTyped ? 1 : 0;
+
+  E2eResult result;
+  result.scenario = scenario;
+  result.payload_size = payload_size;
+  const std::vector<uint64_t> kHopsBefore(DeliveredHops(network));
+  const std::clock_t kCpuStart(std::clock());
+  test::LoadGenerator load_generator(network.nodes_[kSource], destinations);
+  result.report = load_generator.Run(profile);
+  const uint64_t kSent(result.report.direct_sent + result.report.group_sent +
+                       result.report.typed_sent);
+  result.cpu_us_per_message = 1e6 * static_cast<double>(std::clock() - kCpuStart) /
+                              CLOCKS_PER_SEC / static_cast<double>(std::max<uint64_t>(kSent, 1));
+  result.hops = DeliveredHops(network);
+  for (size_t i(0); i != kHopsBefore.size(); ++i)
+    result.hops[i] -= kHopsBefore[i];
+  while (!result.hops.empty() && result.hops.back() == 0)
+    result.hops.pop_back();
+  return result;
+}
+
+double MessagesPerSecond(const test::LoadReport& report) {
+  const double kSeconds(std::chrono::duration<double>(report.elapsed).count());
+  return kSeconds > 0.0 ? (report.direct_sent + report.group_sent + report.typed_sent) / kSeconds
+                        : 0.0;
+}
+
+// Direct and client scenarios are timed to their response, group ones to their last response.
+// Typed messages are one way, so have no latencies.
+const test::LatencyHistogram& Latency(const E2eResult& result) {
+  return result.scenario == Scenario::kGroup ? result.report.group_latency
+                                             : result.report.direct_latency;
+}
+
+void PrintResult(std::ostream& stream, const E2eResult& result) {
+  const test::LatencyHistogram& kLatency(Latency(result));
+  auto milliseconds([](std::chrono::microseconds value) { return value.count() / 1000.0; });
+  stream << std::fixed << std::setprecision(2) << std::left << std::setw(7)
+         << ScenarioName(result.scenario) << std::right << std::setw(7) << result.payload_size
+         << " B: " << std::setw(9) << MessagesPerSecond(result.report) << " msg/s, p50 "
+         << milliseconds(kLatency.Percentile(0.5)) << " ms, p99 "
+         << milliseconds(kLatency.Percentile(0.99)) << " ms, " << result.cpu_us_per_message
+         << " CPU us/msg, " << result.report.failed << " failed, hops";
+  for (auto count : result.hops)
+    stream << ' ' << count;
+  stream << '\n';
+}
+
+void PrintClientStartup(std::ostream& stream, const std::vector<double>& startup_means) {
+  stream << std::fixed << std::setprecision(2) << "client startup, mean us:";
+  for (size_t phase(0); phase != startup_means.size(); ++phase)
+    stream << ' ' << StartupPhaseName(phase) << ' ' << startup_means[phase];
+  stream << '\n';
+}
+
+void WriteJson(std::ostream& stream, size_t vaults, size_t clients,
+               const test::LoadProfile& profile, const std::vector<double>& startup_means,
+               const std::vector<E2eResult>& results) {
+  stream << std::fixed << std::setprecision(2) << "{\n  \"schema\": " << kJsonSchema
+         << ",\n  \"vaults\": " << vaults << ",\n  \"clients\": " << clients
+         << ",\n  \"messages\": " << profile.message_count << ",\n  \"threads\": "
+         << profile.threads << ",\n  \"concurrency\": " << profile.max_outstanding
+         << ",\n  \"client_startup_us\": {";
+  for (size_t phase(0); phase != startup_means.size(); ++phase) {
+    stream << (phase == 0 ? "\"" : ", \"") << StartupPhaseName(phase)
+           << "\": " << startup_means[phase];
+  }
+  stream << "},\n  \"results\": [\n";
+  for (size_t i(0); i != results.size(); ++i) {
+    const E2eResult& result(results[i]);
+    const test::LatencyHistogram& kLatency(Latency(result));
+    stream << "    {\"scenario\": \"" << ScenarioName(result.scenario)
+           << "\", \"payload_bytes\": " << result.payload_size
+           << ", \"sent\": " << result.report.direct_sent + result.report.group_sent +
+                                    result.report.typed_sent
+           << ", \"succeeded\": " << result.report.succeeded
+           << ", \"failed\": " << result.report.failed
+           << ", \"msgs_per_s\": " << MessagesPerSecond(result.report)
+           << ", \"msgs_per_s_per_node\": "
+           << MessagesPerSecond(result.report) / static_cast<double>(vaults + clients)
+           << ", \"p50_us\": " << kLatency.Percentile(0.5).count()
+           << ", \"p90_us\": " << kLatency.Percentile(0.9).count()
+           << ", \"p99_us\": " << kLatency.Percentile(0.99).count()
+           << ", \"p999_us\": " << kLatency.Percentile(0.999).count()
+           << ", \"max_us\": " << kLatency.max().count()
+           << ", \"cpu_us_per_msg\": " << result.cpu_us_per_message << ", \"hops\": [";
+    for (size_t hop(0); hop != result.hops.size(); ++hop)
+      stream << (hop == 0 ? "" : ", ") << result.hops[hop];
+    stream << "]}" << (i + 1 == results.size() ? "\n" : ",\n");
+  }
+  stream << "  ]\n}\n";
+}
+
+}  // unnamed namespace
+
+}  // namespace benchmark
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+int main(int argc, char** argv) {
+  namespace bm = maidsafe::routing::benchmark;
+  namespace test = maidsafe::routing::test;
+  size_t vaults(16), clients(2);
+  std::vector<size_t> payload_sizes;
+  std::vector<std::string> scenario_names;
+  std::string json_path;
+  test::LoadProfile profile;
+  profile.message_count = 1000;
+  profile.rate = 0.0;  // closed loop: each thread sends as soon as a slot is free
+  profile.max_outstanding = 32;
+  po::options_description description("BENCHrouting_e2e options");
+  description.add_options()("help,h", "Print this message.")(
+      "vaults", po::value<size_t>(&vaults)->default_value(vaults),
+      "Vaults in the loopback network, at least 2.")(
+      "clients", po::value<size_t>(&clients)->default_value(clients),
+      "Clients in the network; the client scenario needs at least one.")(
+      "messages", po::value<size_t>(&profile.message_count)->default_value(profile.message_count),
+      "Messages sent per scenario and payload size.")(
+      "payload_sizes", po::value<std::vector<size_t>>(&payload_sizes)->multitoken(),
+      "Payload sizes in bytes to run each scenario at (default 1024).")(
+      "concurrency",
+      po::value<size_t>(&profile.max_outstanding)->default_value(profile.max_outstanding),
+      "Messages kept awaiting responses at once.")(
+      "threads", po::value<size_t>(&profile.threads)->default_value(profile.threads),
+      "Sending threads.")(
+      "scenarios", po::value<std::vector<std::string>>(&scenario_names)->multitoken(),
+      "Any of direct, group, typed and client (default all).  Typed messages are one way, so "
+      "are counted but not timed.")(
+      "json", po::value<std::string>(&json_path), "Also write results as JSON to this file.");
+  try {
+    po::variables_map variables_map;
+    po::store(po::parse_command_line(argc, argv, description), variables_map);
+    po::notify(variables_map);
+    if (variables_map.count("help")) {
+      std::cout << description << '\n';
+      return 0;
+    }
+  }
+  catch (const std::exception& e) {
+    std::cout << "Error: " << e.what() << '\n' << description << '\n';
+    return 1;
+  }
+  if (payload_sizes.empty())
+    payload_sizes.push_back(1024);
+  std::vector<bm::Scenario> scenarios;
+  for (auto scenario : {bm::Scenario::kDirect, bm::Scenario::kGroup, bm::Scenario::kTyped,
+                        bm::Scenario::kClient}) {
+    if ((scenario_names.empty() && (scenario != bm::Scenario::kClient || clients != 0)) ||
+        std::find(scenario_names.begin(), scenario_names.end(), bm::ScenarioName(scenario)) !=
+            scenario_names.end())
+      scenarios.push_back(scenario);
+  }
+  if (vaults < 2 || scenarios.empty() ||
+      (clients == 0 &&
+       std::find(scenarios.begin(), scenarios.end(), bm::Scenario::kClient) != scenarios.end())) {
+    std::cout << "Nothing to run with these options\n" << description << '\n';
+    return 1;
+  }
+
+  test::GenericNetwork network;
+  network.SetUp();
+  network.SetUpNetwork(vaults, clients);
+  const std::vector<double> kStartupMeans(bm::ClientStartupMeans(network));
+  if (clients != 0)
+    bm::PrintClientStartup(std::cout, kStartupMeans);
+  std::vector<bm::E2eResult> results;
+  for (auto scenario : scenarios) {
+    for (auto payload_size : payload_sizes) {
+      results.push_back(bm::RunScenario(network, scenario, payload_size, profile));
+      bm::PrintResult(std::cout, results.back());
+    }
+  }
+  network.TearDown();
+  if (!json_path.empty()) {
+    std::ofstream json(json_path);
+    bm::WriteJson(json, vaults, clients, profile, kStartupMeans, results);
+    if (!json) {
+      std::cout << "Failed to write " << json_path << '\n';
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -316,11 +316,7 @@ bool GenericNode::RoutingTableHasNode(const NodeId& node_id) {
 }
 
 bool GenericNode::ClientRoutingTableHasNode(const NodeId& node_id) {
-  return std::find_if(routing_->pimpl_->client_routing_table_.nodes_.begin(),
-                      routing_->pimpl_->client_routing_table_.nodes_.end(),
-                      [&node_id](const NodeInfo & node_info) {
-           return (node_id == node_info.node_id);
-         }) != routing_->pimpl_->client_routing_table_.nodes_.end();
+  return routing_->pimpl_->client_routing_table_.Contains(node_id);
 }
 
 NodeInfo GenericNode::GetRemovableNode() {
@@ -360,6 +356,10 @@ void GenericNode::Join(const std::vector<Endpoint>& peer_endpoints) {
   routing_->Join(functors_, peer_endpoints);
 }
 
+void GenericNode::UseNetworkManifest(const std::vector<NodeId>& node_ids) {
+  routing_->UseNetworkManifest(node_ids);
+}
+
 void GenericNode::set_joined(const bool node_joined) { joined_ = node_joined; }
 
 bool GenericNode::joined() const { return joined_; }
@@ -373,7 +373,7 @@ void GenericNode::PrintRoutingTable() {
              << (IsClient() ? " (Client)" : " (Vault) :")
              << "Routing table size: " << routing_->pimpl_->routing_table_.nodes_.size();
   {
-    std::lock_guard<std::mutex> lock(routing_->pimpl_->routing_table_.mutex_);
+    boost::shared_lock<boost::shared_mutex> lock(routing_->pimpl_->routing_table_.mutex_);
     for (const auto& node_info : routing_->pimpl_->routing_table_.nodes_) {
       LOG(kInfo) << "\tNodeId : " << HexSubstr(node_info.node_id.string());
     }
@@ -381,14 +381,14 @@ void GenericNode::PrintRoutingTable() {
   LOG(kInfo) << "[" << HexSubstr(node_info_plus_->node_info.node_id.string())
              << "]'s Non-RoutingTable : ";
   std::lock_guard<std::mutex> lock(routing_->pimpl_->client_routing_table_.mutex_);
-  for (const auto& node_info : routing_->pimpl_->client_routing_table_.nodes_) {
-    LOG(kInfo) << "\tNodeId : " << HexSubstr(node_info.node_id.string());
+  for (const auto& node : routing_->pimpl_->client_routing_table_.nodes_) {
+    LOG(kInfo) << "\tNodeId : " << HexSubstr(node.second.node_id.string());
   }
 }
 
 std::vector<NodeId> GenericNode::ReturnRoutingTable() {
   std::vector<NodeId> routing_nodes;
-  std::lock_guard<std::mutex> lock(routing_->pimpl_->routing_table_.mutex_);
+  boost::shared_lock<boost::shared_mutex> lock(routing_->pimpl_->routing_table_.mutex_);
   for (const auto& node_info : routing_->pimpl_->routing_table_.nodes_)
     routing_nodes.push_back(node_info.node_id);
   return routing_nodes;
@@ -428,7 +428,7 @@ void GenericNode::SetHealth(int health) {
 void GenericNode::PostTaskToAsioService(std::function<void()> functor) {
   std::lock_guard<std::mutex> lock(routing_->pimpl_->running_mutex_);
   if (routing_->pimpl_->running_)
-    routing_->pimpl_->asio_service_.service().post(functor);
+    routing_->pimpl_->asio_service_->service().post(functor);
 }
 
 rudp::NatType GenericNode::nat_type() { return routing_->pimpl_->network_.nat_type(); }
@@ -553,6 +553,31 @@ void GenericNetwork::SetUpNetwork(size_t total_number_vaults,
   //    EXPECT_TRUE(ValidateRoutingTables());
 }
 
+void GenericNetwork::SetUpNetworkInParallel(size_t total_number_vaults) {
+  assert(total_number_vaults >= 2);
+  std::vector<NodePtr> new_nodes;
+  std::vector<NodeId> manifest;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& node : nodes_)
+      manifest.push_back(node->node_id());
+  }
+  for (size_t index(2); index < total_number_vaults; ++index) {
+    new_nodes.push_back(NodePtr(new GenericNode(false, false)));
+    manifest.push_back(new_nodes.back()->node_id());
+  }
+
+  std::vector<std::future<void>> joins;
+  for (const auto& node : new_nodes) {
+    node->UseNetworkManifest(manifest);
+    joins.push_back(std::async(std::launch::async, [this, node] { AddNodeDetails(node); }));
+  }
+  for (auto& join : joins)
+    join.get();
+  LOG(kVerbose) << nodes_.size() << " nodes added to network in parallel";
+  PrintRoutingTables();
+}
+
 void GenericNetwork::AddNode(bool client_mode, const NodeId& node_id,
                              MatrixChangedFunctor matrix_change_functor) {
   NodeInfoAndPrivateKey node_info;
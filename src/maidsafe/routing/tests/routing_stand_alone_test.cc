@@ -16,6 +16,7 @@
     See the Licences for the specific language governing permissions and limitations relating to
     use of the MaidSafe Software.                                                                 */
 
+#include <chrono>
 #include <vector>
 
 #include "boost/progress.hpp"
@@ -83,6 +84,16 @@ TEST_F(RoutingStandAloneTest, FUNC_ClientRoutingTableUpdate) {
 
 TEST_F(RoutingStandAloneTest, FUNC_SetupNetwork) { this->SetUpNetwork(kServerSize); }
 
+TEST_F(RoutingStandAloneTest, FUNC_SetupNetworkInParallel) {
+  const auto kStart(std::chrono::steady_clock::now());
+  this->SetUpNetworkInParallel(kServerSize);
+  LOG(kInfo) << kServerSize << " vaults joined in "
+             << std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - kStart).count() << " ms";
+  EXPECT_EQ(kServerSize, this->ClientIndex());
+  EXPECT_TRUE(this->SendDirect(1));
+}
+
 TEST_F(RoutingStandAloneTest, FUNC_SetupSingleClientHybridNetwork) {
   this->SetUpNetwork(kServerSize, 1);
 }
@@ -16,8 +16,11 @@
     See the Licences for the specific language governing permissions and limitations relating to
     use of the MaidSafe Software.                                                                 */
 
+#include <algorithm>
 #include <bitset>
+#include <chrono>
 #include <memory>
+#include <thread>
 #include <vector>
 
 #include "maidsafe/common/log.h"
@@ -65,6 +68,58 @@ TEST(RoutingTableTest, BEH_AddCloseNodes) {
   EXPECT_EQ(Parameters::closest_nodes_size, routing_table.size());
 }
 
+TEST(RoutingTableTest, BEH_AddAndDropNodesInBulk) {
+  NodeId node_id(NodeId::kRandomId);
+  NetworkStatistics network_statistics(node_id);
+  RoutingTable routing_table(false, node_id, asymm::GenerateKeyPair(), network_statistics);
+  std::vector<NodeInfo> nodes;
+  for (uint16_t i = 0; i < 2 * Parameters::closest_nodes_size; ++i)
+    nodes.push_back(MakeNode());
+
+  int status_count(0), removed_count(0), group_change_count(0), matrix_change_count(0);
+  routing_table.InitialiseFunctors([&status_count](int) { ++status_count; },
+                                   [&removed_count](const NodeInfo&, bool) { ++removed_count; },
+                                   []() {},
+                                   [&group_change_count](const std::vector<NodeInfo>,
+                                                         const std::vector<NodeInfo>) {
+                                     ++group_change_count;
+                                   },
+                                   [&matrix_change_count](std::shared_ptr<MatrixChange>) {
+                                     ++matrix_change_count;
+                                   });
+  EXPECT_EQ(nodes.size(), routing_table.AddNodes(nodes).size());
+  EXPECT_EQ(nodes.size(), routing_table.size());
+  EXPECT_EQ(1, status_count);
+  EXPECT_EQ(1, group_change_count);
+  EXPECT_EQ(1, matrix_change_count);
+  // Nodes already held aren't added again, and change nothing.
+  EXPECT_TRUE(routing_table.AddNodes(nodes).empty());
+  EXPECT_EQ(1, status_count);
+
+  std::sort(nodes.begin(), nodes.end(), [&node_id](const NodeInfo & lhs, const NodeInfo & rhs) {
+    return NodeId::CloserToTarget(lhs.node_id, rhs.node_id, node_id);
+  });
+  std::vector<NodeId> closest;
+  for (uint16_t i = 0; i < Parameters::closest_nodes_size; ++i)
+    closest.push_back(nodes.at(i).node_id);
+  EXPECT_EQ(closest, routing_table.GetClosestNodes(node_id, Parameters::closest_nodes_size));
+
+  // Dropping the close group refills it from the nodes left.
+  EXPECT_EQ(closest.size(), routing_table.DropNodes(closest, false).size());
+  EXPECT_EQ(nodes.size() - closest.size(), routing_table.size());
+  EXPECT_EQ(2, status_count);
+  EXPECT_EQ(static_cast<int>(closest.size()), removed_count);
+  EXPECT_EQ(2, group_change_count);
+  EXPECT_EQ(2, matrix_change_count);
+  std::vector<NodeInfo> matrix_nodes(routing_table.GetMatrixNodes());
+  for (size_t i(closest.size()); i != nodes.size(); ++i) {
+    EXPECT_NE(matrix_nodes.end(), std::find_if(matrix_nodes.begin(), matrix_nodes.end(),
+                                               [&](const NodeInfo & node) {
+      return node.node_id == nodes.at(i).node_id;
+    }));
+  }
+}
+
 TEST(RoutingTableTest, FUNC_AddTooManyNodes) {
   NodeId node_id(NodeId::kRandomId);
   NetworkStatistics network_statistics(node_id);
@@ -88,6 +143,30 @@ TEST(RoutingTableTest, FUNC_AddTooManyNodes) {
   EXPECT_EQ(routing_table.size(), Parameters::max_routing_table_size);
 }
 
+TEST(RoutingTableTest, BEH_InstanceParametersLimitSize) {
+  NodeId node_id(NodeId::kRandomId);
+  NetworkStatistics network_statistics(node_id);
+  InstanceParameters parameters;
+  parameters.max_routing_table_size = Parameters::closest_nodes_size + 4;
+  parameters.routing_table_size_threshold = parameters.max_routing_table_size / 2;
+  RoutingTable small_table(false, node_id, asymm::GenerateKeyPair(), network_statistics,
+                           parameters);
+  RoutingTable default_table(false, node_id, asymm::GenerateKeyPair(), network_statistics);
+  EXPECT_EQ(parameters.max_routing_table_size, small_table.kMaxSize());
+  EXPECT_EQ(Parameters::max_routing_table_size, default_table.kMaxSize());
+
+  for (uint16_t i = 0; small_table.size() < parameters.max_routing_table_size; ++i) {
+    NodeInfo node(MakeNode());
+    EXPECT_TRUE(small_table.AddNode(node));
+  }
+  for (uint16_t i = 0; i < 100; ++i) {
+    NodeInfo node(MakeNode());
+    if (small_table.CheckNode(node))
+      EXPECT_TRUE(small_table.AddNode(node));
+  }
+  EXPECT_EQ(parameters.max_routing_table_size, small_table.size());
+}
+
 TEST(RoutingTableTest, BEH_PopulateAndDepopulateGroupCheckGroupChange) {
   NodeId node_id(NodeId::kRandomId);
   NetworkStatistics network_statistics(node_id);
@@ -750,6 +829,112 @@ TEST(RoutingTableTest, BEH_GroupUpdateFromConnectedPeer) {
   }
 }
 
+TEST(RoutingTableTest, BEH_GroupUpdateFromUnmatchedPeer) {
+  NodeId node_id(NodeId::kRandomId);
+  NetworkStatistics network_statistics(node_id);
+  RoutingTable routing_table(false, node_id, asymm::GenerateKeyPair(), network_statistics);
+  std::shared_ptr<MatrixChange> last_change;
+  routing_table.InitialiseFunctors([](int) {}, [](const NodeInfo&, bool) {}, []() {},  // NOLINT
+                                   [](const std::vector<NodeInfo>&,
+                                      const std::vector<NodeInfo> /*old_nodes*/) {},
+                                   [&last_change](std::shared_ptr<MatrixChange> matrix_change) {
+    last_change = matrix_change;
+  });
+  std::vector<NodeInfo> nodes;
+  for (uint16_t i(0); i != Parameters::closest_nodes_size; ++i) {
+    nodes.push_back(MakeNode());
+    ASSERT_TRUE(routing_table.AddNode(nodes.back()));
+  }
+  // A peer in the routing table which isn't yet a connected peer of the matrix is added by the
+  // update, and the change reported includes it.
+  const NodeInfo kPeer(nodes.front());
+  routing_table.group_matrix_.RemoveConnectedPeer(kPeer);
+  auto members(routing_table.group_matrix_.members()->ids);
+  ASSERT_EQ(std::end(members), std::find(std::begin(members), std::end(members), kPeer.node_id));
+  last_change.reset();
+  std::vector<NodeInfo> row(1, MakeNode());
+  routing_table.GroupUpdateFromConnectedPeer(kPeer.node_id, row);
+  ASSERT_NE(nullptr, last_change);
+  auto new_nodes(last_change->new_nodes());
+  EXPECT_NE(std::end(new_nodes),
+            std::find(std::begin(new_nodes), std::end(new_nodes), kPeer.node_id));
+  members = last_change->old_members()->ids;
+  EXPECT_EQ(std::end(members), std::find(std::begin(members), std::end(members), kPeer.node_id));
+}
+
+TEST(RoutingTableTest, BEH_LeanClientKeepsOnlyConnectedPeers) {
+  NodeId node_id(NodeId::kRandomId);
+  NetworkStatistics network_statistics(node_id);
+  const asymm::Keys kKeys(asymm::GenerateKeyPair());
+  RoutingTable lean_table(true, node_id, kKeys, network_statistics,
+                          InstanceParameters::LeanClient());
+  RoutingTable full_table(true, node_id, kKeys, network_statistics);
+  NodeInfo peer(MakeNode());
+  EXPECT_TRUE(lean_table.AddNode(peer));
+  EXPECT_TRUE(full_table.AddNode(peer));
+
+  std::vector<NodeInfo> row;
+  for (uint16_t i(0); i != 3; ++i) {
+    NodeInfo node;
+    node.node_id = NodeId(NodeId::kRandomId);
+    row.push_back(node);
+  }
+  lean_table.GroupUpdateFromConnectedPeer(peer.node_id, row);
+  full_table.GroupUpdateFromConnectedPeer(peer.node_id, row);
+  EXPECT_TRUE(lean_table.IsConnected(peer.node_id));
+  for (const auto& node : row) {
+    EXPECT_FALSE(lean_table.IsConnected(node.node_id));
+    EXPECT_TRUE(full_table.IsConnected(node.node_id));
+  }
+}
+
+TEST(RoutingTableTest, BEH_BucketBalancedAdmission) {
+  // An ID differing from holder first in bit |bucket|.
+  auto id_in_bucket([](const NodeId& holder, uint16_t bucket) {
+    std::string binary(GenerateUniqueRandomId(holder, bucket)
+                           .ToStringEncoded(NodeId::EncodingType::kBinary));
+    char& bit(binary[NodeId::kSize * 8 - 1 - bucket]);
+    bit = (bit == '0' ? '1' : '0');
+    return NodeId(binary, NodeId::EncodingType::kBinary);
+  });
+  NodeId node_id(NodeId::kRandomId);
+  NetworkStatistics network_statistics(node_id);
+  InstanceParameters parameters;
+  parameters.max_routing_table_size = 2 * Parameters::closest_nodes_size;
+  parameters.bucket_target_size = 1;
+  RoutingTable routing_table(false, node_id, asymm::GenerateKeyPair(), network_statistics,
+                             parameters);
+  for (uint16_t i(0); i != Parameters::closest_nodes_size; ++i) {
+    NodeInfo node(MakeNode());
+    node.node_id = id_in_bucket(node_id, 10 + i);
+    ASSERT_TRUE(routing_table.AddNode(node));
+  }
+  const NodeId kFarId(id_in_bucket(node_id, NodeId::kSize * 8 - 1));
+  while (routing_table.size() < routing_table.kMaxSize()) {
+    NodeInfo node(MakeNode());
+    node.node_id = id_in_bucket(node_id, NodeId::kSize * 8 - 1);
+    ASSERT_TRUE(routing_table.AddNode(node));
+  }
+
+  // Nodes in a nearer bucket displace those in the crowded furthest one until the two balance.
+  const NodeId kMiddleId(id_in_bucket(node_id, 300));
+  for (;;) {
+    NodeInfo node(MakeNode());
+    node.node_id = id_in_bucket(node_id, 300);
+    if (!routing_table.AddNode(node))
+      break;
+  }
+  EXPECT_EQ(routing_table.kMaxSize(), routing_table.size());
+  EXPECT_EQ(3U, routing_table.BucketSize(kMiddleId));
+  EXPECT_EQ(5U, routing_table.BucketSize(kFarId));
+
+  // The furthest bucket, being no smaller than any other, doesn't make space for more.
+  NodeInfo far_node(MakeNode());
+  far_node.node_id = id_in_bucket(node_id, NodeId::kSize * 8 - 1);
+  EXPECT_FALSE(routing_table.CheckNode(far_node));
+  EXPECT_FALSE(routing_table.AddNode(far_node));
+}
+
 TEST(RoutingTableTest, BEH_GetNthClosest) {
   std::vector<NodeId> nodes_id;
   NodeId node_id(NodeId::kRandomId);
@@ -772,6 +957,39 @@ TEST(RoutingTableTest, BEH_GetNthClosest) {
   }
 }
 
+TEST(RoutingTableTest, BEH_GetClosestNodesToRandomTargets) {
+  NodeId node_id(NodeId::kRandomId);
+  NetworkStatistics network_statistics(node_id);
+  RoutingTable routing_table(false, node_id, asymm::GenerateKeyPair(), network_statistics);
+  std::vector<NodeInfo> known_nodes;
+  while (routing_table.size() < Parameters::max_routing_table_size) {
+    NodeInfo node(MakeNode());
+    if (routing_table.AddNode(node))
+      known_nodes.push_back(node);
+  }
+
+  // Targets near this node lie in its low buckets, where the walk starts at the target's bucket
+  // and then visits the buckets below it out of order.
+  auto near_target([&node_id](int i) {
+    std::string raw_id(node_id.string());
+    raw_id[NodeId::kSize - 1 - i % 8] ^= static_cast<char>(RandomUint32() % 255 + 1);
+    return NodeId(raw_id);
+  });
+  for (int i(0); i < 150; ++i) {
+    NodeId target((i % 3 == 0) ? NodeId(NodeId::kRandomId) : (i % 3 == 1)
+                      ? known_nodes.at(RandomUint32() % known_nodes.size()).node_id
+                      : near_target(i));
+    uint16_t number_to_get(static_cast<uint16_t>(RandomUint32() % known_nodes.size() + 1));
+    SortFromTarget(target, known_nodes);
+    std::vector<NodeId> closest_nodes(routing_table.GetClosestNodes(target, number_to_get));
+    ASSERT_EQ(number_to_get, closest_nodes.size());
+    for (uint16_t index(0); index < number_to_get; ++index)
+      EXPECT_EQ(known_nodes.at(index).node_id, closest_nodes.at(index));
+    EXPECT_EQ(known_nodes.at(number_to_get - 1).node_id,
+              routing_table.GetNthClosestNode(target, number_to_get).node_id);
+  }
+}
+
 TEST(RoutingTableTest, FUNC_GetClosestNodeWithExclusion) {
   NodeId node_id(NodeId::kRandomId);
   NetworkStatistics network_statistics(node_id);
@@ -1050,7 +1268,7 @@ TEST(RoutingTableTest, FUNC_GetNodeForSendingMessage) {
   }
 
   // Test GetNodeForSendingMessage for nodes in routing table
-  std::vector<std::string> exclude;
+  RouteHistory exclude;
   for (const auto& node : nodes_in_table) {
     EXPECT_EQ(node.node_id, routing_table.GetNodeForSendingMessage(node.node_id, exclude).node_id);
     EXPECT_NE(node.node_id,
@@ -1073,12 +1291,86 @@ TEST(RoutingTableTest, FUNC_GetNodeForSendingMessage) {
   // Test GetNodeForSendingMessage for node in group matrix (with exclusions)
   NodeId target(rows_in_matrix.at(0).at(RandomUint32() % rows_in_matrix.at(0).size()).node_id);
   for (uint16_t i(0); i < matrix_row_leaders.size() - 1; ++i) {
-    exclude.push_back(matrix_row_leaders.at(i).node_id.string());
+    exclude.Add(matrix_row_leaders.at(i).node_id);
     EXPECT_EQ(matrix_row_leaders.at(i + 1).node_id,
               routing_table.GetNodeForSendingMessage(target, exclude).node_id);
   }
 }
 
+TEST(RoutingTableTest, BEH_GetNodeForSendingMessagePrefersFasterLink) {
+  NodeId own_node_id(NodeId::kRandomId);
+  NetworkStatistics network_statistics(own_node_id);
+  RoutingTable routing_table(false, own_node_id, asymm::GenerateKeyPair(), network_statistics);
+  auto near_id([](const NodeId& node_id, char flipped_bits)->NodeId {
+    std::string id(node_id.string());
+    id[NodeId::kSize - 1] ^= flipped_bits;
+    return NodeId(id);
+  });
+  // Fill this node's close group, so the target lies outside it.
+  NodeInfo node_info;
+  for (uint16_t i(0); i < Parameters::closest_nodes_size; ++i) {
+    node_info = MakeNode();
+    node_info.node_id = near_id(own_node_id, static_cast<char>(i + 1));
+    ASSERT_TRUE(routing_table.AddNode(node_info));
+  }
+  NodeId target(NodeId::kRandomId);
+  NodeInfo closest(MakeNode()), comparable(MakeNode());
+  closest.node_id = near_id(target, 2);
+  comparable.node_id = near_id(target, 3);
+  ASSERT_TRUE(routing_table.AddNode(closest));
+  ASSERT_TRUE(routing_table.AddNode(comparable));
+
+  RouteHistory exclude;
+  EXPECT_EQ(closest.node_id, routing_table.GetNodeForSendingMessage(target, exclude).node_id);
+
+  LinkQuality& link_quality(routing_table.link_quality());
+  uint64_t stamp(link_quality.ProbeSent(comparable.node_id));
+  link_quality.ProbeAnswered(comparable.node_id, stamp);
+  stamp = link_quality.ProbeSent(closest.node_id);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  link_quality.ProbeAnswered(closest.node_id, stamp);
+  EXPECT_EQ(comparable.node_id, routing_table.GetNodeForSendingMessage(target, exclude).node_id);
+
+  exclude.Add(comparable.node_id);
+  EXPECT_EQ(closest.node_id, routing_table.GetNodeForSendingMessage(target, exclude).node_id);
+}
+
+TEST(RoutingTableTest, BEH_GetRemovableNodePrefersWorstLink) {
+  NodeId own_node_id(NodeId::kRandomId);
+  NetworkStatistics network_statistics(own_node_id);
+  RoutingTable routing_table(false, own_node_id, asymm::GenerateKeyPair(), network_statistics);
+  NodeInfo node_info;
+  for (uint16_t i(0); i < Parameters::closest_nodes_size; ++i) {
+    std::string id(own_node_id.string());
+    id[NodeId::kSize - 1] ^= static_cast<char>(i + 1);
+    node_info = MakeNode();
+    node_info.node_id = NodeId(id);
+    ASSERT_TRUE(routing_table.AddNode(node_info));
+  }
+  // Three peers sharing the furthest bucket.
+  std::vector<NodeInfo> far_nodes;
+  while (far_nodes.size() < 3) {
+    std::string id(NodeId(NodeId::kRandomId).string());
+    id[0] = own_node_id.string()[0] ^ static_cast<char>(0x80);
+    node_info = MakeNode();
+    node_info.node_id = NodeId(id);
+    ASSERT_TRUE(routing_table.AddNode(node_info));
+    far_nodes.push_back(node_info);
+  }
+
+  LinkQuality& link_quality(routing_table.link_quality());
+  uint64_t stamp(link_quality.ProbeSent(far_nodes.at(0).node_id));
+  link_quality.ProbeAnswered(far_nodes.at(0).node_id, stamp);
+  stamp = link_quality.ProbeSent(far_nodes.at(1).node_id);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  link_quality.ProbeAnswered(far_nodes.at(1).node_id, stamp);
+  EXPECT_EQ(far_nodes.at(1).node_id, routing_table.GetRemovableNode().node_id);
+
+  // The unprobed peer is kept while a probed one remains.
+  std::vector<std::string> attempted(1, far_nodes.at(1).node_id.string());
+  EXPECT_EQ(far_nodes.at(0).node_id, routing_table.GetRemovableNode(attempted).node_id);
+}
+
 TEST(RoutingTableTest, FUNC_GetNodeForSendingMessageIgnoreExactMatch) {
   // populate routing table
   NodeId own_node_id(NodeId::kRandomId);
@@ -1097,7 +1389,7 @@ TEST(RoutingTableTest, FUNC_GetNodeForSendingMessageIgnoreExactMatch) {
     EXPECT_TRUE(routing_table.AddNode(node));
 
   // test GetNodeForSendingMessage
-  std::vector<std::string> exclude;
+  RouteHistory exclude;
   std::vector<NodeInfo> nodes2(nodes_in_table);
   for (const auto& node : nodes2) {
     PartialSortFromTarget(node.node_id, nodes_in_table, 2);
@@ -1187,6 +1479,79 @@ TEST(RoutingTableTest, FUNC_IsNodeIdInGroupRange) {
   }
 }
 
+TEST(RoutingTableTest, BEH_BulkGroupQueriesMatchSingleQueries) {
+  NodeId own_node_id(NodeId::kRandomId);
+  NetworkStatistics network_statistics(own_node_id);
+  RoutingTable routing_table(false, own_node_id, asymm::GenerateKeyPair(), network_statistics);
+  while (routing_table.size() < Parameters::max_routing_table_size)
+    EXPECT_TRUE(routing_table.AddNode(MakeNode()));
+
+  std::vector<NodeId> target_ids;
+  for (uint16_t i(0); i < 50; ++i)
+    target_ids.push_back(NodeId(NodeId::kRandomId));
+  std::vector<GroupRangeStatus> statuses;
+  routing_table.IsNodeIdInGroupRange(target_ids, statuses);
+  std::vector<std::vector<NodeId>> groups;
+  routing_table.GetGroups(target_ids, groups);
+  ASSERT_EQ(target_ids.size(), statuses.size());
+  ASSERT_EQ(target_ids.size(), groups.size());
+  for (size_t i(0); i != target_ids.size(); ++i) {
+    EXPECT_EQ(routing_table.IsNodeIdInGroupRange(target_ids[i]), statuses[i]);
+    EXPECT_EQ(routing_table.GetGroup(target_ids[i]), groups[i]);
+  }
+}
+
+TEST(RoutingTableTest, BEH_ClassifyRouteMatchesSingleQueries) {
+  NodeId own_node_id(NodeId::kRandomId);
+  NetworkStatistics network_statistics(own_node_id);
+  RoutingTable routing_table(false, own_node_id, asymm::GenerateKeyPair(), network_statistics);
+  std::vector<NodeId> target_ids;
+  while (routing_table.size() < Parameters::max_routing_table_size) {
+    NodeInfo node(MakeNode());
+    EXPECT_TRUE(routing_table.AddNode(node));
+    // Both targets held in the table and targets which aren't, at each size of table.
+    target_ids.push_back(node.node_id);
+    target_ids.push_back(NodeId(NodeId::kRandomId));
+    for (const auto& target_id : target_ids) {
+      RouteClassification route(routing_table.ClassifyRoute(target_id));
+      EXPECT_EQ(routing_table.size(), route.table_size);
+      EXPECT_EQ(routing_table.Contains(target_id), route.target_connected);
+      EXPECT_EQ(routing_table.IsThisNodeInRange(target_id, Parameters::group_size),
+                route.in_group_range);
+      EXPECT_EQ(routing_table.IsThisNodeInRange(target_id, Parameters::closest_nodes_size),
+                route.in_close_range);
+      EXPECT_EQ(routing_table.IsThisNodeClosestTo(target_id, false), route.closest);
+      EXPECT_EQ(routing_table.IsThisNodeClosestTo(target_id, true), route.closest_ignoring_target);
+    }
+  }
+
+  for (const auto& target_id : target_ids) {
+    RouteHistory exclude;
+    NodeInfo connected_peer;
+    bool leader(routing_table.IsThisNodeGroupLeader(target_id, connected_peer, exclude));
+    GroupRoute group_route(
+        routing_table.RouteGroup(target_id, exclude, Parameters::group_size - 1));
+    ASSERT_EQ(leader, group_route.leader);
+    if (!leader) {
+      EXPECT_EQ(connected_peer.node_id, group_route.next_hop.node_id);
+      continue;
+    }
+    std::vector<NodeInfo> expected(
+        routing_table.GetClosestMatrixNodes(target_id, Parameters::group_size + 1));
+    expected.erase(std::remove_if(expected.begin(), expected.end(), [&](const NodeInfo& node) {
+                     return node.node_id == target_id || node.node_id == own_node_id;
+                   }),
+                   expected.end());
+    expected.resize(std::min(expected.size(), static_cast<size_t>(Parameters::group_size - 1)));
+    EXPECT_EQ(expected.size(),
+              group_route.connected_members.size() + group_route.other_members.size());
+    for (const auto& member : group_route.connected_members)
+      EXPECT_TRUE(routing_table.Contains(member.node_id));
+    for (const auto& member : group_route.other_members)
+      EXPECT_FALSE(routing_table.Contains(member.node_id));
+  }
+}
+
 TEST(RoutingTableTest, BEH_MatrixChange) {
   NodeId node_id(NodeId::kRandomId);
   NetworkStatistics network_statistics(node_id);
@@ -1225,6 +1590,85 @@ TEST(RoutingTableTest, BEH_MatrixChange) {
   EXPECT_EQ(count, Parameters::closest_nodes_size + 2);
 }
 
+TEST(RoutingTableTest, BEH_MatrixChangeSince) {
+  NodeId node_id(NodeId::kRandomId);
+  NetworkStatistics network_statistics(node_id);
+  RoutingTable routing_table(false, node_id, asymm::GenerateKeyPair(), network_statistics);
+  std::vector<uint64_t> epochs;
+  routing_table.InitialiseFunctors([](int) {}, [](const NodeInfo&, bool) {}, []() {},  // NOLINT
+                                   [](const std::vector<NodeInfo>&,
+                                      const std::vector<NodeInfo> /*old_nodes*/) {},
+                                   [&epochs](std::shared_ptr<MatrixChange> matrix_change) {
+                                     epochs.push_back(matrix_change->epoch());
+                                   });
+  EXPECT_EQ(0, routing_table.matrix_epoch());
+  std::vector<NodeInfo> nodes;
+  for (uint16_t i(0); i != Parameters::closest_nodes_size; ++i) {
+    nodes.push_back(MakeNode());
+    EXPECT_TRUE(routing_table.AddNode(nodes.back()));
+  }
+  ASSERT_EQ(nodes.size(), epochs.size());
+  for (size_t i(0); i != epochs.size(); ++i)
+    EXPECT_EQ(i + 1, epochs[i]);
+  EXPECT_EQ(epochs.back(), routing_table.matrix_epoch());
+
+  // The net change since the first node was added is the arrival of the rest.
+  auto matrix_change(routing_table.MatrixChangeSince(epochs.front()));
+  ASSERT_NE(nullptr, matrix_change);
+  EXPECT_EQ(routing_table.matrix_epoch(), matrix_change->epoch());
+  EXPECT_EQ(nodes.size() - 1, matrix_change->new_nodes().size());
+  EXPECT_TRUE(matrix_change->lost_nodes().empty());
+
+  // A node added then dropped again in the meantime cancels out.  It's the closest yet, so that it
+  // enters the matrix.
+  uint64_t epoch(routing_table.matrix_epoch());
+  NodeInfo transient(MakeNode());
+  std::string transient_id(node_id.string());
+  transient_id.back() ^= 1;
+  transient.node_id = NodeId(transient_id);
+  transient.connection_id = transient.node_id;
+  EXPECT_TRUE(routing_table.AddNode(transient));
+  routing_table.DropNode(transient.node_id, true);
+  EXPECT_LT(epoch, routing_table.matrix_epoch());
+  matrix_change = routing_table.MatrixChangeSince(epoch);
+  ASSERT_NE(nullptr, matrix_change);
+  EXPECT_TRUE(matrix_change->new_nodes().empty());
+  EXPECT_TRUE(matrix_change->lost_nodes().empty());
+
+  EXPECT_EQ(nullptr, routing_table.MatrixChangeSince(routing_table.matrix_epoch() + 1));
+  if (routing_table.matrix_epoch() > Parameters::matrix_epoch_history)
+    EXPECT_EQ(nullptr, routing_table.MatrixChangeSince(0));
+  else
+    EXPECT_EQ(routing_table.size(), routing_table.MatrixChangeSince(0)->new_nodes().size());
+}
+
+TEST(RoutingTableTest, BEH_CloseBoundaries) {
+  NodeId node_id(NodeId::kRandomId);
+  NetworkStatistics network_statistics(node_id);
+  RoutingTable routing_table(false, node_id, asymm::GenerateKeyPair(), network_statistics);
+  auto expect_boundaries([&]() {
+    auto boundaries(routing_table.close_boundaries());
+    EXPECT_EQ(routing_table.GetNthClosestNode(node_id, Parameters::closest_nodes_size).node_id,
+              boundaries->furthest_close_node);
+    EXPECT_EQ(routing_table.GetNthClosestNode(node_id, 2 * Parameters::closest_nodes_size).node_id,
+              boundaries->furthest_client_close_node);
+    EXPECT_EQ(node_id ^ boundaries->furthest_close_node, boundaries->close_distance);
+  });
+  expect_boundaries();
+  std::vector<NodeInfo> nodes;
+  for (uint16_t i(0); i != 3 * Parameters::closest_nodes_size; ++i) {
+    nodes.push_back(MakeNode());
+    EXPECT_TRUE(routing_table.AddNode(nodes.back()));
+    expect_boundaries();
+  }
+  SortFromTarget(node_id, nodes);
+  // Each close node dropped moves both boundaries further out.
+  for (uint16_t i(0); i != Parameters::closest_nodes_size; ++i) {
+    routing_table.DropNode(nodes[i].node_id, true);
+    expect_boundaries();
+  }
+}
+
 TEST(RoutingTableTest, FUNC_ClosestToId) {
   NodeId own_node_id(NodeId::kRandomId);
   NetworkStatistics network_statistics(own_node_id);
@@ -32,6 +32,7 @@
 #include "maidsafe/routing/rpcs.h"
 #include "maidsafe/routing/routing.pb.h"
 #include "maidsafe/routing/routing_table.h"
+#include "maidsafe/routing/rpc_templates.h"
 #include "maidsafe/routing/tests/test_utils.h"
 
 namespace maidsafe {
@@ -193,6 +194,49 @@ TEST(RpcsTest, BEH_FindNodesMessageNodeRelayMode) {
   ASSERT_FALSE(node.IsZero());
 }
 
+TEST(RpcsTest, BEH_TemplatesMatchRpcs) {
+  NodeInfo us(MakeNode()), them(MakeNode()), other(MakeNode());
+  RpcTemplates templates(us.node_id, false);
+
+  protobuf::Message ping(templates.Ping(them.node_id, 7));
+  protobuf::Message expected_ping(rpcs::Ping(them.node_id, us.node_id.string(), 7));
+  protobuf::PingRequest ping_request, expected_ping_request;
+  ASSERT_TRUE(ping_request.ParseFromString(ping.data(0)));
+  ASSERT_TRUE(expected_ping_request.ParseFromString(expected_ping.data(0)));
+  EXPECT_TRUE(ping_request.ping());
+  EXPECT_EQ(7U, ping_request.probe_stamp());
+  EXPECT_TRUE(ping_request.has_timestamp());
+  // The timestamps may differ, so the rest of the messages is compared.
+  ping.clear_data();
+  expected_ping.clear_data();
+  EXPECT_EQ(expected_ping.SerializeAsString(), ping.SerializeAsString());
+
+  protobuf::Message find_nodes(templates.FindNodes(us.node_id, 8));
+  protobuf::Message expected_find_nodes(
+      rpcs::FindNodes(us.node_id, us.node_id, 8, false, NodeId(), true));
+  protobuf::FindNodesRequest find_nodes_request;
+  ASSERT_TRUE(find_nodes_request.ParseFromString(find_nodes.data(0)));
+  EXPECT_EQ(8, find_nodes_request.num_nodes_requested());
+  EXPECT_EQ(us.node_id.string(), find_nodes_request.target_node());
+  EXPECT_TRUE(find_nodes_request.want_contacts());
+  find_nodes.clear_data();
+  expected_find_nodes.clear_data();
+  expected_find_nodes.set_id(find_nodes.id());
+  EXPECT_EQ(expected_find_nodes.SerializeAsString(), find_nodes.SerializeAsString());
+
+  std::vector<NodeId> additional_node_ids(1, other.node_id);
+  protobuf::Message get_group(templates.GetGroup(them.node_id, additional_node_ids));
+  protobuf::Message expected_get_group(
+      rpcs::GetGroup(them.node_id, us.node_id, additional_node_ids));
+  protobuf::GetGroup get_group_request;
+  ASSERT_TRUE(get_group_request.ParseFromString(get_group.data(0)));
+  EXPECT_EQ(expected_get_group.data(0), get_group.data(0));
+  expected_get_group.set_id(get_group.id());
+  EXPECT_EQ(expected_get_group.SerializeAsString(), get_group.SerializeAsString());
+
+  EXPECT_TRUE(RpcTemplates(us.node_id, true).Ping(them.node_id).client_node());
+}
+
 }  // namespace test
 
 }  // namespace routing
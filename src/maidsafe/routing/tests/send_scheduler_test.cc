@@ -0,0 +1,131 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/rudp/return_codes.h"
+
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/send_scheduler.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+typedef std::vector<std::pair<std::string, rudp::MessageSentFunctor>> InFlight;
+
+SendScheduler::DispatchFunctor Recorder(InFlight& in_flight) {
+  return [&in_flight](const NodeId& /*peer_id*/, const std::string& serialised,
+                      const rudp::MessageSentFunctor& message_sent_functor) {
+    in_flight.push_back(std::make_pair(serialised, message_sent_functor));
+  };
+}
+
+}  // unnamed namespace
+
+TEST(SendSchedulerTest, BEH_MessagePriority) {
+  protobuf::Message message;
+  message.set_routing_message(true);
+  EXPECT_EQ(SendPriority::kControl, MessagePriority(message));
+  message.set_routing_message(false);
+  message.add_data("small");
+  SetSendPriority(message);
+  EXPECT_FALSE(message.has_priority());
+  EXPECT_EQ(SendPriority::kInteractive, MessagePriority(message));
+  message.add_data(std::string(Parameters::bulk_message_size, 'b'));
+  SetSendPriority(message);
+  EXPECT_EQ(SendPriority::kBulk, MessagePriority(message));
+  message.set_priority(7);
+  EXPECT_EQ(SendPriority::kInteractive, MessagePriority(message));
+}
+
+TEST(SendSchedulerTest, BEH_ControlOvertakesQueuedBulk) {
+  InFlight in_flight;
+  SendScheduler scheduler(1, Recorder(in_flight));
+  NodeId peer(NodeId::kRandomId);
+  for (int i(0); i != 4; ++i)
+    scheduler.Send(peer, SendPriority::kBulk, std::string(100000, 'b'), nullptr);
+  for (int i(0); i != 3; ++i)
+    scheduler.Send(peer, SendPriority::kControl, std::string(100, 'c'), nullptr);
+  scheduler.Send(peer, SendPriority::kInteractive, std::string(100, 'i'), nullptr);
+  ASSERT_EQ(1U, in_flight.size());
+  EXPECT_EQ(7U, scheduler.queued(peer));
+
+  std::string order;
+  while (order.size() != 8) {
+    ASSERT_EQ(order.size() + 1, in_flight.size());
+    auto sent(in_flight.back());
+    order += sent.first[0];
+    sent.second(rudp::kSuccess);
+  }
+  EXPECT_EQ("bcccibbb", order);
+  EXPECT_EQ(0U, scheduler.queued(peer));
+}
+
+TEST(SendSchedulerTest, BEH_LimitIsPerPeer) {
+  InFlight in_flight;
+  SendScheduler scheduler(2, Recorder(in_flight));
+  NodeId peer(NodeId::kRandomId), other_peer(NodeId::kRandomId);
+  for (int i(0); i != 3; ++i) {
+    scheduler.Send(peer, SendPriority::kInteractive, "peer", nullptr);
+    scheduler.Send(other_peer, SendPriority::kInteractive, "other", nullptr);
+  }
+  EXPECT_EQ(4U, in_flight.size());
+  EXPECT_EQ(1U, scheduler.queued(peer));
+  EXPECT_EQ(1U, scheduler.queued(other_peer));
+  in_flight.front().second(rudp::kSuccess);
+  EXPECT_EQ(5U, in_flight.size());
+  EXPECT_EQ(0U, scheduler.queued(peer));
+}
+
+TEST(SendSchedulerTest, BEH_RemoveFailsQueued) {
+  InFlight in_flight;
+  SendScheduler scheduler(1, Recorder(in_flight));
+  NodeId peer(NodeId::kRandomId);
+  std::vector<int> results;
+  auto record([&results](int result) { results.push_back(result); });
+  for (int i(0); i != 3; ++i)
+    scheduler.Send(peer, SendPriority::kInteractive, "message", record);
+  ASSERT_EQ(1U, in_flight.size());
+  scheduler.Remove(peer);
+  EXPECT_EQ(0U, scheduler.queued(peer));
+  EXPECT_EQ(std::vector<int>(2, rudp::kSendFailure), results);
+
+  // The message already in flight still reports its own result, and the peer's next message is
+  // dispatched straight away.
+  in_flight.front().second(rudp::kSuccess);
+  EXPECT_EQ(3U, results.size());
+  EXPECT_EQ(rudp::kSuccess, results.back());
+  scheduler.Send(peer, SendPriority::kInteractive, "message", record);
+  EXPECT_EQ(2U, in_flight.size());
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
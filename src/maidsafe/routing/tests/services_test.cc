@@ -17,6 +17,7 @@
     use of the MaidSafe Software.                                                                 */
 
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "maidsafe/common/log.h"
@@ -53,7 +54,7 @@ TEST(ServicesTest, BEH_Ping) {
   RoutingTable routing_table(false, node_id, asymm::GenerateKeyPair(), network_statistics);
   ClientRoutingTable client_routing_table(routing_table.kNodeId());
   AsioService asio_service(1);
-  NetworkUtils network(routing_table, client_routing_table);
+  NetworkUtils network(routing_table, client_routing_table, asio_service);
   GroupChangeHandler group_change_handler(routing_table, client_routing_table, network);
   Service service(routing_table, client_routing_table, network);
   NodeInfo node;
@@ -85,7 +86,7 @@ TEST(ServicesTest, BEH_FindNodes) {
   NodeId this_node_id(routing_table.kNodeId());
   ClientRoutingTable client_routing_table(routing_table.kNodeId());
   AsioService asio_service(1);
-  NetworkUtils network(routing_table, client_routing_table);
+  NetworkUtils network(routing_table, client_routing_table, asio_service);
   GroupChangeHandler group_change_handler(routing_table, client_routing_table, network);
   Service service(routing_table, client_routing_table, network);
   protobuf::Message message = rpcs::FindNodes(this_node_id, this_node_id, 8);
@@ -109,6 +110,66 @@ TEST(ServicesTest, BEH_FindNodes) {
   // EXPECT_FALSE(message.has_relay());
 }
 
+TEST(ServicesTest, BEH_FindNodesWithContacts) {
+  NodeId node_id(NodeId::kRandomId);
+  NetworkStatistics network_statistics(node_id);
+  RoutingTable routing_table(false, node_id, asymm::GenerateKeyPair(), network_statistics);
+  NodeId this_node_id(routing_table.kNodeId());
+  ClientRoutingTable client_routing_table(routing_table.kNodeId());
+  AsioService asio_service(1);
+  NetworkUtils network(routing_table, client_routing_table, asio_service);
+  Service service(routing_table, client_routing_table, network);
+  for (int i(0); i != 2; ++i) {  // with contacts, then without
+    protobuf::Message message =
+        rpcs::FindNodes(this_node_id, this_node_id, 8, false, NodeId(), i == 0);
+    service.FindNodes(message);
+    protobuf::FindNodesResponse find_nodes_response;
+    ASSERT_TRUE(find_nodes_response.ParseFromString(message.data(0)));
+    ASSERT_EQ(1, find_nodes_response.nodes_size());
+    EXPECT_EQ(this_node_id.string(), find_nodes_response.nodes(0));
+    EXPECT_TRUE(find_nodes_response.has_original_request());
+    if (i == 0) {
+      ASSERT_EQ(1, find_nodes_response.contacts_size());
+      EXPECT_EQ(this_node_id.string(), find_nodes_response.contacts(0).node_id());
+      EXPECT_TRUE(find_nodes_response.contacts(0).has_nat_type());
+    } else {
+      EXPECT_EQ(0, find_nodes_response.contacts_size());
+    }
+  }
+}
+
+TEST(ServicesTest, BEH_GetGroupFlagsOutOfRangeIds) {
+  NodeId node_id(NodeId::kRandomId);
+  NetworkStatistics network_statistics(node_id);
+  RoutingTable routing_table(false, node_id, asymm::GenerateKeyPair(), network_statistics);
+  ClientRoutingTable client_routing_table(routing_table.kNodeId());
+  AsioService asio_service(1);
+  NetworkUtils network(routing_table, client_routing_table, asio_service);
+  Service service(routing_table, client_routing_table, network);
+  while (routing_table.size() < Parameters::max_routing_table_size)
+    routing_table.AddNode(MakeNode());
+  // An id differing from this node's in its first bit is far outside its group range.
+  std::string far_id(node_id.string());
+  far_id[0] ^= static_cast<char>(0x80);
+  std::vector<NodeId> additional_ids(1, node_id);
+  additional_ids.push_back(NodeId(far_id));
+  ASSERT_EQ(GroupRangeStatus::kInRange, routing_table.IsNodeIdInGroupRange(additional_ids[0]));
+  ASSERT_NE(GroupRangeStatus::kInRange, routing_table.IsNodeIdInGroupRange(additional_ids[1]));
+
+  protobuf::Message message(
+      rpcs::GetGroup(node_id, NodeId(NodeId::kRandomId), additional_ids));
+  service.GetGroup(message);
+  protobuf::GetGroup get_group;
+  ASSERT_TRUE(get_group.ParseFromString(message.data(0)));
+  EXPECT_EQ(0, get_group.additional_node_ids_size());
+  ASSERT_EQ(2, get_group.additional_groups_size());
+  EXPECT_FALSE(get_group.additional_groups(0).out_of_range());
+  EXPECT_EQ(routing_table.GetGroup(node_id).size(),
+            get_group.additional_groups(0).group_nodes_id_size());
+  EXPECT_TRUE(get_group.additional_groups(1).out_of_range());
+  EXPECT_EQ(0, get_group.additional_groups(1).group_nodes_id_size());
+}
+
 // TEST(ServicesTest, BEH_ProxyConnect) {
 //   asymm::Keys my_keys;
 //   my_keys.identity = RandomString(64);
@@ -0,0 +1,191 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/node_info.h"
+#include "maidsafe/routing/route_history.h"
+#include "maidsafe/routing/shortcut_table.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+NodeInfo Peer(const NodeId& node_id) {
+  NodeInfo peer;
+  peer.node_id = node_id;
+  peer.connection_id = NodeId(NodeId::kRandomId);
+  return peer;
+}
+
+}  // unnamed namespace
+
+TEST(ShortcutTableTest, BEH_CountsSendsAndAcceptsOnlyExpectedPeers) {
+  ShortcutTable disabled(0, 2, std::chrono::seconds(10));
+  NodeId destination(NodeId::kRandomId);
+  EXPECT_FALSE(disabled.CountSend(destination));
+  EXPECT_FALSE(disabled.CountSend(destination));
+  EXPECT_FALSE(disabled.Expect(destination));
+
+  ShortcutTable shortcuts(2, 3, std::chrono::seconds(10));
+  EXPECT_FALSE(shortcuts.CountSend(destination));
+  EXPECT_FALSE(shortcuts.CountSend(destination));
+  EXPECT_TRUE(shortcuts.CountSend(destination));
+  EXPECT_FALSE(shortcuts.CountSend(destination));
+
+  NodeId evicted;
+  NodeInfo peer(Peer(destination));
+  EXPECT_FALSE(shortcuts.Add(peer, evicted));
+  EXPECT_TRUE(shortcuts.Expect(peer.node_id));
+  EXPECT_TRUE(shortcuts.IsExpected(peer.node_id));
+  EXPECT_TRUE(shortcuts.Add(peer, evicted));
+  EXPECT_TRUE(evicted.IsZero());
+  EXPECT_FALSE(shortcuts.IsExpected(peer.node_id));
+  EXPECT_TRUE(shortcuts.Contains(peer.node_id));
+  // A peer already held isn't expected again.
+  EXPECT_FALSE(shortcuts.Expect(peer.node_id));
+  EXPECT_TRUE(shortcuts.Drop(peer.connection_id));
+  EXPECT_FALSE(shortcuts.Drop(peer.connection_id));
+  EXPECT_EQ(0U, shortcuts.size());
+}
+
+TEST(ShortcutTableTest, BEH_EvictsLeastRecentlyUsed) {
+  ShortcutTable shortcuts(2, 1, std::chrono::seconds(10));
+  std::vector<NodeInfo> peers;
+  for (int i(0); i != 3; ++i)
+    peers.push_back(Peer(NodeId(NodeId::kRandomId)));
+  NodeId evicted;
+  for (int i(0); i != 2; ++i) {
+    ASSERT_TRUE(shortcuts.Expect(peers[i].node_id));
+    ASSERT_TRUE(shortcuts.Add(peers[i], evicted));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  // Using the older one leaves the newer least recently used.
+  NodeInfo next_hop(Peer(NodeId(NodeId::kRandomId)));
+  ASSERT_TRUE(shortcuts.NextHop(peers[0].node_id, false, next_hop));
+  EXPECT_EQ(peers[0].node_id, next_hop.node_id);
+  ASSERT_TRUE(shortcuts.Expect(peers[2].node_id));
+  ASSERT_TRUE(shortcuts.Add(peers[2], evicted));
+  EXPECT_EQ(peers[1].connection_id, evicted);
+  EXPECT_EQ(2U, shortcuts.size());
+  EXPECT_FALSE(shortcuts.Contains(peers[1].node_id));
+}
+
+TEST(ShortcutTableTest, BEH_InboundShortcutsDontEvict) {
+  ShortcutTable shortcuts(2, 1, std::chrono::seconds(10));
+  std::vector<NodeInfo> peers;
+  for (int i(0); i != 6; ++i)
+    peers.push_back(Peer(NodeId(NodeId::kRandomId)));
+  // No more than capacity of each kind are expected at once.
+  ASSERT_TRUE(shortcuts.Expect(peers[0].node_id));
+  ASSERT_TRUE(shortcuts.Expect(peers[1].node_id));
+  EXPECT_FALSE(shortcuts.Expect(peers[2].node_id));
+  ASSERT_TRUE(shortcuts.Expect(peers[2].node_id, true));
+  ASSERT_TRUE(shortcuts.Expect(peers[3].node_id, true));
+  EXPECT_FALSE(shortcuts.Expect(peers[4].node_id, true));
+
+  NodeId evicted;
+  ASSERT_TRUE(shortcuts.Add(peers[0], evicted));
+  ASSERT_TRUE(shortcuts.Add(peers[1], evicted));
+  // The table is full, so an inbound shortcut is refused rather than evicting this node's own.
+  EXPECT_FALSE(shortcuts.Add(peers[2], evicted));
+  EXPECT_TRUE(evicted.IsZero());
+  EXPECT_FALSE(shortcuts.Expect(peers[4].node_id, true));
+  EXPECT_EQ(2U, shortcuts.size());
+  EXPECT_TRUE(shortcuts.Contains(peers[0].node_id));
+  EXPECT_TRUE(shortcuts.Contains(peers[1].node_id));
+
+  // Whereas one this node asked for still makes way for itself.
+  ASSERT_TRUE(shortcuts.Expect(peers[5].node_id));
+  ASSERT_TRUE(shortcuts.Add(peers[5], evicted));
+  EXPECT_FALSE(evicted.IsZero());
+  EXPECT_EQ(2U, shortcuts.size());
+}
+
+TEST(ShortcutTableTest, BEH_NextHopOnlyIfCloser) {
+  ShortcutTable shortcuts(4, 1, std::chrono::seconds(10));
+  NodeId target(NodeId::kRandomId);
+  NodeInfo shortcut(Peer(NodeId(NodeId::kRandomId)));
+  NodeId evicted;
+  ASSERT_TRUE(shortcuts.Expect(shortcut.node_id));
+  ASSERT_TRUE(shortcuts.Add(shortcut, evicted));
+
+  NodeInfo peer(Peer(NodeId(NodeId::kRandomId)));
+  NodeInfo chosen(peer);
+  bool replaced(shortcuts.NextHop(target, true, chosen));
+  EXPECT_EQ(NodeId::CloserToTarget(shortcut.node_id, peer.node_id, target), replaced);
+  EXPECT_EQ(replaced ? shortcut.connection_id : peer.connection_id, chosen.connection_id);
+
+  // The target itself is skipped for group messages, but not for direct ones.
+  chosen = peer;
+  EXPECT_FALSE(shortcuts.NextHop(shortcut.node_id, true, chosen));
+  EXPECT_EQ(peer.node_id, chosen.node_id);
+  chosen = peer;
+  EXPECT_TRUE(shortcuts.NextHop(shortcut.node_id, false, chosen));
+  EXPECT_EQ(shortcut.node_id, chosen.node_id);
+
+  // Nor is a shortcut the message has already passed through.
+  RouteHistory route_history;
+  route_history.Add(shortcut.node_id);
+  chosen = peer;
+  EXPECT_FALSE(shortcuts.NextHop(shortcut.node_id, route_history, false, chosen));
+  EXPECT_EQ(peer.node_id, chosen.node_id);
+}
+
+TEST(ShortcutTableTest, BEH_TakeIdle) {
+  ShortcutTable shortcuts(4, 1, std::chrono::milliseconds(50));
+  NodeInfo idle(Peer(NodeId(NodeId::kRandomId))), used(Peer(NodeId(NodeId::kRandomId)));
+  NodeId evicted;
+  ASSERT_TRUE(shortcuts.Expect(idle.node_id));
+  ASSERT_TRUE(shortcuts.Add(idle, evicted));
+  ASSERT_TRUE(shortcuts.Expect(used.node_id));
+  ASSERT_TRUE(shortcuts.Add(used, evicted));
+  EXPECT_TRUE(shortcuts.TakeIdle().empty());
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  NodeInfo next_hop(Peer(NodeId(NodeId::kRandomId)));
+  ASSERT_TRUE(shortcuts.NextHop(used.node_id, false, next_hop));
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  std::vector<NodeId> taken(shortcuts.TakeIdle());
+  ASSERT_EQ(1U, taken.size());
+  EXPECT_EQ(idle.connection_id, taken.front());
+  EXPECT_TRUE(shortcuts.Contains(used.node_id));
+  EXPECT_FALSE(shortcuts.Contains(idle.node_id));
+
+  // An expected peer not added within the timeout is forgotten.
+  NodeInfo late(Peer(NodeId(NodeId::kRandomId)));
+  ASSERT_TRUE(shortcuts.Expect(late.node_id));
+  std::this_thread::sleep_for(std::chrono::milliseconds(60));
+  EXPECT_FALSE(shortcuts.IsExpected(late.node_id));
+  EXPECT_FALSE(shortcuts.Add(late, evicted));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,100 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "maidsafe/common/rsa.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/node_info.h"
+#include "maidsafe/routing/signature_verifier.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(SignatureVerifierTest, BEH_SignAndVerify) {
+  SignatureVerifier signature_verifier(2, 4, 16);
+  asymm::Keys keys(asymm::GenerateKeyPair()), other_keys(asymm::GenerateKeyPair());
+  std::string data(RandomString(1024));
+
+  std::promise<std::string> signed_promise;
+  signature_verifier.Sign(data, keys.private_key,
+                          [&](std::string signature) { signed_promise.set_value(signature); });
+  std::string signature(signed_promise.get_future().get());
+  ASSERT_FALSE(signature.empty());
+
+  auto verify([&](const std::string& data, const asymm::PublicKey& public_key,
+                  std::shared_ptr<const std::string> encoded_public_key) {
+    std::promise<bool> verdict;
+    signature_verifier.Verify(data, signature, public_key,
+                              [&](bool valid) { verdict.set_value(valid); }, encoded_public_key);
+    return verdict.get_future().get();
+  });
+  EXPECT_TRUE(verify(data, keys.public_key, nullptr));
+  // Cached verdict.
+  EXPECT_TRUE(verify(data, keys.public_key, nullptr));
+  EXPECT_FALSE(verify(data, other_keys.public_key, nullptr));
+  EXPECT_FALSE(verify(data + "a", keys.public_key, nullptr));
+
+  // A key encoded once, as the routing table holds it, gives the same verdicts.
+  NodeInfo node_info, other_node_info;
+  node_info.public_key = keys.public_key;
+  other_node_info.public_key = other_keys.public_key;
+  CacheEncodedPublicKey(node_info);
+  CacheEncodedPublicKey(other_node_info);
+  EXPECT_EQ(asymm::EncodeKey(keys.public_key).string(), *node_info.encoded_public_key);
+  EXPECT_TRUE(verify(data, node_info.public_key, node_info.encoded_public_key));
+  EXPECT_FALSE(verify(data, other_node_info.public_key, other_node_info.encoded_public_key));
+}
+
+TEST(SignatureVerifierTest, BEH_InlineWithoutThreads) {
+  // As for a lean client, jobs are run on the calling thread, before Sign or Verify returns.
+  SignatureVerifier signature_verifier(0, 4, 16);
+  asymm::Keys keys(asymm::GenerateKeyPair());
+  std::string data(RandomString(1024)), signature;
+  const std::thread::id kThisThread(std::this_thread::get_id());
+  signature_verifier.Sign(data, keys.private_key, [&](std::string result) {
+    EXPECT_EQ(kThisThread, std::this_thread::get_id());
+    signature = result;
+  });
+  ASSERT_FALSE(signature.empty());
+  int verdicts(0);
+  signature_verifier.Verify(data, signature, keys.public_key, [&](bool valid) {
+    EXPECT_EQ(kThisThread, std::this_thread::get_id());
+    EXPECT_TRUE(valid);
+    ++verdicts;
+  });
+  signature_verifier.Verify(data + "a", signature, keys.public_key, [&](bool valid) {
+    EXPECT_FALSE(valid);
+    ++verdicts;
+  });
+  EXPECT_EQ(2, verdicts);
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
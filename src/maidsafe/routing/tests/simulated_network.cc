@@ -0,0 +1,555 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/tests/simulated_network.h"
+
+#include <algorithm>
+#include <cassert>
+#include <ctime>
+#include <sstream>
+#include <string>
+
+#include "maidsafe/routing/node_info.h"
+#include "maidsafe/routing/parameters.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+SimulatedNetwork::Node::Node(const NodeId& node_id_in, const asymm::Keys& keys,
+                             const InstanceParameters& parameters)
+    : node_id(node_id_in),
+      public_key(),
+      alive(true),
+      network_statistics(node_id_in),
+      routing_table(false, node_id_in, keys, network_statistics, parameters),
+      holders(),
+      update_queued(false) {}
+
+SimulatedNetwork::Packet::Packet()
+    : type(PacketType::kData),
+      source(0),
+      destination_id(),
+      to_group(false),
+      hops(0),
+      route_history(),
+      sent_at(0) {}
+
+SimulatedNetwork::SimulatedNetwork(uint32_t seed, LinkProfile default_link,
+                                   const InstanceParameters& parameters)
+    : engine_(seed),
+      kDefaultLink_(default_link),
+      kParameters_(parameters),
+      kKeys_(asymm::GenerateKeyPair()),
+      links_(),
+      nodes_(),
+      indices_(),
+      joins_(),
+      events_(),
+      next_sequence_(0),
+      now_(0),
+      last_activity_(0),
+      statistics_() {}
+
+SimulatedNetwork::~SimulatedNetwork() {}
+
+void SimulatedNetwork::Populate(size_t node_count) {
+  for (size_t i(0); i != node_count; ++i)
+    AddNode(NewId());
+  std::vector<size_t> order;
+  for (size_t index(0); index != nodes_.size(); ++index) {
+    if (nodes_[index]->alive)
+      order.push_back(index);
+  }
+  if (order.size() < 2)
+    return;
+  // Nodes adjacent in ID order mostly share long prefixes, so are close by XOR distance too.
+  std::sort(order.begin(), order.end(),
+            [this](size_t lhs, size_t rhs) { return nodes_[lhs]->node_id < nodes_[rhs]->node_id; });
+  const size_t kWindow(2 * Parameters::closest_nodes_size);
+  for (size_t position(0); position != order.size(); ++position) {
+    for (size_t offset(1); offset <= kWindow && position + offset < order.size(); ++offset)
+      Connect(order[position], order[position + offset]);
+  }
+  std::uniform_int_distribution<size_t> distribution(0, order.size() - 1);
+  for (auto index : order) {
+    for (uint16_t i(0); i < kParameters_.max_routing_table_size / 2; ++i)
+      Connect(index, order[distribution(engine_)]);
+  }
+  Run();
+  now_ = last_activity_ = Duration(0);
+  ResetStatistics();
+}
+
+void SimulatedNetwork::SetLink(const NodeId& from, const NodeId& to, const LinkProfile& profile) {
+  links_[std::make_pair(indices_.at(from), indices_.at(to))] = profile;
+}
+
+NodeId SimulatedNetwork::Join() {
+  const size_t kBootstrap(indices_.at(RandomLiveNodeId()));
+  const NodeId kNodeId(NewId());
+  const size_t kJoining(AddNode(kNodeId));
+  ++statistics_.joins_started;
+  PendingJoin& join(joins_[kJoining]);
+  join.started_at = now_;
+  join.outstanding_connects = 0;
+  // The connection takes a round trip, after which the new node looks up its own ID.
+  const Duration kRoundTrip(Latency(Link(kJoining, kBootstrap)) +
+                            Latency(Link(kBootstrap, kJoining)));
+  ++statistics_.connects;
+  Schedule(kRoundTrip, [this, kJoining, kBootstrap, kNodeId] {
+    if (!Connect(kJoining, kBootstrap))
+      return;
+    Packet packet;
+    packet.type = PacketType::kFindNodes;
+    packet.source = kJoining;
+    packet.destination_id = kNodeId;
+    packet.to_group = true;
+    packet.sent_at = now_;
+    packet.route_history.Add(kNodeId);
+    ++statistics_.find_nodes;
+    Transmit(kJoining, kBootstrap, [this, kBootstrap, packet] { OnArrival(kBootstrap, packet); },
+             [] {});
+  });
+  return kNodeId;
+}
+
+void SimulatedNetwork::Leave(const NodeId& node_id) {
+  const size_t kIndex(indices_.at(node_id));
+  Node& node(*nodes_[kIndex]);
+  if (!node.alive)
+    return;
+  node.alive = false;
+  const Duration kDetection(kDefaultLink_.retransmit_timeout * kDefaultLink_.max_attempts);
+  for (auto holder : node.holders) {
+    Schedule(kDetection, [this, holder, node_id] {
+      if (nodes_[holder]->alive)
+        nodes_[holder]->routing_table.DropNode(node_id, true);
+    });
+  }
+  node.holders.clear();
+}
+
+void SimulatedNetwork::Send(const NodeId& source, const NodeId& destination, bool to_group) {
+  const size_t kSource(indices_.at(source));
+  ++statistics_.messages_sent;
+  Packet packet;
+  packet.source = kSource;
+  packet.destination_id = destination;
+  packet.to_group = to_group;
+  packet.sent_at = now_;
+  Schedule(Duration(0), [this, kSource, packet] { Forward(kSource, packet); });
+}
+
+SimulatedNetwork::Duration SimulatedNetwork::Run(Duration limit) {
+  while (!events_.empty() && events_.top().time <= limit) {
+    Event event(events_.top());
+    events_.pop();
+    now_ = last_activity_ = event.time;
+    event.action();
+  }
+  if (limit != Duration::max() && now_ < limit)
+    now_ = limit;
+  return now_;
+}
+
+std::vector<NodeId> SimulatedNetwork::LiveNodeIds() const {
+  std::vector<NodeId> node_ids;
+  for (const auto& node : nodes_) {
+    if (node->alive)
+      node_ids.push_back(node->node_id);
+  }
+  return node_ids;
+}
+
+NodeId SimulatedNetwork::RandomLiveNodeId() {
+  std::vector<NodeId> node_ids(LiveNodeIds());
+  assert(!node_ids.empty());
+  return node_ids[std::uniform_int_distribution<size_t>(0, node_ids.size() - 1)(engine_)];
+}
+
+RoutingTable& SimulatedNetwork::routing_table(const NodeId& node_id) {
+  return nodes_.at(indices_.at(node_id))->routing_table;
+}
+
+double SimulatedNetwork::CloseGroupAccuracy(size_t sample_size) {
+  std::vector<NodeId> node_ids(LiveNodeIds());
+  if (node_ids.size() < 2)
+    return 1.0;
+  std::vector<NodeId> sample(node_ids);
+  if (sample_size != 0 && sample_size < sample.size()) {
+    std::shuffle(sample.begin(), sample.end(), engine_);
+    sample.resize(sample_size);
+  }
+  const size_t kGroupSize(std::min(static_cast<size_t>(Parameters::closest_nodes_size),
+                                   node_ids.size() - 1));
+  size_t accurate(0);
+  for (const auto& node_id : sample) {
+    std::vector<NodeId> expected(node_ids);
+    expected.erase(std::find(expected.begin(), expected.end(), node_id));
+    std::partial_sort(expected.begin(), expected.begin() + kGroupSize, expected.end(),
+                      [&node_id](const NodeId& lhs, const NodeId& rhs) {
+                        return NodeId::CloserToTarget(lhs, rhs, node_id);
+                      });
+    expected.resize(kGroupSize);
+    std::vector<NodeId> actual(routing_table(node_id).GetClosestNodes(
+        node_id, static_cast<uint16_t>(kGroupSize)));
+    std::sort(expected.begin(), expected.end());
+    std::sort(actual.begin(), actual.end());
+    if (expected == actual)
+      ++accurate;
+  }
+  return static_cast<double>(accurate) / sample.size();
+}
+
+size_t SimulatedNetwork::AddNode(const NodeId& node_id) {
+  const size_t kIndex(nodes_.size());
+  nodes_.emplace_back(new Node(node_id, kKeys_, kParameters_));
+  const CryptoPP::Integer kExponent(static_cast<signed long>(2 * kIndex + 3));  // NOLINT
+  nodes_.back()->public_key.Initialize(kKeys_.public_key.GetModulus(), kExponent);
+  indices_[node_id] = kIndex;
+  nodes_.back()->routing_table.InitialiseFunctors(
+      [](int) {},  // NOLINT
+      [this, node_id](const NodeInfo& removed_node, bool /*internal_rudp_only*/) {
+        // The removed node learns of it when its connection is closed.
+        const size_t kRemoved(indices_.at(removed_node.node_id));
+        Schedule(Duration(0), [this, kRemoved, node_id] {
+          if (nodes_[kRemoved]->alive)
+            nodes_[kRemoved]->routing_table.DropNode(node_id, true);
+        });
+      },
+      [] {},
+      [this, kIndex](const std::vector<NodeInfo>& /*new_nodes*/,
+                     const std::vector<NodeInfo>& /*old_nodes*/) {
+        QueueClosestNodesUpdate(kIndex);
+      },
+      [this](std::shared_ptr<MatrixChange> /*matrix_change*/) { ++statistics_.matrix_changes; });
+  return kIndex;
+}
+
+void SimulatedNetwork::QueueClosestNodesUpdate(size_t index) {
+  if (nodes_[index]->update_queued)
+    return;
+  nodes_[index]->update_queued = true;
+  Schedule(std::chrono::duration_cast<Duration>(Parameters::closest_nodes_update_interval),
+           [this, index] { SendClosestNodesUpdate(index); });
+}
+
+void SimulatedNetwork::SendClosestNodesUpdate(size_t index) {
+  Node& node(*nodes_[index]);
+  node.update_queued = false;
+  if (!node.alive)
+    return;
+  const std::vector<NodeId> kClosest(
+      node.routing_table.GetClosestNodes(node.node_id, Parameters::closest_nodes_size));
+  if (kClosest.size() < Parameters::closest_nodes_size)
+    return;
+  std::vector<NodeInfo> closest_nodes;
+  for (const auto& node_id : kClosest)
+    closest_nodes.push_back(MakeNodeInfo(indices_.at(node_id)));
+  const NodeId kNodeId(node.node_id);
+  for (const auto& node_id : kClosest) {
+    const size_t kPeer(indices_.at(node_id));
+    ++statistics_.closest_nodes_updates;
+    Transmit(index, kPeer, [this, kPeer, kNodeId, closest_nodes] {
+      if (nodes_[kPeer]->alive)
+        nodes_[kPeer]->routing_table.GroupUpdateFromConnectedPeer(kNodeId, closest_nodes);
+    }, [] {});
+  }
+}
+
+NodeId SimulatedNetwork::NewId() {
+  for (;;) {
+    std::string id(NodeId::kSize, 0);
+    for (auto& byte : id)
+      byte = static_cast<char>(engine_() & 0xff);
+    NodeId node_id(id);
+    if (!node_id.IsZero() && indices_.count(node_id) == 0)
+      return node_id;
+  }
+}
+
+NodeInfo SimulatedNetwork::MakeNodeInfo(size_t index) const {
+  NodeInfo node_info;
+  node_info.node_id = nodes_[index]->node_id;
+  node_info.connection_id = node_info.node_id;
+  node_info.public_key = nodes_[index]->public_key;
+  return node_info;
+}
+
+void SimulatedNetwork::Schedule(Duration delay, std::function<void()> action) {
+  Event event;
+  event.time = now_ + delay;
+  event.sequence = next_sequence_++;
+  event.action = std::move(action);
+  events_.push(std::move(event));
+}
+
+const LinkProfile& SimulatedNetwork::Link(size_t from, size_t to) const {
+  auto itr(links_.find(std::make_pair(from, to)));
+  return itr == links_.end() ? kDefaultLink_ : itr->second;
+}
+
+SimulatedNetwork::Duration SimulatedNetwork::Latency(const LinkProfile& link) {
+  if (link.jitter.count() <= 0)
+    return link.latency;
+  std::uniform_int_distribution<int64_t> distribution(0, link.jitter.count() - 1);
+  return link.latency + Duration(distribution(engine_));
+}
+
+bool SimulatedNetwork::Connect(size_t lhs, size_t rhs) {
+  if (lhs == rhs || !nodes_[lhs]->alive || !nodes_[rhs]->alive)
+    return false;
+  Node& lhs_node(*nodes_[lhs]);
+  Node& rhs_node(*nodes_[rhs]);
+  const NodeInfo kLhsInfo(MakeNodeInfo(lhs)), kRhsInfo(MakeNodeInfo(rhs));
+  if (!lhs_node.routing_table.CheckNode(kRhsInfo) || !rhs_node.routing_table.CheckNode(kLhsInfo))
+    return false;
+  if (!lhs_node.routing_table.AddNode(kRhsInfo))
+    return false;
+  if (!rhs_node.routing_table.AddNode(kLhsInfo)) {
+    lhs_node.routing_table.DropNode(rhs_node.node_id, true);
+    return false;
+  }
+  lhs_node.holders.insert(rhs);
+  rhs_node.holders.insert(lhs);
+  return true;
+}
+
+void SimulatedNetwork::Transmit(size_t from, size_t to, std::function<void()> on_arrival,
+                                std::function<void()> on_failure, int attempt) {
+  ++statistics_.transmissions;
+  const LinkProfile& link(Link(from, to));
+  const bool kLost(!nodes_[to]->alive ||
+                   (link.loss > 0.0 &&
+                    std::uniform_real_distribution<double>(0.0, 1.0)(engine_) < link.loss));
+  if (!kLost) {
+    Schedule(Latency(link), std::move(on_arrival));
+    return;
+  }
+  ++statistics_.transmissions_lost;
+  if (attempt + 1 < link.max_attempts) {
+    Schedule(link.retransmit_timeout, [this, from, to, on_arrival, on_failure, attempt] {
+      Transmit(from, to, on_arrival, on_failure, attempt + 1);
+    });
+  } else {
+    Schedule(link.retransmit_timeout, std::move(on_failure));
+  }
+}
+
+void SimulatedNetwork::Forward(size_t at, Packet packet) {
+  Node& node(*nodes_[at]);
+  if (!node.alive)
+    return Fail(packet);
+  // As in NetworkUtils, only direct messages may be passed to a node with the destination's ID.
+  const bool kIgnoreExactMatch(packet.to_group);
+  if (!kIgnoreExactMatch && node.node_id == packet.destination_id)
+    return Deliver(at, packet);
+  if (node.routing_table.IsThisNodeClosestTo(packet.destination_id, kIgnoreExactMatch)) {
+    if (!kIgnoreExactMatch)
+      return Fail(packet);  // the destination isn't connected to its closest node
+    if (packet.type == PacketType::kFindNodes)
+      return OnFindNodes(at, packet);
+    return Deliver(at, packet);
+  }
+  if (packet.hops >= Parameters::hops_to_live)
+    return Fail(packet);
+
+  NodeInfo peer(node.routing_table.GetNodeForSendingMessage(packet.destination_id,
+                                                           packet.route_history,
+                                                           kIgnoreExactMatch));
+  if (peer.node_id.IsZero()) {
+    peer = node.routing_table.GetNodeForSendingMessage(packet.destination_id, RouteHistory(),
+                                                       kIgnoreExactMatch);
+  }
+  if (peer.node_id.IsZero())
+    return Fail(packet);
+  if (packet.type == PacketType::kFindNodes)
+    ++statistics_.find_nodes;
+  const size_t kNext(indices_.at(peer.node_id));
+  Packet forwarded(packet);
+  forwarded.route_history.Add(node.node_id);
+  const NodeId kPeerId(peer.node_id);
+  Transmit(at, kNext, [this, kNext, forwarded] { OnArrival(kNext, forwarded); },
+           [this, at, kPeerId, packet] {
+             if (nodes_[at]->alive)
+               nodes_[at]->routing_table.DropNode(kPeerId, true);
+             Forward(at, packet);
+           });
+}
+
+void SimulatedNetwork::OnArrival(size_t at, Packet packet) {
+  ++packet.hops;
+  if (packet.type == PacketType::kGroupCopy) {
+    ++statistics_.group_copies_delivered;
+    return;
+  }
+  Forward(at, packet);
+}
+
+void SimulatedNetwork::Deliver(size_t at, const Packet& packet) {
+  ++statistics_.messages_delivered;
+  statistics_.total_hops += packet.hops;
+  statistics_.max_hops = std::max(statistics_.max_hops, packet.hops);
+  statistics_.total_delivery_time += now_ - packet.sent_at;
+  if (!packet.to_group)
+    return;
+  // This node leads the group, so passes copies directly to the rest of it.
+  Packet copy(packet);
+  copy.type = PacketType::kGroupCopy;
+  for (const auto& member : nodes_[at]->routing_table.GetClosestNodes(
+           packet.destination_id, Parameters::group_size - 1)) {
+    const size_t kMember(indices_.at(member));
+    Transmit(at, kMember, [this, kMember, copy] { OnArrival(kMember, copy); }, [] {});
+  }
+}
+
+void SimulatedNetwork::Fail(const Packet& packet) {
+  if (packet.type == PacketType::kData)
+    ++statistics_.messages_failed;
+}
+
+void SimulatedNetwork::OnFindNodes(size_t at, const Packet& packet) {
+  std::vector<size_t> peers(1, at);
+  for (const auto& node_id : nodes_[at]->routing_table.GetClosestNodes(
+           packet.destination_id, Parameters::closest_nodes_size)) {
+    size_t index(indices_.at(node_id));
+    if (index != packet.source)
+      peers.push_back(index);
+  }
+  // The response is sent straight back, as the joining node is connected to the bootstrap node.
+  const size_t kJoining(packet.source);
+  Transmit(at, kJoining, [this, kJoining, peers] { ConnectJoiningNode(kJoining, peers); }, [] {});
+}
+
+void SimulatedNetwork::ConnectJoiningNode(size_t joining, const std::vector<size_t>& peers) {
+  auto join(joins_.find(joining));
+  if (join == joins_.end())
+    return;
+  join->second.outstanding_connects += peers.size();
+  if (join->second.outstanding_connects == 0) {
+    join->second.outstanding_connects = 1;
+    return CompleteConnect(joining);
+  }
+  statistics_.connects += peers.size();
+  for (auto peer : peers) {
+    const Duration kRoundTrip(Latency(Link(joining, peer)) + Latency(Link(peer, joining)));
+    Schedule(kRoundTrip, [this, joining, peer] {
+      Connect(joining, peer);
+      CompleteConnect(joining);
+    });
+  }
+}
+
+void SimulatedNetwork::CompleteConnect(size_t joining) {
+  auto join(joins_.find(joining));
+  if (join == joins_.end() || --join->second.outstanding_connects != 0)
+    return;
+  ++statistics_.joins_completed;
+  statistics_.total_join_time += now_ - join->second.started_at;
+  joins_.erase(join);
+}
+
+bool ParseChurnTrace(std::istream& stream, std::vector<ChurnEvent>& trace) {
+  std::string line;
+  while (std::getline(stream, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+    std::istringstream fields(line);
+    int64_t milliseconds(0);
+    std::string type;
+    if (!(fields >> milliseconds >> type) || milliseconds < 0 ||
+        (type != "join" && type != "leave"))
+      return false;
+    const SimulatedNetwork::Duration kAt(
+        std::chrono::duration_cast<SimulatedNetwork::Duration>(
+            std::chrono::milliseconds(milliseconds)));
+    if (!trace.empty() && kAt < trace.back().at)
+      return false;
+    trace.emplace_back(kAt, type == "join" ? ChurnEvent::Type::kJoin : ChurnEvent::Type::kLeave);
+  }
+  return true;
+}
+
+std::vector<ChurnEvent> MakeChurnTrace(size_t event_count, SimulatedNetwork::Duration interval) {
+  std::vector<ChurnEvent> trace;
+  for (size_t i(0); i != event_count; ++i) {
+    trace.emplace_back(interval * static_cast<int64_t>(i + 1),
+                       i % 2 == 0 ? ChurnEvent::Type::kJoin : ChurnEvent::Type::kLeave);
+  }
+  return trace;
+}
+
+ChurnReport ReplayChurn(SimulatedNetwork& network, const std::vector<ChurnEvent>& trace) {
+  typedef SimulatedNetwork::Duration Duration;
+  ChurnReport report;
+  if (trace.empty())
+    return report;
+  const std::clock_t kCpuStart(std::clock());
+  const Duration kStart(network.Run());
+  const SimulationStatistics kBefore(network.statistics());
+  Duration total_time_to_stable(0);
+  double node_seconds(0.0);
+  for (size_t i(0); i != trace.size(); ++i) {
+    const Duration kAt(kStart + trace[i].at);
+    network.Run(kAt);
+    if (trace[i].type == ChurnEvent::Type::kJoin)
+      network.Join();
+    else if (network.LiveNodeIds().size() > 1)
+      network.Leave(network.RandomLiveNodeId());
+    const Duration kNext(i + 1 == trace.size() ? Duration::max() : kStart + trace[i + 1].at);
+    network.Run(kNext == Duration::max() ? kNext : kNext - Duration(1));
+    if (network.Idle()) {
+      const Duration kTimeToStable(std::max(network.LastActivity(), kAt) - kAt);
+      total_time_to_stable += kTimeToStable;
+      report.max_time_to_stable = std::max(report.max_time_to_stable, kTimeToStable);
+    } else {
+      ++report.unsettled_events;
+    }
+    const Duration kSpan((kNext == Duration::max() ? network.LastActivity() : kNext) - kAt);
+    node_seconds += network.LiveNodeIds().size() *
+                    std::chrono::duration_cast<std::chrono::duration<double>>(kSpan).count();
+  }
+  const SimulationStatistics& kAfter(network.statistics());
+  const double kEvents(static_cast<double>(trace.size()));
+  report.events = trace.size();
+  const size_t kSettled(trace.size() - report.unsettled_events);
+  if (kSettled != 0)
+    report.mean_time_to_stable = total_time_to_stable / static_cast<int64_t>(kSettled);
+  report.connects_per_event = (kAfter.connects - kBefore.connects) / kEvents;
+  report.find_nodes_per_event = (kAfter.find_nodes - kBefore.find_nodes) / kEvents;
+  report.closest_nodes_updates_per_event =
+      (kAfter.closest_nodes_updates - kBefore.closest_nodes_updates) / kEvents;
+  report.matrix_changes_per_event = (kAfter.matrix_changes - kBefore.matrix_changes) / kEvents;
+  if (node_seconds > 0.0) {
+    report.matrix_changes_per_node_second =
+        (kAfter.matrix_changes - kBefore.matrix_changes) / node_seconds;
+  }
+  report.cpu_microseconds_per_node =
+      1e6 * static_cast<double>(std::clock() - kCpuStart) / CLOCKS_PER_SEC /
+      std::max<size_t>(network.LiveNodeIds().size(), 1);
+  return report;
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
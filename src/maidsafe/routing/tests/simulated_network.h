@@ -0,0 +1,272 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_TESTS_SIMULATED_NETWORK_H_
+#define MAIDSAFE_ROUTING_TESTS_SIMULATED_NETWORK_H_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <map>
+#include <memory>
+#include <queue>
+#include <random>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/rsa.h"
+
+#include "maidsafe/routing/network_statistics.h"
+#include "maidsafe/routing/node_id_hash.h"
+#include "maidsafe/routing/route_history.h"
+#include "maidsafe/routing/routing_table.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+// How transmissions over a link behave.  A lost transmission is resent after retransmit_timeout,
+// as rudp would, and after max_attempts failures the sender drops the peer and reroutes, as
+// NetworkUtils::RecursiveSendOn does.
+struct LinkProfile {
+  LinkProfile()
+      : latency(std::chrono::milliseconds(20)),
+        jitter(std::chrono::milliseconds(5)),
+        loss(0.0),
+        retransmit_timeout(std::chrono::milliseconds(200)),
+        max_attempts(3) {}
+  std::chrono::microseconds latency, jitter;  // each transmission takes latency + [0, jitter)
+  double loss;                                // chance of each transmission being lost
+  std::chrono::microseconds retransmit_timeout;
+  int max_attempts;
+};
+
+struct SimulationStatistics {
+  SimulationStatistics()
+      : messages_sent(0),
+        messages_delivered(0),
+        messages_failed(0),
+        transmissions(0),
+        transmissions_lost(0),
+        group_copies_delivered(0),
+        connects(0),
+        find_nodes(0),
+        closest_nodes_updates(0),
+        matrix_changes(0),
+        total_hops(0),
+        max_hops(0),
+        total_delivery_time(0),
+        joins_started(0),
+        joins_completed(0),
+        total_join_time(0) {}
+  double AverageHops() const {
+    return messages_delivered == 0 ? 0.0 : static_cast<double>(total_hops) / messages_delivered;
+  }
+
+  uint64_t messages_sent, messages_delivered, messages_failed;
+  uint64_t transmissions, transmissions_lost;  // every attempt over a link, including group copies
+  uint64_t group_copies_delivered;  // by group leaders to the rest of the group
+  // Connections attempted by joining nodes, and the routing messages the real protocol would send.
+  uint64_t connects, find_nodes, closest_nodes_updates;
+  uint64_t matrix_changes;  // MatrixChangedFunctor invocations, summed over nodes
+  uint64_t total_hops;
+  uint16_t max_hops;
+  std::chrono::microseconds total_delivery_time;
+  uint64_t joins_started, joins_completed;
+  std::chrono::microseconds total_join_time;
+};
+
+// Runs many nodes' routing tables in one process over a simulated transport with a virtual clock,
+// so that routing, churn and group message experiments at thousands of nodes are quick and
+// repeatable.  Messages are forwarded using the routing tables' own next hop choices, as
+// NetworkUtils would, but nothing is serialised and no sockets are used.  As in Routing::Impl, a
+// change to a node's close group queues a ClosestNodesUpdate to its close peers, sent after
+// Parameters::closest_nodes_update_interval, and a peer evicted to make space drops the evictor.
+// Events are run one at a time in virtual time order, ties broken by scheduling order, and all
+// randomness comes from seed, so a given sequence of calls always gives the same results.
+class SimulatedNetwork {
+ public:
+  typedef std::chrono::microseconds Duration;
+
+  // Every node's routing table is given parameters.
+  explicit SimulatedNetwork(uint32_t seed, LinkProfile default_link = LinkProfile(),
+                            const InstanceParameters& parameters = InstanceParameters());
+  ~SimulatedNetwork();
+
+  // Adds node_count nodes at once, each connected to those near it and to a random sample of the
+  // rest, as far as their routing tables accept.  Then runs until the resulting updates have
+  // settled, and resets the clock and statistics.
+  void Populate(size_t node_count);
+  // Overrides the default profile for transmissions from one node to another.
+  void SetLink(const NodeId& from, const NodeId& to, const LinkProfile& profile);
+  // Starts a new node joining via a random live node, as a real node would: it connects to the
+  // bootstrap node, looks up its own ID, then connects to the close nodes returned.
+  NodeId Join();
+  // The node disappears without notice.  Its peers drop it once rudp would have noticed, after
+  // max_attempts retransmit timeouts, or sooner if a send to it fails first.
+  void Leave(const NodeId& node_id);
+  // Sends from source to the node with destination's ID, or to destination's group.
+  void Send(const NodeId& source, const NodeId& destination, bool to_group);
+  // Runs events until none remain or virtual time would pass limit, then advances the clock to
+  // limit if one was given.  Returns the virtual time.
+  Duration Run(Duration limit = Duration::max());
+
+  Duration Now() const { return now_; }
+  bool Idle() const { return events_.empty(); }
+  // The virtual time of the last event run.
+  Duration LastActivity() const { return last_activity_; }
+  std::vector<NodeId> LiveNodeIds() const;
+  NodeId RandomLiveNodeId();
+  RoutingTable& routing_table(const NodeId& node_id);
+  // Fraction of live nodes (or of sample_size of them, chosen at random) whose closest
+  // Parameters::closest_nodes_size routing table entries are the closest live nodes.
+  double CloseGroupAccuracy(size_t sample_size = 0);
+  const SimulationStatistics& statistics() const { return statistics_; }
+  void ResetStatistics() { statistics_ = SimulationStatistics(); }
+
+ private:
+  SimulatedNetwork(const SimulatedNetwork&);
+  SimulatedNetwork& operator=(const SimulatedNetwork&);
+
+  struct Node {
+    Node(const NodeId& node_id, const asymm::Keys& keys, const InstanceParameters& parameters);
+    NodeId node_id;
+    // Routing tables refuse a second peer with the same key, so each node has its own.  They
+    // differ only in exponent, as nothing here signs or verifies.
+    asymm::PublicKey public_key;
+    bool alive;
+    NetworkStatistics network_statistics;
+    RoutingTable routing_table;
+    std::set<size_t> holders;  // nodes which may have this one in their routing tables
+    bool update_queued;
+  };
+
+  enum class PacketType { kData, kGroupCopy, kFindNodes };
+
+  struct Packet {
+    Packet();
+    PacketType type;
+    size_t source;
+    NodeId destination_id;
+    bool to_group;
+    uint16_t hops;
+    RouteHistory route_history;
+    Duration sent_at;
+  };
+
+  struct Event {
+    Duration time;
+    uint64_t sequence;
+    std::function<void()> action;
+    bool operator>(const Event& other) const {
+      return time != other.time ? time > other.time : sequence > other.sequence;
+    }
+  };
+
+  struct PendingJoin {
+    Duration started_at;
+    size_t outstanding_connects;
+  };
+
+  size_t AddNode(const NodeId& node_id);
+  void QueueClosestNodesUpdate(size_t index);
+  void SendClosestNodesUpdate(size_t index);
+  NodeId NewId();
+  NodeInfo MakeNodeInfo(size_t index) const;
+  void Schedule(Duration delay, std::function<void()> action);
+  const LinkProfile& Link(size_t from, size_t to) const;
+  Duration Latency(const LinkProfile& link);
+  // Adds each to the other's routing table if both accept.
+  bool Connect(size_t lhs, size_t rhs);
+  // Makes one attempt at a transmission, calling on_arrival or finally on_failure.
+  void Transmit(size_t from, size_t to, std::function<void()> on_arrival,
+                std::function<void()> on_failure, int attempt = 0);
+  void Forward(size_t at, Packet packet);
+  void OnArrival(size_t at, Packet packet);
+  void Deliver(size_t at, const Packet& packet);
+  void Fail(const Packet& packet);
+  void OnFindNodes(size_t at, const Packet& packet);
+  void ConnectJoiningNode(size_t joining, const std::vector<size_t>& peers);
+  void CompleteConnect(size_t joining);
+
+  std::mt19937 engine_;
+  const LinkProfile kDefaultLink_;
+  const InstanceParameters kParameters_;
+  const asymm::Keys kKeys_;
+  std::map<std::pair<size_t, size_t>, LinkProfile> links_;
+  std::vector<std::unique_ptr<Node>> nodes_;
+  std::unordered_map<NodeId, size_t, NodeIdHash> indices_;
+  std::map<size_t, PendingJoin> joins_;
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events_;
+  uint64_t next_sequence_;
+  Duration now_, last_activity_;
+  SimulationStatistics statistics_;
+};
+
+struct ChurnEvent {
+  enum class Type { kJoin, kLeave };
+  ChurnEvent(SimulatedNetwork::Duration at_in, Type type_in) : at(at_in), type(type_in) {}
+  SimulatedNetwork::Duration at;  // virtual time, from the start of the replay
+  Type type;                      // a leave picks a random live node
+};
+
+struct ChurnReport {
+  ChurnReport()
+      : events(0),
+        unsettled_events(0),
+        mean_time_to_stable(0),
+        max_time_to_stable(0),
+        connects_per_event(0.0),
+        find_nodes_per_event(0.0),
+        closest_nodes_updates_per_event(0.0),
+        matrix_changes_per_event(0.0),
+        matrix_changes_per_node_second(0.0),
+        cpu_microseconds_per_node(0.0) {}
+  size_t events;
+  // Events which the network hadn't settled after before the next event.  These are left out of
+  // the times to stable, but their messages still count.
+  size_t unsettled_events;
+  // From each event until the last routing activity it caused.
+  SimulatedNetwork::Duration mean_time_to_stable, max_time_to_stable;
+  double connects_per_event, find_nodes_per_event, closest_nodes_updates_per_event,
+      matrix_changes_per_event;
+  double matrix_changes_per_node_second;  // of virtual time
+  double cpu_microseconds_per_node;       // of process time, over the whole replay
+};
+
+// Reads a trace of lines "<milliseconds> join" or "<milliseconds> leave", in time order.  Blank
+// lines and lines starting with '#' are skipped.  Returns false on a malformed line.
+bool ParseChurnTrace(std::istream& stream, std::vector<ChurnEvent>& trace);
+// Alternates joins and leaves, interval apart.
+std::vector<ChurnEvent> MakeChurnTrace(size_t event_count, SimulatedNetwork::Duration interval);
+// Applies trace to network, which should already be populated, running it between events.
+ChurnReport ReplayChurn(SimulatedNetwork& network, const std::vector<ChurnEvent>& trace);
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_TESTS_SIMULATED_NETWORK_H_
@@ -0,0 +1,167 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/tests/simulated_network.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+void SendRandomMessages(SimulatedNetwork& network, int count, bool to_group) {
+  for (int i(0); i != count; ++i)
+    network.Send(network.RandomLiveNodeId(), network.RandomLiveNodeId(), to_group);
+}
+
+}  // unnamed namespace
+
+TEST(SimulatedNetworkTest, BEH_SameSeedSameResults) {
+  SimulationStatistics statistics[2];
+  for (auto& result : statistics) {
+    LinkProfile link;
+    link.loss = 0.05;
+    SimulatedNetwork network(7, link);
+    network.Populate(64);
+    SendRandomMessages(network, 50, false);
+    SendRandomMessages(network, 50, true);
+    network.Join();
+    network.Run();
+    result = network.statistics();
+  }
+  EXPECT_EQ(statistics[0].transmissions, statistics[1].transmissions);
+  EXPECT_EQ(statistics[0].transmissions_lost, statistics[1].transmissions_lost);
+  EXPECT_EQ(statistics[0].total_hops, statistics[1].total_hops);
+  EXPECT_EQ(statistics[0].total_delivery_time, statistics[1].total_delivery_time);
+  EXPECT_EQ(statistics[0].total_join_time, statistics[1].total_join_time);
+}
+
+TEST(SimulatedNetworkTest, BEH_RoutesDirectAndGroupMessages) {
+  SimulatedNetwork network(1);
+  network.Populate(128);
+  SendRandomMessages(network, 100, false);
+  SendRandomMessages(network, 100, true);
+  network.Run();
+  const SimulationStatistics& statistics(network.statistics());
+  EXPECT_EQ(200U, statistics.messages_sent);
+  // Tables aren't always symmetric, so a destination can occasionally be missing from its closest
+  // node's table.
+  EXPECT_GE(statistics.messages_delivered, 196U);
+  EXPECT_EQ(statistics.messages_sent, statistics.messages_delivered + statistics.messages_failed);
+  EXPECT_EQ(100U * (Parameters::group_size - 1), statistics.group_copies_delivered);
+  EXPECT_LT(statistics.AverageHops(), 8.0);
+  EXPECT_GT(network.Now().count(), 0);
+}
+
+TEST(SimulatedNetworkTest, BEH_ReroutesAroundLossAndDeparture) {
+  LinkProfile link;
+  link.loss = 0.1;
+  SimulatedNetwork network(2, link);
+  network.Populate(128);
+  for (int i(0); i != 10; ++i)
+    network.Leave(network.RandomLiveNodeId());
+  EXPECT_EQ(118U, network.LiveNodeIds().size());
+  SendRandomMessages(network, 100, false);
+  network.Run();
+  const SimulationStatistics& statistics(network.statistics());
+  EXPECT_GT(statistics.transmissions_lost, 0U);
+  EXPECT_GE(statistics.messages_delivered, 95U);
+  EXPECT_EQ(statistics.messages_sent, statistics.messages_delivered + statistics.messages_failed);
+}
+
+TEST(SimulatedNetworkTest, BEH_JoiningNodesFindTheirCloseGroups) {
+  SimulatedNetwork network(3);
+  network.Populate(128);
+  std::vector<NodeId> joined;
+  for (int i(0); i != 16; ++i)
+    joined.push_back(network.Join());
+  network.Run();
+  const SimulationStatistics& statistics(network.statistics());
+  EXPECT_EQ(16U, statistics.joins_completed);
+  EXPECT_GT(statistics.total_join_time.count(), 0);
+  for (const auto& node_id : joined) {
+    EXPECT_GE(network.routing_table(node_id).size(), Parameters::closest_nodes_size);
+    network.Send(network.RandomLiveNodeId(), node_id, false);
+  }
+  network.Run();
+  EXPECT_GE(network.statistics().messages_delivered, 15U);
+}
+
+TEST(SimulatedNetworkTest, BEH_ReplaysChurnTrace) {
+  std::istringstream bad_trace("100 join\n50 leave\n");
+  std::vector<ChurnEvent> trace;
+  EXPECT_FALSE(ParseChurnTrace(bad_trace, trace));
+  trace.clear();
+  std::istringstream good_trace("# time type\n100 join\n\n1100 leave\n2100 join\n3100 leave\n");
+  ASSERT_TRUE(ParseChurnTrace(good_trace, trace));
+  ASSERT_EQ(4U, trace.size());
+  EXPECT_EQ(ChurnEvent::Type::kLeave, trace[1].type);
+
+  SimulatedNetwork network(4);
+  network.Populate(128);
+  EXPECT_EQ(0U, network.statistics().closest_nodes_updates);
+  const ChurnReport kReport(ReplayChurn(network, trace));
+  EXPECT_EQ(4U, kReport.events);
+  EXPECT_EQ(0U, kReport.unsettled_events);
+  EXPECT_GT(kReport.mean_time_to_stable.count(), 0);
+  EXPECT_GE(kReport.max_time_to_stable, kReport.mean_time_to_stable);
+  EXPECT_GT(kReport.connects_per_event, 0.0);
+  EXPECT_GT(kReport.closest_nodes_updates_per_event, 0.0);
+  EXPECT_GT(kReport.matrix_changes_per_event, 0.0);
+  EXPECT_EQ(128U, network.LiveNodeIds().size());
+}
+
+TEST(SimulatedNetworkTest, FUNC_LargeNetworkWithChurn) {
+  SimulatedNetwork network(4);
+  network.Populate(2000);
+  LOG(kInfo) << "Close group accuracy after populating: " << network.CloseGroupAccuracy(200);
+  for (int round(0); round != 10; ++round) {
+    for (int i(0); i != 10; ++i) {
+      network.Leave(network.RandomLiveNodeId());
+      network.Join();
+    }
+    SendRandomMessages(network, 100, false);
+    SendRandomMessages(network, 100, true);
+    network.Run();
+  }
+  const SimulationStatistics& statistics(network.statistics());
+  LOG(kInfo) << "Messages: " << statistics.messages_delivered << " of "
+             << statistics.messages_sent << " delivered in an average of "
+             << statistics.AverageHops() << " hops, " << statistics.transmissions
+             << " transmissions.  Joins took an average of "
+             << statistics.total_join_time.count() / std::max<uint64_t>(statistics.joins_completed,
+                                                                          1) << " us.";
+  EXPECT_EQ(100U, statistics.joins_completed);
+  EXPECT_GE(statistics.messages_delivered, statistics.messages_sent * 99 / 100);
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -71,6 +71,23 @@ void SortNodeInfosFromTarget(const NodeId& target, std::vector<NodeInfo>& nodes)
 
 bool CompareListOfNodeInfos(const std::vector<NodeInfo>& lhs, const std::vector<NodeInfo>& rhs);
 
+// Sets parameter to value for its lifetime, restoring the old value however the test ends.
+template <typename T>
+class ScopedParameter {
+ public:
+  ScopedParameter(T& parameter, T value) : parameter_(parameter), kOldValue_(parameter) {
+    parameter_ = value;
+  }
+  ~ScopedParameter() { parameter_ = kOldValue_; }
+
+ private:
+  ScopedParameter(const ScopedParameter&);
+  ScopedParameter& operator=(const ScopedParameter&);
+
+  T& parameter_;
+  const T kOldValue_;
+};
+
 }  // namespace test
 
 }  // namespace routing
@@ -0,0 +1,79 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#if defined MAIDSAFE_LINUX
+#include <sched.h>
+#endif
+
+#include <future>
+#include <vector>
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/thread_placement.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(ThreadPlacementTest, BEH_PinAsioThreads) {
+  const uint16_t kThreadCount(3);
+  AsioService asio_service(kThreadCount);
+  EXPECT_EQ(0, PinAsioThreads(asio_service, kThreadCount, std::vector<uint32_t>()));
+#if defined MAIDSAFE_LINUX
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(allowed), &allowed));
+  uint32_t cpu(0);
+  while (!CPU_ISSET(cpu, &allowed))
+    ++cpu;
+  EXPECT_EQ(kThreadCount,
+            PinAsioThreads(asio_service, kThreadCount, std::vector<uint32_t>(1, cpu)));
+  // Whichever thread runs them, tasks now run on that CPU.
+  std::vector<std::future<int>> cpus;
+  for (uint16_t i(0); i != kThreadCount * 4; ++i) {
+    auto running_on(std::make_shared<std::promise<int>>());
+    cpus.push_back(running_on->get_future());
+    asio_service.service().post([running_on] { running_on->set_value(sched_getcpu()); });
+  }
+  for (auto& running_on : cpus)
+    EXPECT_EQ(static_cast<int>(cpu), running_on.get());
+  EXPECT_FALSE(PinThisThread(CPU_SETSIZE));
+#else
+  EXPECT_EQ(0, PinAsioThreads(asio_service, kThreadCount, std::vector<uint32_t>(1, 0)));
+#endif
+}
+
+TEST(ThreadPlacementTest, BEH_CpusAfter) {
+  EXPECT_TRUE(CpusAfter(std::vector<uint32_t>(), 3).empty());
+  const std::vector<uint32_t> kCpus{4, 5, 6};
+  EXPECT_EQ(kCpus, CpusAfter(kCpus, 0));
+  EXPECT_EQ(std::vector<uint32_t>({5, 6, 4}), CpusAfter(kCpus, 1));
+  EXPECT_EQ(std::vector<uint32_t>({6, 4, 5}), CpusAfter(kCpus, 5));
+  // Two pools in turn end where one pool of both their sizes would.
+  EXPECT_EQ(CpusAfter(kCpus, 4), CpusAfter(CpusAfter(kCpus, 2), 2));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
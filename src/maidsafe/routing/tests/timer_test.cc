@@ -21,8 +21,11 @@
 #include <cstdint>
 #include <iterator>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "maidsafe/common/asio_service.h"
 #include "maidsafe/common/error.h"
@@ -74,7 +77,7 @@ class TimerTest : public testing::Test {
 
   void TearDown() override {
     asio_service_.Stop();
-    EXPECT_TRUE(timer_.tasks_.empty());
+    EXPECT_EQ(0U, timer_.task_count_);
   }
 
  protected:
@@ -243,6 +246,95 @@ TEST_F(TimerTest, BEH_CancelTask) {
   EXPECT_EQ(failed_response_count_, kGroupSize_ - 1);
 }
 
+TEST_F(TimerTest, BEH_TimeoutFunctorDestroysTimer) {
+  std::unique_ptr<Timer<std::string>> timer(new Timer<std::string>(asio_service_));
+  bool destroyed(false);
+  timer->AddTask(std::chrono::milliseconds(50), [&](std::string response) {
+                   EXPECT_TRUE(response.empty());
+                   timer.reset();
+                   std::lock_guard<std::mutex> lock(mutex_);
+                   destroyed = true;
+                   cond_var_.notify_one();
+                 }, 1, timer->NewTaskId());
+  std::unique_lock<std::mutex> lock(mutex_);
+  EXPECT_TRUE(cond_var_.wait_for(lock, std::chrono::seconds(2), [&] { return destroyed; }));
+}
+
+TEST_F(TimerTest, BEH_TimeoutsAcrossWheelLevels) {
+  // 700ms is beyond the wheel's first level, so that task has to be cascaded down before expiring.
+  std::chrono::steady_clock::time_point short_expiry, long_expiry;
+  const auto kStart(std::chrono::steady_clock::now());
+  timer_.AddTask(std::chrono::milliseconds(50), [&](std::string) {
+                   std::lock_guard<std::mutex> lock(mutex_);
+                   short_expiry = std::chrono::steady_clock::now();
+                   ++failed_response_count_;
+                   cond_var_.notify_one();
+                 }, 1, timer_.NewTaskId());
+  timer_.AddTask(std::chrono::milliseconds(700), [&](std::string) {
+                   std::lock_guard<std::mutex> lock(mutex_);
+                   long_expiry = std::chrono::steady_clock::now();
+                   ++failed_response_count_;
+                   cond_var_.notify_one();
+                 }, 1, timer_.NewTaskId());
+  std::unique_lock<std::mutex> lock(mutex_);
+  ASSERT_TRUE(cond_var_.wait_for(lock, std::chrono::seconds(2),
+                                 [&] { return failed_response_count_ == 2U; }));
+  EXPECT_GE(short_expiry - kStart, std::chrono::milliseconds(50));
+  EXPECT_LT(short_expiry - kStart, std::chrono::milliseconds(200));
+  EXPECT_GE(long_expiry - kStart, std::chrono::milliseconds(700));
+  EXPECT_LT(long_expiry - kStart, std::chrono::milliseconds(850));
+}
+
+TEST_F(TimerTest, BEH_GroupTask) {
+  std::vector<std::string> received;
+  int calls(0);
+  Timer<std::string>::GroupResponseFunctor group_functor(
+      [&](std::vector<std::string> responses) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        received = std::move(responses);
+        ++calls;
+        cond_var_.notify_one();
+      });
+  EXPECT_THROW(timer_.AddGroupTask(std::chrono::seconds(1), nullptr, 4, timer_.NewTaskId()),
+               maidsafe_error);
+  EXPECT_THROW(timer_.AddGroupTask(std::chrono::seconds(1), group_functor, 0, timer_.NewTaskId()),
+               maidsafe_error);
+
+  // All expected responses arrive.
+  auto task_id(timer_.NewTaskId());
+  timer_.AddGroupTask(std::chrono::seconds(10), group_functor, 3, task_id);
+  for (int i(0); i != 3; ++i)
+    timer_.AddResponse(task_id, std::to_string(i));
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ASSERT_TRUE(cond_var_.wait_for(lock, std::chrono::seconds(2), [&] { return calls == 1; }));
+    EXPECT_EQ(std::vector<std::string>({"0", "1", "2"}), received);
+  }
+
+  // Completes early once two of four match, and later responses are rejected.
+  task_id = timer_.NewTaskId();
+  timer_.AddGroupTask(std::chrono::seconds(10), group_functor, 4, task_id,
+                      Timer<std::string>::IdenticalResponses(2));
+  timer_.AddResponse(task_id, message_);
+  timer_.AddResponse(task_id, "other");
+  std::string moved_response(message_);
+  timer_.AddResponse(task_id, std::move(moved_response));
+  EXPECT_THROW(timer_.AddResponse(task_id, message_), maidsafe_error);
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ASSERT_TRUE(cond_var_.wait_for(lock, std::chrono::seconds(2), [&] { return calls == 2; }));
+    EXPECT_EQ(std::vector<std::string>({message_, "other", message_}), received);
+  }
+
+  // Times out with only the responses received.
+  task_id = timer_.NewTaskId();
+  timer_.AddGroupTask(std::chrono::milliseconds(100), group_functor, 4, task_id);
+  timer_.AddResponse(task_id, message_);
+  std::unique_lock<std::mutex> lock(mutex_);
+  ASSERT_TRUE(cond_var_.wait_for(lock, std::chrono::seconds(2), [&] { return calls == 3; }));
+  EXPECT_EQ(std::vector<std::string>(1, message_), received);
+}
+
 struct MessageDetails {
   MessageDetails()
       : message(RandomAlphaNumericString(30)),
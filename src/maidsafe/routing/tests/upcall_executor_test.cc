@@ -0,0 +1,115 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/metrics.h"
+#include "maidsafe/routing/upcall_executor.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(UpcallExecutorTest, BEH_RunsInlineWithoutThreads) {
+  UpcallExecutor executor(0, 0);
+  std::thread::id caller(std::this_thread::get_id()), runner;
+  EXPECT_TRUE(executor.Post([&runner]() { runner = std::this_thread::get_id(); }));
+  EXPECT_EQ(caller, runner);
+  EXPECT_EQ(0U, executor.queued());
+}
+
+TEST(UpcallExecutorTest, BEH_RefusesUpcallsBeyondQueueLimit) {
+  Metrics metrics;
+  UpcallExecutor executor(1, 2);
+  executor.set_metrics(&metrics);
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool released(false);
+  std::atomic<int> run_count(0);
+  auto blocking_upcall([&]() {
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [&released] { return released; });
+    ++run_count;
+  });
+  EXPECT_TRUE(executor.Post(blocking_upcall));
+  // Wait for the thread to take the first up-call, leaving the whole queue free.
+  for (int i(0); i != 100 && executor.queued() != 0; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_TRUE(executor.Post([&run_count]() { ++run_count; }));
+  EXPECT_TRUE(executor.Post([&run_count]() { ++run_count; }));
+  EXPECT_FALSE(executor.Post([&run_count]() { ++run_count; }));
+  EXPECT_EQ(2U, executor.queued());
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    released = true;
+  }
+  condition.notify_all();
+  for (int i(0); i != 100 && run_count != 3; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(3, run_count);
+  MetricsSnapshot snapshot;
+  metrics.Snapshot(snapshot);
+  EXPECT_EQ(3U, snapshot.upcalls);
+  EXPECT_LT(0U, snapshot.upcall_queue_delay_us);
+}
+
+TEST(UpcallExecutorTest, BEH_DropsExpiredUpcalls) {
+  Metrics metrics;
+  UpcallExecutor executor(1, 4);
+  executor.set_metrics(&metrics);
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool released(false);
+  std::atomic<int> run_count(0);
+  EXPECT_TRUE(executor.Post([&]() {
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [&released] { return released; });
+    ++run_count;
+  }));
+  for (int i(0); i != 100 && executor.queued() != 0; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_TRUE(executor.Post([&run_count]() { ++run_count; },
+                            std::chrono::steady_clock::now() + std::chrono::milliseconds(10)));
+  EXPECT_TRUE(executor.Post([&run_count]() { ++run_count; }));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    released = true;
+  }
+  condition.notify_all();
+  for (int i(0); i != 100 && run_count != 2; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(2, run_count);
+  MetricsSnapshot snapshot;
+  metrics.Snapshot(snapshot);
+  EXPECT_EQ(1U, snapshot.drops[static_cast<size_t>(DropReason::kExpired)]);
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,144 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <string>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/utils.h"
+#include "maidsafe/routing/tests/test_utils.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(UtilsTest, BEH_SetTimeLeft) {
+  protobuf::Message message;
+  {
+    ScopedParameter<bool> request_deadlines(Parameters::request_deadlines, false);
+    SetTimeLeft(std::chrono::seconds(1), message);
+    EXPECT_FALSE(message.has_time_left());
+  }
+  ScopedParameter<bool> request_deadlines(Parameters::request_deadlines, true);
+  SetTimeLeft(std::chrono::seconds(1), message);
+  EXPECT_EQ(1000U, message.time_left());
+  SetTimeLeft(std::chrono::milliseconds(-5), message);
+  EXPECT_EQ(0U, message.time_left());
+}
+
+TEST(UtilsTest, BEH_DeductTimeLeft) {
+  protobuf::Message message;
+  const auto kReceived(std::chrono::steady_clock::now() - std::chrono::milliseconds(300));
+  // Without a time_left, the message is left as it is.
+  DeductTimeLeft(kReceived, message);
+  EXPECT_FALSE(message.has_time_left());
+
+  message.set_time_left(1000);
+  DeductTimeLeft(kReceived, message);
+  EXPECT_LE(message.time_left(), 700U);
+  EXPECT_GT(message.time_left(), 0U);
+
+  // Time spent beyond what was left leaves none, rather than wrapping round.
+  message.set_time_left(100);
+  DeductTimeLeft(kReceived, message);
+  ASSERT_TRUE(message.has_time_left());
+  EXPECT_EQ(0U, message.time_left());
+}
+
+TEST(UtilsTest, BEH_IsExpired) {
+  protobuf::Message message;
+  EXPECT_FALSE(IsExpired(message));
+  message.set_time_left(1);
+  EXPECT_FALSE(IsExpired(message));
+  message.set_time_left(0);
+  EXPECT_TRUE(IsExpired(message));
+  message.clear_time_left();
+  EXPECT_FALSE(IsExpired(message));
+}
+
+TEST(UtilsTest, BEH_UncompressDataIsBounded) {
+  protobuf::Message message;
+  const std::string kPayload(1000, 'a');
+  message.add_data(kPayload);
+  CompressData(message);
+  ASSERT_TRUE(message.compressed());
+  EXPECT_TRUE(UncompressData(message));
+  EXPECT_FALSE(message.compressed());
+  EXPECT_EQ(kPayload, message.data(0));
+
+  // A small payload which would inflate past max_data_size is refused.
+  message.set_data(0, std::string(Parameters::max_data_size + 1, 'a'));
+  CompressData(message);
+  ASSERT_TRUE(message.compressed());
+  EXPECT_LT(message.data(0).size(), 64U * 1024);
+  EXPECT_FALSE(UncompressData(message));
+
+  message.set_data(0, "not gzip");
+  EXPECT_FALSE(UncompressData(message));
+}
+
+TEST(UtilsTest, BEH_ParseMessageHeader) {
+  protobuf::Message message;
+  message.set_source_id(NodeId(NodeId::kRandomId).string());
+  message.set_destination_id(NodeId(NodeId::kRandomId).string());
+  message.set_routing_message(false);
+  message.set_direct(true);
+  message.set_client_node(false);
+  message.set_id(7);
+  message.add_route_history(1);
+  message.add_data("DATA");
+  message.set_signature("SIGNATURE");
+  // Concatenated, the header and payload fields alternate over several runs.
+  protobuf::Message more;
+  more.add_route_history(2);
+  more.add_data("MORE");
+  const std::string kSerialised(message.SerializeAsString() + more.SerializeAsString());
+
+  protobuf::Message header;
+  std::string encoded_body;
+  ASSERT_TRUE(ParseMessageHeader(kSerialised, header, encoded_body));
+  EXPECT_EQ(0, header.data_size());
+  EXPECT_FALSE(header.has_signature());
+  EXPECT_EQ(message.source_id(), header.source_id());
+  EXPECT_EQ(7, header.id());
+  ASSERT_EQ(2, header.route_history_size());
+  EXPECT_EQ(2U, header.route_history(1));
+
+  protobuf::Message parsed, expected;
+  ASSERT_TRUE(parsed.ParseFromString(header.SerializeAsString() + encoded_body));
+  ASSERT_TRUE(expected.ParseFromString(kSerialised));
+  EXPECT_EQ(expected.SerializeAsString(), parsed.SerializeAsString());
+
+  // A header missing a required field, or a truncated message, is refused.
+  message.clear_direct();
+  EXPECT_FALSE(ParseMessageHeader(message.SerializePartialAsString(), header, encoded_body));
+  EXPECT_FALSE(ParseMessageHeader(kSerialised.substr(0, kSerialised.size() - 1), header,
+                                  encoded_body));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
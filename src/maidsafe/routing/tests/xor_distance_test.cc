@@ -0,0 +1,125 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/node_info.h"
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/xor_distance.h"
+#include "maidsafe/routing/tests/test_utils.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+crypto::BigInt ToBigInt(const NodeId& node_id) {
+  return crypto::BigInt((node_id.ToStringEncoded(NodeId::EncodingType::kHex) + 'h').c_str());
+}
+
+NodeId FromBigInt(const crypto::BigInt& value) {
+  std::string bytes(NodeId::kSize, '\0');
+  for (auto index(NodeId::kSize - 1); index >= 0; --index)
+    bytes[NodeId::kSize - 1 - index] = value.GetByte(index);
+  return NodeId(bytes);
+}
+
+}  // unnamed namespace
+
+TEST(XorDistanceTest, BEH_MatchesCloserToTarget) {
+  for (int i(0); i < 1000; ++i) {
+    NodeId target(NodeId::kRandomId), lhs(NodeId::kRandomId), rhs(NodeId::kRandomId);
+    if (i % 3 == 0)  // Share a long prefix to exercise the later words.
+      rhs = GenerateUniqueRandomId(lhs, 20);
+    EXPECT_EQ(NodeId::CloserToTarget(lhs, rhs, target),
+              XorDistance(lhs, target) < XorDistance(rhs, target));
+    EXPECT_EQ(NodeId::CloserToTarget(rhs, lhs, target),
+              XorDistance(rhs, target) < XorDistance(lhs, target));
+    EXPECT_FALSE(XorDistance(lhs, target) < XorDistance(lhs, target));
+    EXPECT_TRUE(XorDistance(lhs, target) == XorDistance(lhs, target));
+    EXPECT_FALSE(XorDistance(lhs, target) == XorDistance(rhs, target));
+  }
+}
+
+TEST(XorDistanceTest, BEH_RankFromTarget) {
+  std::vector<NodeInfo> nodes;
+  std::vector<NodeId> node_ids;
+  NodeInfo node_info;
+  for (int i(0); i < 100; ++i) {
+    node_info.node_id = NodeId(NodeId::kRandomId);
+    nodes.push_back(node_info);
+    node_ids.push_back(node_info.node_id);
+  }
+  EXPECT_TRUE(RankFromTarget(nodes.begin(), nodes.begin(), NodeId(NodeId::kRandomId), 4).empty());
+  EXPECT_TRUE(RankIdsFromTarget(std::vector<NodeId>(), NodeId(NodeId::kRandomId), 4).empty());
+
+  for (size_t count : {size_t(1), size_t(4), size_t(50), nodes.size(), nodes.size() + 1}) {
+    NodeId target(NodeId::kRandomId);
+    auto ranked(RankFromTarget(nodes.begin(), nodes.end(), target, count));
+    auto ranked_ids(RankIdsFromTarget(node_ids, target, count));
+    std::vector<NodeInfo> expected(nodes);
+    SortFromTarget(target, expected);
+    ASSERT_EQ(std::min(count, nodes.size()), ranked.size());
+    ASSERT_EQ(ranked.size(), ranked_ids.size());
+    for (size_t index(0); index < ranked.size(); ++index) {
+      EXPECT_EQ(expected.at(index).node_id, ranked.at(index)->node_id);
+      EXPECT_EQ(expected.at(index).node_id, ranked_ids.at(index));
+    }
+  }
+}
+
+TEST(XorDistanceTest, BEH_Arithmetic) {
+  EXPECT_EQ(NodeId(), XorDistance().ToNodeId());
+  EXPECT_TRUE(XorDistance() == XorDistance(NodeId()));
+  for (int i(0); i < 1000; ++i) {
+    NodeId lhs(NodeId::kRandomId), rhs(NodeId::kRandomId);
+    if (i % 3 == 0)
+      lhs = NodeId(NodeId::kMaxId);
+    EXPECT_EQ(lhs, XorDistance(lhs).ToNodeId());
+    EXPECT_EQ(lhs ^ rhs, XorDistance(lhs, rhs).ToNodeId());
+
+    XorDistance sum(lhs);
+    sum += XorDistance(rhs);
+    uint32_t divisor(RandomUint32() % 1000 + 2);
+    EXPECT_EQ(FromBigInt((ToBigInt(lhs) + ToBigInt(rhs)) / divisor),
+              (sum / divisor).ToNodeId());
+
+    uint32_t factor(RandomUint32() % 1000 + 1);
+    EXPECT_EQ(FromBigInt(ToBigInt(lhs) * factor / (factor + 1)),
+              (XorDistance(lhs) * factor / (factor + 1)).ToNodeId());
+    EXPECT_EQ(ToBigInt(lhs) * 2 < ToBigInt(rhs), XorDistance(lhs) * 2 < XorDistance(rhs));
+    EXPECT_EQ(ToBigInt(rhs) <= ToBigInt(lhs) * factor,
+              XorDistance(rhs) <= XorDistance(lhs) * factor);
+  }
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,110 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/thread_placement.h"
+
+#if defined MAIDSAFE_LINUX
+#include <pthread.h>
+#include <sched.h>
+#elif defined MAIDSAFE_WIN32
+#include <windows.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+#include "maidsafe/common/log.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+struct PinningState {
+  explicit PinningState(uint16_t thread_count_in)
+      : mutex(), cond_var(), thread_count(thread_count_in), started(0), pinned(0) {}
+  std::mutex mutex;
+  std::condition_variable cond_var;
+  const uint16_t thread_count;
+  uint16_t started, pinned;
+};
+
+}  // unnamed namespace
+
+bool PinThisThread(uint32_t cpu) {
+#if defined MAIDSAFE_LINUX
+  if (cpu >= CPU_SETSIZE)
+    return false;
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(cpu, &cpu_set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+#elif defined MAIDSAFE_WIN32
+  if (cpu >= sizeof(DWORD_PTR) * 8)
+    return false;
+  return SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << cpu) != 0;
+#else
+  static_cast<void>(cpu);
+  return false;
+#endif
+}
+
+uint16_t PinAsioThreads(AsioService& asio_service, uint16_t thread_count,
+                        const std::vector<uint32_t>& cpus) {
+  if (cpus.empty() || thread_count == 0)
+    return 0;
+  const std::chrono::seconds kTimeout(1);
+  auto state(std::make_shared<PinningState>(thread_count));
+  for (uint16_t index(0); index != thread_count; ++index) {
+    const uint32_t kCpu(cpus[index % cpus.size()]);
+    asio_service.service().post([state, kCpu, kTimeout]() {
+      const bool kPinned(PinThisThread(kCpu));
+      std::unique_lock<std::mutex> lock(state->mutex);
+      ++state->started;
+      if (kPinned)
+        ++state->pinned;
+      state->cond_var.notify_all();
+      state->cond_var.wait_for(lock, kTimeout,
+                               [state] { return state->started == state->thread_count; });
+    });
+  }
+  std::unique_lock<std::mutex> lock(state->mutex);
+  if (!state->cond_var.wait_for(lock, kTimeout,
+                                [state] { return state->started == state->thread_count; })) {
+    LOG(kWarning) << "Only " << state->started << " of " << thread_count
+                  << " threads started to be pinned.";
+  }
+  if (state->pinned != state->started)
+    LOG(kWarning) << "Failed to pin " << state->started - state->pinned << " threads.";
+  return state->pinned;
+}
+
+std::vector<uint32_t> CpusAfter(const std::vector<uint32_t>& cpus, size_t thread_count) {
+  std::vector<uint32_t> rest(cpus);
+  if (!rest.empty())
+    std::rotate(rest.begin(), rest.begin() + thread_count % rest.size(), rest.end());
+  return rest;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,55 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_THREAD_PLACEMENT_H_
+#define MAIDSAFE_ROUTING_THREAD_PLACEMENT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "maidsafe/common/asio_service.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// Pins the calling thread to the given CPU.  Returns false if the CPU doesn't exist or isn't
+// available to the process, or where threads can't be pinned (only Linux and Windows are
+// supported).
+bool PinThisThread(uint32_t cpu);
+
+// Pins each of the thread_count threads running asio_service to the next of cpus in turn.  Each
+// thread is given a task which pins it and then waits for the others' tasks to start, so that no
+// thread takes two; it is meant for a service whose threads are otherwise idle, i.e. one just
+// constructed.  Blocks until all have been pinned, or for at most a second.  Threads allocate
+// from their own NUMA node's memory once pinned, as the kernel places pages where first touched.
+// Returns the number of threads pinned, which is zero if cpus is empty.
+uint16_t PinAsioThreads(AsioService& asio_service, uint16_t thread_count,
+                        const std::vector<uint32_t>& cpus);
+
+// Returns cpus reordered to start from the one after those PinAsioThreads gives thread_count
+// threads, so that several pools pinned from the same list in turn carry on round it rather than
+// each starting again from its front.
+std::vector<uint32_t> CpusAfter(const std::vector<uint32_t>& cpus, size_t thread_count);
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_THREAD_PLACEMENT_H_
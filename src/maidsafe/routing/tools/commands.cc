@@ -19,14 +19,21 @@
 #include "maidsafe/routing/tools/commands.h"
 
 #include <algorithm>
+#include <fstream>
 #include <iostream>  // NOLINT
+#include <iterator>
+#include <utility>
 
+#include "boost/algorithm/string.hpp"
 #include "boost/format.hpp"
 #include "boost/filesystem.hpp"
 #include "boost/tokenizer.hpp"
 #include "boost/lexical_cast.hpp"
 #include "maidsafe/common/crypto.h"
 #include "maidsafe/common/utils.h"
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/trace_event.h"
+#include "maidsafe/routing/tools/load_generator.h"
 #include "maidsafe/routing/tools/shared_response.h"
 
 namespace fs = boost::filesystem;
@@ -37,10 +44,10 @@ namespace routing {
 
 namespace test {
 
-Commands::Commands(DemoNodePtr demo_node, std::vector<maidsafe::passport::Pmid> all_pmids,
+Commands::Commands(DemoNodePtr demo_node, std::shared_ptr<const PmidStore> pmid_store,
                    int identity_index)
     : demo_node_(demo_node),
-      all_pmids_(std::move(all_pmids)),
+      pmid_store_(std::move(pmid_store)),
       all_ids_(),
       identity_index_(identity_index),
       bootstrap_peer_ep_(),
@@ -55,8 +62,8 @@ Commands::Commands(DemoNodePtr demo_node, std::vector<maidsafe::passport::Pmid>
   // here it is assumed that the first half of fobs will be used as vault
   // and the latter half part will be used as client, which shall not respond msg
   // i.e. shall not be put into all_ids_
-  for (size_t i(0); i < (all_pmids_.size() / 2); ++i)
-    all_ids_.push_back(NodeId(all_pmids_[i].name().value));
+  for (size_t i(0); i < (PmidCount() / 2); ++i)
+    all_ids_.push_back(pmid_store_->node_id(i));
 
   demo_node->functors_.request_public_key = [this](
       const NodeId & node_id,
@@ -66,7 +73,7 @@ Commands::Commands(DemoNodePtr demo_node, std::vector<maidsafe::passport::Pmid>
     std::string reply_msg(wrapped_message + "+++" + demo_node_->node_id().string());
     if (std::string::npos != wrapped_message.find("request_routing_table"))
       reply_msg = reply_msg + "---" + demo_node_->SerializeRoutingTable();
-    reply_functor(reply_msg);
+    reply_functor(std::move(reply_msg));
   };
   mark_results_arrived_ = std::bind(&Commands::MarkResultArrived, this);
 }
@@ -75,16 +82,10 @@ void Commands::Validate(const NodeId& node_id, GivePublicKeyFunctor give_public_
   if (node_id == NodeId())
     return;
 
-  auto iter(all_pmids_.begin());
-  bool find(false);
-  while ((iter != all_pmids_.end()) && !find) {
-    if (iter->name()->string() == node_id.string())
-      find = true;
-    else
-      ++iter;
-  }
-  if (iter != all_pmids_.end())
-    give_public_key((*iter).public_key());
+  // Only the peer's own entry is parsed.
+  size_t index(pmid_store_ ? pmid_store_->Find(node_id) : 0);
+  if (index < PmidCount())
+    give_public_key(pmid_store_->pmid(index).public_key());
 }
 
 void Commands::Run() {
@@ -139,13 +140,9 @@ void Commands::ZeroStateJoin() {
     return;
   }
   NodeInfo peer_node_info;
-  if (identity_index_ == 0) {
-    peer_node_info.node_id = NodeId(all_pmids_[1].name().value);
-    peer_node_info.public_key = all_pmids_[1].public_key();
-  } else {
-    peer_node_info.node_id = NodeId(all_pmids_[0].name().value);
-    peer_node_info.public_key = all_pmids_[0].public_key();
-  }
+  const passport::Pmid kPeerPmid(pmid_store_->pmid(identity_index_ == 0 ? 1 : 0));
+  peer_node_info.node_id = NodeId(kPeerPmid.name().value);
+  peer_node_info.public_key = kPeerPmid.public_key();
   peer_node_info.connection_id = peer_node_info.node_id;
 
   ReturnCode ret_code(
@@ -202,20 +199,112 @@ void Commands::SendMessages(int id_index, const DestinationType& destination_typ
             << std::endl;
 }
 
+void Commands::GenerateLoad(const Arguments& args) {
+  LoadProfile profile;
+  for (const auto& arg : args) {
+    const size_t kEquals(arg.find('='));
+    const std::string kKey(arg.substr(0, kEquals));
+    const std::string kValue(kEquals == std::string::npos ? "" : arg.substr(kEquals + 1));
+    try {
+      if (kKey == "count") {
+        profile.message_count = boost::lexical_cast<size_t>(kValue);
+      } else if (kKey == "duration") {
+        profile.duration = std::chrono::seconds(boost::lexical_cast<int>(kValue));
+      } else if (kKey == "rate") {
+        profile.rate = boost::lexical_cast<double>(kValue);
+      } else if (kKey == "arrival" && (kValue == "poisson" || kValue == "constant")) {
+        profile.arrival = kValue == "poisson" ? LoadProfile::Arrival::kPoisson
+                                              : LoadProfile::Arrival::kConstant;
+      } else if (kKey == "threads") {
+        profile.threads = boost::lexical_cast<size_t>(kValue);
+      } else if (kKey == "outstanding") {
+        profile.max_outstanding = boost::lexical_cast<size_t>(kValue);
+      } else if (kKey == "sizes" && kValue == "fixed") {
+        profile.payload_sizes = LoadProfile::PayloadSizes::kFixed;
+      } else if (kKey == "sizes" && kValue == "uniform") {
+        profile.payload_sizes = LoadProfile::PayloadSizes::kUniform;
+      } else if (kKey == "sizes" && kValue == "exponential") {
+        profile.payload_sizes = LoadProfile::PayloadSizes::kExponential;
+      } else if (kKey == "size") {
+        profile.payload_size = boost::lexical_cast<size_t>(kValue);
+      } else if (kKey == "max_size") {
+        profile.max_payload_size = boost::lexical_cast<size_t>(kValue);
+      } else if (kKey == "mix") {
+        std::vector<std::string> weights;
+        boost::split(weights, kValue, boost::is_any_of(":"));
+        if (weights.size() != 3)
+          throw boost::bad_lexical_cast();
+        profile.direct_weight = boost::lexical_cast<uint32_t>(weights[0]);
+        profile.group_weight = boost::lexical_cast<uint32_t>(weights[1]);
+        profile.typed_weight = boost::lexical_cast<uint32_t>(weights[2]);
+      } else {
+        throw boost::bad_lexical_cast();
+      }
+    }
+    catch (const boost::bad_lexical_cast&) {
+      std::cout << "Error : Invalid load option " << arg << std::endl;
+      return;
+    }
+  }
+  if (profile.direct_weight + profile.group_weight + profile.typed_weight == 0) {
+    std::cout << "Error : mix must include at least one kind of message" << std::endl;
+    return;
+  }
+  std::vector<NodeId> destinations;
+  std::copy_if(all_ids_.begin(), all_ids_.end(), std::back_inserter(destinations),
+               [this](const NodeId& node_id) { return node_id != demo_node_->node_id(); });
+  if (destinations.empty() && profile.direct_weight + profile.typed_weight != 0) {
+    std::cout << "Error : No destination vaults are known" << std::endl;
+    return;
+  }
+  std::cout << "Generating load, " << (profile.message_count != 0
+                                           ? std::to_string(profile.message_count) + " messages"
+                                           : std::to_string(profile.duration.count()) + " s")
+            << " ..." << std::endl;
+  LoadGenerator load_generator(demo_node_, destinations);
+  load_generator.Run(profile).Print(std::cout);
+}
+
+void Commands::Trace(const Arguments& args) {
+  if (args.size() == 1) {
+    try {
+      Parameters::trace_sample_interval = boost::lexical_cast<uint32_t>(args[0]);
+    }
+    catch (const boost::bad_lexical_cast&) {
+      std::cout << "Error : Invalid sample interval " << args[0] << std::endl;
+      return;
+    }
+    std::cout << (Parameters::trace_sample_interval == 0
+                      ? std::string("Tracing disabled")
+                      : "Tracing one in " + args[0] + " messages sent") << std::endl;
+  } else if (args.size() == 2 && args[0] == "dump") {
+    std::ofstream trace_file(args[1], std::ios::trunc);
+    auto events(DumpTraceEvents());
+    WriteTraceEvents(events, trace_file);
+    if (!trace_file) {
+      std::cout << "Error : Failed to write " << args[1] << std::endl;
+      return;
+    }
+    std::cout << "Wrote " << events.size() << " trace events to " << args[1] << std::endl;
+  } else {
+    std::cout << "Error : Try correct option" << std::endl;
+  }
+}
+
 uint16_t Commands::MakeMessage(int id_index, const DestinationType& destination_type,
                                std::vector<NodeId>& closest_nodes, NodeId& dest_id) {
   int identity_index;
   if (id_index >= 0)
     identity_index = id_index;
   else
-    identity_index = RandomUint32() % (all_pmids_.size() / 2);
+    identity_index = RandomUint32() % (PmidCount() / 2);
 
-  if ((identity_index >= 0) && (static_cast<uint32_t>(identity_index) >= all_pmids_.size())) {
+  if ((identity_index >= 0) && (static_cast<uint32_t>(identity_index) >= PmidCount())) {
     std::cout << "ERROR : destination index out of range" << std::endl;
     return 0;
   }
   if (identity_index >= 0)
-    dest_id = NodeId(all_pmids_[identity_index].name().value);
+    dest_id = pmid_store_->node_id(identity_index);
   std::cout << "Sending a msg from : " << maidsafe::HexSubstr(demo_node_->node_id().string())
             << " to " << (destination_type != DestinationType::kGroup ? ": " : "group : ")
             << maidsafe::HexSubstr(dest_id.string())
@@ -296,6 +385,8 @@ void Commands::Join() {
   std::vector<boost::asio::ip::udp::endpoint> bootstrap_endpoints;
   if (bootstrap_peer_ep_ != boost::asio::ip::udp::endpoint())
     bootstrap_endpoints.push_back(bootstrap_peer_ep_);
+  // The vaults' IDs are all known from the keys file, so connect to the closest at once.
+  demo_node_->UseNetworkManifest(all_ids_);
   demo_node_->Join(bootstrap_endpoints);
 
   if (!demo_node_->joined()) {
@@ -326,6 +417,13 @@ void Commands::PrintUsage() {
             << " picked-up destination. -1 for infinite\n";
   std::cout << "\tdatasize <data_size> Set the data_size for the message.\n";
   std::cout << "\tdatarate <data_rate> Set the data_rate for the message.\n";
+  std::cout << "\tload [key=value ...] Generate message load and report throughput and latency."
+            << " Keys: count (0 to run for duration), duration <s>, rate <msg/s, 0 for closed"
+            << " loop>, arrival poisson|constant, threads, outstanding, sizes"
+            << " fixed|uniform|exponential, size, max_size, mix <direct:group:typed>.\n";
+  std::cout << "\ttrace <interval> Trace one in interval messages sent, 0 to stop (Default 0).\n";
+  std::cout << "\ttrace dump <file> Write the trace events recorded so far to file, for"
+            << " network_viewer.\n";
   std::cout << "\nattype Print the NatType of this node.\n";
   std::cout << "\texit Exit application.\n";
 }
@@ -418,6 +516,10 @@ void Commands::ProcessCommand(const std::string& cmdline) {
       data_rate_ = atoi(args[0].c_str());
     else
       std::cout << "Error : Try correct option" << std::endl;
+  } else if (cmd == "load") {
+    GenerateLoad(args);
+  } else if (cmd == "trace") {
+    Trace(args);
   } else if (cmd == "nattype") {
     std::cout << "NatType for this node is : " << demo_node_->nat_type() << std::endl;
   } else if (cmd == "exit") {
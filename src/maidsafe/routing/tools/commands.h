@@ -29,6 +29,7 @@
 #include "boost/date_time/posix_time/posix_time_types.hpp"
 
 #include "maidsafe/passport/types.h"
+#include "maidsafe/routing/pmid_store.h"
 #include "maidsafe/routing/tests/routing_network.h"
 #include "maidsafe/routing/tests/test_utils.h"
 #include "maidsafe/routing/utils.h"
@@ -45,7 +46,8 @@ typedef std::shared_ptr<GenericNode> DemoNodePtr;
 
 class Commands {
  public:
-  explicit Commands(DemoNodePtr demo_node, std::vector<maidsafe::passport::Pmid> all_pmids,
+  // pmid_store may be null if there's no keys file.
+  explicit Commands(DemoNodePtr demo_node, std::shared_ptr<const PmidStore> pmid_store,
                     int identity_index);
   void Run();
   void GetPeer(const std::string& peer);
@@ -53,6 +55,7 @@ class Commands {
  private:
   typedef std::vector<std::string> Arguments;
 
+  size_t PmidCount() const { return pmid_store_ ? pmid_store_->size() : 0; }
   void PrintUsage();
   void ProcessCommand(const std::string& cmdline);
   void MarkResultArrived();
@@ -64,6 +67,11 @@ class Commands {
   void Validate(const NodeId& node_id, GivePublicKeyFunctor give_public_key);
   void SendMessages(int identity_index, const DestinationType& destination_type,
                     bool is_routing_req, int messages_count);
+  // Runs a LoadGenerator with the profile given as "key=value" arguments, see PrintUsage.
+  void GenerateLoad(const Arguments& args);
+  // "trace <interval>" sets Parameters::trace_sample_interval; "trace dump <file>" writes the
+  // recorded trace events to file for network_viewer.
+  void Trace(const Arguments& args);
 
   NodeId CalculateClosests(const NodeId& target_id, std::vector<NodeId>& closests,
                            uint16_t num_of_closests);
@@ -78,7 +86,7 @@ class Commands {
                     std::string data);
 
   std::shared_ptr<GenericNode> demo_node_;
-  std::vector<maidsafe::passport::Pmid> all_pmids_;
+  std::shared_ptr<const PmidStore> pmid_store_;
   std::vector<NodeId> all_ids_;
   int identity_index_;
   boost::asio::ip::udp::endpoint bootstrap_peer_ep_;
@@ -18,12 +18,15 @@
 
 #include <signal.h>
 
+#include <algorithm>
 #include <atomic>
 #include <iostream>  // NOLINT
 #include <fstream>   // NOLINT
 #include <future>    // NOLINT
 #include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "boost/filesystem.hpp"
 #include "boost/asio.hpp"
@@ -45,6 +48,7 @@
 #include "maidsafe/passport/types.h"
 
 #include "maidsafe/routing/node_info.h"
+#include "maidsafe/routing/pmid_store.h"
 #include "maidsafe/routing/routing_api.h"
 #include "maidsafe/routing/utils.h"
 
@@ -57,27 +61,43 @@ typedef std::vector<maidsafe::passport::Pmid> PmidVector;
 
 const std::string kHelperVersion = "MaidSafe Routing KeysHelper " + maidsafe::kApplicationVersion();
 
-void PrintKeys(const PmidVector& all_pmids) {
-  for (size_t i = 0; i < all_pmids.size(); ++i)
-    std::cout << '\t' << i << "\t PMID " << maidsafe::HexSubstr(all_pmids[i].name()->string())
+void PrintKeys(const maidsafe::routing::PmidStore& pmid_store) {
+  for (size_t i = 0; i < pmid_store.size(); ++i)
+    std::cout << '\t' << i << "\t PMID " << maidsafe::HexSubstr(pmid_store.node_id(i).string())
               << (i < 2 ? " (bootstrap)" : "") << std::endl;
 }
 
-bool CreateKeys(size_t pmids_count, PmidVector& all_pmids) {
+// Key generation dominates, so pmids are created on thread_count threads at once, each taking the
+// next to be created until there are pmids_count.
+bool CreateKeys(size_t pmids_count, size_t thread_count, PmidVector& all_pmids) {
   all_pmids.clear();
-  for (size_t i = 0; i < pmids_count; ++i) {
-    try {
+  std::atomic<size_t> claimed(0);
+  auto create_pmids([&claimed, pmids_count]()->PmidVector {
+    PmidVector pmids;
+    while (claimed++ < pmids_count) {
       maidsafe::passport::Anmaid anmaid;
       maidsafe::passport::Maid maid(anmaid);
       maidsafe::passport::Pmid pmid(maid);
-      all_pmids.push_back(pmid);
+      pmids.push_back(pmid);
+    }
+    return pmids;
+  });
+  const size_t kThreadCount(std::max(std::min(thread_count, pmids_count), static_cast<size_t>(1)));
+  std::vector<std::future<PmidVector>> creators;
+  for (size_t i(0); i != kThreadCount; ++i)
+    creators.push_back(std::async(std::launch::async, create_pmids));
+  bool created(true);
+  for (auto& creator : creators) {
+    try {
+      PmidVector pmids(creator.get());
+      all_pmids.insert(all_pmids.end(), pmids.begin(), pmids.end());
     }
-    catch (const std::exception& /*ex*/) {
-      LOG(kError) << "CreatePmids - Could not create ID #" << i;
-      return false;
+    catch (const std::exception& e) {
+      LOG(kError) << "CreatePmids - Could not create IDs: " << e.what();
+      created = false;
     }
   }
-  return true;
+  return created;
 }
 
 }  // unnamed namespace
@@ -91,6 +111,7 @@ int main(int argc, char* argv[]) {
   boost::system::error_code error_code;
 
   size_t pmids_count(12);
+  size_t thread_count(std::max(std::thread::hardware_concurrency(), 1U));
 
   try {
     // Options allowed only on command line
@@ -104,6 +125,8 @@ int main(int argc, char* argv[]) {
     config_file_options.add_options()("pmids_count,n",
                                       po::value<size_t>(&pmids_count)->default_value(pmids_count),
                                       "Number of pmids to create")(
+        "threads,t", po::value<size_t>(&thread_count)->default_value(thread_count),
+        "Number of threads creating pmids")(
         "pmids_path", po::value<std::string>()->default_value(fs::path(
                           fs::temp_directory_path(error_code) / "pmids_list.dat").string()),
         "Path to pmids file");
@@ -128,32 +151,34 @@ int main(int argc, char* argv[]) {
       return 0;
     }
 
-    PmidVector all_pmids;
+    std::unique_ptr<maidsafe::routing::PmidStore> pmid_store;
     auto pmids_path(maidsafe::GetPathFromProgramOptions("pmids_path", variables_map, false, true));
 
     if (do_create) {
-      if (CreateKeys(pmids_count, all_pmids)) {
+      PmidVector all_pmids;
+      if (CreateKeys(pmids_count, thread_count, all_pmids)) {
         std::cout << "Created " << all_pmids.size() << " fobs." << std::endl;
-        if (maidsafe::passport::detail::WritePmidList(pmids_path, all_pmids))
+        if (maidsafe::routing::WritePmidStore(pmids_path, all_pmids))
           std::cout << "Wrote pmids to " << pmids_path << std::endl;
         else
           std::cout << "Could not write pmids to " << pmids_path << std::endl;
       } else {
         std::cout << "Could not create pmids." << std::endl;
       }
-    } else if (do_load) {
+    }
+    if (do_load || (do_create && do_print)) {
       try {
-        all_pmids = maidsafe::passport::detail::ReadPmidList(pmids_path);
-        std::cout << "Loaded " << all_pmids.size() << " pmids from " << pmids_path << std::endl;
+        pmid_store.reset(new maidsafe::routing::PmidStore(pmids_path));
+        std::cout << "Loaded " << pmid_store->size() << " pmids from " << pmids_path << std::endl;
       }
       catch (const std::exception& /*ex*/) {
-        all_pmids.clear();
+        pmid_store.reset();
         std::cout << "Could not load fobs from " << pmids_path << std::endl;
       }
     }
 
-    if (do_print)
-      PrintKeys(all_pmids);
+    if (do_print && pmid_store)
+      PrintKeys(*pmid_store);
 
     if (do_delete) {
       if (fs::remove(pmids_path, error_code))
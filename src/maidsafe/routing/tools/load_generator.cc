@@ -0,0 +1,305 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/tools/load_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <iomanip>
+#include <limits>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/message.h"
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/routing_api.h"
+#include "maidsafe/routing/tests/routing_network.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+LoadProfile::LoadProfile()
+    : message_count(0),
+      duration(10),
+      rate(1000.0),
+      arrival(Arrival::kPoisson),
+      threads(2),
+      max_outstanding(256),
+      payload_sizes(PayloadSizes::kFixed),
+      payload_size(1024),
+      max_payload_size(64 * 1024),
+      direct_weight(8),
+      group_weight(1),
+      typed_weight(1) {}
+
+LatencyHistogram::LatencyHistogram() : buckets_(), count_(0), max_(0) {}
+
+void LatencyHistogram::Add(std::chrono::microseconds latency) {
+  ++buckets_[Bucket(static_cast<uint64_t>(std::max<int64_t>(latency.count(), 0)))];
+  ++count_;
+  max_ = std::max(max_, latency);
+}
+
+std::chrono::microseconds LatencyHistogram::Percentile(double fraction) const {
+  if (count_ == 0)
+    return std::chrono::microseconds(0);
+  const uint64_t kRank(std::max<uint64_t>(
+      static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(count_))), 1));
+  uint64_t seen(0);
+  for (size_t bucket(0); bucket != kBucketCount_; ++bucket) {
+    seen += buckets_[bucket];
+    if (seen >= kRank) {
+      return std::min(std::chrono::microseconds(static_cast<int64_t>(BucketLimit(bucket))),
+                      max_);
+    }
+  }
+  return max_;
+}
+
+// Values below kSubBuckets_ have a bucket each; above that each power of two is split into
+// kSubBuckets_ equal buckets.
+size_t LatencyHistogram::Bucket(uint64_t microseconds) {
+  if (microseconds < kSubBuckets_)
+    return static_cast<size_t>(microseconds);
+  int exponent(4);
+  while (exponent < 43 && (microseconds >> (exponent + 1)) != 0)
+    ++exponent;
+  const uint64_t kSubBucket(std::min<uint64_t>((microseconds >> (exponent - 4)) - kSubBuckets_,
+                                               kSubBuckets_ - 1));
+  return kSubBuckets_ * static_cast<size_t>(exponent - 3) + static_cast<size_t>(kSubBucket);
+}
+
+uint64_t LatencyHistogram::BucketLimit(size_t bucket) {
+  if (bucket < kSubBuckets_)
+    return bucket;
+  const int kExponent(static_cast<int>(bucket / kSubBuckets_) + 3);
+  const uint64_t kSubBucket(bucket % kSubBuckets_);
+  return ((kSubBuckets_ + kSubBucket + 1) << (kExponent - 4)) - 1;
+}
+
+LoadReport::LoadReport()
+    : direct_sent(0),
+      group_sent(0),
+      typed_sent(0),
+      succeeded(0),
+      failed(0),
+      shed(0),
+      payload_bytes(0),
+      elapsed(0),
+      direct_latency(),
+      group_latency() {}
+
+void LoadReport::Print(std::ostream& stream) const {
+  const double kSeconds(std::chrono::duration<double>(elapsed).count());
+  const uint64_t kSent(direct_sent + group_sent + typed_sent);
+  stream << std::fixed << std::setprecision(1) << "Sent " << kSent << " messages (" << direct_sent
+         << " direct, " << group_sent << " group, " << typed_sent << " typed) in " << kSeconds
+         << " s, " << shed << " arrivals shed\n"
+         << "Responses: " << succeeded << " succeeded, " << failed << " failed\n";
+  if (kSeconds > 0.0) {
+    stream << "Throughput: " << kSent / kSeconds << " msg/s, "
+           << payload_bytes / kSeconds / 1024.0 << " KiB/s of payload\n";
+  }
+  auto print_histogram([&stream](const char* name, const LatencyHistogram& histogram) {
+    if (histogram.count() == 0)
+      return;
+    auto milliseconds([](std::chrono::microseconds value) { return value.count() / 1000.0; });
+    stream << name << " latency (ms): p50 " << milliseconds(histogram.Percentile(0.5)) << ", p99 "
+           << milliseconds(histogram.Percentile(0.99)) << ", p999 "
+           << milliseconds(histogram.Percentile(0.999)) << ", max "
+           << milliseconds(histogram.max()) << '\n';
+  });
+  print_histogram("Direct", direct_latency);
+  print_histogram("Group", group_latency);
+}
+
+struct LoadGenerator::State {
+  State() : mutex(), cond_var(), arrivals_left(0), outstanding_count(0), report() {}
+  std::mutex mutex;
+  std::condition_variable cond_var;
+  size_t arrivals_left, outstanding_count;
+  LoadReport report;
+};
+
+struct LoadGenerator::Outstanding {
+  Outstanding(Kind kind_in, size_t responses_in)
+      : kind(kind_in), sent_at(std::chrono::steady_clock::now()), responses_left(responses_in),
+        done(false) {}
+  Kind kind;
+  std::chrono::steady_clock::time_point sent_at;
+  size_t responses_left;
+  bool done;
+};
+
+LoadGenerator::LoadGenerator(std::shared_ptr<GenericNode> node, std::vector<NodeId> destinations)
+    : node_(std::move(node)),
+      kDestinations_(std::move(destinations)),
+      payload_(),
+      state_(std::make_shared<State>()) {}
+
+LoadReport LoadGenerator::Run(const LoadProfile& profile) {
+  payload_ = RandomAlphaNumericString(std::max(profile.payload_size, profile.max_payload_size));
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->report = LoadReport();
+    state_->arrivals_left = profile.message_count != 0 ? profile.message_count
+                                                       : std::numeric_limits<size_t>::max();
+  }
+  const auto kStart(std::chrono::steady_clock::now());
+  std::vector<std::thread> threads;
+  for (size_t i(0); i != std::max<size_t>(profile.threads, 1); ++i)
+    threads.emplace_back([this, &profile, i, kStart] { SendLoop(profile, i, kStart); });
+  for (auto& thread : threads)
+    thread.join();
+  std::unique_lock<std::mutex> lock(state_->mutex);
+  state_->cond_var.wait(lock, [this] { return state_->outstanding_count == 0; });
+  state_->report.elapsed = std::chrono::steady_clock::now() - kStart;
+  return state_->report;
+}
+
+void LoadGenerator::SendLoop(const LoadProfile& profile, size_t thread_index,
+                             std::chrono::steady_clock::time_point start) {
+  typedef std::chrono::duration<double> Seconds;
+  const size_t kThreads(std::max<size_t>(profile.threads, 1));
+  std::mt19937 engine(RandomUint32());
+  std::discrete_distribution<int> kinds(
+      {static_cast<double>(profile.direct_weight), static_cast<double>(profile.group_weight),
+       static_cast<double>(profile.typed_weight)});
+  std::uniform_int_distribution<size_t> destinations(0, kDestinations_.size() - 1);
+  std::uniform_int_distribution<size_t> uniform_sizes(
+      profile.payload_size, std::max(profile.payload_size, profile.max_payload_size));
+  std::exponential_distribution<double> exponential_sizes(
+      1.0 / static_cast<double>(std::max<size_t>(profile.payload_size, 1)));
+  // Each thread's arrivals are a rate / kThreads process, so together they make one at rate.
+  const double kMeanGap(profile.rate > 0.0 ? kThreads / profile.rate : 0.0);
+  std::exponential_distribution<double> gaps(kMeanGap > 0.0 ? 1.0 / kMeanGap : 1.0);
+  auto next_gap([&]() -> Seconds {
+    return Seconds(profile.arrival == LoadProfile::Arrival::kPoisson ? gaps(engine) : kMeanGap);
+  });
+  const auto kDeadline(profile.message_count != 0
+                           ? std::chrono::steady_clock::time_point::max()
+                           : start + profile.duration);
+  auto next_arrival(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                Seconds(kMeanGap * thread_index / kThreads)));
+  for (;;) {
+    if (kMeanGap > 0.0) {
+      if (next_arrival >= kDeadline)
+        return;
+      std::this_thread::sleep_until(next_arrival);
+      next_arrival += std::chrono::duration_cast<std::chrono::steady_clock::duration>(next_gap());
+    }
+    bool shed(false);
+    if (!Arrive(profile, kDeadline, shed))
+      return;
+    if (shed)
+      continue;
+    size_t size(profile.payload_size);
+    if (profile.payload_sizes == LoadProfile::PayloadSizes::kUniform) {
+      size = uniform_sizes(engine);
+    } else if (profile.payload_sizes == LoadProfile::PayloadSizes::kExponential) {
+      size = std::min(static_cast<size_t>(exponential_sizes(engine)), payload_.size());
+    }
+    const Kind kKind(static_cast<Kind>(kinds(engine)));
+    const NodeId kDestination(kKind == Kind::kGroup || kDestinations_.empty()
+                                  ? NodeId(NodeId::kRandomId)
+                                  : kDestinations_[destinations(engine)]);
+    Send(kKind, kDestination, payload_.substr(0, std::max<size_t>(size, 1)));
+  }
+}
+
+bool LoadGenerator::Arrive(const LoadProfile& profile,
+                           std::chrono::steady_clock::time_point deadline, bool& shed) {
+  std::unique_lock<std::mutex> lock(state_->mutex);
+  if (state_->arrivals_left == 0 || std::chrono::steady_clock::now() >= deadline)
+    return false;
+  if (profile.message_count != 0)
+    --state_->arrivals_left;
+  if (profile.rate > 0.0) {
+    if (state_->outstanding_count >= profile.max_outstanding) {
+      ++state_->report.shed;
+      shed = true;
+      return true;
+    }
+  } else {
+    state_->cond_var.wait(lock, [&] {
+      return state_->outstanding_count < std::max<size_t>(profile.max_outstanding, 1);
+    });
+  }
+  ++state_->outstanding_count;
+  return true;
+}
+
+void LoadGenerator::Send(Kind kind, const NodeId& destination, std::string data) {
+  const size_t kResponses(kind == Kind::kGroup ? Parameters::group_size : 1);
+  auto outstanding(std::make_shared<Outstanding>(kind, kResponses));
+  auto state(state_);
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    LoadReport& report(state->report);
+    ++(kind == Kind::kDirect ? report.direct_sent
+                             : kind == Kind::kGroup ? report.group_sent : report.typed_sent);
+    report.payload_bytes += data.size();
+  }
+  auto response_functor([state, outstanding](std::string response) {
+    Complete(state, outstanding, !response.empty());
+  });
+  if (kind == Kind::kDirect) {
+    node_->SendDirect(destination, data, false, response_functor);
+  } else if (kind == Kind::kGroup) {
+    node_->SendGroup(destination, data, false, response_functor);
+  } else {
+    node_->routing()->Send(SingleToSingleMessage(std::move(data), SingleSource(node_->node_id()),
+                                                 SingleId(destination)));
+    std::lock_guard<std::mutex> lock(state->mutex);
+    --state->outstanding_count;
+    state->cond_var.notify_all();
+  }
+}
+
+void LoadGenerator::Complete(const std::shared_ptr<State>& state,
+                             const std::shared_ptr<Outstanding>& outstanding, bool success) {
+  std::lock_guard<std::mutex> lock(state->mutex);
+  if (outstanding->done || (success && --outstanding->responses_left != 0))
+    return;
+  outstanding->done = true;
+  LoadReport& report(state->report);
+  if (success) {
+    ++report.succeeded;
+    const auto kLatency(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - outstanding->sent_at));
+    (outstanding->kind == Kind::kDirect ? report.direct_latency : report.group_latency)
+        .Add(kLatency);
+  } else {
+    ++report.failed;
+  }
+  --state->outstanding_count;
+  state->cond_var.notify_all();
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
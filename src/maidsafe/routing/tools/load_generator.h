@@ -0,0 +1,139 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_TOOLS_LOAD_GENERATOR_H_
+#define MAIDSAFE_ROUTING_TOOLS_LOAD_GENERATOR_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+class GenericNode;
+
+struct LoadProfile {
+  enum class Arrival { kConstant, kPoisson };
+  enum class PayloadSizes { kFixed, kUniform, kExponential };
+
+  LoadProfile();
+
+  // The run ends after message_count arrivals, or after duration if message_count is 0.
+  size_t message_count;
+  std::chrono::seconds duration;
+  // Total arrivals per second, spread over the sending threads.  With an arrival rate the load is
+  // open loop: an arrival finding max_outstanding messages awaiting responses is shed and counted,
+  // not delayed.  With a rate of 0 each thread sends as soon as a slot is free.
+  double rate;
+  Arrival arrival;
+  size_t threads;
+  size_t max_outstanding;
+  // Fixed sizes are payload_size, uniform ones lie in [payload_size, max_payload_size] and
+  // exponential ones have mean payload_size, capped at max_payload_size.
+  PayloadSizes payload_sizes;
+  size_t payload_size, max_payload_size;
+  // Relative weights of the kinds of message sent.  Direct and group messages are the string API's
+  // and are timed to their last response; typed messages are one way, so are only counted.
+  uint32_t direct_weight, group_weight, typed_weight;
+};
+
+// Latencies in microseconds, in buckets 1/16 of a power of two wide, so percentiles are within
+// about 6% of the true value.
+class LatencyHistogram {
+ public:
+  LatencyHistogram();
+  void Add(std::chrono::microseconds latency);
+  uint64_t count() const { return count_; }
+  std::chrono::microseconds max() const { return max_; }
+  // The upper bound of the bucket holding the given fraction of samples, e.g. 0.99 for p99.
+  std::chrono::microseconds Percentile(double fraction) const;
+
+ private:
+  static const size_t kSubBuckets_ = 16, kBucketCount_ = 16 * 41;
+  static size_t Bucket(uint64_t microseconds);
+  static uint64_t BucketLimit(size_t bucket);
+
+  std::array<uint64_t, kBucketCount_> buckets_;
+  uint64_t count_;
+  std::chrono::microseconds max_;
+};
+
+struct LoadReport {
+  LoadReport();
+  void Print(std::ostream& stream) const;
+
+  uint64_t direct_sent, group_sent, typed_sent;
+  uint64_t succeeded, failed;  // direct and group messages only
+  uint64_t shed;               // arrivals dropped with max_outstanding already in flight
+  uint64_t payload_bytes;
+  std::chrono::steady_clock::duration elapsed;
+  LatencyHistogram direct_latency, group_latency;
+};
+
+// Sends a mix of direct, group and typed messages from one node, at the rate and sizes set by a
+// LoadProfile, and reports their outcomes and latencies.  Both the routing tool's load command
+// and BENCHrouting_e2e run it.
+class LoadGenerator {
+ public:
+  // destinations are the vaults direct and typed messages may be sent to.
+  LoadGenerator(std::shared_ptr<GenericNode> node, std::vector<NodeId> destinations);
+  // Blocks until the run has ended and every message sent has been answered or has failed.
+  LoadReport Run(const LoadProfile& profile);
+
+ private:
+  enum class Kind { kDirect, kGroup, kTyped };
+  // Held too by the response functors, which may outlive the generator when a group message has
+  // failed before all its responses arrived.
+  struct State;
+  struct Outstanding;
+
+  LoadGenerator(const LoadGenerator&);
+  LoadGenerator& operator=(const LoadGenerator&);
+  void SendLoop(const LoadProfile& profile, size_t thread_index,
+                std::chrono::steady_clock::time_point start);
+  // Takes a slot for an arrival, or returns false if the run is over.  Sets shed if the arrival
+  // was shed instead.
+  bool Arrive(const LoadProfile& profile, std::chrono::steady_clock::time_point deadline,
+              bool& shed);
+  void Send(Kind kind, const NodeId& destination, std::string data);
+  static void Complete(const std::shared_ptr<State>& state,
+                       const std::shared_ptr<Outstanding>& outstanding, bool success);
+
+  std::shared_ptr<GenericNode> node_;
+  const std::vector<NodeId> kDestinations_;
+  std::string payload_;
+  std::shared_ptr<State> state_;
+};
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_TOOLS_LOAD_GENERATOR_H_
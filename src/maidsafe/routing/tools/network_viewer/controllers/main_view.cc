@@ -20,15 +20,18 @@
 
 #include <vector>
 
+#include "QFileDialog"
 #include "QMessageBox"
 
 #include "helpers/qt_push_headers.h"
 #include "helpers/qt_pop_headers.h"
 
 #include "controllers/graph_view.h"
+#include "controllers/trace_view.h"
 #include "helpers/application.h"
 #include "helpers/graph_page.h"
 #include "models/api_helper.h"
+#include "models/trace_file.h"
 
 namespace maidsafe {
 
@@ -93,6 +96,19 @@ void MainViewController::OpenDataViewer() {
   CreateGraphController(view_.data_id_->text(), true);
 }
 
+void MainViewController::OpenTraceViewer() {
+  QString path(QFileDialog::getOpenFileName(this, "Open Trace File"));
+  if (path.isEmpty())
+    return;
+  std::vector<TracedMessage> traced_messages;
+  if (!ReadTraceFile(path.toStdString(), traced_messages)) {
+    QMessageBox::critical(this, "Trace Viewer", "Failed to read trace file " + path);
+    return;
+  }
+  TraceViewController* trace_controller(new TraceViewController(traced_messages));
+  trace_controller->show();
+}
+
 void MainViewController::PopulateNodes() {
   std::vector<std::string> node_ids(api_helper_->GetNodesInNetwork(last_network_state_id_));
   //  view_.nodes_->clear();
@@ -133,6 +149,7 @@ void MainViewController::InitSignals() {
   connect(main_page_, SIGNAL(RequestNewGraphView(const QString&)),  // NOLINT - Viv
           this, SLOT(NewGraphViewRequested(const QString&)));       // NOLINT - Viv
   connect(view_.open_data_viewer_, SIGNAL(clicked()), this, SLOT(OpenDataViewer()));
+  connect(view_.open_trace_viewer_, SIGNAL(clicked()), this, SLOT(OpenTraceViewer()));
 }
 
 }  // namespace maidsafe
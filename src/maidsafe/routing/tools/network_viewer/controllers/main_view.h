@@ -51,6 +51,7 @@ slots:  // NOLINT - Viv
   void FilterChanged(const QString& new_filter);
   void NewGraphViewRequested(const QString& new_parent_id);
   void OpenDataViewer();
+  void OpenTraceViewer();
 
  private:
   MainViewController(const MainViewController&);
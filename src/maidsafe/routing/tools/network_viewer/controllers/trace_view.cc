@@ -0,0 +1,90 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "controllers/trace_view.h"
+
+#include "QHeaderView"
+#include "QTreeWidget"
+#include "QVBoxLayout"
+
+#include "helpers/qt_push_headers.h"
+#include "helpers/qt_pop_headers.h"
+
+namespace maidsafe {
+
+namespace {
+
+QString Microseconds(int64_t microseconds) {
+  if (microseconds < 0)
+    return QString();
+  if (microseconds < 10000)
+    return QString("%1 us").arg(microseconds);
+  return QString("%1 ms").arg(static_cast<double>(microseconds) / 1000.0, 0, 'f', 1);
+}
+
+QString ShortId(const std::string& id) { return QString::fromStdString(id.substr(0, 8)); }
+
+}  // unnamed namespace
+
+TraceViewController::TraceViewController(const std::vector<TracedMessage>& traced_messages,
+                                         QWidget* parent)
+    : QWidget(parent), tree_(new QTreeWidget(this)) {
+  setWindowTitle(QString("Network Viewer - Traces (%1)").arg(traced_messages.size()));
+  resize(900, 600);
+  QVBoxLayout* layout(new QVBoxLayout(this));
+  layout->addWidget(tree_);
+  tree_->setColumnCount(6);
+  tree_->setHeaderLabels(QStringList() << "Trace / Node"
+                                       << "Step"
+                                       << "At"
+                                       << "Queued"
+                                       << "Link Delay"
+                                       << "Next Hop");
+  tree_->setFont(QFont("Courier", 10));
+  tree_->setAlternatingRowColors(true);
+  Populate(traced_messages);
+  tree_->header()->resizeSections(QHeaderView::ResizeToContents);
+}
+
+void TraceViewController::closeEvent(QCloseEvent* /*event*/) { deleteLater(); }
+
+void TraceViewController::Populate(const std::vector<TracedMessage>& traced_messages) {
+  for (const auto& traced_message : traced_messages) {
+    QTreeWidgetItem* trace_item(new QTreeWidgetItem(tree_));
+    trace_item->setText(0, QString::fromStdString(traced_message.trace_id));
+    trace_item->setText(1, traced_message.dropped
+                               ? QString("dropped")
+                               : (traced_message.delivered ? QString("delivered")
+                                                           : QString("incomplete")));
+    trace_item->setText(2, Microseconds(static_cast<int64_t>(traced_message.duration)));
+    trace_item->setText(5, QString("%1 hops").arg(traced_message.hops));
+    for (const auto& step : traced_message.steps) {
+      QTreeWidgetItem* step_item(new QTreeWidgetItem(trace_item));
+      step_item->setText(0, ShortId(step.node));
+      step_item->setText(1, QString::fromStdString(DecisionString(step.decision)));
+      step_item->setText(2, "+" + Microseconds(static_cast<int64_t>(step.offset)));
+      if (step.decision == TraceStep::kReceived) {
+        step_item->setText(3, Microseconds(step.queue_delay));
+        step_item->setText(4, Microseconds(step.link_delay));
+      }
+      step_item->setText(5, ShortId(step.next_hop));
+    }
+  }
+}
+
+}  // namespace maidsafe
@@ -0,0 +1,57 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_TOOLS_NETWORK_VIEWER_CONTROLLERS_TRACE_VIEW_H_
+#define MAIDSAFE_ROUTING_TOOLS_NETWORK_VIEWER_CONTROLLERS_TRACE_VIEW_H_
+
+// std
+#include <vector>
+
+#include "helpers/qt_push_headers.h"
+#include "helpers/qt_pop_headers.h"
+
+#include "models/trace_file.h"
+
+class QTreeWidget;
+
+namespace maidsafe {
+
+// Lists traced messages, slowest first, each expanding to its path: the node at each step, what
+// it did, when, and how long the message spent queued at and travelling to it.
+class TraceViewController : public QWidget {
+  Q_OBJECT
+
+ public:
+  explicit TraceViewController(const std::vector<TracedMessage>& traced_messages,
+                               QWidget* parent = 0);
+  ~TraceViewController() {}
+
+ protected:
+  virtual void closeEvent(QCloseEvent* event);
+
+ private:
+  TraceViewController(const TraceViewController&);
+  TraceViewController& operator=(const TraceViewController&);
+  void Populate(const std::vector<TracedMessage>& traced_messages);
+
+  QTreeWidget* tree_;
+};
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_TOOLS_NETWORK_VIEWER_CONTROLLERS_TRACE_VIEW_H_
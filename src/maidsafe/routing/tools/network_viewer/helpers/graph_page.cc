@@ -19,32 +19,52 @@
 #include "helpers/graph_page.h"
 
 #include <limits>
+#include <utility>
 #include <vector>
 
-#include "maidsafe/common/tools/network_viewer.h"
+#include "helpers/layout_engine.h"
 
 namespace maidsafe {
 
+namespace {
+
+RingLayout::Band BandOf(routing::MatrixEntryType type) {
+  switch (type) {
+    case routing::MatrixEntryType::kGroup:
+      return RingLayout::Band::kGroup;
+    case routing::MatrixEntryType::kClosest:
+      return RingLayout::Band::kClosest;
+    default:
+      return RingLayout::Band::kMatrix;
+  }
+}
+
+}  // unnamed namespace
+
 GraphPage::GraphPage(std::shared_ptr<APIHelper> api_helper, QObject* parent)
     : QWebPage(parent),
       api_helper_(api_helper),
       current_graph_data_(),
       current_parent_id_(),
       is_data_node_(false),
-      expanded_children_() {
+      expanded_children_(),
+      layout_engine_(new LayoutEngine(this)),
+      layout_nodes_() {
   QFile frame_template(":/index.html");
   frame_template.open(QFile::ReadOnly | QIODevice::Text);
   mainFrame()->setHtml(QLatin1String(frame_template.readAll()));
+  InitSignals();
 }
 
 void GraphPage::RenderGraph(int state_id, std::string parent_id, bool is_data_node) {
   SetGraphContents(QString());
   expanded_children_.clear();
+  layout_nodes_.clear();
   current_parent_id_ = parent_id;
   is_data_node_ = is_data_node;
-  if (parent_id.empty())
-    return;
-  RenderNode(state_id, parent_id, true, is_data_node);
+  if (!parent_id.empty())
+    RenderNode(state_id, parent_id, true, is_data_node);
+  layout_engine_->Layout(layout_nodes_);
 }
 
 void GraphPage::javaScriptAlert(QWebFrame* /*frame*/, const QString& msg) {
@@ -59,6 +79,7 @@ void GraphPage::javaScriptAlert(QWebFrame* /*frame*/, const QString& msg) {
     } else {
       expanded_children_.push_back(node_id);
       RenderNode(-1, node_id, false, false);
+      layout_engine_->Layout(layout_nodes_);
     }
   } else if (message_parts.at(0) == "dblclick") {
     RenderGraph(-1, message_parts.at(1).toStdString(), false);
@@ -68,13 +89,18 @@ void GraphPage::javaScriptAlert(QWebFrame* /*frame*/, const QString& msg) {
 }
 
 void GraphPage::RefreshGraph(int state_id) {
+  if (current_parent_id_.empty())
+    return;
+  layout_nodes_.clear();
   RenderNode(state_id, current_parent_id_, true, is_data_node_);
   foreach(std::string node_id, expanded_children_) { RenderNode(state_id, node_id, false, false); }
+  layout_engine_->Layout(layout_nodes_);
 }
 
 void GraphPage::RenderNode(int state_id, std::string node_id, bool is_parent, bool is_data_node) {
   QString graph_contents;
   std::vector<Node> children(api_helper_->GetCloseNodes(state_id, node_id));
+  AddToLayout(node_id, is_parent ? RingLayout::Band::kParent : RingLayout::Band::kMatrix);
   if (is_parent) {
     graph_contents = QString("%1 {routingNodeType:%2}\\n").arg(QString::fromStdString(node_id)).arg(
         is_data_node ? "dataNode" : "mainNode");
@@ -95,6 +121,7 @@ void GraphPage::RenderNode(int state_id, std::string node_id, bool is_parent, bo
 
   for (size_t i(0); i < children.size(); ++i) {
     graph_contents.append(CreateEdge(node_id, children.at(i), &graph_contents));
+    AddToLayout(children.at(i).id, BandOf(children.at(i).type));
     if (is_parent) {
       assert(i < static_cast<uintmax_t>(std::numeric_limits<int>::max()));
       graph_contents.append(CreateProximityNode(children.at(i), static_cast<int>(i) + 1));
@@ -103,6 +130,10 @@ void GraphPage::RenderNode(int state_id, std::string node_id, bool is_parent, bo
   SetGraphContents(graph_contents);
 }
 
+void GraphPage::ApplyLayout(const QString& delta_json) {
+  mainFrame()->evaluateJavaScript(QString("applyLayout(%1)").arg(delta_json));
+}
+
 QString GraphPage::CreateEdge(std::string parent_id, const Node& child_node,
                               QString* current_content) {
   QString q_parent_id(QString::fromStdString(parent_id));
@@ -137,10 +168,19 @@ void GraphPage::SetGraphContents(const QString& entire_content) {
   mainFrame()->evaluateJavaScript(QString("setContent('%1')").arg(entire_content));
 }
 
+void GraphPage::AddToLayout(const std::string& node_id, RingLayout::Band band) {
+  // A node reached by several paths is drawn in the innermost band it belongs to.
+  auto result(layout_nodes_.insert(std::make_pair(node_id, band)));
+  if (!result.second && band < result.first->second)
+    result.first->second = band;
+}
+
 void GraphPage::InitSignals() {
   connect(api_helper_.get(), SIGNAL(RequestGraphRefresh(int)),  // NOLINT - Viv
           this, SLOT(RefreshGraph(int)),                        // NOLINT - Viv
           Qt::QueuedConnection);
+  connect(layout_engine_, SIGNAL(LayoutChanged(const QString&)),  // NOLINT - Viv
+          this, SLOT(ApplyLayout(const QString&)));               // NOLINT - Viv
 }
 
 }  // namespace maidsafe
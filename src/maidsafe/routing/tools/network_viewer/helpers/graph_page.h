@@ -27,15 +27,17 @@
 #include "helpers/qt_pop_headers.h"
 
 #include "models/api_helper.h"
+#include "models/ring_layout.h"
 
 namespace maidsafe {
 
-namespace network_viewer {
-struct ViewableNode;
-}
-
 class APIHelper;
+class LayoutEngine;
+struct ViewableNode;
 
+// Nodes are placed by a native RingLayout (see LayoutEngine) rather than by the page's
+// force-directed layout, which can't keep up with networks of more than a few hundred nodes.  The
+// page is only sent the graph's structure when it changes and the positions of nodes which moved.
 class GraphPage : public QWebPage {
   Q_OBJECT
 
@@ -54,14 +56,16 @@ class GraphPage : public QWebPage {
 slots:  // NOLINT - Viv
   void RefreshGraph(int state_id);
   void RenderNode(int state_id, std::string node_id, bool is_parent, bool is_data_node);
+  void ApplyLayout(const QString& delta_json);
 
  private:
-  typedef network_viewer::ViewableNode Node;
+  typedef ViewableNode Node;
   GraphPage(const GraphPage&);
   GraphPage& operator=(const GraphPage&);
   QString CreateEdge(std::string parent_id, const Node& child_node, QString* current_content);
   QString CreateProximityNode(const Node& child_node, int proximity);
   void SetGraphContents(const QString& entire_content);
+  void AddToLayout(const std::string& node_id, RingLayout::Band band);
   void InitSignals();
 
   std::shared_ptr<APIHelper> api_helper_;
@@ -69,6 +73,8 @@ slots:  // NOLINT - Viv
   std::string current_parent_id_;
   bool is_data_node_;
   QList<std::string> expanded_children_;
+  LayoutEngine* layout_engine_;
+  RingLayout::Nodes layout_nodes_;
 };
 
 }  // namespace maidsafe
@@ -0,0 +1,63 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "helpers/layout_engine.h"
+
+namespace maidsafe {
+
+LayoutEngine::LayoutEngine(QObject* parent)
+    : QObject(parent),
+      ring_layout_(std::make_shared<RingLayout>()),
+      watcher_(),
+      pending_nodes_(),
+      has_pending_nodes_(false) {
+  connect(&watcher_, SIGNAL(finished()), this, SLOT(OnLayoutFinished()));
+}
+
+LayoutEngine::~LayoutEngine() { watcher_.waitForFinished(); }
+
+void LayoutEngine::Layout(const RingLayout::Nodes& nodes) {
+  if (watcher_.isRunning()) {
+    pending_nodes_ = nodes;
+    has_pending_nodes_ = true;
+    return;
+  }
+  Start(nodes);
+}
+
+void LayoutEngine::OnLayoutFinished() {
+  QString delta_json(watcher_.result());
+  if (!delta_json.isEmpty())
+    emit LayoutChanged(delta_json);
+  if (has_pending_nodes_) {
+    has_pending_nodes_ = false;
+    Start(pending_nodes_);
+  }
+}
+
+void LayoutEngine::Start(const RingLayout::Nodes& nodes) {
+  std::shared_ptr<RingLayout> ring_layout(ring_layout_);
+  watcher_.setFuture(QtConcurrent::run([ring_layout, nodes]()->QString {
+    RingLayout::Delta delta(ring_layout->Update(nodes));
+    if (delta.moved.empty() && delta.removed.empty())
+      return QString();
+    return QString::fromStdString(ToJson(delta));
+  }));
+}
+
+}  // namespace maidsafe
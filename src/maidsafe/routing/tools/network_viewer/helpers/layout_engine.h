@@ -0,0 +1,64 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_TOOLS_NETWORK_VIEWER_HELPERS_LAYOUT_ENGINE_H_
+#define MAIDSAFE_ROUTING_TOOLS_NETWORK_VIEWER_HELPERS_LAYOUT_ENGINE_H_
+
+// std
+#include <memory>
+
+#include "helpers/qt_push_headers.h"
+#include "helpers/qt_pop_headers.h"
+
+#include "models/ring_layout.h"
+
+namespace maidsafe {
+
+// Runs a RingLayout on a worker thread, emitting what moved for the page's renderer to apply.
+class LayoutEngine : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit LayoutEngine(QObject* parent = 0);
+  ~LayoutEngine();
+  // If a layout is still running, only the latest nodes passed in meanwhile are laid out once it
+  // has finished, so a burst of refreshes costs two layouts.
+  void Layout(const RingLayout::Nodes& nodes);
+
+ signals:
+  // delta_json is as taken by applyLayout in resources/js/main.js.  Not emitted if nothing moved.
+  void LayoutChanged(const QString& delta_json);
+
+  private
+slots:  // NOLINT - Viv
+  void OnLayoutFinished();
+
+ private:
+  LayoutEngine(const LayoutEngine&);
+  LayoutEngine& operator=(const LayoutEngine&);
+  void Start(const RingLayout::Nodes& nodes);
+
+  std::shared_ptr<RingLayout> ring_layout_;  // only used by the running job
+  QFutureWatcher<QString> watcher_;
+  RingLayout::Nodes pending_nodes_;
+  bool has_pending_nodes_;
+};
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_TOOLS_NETWORK_VIEWER_HELPERS_LAYOUT_ENGINE_H_
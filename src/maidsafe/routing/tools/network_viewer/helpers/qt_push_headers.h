@@ -63,8 +63,10 @@
 #pragma GCC diagnostic ignored "-Wfloat-equal"
 #endif
 
+#include "QtConcurrent/QtConcurrentRun"
 #include "QtCore/QDebug"
 #include "QtCore/QFile"
+#include "QtCore/QFutureWatcher"
 #include "QtCore/QTimer"
 #include "QtWebKitWidgets/QWebFrame"
 #include "QtWebKitWidgets/QWebPage"
@@ -18,41 +18,99 @@
 
 #include "models/api_helper.h"
 
-#include <chrono>
+#include <algorithm>
 
 #include "helpers/qt_push_headers.h"
 #include "helpers/qt_pop_headers.h"
 
-#include "maidsafe/common/tools/network_viewer.h"
 #include "maidsafe/common/node_id.h"
-#include "maidsafe/common/utils.h"
 
 namespace maidsafe {
 
-APIHelper::APIHelper(QObject* parent) : QObject(parent) {
-  network_viewer::SetUpdateFunctor([this](int state_id) { NetworkUpdated(state_id); });
-  network_viewer::Run(std::chrono::milliseconds(1000));
+namespace {
+
+const size_t kDataCloseNodes(16);
+const size_t kDataGroupSize(4);
+
+std::string Hex(const NodeId& node_id) {
+  return node_id.ToStringEncoded(NodeId::EncodingType::kHex);
+}
+
+}  // unnamed namespace
+
+ViewableNode::ViewableNode() : id(), distance(), type(routing::MatrixEntryType::kMatrix) {}
+
+const int APIHelper::kPollInterval;
+
+APIHelper::APIHelper(QObject* parent) : QObject(parent), reader_(), nodes_(), state_id_(0) {
+  QTimer* poll_timer(new QTimer(this));
+  connect(poll_timer, SIGNAL(timeout()), this, SLOT(Poll()));
+  poll_timer->start(kPollInterval);
 }
 
-APIHelper::~APIHelper() { network_viewer::Stop(); }
+APIHelper::~APIHelper() {}
 
 std::vector<std::string> APIHelper::GetNodesInNetwork(int state_id) const {
   qDebug() << QString("APIHelper::GetNodesInNetwork for State: %1").arg(QString::number(state_id));
-  return network_viewer::GetNodesInNetwork(state_id);
+  std::vector<std::string> node_ids;
+  for (const auto& node : nodes_)
+    node_ids.push_back(node.first);
+  return node_ids;
 }
 
-std::vector<network_viewer::ViewableNode> APIHelper::GetCloseNodes(int state_id,
-                                                                   const std::string& id) const {
+std::vector<ViewableNode> APIHelper::GetCloseNodes(int state_id, const std::string& id) const {
   qDebug() << QString("APIHelper::GetCloseNodes for State: %1 Node: %2")
                   .arg(QString::number(state_id))
                   .arg(GetShortNodeId(id));
-  return network_viewer::GetCloseNodes(state_id, id);
+  std::vector<ViewableNode> close_nodes;
+  NodeId target;
+  try {
+    target = NodeId(id, NodeId::EncodingType::kHex);
+  }
+  catch (const std::exception&) {
+    return close_nodes;
+  }
+  auto itr(nodes_.find(id));
+  if (itr != nodes_.end()) {
+    for (const auto& entry : itr->second) {
+      ViewableNode close_node;
+      close_node.id = Hex(entry.first);
+      close_node.distance = Hex(entry.first ^ target);
+      close_node.type = entry.second;
+      close_nodes.push_back(close_node);
+    }
+    return close_nodes;
+  }
+  // A data ID: show the nodes whose group it would fall in.
+  std::vector<NodeId> node_ids;
+  for (const auto& node : nodes_)
+    node_ids.push_back(NodeId(node.first, NodeId::EncodingType::kHex));
+  const size_t kCount(std::min(kDataCloseNodes, node_ids.size()));
+  std::partial_sort(node_ids.begin(), node_ids.begin() + kCount, node_ids.end(),
+                    [&target](const NodeId& lhs, const NodeId& rhs) {
+                      return NodeId::CloserToTarget(lhs, rhs, target);
+                    });
+  for (size_t index(0); index != kCount; ++index) {
+    ViewableNode close_node;
+    close_node.id = Hex(node_ids[index]);
+    close_node.distance = Hex(node_ids[index] ^ target);
+    close_node.type = index < kDataGroupSize ? routing::MatrixEntryType::kGroup
+                                             : routing::MatrixEntryType::kClosest;
+    close_nodes.push_back(close_node);
+  }
+  return close_nodes;
 }
 
-void APIHelper::NetworkUpdated(int state_id) {
-  qDebug() << QString("APIHelper::NetworkUpdated invoked with State: %1")
-                  .arg(QString::number(state_id));
-  emit RequestGraphRefresh(state_id);
+void APIHelper::Poll() {
+  std::vector<routing::MatrixSnapshot> snapshots;
+  if (!reader_.Read(snapshots))
+    return;
+  nodes_.clear();
+  for (auto& snapshot : snapshots)
+    nodes_[Hex(snapshot.node_id)].swap(snapshot.entries);
+  qDebug() << QString("APIHelper::Poll network updated to State: %1")
+                  .arg(QString::number(++state_id_));
+  emit RequestGraphRefresh(state_id_);
 }
 
 QString APIHelper::GetShortNodeId(std::string node_id) const {
@@ -20,6 +20,7 @@
 #define MAIDSAFE_ROUTING_TOOLS_NETWORK_VIEWER_MODELS_API_HELPER_H_
 
 // std
+#include <map>
 #include <memory>
 #include <string>
 #include <functional>
@@ -28,32 +29,49 @@
 #include "helpers/qt_push_headers.h"
 #include "helpers/qt_pop_headers.h"
 
+#include "maidsafe/routing/matrix_snapshot.h"
+
 namespace maidsafe {
 
-namespace network_viewer {
-struct ViewableNode;
-}
+struct ViewableNode {
+  ViewableNode();
+
+  std::string id, distance;  // hex encoded; distance is from the node or data ID asked about
+  routing::MatrixEntryType type;
+};
 
+// Polls the matrix snapshots published by local nodes (see routing::MatrixSnapshotReader) every
+// kPollInterval, asking for a refresh whenever any node's snapshot has changed.  Only the latest
+// state is kept, so the state_id arguments are accepted for the views' sake but not used.
 class APIHelper : public QObject {
   Q_OBJECT
 
  public:
+  static const int kPollInterval = 200;  // milliseconds
+
   explicit APIHelper(QObject* parent = nullptr);
   ~APIHelper();
   std::vector<std::string> GetNodesInNetwork(int state_id) const;
-  std::vector<network_viewer::ViewableNode> GetCloseNodes(int state_id,
-                                                          const std::string& id) const;
-  void NetworkUpdated(int state_id);
+  // The matrix of the node with ID id, or if there's none, the nodes closest to id.
+  std::vector<ViewableNode> GetCloseNodes(int state_id, const std::string& id) const;
   QString GetShortNodeId(std::string node_id) const;
 
  signals:
   void RequestGraphRefresh(int state_id);
 
+  private
+slots:  // NOLINT - Viv
+  void Poll();
+
  private:
   APIHelper(const APIHelper&);
   APIHelper& operator=(const APIHelper&);
   APIHelper(APIHelper&&);
   APIHelper& operator=(APIHelper&&);
+
+  routing::MatrixSnapshotReader reader_;
+  std::map<std::string, routing::MatrixEntries> nodes_;  // keyed by hex encoded ID
+  int state_id_;
 };
 
 }  // namespace maidsafe
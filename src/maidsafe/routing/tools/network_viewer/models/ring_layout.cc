@@ -0,0 +1,99 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "models/ring_layout.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+namespace maidsafe {
+
+namespace {
+
+const double kPi(3.14159265358979323846);
+const double kBandRadius[] = { 0.4, 0.7, 0.85, 1.0 };
+
+// The leading 64 bits of the ID as a fraction of the ring.
+double RingFraction(const std::string& id) {
+  const std::string leading(id.substr(0, 16));
+  if (leading.empty())
+    return 0.0;
+  uint64_t bits(std::strtoull(leading.c_str(), nullptr, 16));
+  bits <<= 4 * (16 - leading.size());
+  return static_cast<double>(bits) /
+         (static_cast<double>(std::numeric_limits<uint64_t>::max()) + 1.0);
+}
+
+}  // unnamed namespace
+
+RingLayout::Delta::Delta() : moved(), removed() {}
+
+RingLayout::RingLayout() : nodes_() {}
+
+RingLayout::Delta RingLayout::Update(const Nodes& nodes) {
+  Delta delta;
+  // Both maps are ordered by ID, so one pass over each finds every change.
+  auto old_itr(nodes_.begin());
+  for (const auto& node : nodes) {
+    while (old_itr != nodes_.end() && old_itr->first < node.first)
+      delta.removed.push_back((old_itr++)->first);
+    if (old_itr != nodes_.end() && old_itr->first == node.first) {
+      if (old_itr->second != node.second)
+        delta.moved.insert(std::make_pair(node.first, PositionOf(node.first, node.second)));
+      ++old_itr;
+    } else {
+      delta.moved.insert(std::make_pair(node.first, PositionOf(node.first, node.second)));
+    }
+  }
+  for (; old_itr != nodes_.end(); ++old_itr)
+    delta.removed.push_back(old_itr->first);
+  nodes_ = nodes;
+  return delta;
+}
+
+RingLayout::Position RingLayout::PositionOf(const std::string& id, Band band) {
+  // Zero is at the top, increasing clockwise.
+  double angle(2.0 * kPi * RingFraction(id));
+  double radius(kBandRadius[static_cast<int>(band)]);
+  return std::make_pair(radius * std::sin(angle), -radius * std::cos(angle));
+}
+
+std::string ToJson(const RingLayout::Delta& delta) {
+  std::ostringstream json;
+  json << std::fixed << std::setprecision(5) << "{\"moved\":{";
+  bool first(true);
+  for (const auto& node : delta.moved) {
+    json << (first ? "" : ",") << '"' << node.first << "\":[" << node.second.first << ','
+         << node.second.second << ']';
+    first = false;
+  }
+  json << "},\"removed\":[";
+  first = true;
+  for (const auto& id : delta.removed) {
+    json << (first ? "" : ",") << '"' << id << '"';
+    first = false;
+  }
+  json << "]}";
+  return json.str();
+}
+
+}  // namespace maidsafe
@@ -0,0 +1,63 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_TOOLS_NETWORK_VIEWER_MODELS_RING_LAYOUT_H_
+#define MAIDSAFE_ROUTING_TOOLS_NETWORK_VIEWER_MODELS_RING_LAYOUT_H_
+
+// std
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace maidsafe {
+
+// Places nodes on a ring by ID, so that nodes close in XOR space for the leading bits are drawn
+// next to each other, with each band on its own radius.  A node's position depends only on its ID
+// and band, so an update costs time only for the nodes which were added, moved band or removed.
+class RingLayout {
+ public:
+  // Innermost first.
+  enum class Band { kParent = 0, kGroup, kClosest, kMatrix };
+  typedef std::map<std::string, Band> Nodes;  // keyed by hex encoded ID
+  typedef std::pair<double, double> Position;  // x and y, both in [-1, 1]
+  struct Delta {
+    Delta();
+
+    std::map<std::string, Position> moved;  // includes added nodes
+    std::vector<std::string> removed;
+  };
+
+  RingLayout();
+  // Lays out exactly 'nodes', returning only what changed since the previous call.
+  Delta Update(const Nodes& nodes);
+  static Position PositionOf(const std::string& id, Band band);
+
+ private:
+  RingLayout(const RingLayout&);
+  RingLayout& operator=(const RingLayout&);
+
+  Nodes nodes_;
+};
+
+// Serialises delta as the JSON object taken by applyLayout in resources/js/main.js.
+std::string ToJson(const RingLayout::Delta& delta);
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_TOOLS_NETWORK_VIEWER_MODELS_RING_LAYOUT_H_
@@ -0,0 +1,128 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "models/trace_file.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+namespace maidsafe {
+
+namespace {
+
+struct Line {
+  Line() : trace_id(), timestamp(0), step() {}
+  std::string trace_id;
+  uint64_t timestamp;
+  TraceStep step;
+};
+
+bool ParseLine(const std::string& text, Line& line) {
+  std::istringstream stream(text);
+  int decision(-1);
+  stream >> line.trace_id >> line.step.node >> line.timestamp >> decision >> line.step.next_hop >>
+      line.step.queue_delay;
+  if (!stream || decision < TraceStep::kOriginated || decision > TraceStep::kDropped)
+    return false;
+  line.step.decision = static_cast<TraceStep::Decision>(decision);
+  if (line.step.decision != TraceStep::kSent)
+    line.step.next_hop.clear();
+  return true;
+}
+
+TracedMessage Assemble(const std::string& trace_id, std::vector<Line>& lines) {
+  std::stable_sort(std::begin(lines), std::end(lines), [](const Line& lhs, const Line& rhs) {
+    return lhs.timestamp < rhs.timestamp;
+  });
+  TracedMessage traced_message;
+  traced_message.trace_id = trace_id;
+  const uint64_t kStart(lines.front().timestamp);
+  std::map<std::string, uint64_t> last_send_to;
+  for (auto& line : lines) {
+    line.step.offset = line.timestamp - kStart;
+    if (line.step.decision == TraceStep::kSent) {
+      last_send_to[line.step.next_hop] = line.timestamp;
+    } else if (line.step.decision == TraceStep::kReceived) {
+      ++traced_message.hops;
+      auto send(last_send_to.find(line.step.node));
+      if (send != std::end(last_send_to))
+        line.step.link_delay =
+            static_cast<int64_t>(line.timestamp) - static_cast<int64_t>(send->second);
+    } else if (line.step.decision == TraceStep::kDelivered) {
+      traced_message.delivered = true;
+    } else if (line.step.decision == TraceStep::kDropped) {
+      traced_message.dropped = true;
+    }
+    traced_message.steps.push_back(line.step);
+  }
+  traced_message.duration = lines.back().timestamp - kStart;
+  return traced_message;
+}
+
+}  // unnamed namespace
+
+TraceStep::TraceStep()
+    : node(), next_hop(), decision(kOriginated), offset(0), queue_delay(0), link_delay(-1) {}
+
+TracedMessage::TracedMessage()
+    : trace_id(), steps(), duration(0), hops(0), delivered(false), dropped(false) {}
+
+bool ReadTraceFile(const std::string& path, std::vector<TracedMessage>& traced_messages) {
+  std::ifstream file(path);
+  if (!file)
+    return false;
+  std::map<std::string, std::vector<Line>> lines_by_trace;
+  std::string text;
+  while (std::getline(file, text)) {
+    if (text.empty())
+      continue;
+    Line line;
+    if (!ParseLine(text, line))
+      return false;
+    lines_by_trace[line.trace_id].push_back(line);
+  }
+  traced_messages.clear();
+  for (auto& trace : lines_by_trace)
+    traced_messages.push_back(Assemble(trace.first, trace.second));
+  // Slowest first, since slow routes are what traces are for.
+  std::stable_sort(std::begin(traced_messages), std::end(traced_messages),
+                   [](const TracedMessage& lhs, const TracedMessage& rhs) {
+                     return lhs.duration > rhs.duration;
+                   });
+  return true;
+}
+
+std::string DecisionString(TraceStep::Decision decision) {
+  switch (decision) {
+    case TraceStep::kOriginated:
+      return "originated";
+    case TraceStep::kReceived:
+      return "received";
+    case TraceStep::kSent:
+      return "sent";
+    case TraceStep::kDelivered:
+      return "delivered";
+    case TraceStep::kDropped:
+      return "dropped";
+  }
+  return "unknown";
+}
+
+}  // namespace maidsafe
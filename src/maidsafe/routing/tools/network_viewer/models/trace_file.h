@@ -0,0 +1,64 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_TOOLS_NETWORK_VIEWER_MODELS_TRACE_FILE_H_
+#define MAIDSAFE_ROUTING_TOOLS_NETWORK_VIEWER_MODELS_TRACE_FILE_H_
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace maidsafe {
+
+// One line of a trace file written by routing's WriteTraceEvents (see
+// maidsafe/routing/trace_event.h), with times made relative to the first event of its trace.
+struct TraceStep {
+  enum Decision { kOriginated = 0, kReceived, kSent, kDelivered, kDropped };
+
+  TraceStep();
+
+  std::string node, next_hop;  // 16 hex digits; next_hop is only set for kSent
+  Decision decision;
+  uint64_t offset;  // microseconds
+  uint32_t queue_delay;  // microseconds waited before being handled, for kReceived
+  // For kReceived, microseconds since the latest send to this node, or -1 if that wasn't recorded.
+  // Nodes' clocks differ, so this is only exact between nodes on the same machine.
+  int64_t link_delay;
+};
+
+// The recorded path of one traced message, and of its reply if it had one.
+struct TracedMessage {
+  TracedMessage();
+
+  std::string trace_id;
+  std::vector<TraceStep> steps;  // in time order
+  uint64_t duration;  // microseconds from first to last step
+  size_t hops;  // number of kReceived steps
+  bool delivered, dropped;
+};
+
+// Returns false if path can't be read or holds a malformed line.  Files dumped by several nodes can
+// be concatenated.
+bool ReadTraceFile(const std::string& path, std::vector<TracedMessage>& traced_messages);
+
+std::string DecisionString(TraceStep::Decision decision);
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_TOOLS_NETWORK_VIEWER_MODELS_TRACE_FILE_H_
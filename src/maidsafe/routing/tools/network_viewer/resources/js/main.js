@@ -20,7 +20,7 @@ trace = arbor.etc.trace;
 objmerge = arbor.etc.objmerge;
 objcopy = arbor.etc.objcopy;
 var parse = Parser().parse;
-var mainCanvas = arbor.ParticleSystem(50, 512, 0.5);
+var mainCanvas = RingSystem();
 
 function setContent(text) {
   var network = parse(text);
@@ -31,6 +31,12 @@ function setContent(text) {
   mainCanvas.renderer.redraw();
 }
 
+// Called by the viewer with the positions of nodes which have moved since its last call.
+function applyLayout(delta) {
+  mainCanvas.applyLayout(delta);
+  mainCanvas.renderer.redraw();
+}
+
 function GetClosestNode(e) {
   var pos = $("#mainViewport").offset();
   var mouseP = arbor.Point(e.pageX - pos.left, e.pageY - pos.top);
@@ -68,7 +74,7 @@ $(document).on("click", "#mainViewport", function (e) {
 
 function singleClick(e) {
   $("#hide_button").click();
-  if (IsParentNode(GetClosestNode(e).node))
+  if (GetClosestNode(e).node === null || IsParentNode(GetClosestNode(e).node))
     return false;
   var nodeName = GetClosestNode(e).node.name.toString();
   alert('click-' + nodeName);
@@ -82,13 +88,15 @@ $(document).on("dblclick", "#mainViewport", function (e) {
 
 function doubleClick(e) {
   $("#hide_button").click();
-  if (IsParentNode(GetClosestNode(e).node))
+  if (GetClosestNode(e).node === null || IsParentNode(GetClosestNode(e).node))
     return false;
   var nodeName = GetClosestNode(e).node.name.toString();
   alert('dblclick-' + nodeName);
 }
 
 $(document).on("contextmenu", "#mainViewport", function (e) {
+  if (GetClosestNode(e).node === null)
+    return false;
   $('#node_name').val(GetClosestNode(e).node.name.toString());
   var routingDistance = GetClosestNode(e).node.data.routingDistance || "";
   $('#node_distance').val(routingDistance);
@@ -100,6 +108,7 @@ $(document).on("contextmenu", "#mainViewport", function (e) {
 
 $(document).ready(function () {
   mainCanvas.renderer = Renderer("#mainViewport");
+  mainCanvas.renderer.init(mainCanvas);
   setContent('');
   $("#container").hide();
   UpdateCanvasOnContainerResize();
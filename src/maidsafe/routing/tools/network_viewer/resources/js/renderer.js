@@ -11,8 +11,6 @@
         particleSystem = system
         particleSystem.screenSize(canvas.width, canvas.height)
         particleSystem.screenPadding(40)
-
-        that.initMouseHandling()
       },
 
       drawRoundedRect: function(x, y, width, height, fill, parentNode, isExpanded) {
@@ -226,57 +224,6 @@
         })
 
 
-      },
-      initMouseHandling: function() {
-        // no-nonsense drag and drop (thanks springy.js)
-        selected = null;
-        nearest = null;
-        var dragged = null;
-        var oldmass = 1
-
-        // set up a handler object that will initially listen for mousedowns then
-        // for moves and mouseups while dragging
-        var handler = {
-          clicked: function(e) {
-            var pos = $(canvas).offset();
-            _mouseP = arbor.Point(e.pageX - pos.left, e.pageY - pos.top)
-            selected = nearest = dragged = particleSystem.nearest(_mouseP);
-
-            if (dragged.node !== null) dragged.node.fixed = true
-
-            $(canvas).bind('mousemove', handler.dragged)
-            $(window).bind('mouseup', handler.dropped)
-
-            return false
-          },
-          dragged: function(e) {
-            var old_nearest = nearest && nearest.node._id
-            var pos = $(canvas).offset();
-            var s = arbor.Point(e.pageX - pos.left, e.pageY - pos.top)
-
-            if (!nearest) return
-            if (dragged !== null && dragged.node !== null) {
-              var p = particleSystem.fromScreen(s)
-              dragged.node.p = p
-            }
-
-            return false
-          },
-
-          dropped: function(e) {
-            if (dragged === null || dragged.node === undefined) return
-            if (dragged.node !== null) dragged.node.fixed = false
-            dragged.node.tempMass = 50
-            dragged = null
-            selected = null
-            $(canvas).unbind('mousemove', handler.dragged)
-            $(window).unbind('mouseup', handler.dropped)
-            _mouseP = null
-            return false
-          }
-        }
-        $(canvas).mousedown(handler.clicked);
-
       }
     }
 
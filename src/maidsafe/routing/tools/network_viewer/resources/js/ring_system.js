@@ -0,0 +1,91 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+// Stands in for arbor's ParticleSystem, drawing nodes where the viewer's native layout placed them
+// (see applyLayout in main.js) rather than simulating forces between them.  Nodes are only drawn
+// once they've been given a position.
+RingSystem = function () {
+  var nodes = {};      // name -> { name, data }
+  var edges = [];      // { source, target, data }
+  var positions = {};  // name -> [x, y], both in [-1, 1]
+  var size = { width: 0, height: 0 };
+  var padding = 0;
+
+  var toScreen = function (position) {
+    var scale = Math.max(0, Math.min(size.width, size.height) / 2 - padding);
+    return arbor.Point(size.width / 2 + position[0] * scale, size.height / 2 + position[1] * scale);
+  };
+
+  var that = {
+    renderer: null,
+
+    // Replaces the graph's structure with network, as returned by Parser().parse.
+    merge: function (network) {
+      nodes = {};
+      $.each(network.nodes, function (name, data) {
+        nodes[name] = { name: name, data: data };
+      });
+      edges = [];
+      $.each(network.edges, function (source, targets) {
+        $.each(targets, function (target, data) {
+          edges.push({ source: nodes[source], target: nodes[target], data: data });
+        });
+      });
+    },
+
+    applyLayout: function (delta) {
+      $.each(delta.moved, function (name, position) { positions[name] = position; });
+      $.each(delta.removed, function (i, name) { delete positions[name]; });
+    },
+
+    eachNode: function (callback) {
+      $.each(nodes, function (name, node) {
+        if (positions[name] !== undefined)
+          callback(node, toScreen(positions[name]));
+      });
+    },
+
+    eachEdge: function (callback) {
+      $.each(edges, function (i, edge) {
+        var source = positions[edge.source.name], target = positions[edge.target.name];
+        if (source !== undefined && target !== undefined)
+          callback(edge, toScreen(source), toScreen(target));
+      });
+    },
+
+    nearest: function (point) {
+      var closest = { node: null, point: null, distance: null };
+      that.eachNode(function (node, pt) {
+        var distance = pt.subtract(point).magnitude();
+        if (closest.distance === null || distance < closest.distance)
+          closest = { node: node, point: pt, distance: distance };
+      });
+      return closest;
+    },
+
+    screenSize: function (width, height) {
+      size = { width: width, height: height };
+    },
+
+    screenPadding: function (pixels) {
+      padding = pixels;
+    }
+  };
+
+  return that;
+};
@@ -107,20 +107,23 @@ int main(int argc, char** argv) {
     }
 
     // Load fob list and local fob
-    std::vector<maidsafe::passport::Pmid> all_pmids;
+    // Only this node's own pmid is parsed from the keys file.
+    std::shared_ptr<const maidsafe::routing::PmidStore> pmid_store;
+    size_t pmids_count(0);
     maidsafe::passport::Anmaid anmaid;
     maidsafe::passport::Maid maid(anmaid);
     maidsafe::passport::Pmid local_pmid(maid);
     auto pmids_path(maidsafe::GetPathFromProgramOptions("pmids_path", variables_map, false, true));
     if (fs::exists(pmids_path, error_code)) {
-      all_pmids = maidsafe::passport::detail::ReadPmidList(pmids_path);
-      std::cout << "Loaded " << all_pmids.size() << " fobs." << std::endl;
-      if (static_cast<uint32_t>(identity_index) >= all_pmids.size() || identity_index < 0) {
-        std::cout << "ERROR : index exceeds fob pool -- pool has " << all_pmids.size()
+      pmid_store = std::make_shared<const maidsafe::routing::PmidStore>(pmids_path);
+      pmids_count = pmid_store->size();
+      std::cout << "Loaded " << pmids_count << " fobs." << std::endl;
+      if (static_cast<uint32_t>(identity_index) >= pmids_count || identity_index < 0) {
+        std::cout << "ERROR : index exceeds fob pool -- pool has " << pmids_count
                   << " fobs, while identity_index is " << identity_index << std::endl;
         return 0;
       } else {
-        local_pmid = all_pmids[identity_index];
+        local_pmid = pmid_store->pmid(identity_index);
         std::cout << "Using identity #" << identity_index << " from keys file"
                   << " , value is : " << maidsafe::HexSubstr(local_pmid.name().value) << std::endl;
       }
@@ -133,15 +136,15 @@ int main(int argc, char** argv) {
     // Ensure correct index range is being used
     bool client_only_node(variables_map["client"].as<bool>());
     if (client_only_node) {
-      if (identity_index < static_cast<int>(all_pmids.size() / 2)) {
+      if (identity_index < static_cast<int>(pmids_count / 2)) {
         std::cout << "ERROR : Incorrect identity_index used for a client, must between "
-                  << all_pmids.size() / 2 << " and " << all_pmids.size() - 1 << std::endl;
+                  << pmids_count / 2 << " and " << pmids_count - 1 << std::endl;
         return 0;
       }
     } else {
-      if (identity_index >= static_cast<int>(all_pmids.size() / 2)) {
+      if (identity_index >= static_cast<int>(pmids_count / 2)) {
         std::cout << "ERROR : Incorrect identity_index used for a vault, must between 0 and "
-                  << all_pmids.size() / 2 - 1 << std::endl;
+                  << pmids_count / 2 - 1 << std::endl;
         return 0;
       }
     }
@@ -161,7 +164,7 @@ int main(int argc, char** argv) {
                 << " ------ " << std::endl;
     }
 
-    maidsafe::routing::test::Commands commands(demo_node, all_pmids, identity_index);
+    maidsafe::routing::test::Commands commands(demo_node, pmid_store, identity_index);
     std::string peer(variables_map.at("peer").as<std::string>());
     if (!peer.empty()) {
       commands.GetPeer(peer);
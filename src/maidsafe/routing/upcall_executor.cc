@@ -0,0 +1,105 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/upcall_executor.h"
+
+#include "maidsafe/routing/metrics.h"
+#include "maidsafe/routing/thread_placement.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+UpcallExecutor::UpcallExecutor(uint16_t thread_count, size_t max_queued,
+                               const std::vector<uint32_t>& cpus)
+    : kThreadCount_(thread_count),
+      kMaxQueued_(max_queued),
+      metrics_(nullptr),
+      mutex_(),
+      upcalls_(),
+      draining_(0),
+      stopped_(false),
+      asio_service_(kThreadCount_ == 0 ? nullptr : new AsioService(kThreadCount_)) {
+  if (asio_service_)
+    PinAsioThreads(*asio_service_, kThreadCount_, cpus);
+}
+
+UpcallExecutor::~UpcallExecutor() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+    upcalls_.clear();
+  }
+  if (asio_service_)
+    asio_service_->Stop();
+}
+
+void UpcallExecutor::set_metrics(Metrics* metrics) { metrics_ = metrics; }
+
+bool UpcallExecutor::Post(std::function<void()> upcall,
+                          std::chrono::steady_clock::time_point deadline) {
+  if (!asio_service_) {
+    upcall();
+    return true;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopped_ || upcalls_.size() >= kMaxQueued_)
+      return false;
+    upcalls_.push_back(Upcall(std::chrono::steady_clock::now(), deadline, std::move(upcall)));
+    // Threads already draining will pick this up-call up.
+    if (draining_ == kThreadCount_ || upcalls_.size() <= draining_)
+      return true;
+    ++draining_;
+  }
+  asio_service_->service().post([this]() { Drain(); });
+  return true;
+}
+
+size_t UpcallExecutor::queued() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return upcalls_.size();
+}
+
+void UpcallExecutor::Drain() {
+  for (;;) {
+    Upcall upcall;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stopped_ || upcalls_.empty()) {
+        --draining_;
+        return;
+      }
+      upcall = std::move(upcalls_.front());
+      upcalls_.pop_front();
+    }
+    const auto kNow(std::chrono::steady_clock::now());
+    if (metrics_)
+      metrics_->UpcallDequeued(kNow - upcall.queued_time);
+    if (kNow >= upcall.deadline) {
+      if (metrics_)
+        metrics_->Dropped(DropReason::kExpired);
+      continue;
+    }
+    upcall.functor();
+  }
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,85 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_UPCALL_EXECUTOR_H_
+#define MAIDSAFE_ROUTING_UPCALL_EXECUTOR_H_
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/common/asio_service.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+class Metrics;
+
+// Passes node level messages to the application on threads of its own, so that a slow handler
+// holds up only other messages for the application, not routing's own traffic.  At most
+// max_queued up-calls wait; Post refuses any more, leaving the caller to shed the message.  With
+// no threads, Post makes the up-call at once on the calling thread.  With more than one, up-calls
+// may overtake each other.  The threads are pinned to the CPUs given, if any (see PinAsioThreads).
+class UpcallExecutor {
+ public:
+  UpcallExecutor(uint16_t thread_count, size_t max_queued,
+                 const std::vector<uint32_t>& cpus = std::vector<uint32_t>());
+  ~UpcallExecutor();
+  // Each up-call's time in the queue is recorded in metrics if it's set.
+  void set_metrics(Metrics* metrics);
+  // An up-call still queued at deadline is dropped rather than made, as no-one is waiting for its
+  // reply any more.
+  bool Post(std::function<void()> upcall, std::chrono::steady_clock::time_point deadline =
+                                              std::chrono::steady_clock::time_point::max());
+  size_t queued() const;
+
+ private:
+  struct Upcall {
+    Upcall() : queued_time(), deadline(), functor() {}
+    Upcall(std::chrono::steady_clock::time_point queued_time_in,
+           std::chrono::steady_clock::time_point deadline_in, std::function<void()> functor_in)
+        : queued_time(queued_time_in), deadline(deadline_in), functor(std::move(functor_in)) {}
+    std::chrono::steady_clock::time_point queued_time, deadline;
+    std::function<void()> functor;
+  };
+
+  UpcallExecutor(const UpcallExecutor&);
+  UpcallExecutor& operator=(const UpcallExecutor&);
+  void Drain();
+
+  const uint16_t kThreadCount_;
+  const size_t kMaxQueued_;
+  Metrics* metrics_;
+  mutable std::mutex mutex_;
+  std::deque<Upcall> upcalls_;
+  uint16_t draining_;
+  bool stopped_;
+  std::unique_ptr<AsioService> asio_service_;  // null if kThreadCount_ is 0
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_UPCALL_EXECUTOR_H_
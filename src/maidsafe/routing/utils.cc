@@ -18,10 +18,18 @@
 
 #include <string>
 #include <algorithm>
+#include <limits>
+#include <sstream>
 #include <vector>
 
 #include "maidsafe/routing/utils.h"
 
+#include "boost/filesystem/operations.hpp"
+#include "cryptopp/gzip.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/wire_format_lite.h"
+
+#include "maidsafe/common/crypto.h"
 #include "maidsafe/common/log.h"
 #include "maidsafe/common/utils.h"
 #include "maidsafe/common/node_id.h"
@@ -76,11 +84,8 @@ bool ValidateAndAddToRoutingTable(NetworkUtils& network, RoutingTable& routing_t
   peer.connection_id = connection_id;
   bool routing_accepted_node(false);
   if (client) {
-    NodeId furthest_close_node_id =
-        routing_table.GetNthClosestNode(NodeId(routing_table.kNodeId()),
-                                        2 * Parameters::closest_nodes_size).node_id;
-
-    if (client_routing_table.AddNode(peer, furthest_close_node_id))
+    if (client_routing_table.AddNode(
+            peer, routing_table.close_boundaries()->furthest_client_close_node))
       routing_accepted_node = true;
   } else {  // Vaults
     if (routing_table.AddNode(peer, matrix_update))
@@ -94,6 +99,17 @@ bool ValidateAndAddToRoutingTable(NetworkUtils& network, RoutingTable& routing_t
     return true;
   }
 
+  if (!client) {
+    NodeId evicted_connection_id;
+    if (network.shortcuts().Add(peer, evicted_connection_id)) {
+      LOG(kVerbose) << "[" << DebugId(routing_table.kNodeId()) << "] "
+                    << "added shortcut to " << HexSubstr(peer_id.string());
+      if (!evicted_connection_id.IsZero())
+        network.Remove(evicted_connection_id);
+      return true;
+    }
+  }
+
   LOG(kInfo) << "[" << DebugId(routing_table.kNodeId()) << "] "
              << "failed to add " << (client ? "client-" : "") << "node to "
              << (client ? "non-" : "") << "routing table.  Node ID: " << HexSubstr(peer_id.string())
@@ -130,7 +146,7 @@ void HandleSymmetricNodeAdd(RoutingTable& /*routing_table*/, const NodeId& /*pee
 
 GroupRangeStatus GetProximalRange(const NodeId& target_id, const NodeId& node_id,
                                   const NodeId& this_node_id,
-                                  const crypto::BigInt& proximity_radius,
+                                  const XorDistance& proximity_radius,
                                   const std::vector<NodeId>& holders) {
   assert((std::find(holders.begin(), holders.end(), target_id) == holders.end()) &&
          "Ensure to remove target id entry from holders, if present");
@@ -148,10 +164,8 @@ GroupRangeStatus GetProximalRange(const NodeId& target_id, const NodeId& node_id
     return GroupRangeStatus::kInRange;
   }
 
-  NodeId distance_id(node_id ^ target_id);
-  crypto::BigInt distance((distance_id.ToStringEncoded(NodeId::EncodingType::kHex) + 'h').c_str());
-  return (distance < proximity_radius) ? GroupRangeStatus::kInProximalRange
-                                       : GroupRangeStatus::kOutwithRange;
+  return (XorDistance(node_id, target_id) < proximity_radius) ? GroupRangeStatus::kInProximalRange
+                                                              : GroupRangeStatus::kOutwithRange;
 }
 
 bool IsRoutingMessage(const protobuf::Message& message) { return message.routing_message(); }
@@ -183,55 +197,110 @@ bool IsClientToClientMessageWithDifferentNodeIds(const protobuf::Message& messag
 bool CheckId(const std::string& id_to_test) { return id_to_test.size() == NodeId::kSize; }
 
 bool ValidateMessage(const protobuf::Message& message) {
+  DropReason reason(DropReason::kUninitialised);
+  return ValidateMessage(message, reason);
+}
+
+void SetHopBudget(uint16_t hop_budget, protobuf::Message& message) {
+  message.set_hops_to_live(hop_budget);
+  if (hop_budget != Parameters::hops_to_live)
+    message.set_hop_budget(hop_budget);
+  else
+    message.clear_hop_budget();
+}
+
+int32_t HopsTaken(const protobuf::Message& message) {
+  return (message.has_hop_budget() ? message.hop_budget() : Parameters::hops_to_live) -
+         message.hops_to_live();
+}
+
+void SetTimeLeft(const std::chrono::steady_clock::duration& timeout, protobuf::Message& message) {
+  if (!Parameters::request_deadlines)
+    return;
+  auto milliseconds(std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count());
+  message.set_time_left(static_cast<uint32_t>(
+      std::min<int64_t>(std::max<int64_t>(milliseconds, 0), std::numeric_limits<uint32_t>::max())));
+}
+
+void DeductTimeLeft(std::chrono::steady_clock::time_point received_time,
+                    protobuf::Message& message) {
+  if (!message.has_time_left())
+    return;
+  const uint64_t kElapsed(static_cast<uint64_t>(std::chrono::duration_cast<
+      std::chrono::milliseconds>(std::chrono::steady_clock::now() - received_time).count()));
+  message.set_time_left(kElapsed >= message.time_left()
+                            ? 0
+                            : message.time_left() - static_cast<uint32_t>(kElapsed));
+}
+
+bool IsExpired(const protobuf::Message& message) {
+  return message.has_time_left() && message.time_left() == 0;
+}
+
+std::chrono::steady_clock::time_point Deadline(const protobuf::Message& message) {
+  if (!message.has_time_left())
+    return std::chrono::steady_clock::time_point::max();
+  return std::chrono::steady_clock::now() + std::chrono::milliseconds(message.time_left());
+}
+
+bool ValidateMessage(const protobuf::Message& message, DropReason& reason) {
   if (!message.IsInitialized()) {
     LOG(kWarning) << "Uninitialised message dropped.";
+    reason = DropReason::kUninitialised;
     return false;
   }
 
   // Message has traversed more hops than expected
   if (message.hops_to_live() <= 0) {
-    std::string route_history;
+    std::ostringstream route_history;
     for (const auto& route : message.route_history())
-      route_history += HexSubstr(route) + ", ";
+      route_history << std::hex << route << ", ";
     LOG(kError) << "Message has traversed more hops than expected. "
                 << Parameters::max_route_history
-                << " last hops in route history are: " << route_history
+                << " last hops in route history are: " << route_history.str()
                 << " \nMessage source: " << HexSubstr(message.source_id())
                 << ", \nMessage destination: " << HexSubstr(message.destination_id())
                 << ", \nMessage type: " << message.type() << ", \nMessage id: " << message.id();
+    reason = DropReason::kNoHopsLeft;
     return false;
   }
   // Invalid destination id, unknown message
   if (!CheckId(message.destination_id())) {
     LOG(kWarning) << "Stray message dropped, need destination ID for processing."
                   << " id: " << message.id();
+    reason = DropReason::kInvalidDestination;
     return false;
   }
 
   if (!(message.has_source_id() || (message.has_relay_id() && message.has_relay_connection_id()))) {
     LOG(kWarning) << "Message should have either src id or relay information.";
     assert(false && "Message should have either src id or relay information.");
+    reason = DropReason::kNoSource;
     return false;
   }
 
   if (message.has_source_id() && !CheckId(message.source_id())) {
     LOG(kWarning) << "Invalid source id field.";
+    reason = DropReason::kInvalidSource;
     return false;
   }
 
   if (message.has_relay_id() && NodeId(message.relay_id()).IsZero()) {
     LOG(kWarning) << "Invalid relay id field.";
+    reason = DropReason::kInvalidRelay;
     return false;
   }
 
   if (message.has_relay_connection_id() && NodeId(message.relay_connection_id()).IsZero()) {
     LOG(kWarning) << "Invalid relay connection id field.";
+    reason = DropReason::kInvalidRelay;
     return false;
   }
 
   if (static_cast<MessageType>(message.type()) == MessageType::kConnect)
     if (!message.direct()) {
       LOG(kWarning) << "kConnectRequest type message must be direct.";
+      reason = DropReason::kMustBeDirect;
       return false;
     }
 
@@ -239,6 +308,7 @@ bool ValidateMessage(const protobuf::Message& message) {
       (message.request() == false))
     if ((!message.direct())) {
       LOG(kWarning) << "kFindNodesResponse type message must be direct.";
+      reason = DropReason::kMustBeDirect;
       return false;
     }
 
@@ -258,9 +328,121 @@ boost::asio::ip::udp::endpoint GetEndpointFromProtobuf(const protobuf::Endpoint&
                                         static_cast<uint16_t>(pb_endpoint.port()));
 }
 
+bool ParseMessageHeader(const std::string& serialised, protobuf::Message& header,
+                        std::string& encoded_body) {
+  using google::protobuf::internal::WireFormatLite;
+  const auto kSerialised(reinterpret_cast<const google::protobuf::uint8*>(serialised.data()));
+  google::protobuf::io::CodedInputStream input(kSerialised, static_cast<int>(serialised.size()));
+  header.Clear();
+  encoded_body.clear();
+  // Fields are handled a run at a time, as serialised in field number order the payload is one
+  // run between two of header fields.  Merging each header run straight from |serialised| is the
+  // same as parsing their concatenation, so the header's encoding is never copied, and the
+  // payload's is copied in one go.
+  int run_start(0);
+  bool body_run(false);
+  auto end_run([&](int run_end)->bool {
+    if (run_end == run_start)
+      return true;
+    if (body_run) {
+      encoded_body.append(serialised, run_start, run_end - run_start);
+      return true;
+    }
+    google::protobuf::io::CodedInputStream run(kSerialised + run_start, run_end - run_start);
+    return header.MergePartialFromCodedStream(&run) && run.ConsumedEntireMessage();
+  });
+  for (;;) {
+    const int kFieldStart(input.CurrentPosition());
+    const google::protobuf::uint32 kTag(input.ReadTag());
+    if (kTag == 0) {
+      if (!end_run(kFieldStart))
+        return false;
+      break;
+    }
+    const int kFieldNumber(WireFormatLite::GetTagFieldNumber(kTag));
+    const bool kBodyField(kFieldNumber == protobuf::Message::kDataFieldNumber ||
+                          kFieldNumber == protobuf::Message::kSignatureFieldNumber);
+    if (kBodyField != body_run) {
+      if (!end_run(kFieldStart))
+        return false;
+      run_start = kFieldStart;
+      body_run = kBodyField;
+    }
+    if (!WireFormatLite::SkipField(&input, kTag))
+      return false;
+  }
+  return input.ConsumedEntireMessage() && header.IsInitialized();
+}
+
+void CompressData(protobuf::Message& message) {
+  if (message.data_size() != 1 || message.data(0).empty())
+    return;
+  try {
+    std::string compressed(crypto::Compress(crypto::UncompressedText(message.data(0)),
+                                            Parameters::compression_level).string());
+    if (compressed.size() >= message.data(0).size())
+      return;
+    message.mutable_data(0)->swap(compressed);
+    message.set_compressed(true);
+  }
+  catch (const std::exception& e) {
+    LOG(kWarning) << "Failed to compress payload: " << e.what();
+  }
+}
+
+bool UncompressData(protobuf::Message& message) {
+  if (!message.compressed())
+    return true;
+  if (message.data_size() != 1)
+    return false;
+  try {
+    // Inflated a chunk at a time, so that a payload which would inflate past max_data_size is
+    // given up on having used at most a chunk's worth of output beyond it.  crypto::Compress
+    // writes gzip, and deflate expands no more than about a thousandfold, so a chunk of
+    // kChunkSize gives at most a few hundred KiB.
+    const size_t kChunkSize(256);
+    const std::string& compressed(message.data(0));
+    const auto kInput(reinterpret_cast<const unsigned char*>(compressed.data()));
+    CryptoPP::Gunzip gunzip;
+    std::string uncompressed;
+    auto drain([&]()->bool {
+      const size_t kAvailable(static_cast<size_t>(gunzip.MaxRetrievable()));
+      if (uncompressed.size() + kAvailable > Parameters::max_data_size)
+        return false;
+      const size_t kOldSize(uncompressed.size());
+      uncompressed.resize(kOldSize + kAvailable);
+      gunzip.Get(reinterpret_cast<unsigned char*>(&uncompressed[kOldSize]), kAvailable);
+      return true;
+    });
+    for (size_t offset(0); offset < compressed.size(); offset += kChunkSize) {
+      gunzip.Put(kInput + offset, std::min(kChunkSize, compressed.size() - offset));
+      if (!drain()) {
+        LOG(kWarning) << "Payload inflates past max_data_size, dropping it.";
+        return false;
+      }
+    }
+    gunzip.MessageEnd();
+    if (!drain()) {
+      LOG(kWarning) << "Payload inflates past max_data_size, dropping it.";
+      return false;
+    }
+    message.mutable_data(0)->swap(uncompressed);
+    message.clear_compressed();
+    return true;
+  }
+  catch (const std::exception& e) {
+    LOG(kWarning) << "Failed to uncompress payload: " << e.what();
+    return false;
+  }
+}
+
 std::string MessageTypeString(const protobuf::Message& message) {
+  return MessageTypeString(message.type(), message.request());
+}
+
+std::string MessageTypeString(int32_t type, bool request) {
   std::string message_type;
-  switch (static_cast<MessageType>(message.type())) {
+  switch (static_cast<MessageType>(type)) {
     case MessageType::kPing:
       message_type = "kPing     ";
       break;
@@ -291,7 +473,7 @@ std::string MessageTypeString(const protobuf::Message& message) {
     default:
       message_type = "Unknown  ";
   }
-  if (message.request())
+  if (request)
     message_type = message_type + " Req";
   else
     message_type = message_type + " Res";
@@ -383,6 +565,23 @@ std::string SerializeNodeIdList(const std::vector<NodeId>& node_list) {
   return node_list_msg.SerializeAsString();
 }
 
+bool WriteFileAtomically(const fs::path& path, const std::string& content) {
+  fs::path temp_path(path);
+  temp_path += ".new";
+  if (!WriteFile(temp_path, content)) {
+    LOG(kError) << "Could not write " << temp_path;
+    return false;
+  }
+  boost::system::error_code error_code;
+  fs::rename(temp_path, path, error_code);
+  if (error_code) {
+    LOG(kError) << "Could not replace " << path << ": " << error_code.message();
+    fs::remove(temp_path, error_code);
+    return false;
+  }
+  return true;
+}
+
 }  // namespace routing
 
 }  // namespace maidsafe
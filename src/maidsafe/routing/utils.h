@@ -19,6 +19,7 @@
 #ifndef MAIDSAFE_ROUTING_UTILS_H_
 #define MAIDSAFE_ROUTING_UTILS_H_
 
+#include <chrono>
 #include <string>
 #include <vector>
 
@@ -31,9 +32,11 @@
 #include "maidsafe/passport/types.h"
 
 #include "maidsafe/routing/api_config.h"
+#include "maidsafe/routing/metrics_snapshot.h"
 #include "maidsafe/routing/node_info.h"
 #include "maidsafe/routing/parameters.h"
 #include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/xor_distance.h"
 
 namespace maidsafe {
 
@@ -66,7 +69,7 @@ void HandleSymmetricNodeAdd(RoutingTable& routing_table, const NodeId& peer_id,
                             const asymm::PublicKey& public_key);
 GroupRangeStatus GetProximalRange(const NodeId& target_id, const NodeId& node_id,
                                   const NodeId& this_node_id,
-                                  const crypto::BigInt& proximity_radius,
+                                  const XorDistance& proximity_radius,
                                   const std::vector<NodeId>& holders);
 
 bool IsRoutingMessage(const protobuf::Message& message);
@@ -80,10 +83,39 @@ bool IsClientToClientMessageWithDifferentNodeIds(const protobuf::Message& messag
                                                  const bool is_destination_client);
 bool CheckId(const std::string& id_to_test);
 bool ValidateMessage(const protobuf::Message& message);
+// As above, setting |reason| if the message is invalid.
+bool ValidateMessage(const protobuf::Message& message, DropReason& reason);
+// Sets the message's hops_to_live for a message this node originates, recording it as the
+// message's hop_budget if it isn't Parameters::hops_to_live.
+void SetHopBudget(uint16_t hop_budget, protobuf::Message& message);
+// The hops a message has used of those it was first given, for Metrics::Delivered.
+int32_t HopsTaken(const protobuf::Message& message);
+// Sets a request's time_left to timeout if Parameters::request_deadlines is set.
+void SetTimeLeft(const std::chrono::steady_clock::duration& timeout, protobuf::Message& message);
+// Takes the time since received_time off the message's time_left, if it has one.
+void DeductTimeLeft(std::chrono::steady_clock::time_point received_time,
+                    protobuf::Message& message);
+// True if the message carries a time_left which has run out.
+bool IsExpired(const protobuf::Message& message);
+// When the requester of a message with a time_left stops waiting, reckoning from now; otherwise
+// time_point::max().
+std::chrono::steady_clock::time_point Deadline(const protobuf::Message& message);
+// Parses all but the payload (the data and signature fields) of |serialised| into |header|, leaving
+// the payload's encoding in |encoded_body|.  Appending |encoded_body| to the serialised |header|
+// yields the original message, so forwarding nodes can pass the payload on without parsing it.
+bool ParseMessageHeader(const std::string& serialised, protobuf::Message& header,
+                        std::string& encoded_body);
+// Compresses the message's payload, leaving it as it is if that doesn't make it smaller.
+void CompressData(protobuf::Message& message);
+// Undoes CompressData, returning false if the payload can't be uncompressed or would be larger
+// than Parameters::max_data_size uncompressed.
+bool UncompressData(protobuf::Message& message);
 void SetProtobufEndpoint(const boost::asio::ip::udp::endpoint& endpoint,
                          protobuf::Endpoint* pb_endpoint);
 boost::asio::ip::udp::endpoint GetEndpointFromProtobuf(const protobuf::Endpoint& pb_endpoint);
 std::string MessageTypeString(const protobuf::Message& message);
+// As above, for a message of the given type field and request flag.
+std::string MessageTypeString(int32_t type, bool request);
 std::vector<boost::asio::ip::udp::endpoint> OrderBootstrapList(
     std::vector<boost::asio::ip::udp::endpoint> peer_endpoints);
 protobuf::NatType NatTypeProtobuf(const rudp::NatType& nat_type);
@@ -91,6 +123,8 @@ rudp::NatType NatTypeFromProtobuf(const protobuf::NatType& nat_type_proto);
 std::string PrintMessage(const protobuf::Message& message);
 std::vector<NodeId> DeserializeNodeIdList(const std::string& node_list_str);
 std::string SerializeNodeIdList(const std::vector<NodeId>& node_list);
+// Writes to a temporary file which is then renamed to 'path', so readers never see a partial file.
+bool WriteFileAtomically(const fs::path& path, const std::string& content);
 }  // namespace routing
 
 }  // namespace maidsafe
@@ -0,0 +1,172 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/xor_distance.h"
+
+#include <algorithm>
+#include <cassert>
+#include <string>
+#include <utility>
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+const uint64_t kLowHalfMask(0xffffffff);
+
+uint64_t LoadBigEndianWord(const char* bytes) {
+  uint64_t word(0);
+  for (size_t index(0); index != sizeof(uint64_t); ++index)
+    word = (word << 8) | static_cast<unsigned char>(bytes[index]);
+  return word;
+}
+
+void StoreBigEndianWord(uint64_t word, size_t offset, std::string& bytes) {
+  for (size_t index(offset + sizeof(uint64_t)); index-- != offset; word >>= 8)
+    bytes[index] = static_cast<char>(word & 0xff);
+}
+
+template <typename T>
+void PartialSortDistances(std::vector<std::pair<XorDistance, const T*>>& distances,
+                          size_t count) {
+  std::partial_sort(distances.begin(), distances.begin() + count, distances.end(),
+                    [](const std::pair<XorDistance, const T*>& lhs,
+                       const std::pair<XorDistance, const T*>& rhs) {
+    return lhs.first < rhs.first;
+  });
+}
+
+}  // unnamed namespace
+
+const size_t XorDistance::kWords;
+
+XorDistance::XorDistance() : words_() {}
+
+XorDistance::XorDistance(const NodeId& distance) : words_() {
+  const std::string& raw_distance(distance.string());
+  const char* bytes(raw_distance.data());
+  for (size_t index(1); index != kWords; ++index, bytes += sizeof(uint64_t))
+    words_[index] = LoadBigEndianWord(bytes);
+}
+
+XorDistance::XorDistance(const NodeId& node_id, const NodeId& target) : words_() {
+  const std::string& raw_id(node_id.string());
+  const std::string& raw_target(target.string());
+  const char* id_bytes(raw_id.data());
+  const char* target_bytes(raw_target.data());
+  for (size_t index(1); index != kWords; ++index) {
+    words_[index] = LoadBigEndianWord(id_bytes) ^ LoadBigEndianWord(target_bytes);
+    id_bytes += sizeof(uint64_t);
+    target_bytes += sizeof(uint64_t);
+  }
+}
+
+XorDistance& XorDistance::operator+=(const XorDistance& other) {
+  uint64_t carry(0);
+  for (size_t index(kWords); index-- != 0;) {
+    const uint64_t sum(words_[index] + other.words_[index]);
+    const uint64_t next_carry((sum < words_[index]) ? 1 : 0);
+    words_[index] = sum + carry;
+    carry = next_carry | ((words_[index] < sum) ? 1 : 0);
+  }
+  assert(carry == 0);
+  return *this;
+}
+
+// Both operators work in 32-bit halves so every intermediate product or dividend fits a uint64_t.
+XorDistance& XorDistance::operator*=(uint32_t factor) {
+  uint64_t carry(0);
+  for (size_t index(kWords); index-- != 0;) {
+    const uint64_t low((words_[index] & kLowHalfMask) * factor + carry);
+    const uint64_t high((words_[index] >> 32) * factor + (low >> 32));
+    words_[index] = (high << 32) | (low & kLowHalfMask);
+    carry = high >> 32;
+  }
+  assert(carry == 0);
+  return *this;
+}
+
+XorDistance& XorDistance::operator/=(uint32_t divisor) {
+  assert(divisor != 0);
+  uint64_t remainder(0);
+  for (auto& word : words_) {
+    const uint64_t high(((remainder << 32) | (word >> 32)) / divisor);
+    remainder = ((remainder << 32) | (word >> 32)) % divisor;
+    const uint64_t low(((remainder << 32) | (word & kLowHalfMask)) / divisor);
+    remainder = ((remainder << 32) | (word & kLowHalfMask)) % divisor;
+    word = (high << 32) | low;
+  }
+  return *this;
+}
+
+NodeId XorDistance::ToNodeId() const {
+  assert(words_[0] == 0);
+  std::string raw_distance(NodeId::kSize, '\0');
+  for (size_t index(1); index != kWords; ++index)
+    StoreBigEndianWord(words_[index], (index - 1) * sizeof(uint64_t), raw_distance);
+  return NodeId(raw_distance);
+}
+
+bool operator<(const XorDistance& lhs, const XorDistance& rhs) {
+  for (size_t index(0); index != XorDistance::kWords; ++index) {
+    if (lhs.words_[index] != rhs.words_[index])
+      return lhs.words_[index] < rhs.words_[index];
+  }
+  return false;
+}
+
+bool operator==(const XorDistance& lhs, const XorDistance& rhs) {
+  return lhs.words_ == rhs.words_;
+}
+
+std::vector<const NodeInfo*> RankFromTarget(std::vector<NodeInfo>::const_iterator first,
+                                            std::vector<NodeInfo>::const_iterator last,
+                                            const NodeId& target, size_t count) {
+  std::vector<std::pair<XorDistance, const NodeInfo*>> distances;
+  distances.reserve(static_cast<size_t>(last - first));
+  for (auto itr(first); itr != last; ++itr)
+    distances.push_back(std::make_pair(XorDistance(itr->node_id, target), &(*itr)));
+  count = std::min(count, distances.size());
+  PartialSortDistances(distances, count);
+  std::vector<const NodeInfo*> ranked;
+  ranked.reserve(count);
+  for (size_t index(0); index != count; ++index)
+    ranked.push_back(distances[index].second);
+  return ranked;
+}
+
+std::vector<NodeId> RankIdsFromTarget(const std::vector<NodeId>& node_ids, const NodeId& target,
+                                      size_t count) {
+  std::vector<std::pair<XorDistance, const NodeId*>> distances;
+  distances.reserve(node_ids.size());
+  for (const auto& node_id : node_ids)
+    distances.push_back(std::make_pair(XorDistance(node_id, target), &node_id));
+  count = std::min(count, distances.size());
+  PartialSortDistances(distances, count);
+  std::vector<NodeId> ranked;
+  ranked.reserve(count);
+  for (size_t index(0); index != count; ++index)
+    ranked.push_back(*distances[index].second);
+  return ranked;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe